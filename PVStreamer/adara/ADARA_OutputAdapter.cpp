@@ -5,6 +5,7 @@
 #include <arpa/inet.h>
 #include <netdb.h>
 #include <syslog.h>
+#include "AsyncLog.h"
 #include <time.h>
 #include <iomanip>
 #include <boost/lexical_cast.hpp>
@@ -87,15 +88,23 @@ OutputAdapter::~OutputAdapter()
   * not received for a configured interval, ADARA heartbeat packets are
   * transmitted as required by the ADARA protocol. When no clients are
   * connected, input packets are simply returned to the stream unused.
+  *
+  * Everything queued (up to PVSD_PKT_BATCH packets) is taken per wakeup,
+  * and the translated ADARA packets are coalesced into one buffer that
+  * is written to each client in a single send, rather than two writes per
+  * packet per client. State updates and sends for a batch are made under
+  * m_mutex, so new clients only ever see a snapshot taken between batches.
   */
 void
 OutputAdapter::streamProcessingThread()
 {
-    StreamPacket   *pvs_pkt;
+    StreamPacket   *pvs_pkts[PVSD_PKT_BATCH];
+    size_t          count;
     OutPacket       adara_pkt;
     OutPacket       heartbeat_pkt;
     bool            timeout_flag = false;
     vector<uint8_t> payload;
+    vector<uint8_t> out_buf;
 
     heartbeat_pkt.payload_len = 0;
     heartbeat_pkt.format = ADARA_PKT_TYPE(
@@ -103,12 +112,14 @@ OutputAdapter::streamProcessingThread()
         ::ADARA::PacketType::HEARTBEAT_VERSION );
     heartbeat_pkt.nsec = 0;
 
+    out_buf.reserve( PVSD_SEND_COALESCE );
+
     while ( 1 )
     {
-        pvs_pkt = m_stream_api->getFilledPacket( m_heartbeat,
-            timeout_flag );
+        count = m_stream_api->getFilledPackets( pvs_pkts, PVSD_PKT_BATCH,
+            m_heartbeat, timeout_flag );
 
-        if ( !pvs_pkt )
+        if ( !count )
         {
             if ( timeout_flag )
             {
@@ -149,45 +160,68 @@ OutputAdapter::streamProcessingThread()
             {
                 // A null packet w/o timeout means queues have been
                 // deactivated and we should exit the thread.
-                syslog( LOG_ERR,
+                ASYNC_SYSLOG( LOG_ERR,
                     "PVSD ERROR: %s: Null Packet/No Timeout - %s",
                     "OutputAdapter::streamProcessingThread()",
                     "Queues Deactivated, Exiting Thread" );
-                usleep(33333); // give syslog a chance...
                 break;
             }
         }
         else
         {
-            // Update internal state data (regardless of connection status)
-            switch ( pvs_pkt->type )
+            // Hold the lock from the first state update until the batch
+            // has been sent: a client that connects in between would
+            // otherwise get a current-state snapshot that is newer than
+            // the (older) packets still waiting in out_buf.
+            boost::lock_guard<boost::recursive_mutex> lock(m_mutex);
+
+            bool send_pkts = connected();
+
+            out_buf.clear();
+
+            for ( size_t i = 0; i < count; ++i )
             {
-            case DeviceDefined:
-                defineDevice( pvs_pkt->device );
-                break;
+                StreamPacket *pvs_pkt = pvs_pkts[i];
 
-            case DeviceRedefined:
-                redefineDevice( pvs_pkt->device, pvs_pkt->old_device );
-                break;
+                // Update internal state data (regardless of connection status)
+                switch ( pvs_pkt->type )
+                {
+                case DeviceDefined:
+                    defineDevice( pvs_pkt->device );
+                    break;
 
-            case DeviceUndefined:
-                undefineDevice( pvs_pkt->device );
-                break;
+                case DeviceRedefined:
+                    redefineDevice( pvs_pkt->device, pvs_pkt->old_device );
+                    break;
 
-            case VariableUpdate:
-                updatePV( pvs_pkt->pv, pvs_pkt->state );
-                break;
-            }
+                case DeviceUndefined:
+                    undefineDevice( pvs_pkt->device );
+                    break;
 
-            // If connected, translate and send packet(s)
-            if ( connected() )
-            {
-                payload.clear();
-                if ( translate( *pvs_pkt, adara_pkt, payload ) )
-                    sendPacket( adara_pkt, payload );
+                case VariableUpdate:
+                    updatePV( pvs_pkt->pv, pvs_pkt->state );
+                    break;
+                }
+
+                // If connected, translate and queue packet(s) for sending
+                if ( send_pkts )
+                {
+                    payload.clear();
+                    if ( translate( *pvs_pkt, adara_pkt, payload ) )
+                        appendPacket( out_buf, adara_pkt, payload );
+
+                    if ( out_buf.size() >= PVSD_SEND_COALESCE )
+                    {
+                        sendBuffer( out_buf );
+                        out_buf.clear();
+                    }
+                }
             }
 
-            m_stream_api->putFreePacket( pvs_pkt );
+            if ( !out_buf.empty() )
+                sendBuffer( out_buf );
+
+            m_stream_api->putFreePackets( pvs_pkts, count );
         }
     }
 }
@@ -203,9 +237,8 @@ OutputAdapter::translate( StreamPacket &a_pv_pkt, OutPacket &a_adara_pkt,
 {
     // A Little Gratuitous Debug Logging... ;-b
     if ( a_pv_pkt.device == NULL ) {
-        syslog( LOG_ERR, "PVSD ERROR: %s: Null Device! type=%d",
+        ASYNC_SYSLOG( LOG_ERR, "PVSD ERROR: %s: Null Device! type=%d",
             "OutputAdapter::translate()", a_pv_pkt.type );
-        usleep(33333); // give syslog a chance...
     }
 
     switch ( a_pv_pkt.type )
@@ -227,16 +260,14 @@ OutputAdapter::translate( StreamPacket &a_pv_pkt, OutPacket &a_adara_pkt,
 
     case VariableUpdate:
         if ( a_pv_pkt.pv == NULL ) {
-            syslog( LOG_ERR, "PVSD ERROR: %s: Null PV! type=%d",
+            ASYNC_SYSLOG( LOG_ERR, "PVSD ERROR: %s: Null PV! type=%d",
                 "OutputAdapter::translate()", a_pv_pkt.type );
-            usleep(33333); // give syslog a chance...
         }
         else if ( a_pv_pkt.pv->m_device == NULL ) {
-            syslog( LOG_ERR,
+            ASYNC_SYSLOG( LOG_ERR,
                 "PVSD ERROR: %s: Null PV Device! type=%d varId=0x%x/%d",
                 "OutputAdapter::translate()", a_pv_pkt.type,
                 a_pv_pkt.pv->m_id, a_pv_pkt.pv->m_id );
-            usleep(33333); // give syslog a chance...
         }
 
         buildVVP( a_adara_pkt, a_pv_pkt.pv, a_pv_pkt.state, a_payload );
@@ -412,14 +443,13 @@ OutputAdapter::buildDDP( OutPacket &a_adara_pkt,
     // "Empty" Descriptor XML for Device "Undefine"...
     else
     {
-        syslog( LOG_ERR,
+        ASYNC_SYSLOG( LOG_ERR,
         "%s: %s: %s Device [%s] (%s id=%d) %s",
             "PVSD ERROR", "OutputAdapter::buildDDP()",
             "Sending Empty Descriptor to *Undefine*",
             a_device->m_name.c_str(),
             "device", a_device->m_id,
             " - Setting Payload Size to Zero" );
-        usleep(33333); // give syslog a chance...
     }
 
     a_adara_pkt.ddp.xml_len = (unsigned long) a_payload.size();
@@ -510,7 +540,7 @@ OutputAdapter::buildVVP( OutPacket &a_adara_pkt,
         a_adara_pkt.vvp_str.str_len = a_state.m_str_val.size();
 
         // (For Now) Log String PV Value Updates...
-        syslog( LOG_ERR,
+        ASYNC_SYSLOG( LOG_ERR,
             "%s: %s Device [%s] (%s id=%d) PV <%s> (%s) (pv id=%d) = [%s]",
             "OutputAdapter::buildVVP()",
             "String PV Value Update for",
@@ -518,7 +548,6 @@ OutputAdapter::buildVVP( OutPacket &a_adara_pkt,
             "device", a_pv->m_device->m_id,
             a_pv->m_name.c_str(), a_pv->m_connection.c_str(),
             a_pv->m_id, a_state.m_str_val.c_str() );
-        usleep(33333); // give syslog a chance...
 
         // Set payload
         a_payload = vector<uint8_t>( a_state.m_str_val.size() );
@@ -570,7 +599,7 @@ OutputAdapter::buildVVP( OutPacket &a_adara_pkt,
         }
         else
         {
-            syslog( LOG_ERR,
+            ASYNC_SYSLOG( LOG_ERR,
             "%s: %s: %s Device [%s] (%s id=%d) PV <%s> (%s) (pv id=%d) %s",
                 "PVSD ERROR", "OutputAdapter::buildVVP()",
                 "Missing Integer Array Data for",
@@ -578,7 +607,6 @@ OutputAdapter::buildVVP( OutPacket &a_adara_pkt,
                 "device", a_pv->m_device->m_id,
                 a_pv->m_name.c_str(), a_pv->m_connection.c_str(),
                 a_pv->m_id, " - Setting Payload Size to Zero" );
-            usleep(33333); // give syslog a chance...
             elemCount = 0;
         }
 
@@ -589,9 +617,8 @@ OutputAdapter::buildVVP( OutPacket &a_adara_pkt,
             arrayElems << " " << uint_array[i];
         }
         arrayElems << " ]";
-        syslog( LOG_INFO, "%s: uint_array = %s",
+        ASYNC_SYSLOG( LOG_INFO, "%s: uint_array = %s",
             "OutputAdapter::buildVVP()", arrayElems.str().c_str() );
-        usleep(33333); // give syslog a chance...
 
         a_adara_pkt.vvp_array.elemCount = elemCount;
         a_payload = vector<uint8_t>( elemCount * sizeof(uint32_t) );
@@ -628,7 +655,7 @@ OutputAdapter::buildVVP( OutPacket &a_adara_pkt,
         }
         else
         {
-            syslog( LOG_ERR,
+            ASYNC_SYSLOG( LOG_ERR,
             "%s: %s: %s Device [%s] (%s id=%d) PV <%s> (%s) (pv id=%d) %s",
                 "PVSD ERROR", "OutputAdapter::buildVVP()",
                 "Missing Double Array Data for",
@@ -636,7 +663,6 @@ OutputAdapter::buildVVP( OutPacket &a_adara_pkt,
                 "device", a_pv->m_device->m_id,
                 a_pv->m_name.c_str(), a_pv->m_connection.c_str(),
                 a_pv->m_id, " - Setting Payload Size to Zero" );
-            usleep(33333); // give syslog a chance...
             elemCount = 0;
         }
 
@@ -647,9 +673,8 @@ OutputAdapter::buildVVP( OutPacket &a_adara_pkt,
             arrayElems << " " << double_array[i];
         }
         arrayElems << " ]";
-        syslog( LOG_INFO, "%s: double_array = %s",
+        ASYNC_SYSLOG( LOG_INFO, "%s: double_array = %s",
             "OutputAdapter::buildVVP()", arrayElems.str().c_str() );
-        usleep(33333); // give syslog a chance...
 
         a_adara_pkt.vvp_array.elemCount = elemCount;
         a_payload = vector<uint8_t>( elemCount * sizeof(double) );
@@ -902,11 +927,10 @@ OutputAdapter::updatePV( PVDescriptor *a_pv, PVState &a_state )
         {
             sstr << " *** NO PV ***";
         }
-        syslog( LOG_ERR,
+        ASYNC_SYSLOG( LOG_ERR,
             "%s %s: %s - PV Descriptor Not Found for State Update! %s",
             "PVSD ERROR:", "OutputAdapter::updatePV()", sstr.str().c_str(),
             "Ignoring..." );
-        usleep(33333); // give syslog a chance...
     }
 }
 
@@ -1085,18 +1109,16 @@ OutputAdapter::socketListenThread()
         if ( info.socket < 0 )
         {
             int e = errno;
-            syslog( LOG_ERR,
+            ASYNC_SYSLOG( LOG_ERR,
                 "PVSD ERROR: %s: Socket Accept Returned Error (%d) - %s",
                 "OutputAdapter::socketListenThread()",
                 e, strerror(e) );
-            usleep(33333); // give syslog a chance...
 
             if ( !m_active )
             {
-                syslog( LOG_ERR, "PVSD ERROR: %s: %s",
+                ASYNC_SYSLOG( LOG_ERR, "PVSD ERROR: %s: %s",
                     "OutputAdapter::socketListenThread()",
                     "Output Adapter No Longer Active, Exiting Thread" );
-                usleep(33333); // give syslog a chance...
                 break;
             }
         }
@@ -1106,11 +1128,10 @@ OutputAdapter::socketListenThread()
             info.addr = inet_ntoa(
                 ((struct sockaddr_in &)client_addr).sin_addr );
 
-            syslog( LOG_ERR,
+            ASYNC_SYSLOG( LOG_ERR,
                 "%s %s: Connected to ADARA SMS Client at %s (socket=%d)",
                 "PVSD ERROR:", "OutputAdapter::socketListenThread()",
                 info.addr.c_str(), info.socket );
-            usleep(33333); // give syslog a chance...
 
             boost::lock_guard<boost::recursive_mutex> lock(m_mutex);
 
@@ -1122,11 +1143,10 @@ OutputAdapter::socketListenThread()
             // need to send it all currently active devices (if any)
             sendCurrentData( info.socket );
 
-            syslog( LOG_ERR,
+            ASYNC_SYSLOG( LOG_ERR,
                 "%s %s: Initial Sends Complete to %s at %s (socket=%d)",
                 "PVSD ERROR:", "OutputAdapter::socketListenThread()",
                 "ADARA SMS Client", info.addr.c_str(), info.socket );
-            usleep(33333); // give syslog a chance...
         }
     }
 }
@@ -1142,10 +1162,9 @@ OutputAdapter::sendCurrentData( int a_socket )
 
     vector<uint8_t> payload;
 
-    syslog( LOG_INFO,
+    ASYNC_SYSLOG( LOG_INFO,
         "%s: Sending Current Data to ADARA SMS Client (socket=%d)",
         "OutputAdapter::sendCurrentData()", a_socket );
-    usleep(33333); // give syslog a chance...
 
     // Use current time for DDP packets
     adara_pkt.sec = (uint32_t)time(0) - EPICS_TIME_OFFSET;
@@ -1157,11 +1176,10 @@ OutputAdapter::sendCurrentData( int a_socket )
     for ( set<DeviceRecordPtr>::iterator idev = m_devices.begin();
             idev != m_devices.end(); ++idev )
     {
-        syslog( LOG_INFO,
+        ASYNC_SYSLOG( LOG_INFO,
             "%s: Sending Device [%s] Descriptor to %s (socket=%d)",
             "OutputAdapter::sendCurrentData()", (*idev)->m_name.c_str(),
             "ADARA SMS Client", a_socket );
-        usleep(33333); // give syslog a chance...
 
         payload.clear();
         buildDDP( adara_pkt, payload, *idev );
@@ -1184,12 +1202,11 @@ OutputAdapter::sendCurrentData( int a_socket )
         if ( sentloghdr.str().size() + pvlist.str().size() + pvstr.size()
                 > 2000 )
         {
-            syslog( LOG_INFO,
+            ASYNC_SYSLOG( LOG_INFO,
                 "%s: Sent PV %s List to %s (socket=%d) -%s...",
                 "OutputAdapter::sendCurrentData()",
                 "Variable Value Update", "ADARA SMS Client", a_socket,
                 pvlist.str().c_str() );
-            usleep(33333); // give syslog a chance...
             pvlist.str("");
         }
         pvlist << pvstr;
@@ -1199,10 +1216,9 @@ OutputAdapter::sendCurrentData( int a_socket )
         sendPacket( adara_pkt, payload, a_socket );
     }
 
-    syslog( LOG_INFO, "%s: Sent PV %s List to %s (socket=%d) -%s.",
+    ASYNC_SYSLOG( LOG_INFO, "%s: Sent PV %s List to %s (socket=%d) -%s.",
         "OutputAdapter::sendCurrentData()", "Variable Value Update",
         "ADARA SMS Client", a_socket, pvlist.str().c_str() );
-    usleep(33333); // give syslog a chance...
 }
 
 
@@ -1216,10 +1232,9 @@ OutputAdapter::sendSourceInfo( int a_socket )
 
     vector<uint8_t> payload;
 
-    syslog( LOG_INFO,
+    ASYNC_SYSLOG( LOG_INFO,
         "%s: Sending Source List to ADARA SMS Client (socket=%d)",
         "OutputAdapter::sendSourceInfo()", a_socket );
-    usleep(33333); // give syslog a chance...
 
     adara_pkt.payload_len = 0;
     adara_pkt.format = ADARA_PKT_TYPE(
@@ -1255,9 +1270,8 @@ OutputAdapter::sendPacket( OutPacket &a_adara_pkt,
 
         if ( !res )
         {
-            syslog( LOG_ERR, "PVSD ERROR: %s: Send Failed! (socket=%d)",
+            ASYNC_SYSLOG( LOG_ERR, "PVSD ERROR: %s: Send Failed! (socket=%d)",
                 "OutputAdapter::sendPacket()", a_socket );
-            usleep(33333); // give syslog a chance...
 
             // Disconnect from client
             boost::lock_guard<boost::recursive_mutex> lock(m_mutex);
@@ -1269,11 +1283,10 @@ OutputAdapter::sendPacket( OutPacket &a_adara_pkt,
             {
                 if ( ic->socket == a_socket )
                 {
-                    syslog( LOG_ERR, "PVSD ERROR: %s: %s at %s",
+                    ASYNC_SYSLOG( LOG_ERR, "PVSD ERROR: %s: %s at %s",
                         "OutputAdapter::sendPacket()",
                         "Disconnecting from ADARA SMS Client",
                         ic->addr.c_str() );
-                    usleep(33333); // give syslog a chance...
 
                     //notifyDisconnect( ic->addr );
                     m_client_info.erase(ic);
@@ -1302,12 +1315,11 @@ OutputAdapter::sendPacket( OutPacket &a_adara_pkt,
 
             if ( !res )
             {
-                syslog( LOG_ERR,
+                ASYNC_SYSLOG( LOG_ERR,
                     "PVSD ERROR: %s: Send Failed! (socket=%d) %s at %s",
                     "OutputAdapter::sendPacket()", ic->socket,
                     "Disconnecting from ADARA SMS Client",
                     ic->addr.c_str() );
-                usleep(33333); // give syslog a chance...
 
                 // Disconnect from client
                 close( ic->socket );
@@ -1321,6 +1333,57 @@ OutputAdapter::sendPacket( OutPacket &a_adara_pkt,
 }
 
 
+/** \brief Appends an ADARA packet (header and payload) to an output buffer.
+  * \param a_buf - Buffer to append to
+  * \param a_adara_pkt - ADARA packet to append
+  * \param a_payload - Optional packet payload (as for sendPacket)
+  */
+void
+OutputAdapter::appendPacket( vector<uint8_t> &a_buf,
+        OutPacket &a_adara_pkt, vector<uint8_t> &a_payload )
+{
+    uint32_t len = (int)a_adara_pkt.payload_len + 16;
+
+    if ( a_payload.size() )
+        len -= (int)a_payload.size();
+
+    const uint8_t *hdr = (const uint8_t *)&a_adara_pkt;
+    a_buf.insert( a_buf.end(), hdr, hdr + len );
+    a_buf.insert( a_buf.end(), a_payload.begin(), a_payload.end() );
+}
+
+
+/** \brief Sends a buffer of coalesced ADARA packets to ALL clients.
+  * \param a_buf - Buffer of complete ADARA packets (see appendPacket)
+  */
+void
+OutputAdapter::sendBuffer( vector<uint8_t> &a_buf )
+{
+    boost::lock_guard<boost::recursive_mutex> lock(m_mutex);
+
+    for ( list<ClientInfo>::iterator ic = m_client_info.begin();
+            ic != m_client_info.end(); )
+    {
+        if ( !send( ic->socket,
+                (const char *)a_buf.data(), (uint32_t)a_buf.size() ) )
+        {
+            ASYNC_SYSLOG( LOG_ERR,
+                "PVSD ERROR: %s: Send Failed! (socket=%d) %s at %s",
+                "OutputAdapter::sendBuffer()", ic->socket,
+                "Disconnecting from ADARA SMS Client",
+                ic->addr.c_str() );
+
+            // Disconnect from client
+            close( ic->socket );
+            //notifyDisconnect( ic->addr );
+            ic = m_client_info.erase(ic);
+        }
+        else
+            ic++;
+    }
+}
+
+
 bool
 OutputAdapter::send( int a_socket, const char *a_data, uint32_t a_len )
 {
@@ -1340,11 +1403,10 @@ OutputAdapter::send( int a_socket, const char *a_data, uint32_t a_len )
                     continue;
 
                 // Serious error
-                syslog( LOG_ERR,
+                ASYNC_SYSLOG( LOG_ERR,
                     "%s: %s: Socket Write Failed! len=%u (socket=%d) - %s",
                     "PVSD ERROR", "OutputAdapter::send()", a_len, a_socket,
                     strerror( errno ) );
-                usleep(33333); // give syslog a chance...
                 return false;
             }
 
@@ -1353,19 +1415,17 @@ OutputAdapter::send( int a_socket, const char *a_data, uint32_t a_len )
     }
     catch ( exception &e )
     {
-        syslog( LOG_ERR,
+        ASYNC_SYSLOG( LOG_ERR,
             "%s: %s: Socket Write Exception! len=%u (socket=%d) - %s",
             "PVSD ERROR", "OutputAdapter::send()", a_len, a_socket,
             e.what() );
-        usleep(33333); // give syslog a chance...
         return false;
     }
     catch (...)
     {
-        syslog( LOG_ERR,
+        ASYNC_SYSLOG( LOG_ERR,
             "%s: %s: Socket Write Unknown Exception! len=%u (socket=%d)",
             "PVSD ERROR", "OutputAdapter::send()", a_len, a_socket );
-        usleep(33333); // give syslog a chance...
         return false;
     }
 
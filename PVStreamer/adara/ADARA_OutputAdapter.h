@@ -15,6 +15,11 @@
 
 #define PVSD_PROTOCOL   0
 
+/// Max stream packets taken from the StreamService per wakeup
+#define PVSD_PKT_BATCH      64
+/// Coalesced ADARA output is flushed to clients once it reaches this size
+#define PVSD_SEND_COALESCE  65536
+
 namespace PVS {
 namespace ADARA {
 
@@ -106,6 +111,10 @@ private:
     void            sendPacket( OutPacket & a_adara_pkt,
                         std::vector<uint8_t> &a_payload,
                         int a_socket = -1 );
+    void            appendPacket( std::vector<uint8_t> &a_buf,
+                        OutPacket & a_adara_pkt,
+                        std::vector<uint8_t> &a_payload );
+    void            sendBuffer( std::vector<uint8_t> &a_buf );
     void            sendSourceInfo( int a_socket );
     void            sendCurrentData( int a_socket );
     bool            send( int a_socket,
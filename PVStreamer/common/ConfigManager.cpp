@@ -4,6 +4,7 @@
 #include "StreamService.h"
 #include "ADARA.h" // Needed for PV status bits
 #include <syslog.h>
+#include "AsyncLog.h"
 #include <unistd.h>
 
 using namespace std;
@@ -60,10 +61,9 @@ DeviceRecordPtr
 ConfigManager::defineDevice( DeviceDescriptor &a_descriptor,
         bool &a_device_changed )
 {
-    // syslog( LOG_DEBUG, "ConfigMgr::defineDevice(): [%s] %s/%lu",
+    // ASYNC_SYSLOG( LOG_DEBUG, "ConfigMgr::defineDevice(): [%s] %s/%lu",
         // a_descriptor.m_name.c_str(), a_descriptor.m_source.c_str(),
         // (unsigned long)a_descriptor.m_protocol );
-    // usleep(33333); // give syslog a chance...
 
     boost::lock_guard<boost::mutex> lock(m_mutex);
     DeviceRecordPtr record;
@@ -86,7 +86,7 @@ ConfigManager::defineDevice( DeviceDescriptor &a_descriptor,
             // Check for Device ID Re-Numbered...
             if ( a_descriptor.m_id != idev->second->m_id )
             {
-                syslog( LOG_ERR, "%s %s: %s: [%s] %s/%lu, (%s %d -> %d)",
+                ASYNC_SYSLOG( LOG_ERR, "%s %s: %s: [%s] %s/%lu, (%s %d -> %d)",
                     "PVSD ERROR:", "ConfigManager::defineDevice()",
                     "Device Definition Unchanged",
                     a_descriptor.m_name.c_str(),
@@ -94,7 +94,6 @@ ConfigManager::defineDevice( DeviceDescriptor &a_descriptor,
                     (unsigned long) a_descriptor.m_protocol,
                     "*** Device ID Re-Numbered",
                     idev->second->m_id, a_descriptor.m_id );
-                usleep(33333); // give syslog a chance...
 
                 DeviceDescriptor *new_desc = new DeviceDescriptor(
                     *idev->second ); // Deep Copy, Keep ID!
@@ -111,14 +110,13 @@ ConfigManager::defineDevice( DeviceDescriptor &a_descriptor,
             }
             else
             {
-                syslog( LOG_INFO, "%s: %s: [%s] %s/%lu (Device ID=%d)",
+                ASYNC_SYSLOG( LOG_INFO, "%s: %s: [%s] %s/%lu (Device ID=%d)",
                     "ConfigManager::defineDevice()",
                     "Device Definition Unchanged",
                     a_descriptor.m_name.c_str(),
                     a_descriptor.m_source.c_str(),
                     (unsigned long) a_descriptor.m_protocol,
                     a_descriptor.m_id );
-                usleep(33333); // give syslog a chance...
 
                 // Descriptor has not changed, just return existing record
                 record = idev->second;
@@ -131,7 +129,7 @@ ConfigManager::defineDevice( DeviceDescriptor &a_descriptor,
                 if ( a_descriptor.m_active_pv_conn.compare(
                     record->m_active_pv_conn ) )
                 {
-                    syslog( LOG_ERR,
+                    ASYNC_SYSLOG( LOG_ERR,
                         "%s %s: %s: [%s] (%s: [%s] -> [%s], %s = %d (%s))",
                         "PVSD ERROR:", "ConfigManager::defineDevice()",
                         "Re-Creating Active Status PV",
@@ -141,7 +139,6 @@ ConfigManager::defineDevice( DeviceDescriptor &a_descriptor,
                         a_descriptor.m_active_pv_conn.c_str(),
                         "active", a_descriptor.m_active,
                         ( a_descriptor.m_active ) ? "true" : "false" );
-                    usleep(33333); // give syslog a chance...
 
                     delete record->m_active_pv;
 
@@ -158,13 +155,12 @@ ConfigManager::defineDevice( DeviceDescriptor &a_descriptor,
             // Otherwise, Clear Out Any Active Status Meta-Data...
             else if ( !record->m_active_pv_conn.empty() )
             {
-                syslog( LOG_ERR, "%s %s: %s: [%s] (%s: [%s] -> [])",
+                ASYNC_SYSLOG( LOG_ERR, "%s %s: %s: [%s] (%s: [%s] -> [])",
                     "PVSD ERROR:", "ConfigManager::defineDevice()",
                     "Removing Active Status PV",
                     a_descriptor.m_name.c_str(),
                     "New Descriptor No Longer Has Active Status PV",
                     record->m_active_pv_conn.c_str() );
-                usleep(33333); // give syslog a chance...
 
                 delete record->m_active_pv;
                 record->m_active_pv_conn.clear();
@@ -178,7 +174,7 @@ ConfigManager::defineDevice( DeviceDescriptor &a_descriptor,
 
             if ( a_descriptor.m_id != idev->second->m_id )
             {
-                syslog( LOG_ERR,
+                ASYNC_SYSLOG( LOG_ERR,
                     "%s %s: Re-defining Device: [%s] %s/%lu (%s %d -> %d)",
                     "PVSD ERROR:", "ConfigManager::defineDevice()",
                     a_descriptor.m_name.c_str(),
@@ -186,18 +182,16 @@ ConfigManager::defineDevice( DeviceDescriptor &a_descriptor,
                     (unsigned long) a_descriptor.m_protocol,
                     "*** Device ID Re-Numbered",
                     idev->second->m_id, a_descriptor.m_id );
-                usleep(33333); // give syslog a chance...
             }
             else
             {
-                syslog( LOG_ERR,
+                ASYNC_SYSLOG( LOG_ERR,
                     "%s %s: Re-defining Device: [%s] %s/%lu (Device ID=%d)",
                     "PVSD ERROR:", "ConfigManager::defineDevice()",
                     a_descriptor.m_name.c_str(),
                     a_descriptor.m_source.c_str(),
                     (unsigned long) a_descriptor.m_protocol,
                     idev->second->m_id );
-                usleep(33333); // give syslog a chance...
             }
 
             // Record is different, must make new record but
@@ -246,7 +240,7 @@ ConfigManager::defineDevice( DeviceDescriptor &a_descriptor,
 
                         used_id = true;
 
-                        syslog( LOG_INFO,
+                        ASYNC_SYSLOG( LOG_INFO,
                         "%s: %s [%s] (%s=%d) %s <%s> (%s) - %s PV ID=%d",
                             "ConfigManager::defineDevice()",
                             "Device", new_desc->m_name.c_str(),
@@ -255,7 +249,6 @@ ConfigManager::defineDevice( DeviceDescriptor &a_descriptor,
                             new_desc->m_active_pv->m_name.c_str(),
                             new_desc->m_active_pv->m_connection.c_str(),
                             "Keep", new_desc->m_active_pv->m_id );
-                        usleep(33333); // give syslog a chance...
                     }
                 }
 
@@ -263,7 +256,7 @@ ConfigManager::defineDevice( DeviceDescriptor &a_descriptor,
                 // Just Clean Up the Old Active Statue PV...
                 if ( !used_id )
                 {
-                    syslog( LOG_ERR,
+                    ASYNC_SYSLOG( LOG_ERR,
                     "%s %s: %s [%s] (%s=%d) %s <%s> (%s) (PV ID=%d)",
                         "PVSD ERROR:", "ConfigManager::defineDevice()",
                         "Device", new_desc->m_name.c_str(),
@@ -272,7 +265,6 @@ ConfigManager::defineDevice( DeviceDescriptor &a_descriptor,
                         idev->second->m_active_pv->m_name.c_str(),
                         idev->second->m_active_pv->m_connection.c_str(),
                         idev->second->m_active_pv->m_id );
-                    usleep(33333); // give syslog a chance...
 
                     sendPvUndefined( idev->second,
                         idev->second->m_active_pv );
@@ -291,7 +283,7 @@ ConfigManager::defineDevice( DeviceDescriptor &a_descriptor,
                 // Not in New Descriptor
                 if ( !(new_pv = new_desc->getPvByName( (*ipv)->m_name )) )
                 {
-                    syslog( LOG_ERR,
+                    ASYNC_SYSLOG( LOG_ERR,
                     "%s %s: %s [%s] (Device ID=%d) %s <%s> (%s) (PV ID=%d)",
                         "PVSD ERROR:", "ConfigManager::defineDevice()",
                         "Device", new_desc->m_name.c_str(), new_desc->m_id,
@@ -299,7 +291,6 @@ ConfigManager::defineDevice( DeviceDescriptor &a_descriptor,
                         (*ipv)->m_name.c_str(),
                         (*ipv)->m_connection.c_str(),
                         (*ipv)->m_id );
-                    usleep(33333); // give syslog a chance...
 
                     sendPvUndefined( idev->second, *ipv );
                 }
@@ -312,7 +303,7 @@ ConfigManager::defineDevice( DeviceDescriptor &a_descriptor,
 
                     pv_ids.insert( new_pv->m_id );
 
-                    syslog( LOG_INFO,
+                    ASYNC_SYSLOG( LOG_INFO,
                     "%s: %s [%s] (Device ID=%d) %s <%s> (%s) - %s PV ID=%d",
                         "ConfigManager::defineDevice()", "Device",
                         new_desc->m_name.c_str(), new_desc->m_id,
@@ -320,7 +311,6 @@ ConfigManager::defineDevice( DeviceDescriptor &a_descriptor,
                         new_pv->m_name.c_str(),
                         new_pv->m_connection.c_str(),
                         "Keep", new_pv->m_id );
-                    usleep(33333); // give syslog a chance...
                 }
             }
 
@@ -345,7 +335,7 @@ ConfigManager::defineDevice( DeviceDescriptor &a_descriptor,
                 // Mark this PV ID, to be sure for the next guy... ;-D
                 pv_ids.insert( new_desc->m_active_pv->m_id );
 
-                syslog( LOG_ERR,
+                ASYNC_SYSLOG( LOG_ERR,
                     "%s %s: %s [%s] (%s=%d) %s <%s> (%s) - %s PV ID=%d",
                     "PVSD ERROR:", "ConfigManager::defineDevice()",
                     "Device", new_desc->m_name.c_str(),
@@ -354,7 +344,6 @@ ConfigManager::defineDevice( DeviceDescriptor &a_descriptor,
                     new_desc->m_active_pv->m_name.c_str(),
                     new_desc->m_active_pv->m_connection.c_str(),
                     "Assign", new_desc->m_active_pv->m_id );
-                usleep(33333); // give syslog a chance...
             }
 
             for ( ipv = new_desc->m_pvs.begin();
@@ -374,7 +363,7 @@ ConfigManager::defineDevice( DeviceDescriptor &a_descriptor,
                     // Mark this PV ID, to be sure for the next guy... ;-D
                     pv_ids.insert( (*ipv)->m_id );
 
-                    syslog( LOG_ERR,
+                    ASYNC_SYSLOG( LOG_ERR,
                         "%s %s: %s [%s] (%s=%d) %s <%s> (%s) - %s PV ID=%d",
                         "PVSD ERROR:", "ConfigManager::defineDevice()",
                         "Device", new_desc->m_name.c_str(),
@@ -383,7 +372,6 @@ ConfigManager::defineDevice( DeviceDescriptor &a_descriptor,
                         (*ipv)->m_name.c_str(),
                         (*ipv)->m_connection.c_str(),
                         "Assign", (*ipv)->m_id );
-                    usleep(33333); // give syslog a chance...
                 }
             }
 
@@ -408,13 +396,12 @@ ConfigManager::defineDevice( DeviceDescriptor &a_descriptor,
         DeviceDescriptor *new_desc =
             new DeviceDescriptor( a_descriptor ); // Deep Copy, Keep ID!
 
-        syslog( LOG_ERR,
+        ASYNC_SYSLOG( LOG_ERR,
             "%s %s: Defining New Device: [%s] %s/%lu (Device ID=%d)",
             "PVSD ERROR:", "ConfigManager::defineDevice()",
             a_descriptor.m_name.c_str(), a_descriptor.m_source.c_str(),
             (unsigned long) a_descriptor.m_protocol,
             new_desc->m_id );
-        usleep(33333); // give syslog a chance...
 
         // PV IDs can be assigned arbitrarily for new devices
 
@@ -425,7 +412,7 @@ ConfigManager::defineDevice( DeviceDescriptor &a_descriptor,
         {
             new_desc->m_active_pv->m_id = id++;
 
-            syslog( LOG_ERR,
+            ASYNC_SYSLOG( LOG_ERR,
                 "%s %s: %s [%s] (%s=%d) %s <%s> (%s) - Assign PV ID=%d",
                 "PVSD ERROR:", "ConfigManager::defineDevice()",
                 "Device", new_desc->m_name.c_str(),
@@ -434,7 +421,6 @@ ConfigManager::defineDevice( DeviceDescriptor &a_descriptor,
                 new_desc->m_active_pv->m_name.c_str(),
                 new_desc->m_active_pv->m_connection.c_str(),
                 new_desc->m_active_pv->m_id );
-            usleep(33333); // give syslog a chance...
         }
 
         for ( vector<PVDescriptor*>::iterator ipv = new_desc->m_pvs.begin();
@@ -442,7 +428,7 @@ ConfigManager::defineDevice( DeviceDescriptor &a_descriptor,
         {
             (*ipv)->m_id = id++;
 
-            syslog( LOG_ERR,
+            ASYNC_SYSLOG( LOG_ERR,
                 "%s %s: %s [%s] (%s=%d) New PV <%s> (%s) - Assign PV ID=%d",
                 "PVSD ERROR:", "ConfigManager::defineDevice()",
                 "Device", new_desc->m_name.c_str(),
@@ -450,7 +436,6 @@ ConfigManager::defineDevice( DeviceDescriptor &a_descriptor,
                 (*ipv)->m_name.c_str(),
                 (*ipv)->m_connection.c_str(),
                 (*ipv)->m_id );
-            usleep(33333); // give syslog a chance...
         }
 
         // Ensure all new PV names are unique
@@ -485,13 +470,12 @@ void
 ConfigManager::undefineDevice( DeviceRecordPtr &a_record,
         bool a_delete_device )
 {
-    syslog( LOG_ERR,
+    ASYNC_SYSLOG( LOG_ERR,
         "%s %s: Un-defining device: [%s] %s/%lu (Device ID=%d) %s=%u",
         "PVSD ERROR:", "ConfigManager::undefineDevice()",
         a_record->m_name.c_str(), a_record->m_source.c_str(),
         (unsigned long)a_record->m_protocol, a_record->m_id,
         "delete_device", a_delete_device );
-    usleep(33333); // give syslog a chance...
 
     boost::lock_guard<boost::mutex> lock(m_mutex);
 
@@ -621,7 +605,7 @@ ConfigManager::makePvNamesUnique( const string &a_key,
         // Only Change the Name as Needed... ;-D
         if ( count )
         {
-            syslog( LOG_ERR,
+            ASYNC_SYSLOG( LOG_ERR,
                 "%s %s: %s [%s] (%s=%d): %s <%s> to <%s> (%s) (PV ID=%d)!",
                 "PVSD ERROR:", "ConfigManager::makePvNamesUnique()",
                 "Device", a_descriptor.m_name.c_str(),
@@ -629,7 +613,6 @@ ConfigManager::makePvNamesUnique( const string &a_key,
                 "Renaming Name-Clash PV from",
                 (*ipv)->m_name.c_str(), new_name.c_str(),
                 (*ipv)->m_connection.c_str(), (*ipv)->m_id );
-            usleep(33333); // give syslog a chance...
 
             (*ipv)->m_name = new_name;
         }
@@ -653,7 +636,7 @@ ConfigManager::sendDeviceDefined( DeviceRecordPtr a_dev_desc )
     {
         if ( m_stream_api->getFreeQueueActive() )
         {
-            syslog( LOG_ERR,
+            ASYNC_SYSLOG( LOG_ERR,
                 "%s %s: %s! Device [%s] (Device ID=%d) %s! [%s = %lu]",
                 "PVSD ERROR:", "ConfigManager::sendDeviceDefined()",
                 "No Free Packets",
@@ -661,16 +644,14 @@ ConfigManager::sendDeviceDefined( DeviceRecordPtr a_dev_desc )
                 "Descriptor Lost",
                 "Filled Queue Size",
                 (unsigned long) m_stream_api->getFilledQueueSize() );
-            usleep(33333); // give syslog a chance...
         }
         else
         {
-            syslog( LOG_ERR,
+            ASYNC_SYSLOG( LOG_ERR,
                 "%s %s: %s, Ignore Define Device [%s] (Device ID=%d)",
                 "PVSD ERROR:", "ConfigManager::sendDeviceDefined()",
                 "Queue Deactivated",
                 a_dev_desc->m_name.c_str(), a_dev_desc->m_id );
-            usleep(33333); // give syslog a chance...
         }
     }
 }
@@ -692,7 +673,7 @@ ConfigManager::sendDeviceUndefined( DeviceRecordPtr a_dev_desc )
     {
         if ( m_stream_api->getFreeQueueActive() )
         {
-            syslog( LOG_ERR,
+            ASYNC_SYSLOG( LOG_ERR,
                 "%s %s: %s! Device [%s] (Device ID=%d) %s! [%s = %lu]",
                 "PVSD ERROR:", "ConfigManager::sendDeviceUndefined()",
                 "No Free Packets",
@@ -700,16 +681,14 @@ ConfigManager::sendDeviceUndefined( DeviceRecordPtr a_dev_desc )
                 "Undefined Lost",
                 "Filled Queue Size",
                 (unsigned long) m_stream_api->getFilledQueueSize() );
-            usleep(33333); // give syslog a chance...
         }
         else
         {
-            syslog( LOG_ERR,
+            ASYNC_SYSLOG( LOG_ERR,
                 "%s %s: %s, Ignore Undefine Device [%s] (Device ID=%d)",
                 "PVSD ERROR:", "ConfigManager::sendDeviceUndefined()",
                 "Queue Deactivated",
                 a_dev_desc->m_name.c_str(), a_dev_desc->m_id );
-            usleep(33333); // give syslog a chance...
         }
     }
 }
@@ -733,7 +712,7 @@ ConfigManager::sendDeviceRedefined( DeviceRecordPtr a_dev_desc,
     {
         if ( m_stream_api->getFreeQueueActive() )
         {
-            syslog( LOG_ERR,
+            ASYNC_SYSLOG( LOG_ERR,
                 "%s %s: %s! %s [%s] (%s [%s]) (%s=%d) %s! [%s = %lu]",
                 "PVSD ERROR:", "ConfigManager::sendDeviceRedefined()",
                 "No Free Packets", "Device", a_dev_desc->m_name.c_str(),
@@ -741,16 +720,14 @@ ConfigManager::sendDeviceRedefined( DeviceRecordPtr a_dev_desc,
                 "Device ID", a_dev_desc->m_id, "Descriptor Update Lost",
                 "Filled Queue Size",
                 (unsigned long) m_stream_api->getFilledQueueSize() );
-            usleep(33333); // give syslog a chance...
         }
         else
         {
-            syslog( LOG_ERR,
+            ASYNC_SYSLOG( LOG_ERR,
                 "%s %s: %s, Ignore Redefine Device [%s] (Device ID=%d)",
                 "PVSD ERROR:", "ConfigManager::sendDeviceRedefined()",
                 "Queue Deactivated",
                 a_dev_desc->m_name.c_str(), a_dev_desc->m_id );
-            usleep(33333); // give syslog a chance...
         }
     }
 }
@@ -778,7 +755,7 @@ ConfigManager::sendPvUndefined( DeviceRecordPtr a_dev_desc, PVDescriptor *a_pv_d
     {
         if ( m_stream_api->getFreeQueueActive() )
         {
-            syslog( LOG_ERR,
+            ASYNC_SYSLOG( LOG_ERR,
         "%s %s: %s! %s [%s] (%s=%d) PV <%s> (%s) (PV ID=%d) %s! [%s = %lu]",
                 "PVSD ERROR:", "ConfigManager::sendPvUndefined()",
                 "No Free Packets", "Device", a_dev_desc->m_name.c_str(),
@@ -788,11 +765,10 @@ ConfigManager::sendPvUndefined( DeviceRecordPtr a_dev_desc, PVDescriptor *a_pv_d
                 a_pv_desc->m_id, "Undefined Lost",
                 "Filled Queue Size",
                 (unsigned long) m_stream_api->getFilledQueueSize() );
-            usleep(33333); // give syslog a chance...
         }
         else
         {
-            syslog( LOG_ERR,
+            ASYNC_SYSLOG( LOG_ERR,
             "%s %s: %s Device [%s] (Device ID=%d) PV <%s> (%s) (PV ID=%d)",
                 "PVSD ERROR:", "ConfigManager::sendPvUndefined()",
                 "Queue Deactivated, Ignore PV Undefine",
@@ -800,7 +776,6 @@ ConfigManager::sendPvUndefined( DeviceRecordPtr a_dev_desc, PVDescriptor *a_pv_d
                 a_pv_desc->m_name.c_str(),
                 a_pv_desc->m_connection.c_str(),
                 a_pv_desc->m_id );
-            usleep(33333); // give syslog a chance...
         }
     }
 }
@@ -112,7 +112,7 @@ PVDescriptor::PVDescriptor( DeviceDescriptor *a_device,
     m_enum(0), m_units(a_source.m_units),
     m_is_active_pv(a_source.m_is_active_pv),
     m_is_active(a_source.m_is_active),
-    m_ignore(a_source.m_ignore)
+    m_ignore(a_source.m_ignore), m_filter(a_source.m_filter)
 {
     // Capture Enum Descriptor for Enum Typed PVs...
     if ( m_type == PV_ENUM && a_source.m_enum )
@@ -131,7 +131,8 @@ PVDescriptor::operator==( const PVDescriptor &a_desc ) const
             && m_elem_count == a_desc.m_elem_count
             && m_units == a_desc.m_units
             && m_is_active_pv == a_desc.m_is_active_pv
-            && m_ignore == a_desc.m_ignore )
+            && m_ignore == a_desc.m_ignore
+            && m_filter == a_desc.m_filter )
     {
         res = true;
 
@@ -303,7 +304,8 @@ void
 DeviceDescriptor::definePV(
         const string &a_name, const string &a_connection,
         PVType a_type, uint32_t a_elem_count,
-        EnumDescriptor *a_enum, const string &a_units )
+        EnumDescriptor *a_enum, const string &a_units,
+        const PVFilter &a_filter )
 {
     if ( getPvByName( a_name )) {
         std::stringstream ss;
@@ -316,8 +318,11 @@ DeviceDescriptor::definePV(
         throw runtime_error( ss.str() );
     }
 
-    m_pvs.push_back( new PVDescriptor( this, a_name, a_connection,
-        a_type, a_elem_count, a_enum, a_units ) );
+    PVDescriptor *pv = new PVDescriptor( this, a_name, a_connection,
+        a_type, a_elem_count, a_enum, a_units );
+    pv->m_filter = a_filter;
+
+    m_pvs.push_back( pv );
 }
 
 
@@ -514,6 +519,12 @@ PVDescriptor::print( ostream &a_out ) const
         << "is_active_pv=" << m_is_active_pv << ","
         << "is_active=" << m_is_active << ","
         << "ignore=" << m_ignore;
+    if ( m_filter.active() )
+    {
+        a_out << "," << "deadband=" << m_filter.m_deadband
+            << "," << "deadband_rel=" << m_filter.m_deadband_rel
+            << "," << "max_rate=" << m_filter.m_max_rate;
+    }
     if ( m_enum )
     {
         a_out << "," << "enum:";
@@ -49,6 +49,27 @@ enum DeviceIsActiveEnum
 };
 
 
+/// Per-PV update filtering, from the beamline configuration
+struct PVFilter
+{
+    PVFilter() : m_deadband(0.0), m_deadband_rel(0.0), m_max_rate(0.0) {}
+
+    bool    active() const
+        { return m_deadband > 0.0 || m_deadband_rel > 0.0
+            || m_max_rate > 0.0; }
+    bool    operator==( const PVFilter &a_filter ) const
+        { return m_deadband == a_filter.m_deadband
+            && m_deadband_rel == a_filter.m_deadband_rel
+            && m_max_rate == a_filter.m_max_rate; }
+    bool    operator!=( const PVFilter &a_filter ) const
+        { return !( *this == a_filter ); }
+
+    double  m_deadband;         ///< Smallest change sent (0 = any change)
+    double  m_deadband_rel;     ///< Same, as a fraction of last value sent
+    double  m_max_rate;         ///< Most updates per second (0 = no limit)
+};
+
+
 class PVDescriptor
 {
 public:
@@ -83,6 +104,7 @@ public:
     bool                m_is_active_pv;
     DeviceIsActiveEnum  m_is_active;
     bool                m_ignore;
+    PVFilter            m_filter;
 
     friend class DeviceDescriptor;
 };
@@ -103,7 +125,8 @@ public:
     void                definePV( const string &a_name,
                             const string &a_connection,
                             PVType a_type, uint32_t a_elem_count,
-                            EnumDescriptor *a_enum, const string &a_units );
+                            EnumDescriptor *a_enum, const string &a_units,
+                            const PVFilter &a_filter = PVFilter() );
     PVDescriptor       *getPvByName( const string &a_pv_name ) const;
     PVDescriptor       *getPvByConnection(
                             const string &a_pv_connection ) const;
@@ -219,6 +219,25 @@ StreamService::getFilledPacket( unsigned long a_timeout, bool & a_timeout_flag )
 }
 
 
+/**
+ * \brief Gets a batch of filled stream packets (blocks until at least one is available)
+ * \param a_pkts - (output) Array to receive up to a_max packets, in stream order
+ * \param a_max - Maximum number of packets to return
+ * \param a_timeout - Timeout period in msec
+ * \param a_timeout_flag - (output) Indicates if a timeout occurred
+ * \return Number of packets returned; 0 on timeout or failure
+ *
+ * Everything already queued (up to a_max) is returned with a single wakeup,
+ * so the output adapter can process and send bursts of updates together.
+ * Packets must be handed back with putFreePacket() or putFreePackets().
+ */
+size_t
+StreamService::getFilledPackets( StreamPacket **a_pkts, size_t a_max, unsigned long a_timeout, bool & a_timeout_flag )
+{
+    return m_fill_que.getBatch( a_pkts, a_max, a_timeout, a_timeout_flag );
+}
+
+
 /**
  * \brief Gets the active status of the filled stream packet queue
  * \return active status of the filled stream packet queue
@@ -270,6 +289,25 @@ StreamService::putFreePacket( StreamPacket *a_pkt )
 }
 
 
+/** \brief Returns a batch of processed packets to the packet pool
+  * \param a_pkts - StreamPacket objects to return
+  * \param a_count - Number of packets in a_pkts
+  */
+void
+StreamService::putFreePackets( StreamPacket **a_pkts, size_t a_count )
+{
+    for ( size_t i = 0; i < a_count; ++i )
+    {
+        a_pkts[i]->device.reset();
+        a_pkts[i]->old_device.reset();
+        a_pkts[i]->pv = 0;
+    }
+
+    // One lock for the whole batch
+    m_free_que.putBatch( a_pkts, a_count );
+}
+
+
 // ---------- Private StreamService methods -----------------------------------
 
 
@@ -216,10 +216,12 @@ public:
     virtual ConfigManager&  getCfgMgr() = 0;
     virtual StreamPacket   *getFilledPacket() = 0;
     virtual StreamPacket   *getFilledPacket( unsigned long a_timeout, bool & a_timeout_flag ) = 0;
+    virtual size_t          getFilledPackets( StreamPacket **a_pkts, size_t a_max, unsigned long a_timeout, bool & a_timeout_flag ) = 0;
     virtual bool            getFilledQueueActive(void) = 0;
     virtual size_t          getFilledQueueSize(void) = 0;
     virtual bool            getFreeQueueActive(void) = 0;
     virtual void            putFreePacket( StreamPacket *a_pkt ) = 0;
+    virtual void            putFreePackets( StreamPacket **a_pkts, size_t a_count ) = 0;
     virtual size_t          getFreeQueueSize(void) = 0;
 };
 
@@ -231,10 +233,11 @@ public:
  * protocol adapters. Input Adapters inject packets into the internal stream; whereas Output
  * Adapters consume packets from the internal stream. Only one Output Adapter may be connected
  * to a StreamService instance at a time. A packet buffer is used to avoid memory allocation,
- * and SyncDeque instances are used to manage free- and filled-packet buffers. Ownership of connected
- * adapters is transferred to the StreamService instance and are destroyed when the StreamService
- * instance is destroyed. When destroyed, the StreamService instance shutsdown the SyncDeque objects
- * which is the signal for adapters to clean-up in preparation for deletion.
+ * and SyncDeque instances are used to manage free- and filled-packet buffers; the output adapter can
+ * take and return packets in batches (one lock per batch) to amortize wakeups and socket writes.
+ * Ownership of connected adapters is transferred to the StreamService instance and are destroyed
+ * when the StreamService instance is destroyed. When destroyed, the StreamService instance shutsdown
+ * the SyncDeque objects which is the signal for adapters to clean-up in preparation for deletion.
  */
 class StreamService : private IInputAdapterAPI, private IOutputAdapterAPI
 {
@@ -261,9 +264,11 @@ private:
 
     StreamPacket   *getFilledPacket();
     StreamPacket   *getFilledPacket( unsigned long a_timeout, bool & a_timeout_flag );
+    size_t          getFilledPackets( StreamPacket **a_pkts, size_t a_max, unsigned long a_timeout, bool & a_timeout_flag );
     bool            getFilledQueueActive(void);
     size_t          getFilledQueueSize(void);
     void            putFreePacket( StreamPacket *a_pkt );
+    void            putFreePackets( StreamPacket **a_pkts, size_t a_count );
 
     ConfigManager               m_cfg_mgr;
     IOutputAdapter             *m_out_adapter;  ///< Active stream output adapter
@@ -75,13 +75,62 @@ public:
         return false;
     }
 
+    /// As getTimed(), but takes everything queued (up to a_max) under one
+    /// lock; returns the number of items taken (0 on timeout or shutdown)
+    size_t getBatch( T *a_items, size_t a_max, unsigned long a_timeout, bool & a_timeout_flag )
+    {
+        boost::system_time const t = boost::get_system_time() + boost::posix_time::milliseconds(a_timeout);
+        a_timeout_flag = false;
+
+        boost::unique_lock<boost::mutex> lock(m_mutex);
+        while( m_active )
+        {
+            if ( m_que.size() )
+            {
+                size_t count = 0;
+                while ( count < a_max && m_que.size() )
+                {
+                    a_items[count++] = m_que.front();
+                    m_que.pop_front();
+                }
+                return count;
+            }
+            else
+            {
+                if ( !m_cvar.timed_wait( lock, t ))
+                {
+                    // Did we really timeout?
+                    if ( m_active && boost::get_system_time() >= t )
+                    {
+                        a_timeout_flag = true;
+                        return 0;
+                    }
+                }
+            }
+        }
+
+        return 0;
+    }
+
     void put(T val)
     {
         boost::lock_guard<boost::mutex> lock(m_mutex);
 
+        // Notify on every put; only waking on empty-to-one loses wakeups
+        // when several threads are blocked in get()
         m_que.push_back(val);
-        if ( m_que.size() == 1 )
+        m_cvar.notify_one();
+    }
+
+    void putBatch( T *a_items, size_t a_count )
+    {
+        boost::lock_guard<boost::mutex> lock(m_mutex);
+
+        for ( size_t i = 0; i < a_count; ++i )
+        {
+            m_que.push_back(a_items[i]);
             m_cvar.notify_one();
+        }
     }
 
     void deactivate()
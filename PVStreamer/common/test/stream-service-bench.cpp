@@ -0,0 +1,160 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <vector>
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+
+#include "StreamService.h"
+
+/* Throughput of PV updates through the StreamService packet pool, with
+ * N input adapter (producer) threads and one output adapter (consumer),
+ * as in pvsd:
+ *
+ *   single - consumer takes and returns one packet per lock/wakeup
+ *            (as pvsd did before batching)
+ *   batch  - consumer takes and returns up to 64 per lock/wakeup (as pvsd)
+ *
+ * Usage: stream-service-bench [producers [updates-per-producer [pool]]]
+ */
+
+using namespace PVS;
+
+enum { BATCH = 64 };
+
+static double elapsed(const struct timespec &a, const struct timespec &b)
+{
+    return (b.tv_sec - a.tv_sec) + (b.tv_nsec - a.tv_nsec) / 1e9;
+}
+
+static void report(const char *what, uint32_t producers, double secs,
+        uint64_t updates, uint64_t wakeups)
+{
+    printf("  %-6s %2u producers %12.0f updates/s  %6.1f updates/wakeup\n",
+        what, producers, updates / secs,
+        wakeups ? (double)updates / wakeups : 0.0);
+}
+
+static void fill(StreamPacket *a_pkt, uint32_t a_val)
+{
+    a_pkt->type = VariableUpdate;
+    a_pkt->state.m_uint_val = a_val;
+    a_pkt->state.m_elem_count = 1;
+}
+
+
+//----- StreamService --------------------------------------------------------
+
+class BenchInput : public IInputAdapter
+{
+public:
+    BenchInput(StreamService &a_serv) : IInputAdapter(a_serv) {}
+
+    void run(uint32_t a_count)
+    {
+        StreamPacket *pkt = 0;
+
+        for (uint32_t i = 0; i < a_count; i++) {
+            if (!(pkt = m_stream_api->getFreePacket()))
+                return;
+            fill(pkt, i);
+            m_stream_api->putFilledPacket(pkt);
+        }
+    }
+};
+
+class BenchOutput : public IOutputAdapter
+{
+public:
+    BenchOutput(StreamService &a_serv) : IOutputAdapter(a_serv),
+        m_wakeups(0) {}
+
+    void runSingle(uint64_t a_total)
+    {
+        StreamPacket *pkt = 0;
+        bool timeout;
+
+        for (uint64_t n = 0; n < a_total; n++) {
+            if (!(pkt = m_stream_api->getFilledPacket(1000, timeout)))
+                return;
+            m_wakeups++;
+            m_stream_api->putFreePacket(pkt);
+        }
+    }
+
+    void runBatch(uint64_t a_total)
+    {
+        StreamPacket *pkts[BATCH];
+        bool timeout;
+        size_t count;
+
+        for (uint64_t n = 0; n < a_total; n += count) {
+            count = m_stream_api->getFilledPackets(pkts, BATCH, 1000,
+                timeout);
+            if (!count)
+                return;
+            m_wakeups++;
+            m_stream_api->putFreePackets(pkts, count);
+        }
+    }
+
+    uint64_t m_wakeups;
+};
+
+static void runService(bool a_batch, uint32_t a_producers, uint32_t a_count,
+        uint32_t a_pool)
+{
+    // The service owns (and deletes) attached adapters
+    StreamService serv(a_pool);
+    BenchOutput *out = new BenchOutput(serv);
+    std::vector<BenchInput*> in;
+    uint64_t total = (uint64_t)a_producers * a_count;
+    struct timespec t0, t1;
+
+    for (uint32_t p = 0; p < a_producers; p++)
+        in.push_back(new BenchInput(serv));
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    boost::thread consumer(boost::bind(a_batch ? &BenchOutput::runBatch
+        : &BenchOutput::runSingle, out, total));
+    boost::thread_group producers;
+    for (uint32_t p = 0; p < a_producers; p++)
+        producers.create_thread(boost::bind(&BenchInput::run, in[p],
+            a_count));
+    producers.join_all();
+    consumer.join();
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    report(a_batch ? "batch" : "single", a_producers, elapsed(t0, t1),
+        total, out->m_wakeups);
+}
+
+
+int main(int argc, char **argv)
+{
+    uint32_t producers = (argc > 1) ? strtoul(argv[1], NULL, 0) : 4;
+    uint32_t count = (argc > 2) ? strtoul(argv[2], NULL, 0) : 1000000;
+    uint32_t pool = (argc > 3) ? strtoul(argv[3], NULL, 0) : 1000;
+
+    if (!producers || pool < 2) {
+        fprintf(stderr, "usage: %s [producers [updates [pool]]]\n",
+            argv[0]);
+        return 1;
+    }
+
+    printf("%u updates/producer, pool of %u packets:\n", count, pool);
+
+    // 1, 2, 4, ... producers, ending with the requested number
+    for (uint32_t p = 1; ; p = (p * 2 < producers) ? p * 2 : producers) {
+        runService(false, p, count, pool);
+        runService(true, p, count, pool);
+        if (p == producers)
+            break;
+    }
+
+    return 0;
+}
+
+// vim: expandtab
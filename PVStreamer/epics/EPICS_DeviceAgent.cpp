@@ -2,7 +2,9 @@
 #include <string>
 #include <sstream>
 #include <syslog.h>
+#include "AsyncLog.h"
 #include <unistd.h>
+#include <math.h>
 #include <alarm.h>
 
 #include "CoreDefs.h"
@@ -19,6 +21,20 @@ using namespace std;
 namespace PVS {
 namespace EPICS {
 
+/// Monitor thread period while any PV is rate limited (usec)
+static const uint32_t HELD_UPDATE_TICK = 10000;
+
+/// How often per-PV filter counts are logged (secs)
+static const time_t FILTER_REPORT_PERIOD = 300;
+
+static double
+monotonicTime()
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
 //-------------------------------------------------------------------------------------------------
 // PUBLIC DeviceAgent Methods
 //-------------------------------------------------------------------------------------------------
@@ -37,7 +53,7 @@ DeviceAgent::DeviceAgent( IInputAdapterAPI &a_stream_api,
         struct ca_client_context *a_epics_context,
         time_t a_device_init_timeout )
     : m_stream_api(a_stream_api), m_dev_desc(0),
-      m_defined(false), m_hung(false),
+      m_defined(false), m_hung(false), m_next_chan_lock(0),
       m_state_changed(false), m_agent_active(true),
       m_epics_context(a_epics_context),
       m_device_init_timeout(a_device_init_timeout)
@@ -98,7 +114,7 @@ DeviceAgent::update( DeviceDescriptor *a_device )
 
     PVDescriptor*                   old_pv;
     vector<PVDescriptor*>::iterator ipv;
-    map<chid,ChanInfo>::iterator    ich;
+    map<chid,ChanInfo*>::iterator   ich;
     map<string,chid>::iterator      idx;
 
     std::string deviceStr = "";
@@ -120,9 +136,8 @@ DeviceAgent::update( DeviceDescriptor *a_device )
     {
         // Disconnect any existing connections that are no longer needed
 
-        syslog( LOG_INFO, "%s: %sDisconnecting Old PV Channels...",
+        ASYNC_SYSLOG( LOG_INFO, "%s: %sDisconnecting Old PV Channels...",
             "DeviceAgent::update()", deviceStr.c_str() );
-        usleep(33333); // give syslog a chance...
 
         // If Active Status PV Connection Changed,
         // Delete Old PV Subscription.
@@ -145,9 +160,8 @@ DeviceAgent::update( DeviceDescriptor *a_device )
         // If a device is already defined, reuse any shared PV connections
         // Make connections for new PVs in updated device
 
-        syslog( LOG_INFO, "%s: %sReuse/Create New PV Channels...",
+        ASYNC_SYSLOG( LOG_INFO, "%s: %sReuse/Create New PV Channels...",
             "DeviceAgent::update()", deviceStr.c_str() );
-        usleep(33333); // give syslog a chance...
 
         // Handle Any Active Status PV Channel...
         if ( a_device->m_active_pv )
@@ -178,10 +192,9 @@ DeviceAgent::update( DeviceDescriptor *a_device )
                         + old_desc->m_active_pv_conn + ")";
                 }
 
-                syslog( LOG_INFO, "%s: %sReusing Channel%s",
+                ASYNC_SYSLOG( LOG_INFO, "%s: %sReusing Channel%s",
                     "DeviceAgent::update()", deviceStr.c_str(),
                     pvStr.c_str() );
-                usleep(33333); // give syslog a chance...
 
                 // Inherit the Active Status from Old Active Status PV
                 a_device->m_active_pv->m_is_active =
@@ -195,36 +208,37 @@ DeviceAgent::update( DeviceDescriptor *a_device )
                     ich = m_chan_info.find( idx->second );
                     if ( ich != m_chan_info.end() )
                     {
+                        boost::lock_guard<boost::mutex> chan_lock(
+                            *ich->second->m_lock );
+
                         // Update PV to new Active Status PV
-                        ich->second.m_pv = a_device->m_active_pv;
+                        ich->second->m_pv = a_device->m_active_pv;
                         // Old device record is no longer valid - reset
-                        ich->second.m_device.reset();
+                        ich->second->m_device.reset();
 
                         // Re-acquire metadata just in case it changed
                         // (only if connected)
-                        if ( ich->second.m_chan_state != UNINITIALIZED )
-                            ich->second.m_chan_state = INFO_NEEDED;
+                        if ( ich->second->m_chan_state != UNINITIALIZED )
+                            ich->second->m_chan_state = INFO_NEEDED;
                     }
                     else
                     {
-                        syslog( LOG_ERR,
+                        ASYNC_SYSLOG( LOG_ERR,
                             "%s %s: %s%s%s - %s!",
                             "PVSD ERROR:", "DeviceAgent::update()",
                             deviceStr.c_str(), "Channel Info Not Found",
                             pvStr.c_str(),
                             "Internal Bookkeeping Linkage Not Updated" );
-                        usleep(33333); // give syslog a chance...
                     }
                 }
                 else
                 {
-                    syslog( LOG_ERR,
+                    ASYNC_SYSLOG( LOG_ERR,
                         "%s %s: %s%s%s - %s!",
                         "PVSD ERROR:", "DeviceAgent::update()",
                         deviceStr.c_str(), "PV Index/Channel ID Not Found",
                         pvStr.c_str(),
                         "Internal Bookkeeping Linkage Not Updated" );
-                    usleep(33333); // give syslog a chance...
                 }
             }
         }
@@ -250,11 +264,10 @@ DeviceAgent::update( DeviceDescriptor *a_device )
                         + (*ipv)->m_device->m_name + "] - ";
                 }
 
-                syslog( LOG_INFO,
+                ASYNC_SYSLOG( LOG_INFO,
                     "%s: %sReusing Channel from Old PV <%s> (%s)",
                     "DeviceAgent::update()", deviceStr.c_str(),
                     (*ipv)->m_name.c_str(), (*ipv)->m_connection.c_str() );
-                usleep(33333); // give syslog a chance...
 
                 // Update PV pointer on channel info
                 idx = m_pv_index.find( old_pv->m_connection );
@@ -263,36 +276,37 @@ DeviceAgent::update( DeviceDescriptor *a_device )
                     ich = m_chan_info.find( idx->second );
                     if ( ich != m_chan_info.end() )
                     {
+                        boost::lock_guard<boost::mutex> chan_lock(
+                            *ich->second->m_lock );
+
                         // Update PV to new (temporary) PV
-                        ich->second.m_pv = *ipv;
+                        ich->second->m_pv = *ipv;
                         // Old device record is no longer valid - reset
-                        ich->second.m_device.reset();
+                        ich->second->m_device.reset();
 
                         // Re-aqcuire metadata just in case it changed
                         // (only if connected)
-                        if ( ich->second.m_chan_state != UNINITIALIZED )
-                            ich->second.m_chan_state = INFO_NEEDED;
+                        if ( ich->second->m_chan_state != UNINITIALIZED )
+                            ich->second->m_chan_state = INFO_NEEDED;
                     }
                     else
                     {
-                        syslog( LOG_ERR,
+                        ASYNC_SYSLOG( LOG_ERR,
                             "%s %s: %s%s for PV <%s> - %s!",
                             "PVSD ERROR:", "DeviceAgent::update()",
                             deviceStr.c_str(), "Channel Info Not Found",
                             old_pv->m_connection.c_str(),
                             "Internal Bookkeeping Linkage Not Updated" );
-                        usleep(33333); // give syslog a chance...
                     }
                 }
                 else
                 {
-                    syslog( LOG_ERR,
+                    ASYNC_SYSLOG( LOG_ERR,
                         "%s %s: %s%s for PV <%s> - %s!",
                         "PVSD ERROR:", "DeviceAgent::update()",
                         deviceStr.c_str(), "PV Index/Channel ID Not Found",
                         old_pv->m_connection.c_str(),
                         "Internal Bookkeeping Linkage Not Updated" );
-                    usleep(33333); // give syslog a chance...
                 }
             }
         }
@@ -305,9 +319,8 @@ DeviceAgent::update( DeviceDescriptor *a_device )
     }
     else
     {
-        syslog( LOG_INFO, "%s: %sCreate New PV Channels...",
+        ASYNC_SYSLOG( LOG_INFO, "%s: %sCreate New PV Channels...",
             "DeviceAgent::update()", deviceStr.c_str() );
-        usleep(33333); // give syslog a chance...
 
         if ( a_device->m_active_pv )
             connectPV( a_device->m_active_pv );
@@ -354,17 +367,19 @@ DeviceAgent::metadataUpdated()
     m_dev_desc = new_dev;
 
     // Update channel info and channel state
-    for ( map<chid,ChanInfo>::iterator ich = m_chan_info.begin();
+    for ( map<chid,ChanInfo*>::iterator ich = m_chan_info.begin();
             ich != m_chan_info.end(); ++ich )
     {
-        ich->second.m_device.reset();
+        boost::unique_lock<boost::mutex> chan_lock( *ich->second->m_lock );
+
+        ich->second->m_device.reset();
 
         // Find PV in New Device Instance...
 
         PVDescriptor *pv = NULL;
 
         // Check for Active Status PV...
-        if ( !ich->second.m_pv->m_connection.compare(
+        if ( !ich->second->m_pv->m_connection.compare(
                 m_dev_desc->m_active_pv_conn ) )
         {
             pv = m_dev_desc->m_active_pv;
@@ -372,59 +387,57 @@ DeviceAgent::metadataUpdated()
         else
         {
             pv = m_dev_desc->getPvByConnection(
-                ich->second.m_pv->m_connection );
+                ich->second->m_pv->m_connection );
         }
 
         // Failsafe...! ;-o
         if ( pv )
         {
-            ich->second.m_pv = pv;
+            ich->second->m_pv = pv;
+            chan_lock.unlock();
         }
         else
         {
-            syslog( LOG_ERR,
+            ASYNC_SYSLOG( LOG_ERR,
                 "%s %s: Device [%s] - %s for PV <%s> (%s), %s",
                 "PVSD ERROR:", "DeviceAgent::metadataUpdated()",
                 m_dev_desc->m_name.c_str(),
                 "Error Updating Metadata",
-                ich->second.m_pv->m_name.c_str(),
-                ich->second.m_pv->m_connection.c_str(),
+                ich->second->m_pv->m_name.c_str(),
+                ich->second->m_pv->m_connection.c_str(),
                 "PV Not Found in Device - Skipping!" );
-            usleep(33333); // give syslog a chance...
 
             continue;
         }
 
-        if ( ich->second.m_chan_state == INFO_AVAILABLE )
+        if ( ich->second->m_chan_state == INFO_AVAILABLE )
         {
-            syslog( LOG_INFO,
+            ASYNC_SYSLOG( LOG_INFO,
                 "%s: Device [%s] - Updating metadata for PV <%s> (%s)",
                 "DeviceAgent::metadataUpdated()",
                 m_dev_desc->m_name.c_str(),
-                ich->second.m_pv->m_name.c_str(),
-                ich->second.m_pv->m_connection.c_str() );
-            usleep(33333); // give syslog a chance...
-
-            ich->second.m_pv->setMetadata(
-                epicsToPVType( ich->second.m_ca_type,
-                    ich->second.m_ca_elem_count ),
-                ich->second.m_ca_elem_count,
-                ich->second.m_ca_units, ich->second.m_ca_enum_vals );
-            ich->second.m_chan_state = READY;
+                ich->second->m_pv->m_name.c_str(),
+                ich->second->m_pv->m_connection.c_str() );
+
+            ich->second->m_pv->setMetadata(
+                epicsToPVType( ich->second->m_ca_type,
+                    ich->second->m_ca_elem_count ),
+                ich->second->m_ca_elem_count,
+                ich->second->m_ca_units, ich->second->m_ca_enum_vals );
+            ich->second->m_chan_state = READY;
         }
-        else if ( ich->second.m_chan_state == READY )
+        else if ( ich->second->m_chan_state == READY )
         {
-            syslog( LOG_INFO,
+            ASYNC_SYSLOG( LOG_INFO,
             "%s: Device [%s] - Re-requesting metadata for PV <%s> (%s)",
                 "DeviceAgent::metadataUpdated()",
                 m_dev_desc->m_name.c_str(),
-                ich->second.m_pv->m_name.c_str(),
-                ich->second.m_pv->m_connection.c_str() );
-            usleep(33333); // give syslog a chance...
+                ich->second->m_pv->m_name.c_str(),
+                ich->second->m_pv->m_connection.c_str() );
 
             // Re-request metadata from all other PV
             // (they may have changed too)
-            ich->second.m_chan_state = INFO_NEEDED;
+            ich->second->m_chan_state = INFO_NEEDED;
         }
     }
 }
@@ -455,51 +468,49 @@ DeviceAgent::stop(void)
     }
 
     // Clear CA channels and unsubscribe
-    for ( map<chid,ChanInfo>::iterator ich = m_chan_info.begin();
+    for ( map<chid,ChanInfo*>::iterator ich = m_chan_info.begin();
             ich != m_chan_info.end(); ++ich )
     {
-        syslog( LOG_INFO,
+        ASYNC_SYSLOG( LOG_INFO,
             "%s: %sStopping PV <%s> (%s)",
             "DeviceAgent::stop()", deviceStr.c_str(),
-            ich->second.m_pv->m_name.c_str(),
-            ich->second.m_pv->m_connection.c_str() );
-        usleep(33333); // give syslog a chance...
+            ich->second->m_pv->m_name.c_str(),
+            ich->second->m_pv->m_connection.c_str() );
 
-        if ( ich->second.m_subscribed )
+        if ( ich->second->m_subscribed )
         {
-            syslog( LOG_INFO,
+            ASYNC_SYSLOG( LOG_INFO,
                 "%s: %sUnsubscribing Channel for PV <%s> (%s)",
                 "DeviceAgent::stop()", deviceStr.c_str(),
-                ich->second.m_pv->m_name.c_str(),
-                ich->second.m_pv->m_connection.c_str() );
-            usleep(33333); // give syslog a chance...
+                ich->second->m_pv->m_name.c_str(),
+                ich->second->m_pv->m_connection.c_str() );
 
             // *** Prevent Deadlock with New EPICS Callback Guard...!!
             lock.unlock();
-            ca_clear_subscription( ich->second.m_evid );
+            ca_clear_subscription( ich->second->m_evid );
             lock.lock();
         }
 
-        syslog( LOG_INFO,
+        ASYNC_SYSLOG( LOG_INFO,
             "%s: %sClearing Channel for PV <%s> (%s)",
             "DeviceAgent::stop()", deviceStr.c_str(),
-            ich->second.m_pv->m_name.c_str(),
-            ich->second.m_pv->m_connection.c_str() );
-        usleep(33333); // give syslog a chance...
+            ich->second->m_pv->m_name.c_str(),
+            ich->second->m_pv->m_connection.c_str() );
 
         // *** Prevent Deadlock with New EPICS Callback Guard...!!
         lock.unlock();
-        ca_clear_channel( ich->second.m_chid );
+        ca_clear_channel( ich->second->m_chid );
         lock.lock();
 
-        syslog( LOG_INFO,
+        ASYNC_SYSLOG( LOG_INFO,
             "%s: %sDone with PV <%s> (%s)",
             "DeviceAgent::stop()", deviceStr.c_str(),
-            ich->second.m_pv->m_name.c_str(),
-            ich->second.m_pv->m_connection.c_str() );
-        usleep(33333); // give syslog a chance...
+            ich->second->m_pv->m_name.c_str(),
+            ich->second->m_pv->m_connection.c_str() );
 
         ca_flush_io();
+
+        delete ich->second;
     }
 
     m_chan_info.clear();
@@ -529,11 +540,10 @@ DeviceAgent::undefine(void)
     // so we make sure Old Inactive Device IDs get cleared.
     if ( m_dev_record.get() )
     {
-        syslog( LOG_INFO,
+        ASYNC_SYSLOG( LOG_INFO,
             "%s: Undefining %sInactive Device ID %d",
             "DeviceAgent::undefine()", deviceStr.c_str(),
             dev ? dev->m_id : -1 );
-        usleep(33333); // give syslog a chance...
 
         m_stream_api.getCfgMgr().undefineDevice( m_dev_record );
         // *Don't* Reset the Descriptor Here, Device May Still Exist
@@ -543,11 +553,10 @@ DeviceAgent::undefine(void)
     // Device Record Not Found, Maybe Already Stopped...?
     else
     {
-        syslog( LOG_INFO,
+        ASYNC_SYSLOG( LOG_INFO,
             "%s: %sInactive Device ID %d Not Found - Already Stopped?",
             "DeviceAgent::undefine()", deviceStr.c_str(),
             ( m_dev_desc != NULL ) ? m_dev_desc->m_id : -1 );
-        usleep(33333); // give syslog a chance...
     }
 }
 
@@ -614,33 +623,37 @@ DeviceAgent::connectPV( PVDescriptor *a_pv )
     if ( a_pv->m_device != NULL && !a_pv->m_device->m_name.empty() )
         deviceStr = "Device [" + a_pv->m_device->m_name + "] - ";
 
-    syslog( LOG_INFO, "%s: %sCreating channel for PV <%s> (%s)",
+    ASYNC_SYSLOG( LOG_INFO, "%s: %sCreating channel for PV <%s> (%s)",
         "DeviceAgent::connectPV()", deviceStr.c_str(),
         a_pv->m_name.c_str(), a_pv->m_connection.c_str() );
-    usleep(33333); // give syslog a chance...
 
-    ChanInfo info;
-    info.m_pv = a_pv;
+    // The channel info is the channel's CA user pointer, so callbacks
+    // go straight to it (no channel ID lookup)
+    ChanInfo *info = new ChanInfo;
+    info->m_agent = this;
+    info->m_lock = &m_chan_locks[ m_next_chan_lock++ % CHAN_LOCK_SHARDS ];
+    info->m_pv = a_pv;
 
     // Create a CA channel
     if ( ca_create_channel( a_pv->m_connection.c_str(),
-                &epicsConnectionCallback, this, 0, &info.m_chid )
+                &epicsConnectionCallback, info, 0, &info->m_chid )
             == ECA_NORMAL )
     {
         // Note: don't flush I/O here - update() method will call it
 
         // Update channel info and PV name index structures
-        m_chan_info[info.m_chid] = info;
-        m_pv_index[a_pv->m_connection] = info.m_chid;
+        m_chan_info[info->m_chid] = info;
+        m_pv_index[a_pv->m_connection] = info->m_chid;
         //cout << "connected chid: " << info.m_chid
             //<< " for PV: " << a_pv->m_connection << endl;
     }
     else
     {
-        syslog( LOG_ERR, "%s %s: %sFailed to create channel for PV <%s>",
+        ASYNC_SYSLOG( LOG_ERR, "%s %s: %sFailed to create channel for PV <%s>",
             "PVSD ERROR:", "DeviceAgent::connectPV()", deviceStr.c_str(),
             a_pv->m_connection.c_str() );
-        usleep(33333); // give syslog a chance...
+
+        delete info;
     }
 }
 
@@ -665,71 +678,68 @@ DeviceAgent::disconnectPV( PVDescriptor *a_pv,
 
     if ( ipv != m_pv_index.end() )
     {
-        syslog( LOG_INFO, "%s: %sDisconnecting channel for PV <%s> (%s)",
+        ASYNC_SYSLOG( LOG_INFO, "%s: %sDisconnecting channel for PV <%s> (%s)",
             "DeviceAgent::disconnectPV()", deviceStr.c_str(),
             a_pv->m_name.c_str(), a_pv->m_connection.c_str() );
-        usleep(33333); // give syslog a chance...
 
-        map<chid,ChanInfo>::iterator ich = m_chan_info.find( ipv->second );
+        map<chid,ChanInfo*>::iterator ich = m_chan_info.find( ipv->second );
 
         if ( ich != m_chan_info.end() )
         {
-            syslog( LOG_INFO,
+            ASYNC_SYSLOG( LOG_INFO,
                 "%s: %sFound Existing Channel for PV <%s> (%s)",
                 "DeviceAgent::disconnectPV()", deviceStr.c_str(),
                 a_pv->m_name.c_str(), a_pv->m_connection.c_str() );
-            usleep(33333); // give syslog a chance...
 
-            if ( ich->second.m_subscribed )
+            if ( ich->second->m_subscribed )
             {
-                syslog( LOG_INFO,
+                ASYNC_SYSLOG( LOG_INFO,
                     "%s: %sClearing Subscription for PV <%s> (%s)",
                     "DeviceAgent::disconnectPV()", deviceStr.c_str(),
                     a_pv->m_name.c_str(), a_pv->m_connection.c_str() );
-                usleep(33333); // give syslog a chance...
 
                 // *** Prevent Deadlock with New EPICS Callback Guard...!!
                 lock.unlock();
-                ca_clear_subscription( ich->second.m_evid );
+                ca_clear_subscription( ich->second->m_evid );
                 lock.lock();
             }
 
-            syslog( LOG_INFO,
+            ASYNC_SYSLOG( LOG_INFO,
                 "%s: %sClearing Channel for PV <%s> (%s)",
                 "DeviceAgent::disconnectPV()", deviceStr.c_str(),
                 a_pv->m_name.c_str(), a_pv->m_connection.c_str() );
-            usleep(33333); // give syslog a chance...
 
             // *** Prevent Deadlock with New EPICS Callback Guard...!!
             lock.unlock();
-            ca_clear_channel( ich->second.m_chid );
+            ca_clear_channel( ich->second->m_chid );
             lock.lock();
 
             // Update channel info index structures
 
-            syslog( LOG_INFO,
+            ASYNC_SYSLOG( LOG_INFO,
                 "%s: %sErasing Channel Info for PV <%s> (%s)",
                 "DeviceAgent::disconnectPV()", deviceStr.c_str(),
                 a_pv->m_name.c_str(), a_pv->m_connection.c_str() );
-            usleep(33333); // give syslog a chance...
 
+            logFilterCounts( *ich->second );
+
+            // No more callbacks once the channel is cleared
+            delete ich->second;
             m_chan_info.erase( ich );
 
-            syslog( LOG_INFO,
+            ASYNC_SYSLOG( LOG_INFO,
                 "%s: %sDone Disconnecting Channel Info for PV <%s> (%s)",
                 "DeviceAgent::disconnectPV()", deviceStr.c_str(),
                 a_pv->m_name.c_str(), a_pv->m_connection.c_str() );
-            usleep(33333); // give syslog a chance...
 
             // Don't flush I/O here - update() method will call it
         }
         else
         {
-            syslog( LOG_WARNING,
+            ASYNC_SYSLOG( LOG_WARNING,
                 "%s: %sWarning: No Channel Info Found for PV <%s> (%s)",
                 "DeviceAgent::disconnectPV()", deviceStr.c_str(),
                 a_pv->m_name.c_str(), a_pv->m_connection.c_str() );
-            usleep(33333); // give syslog a chance...
         }
 
         // Update name index structures
@@ -737,12 +747,11 @@ DeviceAgent::disconnectPV( PVDescriptor *a_pv,
     }
     else
     {
-        syslog( LOG_ERR,
+        ASYNC_SYSLOG( LOG_ERR,
             "%s %s: %s%s <%s> (%s) - Not Found",
             "PVSD ERROR:", "DeviceAgent::disconnectPV()",
             deviceStr.c_str(), "Failed to disconnect channel for PV",
             a_pv->m_name.c_str(), a_pv->m_connection.c_str() );
-        usleep(33333); // give syslog a chance...
     }
 }
 
@@ -763,7 +772,7 @@ DeviceAgent::controlThread()
 {
     ca_attach_context( m_epics_context );
 
-    map<chid,ChanInfo>::iterator ich;
+    map<chid,ChanInfo*>::iterator ich;
     map<std::string,chid>::iterator idx;
     PVDescriptor *pv;
     size_t ready;
@@ -795,22 +804,22 @@ DeviceAgent::controlThread()
             for ( ich = m_chan_info.begin();
                     ich != m_chan_info.end() && !m_state_changed; ++ich )
             {
-                switch ( ich->second.m_chan_state )
+                switch ( ich->second->m_chan_state )
                 {
                 case INFO_NEEDED:
                     // cout <<  "IN, chan: " << ich->first
-                         // << " ca_type = " << ich->second.m_ca_type
+                         // << " ca_type = " << ich->second->m_ca_type
                          // << " ca_element_count = "
-                         // << ich->second.m_ca_elem_count
+                         // << ich->second->m_ca_elem_count
                          // << " for PV: "
-                         // << ich->second.m_pv->m_connection << endl;
+                         // << ich->second->m_pv->m_connection << endl;
 
                     if ( ca_get_callback(
-                            epicsToCtrlRecordType( ich->second.m_ca_type ),
+                            epicsToCtrlRecordType( ich->second->m_ca_type ),
                             ich->first, epicsEventCallback,
                             this ) == ECA_NORMAL )
                     {
-                        ich->second.m_chan_state = INFO_PENDING;
+                        ich->second->m_chan_state = INFO_PENDING;
                     }
                     else
                     {
@@ -822,33 +831,32 @@ DeviceAgent::controlThread()
                                 + m_dev_desc->m_name + "] - ";
                         }
 
-                        syslog( LOG_ERR, "%s %s: %s%s <%s> (%s)",
+                        ASYNC_SYSLOG( LOG_ERR, "%s %s: %s%s <%s> (%s)",
                             "PVSD ERROR:",
                             "DeviceAgent::controlThread(INFO_NEEDED)",
                             deviceStr.c_str(),
                             "Failed to get channel info for PV",
-                            ich->second.m_pv->m_name.c_str(),
-                            ich->second.m_pv->m_connection.c_str() );
-                        usleep(33333); // give syslog a chance...
+                            ich->second->m_pv->m_name.c_str(),
+                            ich->second->m_pv->m_connection.c_str() );
                     }
-                    pendingPVs.push_back( ich->second.m_pv->m_connection );
+                    pendingPVs.push_back( ich->second->m_pv->m_connection );
                     break;
                 case INFO_AVAILABLE:
                     if ( m_defined )
                     {
                         // cout <<  "IA, chan: " << ich->first
-                             // << " ca_type = " << ich->second.m_ca_type
+                             // << " ca_type = " << ich->second->m_ca_type
                              // << " ca_element_count = "
-                             // << ich->second.m_ca_elem_count
+                             // << ich->second->m_ca_elem_count
                              // << " for PV: "
-                             // << ich->second.m_pv->m_connection << endl;
-
-                        if ( !ich->second.m_pv->equalMetadata(
-                                epicsToPVType( ich->second.m_ca_type,
-                                    ich->second.m_ca_elem_count ),
-                                ich->second.m_ca_elem_count,
-                                ich->second.m_ca_units,
-                                ich->second.m_ca_enum_vals ) )
+                             // << ich->second->m_pv->m_connection << endl;
+
+                        if ( !ich->second->m_pv->equalMetadata(
+                                epicsToPVType( ich->second->m_ca_type,
+                                    ich->second->m_ca_elem_count ),
+                                ich->second->m_ca_elem_count,
+                                ich->second->m_ca_units,
+                                ich->second->m_ca_enum_vals ) )
                         {
                             metadataUpdated();
                             // Setup for another state machine pass
@@ -859,26 +867,26 @@ DeviceAgent::controlThread()
                     }
 
                     // cout <<  "IN(2), chan: " << ich->first
-                         // << " ca_type = " << ich->second.m_ca_type
+                         // << " ca_type = " << ich->second->m_ca_type
                          // << " ca_element_count = "
-                         // << ich->second.m_ca_elem_count'
+                         // << ich->second->m_ca_elem_count'
                          // << " for PV: "
-                         // << ich->second.m_pv->m_connection << endl;
-
-                    ich->second.m_pv->setMetadata(
-                        epicsToPVType( ich->second.m_ca_type,
-                            ich->second.m_ca_elem_count ),
-                        ich->second.m_ca_elem_count,
-                        ich->second.m_ca_units,
-                        ich->second.m_ca_enum_vals );
-                    ich->second.m_chan_state = READY;
+                         // << ich->second->m_pv->m_connection << endl;
+
+                    ich->second->m_pv->setMetadata(
+                        epicsToPVType( ich->second->m_ca_type,
+                            ich->second->m_ca_elem_count ),
+                        ich->second->m_ca_elem_count,
+                        ich->second->m_ca_units,
+                        ich->second->m_ca_enum_vals );
+                    ich->second->m_chan_state = READY;
                     ++ready;
                     break;
                 case READY:
                     ++ready;
                     break;
                 default:
-                    pendingPVs.push_back( ich->second.m_pv->m_connection );
+                    pendingPVs.push_back( ich->second->m_pv->m_connection );
                     break;
                 }
             }
@@ -923,6 +931,9 @@ DeviceAgent::controlThread()
                         ich = m_chan_info.find( idx->second );
                         if ( ich != m_chan_info.end() )
                         {
+                            boost::lock_guard<boost::mutex> chan_lock(
+                                *ich->second->m_lock );
+
                             // Careful! PV names can be changed in new_rec
                             // due to name conflicts!!!
                             if ( (pv = m_dev_record->getPvByConnection(
@@ -930,8 +941,8 @@ DeviceAgent::controlThread()
                             {
                                 // Replace temporary device and PV records
                                 // with new managed records
-                                ich->second.m_device = m_dev_record;
-                                ich->second.m_pv = pv;
+                                ich->second->m_device = m_dev_record;
+                                ich->second->m_pv = pv;
                             }
                             // Handle Any Active Status PV...
                             else if ( m_dev_record->m_active_pv
@@ -940,30 +951,28 @@ DeviceAgent::controlThread()
                             {
                                 // Replace temporary device and PV records
                                 // with new managed records
-                                ich->second.m_device = m_dev_record;
-                                ich->second.m_pv =
+                                ich->second->m_device = m_dev_record;
+                                ich->second->m_pv =
                                     m_dev_record->m_active_pv;
                             }
                             else
                             {
-                                syslog( LOG_ERR, "%s %s: %s%s %s=%s - %s",
+                                ASYNC_SYSLOG( LOG_ERR, "%s %s: %s%s %s=%s - %s",
                                     "PVSD ERROR:",
                                     "DeviceAgent::controlThread()",
                                     "Missing PV for", deviceStr.c_str(),
                                     "connection", idx->first.c_str(),
                                     "Ignoring..." );
-                                usleep(33333); // give syslog a chance...
                             }
                         }
                         else
                         {
-                            syslog( LOG_ERR, "%s %s: %s %lx %s %s - %s",
+                            ASYNC_SYSLOG( LOG_ERR, "%s %s: %s %lx %s %s - %s",
                                 "PVSD ERROR:",
                                 "DeviceAgent::controlThread()",
                                 "Missing Channel Info", (long) idx->second,
                                 "for PV", idx->first.c_str(),
                                 "Ignoring..." );
-                            usleep(33333); // give syslog a chance...
                         }
                     }
 
@@ -999,14 +1008,13 @@ DeviceAgent::controlThread()
                             {
                                 m_dev_record->m_active = true;
 
-                                syslog( LOG_INFO,
+                                ASYNC_SYSLOG( LOG_INFO,
                                     "%s: %s %s -%s%s [%s = %u (%s)]",
                                     "DeviceAgent::controlThread()",
                                     "Mark Device Active",
                                     "from Active Status PV",
                                     deviceStr.c_str(), pvStr.c_str(),
                                     "active", 1, "true" );
-                                usleep(33333); // give syslog a chance...
                             }
 
                             // If We Didn't Just Send the PV Values
@@ -1021,7 +1029,7 @@ DeviceAgent::controlThread()
                         else if ( m_dev_record->m_active_pv->m_is_active
                                 == DEVICE_IS_UNKNOWN )
                         {
-                            syslog( LOG_ERR,
+                            ASYNC_SYSLOG( LOG_ERR,
                                 "%s %s: %s, %s %s -%s%s [%s = %u (%s)]",
                                 "PVSD ERROR:",
                                 "DeviceAgent::controlThread()",
@@ -1032,7 +1040,6 @@ DeviceAgent::controlThread()
                                 "active", m_dev_record->m_active,
                                 ( ( m_dev_record->m_active )
                                     ? "true" : "false" ) );
-                            usleep(33333); // give syslog a chance...
 
                             // If Device is Active,
                             // And We Didn't Just Send the PV Values
@@ -1055,14 +1062,13 @@ DeviceAgent::controlThread()
                             {
                                 m_dev_record->m_active = false;
 
-                                syslog( LOG_INFO,
+                                ASYNC_SYSLOG( LOG_INFO,
                                     "%s: %s %s -%s%s [%s = %u (%s)]",
                                     "DeviceAgent::controlThread()",
                                     "Mark Device Inactive",
                                     "from Active Status PV",
                                     deviceStr.c_str(), pvStr.c_str(),
                                     "active", 0, "false" );
-                                usleep(33333); // give syslog a chance...
                             }
 
                             if ( m_dev_record.get() )
@@ -1073,14 +1079,13 @@ DeviceAgent::controlThread()
                             }
                             else
                             {
-                                syslog( LOG_ERR,
+                                ASYNC_SYSLOG( LOG_ERR,
                                     "%s %s: %s%s%s [%s = %u (%s)]",
                                     "PVSD ERROR:",
                                     "DeviceAgent::controlThread()",
                                     "Couldn't Soft-Undefine Now-Inactive",
                                     deviceStr.c_str(), pvStr.c_str(),
                                     "active", 0, "false" );
-                                usleep(33333); // give syslog a chance...
                             }
                         }
                     }
@@ -1102,14 +1107,13 @@ DeviceAgent::controlThread()
                         ss << "<" << pendingPVs[i] << ">";
                     }
 
-                    syslog( LOG_INFO,
+                    ASYNC_SYSLOG( LOG_INFO,
                         "%s: %sWaiting for %ld Pending PV Connections: %s",
                         "DeviceAgent::controlThread()", deviceStr.c_str(),
                         m_dev_desc->m_pvs.size()
                             + ( ( m_dev_desc->m_active_pv ) ? 1 : 0 )
                             - ready,
                         ss.str().c_str() );
-                    usleep(33333); // give syslog a chance...
 
                     // Save Number of "Ready" PVs, in case Device Hangs
                     // on Initialization (include pending count in signal)
@@ -1119,19 +1123,19 @@ DeviceAgent::controlThread()
         }
         catch ( TraceException &e )
         {
-            syslog( LOG_ERR, "%s %s: TraceException thrown!",
+            ASYNC_SYSLOG( LOG_ERR, "%s %s: TraceException thrown!",
                 "PVSD ERROR:", "DeviceAgent::controlThread()" );
-            syslog( LOG_ERR, "content: %s", e.toString( true ).c_str() );
+            ASYNC_SYSLOG( LOG_ERR, "content: %s", e.toString( true ).c_str() );
         }
         catch ( exception &e )
         {
-            syslog( LOG_ERR, "%s %s: std::exception thrown!",
+            ASYNC_SYSLOG( LOG_ERR, "%s %s: std::exception thrown!",
                 "PVSD ERROR:", "DeviceAgent::controlThread()" );
-            syslog( LOG_ERR, "content: %s", e.what() );
+            ASYNC_SYSLOG( LOG_ERR, "content: %s", e.what() );
         }
         catch(...)
         {
-            syslog( LOG_ERR, "%s %s: Unknown exception thrown!",
+            ASYNC_SYSLOG( LOG_ERR, "%s %s: Unknown exception thrown!",
                 "PVSD ERROR:", "DeviceAgent::controlThread()" );
         }
     }
@@ -1184,13 +1188,36 @@ DeviceAgent::monitorThread()
      * will be properly retracted when it is finally ready.
      */
 
+    // Startup checks run once a second; while any of the device's PVs
+    // has a max rate, wake more often to send held updates on time
+    uint32_t tick = 1000000;
+    uint32_t elapsed = 0;
+    time_t last_report = time(0);
+
     // Run until DeviceAgent is shutdown/destroyed
     while ( m_agent_active )
     {
-        sleep(1);
+        struct timespec ts = { tick / 1000000, ( tick % 1000000 ) * 1000 };
+        nanosleep( &ts, 0 );
 
         boost::unique_lock<boost::mutex> lock(m_mutex);
 
+        elapsed += tick;
+        tick = sendHeldUpdates() ? HELD_UPDATE_TICK : 1000000;
+        if ( elapsed < 1000000 )
+            continue;
+        elapsed = 0;
+
+        if ( time(0) - last_report >= FILTER_REPORT_PERIOD )
+        {
+            for ( map<chid,ChanInfo*>::iterator ich = m_chan_info.begin();
+                    ich != m_chan_info.end(); ++ich )
+            {
+                logFilterCounts( *ich->second );
+            }
+            last_report = time(0);
+        }
+
         switch( state )
         {
             case DSS_INITIALIZING: // Timer running - device not ready yet
@@ -1226,8 +1253,7 @@ DeviceAgent::monitorThread()
                             sigmsg );
 
                         // Also log the error
-                        syslog( LOG_ERR, ss.str().c_str() );
-                        usleep(33333); // give syslog a chance...
+                        ASYNC_SYSLOG( LOG_ERR, ss.str().c_str() );
 
                         // Be Sure to Set Device Active Status If Known!
                         if ( m_dev_desc->m_active_pv )
@@ -1240,7 +1266,7 @@ DeviceAgent::monitorThread()
                             if ( m_dev_desc->m_active_pv->m_is_active
                                 == DEVICE_IS_ACTIVE )
                             {
-                                syslog( LOG_ERR,
+                                ASYNC_SYSLOG( LOG_ERR,
                                     "%s: %s [%s] %s to %s, %s %s",
                                     "DeviceAgent::monitorThread()",
                                     "Setting HUNG Device",
@@ -1253,7 +1279,7 @@ DeviceAgent::monitorThread()
                             else if ( m_dev_desc->m_active_pv->m_is_active
                                 == DEVICE_IS_INACTIVE )
                             {
-                                syslog( LOG_ERR,
+                                ASYNC_SYSLOG( LOG_ERR,
                                     "%s: %s [%s] %s to %s, %s %s",
                                     "DeviceAgent::monitorThread()",
                                     "Setting HUNG Device",
@@ -1265,7 +1291,7 @@ DeviceAgent::monitorThread()
                             }
                             else
                             {
-                                syslog( LOG_ERR,
+                                ASYNC_SYSLOG( LOG_ERR,
                                     "%s: %s [%s] %s, %s %s",
                                     "DeviceAgent::monitorThread()",
                                     "Cannot Set HUNG Device",
@@ -1307,8 +1333,7 @@ DeviceAgent::monitorThread()
                         "PVSD ERROR: DeviceAgent::monitorThread(): "
                         + string("Device [") + dev_name
                         + "] has recovered from hung state.";
-                    syslog( LOG_ERR, message.c_str() );
-                    usleep(33333); // give syslog a chance...
+                    ASYNC_SYSLOG( LOG_ERR, message.c_str() );
 
                     m_hung = false;
 
@@ -1357,7 +1382,7 @@ DeviceAgent::monitorThread()
  * dropped and a PV disconnect packet is emitted.
  */
 void
-DeviceAgent::epicsConnectionHandler(
+DeviceAgent::epicsConnectionHandler( ChanInfo &a_info,
         struct connection_handler_args a_args )
 {
     try
@@ -1367,85 +1392,77 @@ DeviceAgent::epicsConnectionHandler(
         {
             boost::lock_guard<boost::mutex> lock(m_mutex);
 
-            map<chid,ChanInfo>::iterator ich =
-                m_chan_info.find( a_args.chid );
+            a_info.m_connected = true;
 
-            if ( ich != m_chan_info.end() )
+            chtype type = ca_field_type( a_args.chid );
+            unsigned long elem_count = ca_element_count( a_args.chid );
+            if ( VALID_DB_FIELD( type ) )
             {
-                ich->second.m_connected = true;
+                // Save native type
+                a_info.m_ca_type = type;
+                a_info.m_ca_elem_count = elem_count;
+                //cout <<  "chan: " << a_info.m_chid
+                    // << " ca_type = " << type << " for PV: "
+                    // << a_info.m_pv->m_connection << endl;
 
-                chtype type = ca_field_type( a_args.chid );
-                unsigned long elem_count = ca_element_count( a_args.chid );
-                if ( VALID_DB_FIELD( type ) )
+                std::string deviceStr = "";
+                if ( a_info.m_device != NULL )
                 {
-                    // Save native type
-                    ich->second.m_ca_type = type;
-                    ich->second.m_ca_elem_count = elem_count;
-                    //cout <<  "chan: " << ich->first
-                        // << " ca_type = " << type << " for PV: "
-                        // << ich->second.m_pv->m_connection << endl;
-
-                    std::string deviceStr = "";
-                    if ( ich->second.m_device != NULL )
-                    {
-                        deviceStr = " - Device ["
-                            + ich->second.m_device->m_name + "]";
-                    }
+                    deviceStr = " - Device ["
+                        + a_info.m_device->m_name + "]";
+                }
 
-                    std::string pvStr = "";
-                    if ( ich->second.m_pv != NULL )
-                    {
-                        pvStr = " for PV <"
-                            + ich->second.m_pv->m_name + "> ("
-                            + ich->second.m_pv->m_connection + ")";
-                    }
+                std::string pvStr = "";
+                if ( a_info.m_pv != NULL )
+                {
+                    pvStr = " for PV <"
+                        + a_info.m_pv->m_name + "> ("
+                        + a_info.m_pv->m_connection + ")";
+                }
 
-                    if ( ca_create_subscription(
-                            epicsToTimeRecordType( type ), 0,
-                            ich->second.m_chid,
-                            DBE_VALUE | DBE_ALARM | DBE_PROPERTY,
-                            &epicsEventCallback, this,
-                            &ich->second.m_evid ) == ECA_NORMAL )
-                    {
-                        // Log as "Error" to Trigger Email Notification
-                        // (as an Accompaniment to Subscription Down...)
-                        syslog( LOG_ERR, "%s %s: Subscription created%s%s",
-                            "PVSD ERROR:",
-                            "DeviceAgent::epicsConnectionHandler()",
-                            deviceStr.c_str(), pvStr.c_str() );
-                        usleep(33333); // give syslog a chance...
+                if ( ca_create_subscription(
+                        epicsToTimeRecordType( type ), 0,
+                        a_info.m_chid,
+                        DBE_VALUE | DBE_ALARM | DBE_PROPERTY,
+                        &epicsEventCallback, this,
+                        &a_info.m_evid ) == ECA_NORMAL )
+                {
+                    // Log as "Error" to Trigger Email Notification
+                    // (as an Accompaniment to Subscription Down...)
+                    ASYNC_SYSLOG( LOG_ERR, "%s %s: Subscription created%s%s",
+                        "PVSD ERROR:",
+                        "DeviceAgent::epicsConnectionHandler()",
+                        deviceStr.c_str(), pvStr.c_str() );
 
-                        ich->second.m_subscribed = true;
-                    }
-                    else
-                    {
-                        syslog( LOG_ERR,
-                            "%s %s: Failed to create subscription%s%s",
-                            "PVSD ERROR:",
-                            "DeviceAgent::epicsConnectionHandler()",
-                            deviceStr.c_str(), pvStr.c_str() );
-                        usleep(33333); // give syslog a chance...
-                    }
+                    a_info.m_subscribed = true;
+                }
+                else
+                {
+                    ASYNC_SYSLOG( LOG_ERR,
+                        "%s %s: Failed to create subscription%s%s",
+                        "PVSD ERROR:",
+                        "DeviceAgent::epicsConnectionHandler()",
+                        deviceStr.c_str(), pvStr.c_str() );
+                }
 
-                    // Update Pseudo "Ready" Counter for Status Logging...
-                    if ( ich->second.m_device != NULL )
-                        (ich->second.m_device->m_ready)++;
+                // Update Pseudo "Ready" Counter for Status Logging...
+                if ( a_info.m_device != NULL )
+                    (a_info.m_device->m_ready)++;
 
-                    ca_flush_io();
+                ca_flush_io();
 
-                    // Note: there is no way to know if the metadata
-                    // on this channel has or hasn't changed,
-                    // so assume it has changed
+                // Note: there is no way to know if the metadata
+                // on this channel has or hasn't changed,
+                // so assume it has changed
 
-                    // There is NO ctrl record for EPICS string types
-                    if ( ich->second.m_pv->m_type == PV_STR )
-                        ich->second.m_chan_state = INFO_AVAILABLE;
-                    else
-                        ich->second.m_chan_state = INFO_NEEDED;
+                // There is NO ctrl record for EPICS string types
+                if ( a_info.m_pv->m_type == PV_STR )
+                    a_info.m_chan_state = INFO_AVAILABLE;
+                else
+                    a_info.m_chan_state = INFO_NEEDED;
 
-                    m_state_changed = true;
-                    m_state_cond.notify_one();
-                }
+                m_state_changed = true;
+                m_state_cond.notify_one();
             }
         }
 
@@ -1454,189 +1471,186 @@ DeviceAgent::epicsConnectionHandler(
         {
             boost::unique_lock<boost::mutex> lock(m_mutex);
 
-            map<chid,ChanInfo>::iterator ich =
-                m_chan_info.find( a_args.chid );
+            a_info.m_connected = false;
 
-            if ( ich != m_chan_info.end() )
+            std::string deviceStr = "";
+            if ( a_info.m_device != NULL )
             {
-                ich->second.m_connected = false;
-
-                std::string deviceStr = "";
-                if ( ich->second.m_device != NULL )
-                {
-                    deviceStr = " - Device ["
-                        + ich->second.m_device->m_name + "]";
-                }
+                deviceStr = " - Device ["
+                    + a_info.m_device->m_name + "]";
+            }
 
-                std::string pvStr = "";
-                if ( ich->second.m_pv != NULL )
-                {
-                    pvStr = " for PV <"
-                        + ich->second.m_pv->m_name + "> ("
-                        + ich->second.m_pv->m_connection + ")";
-                }
+            std::string pvStr = "";
+            if ( a_info.m_pv != NULL )
+            {
+                pvStr = " for PV <"
+                    + a_info.m_pv->m_name + "> ("
+                    + a_info.m_pv->m_connection + ")";
+            }
 
-                if ( ich->second.m_subscribed )
-                {
-                    syslog( LOG_ERR, "%s %s: %s%s%s",
-                        "PVSD ERROR:",
-                        "DeviceAgent::epicsConnectionHandler()",
-                        "Clearing subscription (Down?)",
-                        deviceStr.c_str(), pvStr.c_str() );
-                    usleep(33333); // give syslog a chance...
+            if ( a_info.m_subscribed )
+            {
+                ASYNC_SYSLOG( LOG_ERR, "%s %s: %s%s%s",
+                    "PVSD ERROR:",
+                    "DeviceAgent::epicsConnectionHandler()",
+                    "Clearing subscription (Down?)",
+                    deviceStr.c_str(), pvStr.c_str() );
 
-                    // *** Prevent Deadlock with New EPICS Callback Guard!
-                    lock.unlock();
-                    ca_clear_subscription( ich->second.m_evid );
-                    lock.lock();
+                // *** Prevent Deadlock with New EPICS Callback Guard!
+                lock.unlock();
+                ca_clear_subscription( a_info.m_evid );
+                lock.lock();
 
-                    ich->second.m_subscribed = false;
-                }
+                a_info.m_subscribed = false;
+            }
 
-                // Update Pseudo "Ready" Counter for Status Logging...
-                if ( ich->second.m_device != NULL )
-                    (ich->second.m_device->m_ready)--;
+            // Update Pseudo "Ready" Counter for Status Logging...
+            if ( a_info.m_device != NULL )
+                (a_info.m_device->m_ready)--;
 
-                // Set var state to disconnected
-                ich->second.m_pv_state.m_status = epicsAlarmComm;
-                ich->second.m_pv_state.m_severity = epicsSevMajor;
+            // Value state is also guarded by the channel lock
+            boost::lock_guard<boost::mutex> chan_lock( *a_info.m_lock );
 
-                // Lost Connection for PV, Clean Things Up...
-                if ( ich->second.m_pv != NULL )
-                {
-                    // Always Save Active Status to PV Descriptor...
-                    // (This PV Could Become an Active Status PV... ;-D)
-                    ich->second.m_pv->m_is_active = DEVICE_IS_UNKNOWN;
+            // Set var state to disconnected
+            a_info.m_pv_state.m_status = epicsAlarmComm;
+            a_info.m_pv_state.m_severity = epicsSevMajor;
 
-                    // Lost Connection for Active Status PV...!
-                    if ( ich->second.m_pv->m_is_active_pv )
-                    {
-                        // NOTE: Just Because Active Status PV Goes Away,
-                        // *Don't* Set Device to "Inactive"...
-                        // Leave Device Status As Is! ;-D (8/1/2019)
-                        // if ( ich->second.m_device != NULL )
-                            // ich->second.m_device->m_active = false;
+            // Disconnect is sent below; anything held is stale, and
+            // the first value after reconnecting always goes out
+            a_info.m_held = false;
+            a_info.m_sent = false;
 
-                        std::string statusStr = "unknown";
-                        bool active_state = false;
+            // Lost Connection for PV, Clean Things Up...
+            if ( a_info.m_pv != NULL )
+            {
+                // Always Save Active Status to PV Descriptor...
+                // (This PV Could Become an Active Status PV... ;-D)
+                a_info.m_pv->m_is_active = DEVICE_IS_UNKNOWN;
 
-                        std::string deviceStr = " *** NO DEVICE ***";
-                        if ( ich->second.m_device != NULL )
-                        {
-                            deviceStr = " Device ["
-                                + ich->second.m_device->m_name + "]";
-                            active_state = ich->second.m_device->m_active;
-                            statusStr = active_state ? "true" : "false";
-                        }
+                // Lost Connection for Active Status PV...!
+                if ( a_info.m_pv->m_is_active_pv )
+                {
+                    // NOTE: Just Because Active Status PV Goes Away,
+                    // *Don't* Set Device to "Inactive"...
+                    // Leave Device Status As Is! ;-D (8/1/2019)
+                    // if ( a_info.m_device != NULL )
+                        // a_info.m_device->m_active = false;
 
-                        std::string pvStr = "";
-                        if ( ich->second.m_pv != NULL )
-                        {
-                            pvStr = " Active Status PV <"
-                                + ich->second.m_pv->m_name + "> ("
-                                + ich->second.m_pv->m_connection + ")";
-                        }
+                    std::string statusStr = "unknown";
+                    bool active_state = false;
 
-                        syslog( LOG_ERR,
-                            "%s %s: %s%s%s - %s [%s = %u (%s)]",
-                            "PVSD ERROR:",
-                            "DeviceAgent::epicsConnectionHandler()",
-                            "Lost Active Status PV Connection for",
-                            deviceStr.c_str(), pvStr.c_str(),
-                            "Device Active Status Remains Unchanged",
-                            "active", active_state, statusStr.c_str() );
-                        usleep(33333); // give syslog a chance...
+                    std::string deviceStr = " *** NO DEVICE ***";
+                    if ( a_info.m_device != NULL )
+                    {
+                        deviceStr = " Device ["
+                            + a_info.m_device->m_name + "]";
+                        active_state = a_info.m_device->m_active;
+                        statusStr = active_state ? "true" : "false";
+                    }
 
-                        // NOTE: *Don't* "Soft-Delete" Device! Leave As Is!
-                        // Device has Gone Inactive, "Soft-Delete" Device
-                        // (i.e. Don't _Actually_ Delete It, Just Pretend!)
-                        // if ( m_dev_record.get() )
-                        // {
-                            // m_stream_api.getCfgMgr().undefineDevice(
-                                // m_dev_record,
-                                // /* Don't Delete Device! */ false );
-                        // }
-                        // else
-                        // {
-                            // syslog( LOG_ERR,
-                                // "%s %s: %s%s%s [%s = %u (%s)]",
-                                // "PVSD ERROR:",
-                                // "DeviceAgent::epicsConnectionHandler()",
-                                // "Couldn't Soft-Undefine Now-Inactive",
-                                // deviceStr.c_str(), pvStr.c_str(),
-                                // "active", 0, "false" );
-                            // usleep(33333); // give syslog a chance...
-                        // }
-
-                        // Don't Send Variable Value Updates
-                        // for Active Status PVs...!
-                        // (Unless Active Status PV is Marked
-                        // to _Not_ Ignore, Because it Subsumed
-                        // a Regular Device PV...)
-                        if ( ich->second.m_pv->m_ignore )
-                            return;
+                    std::string pvStr = "";
+                    if ( a_info.m_pv != NULL )
+                    {
+                        pvStr = " Active Status PV <"
+                            + a_info.m_pv->m_name + "> ("
+                            + a_info.m_pv->m_connection + ")";
                     }
+
+                    ASYNC_SYSLOG( LOG_ERR,
+                        "%s %s: %s%s%s - %s [%s = %u (%s)]",
+                        "PVSD ERROR:",
+                        "DeviceAgent::epicsConnectionHandler()",
+                        "Lost Active Status PV Connection for",
+                        deviceStr.c_str(), pvStr.c_str(),
+                        "Device Active Status Remains Unchanged",
+                        "active", active_state, statusStr.c_str() );
+
+                    // NOTE: *Don't* "Soft-Delete" Device! Leave As Is!
+                    // Device has Gone Inactive, "Soft-Delete" Device
+                    // (i.e. Don't _Actually_ Delete It, Just Pretend!)
+                    // if ( m_dev_record.get() )
+                    // {
+                        // m_stream_api.getCfgMgr().undefineDevice(
+                            // m_dev_record,
+                            // /* Don't Delete Device! */ false );
+                    // }
+                    // else
+                    // {
+                        // ASYNC_SYSLOG( LOG_ERR,
+                            // "%s %s: %s%s%s [%s = %u (%s)]",
+                            // "PVSD ERROR:",
+                            // "DeviceAgent::epicsConnectionHandler()",
+                            // "Couldn't Soft-Undefine Now-Inactive",
+                            // deviceStr.c_str(), pvStr.c_str(),
+                            // "active", 0, "false" );
+                    // }
+
+                    // Don't Send Variable Value Updates
+                    // for Active Status PVs...!
+                    // (Unless Active Status PV is Marked
+                    // to _Not_ Ignore, Because it Subsumed
+                    // a Regular Device PV...)
+                    if ( a_info.m_pv->m_ignore )
+                        return;
                 }
+            }
 
-                // Do not try to send value/alarm data unless
-                // device is fully defined
-                if ( !m_defined )
-                    return;
+            // Do not try to send value/alarm data unless
+            // device is fully defined
+            if ( !m_defined )
+                return;
 
-                bool timeout;
-                StreamPacket *pkt =
-                    m_stream_api.getFreePacket( 5000, timeout );
-                if ( pkt )
-                {
-                    pkt->type = VariableUpdate;
-                    pkt->device = ich->second.m_device;
-                    pkt->pv = ich->second.m_pv;
-                    pkt->state = ich->second.m_pv_state;
+            bool timeout;
+            StreamPacket *pkt =
+                m_stream_api.getFreePacket( 5000, timeout );
+            if ( pkt )
+            {
+                pkt->type = VariableUpdate;
+                pkt->device = a_info.m_device;
+                pkt->pv = a_info.m_pv;
+                pkt->state = a_info.m_pv_state;
 
-                    m_stream_api.putFilledPacket( pkt );
+                m_stream_api.putFilledPacket( pkt );
+            }
+            else
+            {
+                if ( m_stream_api.getFreeQueueActive() )
+                {
+                    ASYNC_SYSLOG( LOG_ERR, "%s %s: %s %s%s%s [%s = %lu]",
+                        "PVSD ERROR:",
+                        "DeviceAgent::epicsConnectionHandler()",
+                        "No Free Packets!", "VariableUpdate Lost",
+                        deviceStr.c_str(), pvStr.c_str(),
+                        "Filled Queue Size",
+                        (unsigned long)
+                            m_stream_api.getFilledQueueSize() );
                 }
                 else
                 {
-                    if ( m_stream_api.getFreeQueueActive() )
-                    {
-                        syslog( LOG_ERR, "%s %s: %s %s%s%s [%s = %lu]",
-                            "PVSD ERROR:",
-                            "DeviceAgent::epicsConnectionHandler()",
-                            "No Free Packets!", "VariableUpdate Lost",
-                            deviceStr.c_str(), pvStr.c_str(),
-                            "Filled Queue Size",
-                            (unsigned long)
-                                m_stream_api.getFilledQueueSize() );
-                        usleep(33333); // give syslog a chance...
-                    }
-                    else
-                    {
-                        syslog( LOG_ERR, "%s %s: %s %s%s%s",
-                            "PVSD ERROR:",
-                            "DeviceAgent::epicsConnectionHandler()",
-                            "Queue Deactivated,", "Ignore VariableUpdate",
-                            deviceStr.c_str(), pvStr.c_str() );
-                        usleep(33333); // give syslog a chance...
-                    }
+                    ASYNC_SYSLOG( LOG_ERR, "%s %s: %s %s%s%s",
+                        "PVSD ERROR:",
+                        "DeviceAgent::epicsConnectionHandler()",
+                        "Queue Deactivated,", "Ignore VariableUpdate",
+                        deviceStr.c_str(), pvStr.c_str() );
                 }
             }
         }
     }
     catch( TraceException &e )
     {
-        syslog( LOG_ERR, "%s %s: TraceException!",
+        ASYNC_SYSLOG( LOG_ERR, "%s %s: TraceException!",
             "PVSD ERROR:", "DeviceAgent::epicsConnectionHandler()" );
-        syslog( LOG_ERR, e.toString().c_str() );
+        ASYNC_SYSLOG( LOG_ERR, e.toString().c_str() );
     }
     catch( std::exception &e )
     {
-        syslog( LOG_ERR, "%s %s: Exception!",
+        ASYNC_SYSLOG( LOG_ERR, "%s %s: Exception!",
             "PVSD ERROR:", "DeviceAgent::epicsConnectionHandler()" );
-        syslog( LOG_ERR, e.what() );
+        ASYNC_SYSLOG( LOG_ERR, e.what() );
     }
     catch(...)
     {
-        syslog( LOG_ERR, "%s %s: Unknown exception!",
+        ASYNC_SYSLOG( LOG_ERR, "%s %s: Unknown exception!",
             "PVSD ERROR:", "DeviceAgent::epicsConnectionHandler()" );
     }
 }
@@ -1677,7 +1691,8 @@ DeviceAgent::updateState( const void *a_src, PVState &a_state )
  * This method handles EPICS data and metadata channel events.
  */
 void
-DeviceAgent::epicsEventHandler( struct event_handler_args a_args )
+DeviceAgent::epicsEventHandler( ChanInfo &a_info,
+        struct event_handler_args a_args )
 {
     try
     {
@@ -1688,472 +1703,356 @@ DeviceAgent::epicsEventHandler( struct event_handler_args a_args )
         // Data event?
         if ( epicsIsTimeRecordType( a_args.type ) )
         {
-            boost::lock_guard<boost::mutex> lock(m_mutex);
-
-            // Valid EPICS channel?
-            map<chid,ChanInfo>::iterator ich =
-                m_chan_info.find( a_args.chid );
+            // Value updates only take this channel's lock, so callbacks
+            // for different channels don't serialize on m_mutex
+            boost::unique_lock<boost::mutex> chan_lock( *a_info.m_lock );
 
-            if ( ich != m_chan_info.end() )
-            {
-                // Extract PV state from type-specific data structure
-                PVState &state = ich->second.m_pv_state;
+            // Extract PV state from type-specific data structure
+            PVState &state = a_info.m_pv_state;
 
-                bool active_state = false;
+            bool active_state = false;
 
-                // For Logging...
-                std::string ckDeviceStr = "";
-                if ( ich->second.m_device != NULL )
-                {
-                    ckDeviceStr = " for Device ["
-                        + ich->second.m_device->m_name + "]";
-                }
-                std::string ckPvStr = "";
-                if ( ich->second.m_pv != NULL )
-                {
-                    ckPvStr = " PV <"
-                        + ich->second.m_pv->m_name + "> ("
-                        + ich->second.m_pv->m_connection + ")";
-                }
-
-                switch ( a_args.type )
+            switch ( a_args.type )
+            {
+            case DBR_TIME_STRING:
+                state.m_str_val =
+                    ((struct dbr_time_string *)a_args.dbr)->value;
+                state.m_elem_count = a_args.count; // Always 1 String?
+                updateState<struct dbr_time_string>(
+                    a_args.dbr, state );
+                if ( !state.m_str_val.compare("true") )
+                    active_state = true;
+                ASYNC_SYSLOG( LOG_DEBUG, "%s: %s%s%s %s=[%s] %s=%u %s=%lu",
+                    "DeviceAgent::epicsEventHandler()",
+                    "Got String PV Value Update",
+                    deviceLabel( a_info, " for Device [" ).c_str(),
+                    pvLabel( a_info, " PV <" ).c_str(),
+                    "state.m_str_val", state.m_str_val.c_str(),
+                    "state.m_elem_count", state.m_elem_count,
+                    "state.m_str_val.size()", state.m_str_val.size() );
+                break;
+            case DBR_TIME_SHORT:
+                // Could be Scalar Numerical Value
+                // -OR- Variable Length Numerical Array...!
+                //    -> Therefore, Set *Both* Value Fields...! ;-D
+                state.m_int_val = (int32_t)
+                    ((struct dbr_time_short *)a_args.dbr)->value;
+                state.m_elem_count = a_args.count;
+                if ( a_args.count > 1 ) // Minimum Array Size is 2...
                 {
-                case DBR_TIME_STRING:
-                    state.m_str_val =
-                        ((struct dbr_time_string *)a_args.dbr)->value;
-                    state.m_elem_count = a_args.count; // Always 1 String?
-                    updateState<struct dbr_time_string>(
-                        a_args.dbr, state );
-                    if ( !state.m_str_val.compare("true") )
-                        active_state = true;
-                    syslog( LOG_DEBUG, "%s: %s%s%s %s=[%s] %s=%u %s=%lu",
-                        "DeviceAgent::epicsEventHandler()",
-                        "Got String PV Value Update",
-                        ckDeviceStr.c_str(), ckPvStr.c_str(),
-                        "state.m_str_val", state.m_str_val.c_str(),
-                        "state.m_elem_count", state.m_elem_count,
-                        "state.m_str_val.size()", state.m_str_val.size() );
-                    usleep(33333); // give syslog a chance...
-                    break;
-                case DBR_TIME_SHORT:
-                    // Could be Scalar Numerical Value
-                    // -OR- Variable Length Numerical Array...!
-                    //    -> Therefore, Set *Both* Value Fields...! ;-D
-                    state.m_int_val = (int32_t)
-                        ((struct dbr_time_short *)a_args.dbr)->value;
-                    state.m_elem_count = a_args.count;
-                    if ( a_args.count > 1 ) // Minimum Array Size is 2...
+                    state.m_short_array = new int16_t[a_args.count];
+                    int16_t *values = (int16_t *)
+                        &((struct dbr_time_short *)a_args.dbr)->value;
+                    for ( uint32_t i=0 ; i < a_args.count ; i++ )
                     {
-                        state.m_short_array = new int16_t[a_args.count];
-                        int16_t *values = (int16_t *)
-                            &((struct dbr_time_short *)a_args.dbr)->value;
-                        for ( uint32_t i=0 ; i < a_args.count ; i++ )
-                        {
-                            state.m_short_array[i] = values[i];
-                        }
-                    }
-                    updateState<struct dbr_time_short>(
-                        a_args.dbr, state );
-                    if ( state.m_int_val )
-                        active_state = true;
-                    break;
-                case DBR_TIME_FLOAT:
-                    // Could be Scalar Numerical Value
-                    // -OR- Variable Length Numerical Array...!
-                    //    -> Therefore, Set *Both* Value Fields...! ;-D
-                    state.m_double_val = (double)
-                        ((struct dbr_time_float *)a_args.dbr)->value;
-                    state.m_elem_count = a_args.count;
-                    if ( a_args.count > 1 ) // Minimum Array Size is 2...
-                    {
-                        state.m_float_array = new float[a_args.count];
-                        float *values = (float *)
-                            &((struct dbr_time_float *)a_args.dbr)->value;
-                        for ( uint32_t i=0 ; i < a_args.count ; i++ )
-                        {
-                            state.m_float_array[i] = values[i];
-                        }
+                        state.m_short_array[i] = values[i];
                     }
-                    updateState<struct dbr_time_float>(
-                        a_args.dbr, state );
-                    if ( state.m_double_val )
-                        active_state = true;
-                    break;
-                case DBR_TIME_ENUM:
-                    state.m_uint_val = (uint32_t)
-                        ((struct dbr_time_enum *)a_args.dbr)->value;
-                    state.m_elem_count = a_args.count;
-                    updateState<struct dbr_time_enum>(
-                        a_args.dbr, state );
-                    if ( state.m_uint_val )
-                        active_state = true;
-                    break;
-                case DBR_TIME_CHAR:
-                    // Could be (Scalar Numerical) Character
-                    // -OR- Variable Length Character String...!
-                    //    -> Therefore, Set *Both* Value Fields...! ;-D
-                    state.m_uint_val = (uint32_t)
-                        ((struct dbr_time_char *)a_args.dbr)->value;
-                    state.m_str_val = (char *)
-                        &((struct dbr_time_char *)a_args.dbr)->value;
-                    state.m_elem_count = a_args.count;
-                    updateState<struct dbr_time_char>( a_args.dbr, state );
-                    // *** Trim String Value to Specified Length!!
-                    if ( state.m_elem_count < state.m_str_val.size() )
+                }
+                updateState<struct dbr_time_short>(
+                    a_args.dbr, state );
+                if ( state.m_int_val )
+                    active_state = true;
+                break;
+            case DBR_TIME_FLOAT:
+                // Could be Scalar Numerical Value
+                // -OR- Variable Length Numerical Array...!
+                //    -> Therefore, Set *Both* Value Fields...! ;-D
+                state.m_double_val = (double)
+                    ((struct dbr_time_float *)a_args.dbr)->value;
+                state.m_elem_count = a_args.count;
+                if ( a_args.count > 1 ) // Minimum Array Size is 2...
+                {
+                    state.m_float_array = new float[a_args.count];
+                    float *values = (float *)
+                        &((struct dbr_time_float *)a_args.dbr)->value;
+                    for ( uint32_t i=0 ; i < a_args.count ; i++ )
                     {
-                        syslog( LOG_ERR,
-                            "%s %s: %s%s%s ORIG %s=[%s] %s=%u %s=%lu",
-                            "PVSD ERROR:",
-                            "DeviceAgent::epicsEventHandler()",
-                            "Got Char PV Value Update TRIMMING LENGTH",
-                            ckDeviceStr.c_str(), ckPvStr.c_str(),
-                            "state.m_str_val", state.m_str_val.c_str(),
-                            "state.m_elem_count", state.m_elem_count,
-                            "state.m_str_val.size()",
-                            state.m_str_val.size() );
-                        usleep(33333); // give syslog a chance...
-                        state.m_str_val.erase( state.m_elem_count );
+                        state.m_float_array[i] = values[i];
                     }
-                    // Check/Set Any Active State Value
-                    if ( state.m_uint_val )
-                        active_state = true;
-                    syslog( LOG_DEBUG, "%s: %s%s%s %s=[%s] %s=%u %s=%lu",
+                }
+                updateState<struct dbr_time_float>(
+                    a_args.dbr, state );
+                if ( state.m_double_val )
+                    active_state = true;
+                break;
+            case DBR_TIME_ENUM:
+                state.m_uint_val = (uint32_t)
+                    ((struct dbr_time_enum *)a_args.dbr)->value;
+                state.m_elem_count = a_args.count;
+                updateState<struct dbr_time_enum>(
+                    a_args.dbr, state );
+                if ( state.m_uint_val )
+                    active_state = true;
+                break;
+            case DBR_TIME_CHAR:
+                // Could be (Scalar Numerical) Character
+                // -OR- Variable Length Character String...!
+                //    -> Therefore, Set *Both* Value Fields...! ;-D
+                state.m_uint_val = (uint32_t)
+                    ((struct dbr_time_char *)a_args.dbr)->value;
+                state.m_str_val = (char *)
+                    &((struct dbr_time_char *)a_args.dbr)->value;
+                state.m_elem_count = a_args.count;
+                updateState<struct dbr_time_char>( a_args.dbr, state );
+                // *** Trim String Value to Specified Length!!
+                if ( state.m_elem_count < state.m_str_val.size() )
+                {
+                    ASYNC_SYSLOG( LOG_ERR,
+                        "%s %s: %s%s%s ORIG %s=[%s] %s=%u %s=%lu",
+                        "PVSD ERROR:",
                         "DeviceAgent::epicsEventHandler()",
-                        "Got Char PV Value Update",
-                        ckDeviceStr.c_str(), ckPvStr.c_str(),
+                        "Got Char PV Value Update TRIMMING LENGTH",
+                        deviceLabel( a_info, " for Device [" ).c_str(),
+                    pvLabel( a_info, " PV <" ).c_str(),
                         "state.m_str_val", state.m_str_val.c_str(),
                         "state.m_elem_count", state.m_elem_count,
-                        "state.m_str_val.size()", state.m_str_val.size() );
-                    usleep(33333); // give syslog a chance...
-                    break;
-                case DBR_TIME_LONG:
-                    // Could be Scalar Numerical Value
-                    // -OR- Variable Length Numerical Array...!
-                    //    -> Therefore, Set *Both* Value Fields...! ;-D
-                    state.m_int_val = (int32_t)
-                        ((struct dbr_time_long *)a_args.dbr)->value;
-                    state.m_elem_count = a_args.count;
-                    if ( a_args.count > 1 ) // Minimum Array Size is 2...
+                        "state.m_str_val.size()",
+                        state.m_str_val.size() );
+                    state.m_str_val.erase( state.m_elem_count );
+                }
+                // Check/Set Any Active State Value
+                if ( state.m_uint_val )
+                    active_state = true;
+                ASYNC_SYSLOG( LOG_DEBUG, "%s: %s%s%s %s=[%s] %s=%u %s=%lu",
+                    "DeviceAgent::epicsEventHandler()",
+                    "Got Char PV Value Update",
+                    deviceLabel( a_info, " for Device [" ).c_str(),
+                    pvLabel( a_info, " PV <" ).c_str(),
+                    "state.m_str_val", state.m_str_val.c_str(),
+                    "state.m_elem_count", state.m_elem_count,
+                    "state.m_str_val.size()", state.m_str_val.size() );
+                break;
+            case DBR_TIME_LONG:
+                // Could be Scalar Numerical Value
+                // -OR- Variable Length Numerical Array...!
+                //    -> Therefore, Set *Both* Value Fields...! ;-D
+                state.m_int_val = (int32_t)
+                    ((struct dbr_time_long *)a_args.dbr)->value;
+                state.m_elem_count = a_args.count;
+                if ( a_args.count > 1 ) // Minimum Array Size is 2...
+                {
+                    state.m_long_array = new int32_t[a_args.count];
+                    int32_t *values = (int32_t *)
+                        &((struct dbr_time_long *)a_args.dbr)->value;
+                    for ( uint32_t i=0 ; i < a_args.count ; i++ )
                     {
-                        state.m_long_array = new int32_t[a_args.count];
-                        int32_t *values = (int32_t *)
-                            &((struct dbr_time_long *)a_args.dbr)->value;
-                        for ( uint32_t i=0 ; i < a_args.count ; i++ )
-                        {
-                            state.m_long_array[i] = values[i];
-                        }
+                        state.m_long_array[i] = values[i];
                     }
-                    updateState<struct dbr_time_long>(
-                        a_args.dbr, state );
-                    if ( state.m_int_val )
-                        active_state = true;
-                    break;
-                case DBR_TIME_DOUBLE:
-                    // Could be Scalar Numerical Value
-                    // -OR- Variable Length Numerical Array...!
-                    //    -> Therefore, Set *Both* Value Fields...! ;-D
-                    state.m_double_val = (double)
-                        ((struct dbr_time_double *)a_args.dbr)->value;
-                    state.m_elem_count = a_args.count;
-                    if ( a_args.count > 1 ) // Minimum Array Size is 2...
+                }
+                updateState<struct dbr_time_long>(
+                    a_args.dbr, state );
+                if ( state.m_int_val )
+                    active_state = true;
+                break;
+            case DBR_TIME_DOUBLE:
+                // Could be Scalar Numerical Value
+                // -OR- Variable Length Numerical Array...!
+                //    -> Therefore, Set *Both* Value Fields...! ;-D
+                state.m_double_val = (double)
+                    ((struct dbr_time_double *)a_args.dbr)->value;
+                state.m_elem_count = a_args.count;
+                if ( a_args.count > 1 ) // Minimum Array Size is 2...
+                {
+                    state.m_double_array = new double[a_args.count];
+                    double *values = (double *)
+                        &((struct dbr_time_double *)a_args.dbr)->value;
+                    for ( uint32_t i=0 ; i < a_args.count ; i++ )
                     {
-                        state.m_double_array = new double[a_args.count];
-                        double *values = (double *)
-                            &((struct dbr_time_double *)a_args.dbr)->value;
-                        for ( uint32_t i=0 ; i < a_args.count ; i++ )
-                        {
-                            state.m_double_array[i] = values[i];
-                        }
+                        state.m_double_array[i] = values[i];
                     }
-                    updateState<struct dbr_time_double>(
-                        a_args.dbr, state );
-                    if ( state.m_double_val )
-                        active_state = true;
-                    break;
-                default:
-                    break;
                 }
+                updateState<struct dbr_time_double>(
+                    a_args.dbr, state );
+                if ( state.m_double_val )
+                    active_state = true;
+                break;
+            default:
+                break;
+            }
 
-                // Set PV/Device Status as Needed from Value Update...
-                if ( ich->second.m_pv != NULL )
-                {
-                    // Always Save Active Status to PV Descriptor...
-                    // (This PV Could Become an Active Status PV... ;-D)
-                    ich->second.m_pv->m_is_active =
-                        ( active_state )
-                            ? DEVICE_IS_ACTIVE : DEVICE_IS_INACTIVE;
-
-                    // Set Device Active Status
-                    // If This PV is an Active Status PV...
-                    if ( ich->second.m_pv->m_is_active_pv )
-                    {
-                        std::string deviceStr = " *** NO DEVICE ***";
-                        if ( ich->second.m_device != NULL )
-                        {
-                            deviceStr = " Device ["
-                                + ich->second.m_device->m_name + "]";
-                        }
+            // Always Save Active Status to PV Descriptor...
+            // (This PV Could Become an Active Status PV... ;-D)
+            if ( a_info.m_pv != NULL )
+            {
+                a_info.m_pv->m_is_active =
+                    ( active_state ) ? DEVICE_IS_ACTIVE : DEVICE_IS_INACTIVE;
+            }
 
-                        std::string pvStr = "";
-                        if ( ich->second.m_pv != NULL )
-                        {
-                            pvStr = " from Active Status PV <"
-                                + ich->second.m_pv->m_name + "> ("
-                                + ich->second.m_pv->m_connection + ")";
-                        }
+            // Regular PV, Just Send the Update...
+            if ( a_info.m_pv == NULL || !a_info.m_pv->m_is_active_pv )
+            {
+                sendValueUpdate( a_info );
+                return;
+            }
 
-                        if ( ich->second.m_device != NULL )
-                        {
-                            // Only Set/Log if Active Status Changed...
-                            if ( ich->second.m_device->m_active
-                                    != active_state )
-                            {
-                                syslog( LOG_ERR,
-                                "%s %s: %s%s%s [%s = %u (%s) -> %u (%s)]",
-                                    "PVSD ERROR:",
-                                    "DeviceAgent::epicsEventHandler()",
-                                    "Setting Active Status for",
-                                    deviceStr.c_str(), pvStr.c_str(),
-                                    "active",
-                                    ich->second.m_device->m_active,
-                                    ( (ich->second.m_device->m_active)
-                                        ? "true" : "false" ),
-                                    active_state,
-                                    ( active_state ? "true" : "false" ) );
-                                usleep(33333); // give syslog a chance...
-
-                                ich->second.m_device->m_active =
-                                    active_state;
-                            }
+            // Setting Device Status is Device-Wide, Take m_mutex
+            // (Always Before the Channel Lock...)
+            chan_lock.unlock();
 
-                            // Setting Device Active, Send PV Values...
-                            if ( active_state )
-                            {
-                                sendCurrentValues();
-                            }
+            boost::lock_guard<boost::mutex> lock(m_mutex);
 
-                            // Device has Gone Inactive,
-                            // "Soft-Delete" Device
-                            // (i.e. Don't _Actually_ Delete It,
-                            // Just Pretend!)
-                            else
-                            {
-                                if ( m_dev_record.get() )
-                                {
-                                    m_stream_api.getCfgMgr()
-                                        .undefineDevice(
-                                            m_dev_record,
-                                            /* Don't Delete Device! */
-                                            false );
-                                }
-                                else
-                                {
-                                    syslog( LOG_ERR,
-                                        "%s %s: %s %s%s%s [%s = %u (%s)]",
-                                        "PVSD ERROR:",
-                                        "DeviceAgent::epicsEventHandler()",
-                                        "Couldn't Soft-Undefine",
-                                        "Now-Inactive",
-                                        deviceStr.c_str(), pvStr.c_str(),
-                                        "active", active_state,
-                                        ( active_state
-                                            ? "true" : "false" ) );
-                                    usleep(33333);
-                                    // give syslog a chance...
-                                }
-                            }
-                        }
-                        else
-                        {
-                            syslog( LOG_ERR,
-                                "%s %s: %s%s%s [%s = %u (%s)]",
-                                "PVSD ERROR:",
-                                "DeviceAgent::epicsEventHandler()",
-                                "FAILED to Set Active Status for",
-                                deviceStr.c_str(), pvStr.c_str(),
-                                "active", active_state,
-                                ( active_state ? "true" : "false" ) );
-                            usleep(33333); // give syslog a chance...
-                        }
+            // Set Device Active Status
+            // If This PV is (Still) an Active Status PV...
+            if ( a_info.m_pv != NULL && a_info.m_pv->m_is_active_pv )
+            {
+                std::string deviceStr = " *** NO DEVICE ***";
+                if ( a_info.m_device != NULL )
+                {
+                    deviceStr = " Device ["
+                        + a_info.m_device->m_name + "]";
+                }
 
-                        // Don't Send Variable Value Updates
-                        // for Active Status PVs...!
-                        // (Unless Active Status PV is Marked
-                        // to _Not_ Ignore, Because it Subsumed
-                        // a Regular Device PV...)
-                        if ( ich->second.m_pv->m_ignore )
-                            return;
-                    }
+                std::string pvStr = "";
+                if ( a_info.m_pv != NULL )
+                {
+                    pvStr = " from Active Status PV <"
+                        + a_info.m_pv->m_name + "> ("
+                        + a_info.m_pv->m_connection + ")";
                 }
 
-                // Send value/alarm data if device is fully defined
-                if ( m_defined )
+                if ( a_info.m_device != NULL )
                 {
-                    bool timeout;
-                    StreamPacket *pkt =
-                        m_stream_api.getFreePacket( 5000, timeout );
-                    if ( pkt )
+                    // Only Set/Log if Active Status Changed...
+                    if ( a_info.m_device->m_active
+                            != active_state )
                     {
-                        pkt->type = VariableUpdate;
-                        pkt->device = ich->second.m_device;
-                        pkt->pv = ich->second.m_pv;
-                        pkt->state = state;
+                        ASYNC_SYSLOG( LOG_ERR,
+                        "%s %s: %s%s%s [%s = %u (%s) -> %u (%s)]",
+                            "PVSD ERROR:",
+                            "DeviceAgent::epicsEventHandler()",
+                            "Setting Active Status for",
+                            deviceStr.c_str(), pvStr.c_str(),
+                            "active",
+                            a_info.m_device->m_active,
+                            ( (a_info.m_device->m_active)
+                                ? "true" : "false" ),
+                            active_state,
+                            ( active_state ? "true" : "false" ) );
+
+                        a_info.m_device->m_active =
+                            active_state;
+                    }
 
-                        m_stream_api.putFilledPacket( pkt );
+                    // Setting Device Active, Send PV Values...
+                    if ( active_state )
+                    {
+                        sendCurrentValues();
                     }
+
+                    // Device has Gone Inactive,
+                    // "Soft-Delete" Device
+                    // (i.e. Don't _Actually_ Delete It,
+                    // Just Pretend!)
                     else
                     {
-                        std::string deviceStr = "";
-                        if ( ich->second.m_device != NULL )
-                        {
-                            deviceStr = " Device ["
-                                + ich->second.m_device->m_name + "]";
-                        }
-
-                        std::string pvStr = "";
-                        if ( ich->second.m_pv != NULL )
-                        {
-                            pvStr = " for PV <"
-                                + ich->second.m_pv->m_name + "> ("
-                                + ich->second.m_pv->m_connection + ")";
-                        }
-
-                        if ( m_stream_api.getFreeQueueActive() )
+                        if ( m_dev_record.get() )
                         {
-                            syslog( LOG_ERR, "%s %s: %s %s%s [%s = %lu]",
-                                "PVSD ERROR:",
-                                "DeviceAgent::epicsEventHandler()",
-                                "No Free Packets! VariableUpdate Lost",
-                                deviceStr.c_str(), pvStr.c_str(),
-                                "Filled Queue Size",
-                                (unsigned long)
-                                    m_stream_api.getFilledQueueSize() );
-                            usleep(33333); // give syslog a chance...
+                            m_stream_api.getCfgMgr()
+                                .undefineDevice(
+                                    m_dev_record,
+                                    /* Don't Delete Device! */
+                                    false );
                         }
                         else
                         {
-                            syslog( LOG_ERR, "%s %s: %s%s%s",
+                            ASYNC_SYSLOG( LOG_ERR,
+                                "%s %s: %s %s%s%s [%s = %u (%s)]",
                                 "PVSD ERROR:",
                                 "DeviceAgent::epicsEventHandler()",
-                                "Queue Deactivated, Ignore VariableUpdate",
-                                deviceStr.c_str(), pvStr.c_str() );
-                            usleep(33333); // give syslog a chance...
+                                "Couldn't Soft-Undefine",
+                                "Now-Inactive",
+                                deviceStr.c_str(), pvStr.c_str(),
+                                "active", active_state,
+                                ( active_state
+                                    ? "true" : "false" ) );
                         }
                     }
                 }
-
-                // Device Not Yet Defined, Ignoring Value Update...!
                 else
                 {
-                    std::string deviceStr = "";
-                    if ( ich->second.m_device != NULL )
-                    {
-                        deviceStr = " Device ["
-                            + ich->second.m_device->m_name + "]";
-                    }
-
-                    std::string pvStr = "";
-                    if ( ich->second.m_pv != NULL )
-                    {
-                        pvStr = " for PV <"
-                            + ich->second.m_pv->m_name + "> ("
-                            + ich->second.m_pv->m_connection + ")";
-                    }
-
-                    syslog( LOG_ERR, "%s %s: %s%s%s",
+                    ASYNC_SYSLOG( LOG_ERR,
+                        "%s %s: %s%s%s [%s = %u (%s)]",
                         "PVSD ERROR:",
                         "DeviceAgent::epicsEventHandler()",
-                        "Device Not Yet Defined, Ignore VariableUpdate",
-                        deviceStr.c_str(), pvStr.c_str() );
-                    usleep(33333); // give syslog a chance...
+                        "FAILED to Set Active Status for",
+                        deviceStr.c_str(), pvStr.c_str(),
+                        "active", active_state,
+                        ( active_state ? "true" : "false" ) );
                 }
-            }
 
-            // Invalid EPICS Channel/Not Found...!
-            else
-            {
-                 syslog( LOG_ERR, "%s %s: %s Unknown Channel Id...",
-                    "PVSD ERROR:",
-                    "DeviceAgent::epicsEventHandler()",
-                    "Error Looking Up EPICS Data Event, " );
-                usleep(33333); // give syslog a chance...
+                // Don't Send Variable Value Updates
+                // for Active Status PVs...!
+                // (Unless Active Status PV is Marked
+                // to _Not_ Ignore, Because it Subsumed
+                // a Regular Device PV...)
+                if ( a_info.m_pv->m_ignore )
+                    return;
             }
+
+            chan_lock.lock();
+
+            sendValueUpdate( a_info );
         }
         // Metadata event?
         else if ( epicsIsCtrlRecordType( a_args.type ) )
         {
             boost::lock_guard<boost::mutex> lock(m_mutex);
 
-            // Valid EPICS channel?
-            map<chid,ChanInfo>::iterator ich = m_chan_info.find( a_args.chid );
-            if ( ich != m_chan_info.end() )
+            // Note EPICS does not define ctrl structs (or units) for string types
+            // Extract units and/or enumeration values
+            switch ( a_args.type )
             {
-                // Note EPICS does not define ctrl structs (or units) for string types
-                // Extract units and/or enumeration values
-                switch ( a_args.type )
-                {
-                case DBR_CTRL_SHORT:
-                    ich->second.m_ca_units = ((struct dbr_ctrl_short *)a_args.dbr)->units;
-                    break;
-                case DBR_CTRL_FLOAT:
-                    ich->second.m_ca_units = ((struct dbr_ctrl_float *)a_args.dbr)->units;
-                    break;
-                case DBR_CTRL_CHAR:
-                    ich->second.m_ca_units = ((struct dbr_ctrl_char *)a_args.dbr)->units;
-                    break;
-                case DBR_CTRL_LONG:
-                    ich->second.m_ca_units = ((struct dbr_ctrl_long *)a_args.dbr)->units;
-                    break;
-                case DBR_CTRL_DOUBLE:
-                    ich->second.m_ca_units = ((struct dbr_ctrl_double *)a_args.dbr)->units;
-                    break;
-                case DBR_CTRL_ENUM:
-                    {
-                    ich->second.m_ca_enum_vals.clear();
-                    for ( int i = 0; i < ((struct dbr_ctrl_enum *)a_args.dbr)->no_str; ++i )
-                        ich->second.m_ca_enum_vals[i] = ((struct dbr_ctrl_enum *)a_args.dbr)->strs[i];
-                    break;
-                    }
-                default:
-                    break;
-                }
-
-                // Bump state to INFO_AVAILABLE if it was pending
-                if ( ich->second.m_chan_state == INFO_PENDING )
+            case DBR_CTRL_SHORT:
+                a_info.m_ca_units = ((struct dbr_ctrl_short *)a_args.dbr)->units;
+                break;
+            case DBR_CTRL_FLOAT:
+                a_info.m_ca_units = ((struct dbr_ctrl_float *)a_args.dbr)->units;
+                break;
+            case DBR_CTRL_CHAR:
+                a_info.m_ca_units = ((struct dbr_ctrl_char *)a_args.dbr)->units;
+                break;
+            case DBR_CTRL_LONG:
+                a_info.m_ca_units = ((struct dbr_ctrl_long *)a_args.dbr)->units;
+                break;
+            case DBR_CTRL_DOUBLE:
+                a_info.m_ca_units = ((struct dbr_ctrl_double *)a_args.dbr)->units;
+                break;
+            case DBR_CTRL_ENUM:
                 {
-                    ich->second.m_chan_state = INFO_AVAILABLE;
-                    // Wake state machine
-                    m_state_changed = true;
-                    m_state_cond.notify_one();
+                a_info.m_ca_enum_vals.clear();
+                for ( int i = 0; i < ((struct dbr_ctrl_enum *)a_args.dbr)->no_str; ++i )
+                    a_info.m_ca_enum_vals[i] = ((struct dbr_ctrl_enum *)a_args.dbr)->strs[i];
+                break;
                 }
+            default:
+                break;
             }
 
-            // Invalid EPICS Channel/Not Found...!
-            else
+            // Bump state to INFO_AVAILABLE if it was pending
+            if ( a_info.m_chan_state == INFO_PENDING )
             {
-                 syslog( LOG_ERR, "%s %s: %s Unknown Channel Id...",
-                    "PVSD ERROR:",
-                    "DeviceAgent::epicsEventHandler()",
-                    "Error Looking Up EPICS Metadata Event, " );
-                usleep(33333); // give syslog a chance...
+                a_info.m_chan_state = INFO_AVAILABLE;
+                // Wake state machine
+                m_state_changed = true;
+                m_state_cond.notify_one();
             }
         }
     }
     catch( TraceException &e )
     {
-        syslog( LOG_ERR, "%s %s: TraceException!",
+        ASYNC_SYSLOG( LOG_ERR, "%s %s: TraceException!",
             "PVSD ERROR:", "DeviceAgent::epicsEventHandler()" );
-        syslog( LOG_ERR, e.toString().c_str() );
+        ASYNC_SYSLOG( LOG_ERR, e.toString().c_str() );
     }
     catch( std::exception &e )
     {
-        syslog( LOG_ERR, "%s %s: Exception!",
+        ASYNC_SYSLOG( LOG_ERR, "%s %s: Exception!",
             "PVSD ERROR:", "DeviceAgent::epicsEventHandler()" );
-        syslog( LOG_ERR, e.what() );
+        ASYNC_SYSLOG( LOG_ERR, e.what() );
     }
     catch(...)
     {
-        syslog( LOG_ERR, "%s %s: Unknown exception!",
+        ASYNC_SYSLOG( LOG_ERR, "%s %s: Unknown exception!",
             "PVSD ERROR:", "DeviceAgent::epicsEventHandler()" );
     }
 }
@@ -2161,83 +2060,351 @@ DeviceAgent::epicsEventHandler( struct event_handler_args a_args )
 
 /**
  * @brief Send current PV values for all channels
+ *
+ * Called with m_mutex held; takes each channel's lock in turn.
  */
 void
 DeviceAgent::sendCurrentValues()
 {
-    for ( map<chid,ChanInfo>::iterator ich = m_chan_info.begin();
+    for ( map<chid,ChanInfo*>::iterator ich = m_chan_info.begin();
             ich != m_chan_info.end(); ++ich )
     {
-        std::string deviceStr = "";
-        if ( ich->second.m_device != NULL )
-        {
-            deviceStr = " Device ["
-                + ich->second.m_device->m_name + "]";
-        }
+        ChanInfo &info = *ich->second;
 
-        std::string pvStr = "";
-        if ( ich->second.m_pv != NULL )
-        {
-            pvStr = " for PV <"
-                + ich->second.m_pv->m_name + "> ("
-                + ich->second.m_pv->m_connection + ")";
-        }
+        boost::lock_guard<boost::mutex> chan_lock( *info.m_lock );
 
         // Don't Send Variable Value Updates for Active Status PVs...!
-        if ( ich->second.m_pv != NULL
-                && ich->second.m_pv->m_is_active_pv
-                && ich->second.m_pv->m_ignore )
+        if ( info.m_pv != NULL
+                && info.m_pv->m_is_active_pv
+                && info.m_pv->m_ignore )
         {
-            syslog( LOG_INFO, "%s: %s%s%s",
+            ASYNC_SYSLOG( LOG_INFO, "%s: %s%s%s",
                 "DeviceAgent::sendCurrentValues()",
                 "Don't Send Active Status PV State for",
-                deviceStr.c_str(), pvStr.c_str() );
-            usleep(33333); // give syslog a chance...
+                deviceLabel( info, " Device [" ).c_str(),
+                pvLabel( info, " for PV <" ).c_str() );
 
             continue;
         }
 
-        bool timeout;
-        StreamPacket *pkt = m_stream_api.getFreePacket( 5000, timeout );
-        if ( pkt )
+        if ( sendUpdate( info, "DeviceAgent::sendCurrentValues()" ) )
+            noteSent( info, monotonicTime() );
+    }
+}
+
+
+/**
+ * @brief Sends a channel's current state as a variable update
+ * @param a_info - Channel to send
+ * @param a_method - Caller, for logging
+ * @return True if the update was queued
+ */
+bool
+DeviceAgent::sendUpdate( ChanInfo &a_info, const char *a_method )
+{
+    bool timeout;
+    StreamPacket *pkt = m_stream_api.getFreePacket( 5000, timeout );
+    if ( pkt )
+    {
+        pkt->type = VariableUpdate;
+        pkt->device = a_info.m_device;
+        pkt->pv = a_info.m_pv;
+        pkt->state = a_info.m_pv_state;
+
+        m_stream_api.putFilledPacket( pkt );
+        return true;
+    }
+
+    if ( m_stream_api.getFreeQueueActive() )
+    {
+        ASYNC_SYSLOG( LOG_ERR, "%s %s: %s %s%s [%s = %lu]",
+            "PVSD ERROR:", a_method,
+            "No Free Packets! VariableUpdate Lost",
+            deviceLabel( a_info, " Device [" ).c_str(),
+            pvLabel( a_info, " for PV <" ).c_str(),
+            "Filled Queue Size",
+            (unsigned long) m_stream_api.getFilledQueueSize() );
+    }
+    else
+    {
+        ASYNC_SYSLOG( LOG_ERR, "%s %s: %s%s%s",
+            "PVSD ERROR:", a_method,
+            "Queue Deactivated, Ignore VariableUpdate",
+            deviceLabel( a_info, " Device [" ).c_str(),
+            pvLabel( a_info, " for PV <" ).c_str() );
+    }
+
+    return false;
+}
+
+
+/**
+ * @brief Sends a channel's new value, if the device is defined
+ * @param a_info - Channel just updated (its lock held)
+ *
+ * Applies the PV's deadband and max rate (see filterUpdate()).
+ */
+void
+DeviceAgent::sendValueUpdate( ChanInfo &a_info )
+{
+    // Send value/alarm data if device is fully defined
+    // (and the PV's deadband/max rate let it through)
+    if ( m_defined )
+    {
+        double now = monotonicTime();
+
+        if ( filterUpdate( a_info, now ) == FILTER_SEND
+                && sendUpdate( a_info, "DeviceAgent::epicsEventHandler()" ) )
         {
-            pkt->type = VariableUpdate;
-            pkt->device = ich->second.m_device;
-            pkt->pv = ich->second.m_pv;
-            pkt->state = ich->second.m_pv_state;
-
-            //syslog( LOG_DEBUG, "%s: %s%s%s %s=%u %s=%u",
-                //"DeviceAgent::sendCurrentValues()",
-                //"Sending PV State for",
-                //deviceStr.c_str(), pvStr.c_str(),
-                //"status", ich->second.m_pv_state.m_status,
-                //"severity", ich->second.m_pv_state.m_severity );
-            //usleep(33333); // give syslog a chance...
-
-            m_stream_api.putFilledPacket( pkt );
+            noteSent( a_info, now );
         }
-        else
+    }
+
+    // Device Not Yet Defined, Ignoring Value Update...!
+    else
+    {
+        ASYNC_SYSLOG( LOG_ERR, "%s %s: %s%s%s",
+            "PVSD ERROR:",
+            "DeviceAgent::epicsEventHandler()",
+            "Device Not Yet Defined, Ignore VariableUpdate",
+            deviceLabel( a_info, " Device [" ).c_str(),
+            pvLabel( a_info, " for PV <" ).c_str() );
+    }
+}
+
+
+/**
+ * @brief Formats a channel's device name for logging
+ * @param a_info - Channel
+ * @param a_prefix - Text before the name, up to the "["
+ * @return Label, or empty if the channel has no device record
+ *
+ * Only call these where the message is actually logged, to keep
+ * string building off the value update path.
+ */
+std::string
+DeviceAgent::deviceLabel( const ChanInfo &a_info, const char *a_prefix )
+{
+    if ( a_info.m_device == NULL )
+        return std::string();
+
+    return a_prefix + a_info.m_device->m_name + "]";
+}
+
+
+/**
+ * @brief Formats a channel's PV name and connection for logging
+ * @param a_info - Channel
+ * @param a_prefix - Text before the name, up to the "<"
+ * @return Label, or empty if the channel has no PV
+ */
+std::string
+DeviceAgent::pvLabel( const ChanInfo &a_info, const char *a_prefix )
+{
+    if ( a_info.m_pv == NULL )
+        return std::string();
+
+    return a_prefix + a_info.m_pv->m_name + "> ("
+        + a_info.m_pv->m_connection + ")";
+}
+
+
+/**
+ * @brief Gets a channel's value as a double, for deadband checks
+ * @param a_ca_type - Native EPICS type of the channel
+ * @param a_state - State holding the value
+ * @param a_value - Output value
+ * @return False for strings, enums, chars and arrays (no deadband)
+ */
+static bool
+scalarValue( unsigned long a_ca_type, const PVState &a_state,
+        double &a_value )
+{
+    if ( a_state.m_elem_count > 1 )
+        return false;
+
+    switch ( a_ca_type )
+    {
+    case DBR_SHORT:
+    case DBR_LONG:
+        a_value = a_state.m_int_val;
+        return true;
+    case DBR_FLOAT:
+    case DBR_DOUBLE:
+        a_value = a_state.m_double_val;
+        return true;
+    default:
+        return false;
+    }
+}
+
+
+/**
+ * @brief Applies a PV's deadband and max rate to a new value update
+ * @param a_info - Channel whose m_pv_state was just updated
+ * @param a_now - Monotonic time of the update
+ * @return Whether to send the update now, drop it, or hold it
+ *
+ * The first update (and the first after a reconnect) and any change of
+ * alarm status or severity are always sent right away. Otherwise a
+ * scalar numeric value that changed by no more than the absolute or
+ * relative deadband from the last value sent is dropped. An update
+ * arriving sooner than 1/max_rate after the last one sent is held; the
+ * newest held value wins, and is sent by the monitor thread (or by the
+ * next update) once the interval is up. Every update is still kept in
+ * m_pv_state, so sendCurrentValues() always sends the latest value.
+ */
+DeviceAgent::FilterAction
+DeviceAgent::filterUpdate( ChanInfo &a_info, double a_now )
+{
+    if ( a_info.m_pv == NULL || !a_info.m_pv->m_filter.active() )
+        return FILTER_SEND;
+
+    const PVFilter &filter = a_info.m_pv->m_filter;
+    const PVState &state = a_info.m_pv_state;
+
+    a_info.m_updates++;
+
+    if ( !a_info.m_sent
+            || state.m_status != a_info.m_sent_status
+            || state.m_severity != a_info.m_sent_severity )
+    {
+        return FILTER_SEND;
+    }
+
+    double value;
+    if ( ( filter.m_deadband > 0.0 || filter.m_deadband_rel > 0.0 )
+            && scalarValue( a_info.m_ca_type, state, value ) )
+    {
+        double delta = fabs( value - a_info.m_sent_value );
+        if ( delta <= filter.m_deadband
+                || delta <= filter.m_deadband_rel
+                    * fabs( a_info.m_sent_value ) )
         {
-            if ( m_stream_api.getFreeQueueActive() )
-            {
-                syslog( LOG_ERR, "%s %s: %s%s%s [%s = %lu]",
-                    "PVSD ERROR:", "DeviceAgent::sendCurrentValues()",
-                    "No Free Packets! VariableUpdate Lost for",
-                    deviceStr.c_str(), pvStr.c_str(),
-                    "Filled Queue Size",
-                    (unsigned long) m_stream_api.getFilledQueueSize() );
-                usleep(33333); // give syslog a chance...
-            }
-            else
+            // Back within the deadband, any held value is moot
+            if ( a_info.m_held )
             {
-                syslog( LOG_ERR, "%s %s: %s%s%s",
-                    "PVSD ERROR:", "DeviceAgent::sendCurrentValues()",
-                    "Queue Deactivated, Ignore VariableUpdate for",
-                    deviceStr.c_str(), pvStr.c_str() );
-                usleep(33333); // give syslog a chance...
+                a_info.m_held = false;
+                a_info.m_coalesced++;
             }
+
+            a_info.m_deadband_drops++;
+            return FILTER_DROP;
         }
     }
+
+    if ( filter.m_max_rate > 0.0
+            && a_now - a_info.m_sent_time < 1.0 / filter.m_max_rate )
+    {
+        // Last value wins
+        if ( a_info.m_held )
+            a_info.m_coalesced++;
+
+        a_info.m_held = true;
+        return FILTER_HOLD;
+    }
+
+    return FILTER_SEND;
+}
+
+
+/**
+ * @brief Records a channel's state as sent, for later filtering
+ * @param a_info - Channel just sent
+ * @param a_now - Monotonic time it was sent
+ */
+void
+DeviceAgent::noteSent( ChanInfo &a_info, double a_now )
+{
+    const PVState &state = a_info.m_pv_state;
+
+    a_info.m_sent = true;
+    a_info.m_held = false;
+    a_info.m_sent_time = a_now;
+    a_info.m_sent_status = state.m_status;
+    a_info.m_sent_severity = state.m_severity;
+
+    if ( !scalarValue( a_info.m_ca_type, state, a_info.m_sent_value ) )
+        a_info.m_sent_value = 0.0;
+}
+
+
+/**
+ * @brief Sends rate limited updates whose interval has passed
+ * @return True if any of the device's PVs has a max rate
+ *
+ * Called periodically from the monitor thread with m_mutex held;
+ * takes each channel's lock in turn.
+ */
+bool
+DeviceAgent::sendHeldUpdates()
+{
+    bool rate_limited = false;
+    double now = monotonicTime();
+
+    for ( map<chid,ChanInfo*>::iterator ich = m_chan_info.begin();
+            ich != m_chan_info.end(); ++ich )
+    {
+        ChanInfo &info = *ich->second;
+
+        boost::lock_guard<boost::mutex> chan_lock( *info.m_lock );
+
+        if ( info.m_pv == NULL || !( info.m_pv->m_filter.m_max_rate > 0.0 ) )
+            continue;
+
+        rate_limited = true;
+
+        if ( !info.m_held || !m_defined
+                || now - info.m_sent_time
+                    < 1.0 / info.m_pv->m_filter.m_max_rate )
+        {
+            continue;
+        }
+
+        if ( sendUpdate( info, "DeviceAgent::sendHeldUpdates()" ) )
+            noteSent( info, now );
+        else
+            info.m_held = false;
+    }
+
+    return rate_limited;
+}
+
+
+/**
+ * @brief Logs a filtered channel's suppressed update counts
+ * @param a_info - Channel to log
+ *
+ * Only logs when something was suppressed since the last time.
+ * Takes the channel's lock.
+ */
+void
+DeviceAgent::logFilterCounts( ChanInfo &a_info )
+{
+    boost::lock_guard<boost::mutex> chan_lock( *a_info.m_lock );
+
+    uint64_t suppressed = a_info.m_deadband_drops + a_info.m_coalesced;
+
+    if ( a_info.m_pv == NULL || suppressed == a_info.m_reported )
+        return;
+
+    std::string deviceStr = "";
+    if ( a_info.m_pv->m_device != NULL )
+    {
+        deviceStr = "Device [" + a_info.m_pv->m_device->m_name + "] - ";
+    }
+
+    ASYNC_SYSLOG( LOG_INFO,
+        "%s: %sPV <%s> (%s): %s=%llu %s=%llu %s=%llu %s=%llu",
+        "DeviceAgent::logFilterCounts()", deviceStr.c_str(),
+        a_info.m_pv->m_name.c_str(), a_info.m_pv->m_connection.c_str(),
+        "updates", (unsigned long long) a_info.m_updates,
+        "deadband_drops", (unsigned long long) a_info.m_deadband_drops,
+        "coalesced", (unsigned long long) a_info.m_coalesced,
+        "passed", (unsigned long long)
+            ( a_info.m_updates - suppressed ) );
+
+    a_info.m_reported = suppressed;
 }
 
 
@@ -2249,10 +2416,10 @@ void
 DeviceAgent::epicsConnectionCallback(
         struct connection_handler_args a_args )
 {
-    DeviceAgent *agent = (DeviceAgent*)ca_puser( a_args.chid );
+    ChanInfo *info = (ChanInfo *)ca_puser( a_args.chid );
 
-    if ( agent )
-        agent->epicsConnectionHandler( a_args );
+    if ( info )
+        info->m_agent->epicsConnectionHandler( *info, a_args );
 }
 
 
@@ -2263,10 +2430,10 @@ DeviceAgent::epicsConnectionCallback(
 void
 DeviceAgent::epicsEventCallback( struct event_handler_args a_args )
 {
-    DeviceAgent *agent = (DeviceAgent *)ca_puser( a_args.chid );
+    ChanInfo *info = (ChanInfo *)ca_puser( a_args.chid );
 
-    if ( agent )
-        agent->epicsEventHandler( a_args );
+    if ( info )
+        info->m_agent->epicsEventHandler( *info, a_args );
 }
 
 
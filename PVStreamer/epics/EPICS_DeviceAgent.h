@@ -58,13 +58,38 @@ private:
         READY
     };
 
+    /// What to do with a value update, per the PV's PVFilter
+    enum FilterAction
+    {
+        FILTER_SEND,
+        FILTER_DROP,    ///< Within the deadband of the last value sent
+        FILTER_HOLD     ///< Over the max rate, sent later if not replaced
+    };
+
+    /// Number of channel locks shared out among an agent's channels
+    enum { CHAN_LOCK_SHARDS = 16 };
+
+    /** \brief Per-channel state, the CA user pointer of its channel
+      *
+      * m_device, m_pv, m_pv_state and the update filtering fields are
+      * guarded by m_lock (one of the agent's m_chan_locks), so value
+      * updates don't need the agent-wide m_mutex; writers of m_device
+      * and m_pv hold both. Everything else is guarded by m_mutex. When
+      * both are needed, m_mutex is taken first.
+      */
     struct ChanInfo
     {
-        ChanInfo() : m_pv(0), m_chid(0), m_evid(0),
+        ChanInfo() : m_agent(0), m_lock(0), m_pv(0), m_chid(0), m_evid(0),
             m_chan_state(UNINITIALIZED), m_connected(false),
-            m_subscribed(false)
+            m_subscribed(false), m_sent(false), m_held(false),
+            m_sent_value(0.0), m_sent_time(0.0),
+            m_sent_status(0), m_sent_severity(0),
+            m_updates(0), m_deadband_drops(0), m_coalesced(0),
+            m_reported(0)
         {}
 
+        DeviceAgent                    *m_agent;
+        boost::mutex                   *m_lock;
         DeviceRecordPtr                 m_device;
         PVDescriptor                   *m_pv;
         chid                            m_chid;
@@ -77,6 +102,18 @@ private:
         unsigned long                   m_ca_elem_count;
         std::string                     m_ca_units;
         std::map<int32_t,std::string>   m_ca_enum_vals;
+
+        // Update filtering (see filterUpdate())
+        bool                            m_sent;             ///< m_sent_* are valid
+        bool                            m_held;             ///< m_pv_state held back by max rate
+        double                          m_sent_value;       ///< Last scalar value sent
+        double                          m_sent_time;        ///< When it was sent (monotonic secs)
+        int16_t                         m_sent_status;
+        int16_t                         m_sent_severity;
+        uint64_t                        m_updates;          ///< Updates seen on a filtered PV
+        uint64_t                        m_deadband_drops;   ///< Updates dropped by deadband
+        uint64_t                        m_coalesced;        ///< Held updates replaced before sending
+        uint64_t                        m_reported;         ///< Drops + coalesced when last logged
     };
 
 
@@ -87,9 +124,16 @@ private:
     void        controlThread();
     void        monitorThread();
     void        sendCurrentValues();
-    void        epicsConnectionHandler(
+    bool        sendUpdate( ChanInfo &a_info, const char *a_method );
+    FilterAction filterUpdate( ChanInfo &a_info, double a_now );
+    void        noteSent( ChanInfo &a_info, double a_now );
+    bool        sendHeldUpdates();
+    void        logFilterCounts( ChanInfo &a_info );
+    void        epicsConnectionHandler( ChanInfo &a_info,
                     struct connection_handler_args a_args );
-    void        epicsEventHandler( struct event_handler_args a_args );
+    void        epicsEventHandler( ChanInfo &a_info,
+                    struct event_handler_args a_args );
+    void        sendValueUpdate( ChanInfo &a_info );
     PVType      epicsToPVType( uint32_t a_rec_type, uint32_t a_elem_count );
     int32_t     epicsToTimeRecordType( uint32_t a_rec_type );
     int32_t     epicsToCtrlRecordType( uint32_t a_rec_type );
@@ -98,6 +142,10 @@ private:
     template<typename T>
     void        updateState( const void *a_src, PVState &a_state );
 
+    static std::string deviceLabel( const ChanInfo &a_info,
+                    const char *a_prefix );
+    static std::string pvLabel( const ChanInfo &a_info,
+                    const char *a_prefix );
     static void epicsConnectionCallback(
                     struct connection_handler_args a_args );
     static void epicsEventCallback( struct event_handler_args a_args );
@@ -105,12 +153,14 @@ private:
     IInputAdapterAPI           &m_stream_api;       ///< Streaming API provided by StreamService
     DeviceRecordPtr             m_dev_record;
     DeviceDescriptor           *m_dev_desc;
-    bool                        m_defined;
+    volatile bool               m_defined;          ///< Also read by value updates without m_mutex
     bool                        m_hung;
-    std::map<chid,ChanInfo>     m_chan_info;        ///< PV channel ID to channel info map
+    std::map<chid,ChanInfo*>    m_chan_info;        ///< PV channel ID to channel info map (owned)
     std::map<std::string,chid>  m_pv_index;         ///< PV connection to channel id map
     boost::thread              *m_ctrl_thread;
     boost::mutex                m_mutex;
+    boost::mutex                m_chan_locks[CHAN_LOCK_SHARDS];
+    uint32_t                    m_next_chan_lock;   ///< Round robin over m_chan_locks
     boost::condition_variable   m_state_cond;
     bool                        m_state_changed;
     bool                        m_agent_active;
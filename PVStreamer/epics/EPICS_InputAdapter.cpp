@@ -1,12 +1,15 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <stdlib.h>
+#include <math.h>
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/path.hpp>
 #include <boost/system/error_code.hpp>
 #include <boost/algorithm/string.hpp>
 #include <cadef.h>
 #include <syslog.h>
+#include "AsyncLog.h"
 
 #include "TraceException.h"
 #include "ConfigManager.h"
@@ -28,7 +31,7 @@ void ca_exception_handler( struct exception_handler_args args )
 {
     const char *pName = ( args.chid ) ? ca_name( args.chid ) : "(Unknown)";
 
-    syslog( LOG_ERR,
+    ASYNC_SYSLOG( LOG_ERR,
         "%s %s: %s! %s=[%s] - %s %s=[%s] %s=%ld %s=%ld %s=[%s] %s=%ld [%s]",
         "PVSD ERROR:", "EPICSInputAdapter::ca_exception_handler()",
         "Caught EPICS Exception", "Context", args.ctx,
@@ -36,7 +39,6 @@ void ca_exception_handler( struct exception_handler_args args )
         "Stat", args.stat, "Operation", args.op,
         "DataType", dbr_type_to_text( args.type ), "Count", args.count,
         "Continuing...!" );
-    usleep(33333); // give syslog a chance...
 }
 
 /** \brief EPICS::InputAdapter constructor
@@ -166,19 +168,17 @@ InputAdapter::startDevice( DeviceDescriptor *a_device )
 
     if ( idev != m_dev_agents.end() )
     {
-        syslog( LOG_DEBUG, "%s: Updating Device Agent for [%s]",
+        ASYNC_SYSLOG( LOG_DEBUG, "%s: Updating Device Agent for [%s]",
             "InputAdapter::startDevice()",
             a_device->m_name.c_str() );
-        usleep(33333); // give syslog a chance...
 
         idev->second->update( a_device );
     }
     else
     {
-        syslog( LOG_DEBUG, "%s: Starting New Device Agent for [%s]",
+        ASYNC_SYSLOG( LOG_DEBUG, "%s: Starting New Device Agent for [%s]",
             "InputAdapter::startDevice()",
             a_device->m_name.c_str() );
-        usleep(33333); // give syslog a chance...
 
         m_dev_agents[a_device->m_name] =
             new DeviceAgent( *m_stream_api, a_device, m_epics_context,
@@ -202,10 +202,9 @@ InputAdapter::stopDevice( const std::string &a_dev_name )
 
     if ( idev != m_dev_agents.end())
     {
-        syslog( LOG_DEBUG, "%s: Stopping old device agent (%s) for [%s]",
+        ASYNC_SYSLOG( LOG_DEBUG, "%s: Stopping old device agent (%s) for [%s]",
             "InputAdapter::stopDevice()", "device no longer defined",
             a_dev_name.c_str() );
-        usleep(33333); // give syslog a chance...
 
         idev->second->stop();
         m_garbage.push_back( idev->second );
@@ -213,11 +212,10 @@ InputAdapter::stopDevice( const std::string &a_dev_name )
     }
     else
     {
-        syslog( LOG_ERR,
+        ASYNC_SYSLOG( LOG_ERR,
             "%s %s: Error Stopping Device Agent: [%s] Not Found!",
             "PVSD ERROR:", "InputAdapter::stopDevice()",
             a_dev_name.c_str() );
-        usleep(33333); // give syslog a chance...
     }
 }
 
@@ -360,11 +358,10 @@ InputAdapter::configFileMonitorThread()
 
                     if ( changed )
                     {
-                        syslog( LOG_INFO,
+                        ASYNC_SYSLOG( LOG_INFO,
                             "%s: EPICS Beam Config File %s has Changed",
                             "InputAdapter::configFileMonitorThread():",
                             m_config_file.c_str() );
-                        usleep(33333); // give syslog a chance...
 
                         boost::lock_guard<boost::recursive_mutex>
                             lock(m_mutex);
@@ -380,10 +377,9 @@ InputAdapter::configFileMonitorThread()
                             devices, inactive_device_ids ) )
                         {
                             // Parsed successfully
-                            syslog( LOG_INFO,
+                            ASYNC_SYSLOG( LOG_INFO,
                                 "%s: EPICS Beam Config File Parse OK",
                                 "InputAdapter::configFileMonitorThread():");
-                            usleep(33333); // give syslog a chance...
 
                             // Keep track of new device names
                             set<string> new_device_names;
@@ -431,13 +427,12 @@ InputAdapter::configFileMonitorThread()
 
                                 if ( !found )
                                 {
-                                    syslog( LOG_ERR, "%s %s::%s: %s %d %s",
+                                    ASYNC_SYSLOG( LOG_ERR, "%s %s::%s: %s %d %s",
                                         "PVSD ERROR:",
                                         "InputAdapter",
                                         "configFileMonitorThread()",
                                         "Inactive Device ID", *iid,
                                         "Not Found!");
-                                    usleep(33333); // give syslog a chance
                                 }
                             }
 
@@ -475,8 +470,7 @@ InputAdapter::configFileMonitorThread()
                                 << " EPICS Beam Config File!"
                                 << " [" << m_config_file << "]";
 
-                            syslog( LOG_ERR, "%s", ss.str().c_str() );
-                            usleep(33333); // give syslog a chance...
+                            ASYNC_SYSLOG( LOG_ERR, "%s", ss.str().c_str() );
 
                             ADARA::ComBus::SignalAssertMessage msg(
                                 "SID_EPICS_CFG_ERROR", "CONFIG", ss.str(),
@@ -498,7 +492,7 @@ InputAdapter::configFileMonitorThread()
                 << " [" << m_config_file << "]"
                 << " [" << e.what() << "]";
 
-            syslog( LOG_ERR, "%s", ss.str().c_str() );
+            ASYNC_SYSLOG( LOG_ERR, "%s", ss.str().c_str() );
 
             ADARA::ComBus::SignalAssertMessage msg(
                 "SID_EPICS_CFG_ERROR", "CONFIG", ss.str(), ADARA::ERROR );
@@ -513,7 +507,7 @@ InputAdapter::configFileMonitorThread()
                 << " EPICS Beam Config File!"
                 << " [" << m_config_file << "]";
 
-            syslog( LOG_ERR, "%s", ss.str().c_str() );
+            ASYNC_SYSLOG( LOG_ERR, "%s", ss.str().c_str() );
 
             ADARA::ComBus::SignalAssertMessage msg(
                 "SID_EPICS_CFG_ERROR", "CONFIG", ss.str(), ADARA::ERROR );
@@ -553,6 +547,9 @@ InputAdapter::parseConfigBuffer( const char* a_buffer, int a_buffer_size,
                     <alias>pv_active</alias>    [used as name if defined; otherwise connection is name]
                     <log/>                      [only PVs with log tag are used]
                     <scan/>                     [not used]
+                    <deadband>0.5</deadband>    [optional; drop updates changing the value by no more than this]
+                    <deadband_rel>0.01</deadband_rel> [optional; same, as a fraction of the last value sent]
+                    <max_rate>10</max_rate>     [optional; most updates per second, newest value wins]
                 </pv>
             </device>
         </devices>
@@ -583,6 +580,7 @@ InputAdapter::parseConfigBuffer( const char* a_buffer, int a_buffer_size,
             string  pv_conn;
             string  active_pv_conn;
             vector<pair<string,string> > pvs;
+            vector<PVFilter> pv_filters; // parallel to pvs
 
             // Skip to beamline section
             beam_node = xmlDocGetRootElement(doc);
@@ -626,6 +624,7 @@ InputAdapter::parseConfigBuffer( const char* a_buffer, int a_buffer_size,
 
                                     dev_name.clear();
                                     pvs.clear();
+                                    pv_filters.clear();
 
                                     for ( xmlNode *cnode = node->children;
                                         cnode; cnode = cnode->next )
@@ -655,7 +654,7 @@ InputAdapter::parseConfigBuffer( const char* a_buffer, int a_buffer_size,
                                                     << "parseConfigBuffer()"
                                                     << ": PV Name is"
                                                     << " missing or empty";
-                                                    syslog( LOG_ERR,
+                                                    ASYNC_SYSLOG( LOG_ERR,
                                                         "%s %s",
                                                         "PVSD ERROR:",
                                                         ss.str().c_str() );
@@ -680,6 +679,15 @@ InputAdapter::parseConfigBuffer( const char* a_buffer, int a_buffer_size,
 
                                                 pvs.push_back( make_pair(
                                                     pv_name, pv_conn ));
+
+                                                // Optional deadband and
+                                                // rate limit for the PV
+                                                PVFilter filter;
+                                                parsePVFilter( cnode,
+                                                    dev_name, pv_conn,
+                                                    filter );
+                                                pv_filters.push_back(
+                                                    filter );
                                             }
                                             // If Not Logging PV, Log It...
                                             // Lol...! :-D
@@ -718,11 +726,9 @@ InputAdapter::parseConfigBuffer( const char* a_buffer, int a_buffer_size,
                                                     << " PV <" << pv_conn
                                                     << "> (" << pv_name
                                                     << ")";
-                                                    syslog( LOG_WARNING,
+                                                    ASYNC_SYSLOG( LOG_WARNING,
                                                         "%s",
                                                         ss.str().c_str() );
-                                                    // give syslog a chance
-                                                    usleep(33333);
                                                 }
                                             }
                                         }
@@ -732,7 +738,7 @@ InputAdapter::parseConfigBuffer( const char* a_buffer, int a_buffer_size,
                                     {
                                         // It's an Error to Omit the
                                         // Device Name
-                                        syslog( LOG_ERR,
+                                        ASYNC_SYSLOG( LOG_ERR,
                                             "%s: %s::%s(): %s -> %s = %d",
                                             "PVSD ERROR", "InputAdapter",
                                             "parseConfigBuffer",
@@ -756,7 +762,7 @@ InputAdapter::parseConfigBuffer( const char* a_buffer, int a_buffer_size,
                                                 + active_pv_conn + "])";
                                         }
 
-                                        syslog( LOG_ERR,
+                                        ASYNC_SYSLOG( LOG_ERR,
                                             "%s::%s: %s [%s] -> %s = %d%s",
                                             "InputAdapter",
                                             "parseConfigBuffer()",
@@ -764,8 +770,6 @@ InputAdapter::parseConfigBuffer( const char* a_buffer, int a_buffer_size,
                                             dev_name.c_str(),
                                             "Device ID", id,
                                             activeStr.c_str() );
-                                        // give syslog a chance...
-                                        usleep(33333);
 
                                         for ( ipv = pvs.begin();
                                             ipv != pvs.end(); ++ipv )
@@ -803,10 +807,8 @@ InputAdapter::parseConfigBuffer( const char* a_buffer, int a_buffer_size,
                                                 << " [" << dev_name << "]"
                                                 << " -> Device ID = " << id
                                                 << activeStr << aliasStr;
-                                                syslog( LOG_ERR, "%s",
+                                                ASYNC_SYSLOG( LOG_ERR, "%s",
                                                     ss.str().c_str() );
-                                                // give syslog a chance...
-                                                usleep(33333);
                                             }
 
                                             else
@@ -815,7 +817,9 @@ InputAdapter::parseConfigBuffer( const char* a_buffer, int a_buffer_size,
                                                 // - just use any value
                                                 dev->definePV(
                                                     ipv->first, ipv->second,
-                                                    PV_INT, 1, 0, "" );
+                                                    PV_INT, 1, 0, "",
+                                                    pv_filters[ ipv
+                                                        - pvs.begin() ] );
                                             }
                                         }
 
@@ -841,7 +845,7 @@ InputAdapter::parseConfigBuffer( const char* a_buffer, int a_buffer_size,
 
                                 if ( !dev_name.empty())
                                 {
-                                    syslog( LOG_WARNING,
+                                    ASYNC_SYSLOG( LOG_WARNING,
                                         "%s: %s [%s] -> %s = %d",
                                         "InputAdapter::parseConfigBuffer()",
                                         "Ignoring Inactive Device",
@@ -849,13 +853,12 @@ InputAdapter::parseConfigBuffer( const char* a_buffer, int a_buffer_size,
                                 }
                                 else
                                 {
-                                    syslog( LOG_WARNING,
+                                    ASYNC_SYSLOG( LOG_WARNING,
                                         "%s: %s! -> %s = %d",
                                         "InputAdapter::parseConfigBuffer()",
                                         "Ignoring Unnamed Inactive Device",
                                         "Device ID", id );
                                 }
-                                usleep(33333); // give syslog a chance...
 
                                 // Save Device ID to Inactive List...
                                 a_inactive_device_ids.push_back( id );
@@ -867,7 +870,7 @@ InputAdapter::parseConfigBuffer( const char* a_buffer, int a_buffer_size,
         }
         catch( std::exception &e )
         {
-            syslog( LOG_ERR,
+            ASYNC_SYSLOG( LOG_ERR,
                 "%s %s: Exception While Parsing EPICS beamline XML - %s",
                 "PVSD ERROR:", "InputAdapter::parseConfigBuffer()",
                 e.what() );
@@ -875,7 +878,7 @@ InputAdapter::parseConfigBuffer( const char* a_buffer, int a_buffer_size,
         }
         catch(...)
         {
-            syslog( LOG_ERR,
+            ASYNC_SYSLOG( LOG_ERR,
                 "%s %s: Exception While Parsing EPICS beamline XML",
                 "PVSD ERROR:", "InputAdapter::parseConfigBuffer()" );
             res = false;
@@ -898,6 +901,59 @@ InputAdapter::parseConfigBuffer( const char* a_buffer, int a_buffer_size,
 }
 
 
+/** \brief Reads the optional update filter settings for a PV
+  * \param a_pv_node - [in] PV node from the beamline configuration
+  * \param a_dev_name - [in] Device name (for logging)
+  * \param a_pv_conn - [in] PV connection (for logging)
+  * \param a_filter - [out] Deadband and rate limit for the PV
+  *
+  * Missing tags leave the filter off; a value that isn't a non-negative
+  * number is logged and ignored rather than failing the whole file.
+  */
+void
+InputAdapter::parsePVFilter( xmlNode *a_pv_node, const string &a_dev_name,
+        const string &a_pv_conn, PVFilter &a_filter ) const
+{
+    static const char *tags[] = { "deadband", "deadband_rel", "max_rate" };
+    double *values[] = { &a_filter.m_deadband, &a_filter.m_deadband_rel,
+        &a_filter.m_max_rate };
+
+    for ( size_t i = 0; i < sizeof(tags) / sizeof(tags[0]); ++i )
+    {
+        xmlNode *node = xmlFind( tags[i], a_pv_node );
+        if ( !node )
+            continue;
+
+        string value;
+        xmlGetValue( node, value );
+
+        char *end = 0;
+        double val = strtod( value.c_str(), &end );
+        if ( value.empty() || *end || !( val >= 0.0 ) || val == HUGE_VAL )
+        {
+            ASYNC_SYSLOG( LOG_ERR, "%s %s: Device [%s] PV (%s): %s <%s>%s%s",
+                "PVSD ERROR:", "InputAdapter::parsePVFilter()",
+                a_dev_name.c_str(), a_pv_conn.c_str(),
+                "Ignoring Invalid", tags[i], value.c_str(),
+                " - Expected a Non-Negative Number" );
+            continue;
+        }
+
+        *values[i] = val;
+    }
+
+    if ( a_filter.active() )
+    {
+        ASYNC_SYSLOG( LOG_INFO, "%s: Device [%s] PV (%s): %s=%g %s=%g %s=%g",
+            "InputAdapter::parsePVFilter()",
+            a_dev_name.c_str(), a_pv_conn.c_str(),
+            "deadband", a_filter.m_deadband,
+            "deadband_rel", a_filter.m_deadband_rel,
+            "max_rate", a_filter.m_max_rate );
+    }
+}
+
+
 /** \brief Helper function to find a child node by name (tag)
   * \param a_tag - [in] Tag to search for
   * \param a_parent_node - [in] Parent node to search
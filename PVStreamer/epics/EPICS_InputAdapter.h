@@ -62,6 +62,10 @@ private:
                         int a_buffer_size,
                         std::vector<DeviceDescriptor*> &a_devices,
                         std::vector<Identifier> &a_inactive_device_ids );
+    void            parsePVFilter( xmlNode *a_pv_node,
+                        const std::string &a_dev_name,
+                        const std::string &a_pv_conn,
+                        PVFilter &a_filter ) const;
     xmlNode*        xmlFind( const char *a_tag,
                         xmlNode *a_parent_node ) const;
     void            xmlGetValue( xmlNode *a_node,
@@ -40,6 +40,7 @@
 #include <iostream>
 #include <boost/program_options.hpp>
 #include <syslog.h>
+#include "AsyncLog.h"
 #include <stdint.h>
 #include <signal.h>
 
@@ -93,7 +94,7 @@ signalParent( int ret_code )
     if ( sigqueue( pid, SIGUSR1, data ) < 0 )
     {
         int e = errno;
-        syslog( LOG_ERR, "PVSD ERROR: Unable to signal parent: %s",
+        ASYNC_SYSLOG( LOG_ERR, "PVSD ERROR: Unable to signal parent: %s",
             strerror(e) );
     }
 }
@@ -107,7 +108,7 @@ daemonize()
     if ( pid < 0 )
     {
         int e = errno;
-        syslog( LOG_ERR, "PVSD ERROR: %s: Unable to fork: %s",
+        ASYNC_SYSLOG( LOG_ERR, "PVSD ERROR: %s: Unable to fork: %s",
             "daemonize()", strerror(e) );
         exit(1);
     }
@@ -127,7 +128,7 @@ daemonize()
     if ( setsid() < 0 )
     {
         int e = errno;
-        syslog( LOG_ERR, "PVSD ERROR: %s: Unable to setsid: %s",
+        ASYNC_SYSLOG( LOG_ERR, "PVSD ERROR: %s: Unable to setsid: %s",
             "daemonize()", strerror(e) );
         exit(1);
     }
@@ -136,7 +137,7 @@ daemonize()
     if ( pid < 0 )
     {
         int e = errno;
-        syslog( LOG_ERR, "PVSD ERROR: %s: Second fork failed: %s",
+        ASYNC_SYSLOG( LOG_ERR, "PVSD ERROR: %s: Second fork failed: %s",
             "daemonize()", strerror(e) );
         exit(1);
     }
@@ -161,7 +162,7 @@ daemonize()
 
     // Reopen log
     openlog( "pvsd", 0, LOG_DAEMON );
-    syslog( LOG_INFO,
+    ASYNC_SYSLOG( LOG_INFO,
         "PVSD Daemon %s Starting. (ADARA Common %s, ComBus %s, Tag %s)",
         PVSD_VERSION, ::ADARA::VERSION.c_str(),
         ::ADARA::ComBus::VERSION.c_str(), ::ADARA::TAG_NAME.c_str() );
@@ -170,7 +171,7 @@ daemonize()
     if ( chdir("/") < 0 )
     {
         int e = errno;
-        syslog( LOG_ERR, "PVSD ERROR: %s: Chdir failed: %s",
+        ASYNC_SYSLOG( LOG_ERR, "PVSD ERROR: %s: Chdir failed: %s",
             "daemonize()", strerror(e) );
         exit(1);
     }
@@ -189,7 +190,7 @@ int main(int argc, char *argv[])
 
     // Initialize SysLog
     openlog( "pvsd", 0, LOG_DAEMON );
-    syslog( LOG_INFO, "PVSD %s Starting (%s %s, %s %s, %s %s)",
+    ASYNC_SYSLOG( LOG_INFO, "PVSD %s Starting (%s %s, %s %s, %s %s)",
         PVSD_VERSION,
         "ADARA Common", ::ADARA::VERSION.c_str(),
         "ComBus", ::ADARA::ComBus::VERSION.c_str(),
@@ -294,14 +295,14 @@ int main(int argc, char *argv[])
 
     if ( !opt_map.count( "domain" ) )
     {
-        syslog( LOG_WARNING,
+        ASYNC_SYSLOG( LOG_WARNING,
             "%s %s: No communication domain specified - probably an error.",
             "PVSD ERROR:", "main()" );
     }
 
     if ( no_heartbeat_pv )
     {
-        syslog( LOG_WARNING,
+        ASYNC_SYSLOG( LOG_WARNING,
             "%s %s: PVSD Heartbeat Device/PV Deactivated on Command Line!",
             "PVSD ERROR:", "main()" );
     }
@@ -341,7 +342,7 @@ int main(int argc, char *argv[])
             {
                 if ( !(combus->status( ::ADARA::ComBus::STATUS_OK )) )
                 {
-                    syslog( LOG_ERR, "PVSD ERROR: %s",
+                    ASYNC_SYSLOG( LOG_ERR, "PVSD ERROR: %s",
                         "Broadcasting PVSD ComBus Status OK Message" );
                 }
             }
@@ -388,7 +389,7 @@ int main(int argc, char *argv[])
                 ss << output->numPVs();
                 ss << " Output PVs Defined";
 
-                syslog( logType, "%sPVSD %s %s %s - %s.",
+                ASYNC_SYSLOG( logType, "%sPVSD %s %s %s - %s.",
                     logPrefix.c_str(), PVSD_VERSION,
                     "is Alive at", output->serverAddr().c_str(),
                     ss.str().c_str() );
@@ -399,19 +400,19 @@ int main(int argc, char *argv[])
     }
     catch( TraceException &e )
     {
-        syslog( LOG_ERR, "PVSD ERROR: %s: %s",
+        ASYNC_SYSLOG( LOG_ERR, "PVSD ERROR: %s: %s",
             "main()", e.toString().c_str() );
         ret_code = 1;
     }
     catch( exception &e )
     {
-        syslog( LOG_ERR, "PVSD ERROR: %s: Unhandled exception: %s",
+        ASYNC_SYSLOG( LOG_ERR, "PVSD ERROR: %s: Unhandled exception: %s",
             "main()", e.what());
         ret_code = 1;
     }
     catch( ... )
     {
-        syslog( LOG_ERR, "PVSD ERROR: main(): Unknown exception" );
+        ASYNC_SYSLOG( LOG_ERR, "PVSD ERROR: main(): Unknown exception" );
         ret_code = 1;
     }
 
@@ -427,7 +428,8 @@ int main(int argc, char *argv[])
     if ( input )
         delete input;
 
-    syslog( LOG_INFO, "PVSD Stopping..." );
+    ASYNC_SYSLOG( LOG_INFO, "PVSD Stopping..." );
+    ::ADARA::AsyncLog::flush();
     closelog();
 
     return ret_code;
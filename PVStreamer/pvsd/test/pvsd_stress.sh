@@ -1,4 +1,21 @@
 #!/bin/bash
+#
+# pvsd Stress Test
+#
+# Usage: pvsd_stress.sh <num_devices> <num_pvs> [caput|scan] [scan_period]
+#
+# Builds a soft IOC with <num_pvs> x 4 PVs (mbbo, stringout, longout, ao)
+# for each of <num_devices> devices, plus a matching beamline config.
+#
+#    caput - (default) step every PV once a second with caput, serially
+#    scan  - the IOC updates every PV itself, each device from its own
+#            counter record processed every <scan_period> (default ".1")
+#            seconds, so monitors for many channels arrive concurrently
+#            on the CA callback threads (i.e. DeviceAgent contention)
+#
+# With START_PVSD=1 the test also runs pvsd on the generated config,
+# and on Ctrl-C reports its CPU time per generated update.
+#
 
 PUT="/home/d3s/epics/bin/linux-x86_64/caput2"
 SOFTIOC=/home/d3s/epics/bin/linux-x86_64/softIoc
@@ -7,6 +24,8 @@ IOC_DB_FILE=pvsd_stress.db
 BEAMLINE_FILE=pvsd_stress.xml
 NUM_DEVICES=$1
 NUM_PVS=$2
+MODE=${3:-caput}
+SCAN_PERIOD=${4:-.1}
 ENVAL=0
 IVAL=0
 FVAL=0.0
@@ -14,6 +33,37 @@ STRVALS[0]="Off"
 STRVALS[1]="Low"
 STRVALS[2]="High"
 
+# In scan mode, take the record's value from the given PV on change
+function scanInput {
+    if [ "$MODE" == "scan" ]
+    then
+        echo '  field(DOL,"'$1' CP")' >> $IOC_DB_FILE
+        echo '  field(OMSL,"closed_loop")' >> $IOC_DB_FILE
+    fi
+}
+
+# Per-device counter records driving all the device's PVs in scan mode
+function buildScanRecords {
+    echo 'record(calc,"D'$DEVID'-TICK")' >> $IOC_DB_FILE
+    echo '{' >> $IOC_DB_FILE
+    echo '  field(SCAN,"'$SCAN_PERIOD' second")' >> $IOC_DB_FILE
+    echo '  field(INPA,"D'$DEVID'-TICK NPP")' >> $IOC_DB_FILE
+    echo '  field(CALC,"A+1")' >> $IOC_DB_FILE
+    echo '}' >> $IOC_DB_FILE
+
+    echo 'record(calc,"D'$DEVID'-ENUM")' >> $IOC_DB_FILE
+    echo '{' >> $IOC_DB_FILE
+    echo '  field(INPA,"D'$DEVID'-TICK CP")' >> $IOC_DB_FILE
+    echo '  field(CALC,"A%3")' >> $IOC_DB_FILE
+    echo '}' >> $IOC_DB_FILE
+
+    echo 'record(calc,"D'$DEVID'-FVAL")' >> $IOC_DB_FILE
+    echo '{' >> $IOC_DB_FILE
+    echo '  field(INPA,"D'$DEVID'-TICK CP")' >> $IOC_DB_FILE
+    echo '  field(CALC,"A*0.1")' >> $IOC_DB_FILE
+    echo '}' >> $IOC_DB_FILE
+}
+
 function buildIOCDB {
     DEVNO=0
 
@@ -22,10 +72,16 @@ function buildIOCDB {
     while [  $DEVNO -lt $NUM_DEVICES ]; do
         let DEVID=DEVNO+1000
         PVID=1
+
+        if [ "$MODE" == "scan" ]
+        then
+            buildScanRecords
+        fi
         PVNO=0
         while [  $PVNO -lt $NUM_PVS ]; do
             echo 'record(mbbo,"D'$DEVID'-PV'$PVID'")' >> $IOC_DB_FILE
             echo '{' >> $IOC_DB_FILE
+            scanInput D$DEVID-ENUM
             echo '  field(SDEF,3)' >> $IOC_DB_FILE
             echo '  field(VAL,0)' >> $IOC_DB_FILE
             echo '  field(ZRVL,0)' >> $IOC_DB_FILE
@@ -41,6 +97,8 @@ function buildIOCDB {
 
             echo 'record(stringout,"D'$DEVID'-PV'$PVID'")' >> $IOC_DB_FILE
             echo '{' >> $IOC_DB_FILE
+            let ENUM_PVID=PVID-1
+            scanInput D$DEVID-PV$ENUM_PVID
             echo '  field(VAL,"Off")' >> $IOC_DB_FILE
             echo '  field(PINI,"YES")' >> $IOC_DB_FILE
             echo '}' >> $IOC_DB_FILE
@@ -49,6 +107,7 @@ function buildIOCDB {
 
             echo 'record(longout,"D'$DEVID'-PV'$PVID'")' >> $IOC_DB_FILE
             echo '{' >> $IOC_DB_FILE
+            scanInput D$DEVID-TICK
             echo '  field(VAL,0)' >> $IOC_DB_FILE
             echo '  field(EGU,"NA")' >> $IOC_DB_FILE
             echo '  field(PINI,"YES")' >> $IOC_DB_FILE
@@ -58,6 +117,7 @@ function buildIOCDB {
 
             echo 'record(ao,"D'$DEVID'-PV'$PVID'")' >> $IOC_DB_FILE
             echo '{' >> $IOC_DB_FILE
+            scanInput D$DEVID-FVAL
             echo '  field(VAL,4.5)' >> $IOC_DB_FILE
             echo '  field(UDF,1)' >> $IOC_DB_FILE
             echo '  field(EGU,"mm")' >> $IOC_DB_FILE
@@ -130,12 +190,36 @@ function stopSoftIOC {
 function startPVSD {
   eval "../pvsd -p 50011 --domain SNS.INST1 -c "$BEAMLINE_FILE" &"
   PVSDPID=$!
+  START_TIME=$(date +%s)
 }
 
 function stopPVSD {
+  reportPVSD
   kill -9 $PVSDPID
 }
 
+# pvsd CPU seconds (user + system) against the updates generated
+function reportPVSD {
+    CLK_TCK=$(getconf CLK_TCK)
+    STAT=( $(sed -e 's/^.*) //' /proc/$PVSDPID/stat) )
+    let ELAPSED="$(date +%s)-$START_TIME"
+    CPU=$(bc -l <<< "(${STAT[11]} + ${STAT[12]}) / $CLK_TCK")
+
+    if [ "$MODE" == "scan" ]
+    then
+        RATE=$(bc -l <<< "$NUM_DEVICES * $NUM_PVS * 4 / $SCAN_PERIOD")
+    else
+        RATE=$(( $NUM_DEVICES * $NUM_PVS * 4 ))
+    fi
+    UPDATES=$(bc -l <<< "$RATE * $ELAPSED")
+
+    echo "pvsd: ${ELAPSED}s elapsed, ${CPU}s CPU, ~${RATE} updates/s"
+    if [ "$ELAPSED" -gt 0 ]
+    then
+        echo "pvsd: $(bc -l <<< "scale=2; 1000000 * $CPU / $UPDATES") CPU us/update"
+    fi
+}
+
 function stepPVs {
     let ENVAL="$ENVAL+1"
     if [ $ENVAL -gt 2 ]
@@ -179,7 +263,10 @@ function loopPVs {
     while [ $RUN -eq 1  ]; do
         #echo 'step'
         sleep 1
-        stepPVs
+        if [ "$MODE" != "scan" ]
+        then
+            stepPVs
+        fi
     done
 }
 
@@ -194,9 +281,15 @@ buildIOCDB
 buildSoftIOCCommandFile
 buildBeamlineFile
 startSoftIOC
-#startPVSD
+if [ "$START_PVSD" == "1" ]
+then
+    startPVSD
+fi
 
 loopPVs
 
-#stopPVSD
+if [ "$START_PVSD" == "1" ]
+then
+    stopPVSD
+fi
 stopSoftIOC
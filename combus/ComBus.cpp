@@ -2,6 +2,7 @@
 #include <fstream>
 #include <sstream>
 #include <activemq/commands/Command.h>
+#include <cms/BytesMessage.h>
 #include <decaf/io/EOFException.h>
 #include <boost/thread/locks.hpp>
 #include <boost/lexical_cast.hpp>
@@ -84,14 +85,25 @@ Connection::Translator::onMessage( const cms::Message *a_msg ) throw()
 {
     const cms::TextMessage *txtmsg =
         dynamic_cast<const cms::TextMessage*>(a_msg);
+    const cms::BytesMessage *bytesmsg = 0;
 
-    // ALL ComBus messages are TextMessages - ignore if not
+    // ComBus messages are TextMessages (JSON) or BytesMessages
+    // (compact encoding) - ignore if neither
     if ( !txtmsg )
-        return;
+    {
+        bytesmsg = dynamic_cast<const cms::BytesMessage*>(a_msg);
+        if ( !bytesmsg )
+            return;
+    }
 
     try
     {
-        MessageBase *msg = Connection::makeMessage( *txtmsg );
+        MessageBase *msg = txtmsg ? Connection::makeMessage( *txtmsg )
+            : Connection::makeMessage( *bytesmsg );
+
+        // Malformed payloads have already been logged by makeMessage()
+        if ( !msg )
+            return;
 
         // Generic ComBus messages are always broadcast, so are never
         // directed at a particular process. If filtering is desired,
@@ -283,7 +295,7 @@ Connection::Connection( std::string &a_domain,
     m_broker_pass(a_pass),
     m_log_info_prefix(a_log_info_prefix),
     m_log_err_prefix(a_log_err_prefix),
-    m_connection(0), m_session(0),
+    m_connection(0), m_session(0), m_coalescer(0),
     m_reconnect_thread(0), m_reconn_retry(2), m_status_thread(0)
 {
     exceptionLog("ComBus Connection() Entry", INFO_LOG);
@@ -346,6 +358,10 @@ Connection::~Connection() throw()
     m_status_cond.notify_one();
     m_status_thread->join();
 
+    // Flush any coalesced messages while we can still send them
+    delete m_coalescer;
+    m_coalescer = 0;
+
     // Wait for reconnect thread to exit
     int i = 0;
     while ( m_reconnect_thread && i++ < 12 )
@@ -687,6 +703,9 @@ Connection::reconnectThread()
                 // ActiveMQ CPP Session Destructor Broken... ;-Q
                 if ( m_session )
                 {
+                    boost::lock_guard<boost::mutex> plock(
+                        m_producer_mutex );
+
                     m_session->close();
                     delete m_session;
                     m_session = 0;
@@ -874,6 +893,9 @@ Connection::disconnect()
 
         try
         {
+            // Coalescer thread sends on the producers and session
+            boost::lock_guard<boost::mutex> plock( m_producer_mutex );
+
             // Disconnect all message producers
             map<string,pair<cms::Topic*,cms::MessageProducer*> >::iterator
                 ip = m_producer_topics.begin();
@@ -1006,35 +1028,17 @@ Connection::broadcast( MessageBase &a_msg )
 
     if ( m_connected )
     {
-        cms::TextMessage *cmsmsg = 0;
+        cms::Message *cmsmsg = 0;
 
         try
         {
             a_msg.setRoutingInfo( m_proc_id, "", time(0) );
 
-            cmsmsg = m_session->createTextMessage();
-            a_msg.serialize( *cmsmsg );
-
             string topic = a_msg.getTopic();
-            map<string,pair<cms::Topic*,cms::MessageProducer*> >::iterator
-                itop = m_producer_topics.find( topic );
-            if ( itop == m_producer_topics.end())
-            {
-                // First message sent on this topic,
-                // create producer and put in "cache"
-                pair<cms::Topic*,cms::MessageProducer*> p;
-                p.first = m_session->createTopic(
-                    m_domain + topic + "." + m_proc_name );
-                p.second = m_session->createProducer( p.first );
-                p.second->setDeliveryMode(
-                    cms::DeliveryMode::NON_PERSISTENT );
-                m_producer_topics[topic] = p;
-                p.second->send( cmsmsg );
-            }
-            else
-            {
-                itop->second.second->send( cmsmsg );
-            }
+
+            cmsmsg = createCMSMessage( a_msg, topic );
+
+            publish( topic, cmsmsg );
 
             delete cmsmsg;
             res = true;
@@ -1111,6 +1115,8 @@ Connection::send( MessageBase &a_msg, const std::string &a_dest_proc_id,
 
                 string dest_proc_name( a_dest_proc_id.substr( 0, pos ));
 
+                boost::lock_guard<boost::mutex> lock( m_producer_mutex );
+
                 map<string, pair<cms::Topic*, cms::MessageProducer*> >
                     ::iterator itop =
                         m_producer_topics.find( dest_proc_name );
@@ -1171,6 +1177,262 @@ Connection::send( MessageBase &a_msg, const std::string &a_dest_proc_id,
 }
 
 
+/** \brief Broadcasts a message on inferred topic, coalescing by key.
+  * \param a_msg - Message to broadcast
+  * \param a_key - Application key identifying the updated quantity
+  * \return True if message is queued (or sent); false otherwise
+  *
+  * This method serializes the message immediately (using the encoding
+  * configured for its topic) and hands it to the coalescing sender. If
+  * another message with the same type and key is broadcast before the
+  * coalescing window expires, only the latest one is sent. If no
+  * coalescing window has been set, this is equivalent to broadcast().
+  */
+bool
+Connection::broadcastCoalesced( MessageBase &a_msg, const std::string &a_key )
+{
+    if ( !m_coalescer )
+        return broadcast( a_msg );
+
+    if ( !m_connected )
+    {
+        std::stringstream ss;
+        ss << "broadcastCoalesced(): Disconnected! Can't Broadcast Message...!"
+            << " domain=[" << m_domain << "]"
+            << " broker_uri=[" << m_broker_uri << "]"
+            << " broker_user=[" << m_broker_user << "]"
+            << " topic=[" << a_msg.getTopic() << "]";
+        exceptionLog(ss.str(), ERR_LOG);
+        return false;
+    }
+
+    try
+    {
+        a_msg.setRoutingInfo( m_proc_id, "", time(0) );
+
+        string topic = a_msg.getTopic();
+        bool compact = ( getTopicEncoding( topic ) == ENCODING_COMPACT );
+
+        string payload;
+        if ( compact )
+            a_msg.serializeCompact( payload );
+        else
+            a_msg.serializeText( payload );
+
+        m_coalescer->post( topic + "."
+                + boost::lexical_cast<string>( a_msg.getMessageType() )
+                + "." + a_key,
+            topic, payload, compact );
+    }
+    catch(...)
+    {
+        exceptionLog( "broadcastCoalesced(): Error Serializing Message!",
+            ERR_LOG );
+        return false;
+    }
+
+    return true;
+}
+
+
+/** \brief Sends a coalesced payload (called from Coalescer thread)
+  * \param a_key - Coalescing key (unused except for logging)
+  * \param a_pending - Pending payload to send
+  */
+void
+Connection::coalescedSend( const std::string &a_key,
+        const Coalescer::Pending &a_pending )
+{
+    // Disconnected, last value is dropped just as for broadcast()
+    if ( !m_connected )
+        return;
+
+    cms::Message *cmsmsg = 0;
+
+    try
+    {
+        // Unlike broadcast(), this runs on the Coalescer thread, so the
+        // session may be torn down underneath us; hold the producer lock
+        // from message creation through the send.
+        boost::lock_guard<boost::mutex> lock( m_producer_mutex );
+
+        if ( !m_session )
+            return;
+
+        cmsmsg = createCMSMessage( a_pending.payload, a_pending.compact );
+
+        publishLocked( a_pending.topic, cmsmsg );
+
+        delete cmsmsg;
+    }
+    catch(...)
+    {
+        std::stringstream ss;
+        ss << "coalescedSend(): Error Broadcasting Message!"
+            << " domain=[" << m_domain << "]"
+            << " broker_uri=[" << m_broker_uri << "]"
+            << " topic=[" << a_pending.topic << "]"
+            << " key=[" << a_key << "]";
+        exceptionLog(ss.str(), ERR_LOG);
+
+        // An exception indicates a loss of connection
+        delete cmsmsg;
+        disconnect();
+    }
+}
+
+
+/** \brief Sets wire encoding for messages broadcast on a topic
+  * \param a_topic - Topic (message category, i.e. "APP", "STATUS")
+  * \param a_encoding - Encoding to use for this topic
+  *
+  * Receivers decode both encodings transparently, so this only needs to
+  * be configured by the sending process. Should be called during start-up
+  * before messages are broadcast on the topic.
+  */
+void
+Connection::setTopicEncoding( const std::string &a_topic,
+        Encoding a_encoding )
+{
+    m_topic_encoding[a_topic] = a_encoding;
+}
+
+
+/** \brief Gets wire encoding for messages broadcast on a topic
+  * \param a_topic - Topic (message category)
+  * \return Encoding for topic (JSON if not configured)
+  */
+Encoding
+Connection::getTopicEncoding( const std::string &a_topic ) const
+{
+    std::map<std::string,Encoding>::const_iterator ienc =
+        m_topic_encoding.find( a_topic );
+
+    return ( ienc == m_topic_encoding.end() ) ? ENCODING_JSON : ienc->second;
+}
+
+
+/** \brief Sets coalescing window for broadcastCoalesced()
+  * \param a_window_ms - Coalescing window in msec (0 disables coalescing)
+  *
+  * Should be called during start-up before coalesced broadcasts begin.
+  * Disabling coalescing flushes any pending messages.
+  */
+void
+Connection::setCoalesceWindow( uint32_t a_window_ms )
+{
+    if ( !a_window_ms )
+    {
+        delete m_coalescer;
+        m_coalescer = 0;
+    }
+    else if ( m_coalescer )
+    {
+        m_coalescer->setWindow( a_window_ms );
+    }
+    else
+    {
+        m_coalescer = new Coalescer( boost::bind(
+            &Connection::coalescedSend, this, _1, _2 ), a_window_ms );
+    }
+}
+
+
+/** \brief Builds an AMQ message using the encoding configured for a topic
+  * \param a_msg - ComBus message to serialize
+  * \param a_topic - Topic (category) the message will be sent on
+  * \return New AMQ message (owned by caller)
+  */
+cms::Message*
+Connection::createCMSMessage( MessageBase &a_msg, const std::string &a_topic )
+{
+    if ( getTopicEncoding( a_topic ) == ENCODING_COMPACT )
+    {
+        string payload;
+        a_msg.serializeCompact( payload );
+        return createCMSMessage( payload, true );
+    }
+
+    cms::TextMessage *txtmsg = m_session->createTextMessage();
+    a_msg.serialize( *txtmsg );
+
+    return txtmsg;
+}
+
+
+/** \brief Builds an AMQ message from an already serialized payload
+  * \param a_payload - Serialized message (JSON text or Codec encoded)
+  * \param a_compact - True if payload is Codec encoded
+  * \return New AMQ message (owned by caller)
+  */
+cms::Message*
+Connection::createCMSMessage( const std::string &a_payload, bool a_compact )
+{
+    if ( a_compact )
+    {
+        cms::BytesMessage *bytesmsg = m_session->createBytesMessage(
+            (const unsigned char *) a_payload.data(),
+            (int) a_payload.size() );
+
+        // Lets non-ComBus consumers (i.e. web monitors) recognize
+        // payloads they can't parse as JSON
+        bytesmsg->setStringProperty( "combus_encoding", "compact" );
+
+        return bytesmsg;
+    }
+
+    return m_session->createTextMessage( a_payload );
+}
+
+
+/** \brief Sends an AMQ message on the producer for a broadcast topic
+  * \param a_topic - Topic (message category)
+  * \param a_cmsmsg - AMQ message to send
+  *
+  * Producers are created on first use and cached. Exceptions from the
+  * AMQ library are passed on to the caller.
+  */
+void
+Connection::publish( const std::string &a_topic, cms::Message *a_cmsmsg )
+{
+    boost::lock_guard<boost::mutex> lock( m_producer_mutex );
+
+    publishLocked( a_topic, a_cmsmsg );
+}
+
+
+/** \brief Sends an AMQ message on a broadcast topic producer (lock held)
+  * \param a_topic - Topic (message category)
+  * \param a_cmsmsg - AMQ message to send
+  *
+  * As publish(), for callers already holding m_producer_mutex.
+  */
+void
+Connection::publishLocked( const std::string &a_topic,
+        cms::Message *a_cmsmsg )
+{
+    map<string,pair<cms::Topic*,cms::MessageProducer*> >::iterator
+        itop = m_producer_topics.find( a_topic );
+    if ( itop == m_producer_topics.end())
+    {
+        // First message sent on this topic,
+        // create producer and put in "cache"
+        pair<cms::Topic*,cms::MessageProducer*> p;
+        p.first = m_session->createTopic(
+            m_domain + a_topic + "." + m_proc_name );
+        p.second = m_session->createProducer( p.first );
+        p.second->setDeliveryMode(
+            cms::DeliveryMode::NON_PERSISTENT );
+        m_producer_topics[a_topic] = p;
+        p.second->send( a_cmsmsg );
+    }
+    else
+    {
+        itop->second.second->send( a_cmsmsg );
+    }
+}
+
+
 /** \brief Posts a message to the workflow manager input queue
   * \param a_msg - Message to post
   * \return True if message is posted; false otherwise
@@ -1275,6 +1537,57 @@ Connection::makeMessage( const cms::TextMessage &a_msg )
 }
 
 
+/** \brief Factory method for ComBus messages based on AMQP bytes messages.
+  * \param a_msg - A received AMQP bytes message.
+  * \return A new ComBus message as a MessageBase pointer (null on error)
+  *
+  * This method is the compact-encoding counterpart of the TextMessage
+  * version above; the message body is decoded with the ComBus Codec into
+  * a property tree, which is then unserialized in the same way.
+  */
+MessageBase*
+Connection::makeMessage( const cms::BytesMessage &a_msg )
+{
+    MessageBase *msg = 0;
+    unsigned char *body = 0;
+    int len = 0;
+
+    try
+    {
+        len = a_msg.getBodyLength();
+        body = a_msg.getBodyBytes();
+
+        boost::property_tree::ptree prop_tree;
+        Codec::decode( body, (size_t) len, prop_tree );
+
+        delete [] body;
+        body = 0;
+
+        uint32_t msg_type = prop_tree.get( "msg_type", 0UL );
+
+        msg = Factory::Inst().make( (MessageType) msg_type );
+
+        msg->unserialize( prop_tree );
+
+        if ( msg->getCorrelationID().empty() )
+            msg->setCorrelationID( a_msg.getCMSMessageID() );
+    }
+    catch(...)
+    {
+        delete [] body;
+        delete msg;
+        msg = 0;
+
+        std::stringstream sstr;
+        sstr << "makeMessage(): Error Making Message from Compact Payload!"
+            << " len=" << len;
+        ComBus::Connection::getInst().exceptionLog( sstr.str(), ERR_LOG );
+    }
+
+    return msg;
+}
+
+
 /** \brief Attaches a connection listener
   * \param a_subscriber - New connection listener to attach
   */
@@ -21,13 +21,19 @@
 namespace ADARA {
 namespace ComBus {
 
-const std::string VERSION = "2.3.8";
+const std::string VERSION = "2.4.0";
 
 enum LogStatus {
     INFO_LOG    =   0x0,
     ERR_LOG     =   0x1,
 };
 
+/// Wire encoding used for messages broadcast on a topic
+enum Encoding {
+    ENCODING_JSON       =   0x0,    ///< JSON text in a TextMessage (default)
+    ENCODING_COMPACT    =   0x1,    ///< Codec binary in a BytesMessage
+};
+
 class MessageBase;
 
 
@@ -81,6 +87,14 @@ public:
  * dropped and must be re-established. This does not apply if the
  * connection is lost and re-acquired; in this case, all subscriptions are
  * automatically reconnected when the connection is re-established.
+ *
+ * By default all messages are sent as JSON text. High-rate producers may
+ * select the compact binary encoding per topic (category) using
+ * setTopicEncoding(); receivers always accept both encodings, so only
+ * senders need to be configured. Producers of periodic status/metrics
+ * may also enable a coalescing window with setCoalesceWindow() and send
+ * with broadcastCoalesced(), in which case only the latest message for
+ * a given key is sent once per window.
  */
 class Connection : public cms::ExceptionListener
 {
@@ -129,8 +143,17 @@ public:
                             const std::string &a_dest_proc,
                             const std::string *a_correlation_id = 0 );
 
+    bool                broadcastCoalesced( MessageBase &a_msg,
+                            const std::string &a_key );
+
     bool                postWorkflow( MessageBase &a_msg );
 
+    void                setTopicEncoding( const std::string &a_topic,
+                            Encoding a_encoding );
+    Encoding            getTopicEncoding( const std::string &a_topic ) const;
+
+    void                setCoalesceWindow( uint32_t a_window_ms );
+
     uint32_t            getReconnRetry() { return m_reconn_retry; }
     void                setReconnRetry( uint32_t a_reconn_retry )
                             { m_reconn_retry = a_reconn_retry; }
@@ -196,7 +219,23 @@ private:
                                 cms::Topic **a_topic,
                                 cms::MessageConsumer **a_consumer );
 
+    cms::Message*           createCMSMessage( MessageBase &a_msg,
+                                const std::string &a_topic );
+
+    cms::Message*           createCMSMessage( const std::string &a_payload,
+                                bool a_compact );
+
+    void                    publish( const std::string &a_topic,
+                                cms::Message *a_cmsmsg );
+
+    void                    publishLocked( const std::string &a_topic,
+                                cms::Message *a_cmsmsg );
+
+    void                    coalescedSend( const std::string &a_key,
+                                const Coalescer::Pending &a_pending );
+
     static MessageBase*     makeMessage( const cms::TextMessage &a_msg );
+    static MessageBase*     makeMessage( const cms::BytesMessage &a_msg );
 
     bool                                    m_running;          ///< Flag indicating ComBus lib is active/running
     bool                                    m_connected;        ///< Flag indicating ComBus is connected
@@ -216,6 +255,9 @@ private:
     cms::Session                           *m_session;          ///< AMQP session instance
     std::vector<IConnectionListener*>       m_status_listeners; ///< Connection status listeners
     ProducerMap                             m_producer_topics;  ///< AMQP topic-producer map
+    boost::mutex                            m_producer_mutex;   ///< Mutex for topic-producer map
+    std::map<std::string,Encoding>          m_topic_encoding;   ///< Per-topic wire encoding
+    Coalescer                              *m_coalescer;        ///< Coalescing sender (if enabled)
     std::map<ITopicListener*,Translator*>   m_listeners;        ///< Topic listeners (subscribers)
     boost::thread                          *m_reconnect_thread; ///< AMQP connection maintenance thread
     uint32_t                                m_reconn_retry;     ///< Retry period for Reconnect Thread (seconds)
@@ -0,0 +1,380 @@
+#ifndef COMBUSCODEC_H
+#define COMBUSCODEC_H
+
+#include <stdint.h>
+#include <string>
+#include <map>
+#include <stdexcept>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/function.hpp>
+#include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+namespace ADARA {
+namespace ComBus {
+
+/** \brief Compact binary encoding of ComBus message property trees
+  *
+  * The Codec class provides an alternative to the JSON text encoding used
+  * for ComBus messages. Messages still describe themselves via their
+  * read()/write() property tree methods, but the property tree is emitted
+  * as length-prefixed binary fields rather than being formatted and
+  * re-parsed as JSON text, which is where most of the CPU time goes for
+  * high-rate status and metrics messages. The encoded form is carried in
+  * an AMQ BytesMessage.
+  *
+  * Encoded layout (all lengths/counts are LEB128 varints):
+  *
+  *   magic[2] ('C','B'), version[1]
+  *   node := data_len, data[data_len], child_count,
+  *           { key_len, key[key_len], node } * child_count
+  */
+class Codec
+{
+public:
+    static const uint8_t    MAGIC0 = 'C';
+    static const uint8_t    MAGIC1 = 'B';
+    static const uint8_t    VERSION = 1;
+
+    /** \brief Encodes a property tree into a compact binary buffer
+      * \param a_prop_tree - Property tree to encode
+      * \param a_buf - String to receive encoded bytes (replaced)
+      */
+    static void encode( const boost::property_tree::ptree &a_prop_tree,
+        std::string &a_buf )
+    {
+        a_buf.clear();
+        a_buf.reserve( 256 );
+        a_buf.push_back( (char) MAGIC0 );
+        a_buf.push_back( (char) MAGIC1 );
+        a_buf.push_back( (char) VERSION );
+        encodeNode( a_prop_tree, a_buf );
+    }
+
+    /** \brief Decodes a compact binary buffer into a property tree
+      * \param a_data - Pointer to encoded bytes
+      * \param a_len - Number of encoded bytes
+      * \param a_prop_tree - Property tree to receive decoded data
+      * \throws runtime_error if the buffer is not a valid encoding
+      */
+    static void decode( const uint8_t *a_data, size_t a_len,
+        boost::property_tree::ptree &a_prop_tree )
+    {
+        if ( a_len < 3 || a_data[0] != MAGIC0 || a_data[1] != MAGIC1 )
+            throw std::runtime_error("Bad compact message header");
+        if ( a_data[2] != VERSION )
+            throw std::runtime_error("Unsupported compact message version");
+
+        const uint8_t *pos = a_data + 3;
+        const uint8_t *end = a_data + a_len;
+
+        a_prop_tree.clear();
+        decodeNode( pos, end, a_prop_tree );
+
+        if ( pos != end )
+            throw std::runtime_error("Trailing data in compact message");
+    }
+
+    /// Returns true if the buffer carries the compact encoding header
+    static bool isCompact( const uint8_t *a_data, size_t a_len )
+    {
+        return a_len >= 3 && a_data[0] == MAGIC0 && a_data[1] == MAGIC1;
+    }
+
+private:
+    static void putVarint( uint64_t a_val, std::string &a_buf )
+    {
+        while ( a_val >= 0x80 )
+        {
+            a_buf.push_back( (char)( ( a_val & 0x7F ) | 0x80 ) );
+            a_val >>= 7;
+        }
+        a_buf.push_back( (char) a_val );
+    }
+
+    static uint64_t getVarint( const uint8_t *&a_pos, const uint8_t *a_end )
+    {
+        uint64_t val = 0;
+        for ( uint32_t shift = 0; shift < 64; shift += 7 )
+        {
+            if ( a_pos >= a_end )
+                throw std::runtime_error("Truncated compact message");
+
+            uint8_t b = *a_pos++;
+            val |= (uint64_t)( b & 0x7F ) << shift;
+            if ( !( b & 0x80 ))
+                return val;
+        }
+        throw std::runtime_error("Bad varint in compact message");
+    }
+
+    static void putString( const std::string &a_str, std::string &a_buf )
+    {
+        putVarint( a_str.size(), a_buf );
+        a_buf.append( a_str );
+    }
+
+    static void getString( const uint8_t *&a_pos, const uint8_t *a_end,
+        std::string &a_str )
+    {
+        uint64_t len = getVarint( a_pos, a_end );
+        if ( len > (uint64_t)( a_end - a_pos ))
+            throw std::runtime_error("Truncated compact message field");
+
+        a_str.assign( (const char *) a_pos, (size_t) len );
+        a_pos += len;
+    }
+
+    static void encodeNode( const boost::property_tree::ptree &a_node,
+        std::string &a_buf )
+    {
+        putString( a_node.data(), a_buf );
+        putVarint( a_node.size(), a_buf );
+
+        for ( boost::property_tree::ptree::const_iterator c = a_node.begin();
+                c != a_node.end(); ++c )
+        {
+            putString( c->first, a_buf );
+            encodeNode( c->second, a_buf );
+        }
+    }
+
+    static void decodeNode( const uint8_t *&a_pos, const uint8_t *a_end,
+        boost::property_tree::ptree &a_node, uint32_t a_depth = 0 )
+    {
+        // Property trees from ComBus messages are shallow; guard against
+        // malicious/corrupt input blowing the stack
+        if ( a_depth > 64 )
+            throw std::runtime_error("Compact message nested too deeply");
+
+        getString( a_pos, a_end, a_node.data() );
+
+        uint64_t count = getVarint( a_pos, a_end );
+        std::string key;
+
+        for ( uint64_t i = 0; i < count; ++i )
+        {
+            getString( a_pos, a_end, key );
+            boost::property_tree::ptree &child =
+                a_node.push_back( std::make_pair( key,
+                    boost::property_tree::ptree() ))->second;
+            decodeNode( a_pos, a_end, child, a_depth + 1 );
+        }
+    }
+};
+
+
+/** \brief Coalesces high-rate updates for the same key within a window
+  *
+  * The Coalescer holds serialized message payloads keyed by an application
+  * supplied key (i.e. message type plus a metric name). If a new payload
+  * for a key arrives before the previous one has been sent, the newer
+  * payload replaces the pending one ("last value wins") but keeps the
+  * original send deadline, so a key is emitted at most once per window.
+  * Pending payloads are handed to the sender callback from an internal
+  * thread; the callback must not call back into the Coalescer.
+  *
+  * The number of distinct keys is expected to be small (tens), so the
+  * earliest deadline is found by a linear scan.
+  */
+class Coalescer
+{
+public:
+    /// Serialized payload awaiting transmission
+    struct Pending
+    {
+        std::string                 topic;      ///< ComBus topic (category)
+        std::string                 payload;    ///< Serialized message
+        bool                        compact;    ///< Payload is Codec encoded
+        boost::posix_time::ptime    deadline;   ///< Time payload must be sent
+        uint32_t                    merged;     ///< Updates merged into this one
+    };
+
+    typedef boost::function<void (const std::string &a_key,
+        const Pending &a_pending)> SendFunc;
+
+    Coalescer( SendFunc a_send, uint32_t a_window_ms )
+        : m_send(a_send), m_window_ms(a_window_ms), m_running(true),
+        m_merged_total(0), m_sent_total(0)
+    {
+        m_thread = new boost::thread( boost::bind( &Coalescer::sendThread,
+            this ));
+    }
+
+    ~Coalescer()
+    {
+        {
+            boost::lock_guard<boost::mutex> lock(m_mutex);
+            m_running = false;
+        }
+        m_cond.notify_all();
+        m_thread->join();
+        delete m_thread;
+
+        // Don't drop the last value of any key on shutdown
+        flush();
+    }
+
+    /// Sets the coalescing window (applies to newly queued keys)
+    void setWindow( uint32_t a_window_ms )
+    {
+        boost::lock_guard<boost::mutex> lock(m_mutex);
+        m_window_ms = a_window_ms;
+    }
+
+    uint32_t getWindow()
+    {
+        boost::lock_guard<boost::mutex> lock(m_mutex);
+        return m_window_ms;
+    }
+
+    /** \brief Queues (or replaces) the pending payload for a key
+      * \param a_key - Coalescing key
+      * \param a_topic - ComBus topic (category) of message
+      * \param a_payload - Serialized message (swapped out, left empty)
+      * \param a_compact - True if payload is Codec encoded
+      */
+    void post( const std::string &a_key, const std::string &a_topic,
+        std::string &a_payload, bool a_compact )
+    {
+        bool wake = false;
+
+        {
+            boost::lock_guard<boost::mutex> lock(m_mutex);
+
+            std::map<std::string,Pending>::iterator p = m_pending.find( a_key );
+            if ( p == m_pending.end() )
+            {
+                p = m_pending.insert( std::make_pair( a_key, Pending() )).first;
+                p->second.deadline =
+                    boost::posix_time::microsec_clock::universal_time()
+                    + boost::posix_time::milliseconds( m_window_ms );
+                p->second.merged = 0;
+                wake = true;
+            }
+            else
+            {
+                ++p->second.merged;
+                ++m_merged_total;
+            }
+
+            p->second.topic = a_topic;
+            p->second.payload.swap( a_payload );
+            a_payload.clear();
+            p->second.compact = a_compact;
+        }
+
+        if ( wake )
+            m_cond.notify_all();
+    }
+
+    /// Sends all pending payloads immediately (on the calling thread)
+    void flush()
+    {
+        std::map<std::string,Pending> due;
+
+        {
+            boost::lock_guard<boost::mutex> lock(m_mutex);
+            due.swap( m_pending );
+            m_sent_total += due.size();
+        }
+
+        for ( std::map<std::string,Pending>::iterator p = due.begin();
+                p != due.end(); ++p )
+        {
+            m_send( p->first, p->second );
+        }
+    }
+
+    /// Total number of updates that were merged (never sent)
+    uint64_t getMergedCount()
+    {
+        boost::lock_guard<boost::mutex> lock(m_mutex);
+        return m_merged_total;
+    }
+
+    /// Total number of payloads handed to the sender
+    uint64_t getSentCount()
+    {
+        boost::lock_guard<boost::mutex> lock(m_mutex);
+        return m_sent_total;
+    }
+
+private:
+    void sendThread()
+    {
+        std::map<std::string,Pending> due;
+
+        boost::unique_lock<boost::mutex> lock(m_mutex);
+
+        while ( m_running )
+        {
+            boost::posix_time::ptime now =
+                boost::posix_time::microsec_clock::universal_time();
+            boost::posix_time::ptime next = boost::posix_time::pos_infin;
+
+            for ( std::map<std::string,Pending>::iterator p =
+                    m_pending.begin(); p != m_pending.end(); )
+            {
+                if ( p->second.deadline <= now )
+                {
+                    Pending &d = due[p->first];
+                    d.payload.swap( p->second.payload );
+                    d.topic = p->second.topic;
+                    d.compact = p->second.compact;
+                    d.deadline = p->second.deadline;
+                    d.merged = p->second.merged;
+                    m_pending.erase( p++ );
+                }
+                else
+                {
+                    if ( p->second.deadline < next )
+                        next = p->second.deadline;
+                    ++p;
+                }
+            }
+
+            if ( !due.empty() )
+            {
+                m_sent_total += due.size();
+
+                // Send outside of lock so producers are never blocked
+                // by a slow broker
+                lock.unlock();
+                for ( std::map<std::string,Pending>::iterator p =
+                        due.begin(); p != due.end(); ++p )
+                {
+                    m_send( p->first, p->second );
+                }
+                due.clear();
+                lock.lock();
+                continue;
+            }
+
+            if ( next.is_pos_infinity() )
+                m_cond.wait( lock );
+            else
+                m_cond.timed_wait( lock, next );
+        }
+    }
+
+    SendFunc                            m_send;         ///< Payload sender callback
+    uint32_t                            m_window_ms;    ///< Coalescing window (msec)
+    bool                                m_running;      ///< Send thread run flag
+    uint64_t                            m_merged_total; ///< Count of merged updates
+    uint64_t                            m_sent_total;   ///< Count of sent payloads
+    std::map<std::string,Pending>       m_pending;      ///< Pending payloads by key
+    boost::thread                      *m_thread;       ///< Send thread
+    boost::mutex                        m_mutex;        ///< Mutex for pending data
+    boost::condition_variable           m_cond;         ///< Wakes send thread
+};
+
+}}
+
+#endif // COMBUSCODEC_H
+
+// vim: expandtab
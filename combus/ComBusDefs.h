@@ -9,6 +9,7 @@
 #include <boost/property_tree/json_parser.hpp>
 #include <boost/algorithm/string.hpp>
 #include "ADARADefs.h"
+#include "ComBusCodec.h"
 
 namespace ADARA {
 namespace ComBus {
@@ -219,6 +220,36 @@ public:
         a_msg.setText( sstr.str() );
     }
 
+    /** \brief Serializes a MessageBase-derived instance to a compact binary payload
+      * \param a_buf - String to receive Codec-encoded MessageBase data
+      *
+      * The compact payload is carried in an AMQ BytesMessage on topics that
+      * have been configured for compact encoding (see Connection).
+      */
+    void serializeCompact( std::string &a_buf )
+    {
+        boost::property_tree::ptree prop_tree;
+
+        write( prop_tree );
+
+        Codec::encode( prop_tree, a_buf );
+    }
+
+    /** \brief Serializes a MessageBase-derived instance to JSON text
+      * \param a_text - String to receive JSON MessageBase data
+      */
+    void serializeText( std::string &a_text )
+    {
+        boost::property_tree::ptree prop_tree;
+
+        write( prop_tree );
+
+        std::stringstream sstr;
+        write_json( sstr, prop_tree );
+
+        a_text = sstr.str();
+    }
+
     /** \brief Unserializes a MessageBase-derived instance from a boost property tree
       * \param a_prop_tree - Boost property tree containing serialized MessageBase data
       */
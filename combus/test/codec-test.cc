@@ -0,0 +1,248 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+
+#include "ComBusCodec.h"
+
+/* Loopback test and microbenchmark for the compact ComBus encoding.
+ *
+ * The property trees built here mirror what the DASMON metrics and SMS
+ * status messages write() (flat numeric fields plus one nested list), so
+ * the benchmark compares the same work the Connection class would do for
+ * the JSON TextMessage and compact BytesMessage paths, minus the broker.
+ */
+
+using namespace ADARA::ComBus;
+using boost::property_tree::ptree;
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+	if (!(cond)) { \
+		fprintf(stderr, "%s:%d: check failed: %s\n", \
+			__FILE__, __LINE__, #cond); \
+		failures++; \
+	} \
+} while (0)
+
+static void buildMetrics(ptree &pt, uint32_t seq)
+{
+	pt.put("msg_type", 0xA0C00008UL);
+	pt.put("src_id", "DASMON_0");
+	pt.put("dest_id", "");
+	pt.put("timestamp", 1700000000UL + seq);
+	pt.put("invalid_pkt_type", seq % 7);
+	pt.put("invalid_pkt", seq % 3);
+	pt.put("invalid_pkt_time", 0);
+	pt.put("duplicate_packet", seq % 5);
+	pt.put("pulse_freq_tol", 0);
+	pt.put("cycle_err", seq % 11);
+	pt.put("invalid_bank_id", 0);
+	pt.put("bank_source_mismatch", 0);
+	pt.put("duplicate_source", 0);
+	pt.put("duplicate_bank", 0);
+	pt.put("pixel_map_err", seq % 13);
+	pt.put("pixel_bank_mismatch", 0);
+	pt.put("pixel_invalid_tof", 0);
+	pt.put("pixel_unknown_id", seq % 17);
+	pt.put("pixel_errors", seq % 19);
+	pt.put("bad_ddp_xml", 0);
+	pt.put("bad_runinfo_xml", 0);
+	pt.put("count_rate", 123456.789 + seq);
+
+	ptree monitors;
+	for (uint32_t m = 0; m < 4; m++) {
+		ptree mon;
+		mon.put("id", m);
+		mon.put("rate", 1000.5 * (m + 1) + seq);
+		monitors.push_back(std::make_pair("", mon));
+	}
+	pt.add_child("monitors", monitors);
+}
+
+static void testRoundTrip(void)
+{
+	ptree in, out;
+	std::string buf;
+
+	buildMetrics(in, 42);
+	in.put("text", "quoted \"string\" with\nnewline and \xc3\xa9");
+	in.put("empty", "");
+
+	Codec::encode(in, buf);
+	CHECK(Codec::isCompact((const uint8_t *) buf.data(), buf.size()));
+
+	Codec::decode((const uint8_t *) buf.data(), buf.size(), out);
+	CHECK(in == out);
+	CHECK(out.get("msg_type", 0UL) == 0xA0C00008UL);
+	CHECK(out.get("text", "") == in.get("text", ""));
+	CHECK(out.get_child("monitors").size() == 4);
+
+	/* Every truncation of a valid buffer must be rejected, never
+	 * crash or decode to something else */
+	for (size_t len = 0; len < buf.size(); len++) {
+		bool threw = false;
+		try {
+			ptree bad;
+			Codec::decode((const uint8_t *) buf.data(), len, bad);
+		} catch (std::runtime_error &) {
+			threw = true;
+		}
+		CHECK(threw);
+	}
+
+	/* JSON payloads must not be mistaken for compact ones */
+	std::stringstream sstr;
+	write_json(sstr, in);
+	CHECK(!Codec::isCompact((const uint8_t *) sstr.str().data(),
+		sstr.str().size()));
+}
+
+/* Loopback "broker": the Coalescer's sender decodes and records what
+ * would have gone on the wire */
+struct Loopback {
+	boost::mutex			mutex;
+	std::vector<std::string>	keys;
+	std::vector<ptree>		msgs;
+
+	void send(const std::string &key, const Coalescer::Pending &p)
+	{
+		ptree pt;
+		Codec::decode((const uint8_t *) p.payload.data(),
+			p.payload.size(), pt);
+
+		boost::lock_guard<boost::mutex> lock(mutex);
+		keys.push_back(key);
+		msgs.push_back(pt);
+	}
+};
+
+static void testCoalescer(void)
+{
+	Loopback lb;
+
+	{
+		Coalescer co(boost::bind(&Loopback::send, &lb, _1, _2), 200);
+		std::string buf;
+
+		for (uint32_t seq = 0; seq < 100; seq++) {
+			ptree pt;
+			buildMetrics(pt, seq);
+			Codec::encode(pt, buf);
+			co.post("stream_metrics", "APP", buf, true);
+			CHECK(buf.empty());
+
+			ptree other;
+			other.put("status", seq);
+			Codec::encode(other, buf);
+			co.post("status", "STATUS", buf, true);
+		}
+
+		/* Nothing should have been sent inside the window */
+		{
+			boost::lock_guard<boost::mutex> lock(lb.mutex);
+			CHECK(lb.msgs.empty());
+		}
+
+		usleep(400000);
+
+		boost::lock_guard<boost::mutex> lock(lb.mutex);
+		CHECK(lb.msgs.size() == 2);
+		CHECK(co.getMergedCount() == 198);
+
+		/* Last value wins */
+		for (size_t i = 0; i < lb.msgs.size(); i++) {
+			if (lb.keys[i] == "status")
+				CHECK(lb.msgs[i].get("status", 0U) == 99);
+			else
+				CHECK(lb.msgs[i].get("timestamp", 0UL)
+					== 1700000000UL + 99);
+		}
+	}
+
+	/* Destructor flushes pending updates */
+	{
+		Coalescer co(boost::bind(&Loopback::send, &lb, _1, _2),
+			60000);
+		ptree pt;
+		std::string buf;
+		pt.put("status", 7);
+		Codec::encode(pt, buf);
+		co.post("status", "STATUS", buf, true);
+	}
+
+	CHECK(lb.msgs.size() == 3);
+	CHECK(lb.msgs.back().get("status", 0U) == 7);
+}
+
+static double elapsed(const struct timespec &a, const struct timespec &b)
+{
+	return (b.tv_sec - a.tv_sec) + (b.tv_nsec - a.tv_nsec) / 1e9;
+}
+
+static void benchmark(uint32_t iters)
+{
+	struct timespec t0, t1, t2;
+	size_t json_bytes = 0, compact_bytes = 0;
+
+	/* Message write() cost is the same for both paths, so build the
+	 * trees up front and time only the encode/decode steps */
+	std::vector<ptree> trees(256);
+	for (uint32_t i = 0; i < trees.size(); i++)
+		buildMetrics(trees[i], i);
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (uint32_t i = 0; i < iters; i++) {
+		ptree out;
+
+		std::stringstream wr;
+		write_json(wr, trees[i % trees.size()]);
+		std::string text = wr.str();
+		json_bytes += text.size();
+
+		std::stringstream rd(text);
+		read_json(rd, out);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	for (uint32_t i = 0; i < iters; i++) {
+		ptree out;
+		std::string buf;
+
+		Codec::encode(trees[i % trees.size()], buf);
+		compact_bytes += buf.size();
+
+		Codec::decode((const uint8_t *) buf.data(), buf.size(), out);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t2);
+
+	double json_s = elapsed(t0, t1), compact_s = elapsed(t1, t2);
+
+	printf("encode+decode %u metrics messages:\n", iters);
+	printf("  json    %8.0f msg/s  %5zu bytes/msg\n",
+		iters / json_s, json_bytes / iters);
+	printf("  compact %8.0f msg/s  %5zu bytes/msg  (%.1fx)\n",
+		iters / compact_s, compact_bytes / iters, json_s / compact_s);
+}
+
+int main(int argc, char **argv)
+{
+	testRoundTrip();
+	testCoalescer();
+
+	if (failures) {
+		fprintf(stderr, "%d check(s) failed\n", failures);
+		return 1;
+	}
+
+	benchmark(argc > 1 ? strtoul(argv[1], NULL, 0) : 20000);
+	return 0;
+}
@@ -80,6 +80,7 @@ namespace PacketType {
 		DATA_DONE_TYPE						=	0x400C,
 		BEAM_MONITOR_CONFIG_TYPE			=	0x400D,
 		DETECTOR_BANK_SETS_TYPE				=	0x400E,
+		HISTO_PREVIEW_TYPE					=	0x400F,
 		DEVICE_DESC_TYPE					=	0x8000,
 		VAR_VALUE_U32_TYPE					=	0x8001,
 		VAR_VALUE_DOUBLE_TYPE				=	0x8002,
@@ -106,7 +107,7 @@ namespace PacketType {
 		RUN_STATUS_VERSION					=	0x01,
 		RUN_INFO_VERSION					=	0x00,
 		TRANS_COMPLETE_VERSION				=	0x00,
-		CLIENT_HELLO_VERSION				=	0x01,
+		CLIENT_HELLO_VERSION				=	0x02,
 		STREAM_ANNOTATION_VERSION			=	0x00,
 		SYNC_VERSION						=	0x00,
 		HEARTBEAT_VERSION					=	0x00,
@@ -115,6 +116,7 @@ namespace PacketType {
 		DATA_DONE_VERSION					=	0x00,
 		BEAM_MONITOR_CONFIG_VERSION			=	0x01,
 		DETECTOR_BANK_SETS_VERSION			=	0x00,
+		HISTO_PREVIEW_VERSION				=	0x00,
 		DEVICE_DESC_VERSION					=	0x00,
 		VAR_VALUE_U32_VERSION				=	0x00,
 		VAR_VALUE_DOUBLE_VERSION			=	0x00,
@@ -585,12 +585,12 @@ ClientHelloPkt::ClientHelloPkt(const uint8_t *data, uint32_t len) :
 			<< m_payload_len;
 		throw invalid_packet(ss.str());
 	}
-	else if (m_version > ADARA::PacketType::CLIENT_HELLO_VERSION
+	else if (m_version >= 0x02
 			&& m_payload_len < (2 * sizeof(uint32_t))) {
 		std::stringstream ss;
 		ss << ( (uint32_t) (m_pulseId >> 32) )
 			<< "." << ( (uint32_t) m_pulseId );
-		ss << " Newer ClientHello packet is too short: "
+		ss << " ClientHello V2+ packet is too short: "
 			<< m_payload_len;
 		throw invalid_packet(ss.str());
 	}
@@ -600,11 +600,49 @@ ClientHelloPkt::ClientHelloPkt(const uint8_t *data, uint32_t len) :
 	m_reqStart = fields[0];
 
 	m_clientFlags = ( m_version > 0 ) ? fields[1] : 0;
+
+	m_eventDecimation = 1;
+
+	/* Version 2 may carry an extended subscription filter payload:
+	 *    decimation, type_count, types[type_count],
+	 *    bank_count, banks[bank_count]
+	 */
+	uint32_t words = m_payload_len / sizeof(uint32_t);
+	if (m_version >= 0x02 && words > 2) {
+		uint32_t type_count = 0, bank_count = 0;
+		bool ok = ( words >= 5 );
+		if (ok) {
+			type_count = fields[3];
+			ok = ( type_count <= words - 5 );
+		}
+		if (ok) {
+			bank_count = fields[4 + type_count];
+			ok = ( words == 5 + type_count + bank_count );
+		}
+		if (!ok) {
+			std::stringstream ss;
+			ss << ( (uint32_t) (m_pulseId >> 32) )
+				<< "." << ( (uint32_t) m_pulseId );
+			ss << " ClientHello V2 filter payload is malformed: "
+				<< m_payload_len;
+			throw invalid_packet(ss.str());
+		}
+
+		if (m_clientFlags & DECIMATE_EVENTS && fields[2] > 1)
+			m_eventDecimation = fields[2];
+		if (m_clientFlags & FILTER_PKT_TYPES)
+			m_pktTypes.assign(fields + 4, fields + 4 + type_count);
+		if (m_clientFlags & FILTER_BANKS)
+			m_banks.assign(fields + 5 + type_count,
+				fields + 5 + type_count + bank_count);
+	}
 }
 
 ClientHelloPkt::ClientHelloPkt(const ClientHelloPkt &pkt) :
 	Packet(pkt), m_reqStart(pkt.m_reqStart),
-	m_clientFlags(pkt.m_clientFlags)
+	m_clientFlags(pkt.m_clientFlags),
+	m_eventDecimation(pkt.m_eventDecimation),
+	m_pktTypes(pkt.m_pktTypes), m_banks(pkt.m_banks)
 {}
 
 /* -------------------------------------------------------------------- */
@@ -1217,6 +1255,85 @@ DataDonePkt::DataDonePkt(const DataDonePkt &pkt) :
 
 /* -------------------------------------------------------------------- */
 
+HistoPreviewPkt::HistoPreviewPkt(const uint8_t *data, uint32_t len) :
+	Packet(data, len), m_fields((const uint32_t *) payload())
+{
+	uint32_t words = m_payload_len / sizeof(uint32_t);
+	const char *why = NULL;
+
+	if (m_version == 0x00 && words < 4)
+		why = " HistoPreview V0 packet is too short: ";
+	else if (m_version > ADARA::PacketType::HISTO_PREVIEW_VERSION
+			&& words < 4)
+		why = " Newer HistoPreview packet is too short: ";
+
+	/* Walk the sections, checking each run fits */
+	uint32_t pos = 4;
+	for (uint32_t i = 0; !why && i < sectionCount(); i++) {
+		if (words - pos < SECTION_HEADER_WORDS) {
+			why = " HistoPreview section header runs off the end: ";
+			break;
+		}
+		m_sectionOffsets.push_back(pos);
+
+		uint32_t bins = m_fields[pos + 4];
+		uint32_t runs = m_fields[pos + 5];
+		pos += SECTION_HEADER_WORDS;
+
+		while (runs--) {
+			if (words - pos < 2) {
+				why = " HistoPreview run header runs off the end: ";
+				break;
+			}
+			uint32_t start = m_fields[pos], count = m_fields[pos + 1];
+			pos += 2;
+			if (start > bins || count > bins - start
+					|| words - pos < count) {
+				why = " HistoPreview run is out of range: ";
+				break;
+			}
+			pos += count;
+		}
+	}
+
+	if (why) {
+		std::stringstream ss;
+		ss << ( (uint32_t) (m_pulseId >> 32) )
+			<< "." << ( (uint32_t) m_pulseId );
+		ss << why << m_payload_len;
+		throw invalid_packet(ss.str());
+	}
+}
+
+HistoPreviewPkt::HistoPreviewPkt(const HistoPreviewPkt &pkt) :
+	Packet(pkt), m_fields((const uint32_t *) payload()),
+	m_sectionOffsets(pkt.m_sectionOffsets)
+{}
+
+void HistoPreviewPkt::accumulate(uint32_t index,
+		std::vector<uint32_t> &bins) const
+{
+	if (index >= m_sectionOffsets.size())
+		return;
+
+	const uint32_t *p = m_fields + m_sectionOffsets[index];
+	uint32_t runs = p[5];
+
+	if (bins.size() < p[4])
+		bins.resize(p[4]);
+
+	p += SECTION_HEADER_WORDS;
+	while (runs--) {
+		uint32_t start = p[0], count = p[1];
+		p += 2;
+		for (uint32_t i = 0; i < count; i++)
+			bins[start + i] += p[i];
+		p += count;
+	}
+}
+
+/* -------------------------------------------------------------------- */
+
 DeviceDescriptorPkt::DeviceDescriptorPkt(
 	const uint8_t *data, uint32_t len) :
 	Packet(data, len)
@@ -445,14 +445,36 @@ public:
 		PAUSE_AGNOSTIC    = 0x0000,
 		NO_PAUSE_DATA     = 0x0001,
 		SEND_PAUSE_DATA   = 0x0002,
+		// Version 2 Subscription Filters...
+		METADATA_ONLY     = 0x0004,
+		FILTER_PKT_TYPES  = 0x0008,
+		FILTER_BANKS      = 0x0010,
+		DECIMATE_EVENTS   = 0x0020,
+		HISTO_PREVIEW     = 0x0040,
 	};
 
+	static const uint32_t FILTER_MASK =
+		METADATA_ONLY | FILTER_PKT_TYPES | FILTER_BANKS | DECIMATE_EVENTS
+		| HISTO_PREVIEW;
+
 	uint32_t requestedStartTime(void) const { return m_reqStart; }
 	uint32_t clientFlags(void) const { return m_clientFlags; }
 
+	/* Version 2 extended payload, only meaningful when the
+	 * matching flag is set (and empty/1 otherwise)
+	 */
+	uint32_t eventDecimation(void) const { return m_eventDecimation; }
+	const std::vector<uint32_t> &packetTypes(void) const
+		{ return m_pktTypes; }
+	const std::vector<uint32_t> &detectorBanks(void) const
+		{ return m_banks; }
+
 private:
 	uint32_t m_reqStart;
 	uint32_t m_clientFlags;
+	uint32_t m_eventDecimation;
+	std::vector<uint32_t> m_pktTypes;
+	std::vector<uint32_t> m_banks;
 
 	ClientHelloPkt(const uint8_t *data, uint32_t len);
 
@@ -802,6 +824,62 @@ private:
 	friend class Parser;
 };
 
+/* Live preview histograms, sent by the SMS instead of neutron events to
+ * clients that asked for HISTO_PREVIEW. Each section covers one detector
+ * bank's TOF histogram (or the per-pixel counts), and holds only the
+ * counts accumulated since the previous preview packet, as runs of
+ * non-zero bins.
+ */
+class HistoPreviewPkt : public Packet {
+public:
+	HistoPreviewPkt(const HistoPreviewPkt &pkt);
+
+	enum SectionKind {
+		BANK_TOF     = 0,
+		PIXEL_COUNTS = 1,
+	};
+
+	uint32_t pulseCount(void) const { return m_fields[0]; }
+	uint32_t eventCount(void) const { return m_fields[1]; }
+	uint32_t eventDecimation(void) const { return m_fields[2]; }
+	uint32_t sectionCount(void) const { return m_fields[3]; }
+
+	uint32_t bankId(uint32_t index) const
+		{ return section(index)[0]; }
+	SectionKind kind(uint32_t index) const
+		{ return (SectionKind) section(index)[1]; }
+	/* First TOF (microseconds) or pixel id */
+	uint32_t base(uint32_t index) const
+		{ return section(index)[2]; }
+	/* TOF bin width (microseconds), 1 for pixel counts */
+	uint32_t binWidth(uint32_t index) const
+		{ return section(index)[3]; }
+	uint32_t binCount(uint32_t index) const
+		{ return section(index)[4]; }
+
+	/* Add the section's counts into a dense histogram of binCount()
+	 * bins, growing it if needed.
+	 */
+	void accumulate(uint32_t index, std::vector<uint32_t> &bins) const;
+
+	static const uint32_t SECTION_HEADER_WORDS = 6;
+
+private:
+	const uint32_t *m_fields;
+	std::vector<uint32_t> m_sectionOffsets;
+
+	const uint32_t *section(uint32_t index) const {
+		static const uint32_t none[SECTION_HEADER_WORDS] = { 0 };
+		if ( index < m_sectionOffsets.size() )
+			return( m_fields + m_sectionOffsets[index] );
+		return( none );
+	}
+
+	HistoPreviewPkt(const uint8_t *data, uint32_t len);
+
+	friend class Parser;
+};
+
 class DataDonePkt : public Packet {
 public:
 	DataDonePkt(const DataDonePkt &pkt);
@@ -284,6 +284,7 @@ bool Parser::rxPacket(const Packet &pkt)
 		MAP_TYPE(PacketType::BEAM_MONITOR_CONFIG_TYPE,
 			BeamMonitorConfigPkt);
 		MAP_TYPE(PacketType::DETECTOR_BANK_SETS_TYPE, DetectorBankSetsPkt);
+		MAP_TYPE(PacketType::HISTO_PREVIEW_TYPE, HistoPreviewPkt);
 		MAP_TYPE(PacketType::DATA_DONE_TYPE, DataDonePkt);
 		MAP_TYPE(PacketType::DEVICE_DESC_TYPE, DeviceDescriptorPkt);
 		MAP_TYPE(PacketType::VAR_VALUE_U32_TYPE, VariableU32Pkt);
@@ -352,6 +353,7 @@ EXPAND_HANDLER(GeometryPkt)
 EXPAND_HANDLER(BeamlineInfoPkt)
 EXPAND_HANDLER(BeamMonitorConfigPkt)
 EXPAND_HANDLER(DetectorBankSetsPkt)
+EXPAND_HANDLER(HistoPreviewPkt)
 EXPAND_HANDLER(DataDonePkt)
 EXPAND_HANDLER(DeviceDescriptorPkt)
 EXPAND_HANDLER(VariableU32Pkt)
@@ -153,6 +153,7 @@ protected:
 	virtual bool rxPacket(const BeamlineInfoPkt &pkt);
 	virtual bool rxPacket(const BeamMonitorConfigPkt &pkt);
 	virtual bool rxPacket(const DetectorBankSetsPkt &pkt);
+	virtual bool rxPacket(const HistoPreviewPkt &pkt);
 	virtual bool rxPacket(const DataDonePkt &pkt);
 	virtual bool rxPacket(const DeviceDescriptorPkt &pkt);
 	virtual bool rxPacket(const VariableU32Pkt &pkt);
@@ -0,0 +1,209 @@
+#ifndef __ADARA_PULSE_INDEX_H
+#define __ADARA_PULSE_INDEX_H
+
+#include <string>
+
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* Pulse index sidecar files, written by the SMS next to each raw data
+ * file ("m00000001-f00000002-run-1234.adara" gets
+ * "m00000001-f00000002-run-1234.pidx") so readers can seek into a data
+ * file without parsing it from the start.
+ *
+ * Layout (native byte order, like the data files):
+ *
+ *	PulseIndexHeader
+ *	PulseIndexEntry[num_entries]
+ *	PulseIndexTypeCount[num_types]	\  only once the data file
+ *	PulseIndexFooter		/  has been closed out
+ *
+ * An entry is added each time the data file reaches a pulse id higher
+ * than any before it, at least "indexdist" bytes after the previous
+ * entry. So the entries are sorted by pulse id, file offset and (SMS
+ * host) wall clock time, and reading the data file from an entry's
+ * offset sees every packet of that pulse and all later pulses.
+ *
+ * Entries are appended while the data file is being written, so a
+ * reader may find an index with no footer; every whole entry in it is
+ * still good.
+ */
+
+namespace ADARA {
+
+#define ADARA_PULSE_INDEX_MAGIC		"ADARAPIX"
+#define ADARA_PULSE_INDEX_VERSION	1
+#define ADARA_PULSE_INDEX_FOOTER_MAGIC	0x58495041	/* "APIX" */
+
+struct PulseIndexHeader {
+	char		magic[8];
+	uint32_t	version;
+	uint32_t	entry_size;
+} __attribute__((packed));
+
+struct PulseIndexEntry {
+	uint64_t	pulse_id;	// EPICS Time, sec << 32 | nsec
+	uint64_t	offset;		// of the first packet with this pulse id
+	uint32_t	wall_sec;	// EPICS Time when the SMS wrote it
+	uint32_t	wall_nsec;
+} __attribute__((packed));
+
+struct PulseIndexTypeCount {
+	uint32_t	pkt_type;	// Base Type, Version Stripped
+	uint32_t	reserved;
+	uint64_t	count;
+} __attribute__((packed));
+
+struct PulseIndexFooter {
+	uint64_t	num_entries;
+	uint32_t	num_types;
+	uint32_t	magic;
+} __attribute__((packed));
+
+/* Read-only, mmap()ed view of a pulse index sidecar */
+class PulseIndex {
+public:
+	PulseIndex() : m_map(NULL), m_map_len(0), m_entries(NULL),
+		m_num_entries(0), m_types(NULL), m_num_types(0) { }
+
+	~PulseIndex() { close(); }
+
+	/* Sidecar path for a given data file path */
+	static std::string sidecarPath(const std::string &data_path) {
+		std::string path(data_path);
+		size_t dot = path.rfind(".adara");
+		if (dot != std::string::npos && dot + 6 == path.size())
+			path.erase(dot);
+		return path + ".pidx";
+	}
+
+	/* Returns false if there's no usable index at path */
+	bool open(const std::string &path) {
+		close();
+
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			return false;
+
+		struct stat st;
+		if (fstat(fd, &st) || (size_t) st.st_size
+				< sizeof(PulseIndexHeader)) {
+			::close(fd);
+			return false;
+		}
+
+		void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+		::close(fd);
+		if (map == MAP_FAILED)
+			return false;
+
+		m_map = (const uint8_t *) map;
+		m_map_len = st.st_size;
+
+		const PulseIndexHeader *hdr = (const PulseIndexHeader *) m_map;
+		if (memcmp(hdr->magic, ADARA_PULSE_INDEX_MAGIC, sizeof(hdr->magic))
+				|| hdr->version != ADARA_PULSE_INDEX_VERSION
+				|| hdr->entry_size != sizeof(PulseIndexEntry)) {
+			close();
+			return false;
+		}
+
+		m_entries = (const PulseIndexEntry *)
+			(m_map + sizeof(PulseIndexHeader));
+		m_num_entries = (m_map_len - sizeof(PulseIndexHeader))
+			/ sizeof(PulseIndexEntry);
+
+		/* Closed out? Then trust the footer's counts */
+		if (m_map_len >= sizeof(PulseIndexHeader)
+				+ sizeof(PulseIndexFooter)) {
+			const PulseIndexFooter *ftr = (const PulseIndexFooter *)
+				(m_map + m_map_len - sizeof(PulseIndexFooter));
+			size_t want = sizeof(PulseIndexHeader)
+				+ ftr->num_entries * sizeof(PulseIndexEntry)
+				+ ftr->num_types * sizeof(PulseIndexTypeCount)
+				+ sizeof(PulseIndexFooter);
+			if (ftr->magic == ADARA_PULSE_INDEX_FOOTER_MAGIC
+					&& want == m_map_len) {
+				m_num_entries = ftr->num_entries;
+				m_types = (const PulseIndexTypeCount *)
+					(m_entries + m_num_entries);
+				m_num_types = ftr->num_types;
+			}
+		}
+
+		return true;
+	}
+
+	void close(void) {
+		if (m_map)
+			munmap((void *) m_map, m_map_len);
+		m_map = NULL;
+		m_map_len = 0;
+		m_entries = NULL;
+		m_num_entries = 0;
+		m_types = NULL;
+		m_num_types = 0;
+	}
+
+	/* The data file was closed out (and the type counts written) */
+	bool complete(void) const { return m_types != NULL; }
+
+	uint64_t numEntries(void) const { return m_num_entries; }
+	const PulseIndexEntry &entry(uint64_t i) const { return m_entries[i]; }
+
+	uint32_t numTypes(void) const { return m_num_types; }
+	const PulseIndexTypeCount &typeCount(uint32_t i) const {
+		return m_types[i];
+	}
+
+	/* Offset to start reading from to see every packet for pulse_id
+	 * and later; 0 if that's before the first entry.
+	 */
+	uint64_t seekPulse(uint64_t pulse_id) const {
+		uint64_t lo = 0, hi = m_num_entries;
+		while (lo < hi) {
+			uint64_t mid = lo + (hi - lo) / 2;
+			if (m_entries[mid].pulse_id <= pulse_id)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		return lo ? m_entries[lo - 1].offset : 0;
+	}
+
+	/* Same, by the (EPICS) wall clock time the SMS wrote the data */
+	uint64_t seekTime(uint32_t sec, uint32_t nsec) const {
+		uint64_t t = ((uint64_t) sec << 32) | nsec;
+		uint64_t lo = 0, hi = m_num_entries;
+		while (lo < hi) {
+			uint64_t mid = lo + (hi - lo) / 2;
+			uint64_t w = ((uint64_t) m_entries[mid].wall_sec << 32)
+				| m_entries[mid].wall_nsec;
+			if (w <= t)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		return lo ? m_entries[lo - 1].offset : 0;
+	}
+
+private:
+	const uint8_t *m_map;
+	size_t m_map_len;
+	const PulseIndexEntry *m_entries;
+	uint64_t m_num_entries;
+	const PulseIndexTypeCount *m_types;
+	uint32_t m_num_types;
+
+	/* Not copyable */
+	PulseIndex(const PulseIndex &);
+	PulseIndex &operator=(const PulseIndex &);
+};
+
+} /* namespace ADARA */
+
+#endif /* __ADARA_PULSE_INDEX_H */
@@ -381,194 +381,265 @@ class RateLimitedLogging {
 
 public:
 
-	typedef
-		std::map<std::pair<uint32_t, std::string>, std::vector<int64_t> >
-			History;
+	/// Registered log site, as an index into its History
+	typedef uint32_t Handle;
 
 	/**
-	 * @brief Rate-Limited Logging Method
+	 * @brief Rate-Limited Logging State for One Log Site
+	 *
+	 * Only the most recent "threshold" occurrence times are needed to
+	 * decide whether we're over threshold (i.e. whether the oldest of
+	 * them is still inside the window), so they're kept in a fixed ring
+	 * allocated once when the log site is registered.
+	 **/
+	struct Site {
+		uint32_t window_seconds;
+		uint32_t threshold;
+		uint32_t log_rate;
+		std::vector<time_t> times; // ring of last "threshold" times
+		uint32_t next;             // next ring slot to overwrite
+		uint32_t count;            // times recorded (up to ring size)
+		bool thrashing;            // over threshold at last check
+		uint64_t burst;            // occurrences since over threshold
+		uint64_t suppressed;       // occurrences not logged since last
+	};
+
+	/**
+	 * @brief Registry of Log Sites
+	 *
+	 * Log sites are registered by (log_id, log_name) or, for callers
+	 * that would otherwise format a number into a name on every call,
+	 * by (log_id, integer key). Registration allocates; checks against
+	 * a registered Handle never do.
+	 **/
+	class History {
+	public:
+		Handle lookup( const uint32_t log_id,
+			const std::string & log_name,
+			const uint32_t window_seconds,
+			const uint32_t threshold, const uint32_t log_rate )
+		{
+			std::pair<uint32_t, std::string> log(log_id, log_name);
+			std::map<std::pair<uint32_t, std::string>, Handle>::iterator
+				it = m_names.find(log);
+			if ( it == m_names.end() ) {
+				it = m_names.insert( it, std::make_pair( log,
+					add( window_seconds, threshold, log_rate ) ) );
+			}
+			return( check( it->second,
+				window_seconds, threshold, log_rate ) );
+		}
+
+		Handle lookup( const uint32_t log_id, const uint64_t log_key,
+			const uint32_t window_seconds,
+			const uint32_t threshold, const uint32_t log_rate )
+		{
+			std::pair<uint32_t, uint64_t> log(log_id, log_key);
+			std::map<std::pair<uint32_t, uint64_t>, Handle>::iterator
+				it = m_keys.find(log);
+			if ( it == m_keys.end() ) {
+				it = m_keys.insert( it, std::make_pair( log,
+					add( window_seconds, threshold, log_rate ) ) );
+			}
+			return( check( it->second,
+				window_seconds, threshold, log_rate ) );
+		}
+
+		Site & site( Handle h ) { return( m_sites[h] ); }
+
+	private:
+		std::map<std::pair<uint32_t, std::string>, Handle> m_names;
+		std::map<std::pair<uint32_t, uint64_t>, Handle> m_keys;
+		std::vector<Site> m_sites;
+
+		Handle add( const uint32_t window_seconds,
+			const uint32_t threshold, const uint32_t log_rate )
+		{
+			m_sites.push_back( Site() );
+			configure( m_sites.back(), window_seconds, threshold, log_rate );
+			return( (Handle) ( m_sites.size() - 1 ) );
+		}
+
+		// Same Log Site Called with Different Limits? Latest Ones Win...
+		Handle check( Handle h, const uint32_t window_seconds,
+			const uint32_t threshold, const uint32_t log_rate )
+		{
+			Site &s = m_sites[h];
+			if ( s.window_seconds != window_seconds
+					|| s.threshold != threshold
+					|| s.log_rate != log_rate ) {
+				configure( s, window_seconds, threshold, log_rate );
+			}
+			return( h );
+		}
+
+		static void configure( Site & s, const uint32_t window_seconds,
+			const uint32_t threshold, const uint32_t log_rate )
+		{
+			s.window_seconds = window_seconds;
+			s.threshold = threshold;
+			s.log_rate = log_rate;
+			s.times.assign( threshold ? threshold : 1, 0 );
+			s.next = 0;
+			s.count = 0;
+			s.thrashing = false;
+			s.burst = 0;
+			s.suppressed = 0;
+		}
+	};
+
+	/**
+	 * @brief Register a Log Site (Once) for Use with checkLog(Handle)
 	 * @param log_id - log message identification number (caller supplied)
 	 * @param log_name - (optional) additional log originator name
-	 * @param log_info - (any) rate-limited logging commentary to prepend
-	 * @return true on ok-to-log, false on don't-log
+	 * @return log site handle
 	 **/
-	static bool checkLog( History & log_history,
+	static Handle registerLog( History & log_history,
 		const uint32_t log_id, const std::string & log_name,
 		const uint32_t window_seconds,
-		const uint32_t threshold, const uint32_t log_rate,
+		const uint32_t threshold, const uint32_t log_rate )
+	{
+		return( log_history.lookup( log_id, log_name,
+			window_seconds, threshold, log_rate ) );
+	}
+
+	static Handle registerLog( History & log_history,
+		const uint32_t log_id, const uint64_t log_key,
+		const uint32_t window_seconds,
+		const uint32_t threshold, const uint32_t log_rate )
+	{
+		return( log_history.lookup( log_id, log_key,
+			window_seconds, threshold, log_rate ) );
+	}
+
+	/**
+	 * @brief Rate-Limited Logging Method
+	 * @param log_handle - log site, from registerLog()
+	 * @param log_info - (any) rate-limited logging commentary to prepend
+	 * @return true on ok-to-log, false on don't-log
+	 *
+	 * Occurrences under "threshold" per "window_seconds" are always
+	 * logged; past that, only every "log_rate"th one is, with commentary,
+	 * until the rate drops back under threshold.
+	 **/
+	static bool checkLog( History & log_history, Handle log_handle,
 		std::string & log_info )
 	{
-		std::pair<uint32_t,std::string> log(log_id, log_name);
+		Site &s = log_history.site( log_handle );
 
 		log_info.clear();
 
-		// Append Current Time/Occurrence...
+		// Seconds are all we need, so the Coarse Clock will do...
 		struct timespec ts;
-		clock_gettime(CLOCK_REALTIME, &ts);
-
-		History::iterator lh = log_history.find(log);
+		clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
 
-		if ( lh == log_history.end() )
-		{
-			std::vector<int64_t> new_time_vec;
-			lh = log_history.insert( lh,
-				std::pair<std::pair<uint32_t, std::string>,
-					std::vector<int64_t> >
-				(log, new_time_vec) );
-		}
+		uint32_t ring = (uint32_t) s.times.size();
 
-		lh->second.push_back( static_cast<int64_t>(ts.tv_sec) );
-
-		// std::stringstream sss;
-		// sss << "[checkLog(";
-		// sss << log_id;
-		// sss << ", ";
-		// sss << log_name;
-		// sss << ") time=";
-		// sss << ts.tv_sec;
-		// sss << " size=";
-		// sss << lh->second.size();
-		// sss << "] ";
-		// log_info.append(sss.str());
-
-		// *Clear* Any Old Timestamps... (Don't "Remove" Until Next Log!)
-		uint32_t old = 0;
-		while ( old < lh->second.size()
-				&& ( ts.tv_sec - labs(lh->second[old]) ) > window_seconds )
-		{
-			// std::stringstream ss;
-			// ss << "[Marking old time index=";
-			// ss << old;
-			// ss << " time=";
-			// ss << lh->second[old];
-			// ss << "] ";
-			// log_info.append(ss.str());
-
-			// Retain "Already Logged" Information...
-			if ( lh->second[old] < 0 )
-				lh->second[old] = -1;
-			else
-				lh->second[old] = 0;
+		s.times[s.next] = ts.tv_sec;
+		if ( ++s.next == ring )
+			s.next = 0;
+		if ( s.count < ring )
+			s.count++;
 
-			old++;
-		}
+		// Oldest of the Last "threshold" Times is Next to be Overwritten
+		bool over = ( s.count == ring
+			&& ( ts.tv_sec - s.times[s.next] )
+				<= (time_t) s.window_seconds );
 
-		// See if Things have Calmed Down now...
-		// If so, then Reset the Threshold & Flush the Timestamp Vector!
-		bool resetThresh = false;
-		if ( lh->second.size() >= threshold
-				&& lh->second.size() - old < threshold )
-		{
-			std::stringstream ss;
-			ss << "[*** Reset Threshold, Log Rate has Slowed! ";
-			ss << old;
-			ss << " Timestamps Marked Old out of ";
-			ss << lh->second.size();
-			ss << " Total Saved";
-			if ( lh->second.size() == old + 1 )
-				ss << " [ALL OLD]";
-			ss << ", Now Under Threshold of ";
-			ss << threshold;
-			ss << ".] ";
-			log_info.append(ss.str());
-
-			resetThresh = true;
-		}
-
-		// Check Occurrences in Latest Window Interval...
-		if ( lh->second.size() >= threshold && !resetThresh )
+		// It's Ok, Just Log It.
+		if ( !over )
 		{
-			// While Thrashing, Still Log Every "Nth" One...
-			if ( !( ( lh->second.size() - threshold ) % log_rate) )
+			// See if Things have Calmed Down now...
+			if ( s.thrashing )
 			{
-				// Count How Many "New" (Unlogged) Timestamps We Have...
-				uint32_t newLogs = 0;
-				int64_t ri = lh->second.size() - 1;
-				while ( ri >= 0 && lh->second[ri] >= 0 ) {
-					newLogs++; ri--;
-				}
-
-				// Mark This Most Recent Timestamp as "Logged"...
-				lh->second[ lh->second.size() - 1 ] *= -1;
-
-				// Log How Badly We're Thrashing on This Log Message...
 				std::stringstream ss;
-				ss << "[*** Rate-Limited Log: ";
-				ss << lh->second.size() - old;
-				ss << " Occurrences (";
-				ss << newLogs;
-				ss << " New) in Last ";
-				ss << window_seconds;
-				ss << " Seconds!";
-				ss << " (thresh=";
-				ss << threshold;
-				ss << ", rate=";
-				ss << log_rate;
-				ss << ", old=";
-				ss << old;
-				ss << ")] ";
+				ss << "[*** Reset Threshold, Log Rate has Slowed! ";
+				ss << s.suppressed;
+				ss << " Occurrences Not Logged";
+				ss << ", Now Under Threshold of ";
+				ss << s.threshold;
+				ss << ".] ";
 				log_info.append(ss.str());
 
-				// _NOW_ Erase Any Old ("Cleared") Timestamps... ;-D
-				// (Yet Only Erase in "Log Rate-Sized" Chunks, to
-				// Prevent Getting "Stuck", i.e. 1 Erase per 1 New Log...)
-				while ( old >= log_rate )
-				{
-					uint32_t cnt = 0;
-					while ( lh->second.size() > 0
-							&& ( lh->second[0] == 0 || lh->second[0] == -1 )
-							&& cnt++ < log_rate )
-					{
-						// log_info.append("[Erasing old time.]");
-						lh->second.erase( lh->second.begin() );
-					}
-
-					old -= log_rate;
-				}
-
-				return( true );
+				s.thrashing = false;
 			}
 
-			else {
+			s.burst = 0;
+			s.suppressed = 0;
 
-				// Don't Log! Thrashing... ;-Q
-				// std::stringstream ss;
-				// ss <<"[DON'T Log: ";
-				// ss << lh->second.size();
-				// ss << " Occurrences in Last ";
-				// ss << window_seconds;
-				// ss << " Seconds!";
-				// ss << " (thresh=";
-				// ss << threshold;
-				// ss << ", rate=";
-				// ss << log_rate;
-				// ss << ", old=";
-				// ss << old;
-				// ss << ")] ";
-				// log_info.append(ss.str());
-
-				return( false );
-			}
+			return( true );
 		}
 
-		// It's Ok, Just Log It.
-		else {
+		if ( !s.thrashing )
+		{
+			s.thrashing = true;
+			s.burst = 0;
+			s.suppressed = 0;
+		}
 
-			// Be Sure to Erase Any Old ("Cleared") Timestamps...! ;-D
-			while ( lh->second.size() > 0
-					&& ( lh->second[0] == 0 || lh->second[0] == -1 ) )
-			{
-				// log_info.append("[Erasing old time.]");
-				lh->second.erase( lh->second.begin() );
-			}
+		// While Thrashing, Still Log Every "Nth" One...
+		if ( !( s.burst++ % ( s.log_rate ? s.log_rate : 1 ) ) )
+		{
+			// Log How Badly We're Thrashing on This Log Message...
+			std::stringstream ss;
+			ss << "[*** Rate-Limited Log: ";
+			ss << s.burst + ring - 1;
+			ss << " Occurrences (";
+			ss << s.suppressed + 1;
+			ss << " New) Since Exceeding Threshold in ";
+			ss << s.window_seconds;
+			ss << " Seconds!";
+			ss << " (thresh=";
+			ss << s.threshold;
+			ss << ", rate=";
+			ss << s.log_rate;
+			ss << ")] ";
+			log_info.append(ss.str());
 
-			// Mark This Most Recent Timestamp as "Logged"...
-			lh->second[ lh->second.size() - 1 ] *= -1;
+			s.suppressed = 0;
 
-			// No rate-limited logging commentary required...
-			// log_info.append("[Under Threshold, Log Normally.]");
 			return( true );
 		}
+
+		// Don't Log! Thrashing... ;-Q
+		s.suppressed++;
+
+		return( false );
+	}
+
+	/**
+	 * @brief Rate-Limited Logging Method (Looks Up the Log Site Each Time)
+	 * @param log_id - log message identification number (caller supplied)
+	 * @param log_name - (optional) additional log originator name
+	 * @param log_info - (any) rate-limited logging commentary to prepend
+	 * @return true on ok-to-log, false on don't-log
+	 **/
+	static bool checkLog( History & log_history,
+		const uint32_t log_id, const std::string & log_name,
+		const uint32_t window_seconds,
+		const uint32_t threshold, const uint32_t log_rate,
+		std::string & log_info )
+	{
+		return( checkLog( log_history,
+			log_history.lookup( log_id, log_name,
+				window_seconds, threshold, log_rate ),
+			log_info ) );
+	}
+
+	/**
+	 * @brief Rate-Limited Logging Method, Integer Key Instead of Name
+	 * (No string formatting or allocation once the site exists)
+	 **/
+	static bool checkLog( History & log_history,
+		const uint32_t log_id, const uint64_t log_key,
+		const uint32_t window_seconds,
+		const uint32_t threshold, const uint32_t log_rate,
+		std::string & log_info )
+	{
+		return( checkLog( log_history,
+			log_history.lookup( log_id, log_key,
+				window_seconds, threshold, log_rate ),
+			log_info ) );
 	}
 };
 
@@ -0,0 +1,428 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include <string>
+#include <vector>
+
+#include "AsyncLog.h"
+
+using namespace ADARA;
+
+/* ------------------------------------------------------------------------ */
+
+namespace {
+
+/* Longer messages are truncated; syslog would do the same */
+enum { TEXT_SIZE = 1024 - 16, QUEUE_RECORDS = 128 };
+
+struct Record {
+	uint64_t	m_time;		// CLOCK_REALTIME, ns
+	int32_t		m_priority;
+	uint32_t	m_len;
+	char		m_text[TEXT_SIZE];
+};
+
+/* One producer (the owning thread), one consumer (the drain thread).
+ * The producer only writes m_tail, the consumer only writes m_head.
+ */
+struct ThreadQueue {
+	Record			m_ring[QUEUE_RECORDS];
+	volatile uint32_t	m_head;
+	volatile uint32_t	m_tail;
+	volatile uint32_t	m_dropped;
+	volatile bool		m_orphaned;	// owning thread has exited
+
+	ThreadQueue() : m_head(0), m_tail(0), m_dropped(0),
+		m_orphaned(false) { }
+
+	bool empty(void) const { return m_head == m_tail; }
+};
+
+pthread_mutex_t g_mutex = PTHREAD_MUTEX_INITIALIZER;
+std::vector<ThreadQueue *> *g_queues = NULL;	// under g_mutex
+pthread_t g_drain;
+bool g_started = false;				// under g_mutex
+pthread_key_t g_key;
+pthread_once_t g_once = PTHREAD_ONCE_INIT;
+
+__thread ThreadQueue *t_queue = NULL;
+
+volatile uint32_t g_rateLimit = 200;
+volatile bool g_syslog = true;
+volatile int g_fd = -1;
+
+/* The idle drain thread sleeps on g_wakeSeq; producers only bump it
+ * (and make the futex call) when g_drainWaiting says it's asleep.
+ */
+volatile int g_wakeSeq = 0;
+volatile bool g_drainWaiting = false;
+
+volatile uint64_t g_written = 0;
+volatile uint64_t g_dropped = 0;
+volatile uint64_t g_suppressed = 0;
+
+uint64_t now_ns(clockid_t clock)
+{
+	struct timespec ts;
+	clock_gettime(clock, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void drainWait(int seq)
+{
+	/* Wake up now and then anyway, to clean up after exited threads */
+	struct timespec ts = { 1, 0 };
+	syscall(SYS_futex, &g_wakeSeq, FUTEX_WAIT_PRIVATE, seq, &ts,
+		NULL, 0);
+}
+
+void drainWake(void)
+{
+	__sync_add_and_fetch(&g_wakeSeq, 1);
+	syscall(SYS_futex, &g_wakeSeq, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+
+void threadExit(void *arg)
+{
+	/* The drain thread frees the queue once it's empty */
+	static_cast<ThreadQueue *>(arg)->m_orphaned = true;
+}
+
+void write_record(const Record &r, bool count = true)
+{
+	if (g_syslog)
+		syslog(r.m_priority, "%.*s", (int) r.m_len, r.m_text);
+
+	int fd = g_fd;
+	if (fd >= 0) {
+		char line[TEXT_SIZE + 64];
+		time_t secs = r.m_time / 1000000000ULL;
+		struct tm tm;
+		localtime_r(&secs, &tm);
+
+		size_t n = strftime(line, 32, "%Y-%m-%d %H:%M:%S", &tm);
+		n += snprintf(line + n, sizeof(line) - n, ".%06u <%d> %.*s\n",
+			(uint32_t) (r.m_time % 1000000000ULL / 1000),
+			r.m_priority & LOG_PRIMASK, (int) r.m_len, r.m_text);
+		if (n > sizeof(line) - 1)
+			n = sizeof(line) - 1;
+
+		/* Nothing useful to do if this fails */
+		if (write(fd, line, n) < 0) { }
+	}
+
+	if (count)
+		__sync_add_and_fetch(&g_written, 1);
+}
+
+/* Write out everything queued, oldest first; returns true if there
+ * was anything to do.
+ */
+bool drain(std::vector<ThreadQueue *> &queues)
+{
+	bool worked = false;
+
+	for (;;) {
+		ThreadQueue *oldest = NULL;
+		for (uint32_t i = 0; i < queues.size(); i++) {
+			ThreadQueue *q = queues[i];
+			if (q->empty())
+				continue;
+			__sync_synchronize();
+			if (!oldest || q->m_ring[q->m_head].m_time
+					< oldest->m_ring[oldest->m_head].m_time)
+				oldest = q;
+		}
+		if (!oldest)
+			break;
+
+		write_record(oldest->m_ring[oldest->m_head]);
+		__sync_synchronize();
+		oldest->m_head = ( oldest->m_head + 1 ) % QUEUE_RECORDS;
+		worked = true;
+	}
+
+	/* Report (and forget) drops */
+	uint32_t dropped = 0;
+	for (uint32_t i = 0; i < queues.size(); i++) {
+		if (queues[i]->m_dropped)
+			dropped += __sync_lock_test_and_set(&queues[i]->m_dropped, 0);
+	}
+	if (dropped) {
+		__sync_add_and_fetch(&g_dropped, dropped);
+
+		Record r;
+		r.m_time = now_ns(CLOCK_REALTIME);
+		r.m_priority = LOG_WARNING;
+		r.m_len = snprintf(r.m_text, sizeof(r.m_text),
+			"AsyncLog: %u messages dropped, log queue full", dropped);
+		write_record(r, false);
+	}
+
+	return worked;
+}
+
+void *drainThread(void *)
+{
+	std::vector<ThreadQueue *> queues;
+
+	for (;;) {
+		/* The queue list only changes when threads come and go */
+		pthread_mutex_lock(&g_mutex);
+		std::vector<ThreadQueue *>::iterator it = g_queues->begin();
+		while (it != g_queues->end()) {
+			if ((*it)->m_orphaned && (*it)->empty()) {
+				delete *it;
+				it = g_queues->erase(it);
+			}
+			else
+				++it;
+		}
+		queues = *g_queues;
+		pthread_mutex_unlock(&g_mutex);
+
+		if (drain(queues))
+			continue;
+
+		/* Idle; say so before the last look at the queues, so a
+		 * producer either sees us waiting or we see its message.
+		 */
+		int seq = g_wakeSeq;
+		g_drainWaiting = true;
+		__sync_synchronize();
+		if (!drain(queues))
+			drainWait(seq);
+		g_drainWaiting = false;
+	}
+
+	return NULL;
+}
+
+void atExit(void)
+{
+	AsyncLog::flush(2.0);
+}
+
+void atForkChild(void)
+{
+	/* The drain thread didn't come along; the parent will write
+	 * whatever was queued before the fork, so start over empty.
+	 */
+	g_mutex = (pthread_mutex_t) PTHREAD_MUTEX_INITIALIZER;
+	g_queues = new std::vector<ThreadQueue *>;
+	g_started = false;
+	g_drainWaiting = false;
+	t_queue = NULL;
+}
+
+void initOnce(void)
+{
+	g_queues = new std::vector<ThreadQueue *>;
+	pthread_key_create(&g_key, threadExit);
+	pthread_atfork(NULL, NULL, atForkChild);
+	atexit(atExit);
+}
+
+void startDrain(void)
+{
+	/* Caller holds g_mutex */
+	if (g_started)
+		return;
+
+	pthread_attr_t attr;
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	if (!pthread_create(&g_drain, &attr, drainThread, NULL))
+		g_started = true;
+	pthread_attr_destroy(&attr);
+}
+
+ThreadQueue *threadQueue(void)
+{
+	if (t_queue)
+		return t_queue;
+
+	pthread_once(&g_once, initOnce);
+
+	ThreadQueue *q = new ThreadQueue;
+	pthread_mutex_lock(&g_mutex);
+	g_queues->push_back(q);
+	startDrain();
+	bool started = g_started;
+	pthread_mutex_unlock(&g_mutex);
+
+	if (!started) {
+		/* No drain thread, nobody would ever write these */
+		pthread_mutex_lock(&g_mutex);
+		g_queues->pop_back();
+		pthread_mutex_unlock(&g_mutex);
+		delete q;
+		return NULL;
+	}
+
+	pthread_setspecific(g_key, q);
+	t_queue = q;
+	return q;
+}
+
+/* Returns the number of messages suppressed since the site's last
+ * admitted message, or -1 if this one should be suppressed.
+ */
+int32_t admit(AsyncLog::Site *site)
+{
+	uint32_t limit = g_rateLimit;
+	if (!limit || !site)
+		return 0;
+
+	uint32_t now = now_ns(CLOCK_MONOTONIC) / 1000000000ULL;
+	uint32_t window = site->m_window;
+	if (window != now
+			&& __sync_bool_compare_and_swap(&site->m_window, window, now))
+		site->m_count = 0;
+
+	if (__sync_add_and_fetch(&site->m_count, 1) > limit) {
+		__sync_add_and_fetch(&site->m_suppressed, 1);
+		__sync_add_and_fetch(&g_suppressed, 1);
+		return -1;
+	}
+
+	if (!site->m_suppressed)
+		return 0;
+	return __sync_lock_test_and_set(&site->m_suppressed, 0);
+}
+
+} /* anonymous namespace */
+
+/* ------------------------------------------------------------------------ */
+
+void AsyncLog::log(Site *site, int priority, const char *fmt, ...)
+{
+	int32_t suppressed = admit(site);
+	if (suppressed < 0)
+		return;
+
+	va_list ap;
+	ThreadQueue *q = threadQueue();
+
+	if (!q) {
+		/* Couldn't start the drain thread, fall back to syslog */
+		va_start(ap, fmt);
+		vsyslog(priority, fmt, ap);
+		va_end(ap);
+		return;
+	}
+
+	uint32_t tail = q->m_tail;
+	uint32_t next = ( tail + 1 ) % QUEUE_RECORDS;
+
+	if (next == q->m_head) {
+		/* Errors are worth waiting a little while for */
+		bool wait = ( priority & LOG_PRIMASK ) <= LOG_ERR;
+		for (int i = 0; wait && i < 1000 && next == q->m_head; i++) {
+			struct timespec ts = { 0, 1000000 };
+			nanosleep(&ts, NULL);
+		}
+		if (next == q->m_head) {
+			__sync_add_and_fetch(&q->m_dropped, 1);
+			return;
+		}
+	}
+
+	Record &r = q->m_ring[tail];
+	r.m_time = now_ns(CLOCK_REALTIME);
+	r.m_priority = priority;
+
+	int n = 0;
+	if (suppressed > 0) {
+		n = snprintf(r.m_text, sizeof(r.m_text),
+			"[%d similar messages suppressed] ", suppressed);
+	}
+
+	va_start(ap, fmt);
+	n += vsnprintf(r.m_text + n, sizeof(r.m_text) - n, fmt, ap);
+	va_end(ap);
+
+	if (n < 0)
+		n = 0;
+	r.m_len = ( (uint32_t) n < sizeof(r.m_text) ) ? n
+		: sizeof(r.m_text) - 1;
+
+	__sync_synchronize();
+	q->m_tail = next;
+
+	__sync_synchronize();
+	if (g_drainWaiting)
+		drainWake();
+
+	/* Don't lose the last words before an abort() */
+	if (( priority & LOG_PRIMASK ) <= LOG_CRIT)
+		flush();
+}
+
+void AsyncLog::flush(double timeout)
+{
+	if (!g_queues)
+		return;
+
+	uint64_t end = now_ns(CLOCK_MONOTONIC) + (uint64_t) (timeout * 1e9);
+
+	while (now_ns(CLOCK_MONOTONIC) < end) {
+		bool empty = true;
+
+		pthread_mutex_lock(&g_mutex);
+		for (uint32_t i = 0; empty && i < g_queues->size(); i++) {
+			ThreadQueue *q = (*g_queues)[i];
+			empty = q->empty() && !q->m_dropped;
+		}
+		bool started = g_started;
+		pthread_mutex_unlock(&g_mutex);
+
+		if (empty || !started)
+			return;
+
+		struct timespec ts = { 0, 1000000 };
+		nanosleep(&ts, NULL);
+	}
+}
+
+void AsyncLog::setRateLimit(uint32_t per_second)
+{
+	g_rateLimit = per_second;
+}
+
+void AsyncLog::setFile(const char *path)
+{
+	int fd = -1;
+	if (path && *path)
+		fd = open(path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+
+	/* Let anything already queued go to the old file */
+	flush();
+
+	int old = __sync_lock_test_and_set(&g_fd, fd);
+	if (old >= 0)
+		close(old);
+}
+
+void AsyncLog::setSyslog(bool enabled)
+{
+	g_syslog = enabled;
+}
+
+AsyncLog::Stats AsyncLog::stats(void)
+{
+	Stats s;
+	s.m_written = g_written;
+	s.m_dropped = g_dropped;
+	s.m_suppressed = g_suppressed;
+	return s;
+}
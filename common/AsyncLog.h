@@ -0,0 +1,83 @@
+#ifndef __ADARA_ASYNC_LOG_H
+#define __ADARA_ASYNC_LOG_H
+
+#include <stdint.h>
+#include <syslog.h>
+
+/* Asynchronous syslog replacement for the daemons.
+ *
+ * ASYNC_SYSLOG() formats the message into a per-thread, single producer
+ * queue and returns; a single drain thread takes messages from all of
+ * the queues, in timestamp order, and hands them to syslog() (and/or a
+ * log file). Callers never block on syslog, so there's no need to sleep
+ * after logging to "give syslog a chance", and a slow syslog can't stall
+ * EPICS callbacks or hold up whoever is waiting on the caller's locks.
+ *
+ * When a thread's queue is full, messages of LOG_ERR and worse wait
+ * (up to a second) for space; everything else is dropped and counted,
+ * and the drain thread reports the count. Each call site is also rate
+ * limited (see setRateLimit()); suppressed messages are counted and
+ * noted on the next message from that site.
+ *
+ * LOG_DEBUG messages compile to nothing unless ASYNC_LOG_DEBUG is
+ * defined non-zero; their arguments aren't evaluated either.
+ *
+ * The drain thread is started on first use, restarted in a forked
+ * child, and flushes at exit.
+ */
+
+#ifndef ASYNC_LOG_DEBUG
+#define ASYNC_LOG_DEBUG 0
+#endif
+
+namespace ADARA {
+
+namespace AsyncLog {
+
+/* Per call site state, statically initialized by ASYNC_SYSLOG() */
+struct Site {
+	const char		*m_file;
+	int			m_line;
+	volatile uint32_t	m_window;	// second the count is for
+	volatile uint32_t	m_count;
+	volatile uint32_t	m_suppressed;
+};
+
+struct Stats {
+	uint64_t	m_written;
+	uint64_t	m_dropped;
+	uint64_t	m_suppressed;
+};
+
+void log(Site *site, int priority, const char *fmt, ...)
+	__attribute__ ((format (printf, 3, 4)));
+
+/* Wait (up to timeout seconds) for everything logged so far to be
+ * written.
+ */
+void flush(double timeout = 5.0);
+
+/* Messages per second allowed from each call site; 0 is unlimited */
+void setRateLimit(uint32_t per_second);
+
+/* Also (or, with syslog off, only) append messages to this file */
+void setFile(const char *path);
+void setSyslog(bool enabled);
+
+Stats stats(void);
+
+} /* namespace AsyncLog */
+
+} /* namespace ADARA */
+
+#define ASYNC_SYSLOG( _pri, ... ) \
+	do { \
+		if ( LOG_PRI(_pri) != LOG_DEBUG || ASYNC_LOG_DEBUG ) { \
+			static ::ADARA::AsyncLog::Site _async_log_site = \
+				{ __FILE__, __LINE__, 0, 0, 0 }; \
+			::ADARA::AsyncLog::log( &_async_log_site, (_pri), \
+				__VA_ARGS__ ); \
+		} \
+	} while (0)
+
+#endif /* __ADARA_ASYNC_LOG_H */
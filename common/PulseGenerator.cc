@@ -0,0 +1,231 @@
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <math.h>
+
+#include "ADARA.h"
+#include "PulseGenerator.h"
+
+using namespace ADARA;
+
+PulseGenerator::Config::Config() :
+	m_sources(1), m_eventsPerPulse(1000), m_maxPacket(32768),
+	m_poolPulses(32), m_pulseNs(16666666), m_unmappedFraction(0.0),
+	m_tofDist("moderator"), m_minTOF(0.0005), m_maxTOF(0.0166),
+	m_monitors(1), m_monitorEvents(100), m_choppers(1),
+	m_chopperEvents(1), m_fastMetaDevices(0), m_fastMetaEvents(1)
+{
+}
+
+PulseGenerator::PulseGenerator(const Config &cfg, uint32_t index) :
+	m_cfg(cfg), m_index(index), m_events(0), m_dspSeq(0)
+{
+	if (m_cfg.m_pixels.empty())
+		throw std::runtime_error("PulseGenerator needs pixel ids");
+
+	build();
+}
+
+void PulseGenerator::loadPixelMap(const std::string &path,
+		std::vector<uint32_t> &pixels)
+{
+	std::ifstream f(path.c_str());
+	std::string line;
+
+	if (f.fail())
+		throw std::runtime_error("Unable to open pixel map " + path);
+
+	while (getline(f, line)) {
+		size_t pos = line.find_first_of("#");
+		if (pos != std::string::npos)
+			line.resize(pos);
+
+		char phys[255], logical[255];
+		uint32_t bank, start, stop;
+		int32_t step;
+
+		if (sscanf(line.c_str(), "%254s %254s %u", phys, logical,
+				&bank) != 3)
+			continue;
+
+		/* Unmapped entries are still events the detector sends */
+		if (sscanf(phys, "%u:%u:%d", &start, &stop, &step) == 3) {
+			if (!step)
+				continue;
+			for (int64_t p = start; step > 0 ? p <= stop : p >= stop;
+					p += step)
+				pixels.push_back((uint32_t) p);
+		} else if (sscanf(phys, "%u", &start) == 1)
+			pixels.push_back(start);
+	}
+
+	if (pixels.empty())
+		throw std::runtime_error("No pixels in pixel map " + path);
+}
+
+/* TOF in 100ns units */
+uint32_t PulseGenerator::genTOF(XorShift &rng)
+{
+	double lo = m_cfg.m_minTOF * 1e7;
+	double span = ( m_cfg.m_maxTOF - m_cfg.m_minTOF ) * 1e7;
+
+	if (m_cfg.m_tofDist == "uniform")
+		return (uint32_t) ( lo + rng.uniform() * span );
+
+	/* A moderator-ish spectrum: a gamma(3) bump peaking early in
+	 * the frame with a long tail, folded back into the frame.
+	 */
+	double t = 0;
+	for (int i = 0; i < 3; i++)
+		t -= log(1.0 - rng.uniform());
+	t *= span * 0.1;
+	return (uint32_t) ( lo + fmod(t, span) );
+}
+
+uint32_t PulseGenerator::genPixel(XorShift &rng)
+{
+	const std::vector<uint32_t> &pixels = m_cfg.m_pixels;
+
+	if (m_cfg.m_unmappedFraction > 0
+			&& rng.uniform() < m_cfg.m_unmappedFraction) {
+		/* Beyond the map, but still a detector event */
+		return ( pixels.back() + 1 + ( rng.next() & 0xffff ) )
+			& 0x0fffffff;
+	}
+	return pixels[rng.next() % pixels.size()];
+}
+
+void PulseGenerator::startPacket(PooledPulse &p, uint32_t type, bool raw)
+{
+	Patch patch;
+	patch.m_offset = p.m_words.size();
+	patch.m_raw = raw;
+
+	p.m_words.push_back(0);
+	p.m_words.push_back(type);
+	p.m_words.push_back(0);
+	p.m_words.push_back(0);
+
+	if (raw) {
+		p.m_words.push_back(m_index + 1);	// source id
+		p.m_words.push_back(0);			// packet/DSP sequence
+	}
+
+	patch.m_common = p.m_words.size();
+	for (int i = 0; i < 4; i++)
+		p.m_words.push_back(0);
+	p.m_words[patch.m_common + 3] = 0x80000000;
+
+	p.m_patches.push_back(patch);
+}
+
+void PulseGenerator::endPacket(PooledPulse &p)
+{
+	uint32_t start = p.m_patches.back().m_offset;
+	p.m_words[start] = ( p.m_words.size() - start - 4 ) * 4;
+}
+
+/* Adds an event, starting a new raw packet if this one is full */
+void PulseGenerator::event(PooledPulse &p, uint32_t tof, uint32_t pixel)
+{
+	if (( p.m_words.size() - p.m_patches.back().m_offset + 2 ) * 4
+			> m_cfg.m_maxPacket) {
+		endPacket(p);
+		startPacket(p, ADARA_PKT_TYPE(
+			ADARA::PacketType::RAW_EVENT_TYPE,
+			ADARA::PacketType::RAW_EVENT_VERSION), true);
+	}
+	p.m_words.push_back(tof);
+	p.m_words.push_back(pixel);
+}
+
+void PulseGenerator::build(void)
+{
+	XorShift rng(0x5eed0000ULL + m_index);
+	uint32_t pool = m_cfg.m_poolPulses ? m_cfg.m_poolPulses : 1;
+
+	m_events = m_cfg.m_eventsPerPulse / m_cfg.m_sources;
+	if (m_index < m_cfg.m_eventsPerPulse % m_cfg.m_sources)
+		m_events++;
+
+	m_pool.resize(pool);
+	for (uint32_t n = 0; n < pool; n++) {
+		PooledPulse &p = m_pool[n];
+
+		/* RTDL; the rest of its payload stays zero */
+		startPacket(p, ADARA_PKT_TYPE(
+			ADARA::PacketType::RTDL_TYPE,
+			ADARA::PacketType::RTDL_VERSION), false);
+		p.m_words.push_back(( 4 << 24 ) | 964728);
+		p.m_words.resize(p.m_patches.back().m_offset + 4 + 30, 0);
+		endPacket(p);
+
+		startPacket(p, ADARA_PKT_TYPE(
+			ADARA::PacketType::RAW_EVENT_TYPE,
+			ADARA::PacketType::RAW_EVENT_VERSION), true);
+
+		if (!m_index) {
+			for (uint32_t c = 0; c < m_cfg.m_choppers; c++)
+				for (uint32_t e = 0; e < m_cfg.m_chopperEvents; e++)
+					event(p, 1 + e,
+						( 7 << 28 ) | ( c << 16 ) | 1);
+			for (uint32_t m = 0; m < m_cfg.m_monitors; m++)
+				for (uint32_t e = 0; e < m_cfg.m_monitorEvents; e++)
+					event(p, genTOF(rng),
+						( 4 << 28 ) | ( m << 16 ) | 1);
+			for (uint32_t d = 0; d < m_cfg.m_fastMetaDevices; d++)
+				for (uint32_t e = 0; e < m_cfg.m_fastMetaEvents; e++)
+					event(p, rng.next() & 0xffff,
+						( 5 << 28 ) | ( d << 16 )
+							| ( rng.next() & 0xffff ));
+		}
+
+		for (uint32_t e = 0; e < m_events; e++)
+			event(p, genTOF(rng), genPixel(rng));
+
+		endPacket(p);
+	}
+}
+
+const std::vector<uint32_t> &PulseGenerator::pulse(uint64_t pulse,
+		uint64_t real_ns)
+{
+	PooledPulse &p = m_pool[pulse % m_pool.size()];
+
+	uint32_t sec = real_ns / 1000000000ULL - ADARA::EPICS_EPOCH_OFFSET;
+	uint32_t nsec = real_ns % 1000000000ULL;
+	uint32_t cycle = pulse % 600;
+	uint16_t pkt_seq = 0;
+
+	uint32_t flavor = ( cycle ? ADARA::PulseFlavor::NORMAL
+		: ADARA::PulseFlavor::NO_BEAM ) << 24;
+	flavor |= (uint32_t) ( ADARA::DataFlags::GOT_NEUTRONS
+		| ADARA::DataFlags::GOT_METADATA ) << 27;
+	/* Charge lags a cycle, so cycle 1 follows no beam */
+	if (cycle != 1)
+		flavor |= 1847000;
+
+	uint32_t *w = &p.m_words[0];
+	for (uint32_t i = 0; i < p.m_patches.size(); i++) {
+		const Patch &pt = p.m_patches[i];
+		uint32_t *pkt = w + pt.m_offset;
+
+		pkt[2] = sec;
+		pkt[3] = nsec;
+		w[pt.m_common] = flavor;
+		w[pt.m_common + 1] = cycle;
+		w[pt.m_common + 2] = m_cfg.m_pulseNs / 100;
+
+		if (pt.m_raw) {
+			pkt[5] = ( (uint32_t) pkt_seq++ << 16 ) | m_dspSeq++;
+			if (i == p.m_patches.size() - 1)
+				pkt[5] |= 0x80000000;	// end of pulse
+		}
+	}
+
+	return p.m_words;
+}
@@ -0,0 +1,117 @@
+#ifndef __ADARA_PULSE_GENERATOR_H
+#define __ADARA_PULSE_GENERATOR_H
+
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+/* Synthetic preprocessor data for load and integration testing, shared
+ * by adara-loadgen and the SMS benchmarks.
+ *
+ * A PulseGenerator stands in for one preprocessor (data source). It
+ * builds a pool of complete pulses (RTDL plus raw event packets) up
+ * front; pulse() then only patches the timestamps, cycle and sequence
+ * numbers into the next pooled pulse, so nothing is generated on the
+ * send path. Pacing and sending are left to the caller.
+ */
+
+namespace ADARA {
+
+/* Small, fast and good enough for test data */
+class XorShift {
+public:
+	XorShift(uint64_t seed) : m_s(seed ? seed : 0x9e3779b97f4a7c15ULL) { }
+
+	uint32_t next(void) {
+		m_s ^= m_s << 13;
+		m_s ^= m_s >> 7;
+		m_s ^= m_s << 17;
+		return (uint32_t) (m_s >> 16);
+	}
+
+	/* [0, 1) */
+	double uniform(void) { return next() / 4294967296.0; }
+
+private:
+	uint64_t m_s;
+};
+
+class PulseGenerator {
+public:
+	struct Config {
+		Config();
+
+		uint32_t	m_sources;		// events are split over
+		uint32_t	m_eventsPerPulse;	// neutrons, all sources
+		uint32_t	m_maxPacket;		// raw event packet bytes
+		uint32_t	m_poolPulses;
+		uint64_t	m_pulseNs;		// pulse period
+
+		/* Physical ids events are drawn from; see loadPixelMap() */
+		std::vector<uint32_t>	m_pixels;
+		double		m_unmappedFraction;
+
+		/* "moderator" or "uniform", in seconds */
+		std::string	m_tofDist;
+		double		m_minTOF;
+		double		m_maxTOF;
+
+		/* Ride along with source 0, as from the beam line
+		 * preprocessor
+		 */
+		uint32_t	m_monitors;
+		uint32_t	m_monitorEvents;	// per monitor per pulse
+		uint32_t	m_choppers;
+		uint32_t	m_chopperEvents;
+		uint32_t	m_fastMetaDevices;
+		uint32_t	m_fastMetaEvents;
+	};
+
+	PulseGenerator(const Config &cfg, uint32_t index);
+
+	/* Neutron events in each of this source's pulses */
+	uint32_t events(void) const { return m_events; }
+
+	/* The packets for pulse number "pulse" on the caller's pulse
+	 * clock, stamped with real_ns (CLOCK_REALTIME, in ns). Valid
+	 * until the next call.
+	 */
+	const std::vector<uint32_t> &pulse(uint64_t pulse, uint64_t real_ns);
+
+	/* Read the physical ids out of an SMS pixel map file; see
+	 * PixelMap::readMap() for the format. Throws std::runtime_error.
+	 */
+	static void loadPixelMap(const std::string &path,
+		std::vector<uint32_t> &pixels);
+
+private:
+	/* Where the per-pulse fields live in a pooled pulse */
+	struct Patch {
+		uint32_t	m_offset;	// packet start, in words
+		uint32_t	m_common;	// pulse info, in words
+		bool		m_raw;
+	};
+
+	struct PooledPulse {
+		std::vector<uint32_t>	m_words;
+		std::vector<Patch>	m_patches;
+	};
+
+	Config				m_cfg;
+	uint32_t			m_index;
+	uint32_t			m_events;
+	uint16_t			m_dspSeq;
+	std::vector<PooledPulse>	m_pool;
+
+	void build(void);
+	void startPacket(PooledPulse &p, uint32_t type, bool raw);
+	void endPacket(PooledPulse &p);
+	void event(PooledPulse &p, uint32_t tof, uint32_t pixel);
+	uint32_t genTOF(XorShift &rng);
+	uint32_t genPixel(XorShift &rng);
+};
+
+} /* namespace ADARA */
+
+#endif /* __ADARA_PULSE_GENERATOR_H */
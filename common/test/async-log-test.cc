@@ -0,0 +1,177 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "AsyncLog.h"
+
+/* Checks for the asynchronous logger: ordering and completeness across
+ * threads (using the LOG_ERR backpressure path, which never drops),
+ * per-site rate limiting, drop accounting, debug compile-out and
+ * logging from a forked child.
+ */
+
+static int failures = 0;
+
+#define CHECK( _cond, _what ) \
+	do { \
+		if ( !(_cond) ) { \
+			fprintf(stderr, "FAIL: %s\n", _what); \
+			failures++; \
+		} \
+	} while (0)
+
+static const char *path;
+
+static std::vector<std::string> readLog(void)
+{
+	std::vector<std::string> lines;
+	std::ifstream f(path);
+	std::string line;
+	while (getline(f, line))
+		lines.push_back(line);
+	return lines;
+}
+
+enum { THREADS = 8, PER_THREAD = 2000 };
+
+static void *producer(void *arg)
+{
+	long id = (long) arg;
+	for (int i = 0; i < PER_THREAD; i++)
+		ASYNC_SYSLOG( LOG_ERR, "order %ld %d", id, i );
+	return NULL;
+}
+
+/* One call site, however often it's called */
+static void limited(int i)
+{
+	ASYNC_SYSLOG( LOG_INFO, "limited %d", i );
+}
+
+static int evaluated = 0;
+
+static int sideEffect(void)
+{
+	return ++evaluated;
+}
+
+int main(void)
+{
+	char tmpl[] = "/tmp/async-log-test.XXXXXX";
+	int fd = mkstemp(tmpl);
+	if (fd < 0) {
+		perror("mkstemp");
+		return 1;
+	}
+	close(fd);
+	path = tmpl;
+
+	ADARA::AsyncLog::setSyslog(false);
+	ADARA::AsyncLog::setFile(path);
+	ADARA::AsyncLog::setRateLimit(0);
+
+	/* Everything arrives, each thread's messages in order */
+	pthread_t threads[THREADS];
+	for (long i = 0; i < THREADS; i++)
+		pthread_create(&threads[i], NULL, producer, (void *) i);
+	for (int i = 0; i < THREADS; i++)
+		pthread_join(threads[i], NULL);
+	ADARA::AsyncLog::flush();
+
+	std::vector<std::string> lines = readLog();
+	std::vector<int> next(THREADS, 0);
+	bool in_order = true;
+	for (size_t i = 0; i < lines.size(); i++) {
+		long id;
+		int seq;
+		size_t pos = lines[i].find("order ");
+		if (pos == std::string::npos
+				|| sscanf(lines[i].c_str() + pos, "order %ld %d",
+					&id, &seq) != 2
+				|| id < 0 || id >= THREADS)
+			continue;
+		if (seq != next[id]++)
+			in_order = false;
+	}
+	CHECK( lines.size() == THREADS * PER_THREAD, "all messages written" );
+	CHECK( in_order, "per-thread order kept" );
+	for (int i = 0; i < THREADS; i++)
+		CHECK( next[i] == PER_THREAD, "all messages from each thread" );
+	CHECK( lines.empty() || lines[0].find("<3> order") != std::string::npos,
+		"priority and text in file lines" );
+
+	/* Rate limiting per call site */
+	ADARA::AsyncLog::setFile(NULL);
+	unlink(path);
+	ADARA::AsyncLog::setFile(path);
+	ADARA::AsyncLog::setRateLimit(10);
+	ADARA::AsyncLog::Stats before = ADARA::AsyncLog::stats();
+
+	/* Start at the top of a second so all 100 share a window */
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	usleep(1000000 - ts.tv_nsec / 1000 + 1000);
+	for (int i = 0; i < 100; i++)
+		limited(i);
+	ASYNC_SYSLOG( LOG_INFO, "other site" );
+	sleep(1);
+	limited(100);
+	ADARA::AsyncLog::flush();
+
+	ADARA::AsyncLog::Stats after = ADARA::AsyncLog::stats();
+	lines = readLog();
+	CHECK( lines.size() == 10 + 1 + 1, "rate limited to 10/s per site" );
+	CHECK( after.m_suppressed - before.m_suppressed == 90,
+		"suppressed messages counted" );
+	CHECK( !lines.empty() && lines.back().find(
+			"[90 similar messages suppressed] limited 100")
+				!= std::string::npos,
+		"suppression noted on next message" );
+
+	/* Low priority messages are dropped, not waited for, and every
+	 * message is either written or counted as dropped.
+	 */
+	ADARA::AsyncLog::setRateLimit(0);
+	before = ADARA::AsyncLog::stats();
+	for (int i = 0; i < 20000; i++)
+		ASYNC_SYSLOG( LOG_INFO, "burst %d", i );
+	ADARA::AsyncLog::flush();
+	after = ADARA::AsyncLog::stats();
+	CHECK( after.m_written - before.m_written
+			+ after.m_dropped - before.m_dropped == 20000,
+		"written + dropped accounts for every message" );
+
+	/* Debug messages (and their arguments) compile away */
+	ASYNC_SYSLOG( LOG_DEBUG, "debug %d", sideEffect() );
+	ASYNC_SYSLOG( LOG_DEBUG | LOG_DAEMON, "debug %d", sideEffect() );
+	CHECK( evaluated == 0, "debug arguments not evaluated" );
+
+	/* A forked child gets a drain thread of its own */
+	pid_t pid = fork();
+	if (!pid) {
+		ASYNC_SYSLOG( LOG_INFO, "from child" );
+		exit(0);
+	}
+	waitpid(pid, NULL, 0);
+	lines = readLog();
+	bool child = false;
+	for (size_t i = 0; i < lines.size(); i++)
+		child = child || lines[i].find("from child") != std::string::npos;
+	CHECK( child, "child messages written at exit" );
+
+	unlink(path);
+
+	if (failures) {
+		fprintf(stderr, "%d failures\n", failures);
+		return 1;
+	}
+	printf("All async log tests passed.\n");
+	return 0;
+}
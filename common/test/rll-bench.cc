@@ -0,0 +1,82 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <sstream>
+#include <string>
+
+#include "ADARAUtils.h"
+
+/* Microbenchmark for RateLimitedLogging::checkLog() in the case we care
+ * about: a condition firing on every event, so nearly every check is
+ * suppressed and the check itself is the whole cost.
+ *
+ *   name   - the old calling pattern, stringstream key + name lookup
+ *   key    - integer key lookup, no formatting
+ *   handle - log site registered once, check by handle
+ */
+
+static double elapsed(const struct timespec &a, const struct timespec &b)
+{
+	return (b.tv_sec - a.tv_sec) + (b.tv_nsec - a.tv_nsec) / 1e9;
+}
+
+static void report(const char *what, double secs, uint32_t iters,
+		uint32_t logged)
+{
+	printf("  %-6s %7.1f ns/check  (%u logged)\n",
+		what, secs * 1e9 / iters, logged);
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t iters = (argc > 1) ? strtoul(argv[1], NULL, 0) : 5000000;
+	uint32_t i, logged;
+	struct timespec t0, t1;
+	std::string log_info;
+
+	/* A handful of distinct keys, as with a few misbehaving devices */
+	const uint32_t nkeys = 8;
+
+	printf("checkLog() x %u, %u keys:\n", iters, nkeys);
+
+	RateLimitedLogging::History byName;
+	logged = 0;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < iters; i++) {
+		std::stringstream ss;
+		ss << (i % nkeys) << "/" << 7;
+		logged += RateLimitedLogging::checkLog(byName, 1, ss.str(),
+			2, 10, 5000, log_info);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	report("name", elapsed(t0, t1), iters, logged);
+
+	RateLimitedLogging::History byKey;
+	logged = 0;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < iters; i++) {
+		uint64_t key = ((uint64_t) (i % nkeys) << 32) | 7;
+		logged += RateLimitedLogging::checkLog(byKey, 1, key,
+			2, 10, 5000, log_info);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	report("key", elapsed(t0, t1), iters, logged);
+
+	RateLimitedLogging::History byHandle;
+	RateLimitedLogging::Handle handles[nkeys];
+	for (i = 0; i < nkeys; i++) {
+		handles[i] = RateLimitedLogging::registerLog(byHandle, 1,
+			(uint64_t) i, 2, 10, 5000);
+	}
+	logged = 0;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < iters; i++) {
+		logged += RateLimitedLogging::checkLog(byHandle,
+			handles[i % nkeys], log_info);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	report("handle", elapsed(t0, t1), iters, logged);
+
+	return 0;
+}
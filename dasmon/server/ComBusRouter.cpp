@@ -1,5 +1,6 @@
 #include <string.h>
 #include <syslog.h>
+#include "AsyncLog.h"
 #include <unistd.h>
 #include "ComBusRouter.h"
 #include "ComBusMessages.h"
@@ -118,16 +119,14 @@ ComBusRouter::run()
         {
             if ( ++proc_stall == TIMEOUT )
             {
-                syslog( LOG_ERR, "StreamMonitor stream processing thread appears to be hung. Thread state = %u, Notify state = %u", m_monitor.getProcState(), m_monitor.getNotifyState() );
-                usleep(30000); // give syslog a chance...
+                ASYNC_SYSLOG( LOG_ERR, "StreamMonitor stream processing thread appears to be hung. Thread state = %u, Notify state = %u", m_monitor.getProcState(), m_monitor.getNotifyState() );
             }
         }
         else
         {
             if ( proc_stall >= TIMEOUT )
             {
-                syslog( LOG_ERR, "StreamMonitor stream processing thread appears to have recovered." );
-                usleep(30000); // give syslog a chance...
+                ASYNC_SYSLOG( LOG_ERR, "StreamMonitor stream processing thread appears to have recovered." );
             }
 
             last_proc_ticker = m_monitor.getProcTicker();
@@ -138,16 +137,14 @@ ComBusRouter::run()
         {
             if ( ++metrics_stall == TIMEOUT )
             {
-                syslog( LOG_ERR, "StreamMonitor metrics thread appears to be hung. Thread state = %u, Notify state = %u", m_monitor.getMetricsState(), m_monitor.getNotifyState() );
-                usleep(30000); // give syslog a chance...
+                ASYNC_SYSLOG( LOG_ERR, "StreamMonitor metrics thread appears to be hung. Thread state = %u, Notify state = %u", m_monitor.getMetricsState(), m_monitor.getNotifyState() );
             }
         }
         else
         {
             if ( metrics_stall >= TIMEOUT )
             {
-                syslog( LOG_ERR, "StreamMonitor metrics thread appears to have recovered." );
-                usleep(30000); // give syslog a chance...
+                ASYNC_SYSLOG( LOG_ERR, "StreamMonitor metrics thread appears to have recovered." );
             }
 
             last_metrics_ticker = m_monitor.getMetricsTicker();
@@ -161,16 +158,14 @@ ComBusRouter::run()
             {
                 if ( ++db_stall == TIMEOUT )
                 {
-                    syslog( LOG_ERR, "StreamMonitor DB thread appears to be hung. Thread state = %u, Notify state = %u", m_monitor.getDbState(), m_monitor.getNotifyState() );
-                    usleep(30000); // give syslog a chance...
+                    ASYNC_SYSLOG( LOG_ERR, "StreamMonitor DB thread appears to be hung. Thread state = %u, Notify state = %u", m_monitor.getDbState(), m_monitor.getNotifyState() );
                 }
             }
             else
             {
                 if ( db_stall >= TIMEOUT )
                 {
-                    syslog( LOG_ERR, "StreamMonitor DB thread appears to have recovered." );
-                    usleep(30000); // give syslog a chance...
+                    ASYNC_SYSLOG( LOG_ERR, "StreamMonitor DB thread appears to have recovered." );
                 }
 
                 last_db_ticker = m_monitor.getDbTicker();
@@ -192,24 +187,23 @@ ComBusRouter::run()
             {
                 if ( !(m_combus.status( ADARA::ComBus::STATUS_OK )) )
                 {
-                    syslog( LOG_ERR, "%s - %s",
+                    ASYNC_SYSLOG( LOG_ERR, "%s - %s",
                         "StreamMonitor Error",
                         "Broadcasting DASMON ComBus Status OK Message" );
                 }
             }
             else
             {
-                syslog( LOG_ERR,
+                ASYNC_SYSLOG( LOG_ERR,
                     "StreamMonitor %s - %s: %s=%u %s=%u %s=%u %s=%u",
                     "SYSTEM STALLED", "STATUS FAULT",
                     "proc_stall", proc_stall,
                     "metrics_stall", metrics_stall,
                     "db_stall", db_stall,
                     "TIMEOUT", TIMEOUT);
-                usleep(30000); // give syslog a chance...
                 if ( !(m_combus.status( ADARA::ComBus::STATUS_FAULT )) )
                 {
-                    syslog( LOG_ERR, "%s - %s",
+                    ASYNC_SYSLOG( LOG_ERR, "%s - %s",
                         "StreamMonitor Error",
                         "Broadcasting DASMON ComBus Status FAULT Message" );
                 }
@@ -223,8 +217,7 @@ ComBusRouter::run()
         {
             if ( ip->second.status == ADARA::ComBus::STATUS_UNRESPONSIVE && t > ( ip->second.last_updated + PROC_TIMEOUT_INACTIVE ))
             {
-                syslog( LOG_INFO, "Process %s has become INACTIVE.", ip->first.c_str() );
-                usleep(30000); // give syslog a chance...
+                ASYNC_SYSLOG( LOG_INFO, "Process %s has become INACTIVE.", ip->first.c_str() );
 
                 ip->second.status = ADARA::ComBus::STATUS_INACTIVE;
                 m_analyzer.retractFact( string("PROC_") + ip->first );
@@ -235,8 +228,7 @@ ComBusRouter::run()
             {
                 if (( ip->second.status == ADARA::ComBus::STATUS_OK || ip->second.status == ADARA::ComBus::STATUS_FAULT ) && t > ( ip->second.last_updated + PROC_TIMEOUT_UNRESPONSIVE ))
                 {
-                    syslog( LOG_INFO, "Process %s has become UNRESPONSIVE.", ip->first.c_str() );
-                    usleep(30000); // give syslog a chance...
+                    ASYNC_SYSLOG( LOG_INFO, "Process %s has become UNRESPONSIVE.", ip->first.c_str() );
 
                     ip->second.status = ADARA::ComBus::STATUS_UNRESPONSIVE;
                     m_analyzer.assertFact( string("PROC_") + ip->first, (int)ip->second.status );
@@ -453,7 +445,7 @@ ComBusRouter::beamMetrics( const BeamMetrics &a_metrics )
         m_beam_metrics_count = 0;
 
         ComBus::DASMON::BeamMetricsMessage msg( a_metrics );
-        m_combus.broadcast( msg );
+        m_combus.broadcastCoalesced( msg, "beam_metrics" );
     }
 }
 
@@ -473,7 +465,7 @@ ComBusRouter::runMetrics( const RunMetrics &a_metrics )
         m_run_metrics_count = 0;
 
         ComBus::DASMON::RunMetricsMessage msg( a_metrics );
-        m_combus.broadcast( msg );
+        m_combus.broadcastCoalesced( msg, "run_metrics" );
     }
 }
 
@@ -486,7 +478,7 @@ ComBusRouter::streamMetrics( const StreamMetrics &a_metrics )
         m_stream_metrics_count = 0;
 
         ComBus::DASMON::StreamMetricsMessage msg( a_metrics );
-        m_combus.broadcast( msg );
+        m_combus.broadcastCoalesced( msg, "stream_metrics" );
     }
 }
 
@@ -698,13 +690,11 @@ ComBusRouter::comBusConnectionStatus( bool a_connected )
     {
         // On reconnect, resend all asserted signals in case some fired while disconnected
         m_resend_state = true;
-        syslog( LOG_NOTICE, "ComBus connection active." );
-        usleep(30000); // give syslog a chance...
+        ASYNC_SYSLOG( LOG_NOTICE, "ComBus connection active." );
     }
     else if ( !a_connected && m_combus_connected )
     {
-        syslog( LOG_ERR, "ComBus connection lost." );
-        usleep(30000); // give syslog a chance...
+        ASYNC_SYSLOG( LOG_ERR, "ComBus connection lost." );
     }
 
     m_combus_connected = a_connected;
@@ -782,14 +772,12 @@ ComBusRouter::comBusInputMessage( const ADARA::ComBus::MessageBase &a_msg )
             break;
 
         case ADARA::ComBus::MSG_DASMON_SET_RULES:
-            syslog( LOG_INFO, "Received request to set rules" );
-            usleep(30000); // give syslog a chance...
+            ASYNC_SYSLOG( LOG_INFO, "Received request to set rules" );
             setRuleDefinitions( &a_msg );
             break;
 
         case ADARA::ComBus::MSG_DASMON_RESTORE_DEFAULT_RULES:
-            syslog( LOG_INFO, "Received request to restore default rules" );
-            usleep(30000); // give syslog a chance...
+            ASYNC_SYSLOG( LOG_INFO, "Received request to restore default rules" );
             m_analyzer.restoreDefaultConfig();
             sendRuleDefinitions( a_msg.getSourceID(), a_msg.getCorrelationID() );
             break;
@@ -808,13 +796,11 @@ ComBusRouter::comBusInputMessage( const ADARA::ComBus::MessageBase &a_msg )
     }
     catch ( exception &e )
     {
-        syslog( LOG_ERR, "Exception while processing command: %s", e.what() );
-        usleep(30000); // give syslog a chance...
+        ASYNC_SYSLOG( LOG_ERR, "Exception while processing command: %s", e.what() );
     }
     catch ( ... )
     {
-        syslog( LOG_ERR, "Unkown exception while processing command" );
-        usleep(30000); // give syslog a chance...
+        ASYNC_SYSLOG( LOG_ERR, "Unkown exception while processing command" );
     }
 }
 
@@ -3,6 +3,7 @@
 #include <boost/algorithm/string.hpp>
 #include <boost/tokenizer.hpp>
 #include <syslog.h>
+#include "AsyncLog.h"
 #include <unistd.h>
 
 #include "ADARA.h"
@@ -129,8 +130,7 @@ StreamAnalyzer::loadConfig()
 
     if ( !inf.is_open())
     {
-        syslog( LOG_ERR, "Could not open configuration file: %s", cfg.c_str() );
-        usleep(30000); // give syslog a chance...
+        ASYNC_SYSLOG( LOG_ERR, "Could not open configuration file: %s", cfg.c_str() );
     }
     else
     {
@@ -208,21 +208,18 @@ StreamAnalyzer::loadConfig()
             map<string,string> errors;
             if ( !setDefinitions( loaded_rules, loaded_signals, errors ))
             {
-                syslog( LOG_ERR, "Failed setting rules from configuration file: %s", cfg.c_str() );
-                usleep(30000); // give syslog a chance...
+                ASYNC_SYSLOG( LOG_ERR, "Failed setting rules from configuration file: %s", cfg.c_str() );
 
                 for ( map<string,string>::iterator ie = errors.begin(); ie != errors.end(); ++ie )
                 {
-                    syslog( LOG_ERR, "Config error on %s: %s", ie->first.c_str(), ie->second.c_str() );
-                    usleep(30000); // give syslog a chance...
+                    ASYNC_SYSLOG( LOG_ERR, "Config error on %s: %s", ie->first.c_str(), ie->second.c_str() );
                 }
             }
         }
         catch ( ... )
         {
             inf.close();
-            syslog( LOG_ERR, "Error at line %i in configuration file: %s", line_no, cfg.c_str() );
-            usleep(30000); // give syslog a chance...
+            ASYNC_SYSLOG( LOG_ERR, "Error at line %i in configuration file: %s", line_no, cfg.c_str() );
         }
     }
 }
@@ -241,8 +238,7 @@ StreamAnalyzer::saveConfig()
 
     if ( !outf.is_open())
     {
-        syslog( LOG_ERR, "Could not open configuration file: %s", cfg.c_str() );
-        usleep(30000); // give syslog a chance...
+        ASYNC_SYSLOG( LOG_ERR, "Could not open configuration file: %s", cfg.c_str() );
         return;
     }
 
@@ -311,8 +307,7 @@ StreamAnalyzer::restoreDefaultConfig()
     }
     catch ( ... )
     {
-        syslog( LOG_ERR, "Could not restore default rule configuration file." );
-        usleep(30000); // give syslog a chance...
+        ASYNC_SYSLOG( LOG_ERR, "Could not restore default rule configuration file." );
     }
 }
 
@@ -338,8 +333,7 @@ StreamAnalyzer::setDefaultConfig()
     }
     catch ( ... )
     {
-        syslog( LOG_ERR, "Could not set default rule configuration file." );
-        usleep(30000); // give syslog a chance...
+        ASYNC_SYSLOG( LOG_ERR, "Could not set default rule configuration file." );
     }
 }
 
@@ -12,6 +12,7 @@
 #include "ADARAUtils.h"
 #include "ADARAPackets.h"
 #include <syslog.h>
+#include "AsyncLog.h"
 #include <unistd.h>
 
 
@@ -58,7 +59,8 @@ StreamMonitor::StreamMonitor(
     : POSIXParser(), m_fd_in(-1),
       m_sms_host(a_sms_host), m_sms_port(a_port),
       m_stream_thread(0), m_metrics_thread(0), m_process_stream(true),
-      m_mon_event_count(0), m_recording(false), m_run_num(0),
+      m_mon_event_count(0), m_event_decimation(1),
+      m_recording(false), m_run_num(0),
       m_run_timestamp(0), m_run_timestamp_nanosec(0),
       m_paused(false), m_scanning(false), m_scan_index(0),
       m_first_pulse_time(0), m_last_pulse_time(0),
@@ -103,8 +105,7 @@ StreamMonitor::~StreamMonitor()
 void
 StreamMonitor::start()
 {
-    syslog( LOG_INFO, "Start processing request." );
-    usleep(30000); // give syslog a chance...
+    ASYNC_SYSLOG( LOG_INFO, "Start processing request." );
 
     boost::lock_guard<boost::mutex> lock(m_api_mutex);
 
@@ -118,8 +119,7 @@ StreamMonitor::start()
 void
 StreamMonitor::stop()
 {
-    syslog( LOG_INFO, "Stop processing request." );
-    usleep(30000); // give syslog a chance...
+    ASYNC_SYSLOG( LOG_INFO, "Stop processing request." );
 
     boost::lock_guard<boost::mutex> lock(m_api_mutex);
 
@@ -259,8 +259,7 @@ StreamMonitor::processThread()
 
     std::string log_info;
 
-    syslog( LOG_INFO, "Stream monitor process thread started." );
-    usleep(30000); // give syslog a chance...
+    ASYNC_SYSLOG( LOG_INFO, "Stream monitor process thread started." );
 
     m_notify.connectionStatus( false, m_sms_host, m_sms_port );
     m_proc_state = TS_RUNNING;
@@ -290,8 +289,7 @@ StreamMonitor::processThread()
                 // NOTE: This is POSIXParser::read()... ;-o
                 else if ( !read( m_fd_in, log_info, 0, ADARA_IN_BUF_SIZE ))
                 {
-                    syslog( LOG_WARNING, "ADARA::POSIXParser::read() returned 0 (%s). Dropping connection.", log_info.c_str() );
-                    usleep(30000); // give syslog a chance...
+                    ASYNC_SYSLOG( LOG_WARNING, "ADARA::POSIXParser::read() returned 0 (%s). Dropping connection.", log_info.c_str() );
                     // Connection lost due to source closing socket
                     handleLostConnection();
                 }
@@ -302,8 +300,7 @@ StreamMonitor::processThread()
             m_proc_state = TS_EXCEPTION;
 
             // TODO Really need to notify someone that something BAD has happened!
-            syslog( LOG_WARNING, "In processThread(): std::exception caught. Dropping connection. Exception = %s", e.what() );
-            usleep(30000); // give syslog a chance...
+            ASYNC_SYSLOG( LOG_WARNING, "In processThread(): std::exception caught. Dropping connection. Exception = %s", e.what() );
             // Connection lost
             handleLostConnection();
             // This is probably a misbehaving data source, wait a bit before retrying
@@ -319,8 +316,7 @@ StreamMonitor::processThread()
             m_proc_state = TS_EXCEPTION;
 
             // TODO Really need to notify someone that something BAD has happened!
-            syslog( LOG_WARNING, "In processThread(): Unknown exception type caught. Dropping connection." );
-            usleep(30000); // give syslog a chance...
+            ASYNC_SYSLOG( LOG_WARNING, "In processThread(): Unknown exception type caught. Dropping connection." );
             // Connection lost
             handleLostConnection();
             // This is probably a misbehaving data source, wait a bit before retrying
@@ -333,8 +329,7 @@ StreamMonitor::processThread()
         }
     }
 
-    syslog( LOG_INFO, "Stream monitor process thread stopping." );
-    usleep(30000); // give syslog a chance...
+    ASYNC_SYSLOG( LOG_INFO, "Stream monitor process thread stopping." );
     m_proc_state = TS_EXIT;
 }
 
@@ -356,8 +351,7 @@ StreamMonitor::connect()
 
     if ( sms_socket < 0 )
     {
-        syslog( LOG_ERR, "Failed to Create SMS Socket!" );
-        usleep(30000); // give syslog a chance...
+        ASYNC_SYSLOG( LOG_ERR, "Failed to Create SMS Socket!" );
         return -1;
     }
 
@@ -374,9 +368,8 @@ StreamMonitor::connect()
         if ( ::connect( sms_socket, (struct sockaddr*) &server_addr, sizeof(server_addr)) == 0 )
         {
             // Send client hello to begin stream processing
-            uint32_t data[6];
+            std::vector<uint32_t> data( 6 );
 
-            data[0] = 8;
             data[1] = ADARA_PKT_TYPE(
                 ADARA::PacketType::CLIENT_HELLO_TYPE,
                 ADARA::PacketType::CLIENT_HELLO_VERSION );
@@ -389,31 +382,50 @@ StreamMonitor::connect()
             // So We Can Keep Updating the Web Monitor... ;-D
             data[5] = ADARA::ClientHelloPkt::SEND_PAUSE_DATA;
 
-            if ( write( sms_socket, data, sizeof(data)) == sizeof( data ))
+            // Version 2 ClientHelloPkt can ask the SMS to only send us
+            // the neutron events from 1-in-N pulses; the pulses still
+            // arrive (with empty banks), so rates/charge stay exact and
+            // the event counts are scaled back up in rxPacket().
+            if ( m_event_decimation > 1 )
             {
-                syslog( LOG_NOTICE, "Connected to SMS." );
-                usleep(30000); // give syslog a chance...
+                data[5] |= ADARA::ClientHelloPkt::DECIMATE_EVENTS;
+                data.push_back( m_event_decimation );
+                data.push_back( 0 ); // no packet type list
+                data.push_back( 0 ); // no bank list
+            }
+
+            data[0] = ( data.size() - 4 ) * sizeof(uint32_t);
+
+            ssize_t len = data.size() * sizeof(uint32_t);
+
+            if ( write( sms_socket, &data[0], len ) == len )
+            {
+                if ( m_event_decimation > 1 )
+                {
+                    ASYNC_SYSLOG( LOG_NOTICE,
+                        "Connected to SMS (events from 1-in-%u pulses).",
+                        m_event_decimation );
+                }
+                else
+                    ASYNC_SYSLOG( LOG_NOTICE, "Connected to SMS." );
                 return sms_socket;
             }
             else
             {
-                syslog( LOG_ERR, "Failed to Write Hello to SMS at %s!",
+                ASYNC_SYSLOG( LOG_ERR, "Failed to Write Hello to SMS at %s!",
                     m_sms_host.c_str() );
-                usleep(30000); // give syslog a chance...
             }
         }
         else
         {
-            syslog( LOG_ERR, "Failed to Connect to SMS at %s!",
+            ASYNC_SYSLOG( LOG_ERR, "Failed to Connect to SMS at %s!",
                 m_sms_host.c_str() );
-            usleep(30000); // give syslog a chance...
         }
     }
     else
     {
-        syslog( LOG_ERR, "Failed to Get Host by Name for %s!",
+        ASYNC_SYSLOG( LOG_ERR, "Failed to Get Host by Name for %s!",
             m_sms_host.c_str() );
-        usleep(30000); // give syslog a chance...
     }
 
     close( sms_socket );
@@ -438,16 +450,14 @@ StreamMonitor::handleLostConnection()
     // Log Pre-Disconnect Run Stats...
     stringstream ssr;
     m_run_metrics.print( ssr );
-    syslog( LOG_ERR, "%s: Lost SMS Connection - %s",
+    ASYNC_SYSLOG( LOG_ERR, "%s: Lost SMS Connection - %s",
         "handleLostConnection()", ssr.str().c_str() );
-    usleep(30000); // give syslog a chance...
 
     // Log Pre-Disconnect Stream Stats...
     stringstream ssm;
     m_stream_metrics.print( ssm );
-    syslog( LOG_ERR, "%s: Lost SMS Connection - %s",
+    ASYNC_SYSLOG( LOG_ERR, "%s: Lost SMS Connection - %s",
         "handleLostConnection()", ssm.str().c_str() );
-    usleep(30000); // give syslog a chance...
 
     resetRunStats();
 
@@ -507,8 +517,7 @@ StreamMonitor::metricsThread()
     RunMetrics      run_metrics;
     StreamMetrics   stream_metrics;
 
-    syslog( LOG_INFO, "Stream metrics thread started." );
-    usleep(30000); // give syslog a chance...
+    ASYNC_SYSLOG( LOG_INFO, "Stream metrics thread started." );
 
     while( m_process_stream )
     {
@@ -573,9 +582,8 @@ StreamMonitor::metricsThread()
             {
                 stringstream ssb;
                 beam_metrics.print( ssb );
-                syslog( LOG_ERR, "%s: %s",
+                ASYNC_SYSLOG( LOG_ERR, "%s: %s",
                     "metricsThread()", ssb.str().c_str() );
-                usleep(30000); // give syslog a chance...
             }
 
             // Send Beam Metrics Every Second
@@ -589,9 +597,8 @@ StreamMonitor::metricsThread()
                 {
                     stringstream ssr;
                     run_metrics.print( ssr );
-                    syslog( LOG_ERR, "%s: %s",
+                    ASYNC_SYSLOG( LOG_ERR, "%s: %s",
                         "metricsThread()", ssr.str().c_str() );
-                    usleep(30000); // give syslog a chance...
                 }
 
                 m_notify.runMetrics( run_metrics );
@@ -605,9 +612,8 @@ StreamMonitor::metricsThread()
                 {
                     stringstream ssm;
                     stream_metrics.print( ssm );
-                    syslog( LOG_ERR, "%s: %s",
+                    ASYNC_SYSLOG( LOG_ERR, "%s: %s",
                         "metricsThread()", ssm.str().c_str() );
-                    usleep(30000); // give syslog a chance...
                 }
 
                 m_notify.streamMetrics( stream_metrics );
@@ -615,8 +621,7 @@ StreamMonitor::metricsThread()
         }
     }
 
-    syslog( LOG_INFO, "Stream metrics thread stopping." );
-    usleep(30000); // give syslog a chance...
+    ASYNC_SYSLOG( LOG_INFO, "Stream metrics thread stopping." );
 
     ++m_metrics_ticker;
     m_metrics_state = TS_EXIT;
@@ -759,16 +764,14 @@ StreamMonitor::rxPacket( const ADARA::RunStatusPkt &a_pkt )
         // Log Pre-Run Run Stats...
         stringstream ssr;
         m_run_metrics.print( ssr );
-        syslog( LOG_ERR, "%s: Pre-Run Stats - %s",
+        ASYNC_SYSLOG( LOG_ERR, "%s: Pre-Run Stats - %s",
             "rxPacket(RunStatusPkt)", ssr.str().c_str() );
-        usleep(30000); // give syslog a chance...
 
         // Log Pre-Disconnect Stream Stats...
         stringstream ssm;
         m_stream_metrics.print( ssm );
-        syslog( LOG_ERR, "%s: Pre-Run Stats - %s",
+        ASYNC_SYSLOG( LOG_ERR, "%s: Pre-Run Stats - %s",
             "rxPacket(RunStatusPkt)", ssm.str().c_str() );
-        usleep(30000); // give syslog a chance...
 
         resetRunStats();
 
@@ -800,16 +803,14 @@ StreamMonitor::rxPacket( const ADARA::RunStatusPkt &a_pkt )
         // Log Pre-Run Run Stats...
         stringstream ssr;
         m_run_metrics.print( ssr );
-        syslog( LOG_ERR, "%s: Final Run Stats - %s",
+        ASYNC_SYSLOG( LOG_ERR, "%s: Final Run Stats - %s",
             "rxPacket(RunStatusPkt)", ssr.str().c_str() );
-        usleep(30000); // give syslog a chance...
 
         // Log Pre-Disconnect Stream Stats...
         stringstream ssm;
         m_stream_metrics.print( ssm );
-        syslog( LOG_ERR, "%s: Final Run Stats - %s",
+        ASYNC_SYSLOG( LOG_ERR, "%s: Final Run Stats - %s",
             "rxPacket(RunStatusPkt)", ssm.str().c_str() );
-        usleep(30000); // give syslog a chance...
 
         resetRunStats();
 
@@ -870,9 +871,8 @@ StreamMonitor::rxPacket( const ADARA::PixelMappingAltPkt &a_pkt )
         // Get number of banks (largest bank id) explicitly from packet
         uint16_t bank_count = (uint16_t) a_pkt.numBanks();
 
-        syslog( LOG_INFO, "%s: Max Bank = %u",
+        ASYNC_SYSLOG( LOG_INFO, "%s: Max Bank = %u",
             "ADARA::PixelMappingAltPkt", bank_count );
-        usleep(30000); // give syslog a chance...
 
         m_bank_info.clear();
 
@@ -898,13 +898,12 @@ StreamMonitor::rxPacket( const ADARA::PixelMappingAltPkt &a_pkt )
             rpos++;
 
 #ifdef DEBUG_PIXMAP
-            syslog( LOG_INFO, "%s: %s = %d, %s = %u, %s = %u, %s = %u",
+            ASYNC_SYSLOG( LOG_INFO, "%s: %s = %d, %s = %u, %s = %u, %s = %u",
                 "ADARA::PixelMappingAltPkt",
                 "Base/Starting Physical", physical_start,
                 "Bank ID", bank_id,
                 "Is Shorthand", is_shorthand,
                 "Count", pixel_count );
-            usleep(30000); // give syslog a chance...
 #endif
 
             // Process Shorthand PixelId Section...
@@ -925,13 +924,12 @@ StreamMonitor::rxPacket( const ADARA::PixelMappingAltPkt &a_pkt )
                 logical_stop = *rpos++;
 
 #ifdef DEBUG_PIXMAP
-                syslog( LOG_INFO, "%s: %s %s=%d/%d/%d %s=%d/%d/%d",
+                ASYNC_SYSLOG( LOG_INFO, "%s: %s %s=%d/%d/%d %s=%d/%d/%d",
                     "ADARA::PixelMappingAltPkt", "Shorthand Section",
                     "physical",
                     physical_start, physical_stop, physical_step,
                     "logical",
                     logical_start, logical_stop, logical_step );
-                usleep(30000); // give syslog a chance...
 #endif
 
                 // Verify Physical PixelId Count Versus Section Count...
@@ -939,7 +937,7 @@ StreamMonitor::rxPacket( const ADARA::PixelMappingAltPkt &a_pkt )
                     / physical_step;
                 if ( cnt != (int32_t) pixel_count )
                 {
-                    syslog( LOG_ERR,
+                    ASYNC_SYSLOG( LOG_ERR,
                         "%s: %s %s=%d/%d/%d %s=%d/%d/%d: %d != %d - %s",
                         "ADARA::PixelMappingAltPkt",
                         "Physical PixelId Count Mismatch",
@@ -949,7 +947,6 @@ StreamMonitor::rxPacket( const ADARA::PixelMappingAltPkt &a_pkt )
                         logical_start, logical_stop, logical_step,
                         cnt, pixel_count,
                         "Skip Section..." );
-                    usleep(30000); // give syslog a chance...
 
                     // Next Section
                     skip_pixel_count += pixel_count;
@@ -962,7 +959,7 @@ StreamMonitor::rxPacket( const ADARA::PixelMappingAltPkt &a_pkt )
                     / logical_step;
                 if ( cnt != (int32_t) pixel_count )
                 {
-                    syslog( LOG_ERR,
+                    ASYNC_SYSLOG( LOG_ERR,
                         "%s: %s %s=%d/%d/%d %s=%d/%d/%d: %d != %d - %s",
                         "ADARA::PixelMappingAltPkt",
                         "Logical PixelId Count Mismatch",
@@ -972,7 +969,6 @@ StreamMonitor::rxPacket( const ADARA::PixelMappingAltPkt &a_pkt )
                         logical_start, logical_stop, logical_step,
                         cnt, pixel_count,
                         "Skip Section..." );
-                    usleep(30000); // give syslog a chance...
 
                     // Next Section
                     skip_pixel_count += pixel_count;
@@ -987,10 +983,9 @@ StreamMonitor::rxPacket( const ADARA::PixelMappingAltPkt &a_pkt )
                 // Skip Unmapped Sections of Pixel Map...!
                 if ( bank_id == (uint16_t) UNMAPPED_BANK )
                 {
-                    syslog( LOG_ERR,
+                    ASYNC_SYSLOG( LOG_ERR,
                         "%s: Unmapped Shorthand Section - Skip...",
                         "ADARA::PixelMappingAltPkt" );
-                    usleep(30000); // give syslog a chance...
 
                     // Next Section
                     skip_pixel_count += pixel_count;
@@ -1027,10 +1022,9 @@ StreamMonitor::rxPacket( const ADARA::PixelMappingAltPkt &a_pkt )
                     m_pixbankmap.resize( max_pid + 1, -1 );
 
 #ifdef DEBUG_PIXMAP
-                    syslog( LOG_ERR,
+                    ASYNC_SYSLOG( LOG_ERR,
                         "%s: Max Logical PixelId Set to %u",
                         "ADARA::PixelMappingAltPkt", max_pid );
-                    usleep(30000); // give syslog a chance...
 #endif
                 }
 
@@ -1049,7 +1043,7 @@ StreamMonitor::rxPacket( const ADARA::PixelMappingAltPkt &a_pkt )
                 tot_pixel_count += pixel_count;
 
 #ifdef DEBUG_PIXMAP
-                syslog( LOG_INFO,
+                ASYNC_SYSLOG( LOG_INFO,
                     "%s: %s, %s=%u %s=%d/%d/%d %s=%d/%d/%d %s=%u %s=%u",
                     "ADARA::PixelMappingAltPkt",
                     "Done with Shorthand Section",
@@ -1060,7 +1054,6 @@ StreamMonitor::rxPacket( const ADARA::PixelMappingAltPkt &a_pkt )
                     logical_start, logical_stop, logical_step,
                     "count", pixel_count,
                     "total", tot_pixel_count );
-                usleep(30000); // give syslog a chance...
 #endif
             }
 
@@ -1070,10 +1063,9 @@ StreamMonitor::rxPacket( const ADARA::PixelMappingAltPkt &a_pkt )
                 // Skip Unmapped Sections of Pixel Map...!
                 if ( bank_id == (uint16_t) UNMAPPED_BANK )
                 {
-                    syslog( LOG_ERR,
+                    ASYNC_SYSLOG( LOG_ERR,
                         "%s: Unmapped Direct Section - Skip...",
                         "ADARA::PixelMappingAltPkt" );
-                    usleep(30000); // give syslog a chance...
 
                     // Next Section
                     skip_pixel_count += pixel_count;
@@ -1114,10 +1106,9 @@ StreamMonitor::rxPacket( const ADARA::PixelMappingAltPkt &a_pkt )
                     m_pixbankmap.resize( max_pid + 1, -1 );
 
 #ifdef DEBUG_PIXMAP
-                    syslog( LOG_ERR,
+                    ASYNC_SYSLOG( LOG_ERR,
                         "%s: Max Logical PixelId Set to %u",
                         "ADARA::PixelMappingAltPkt", max_pid );
-                    usleep(30000); // give syslog a chance...
 #endif
                 }
 
@@ -1143,7 +1134,7 @@ StreamMonitor::rxPacket( const ADARA::PixelMappingAltPkt &a_pkt )
                 // Done with This Direct Section
 
 #ifdef DEBUG_PIXMAP
-                syslog( LOG_INFO,
+                ASYNC_SYSLOG( LOG_INFO,
                     "%s: %s, %s=%u %s=%d %s=%u count=%u tot=%u",
                     "ADARA::PixelMappingAltPkt",
                     "Done with Direct Section",
@@ -1151,7 +1142,6 @@ StreamMonitor::rxPacket( const ADARA::PixelMappingAltPkt &a_pkt )
                     "physical", physical_start,
                     "Last Logical PixelId", last_pid,
                     pixel_count, tot_pixel_count );
-                usleep(30000); // give syslog a chance...
 #endif
             }
 
@@ -1176,7 +1166,7 @@ StreamMonitor::rxPacket( const ADARA::PixelMappingAltPkt &a_pkt )
 
         // Done
 
-        syslog( LOG_INFO,
+        ASYNC_SYSLOG( LOG_INFO,
             "%s: %s %s=%u %s=%u %s=%u, %s=%u %s=%u %s=%lu",
             "ADARA::PixelMappingAltPkt",
             "Done with Packet, PixelIds",
@@ -1186,7 +1176,6 @@ StreamMonitor::rxPacket( const ADARA::PixelMappingAltPkt &a_pkt )
             "Sections Used", section_count,
             "Skip", skip_sections,
             "PixelBankMap.size()", m_pixbankmap.size() );
-        usleep(30000); // give syslog a chance...
 
         m_pixbankmap_processed = true;
     }
@@ -1265,12 +1254,11 @@ StreamMonitor::rxPacket( const ADARA::PixelMappingPkt &a_pkt )
             }
         }
 
-        syslog( LOG_INFO, "%s: %s %s=%u, %s=%lu",
+        ASYNC_SYSLOG( LOG_INFO, "%s: %s %s=%u, %s=%lu",
             "ADARA::PixelMappingPkt",
             "Done with Packet, PixelIds",
             "Max", max_pid,
             "PixelBankMap.size()", m_pixbankmap.size() );
-        usleep(30000); // give syslog a chance...
 
         m_pixbankmap_processed = true;
     }
@@ -1391,12 +1379,14 @@ StreamMonitor::rxPacket( const ADARA::BankedEventPkt &a_pkt )
 
             if ( bank_id == -1 )
             {
-                m_stream_metrics.m_pixel_map_err += bank_event_count;
+                m_stream_metrics.m_pixel_map_err +=
+                    bank_event_count * m_event_decimation;
                 rpos += bank_event_count << 1;
             }
             else if ( bank_id == -2 )
             {
-                m_stream_metrics.m_pixel_errors += bank_event_count;
+                m_stream_metrics.m_pixel_errors +=
+                    bank_event_count * m_event_decimation;
                 rpos += bank_event_count << 1;
             }
             else if (( ibank = m_bank_info.find( bank_id )) != m_bank_info.end() )
@@ -1463,6 +1453,10 @@ StreamMonitor::rxPacket( const ADARA::BankedEventPkt &a_pkt )
     }
 
     m_last_pulse_time = pulse_time;
+
+    // Only 1-in-N pulses carry events when decimating, scale back up
+    event_count *= m_event_decimation;
+
     m_bank_count_info.addSample( event_count );
     m_run_metrics.m_total_counts += event_count;
     m_run_metrics.m_time = ( pulse_time - m_first_pulse_time )
@@ -1586,12 +1580,14 @@ StreamMonitor::rxPacket( const ADARA::BankedEventStatePkt &a_pkt )
 
             if ( bank_id == -1 )
             {
-                m_stream_metrics.m_pixel_map_err += bank_event_count;
+                m_stream_metrics.m_pixel_map_err +=
+                    bank_event_count * m_event_decimation;
                 rpos += bank_event_count << 1;
             }
             else if ( bank_id == -2 )
             {
-                m_stream_metrics.m_pixel_errors += bank_event_count;
+                m_stream_metrics.m_pixel_errors +=
+                    bank_event_count * m_event_decimation;
                 rpos += bank_event_count << 1;
             }
             else if (( ibank = m_bank_info.find( bank_id )) != m_bank_info.end() )
@@ -1658,6 +1654,10 @@ StreamMonitor::rxPacket( const ADARA::BankedEventStatePkt &a_pkt )
     }
 
     m_last_pulse_time = pulse_time;
+
+    // Only 1-in-N pulses carry events when decimating, scale back up
+    event_count *= m_event_decimation;
+
     m_bank_count_info.addSample( event_count );
     m_run_metrics.m_total_counts += event_count;
     m_run_metrics.m_time = ( pulse_time - m_first_pulse_time )
@@ -2121,12 +2121,11 @@ StreamMonitor::rxPacket( const ADARA::MultVariableU32Pkt &a_pkt )
     uint32_t numVals = a_pkt.numValues();
 
     // struct timespec Ts = a_pkt.timestamp();
-    // syslog( LOG_ERR, "%s %s=%u %s=%u %s=%u at %lu.%09lu",
+    // ASYNC_SYSLOG( LOG_ERR, "%s %s=%u %s=%u %s=%u at %lu.%09lu",
         // "MultVariableU32Pkt()",
         // "devId", a_pkt.devId(), "varId", a_pkt.varId(),
         // "numVals", numVals,
         // Ts.tv_sec - ADARA::EPICS_EPOCH_OFFSET, Ts.tv_nsec );
-    // usleep(30000); // give syslog a chance...
 
     for ( uint32_t i=0 ; i < numVals ; i++ )
     {
@@ -2136,12 +2135,11 @@ StreamMonitor::rxPacket( const ADARA::MultVariableU32Pkt &a_pkt )
         if ( it_vals == a_pkt.values().end()
                 || it_tofs == a_pkt.tofs().end() )
         {
-            syslog( LOG_ERR, "%s %s=%u %s=%u %s i=%u/%u at %lu.%09lu",
+            ASYNC_SYSLOG( LOG_ERR, "%s %s=%u %s=%u %s i=%u/%u at %lu.%09lu",
                 "MultVariableU32Pkt()",
                 "devId", a_pkt.devId(), "varId", a_pkt.varId(),
                 "Premature End of Value or TOF Vector", i, numVals,
                 ts.tv_sec - ADARA::EPICS_EPOCH_OFFSET, ts.tv_nsec );
-            usleep(30000); // give syslog a chance...
             return false;
         }
 
@@ -2174,12 +2172,11 @@ StreamMonitor::rxPacket( const ADARA::MultVariableDoublePkt &a_pkt )
     uint32_t numVals = a_pkt.numValues();
 
     // struct timespec Ts = a_pkt.timestamp();
-    // syslog( LOG_ERR, "%s %s=%u %s=%u %s=%u at %lu.%09lu",
+    // ASYNC_SYSLOG( LOG_ERR, "%s %s=%u %s=%u %s=%u at %lu.%09lu",
         // "MultVariableDoublePkt()",
         // "devId", a_pkt.devId(), "varId", a_pkt.varId(),
         // "numVals", numVals,
         // Ts.tv_sec - ADARA::EPICS_EPOCH_OFFSET, Ts.tv_nsec );
-    // usleep(30000); // give syslog a chance...
 
     for ( uint32_t i=0 ; i < numVals ; i++ )
     {
@@ -2189,12 +2186,11 @@ StreamMonitor::rxPacket( const ADARA::MultVariableDoublePkt &a_pkt )
         if ( it_vals == a_pkt.values().end()
                 || it_tofs == a_pkt.tofs().end() )
         {
-            syslog( LOG_ERR, "%s %s=%u %s=%u %s i=%u/%u at %lu.%09lu",
+            ASYNC_SYSLOG( LOG_ERR, "%s %s=%u %s=%u %s i=%u/%u at %lu.%09lu",
                 "MultVariableDoublePkt()",
                 "devId", a_pkt.devId(), "varId", a_pkt.varId(),
                 "Premature End of Value or TOF Vector", i, numVals,
                 ts.tv_sec - ADARA::EPICS_EPOCH_OFFSET, ts.tv_nsec );
-            usleep(30000); // give syslog a chance...
             return false;
         }
 
@@ -2227,12 +2223,11 @@ StreamMonitor::rxPacket( const ADARA::MultVariableStringPkt &a_pkt )
     uint32_t numVals = a_pkt.numValues();
 
     // struct timespec Ts = a_pkt.timestamp();
-    // syslog( LOG_ERR, "%s %s=%u %s=%u %s=%u at %lu.%09lu",
+    // ASYNC_SYSLOG( LOG_ERR, "%s %s=%u %s=%u %s=%u at %lu.%09lu",
         // "MultVariableStringPkt()",
         // "devId", a_pkt.devId(), "varId", a_pkt.varId(),
         // "numVals", numVals,
         // Ts.tv_sec - ADARA::EPICS_EPOCH_OFFSET, Ts.tv_nsec );
-    // usleep(30000); // give syslog a chance...
 
     for ( uint32_t i=0 ; i < numVals ; i++ )
     {
@@ -2242,12 +2237,11 @@ StreamMonitor::rxPacket( const ADARA::MultVariableStringPkt &a_pkt )
         if ( it_vals == a_pkt.values().end()
                 || it_tofs == a_pkt.tofs().end() )
         {
-            syslog( LOG_ERR, "%s %s=%u %s=%u %s i=%u/%u at %lu.%09lu",
+            ASYNC_SYSLOG( LOG_ERR, "%s %s=%u %s=%u %s i=%u/%u at %lu.%09lu",
                 "MultVariableStringPkt()",
                 "devId", a_pkt.devId(), "varId", a_pkt.varId(),
                 "Premature End of Value or TOF Vector", i, numVals,
                 ts.tv_sec - ADARA::EPICS_EPOCH_OFFSET, ts.tv_nsec );
-            usleep(30000); // give syslog a chance...
             return false;
         }
 
@@ -2281,12 +2275,11 @@ StreamMonitor::rxPacket( const ADARA::MultVariableU32ArrayPkt &a_pkt )
     uint32_t numVals = a_pkt.numValues();
 
     // struct timespec Ts = a_pkt.timestamp();
-    // syslog( LOG_ERR, "%s %s=%u %s=%u %s=%u at %lu.%09lu",
+    // ASYNC_SYSLOG( LOG_ERR, "%s %s=%u %s=%u %s=%u at %lu.%09lu",
         // "MultVariableU32ArrayPkt()",
         // "devId", a_pkt.devId(), "varId", a_pkt.varId(),
         // "numVals", numVals,
         // Ts.tv_sec - ADARA::EPICS_EPOCH_OFFSET, Ts.tv_nsec );
-    // usleep(30000); // give syslog a chance...
 
     for ( uint32_t i=0 ; i < numVals ; i++ )
     {
@@ -2296,13 +2289,12 @@ StreamMonitor::rxPacket( const ADARA::MultVariableU32ArrayPkt &a_pkt )
         if ( it_vals == a_pkt.values().end()
                 || it_tofs == a_pkt.tofs().end() )
         {
-            syslog( LOG_ERR,
+            ASYNC_SYSLOG( LOG_ERR,
                 "%s %s=%u %s=%u %s i=%u/%u at %lu.%09lu",
                 "MultVariableU32ArrayPkt()",
                 "devId", a_pkt.devId(), "varId", a_pkt.varId(),
                 "Premature End of Value or TOF Vector", i, numVals,
                 ts.tv_sec - ADARA::EPICS_EPOCH_OFFSET, ts.tv_nsec );
-            usleep(30000); // give syslog a chance...
             return false;
         }
 
@@ -2336,12 +2328,11 @@ StreamMonitor::rxPacket( const ADARA::MultVariableDoubleArrayPkt &a_pkt )
     uint32_t numVals = a_pkt.numValues();
 
     // struct timespec Ts = a_pkt.timestamp();
-    // syslog( LOG_ERR, "%s %s=%u %s=%u %s=%u at %lu.%09lu",
+    // ASYNC_SYSLOG( LOG_ERR, "%s %s=%u %s=%u %s=%u at %lu.%09lu",
         // "MultVariableDoubleArrayPkt()",
         // "devId", a_pkt.devId(), "varId", a_pkt.varId(),
         // "numVals", numVals,
         // Ts.tv_sec - ADARA::EPICS_EPOCH_OFFSET, Ts.tv_nsec );
-    // usleep(30000); // give syslog a chance...
 
     for ( uint32_t i=0 ; i < numVals ; i++ )
     {
@@ -2351,12 +2342,11 @@ StreamMonitor::rxPacket( const ADARA::MultVariableDoubleArrayPkt &a_pkt )
         if ( it_vals == a_pkt.values().end()
                 || it_tofs == a_pkt.tofs().end() )
         {
-            syslog( LOG_ERR, "%s %s=%u %s=%u %s i=%u/%u at %lu.%09lu",
+            ASYNC_SYSLOG( LOG_ERR, "%s %s=%u %s=%u %s i=%u/%u at %lu.%09lu",
                 "MultVariableDoubleArrayPkt()",
                 "devId", a_pkt.devId(), "varId", a_pkt.varId(),
                 "Premature End of Value or TOF Vector", i, numVals,
                 ts.tv_sec - ADARA::EPICS_EPOCH_OFFSET, ts.tv_nsec );
-            usleep(30000); // give syslog a chance...
             return false;
         }
 
@@ -2618,8 +2608,7 @@ StreamMonitor::dbThread()
 {
     m_db_state = TS_ENTER;
 
-    syslog( LOG_INFO, "Database update thread started." );
-    usleep(30000); // give syslog a chance...
+    ASYNC_SYSLOG( LOG_INFO, "Database update thread started." );
 
     // Attempt to connect
     string connect_string;
@@ -2666,20 +2655,18 @@ StreamMonitor::dbThread()
         ++m_db_ticker;
         m_db_state = TS_CONNECTING;
 
-        syslog( LOG_INFO,
+        ASYNC_SYSLOG( LOG_INFO,
             "Connecting to Database (%s=%s %s=%s %s=%s %s=%s)",
             "host", m_db_info->host.c_str(),
             "port", boost::lexical_cast<string>(m_db_info->port).c_str(),
             "user", m_db_info->user.c_str(),
             "dbname", m_db_info->name.c_str() );
-        usleep(30000); // give syslog a chance...
 
         conn = PQconnectdb( connect_string.c_str() );
 
         if ( conn )
         {
-            syslog( LOG_INFO, "Database Connected." );
-            usleep(30000); // give syslog a chance...
+            ASYNC_SYSLOG( LOG_INFO, "Database Connected." );
             ++m_db_ticker;
             m_db_state = TS_RUNNING;
 
@@ -2752,10 +2739,9 @@ StreamMonitor::dbThread()
                                     PVInfoLite( ipvm->second ),
                                         ss.str() ) );
 
-                                syslog( LOG_ERR, "%s - Trimmed to [%s].",
+                                ASYNC_SYSLOG( LOG_ERR, "%s - Trimmed to [%s].",
                                     "Double Array Too Long",
                                     ss.str().c_str() );
-                                usleep(30000); // give syslog a chance...
                             }
                             else
                             {
@@ -2781,10 +2767,9 @@ StreamMonitor::dbThread()
                                     PVInfoLite( ipvm->second ),
                                         ss.str() ) );
 
-                                syslog( LOG_ERR, "%s - Trimmed to [%s].",
+                                ASYNC_SYSLOG( LOG_ERR, "%s - Trimmed to [%s].",
                                     "UInt Array Too Long",
                                     ss.str().c_str() );
-                                usleep(30000); // give syslog a chance...
                             }
                             else
                             {
@@ -2817,13 +2802,10 @@ StreamMonitor::dbThread()
                     res = PQexec( conn, buf );
                     if ( !res || PQresultStatus( res ) != PGRES_TUPLES_OK )
                     {
-                        syslog( LOG_ERR,
+                        ASYNC_SYSLOG( LOG_ERR,
                             "Database Double Update Call Failed." );
-                        usleep(30000); // give syslog a chance...
-                        syslog( LOG_ERR, PQresultErrorMessage( res ));
-                        usleep(30000); // give syslog a chance...
-                        syslog( LOG_ERR, buf );
-                        usleep(30000); // give syslog a chance...
+                        ASYNC_SYSLOG( LOG_ERR, PQresultErrorMessage( res ));
+                        ASYNC_SYSLOG( LOG_ERR, buf );
 
                         PQclear( res );
                         update = false;
@@ -2853,13 +2835,10 @@ StreamMonitor::dbThread()
                     res = PQexec( conn, buf );
                     if ( !res || PQresultStatus( res ) != PGRES_TUPLES_OK )
                     {
-                        syslog( LOG_ERR,
+                        ASYNC_SYSLOG( LOG_ERR,
                             "Database Int Update Call Failed." );
-                        usleep(30000); // give syslog a chance...
-                        syslog( LOG_ERR, PQresultErrorMessage( res ));
-                        usleep(30000); // give syslog a chance...
-                        syslog( LOG_ERR, buf );
-                        usleep(30000); // give syslog a chance...
+                        ASYNC_SYSLOG( LOG_ERR, PQresultErrorMessage( res ));
+                        ASYNC_SYSLOG( LOG_ERR, buf );
 
                         PQclear( res );
                         update = false;
@@ -2886,12 +2865,11 @@ StreamMonitor::dbThread()
                             false /* a_preserve_uri */,
                             true /* a_preserve_whitespace */ ) )
                     {
-                        syslog( LOG_WARNING,
+                        ASYNC_SYSLOG( LOG_WARNING,
                       "String PV \"%s\" Value Sanitized from [%s] to [%s]",
                             istrpv->first.m_name.c_str(),
                             istrpv->second.c_str(),
                             strpv_value.c_str() );
-                        usleep(30000); // give syslog a chance...
                     }
 
                     size_t sz = cmd_prefix.size() + 1
@@ -2915,9 +2893,8 @@ StreamMonitor::dbThread()
 
                         sprintf( buf, "%s", ss.str().c_str() );
 
-                        syslog( LOG_ERR, "%s - Trimmed to [%s].",
+                        ASYNC_SYSLOG( LOG_ERR, "%s - Trimmed to [%s].",
                             "Database String Command Too Long", buf );
-                        usleep(30000); // give syslog a chance...
                     }
                     else
                     {
@@ -2934,13 +2911,10 @@ StreamMonitor::dbThread()
                     res = PQexec( conn, buf );
                     if ( !res || PQresultStatus( res ) != PGRES_TUPLES_OK )
                     {
-                        syslog( LOG_ERR,
+                        ASYNC_SYSLOG( LOG_ERR,
                             "Database String Update Call Failed." );
-                        usleep(30000); // give syslog a chance...
-                        syslog( LOG_ERR, PQresultErrorMessage( res ));
-                        usleep(30000); // give syslog a chance...
-                        syslog( LOG_ERR, buf );
-                        usleep(30000); // give syslog a chance...
+                        ASYNC_SYSLOG( LOG_ERR, PQresultErrorMessage( res ));
+                        ASYNC_SYSLOG( LOG_ERR, buf );
 
                         PQclear( res );
                         update = false;
@@ -2954,22 +2928,19 @@ StreamMonitor::dbThread()
                 }
             }
             PQfinish( conn );
-            syslog( LOG_INFO, "Database Disconnected." );
-            usleep(30000); // give syslog a chance...
+            ASYNC_SYSLOG( LOG_INFO, "Database Disconnected." );
             m_db_state = TS_DB_ERROR;
             ++m_db_ticker;
         }
         else
         {
-            syslog( LOG_INFO, "Database Connect FAILED!" );
-            usleep(30000); // give syslog a chance...
+            ASYNC_SYSLOG( LOG_INFO, "Database Connect FAILED!" );
         }
 
         // Error may have been caused by DB being off-line,
         // or network error...
         // wait a bit and try connecting again
-        syslog( LOG_INFO, "Sleeping Before Database Connection Attempt." );
-        usleep(30000); // give syslog a chance...
+        ASYNC_SYSLOG( LOG_INFO, "Sleeping Before Database Connection Attempt." );
         for ( i = 0; i < 15; ++i )
         {
             sleep( 1 );
@@ -2977,8 +2948,7 @@ StreamMonitor::dbThread()
         }
     }
 
-    syslog( LOG_INFO, "Database update thread stopping." );
-    usleep(30000); // give syslog a chance...
+    ASYNC_SYSLOG( LOG_INFO, "Database update thread stopping." );
     m_db_state = TS_EXIT;
 }
 #endif
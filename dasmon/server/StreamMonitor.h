@@ -344,6 +344,9 @@ public:
     void            resendState( IStreamListener &a_listener ) const;
     void            enableDiagnostics( bool a_diagnostics )
                     { m_diagnostics = a_diagnostics; }
+    /// Request neutron events from only 1-in-N pulses (takes effect on the next connect)
+    void            setEventDecimation( uint32_t a_decimation )
+                    { m_event_decimation = a_decimation ? a_decimation : 1; }
 
 
     inline uint32_t getProcTicker() { return m_proc_ticker; }
@@ -477,6 +480,7 @@ private:
     std::map<uint32_t,CountInfo<uint64_t> >     m_mon_count_info;
     std::map<uint32_t,uint64_t>     m_mon_last_pulse;
     uint64_t                        m_mon_event_count;
+    uint32_t                        m_event_decimation;
     bool                            m_recording;
     uint32_t                        m_run_num;
     uint32_t                        m_run_timestamp;
@@ -44,6 +44,7 @@
 #include "StreamMonitor.h"
 #include <boost/program_options.hpp>
 #include <syslog.h>
+#include "AsyncLog.h"
 #include <unistd.h>
 #include "ADARAUtils.h"
 
@@ -78,8 +79,7 @@ signalParent( int ret_code )
     if ( sigqueue( pid, SIGUSR1, data ) < 0 )
     {
         int e = errno;
-        syslog( LOG_ERR, "Unable to signal parent: %s", strerror(e));
-        usleep(30000); // give syslog a chance...
+        ASYNC_SYSLOG( LOG_ERR, "Unable to signal parent: %s", strerror(e));
     }
 }
 
@@ -92,8 +92,7 @@ daemonize()
     if ( pid < 0 )
     {
         int e = errno;
-        syslog( LOG_ERR, "Unable to fork: %s", strerror(e));
-        usleep(30000); // give syslog a chance...
+        ASYNC_SYSLOG( LOG_ERR, "Unable to fork: %s", strerror(e));
         exit(1);
     }
 
@@ -112,8 +111,7 @@ daemonize()
     if ( setsid() < 0 )
     {
         int e = errno;
-        syslog( LOG_ERR, "Unable to setsid: %s", strerror(e));
-        usleep(30000); // give syslog a chance...
+        ASYNC_SYSLOG( LOG_ERR, "Unable to setsid: %s", strerror(e));
         exit(1);
     }
 
@@ -121,8 +119,7 @@ daemonize()
     if ( pid < 0 )
     {
         int e = errno;
-        syslog( LOG_ERR, "Second fork failed: %s", strerror(e));
-        usleep(30000); // give syslog a chance...
+        ASYNC_SYSLOG( LOG_ERR, "Second fork failed: %s", strerror(e));
         exit(1);
     }
     else if ( pid )
@@ -146,15 +143,13 @@ daemonize()
 
     // Reopen log
     openlog( "dasmond", 0, LOG_DAEMON );
-    syslog( LOG_INFO, "dasmond daemon starting" );
-    usleep(30000); // give syslog a chance...
+    ASYNC_SYSLOG( LOG_INFO, "dasmond daemon starting" );
 
     // Chdir to "/"
     if ( chdir("/") < 0 )
     {
         int e = errno;
-        syslog( LOG_ERR, "Chdir failed: %s", strerror(e));
-        usleep(30000); // give syslog a chance...
+        ASYNC_SYSLOG( LOG_ERR, "Chdir failed: %s", strerror(e));
         exit(1);
     }
 }
@@ -184,6 +179,8 @@ int main(int argc, char *argv[])
     unsigned long   max_tof;
     bool            daemon = false;
     uint16_t        metrics_period = 4;
+    uint32_t        coalesce_ms = 0;
+    uint32_t        event_decimation = 1;
 
 #ifndef NO_DB
     DBConnectInfo   db_info;
@@ -203,6 +200,9 @@ int main(int argc, char *argv[])
             ("broker_user", po::value<string>( &broker_user )->default_value( "" ), "set AMQP broker user name")
             ("broker_pass", po::value<string>( &broker_pass )->default_value( "" ), "set AMQP broker password")
             ("metrics_period", po::value<unsigned short>( &metrics_period )->default_value( 4 ), "Metrics AMQP broadcast period")
+            ("compact_app", "Use compact binary ComBus encoding on APP topic (requires ComBus 2.4 clients)")
+            ("coalesce_ms", po::value<uint32_t>( &coalesce_ms )->default_value( 0 ), "Metrics AMQP coalescing window in msec (0 = off)")
+            ("event_decimation", po::value<uint32_t>( &event_decimation )->default_value( 1 ), "Request neutron events from only 1-in-N pulses (counts are scaled; requires an SMS supporting filtered subscriptions)")
             ("nodiag", "Disable low-level stream diagnostics (test only)")
             ("maxtof", po::value<unsigned long>( &max_tof )->default_value( 33333 ), "set maximum time of flight in usec")
             ("daemon", "Run as background daemon")
@@ -240,16 +240,14 @@ int main(int argc, char *argv[])
     // Initialize SysLog
 
     openlog( "dasmond", 0, LOG_DAEMON );
-    syslog( LOG_INFO,
+    ASYNC_SYSLOG( LOG_INFO,
         "Dasmon Daemon %s Started. (%s %s, %s %s)", DASMON_VERSION,
         "ADARA Common", ADARA::VERSION.c_str(),
         "ComBus", ADARA::ComBus::VERSION.c_str() );
-    usleep(30000); // give syslog a chance...
 
     if ( !opt_map.count( "domain" ))
     {
-        syslog( LOG_WARNING, "No communication domain specified - probably an error." );
-        usleep(30000); // give syslog a chance...
+        ASYNC_SYSLOG( LOG_WARNING, "No communication domain specified - probably an error." );
         cout << "No communication domain specified - probably an error."  << endl;
     }
 
@@ -261,17 +259,20 @@ int main(int argc, char *argv[])
         domain, "DASMON", 0, broker_uri, broker_user, broker_pass,
         "Dasmon Daemon ComBus", "Dasmon Daemon Error ComBus" );
 
+    if ( opt_map.count( "compact_app" ))
+        combus->setTopicEncoding( "APP", ADARA::ComBus::ENCODING_COMPACT );
+
+    combus->setCoalesceWindow( coalesce_ms );
+
     try
     {
         if ( !combus->waitForConnect( 5 ) )
         {
-            syslog( LOG_ERR, "ComBus: Failed to Connect to AMQP!" );
-            usleep(30000); // give syslog a chance...
+            ASYNC_SYSLOG( LOG_ERR, "ComBus: Failed to Connect to AMQP!" );
         }
         else
         {
-            syslog( LOG_NOTICE, "ComBus: Connected to AMQP." );
-            usleep(30000); // give syslog a chance...
+            ASYNC_SYSLOG( LOG_NOTICE, "ComBus: Connected to AMQP." );
         }
 
 #ifndef NO_DB
@@ -282,6 +283,8 @@ int main(int argc, char *argv[])
         if ( opt_map.count( "nodiag" ))
             monitor.enableDiagnostics(false);
 
+        monitor.setEventDecimation( event_decimation );
+
         StreamAnalyzer  analyzer( monitor, config_dir );
         ComBusRouter    router( monitor, analyzer, metrics_period );
 
@@ -300,15 +303,14 @@ int main(int argc, char *argv[])
     }
     catch( exception &e )
     {
-        syslog( LOG_ERR, "Unhandled exception: %s", e.what());
-        usleep(30000); // give syslog a chance...
+        ASYNC_SYSLOG( LOG_ERR, "Unhandled exception: %s", e.what());
     }
 
     delete combus;
 
-    syslog( LOG_INFO, "Dasmon service stopping." );
-    usleep(30000); // give syslog a chance...
+    ASYNC_SYSLOG( LOG_INFO, "Dasmon service stopping." );
 
+    ::ADARA::AsyncLog::flush();
     closelog();
 
     return res;
@@ -0,0 +1,342 @@
+#include <algorithm>
+#include <string>
+#include <sstream>
+
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "CompressedFile.h"
+
+static ssize_t readFull(int fd, void *buf, size_t len)
+{
+	size_t got = 0;
+
+	while (got < len) {
+		ssize_t rc = ::read(fd, (char *) buf + got, len - got);
+		if (rc < 0 && errno == EINTR)
+			continue;
+		if (rc < 0)
+			return rc;
+		if (!rc)
+			break;
+		got += rc;
+	}
+
+	return got;
+}
+
+static ssize_t preadFull(int fd, void *buf, size_t len, off_t offset)
+{
+	size_t got = 0;
+
+	while (got < len) {
+		ssize_t rc = ::pread(fd, (char *) buf + got, len - got,
+			offset + got);
+		if (rc < 0 && errno == EINTR)
+			continue;
+		if (rc < 0)
+			return rc;
+		if (!rc)
+			break;
+		got += rc;
+	}
+
+	return got;
+}
+
+static bool writeFull(int fd, const void *buf, size_t len)
+{
+	size_t done = 0;
+
+	while (done < len) {
+		ssize_t rc = ::write(fd, (const char *) buf + done, len - done);
+		if (rc < 0 && errno == EINTR)
+			continue;
+		if (rc <= 0)
+			return false;
+		done += rc;
+	}
+
+	return true;
+}
+
+CompressedFile::CompressedFile() :
+	m_fd(-1), m_rawStart(1, 0), m_packedStart(1, 0), m_cached(-1),
+	m_dctx(NULL)
+{
+}
+
+CompressedFile::~CompressedFile()
+{
+	if (m_dctx)
+		LZ4F_freeDecompressionContext(m_dctx);
+}
+
+bool CompressedFile::detect(int fd)
+{
+	uint32_t magic;
+
+	if (preadFull(fd, &magic, sizeof(magic), 0) != sizeof(magic))
+		return false;
+
+	/* No ADARA packet header starts like this; the payload length
+	 * would be over 400 MB.
+	 */
+	return magic == COMPRESSED_FILE_LZ4_MAGIC;
+}
+
+bool CompressedFile::compress(int in_fd, int out_fd, uint32_t frame_size,
+		uint64_t &packed_size, std::string &err,
+		const volatile bool *stop)
+{
+	if (frame_size < MIN_FRAME_SIZE)
+		frame_size = MIN_FRAME_SIZE;
+	if (frame_size > MAX_FRAME_SIZE)
+		frame_size = MAX_FRAME_SIZE;
+
+	LZ4F_preferences_t prefs;
+	memset(&prefs, 0, sizeof(prefs));
+	prefs.frameInfo.blockSizeID = LZ4F_max4MB;
+	prefs.frameInfo.blockMode = LZ4F_blockIndependent;
+	prefs.frameInfo.contentChecksumFlag = LZ4F_contentChecksumEnabled;
+
+	std::vector<char> raw(frame_size);
+	std::vector<char> packed(LZ4F_compressFrameBound(frame_size, &prefs));
+	std::vector<CompressedFrameEntry> table;
+	uint64_t raw_size = 0;
+
+	packed_size = 0;
+
+	for (;;) {
+		if (stop && *stop) {
+			err = "Stopped";
+			return false;
+		}
+
+		ssize_t len = readFull(in_fd, &raw[0], frame_size);
+		if (len < 0) {
+			err = "Read error: ";
+			err += strerror(errno);
+			return false;
+		}
+		if (!len)
+			break;
+
+		prefs.frameInfo.contentSize = len;
+		size_t rc = LZ4F_compressFrame(&packed[0], packed.size(),
+			&raw[0], len, &prefs);
+		if (LZ4F_isError(rc)) {
+			err = "Compression error: ";
+			err += LZ4F_getErrorName(rc);
+			return false;
+		}
+
+		if (!writeFull(out_fd, &packed[0], rc)) {
+			err = "Write error: ";
+			err += strerror(errno);
+			return false;
+		}
+
+		CompressedFrameEntry ent;
+		ent.packed_size = rc;
+		ent.raw_size = len;
+		table.push_back(ent);
+
+		raw_size += len;
+		packed_size += rc;
+	}
+
+	CompressedFileFooter footer;
+	footer.raw_size = raw_size;
+	footer.num_frames = table.size();
+	footer.magic = COMPRESSED_FILE_FOOTER_MAGIC;
+
+	uint32_t hdr[2];
+	hdr[0] = COMPRESSED_FILE_TABLE_MAGIC;
+	hdr[1] = table.size() * sizeof(CompressedFrameEntry) + sizeof(footer);
+
+	if (!writeFull(out_fd, hdr, sizeof(hdr))
+			|| (!table.empty() && !writeFull(out_fd, &table[0],
+				table.size() * sizeof(CompressedFrameEntry)))
+			|| !writeFull(out_fd, &footer, sizeof(footer))) {
+		err = "Write error: ";
+		err += strerror(errno);
+		return false;
+	}
+
+	packed_size += sizeof(hdr) + hdr[1];
+
+	return true;
+}
+
+bool CompressedFile::open(int fd, std::string &err)
+{
+	struct stat st;
+	if (fstat(fd, &st)) {
+		err = "Stat error: ";
+		err += strerror(errno);
+		return false;
+	}
+
+	CompressedFileFooter footer;
+	uint32_t hdr[2];
+
+	if ((uint64_t) st.st_size < sizeof(hdr) + sizeof(footer)
+			|| preadFull(fd, &footer, sizeof(footer),
+				st.st_size - sizeof(footer)) != sizeof(footer)
+			|| footer.magic != COMPRESSED_FILE_FOOTER_MAGIC) {
+		err = "Missing seek table footer";
+		return false;
+	}
+
+	uint64_t table_len = (uint64_t) footer.num_frames
+		* sizeof(CompressedFrameEntry);
+	if (table_len + sizeof(hdr) + sizeof(footer) > (uint64_t) st.st_size) {
+		err = "Seek table larger than file";
+		return false;
+	}
+
+	off_t table_off = st.st_size - sizeof(footer) - table_len;
+	std::vector<CompressedFrameEntry> table(footer.num_frames);
+
+	if (preadFull(fd, hdr, sizeof(hdr), table_off - sizeof(hdr))
+				!= sizeof(hdr)
+			|| hdr[0] != COMPRESSED_FILE_TABLE_MAGIC
+			|| hdr[1] != table_len + sizeof(footer)
+			|| (table_len && preadFull(fd, &table[0], table_len,
+				table_off) != (ssize_t) table_len)) {
+		err = "Bad seek table";
+		return false;
+	}
+
+	std::vector<uint64_t> raw_start(1, 0), packed_start(1, 0);
+	for (uint32_t i = 0; i < table.size(); i++) {
+		const CompressedFrameEntry &ent = table[i];
+		if (!ent.raw_size || !ent.packed_size
+				|| ent.raw_size > MAX_FRAME_SIZE) {
+			err = "Bad frame size in seek table";
+			return false;
+		}
+		raw_start.push_back(raw_start.back() + ent.raw_size);
+		packed_start.push_back(packed_start.back() + ent.packed_size);
+	}
+
+	if (raw_start.back() != footer.raw_size
+			|| packed_start.back() + sizeof(hdr) + hdr[1]
+				!= (uint64_t) st.st_size) {
+		err = "Seek table doesn't match file";
+		return false;
+	}
+
+	m_fd = fd;
+	m_rawStart.swap(raw_start);
+	m_packedStart.swap(packed_start);
+	m_cached = -1;
+
+	return true;
+}
+
+bool CompressedFile::loadFrame(uint32_t idx)
+{
+	if (m_cached == idx)
+		return true;
+
+	m_cached = -1;
+
+	size_t packed_len = m_packedStart[idx + 1] - m_packedStart[idx];
+	size_t raw_len = m_rawStart[idx + 1] - m_rawStart[idx];
+
+	m_packed.resize(packed_len);
+	m_frame.resize(raw_len);
+
+	ssize_t rc = preadFull(m_fd, &m_packed[0], packed_len,
+		m_packedStart[idx]);
+	if (rc != (ssize_t) packed_len) {
+		std::stringstream ss;
+		ss << "Short read of frame " << idx;
+		if (rc < 0)
+			ss << ": " << strerror(errno);
+		m_error = ss.str();
+		return false;
+	}
+
+	if (!m_dctx) {
+		size_t err = LZ4F_createDecompressionContext(&m_dctx,
+			LZ4F_VERSION);
+		if (LZ4F_isError(err)) {
+			m_dctx = NULL;
+			m_error = "Unable to create decompression context: ";
+			m_error += LZ4F_getErrorName(err);
+			return false;
+		}
+	}
+
+	size_t dst_len = raw_len, src_len = packed_len;
+	size_t left = LZ4F_decompress(m_dctx, &m_frame[0], &dst_len,
+		&m_packed[0], &src_len, NULL);
+
+	if (LZ4F_isError(left) || left || dst_len != raw_len
+			|| src_len != packed_len) {
+		std::stringstream ss;
+		ss << "Corrupt frame " << idx;
+		if (LZ4F_isError(left))
+			ss << ": " << LZ4F_getErrorName(left);
+
+		m_error = ss.str();
+
+		/* Leaves the context mid-frame; start over next time */
+		LZ4F_freeDecompressionContext(m_dctx);
+		m_dctx = NULL;
+		return false;
+	}
+
+	m_cached = idx;
+
+	return true;
+}
+
+ssize_t CompressedFile::pread(void *buf, size_t len, off_t offset)
+{
+	size_t done = 0;
+
+	if (offset < 0) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	while (done < len && (uint64_t) offset + done < size()) {
+		uint64_t pos = offset + done;
+
+		/* Sequential readers almost always want the cached frame */
+		uint32_t idx;
+		if (m_cached >= 0 && pos >= m_rawStart[m_cached]
+				&& pos < m_rawStart[m_cached + 1]) {
+			idx = m_cached;
+		}
+		else {
+			idx = std::upper_bound(m_rawStart.begin(),
+				m_rawStart.end(), pos) - m_rawStart.begin() - 1;
+		}
+
+		if (!loadFrame(idx)) {
+			/* Hand back what we have, the error comes next time */
+			if (done)
+				break;
+			errno = EIO;
+			return -1;
+		}
+
+		size_t from = pos - m_rawStart[idx];
+		size_t n = m_frame.size() - from;
+		if (n > len - done)
+			n = len - done;
+
+		memcpy((char *) buf + done, &m_frame[from], n);
+		done += n;
+	}
+
+	return done;
+}
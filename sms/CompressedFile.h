@@ -0,0 +1,101 @@
+#ifndef __COMPRESSED_FILE_H
+#define __COMPRESSED_FILE_H
+
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <lz4frame.h>
+
+/* Compressed SMS raw data files.
+ *
+ * With "compress" set in the [storage] config, the SMS rewrites each
+ * data file in the background once it has been closed out: the stream
+ * is cut into frames of "compressframe" bytes (1-4 MB), each frame is
+ * compressed on its own, and the result is renamed over the original.
+ * The file keeps its name, so scanning, purging and the like carry on
+ * as before (just with fewer blocks to account for).
+ *
+ * Layout (native byte order, like the data files):
+ *
+ *	LZ4 frame[num_frames]		Standard LZ4 frames, with content
+ *					size and checksum
+ *	uint32_t magic			LZ4 skippable frame (0x184D2A5E)
+ *	uint32_t size			Bytes in the rest of the file
+ *	CompressedFrameEntry[num_frames]
+ *	CompressedFileFooter
+ *
+ * That's all plain LZ4 framing, so "lz4 -dc" gives back the original
+ * stream, and the seek table at the end lets readers go straight to
+ * the frame holding any offset in it.
+ */
+
+#define COMPRESSED_FILE_LZ4_MAGIC	0x184D2204
+#define COMPRESSED_FILE_TABLE_MAGIC	0x184D2A5E
+#define COMPRESSED_FILE_FOOTER_MAGIC	0x535A4441	/* "ADZS" */
+
+struct CompressedFrameEntry {
+	uint32_t	packed_size;
+	uint32_t	raw_size;
+} __attribute__((packed));
+
+struct CompressedFileFooter {
+	uint64_t	raw_size;
+	uint32_t	num_frames;
+	uint32_t	magic;
+} __attribute__((packed));
+
+/* Random access reads from a compressed data file, as if it were
+ * the original; decompresses a frame at a time, keeping the last one
+ * around, so sequential readers only decompress each frame once.
+ */
+class CompressedFile {
+public:
+	enum { MIN_FRAME_SIZE = 1024 * 1024, MAX_FRAME_SIZE = 4 * 1024 * 1024 };
+
+	CompressedFile();
+	~CompressedFile();
+
+	/* Does the file open on fd start like one of ours? */
+	static bool detect(int fd);
+
+	/* Write the compressed form of all of in_fd to out_fd. Checks
+	 * *stop between frames, giving up if it gets set.
+	 */
+	static bool compress(int in_fd, int out_fd, uint32_t frame_size,
+		uint64_t &packed_size, std::string &err,
+		const volatile bool *stop = NULL);
+
+	/* Read the seek table; fd stays owned by the caller */
+	bool open(int fd, std::string &err);
+
+	uint64_t size(void) const { return m_rawStart.back(); }
+	uint32_t frames(void) const { return m_rawStart.size() - 1; }
+
+	/* pread() on the original stream; -1/EIO for a corrupt frame */
+	ssize_t pread(void *buf, size_t len, off_t offset);
+
+	const std::string &error(void) const { return m_error; }
+
+private:
+	int m_fd;
+
+	/* Frame i covers [m_rawStart[i], m_rawStart[i + 1]) of the
+	 * original, from [m_packedStart[i], m_packedStart[i + 1])
+	 */
+	std::vector<uint64_t> m_rawStart;
+	std::vector<uint64_t> m_packedStart;
+
+	std::vector<char> m_packed;
+	std::vector<char> m_frame;
+	int64_t m_cached;
+
+	LZ4F_decompressionContext_t m_dctx;
+	std::string m_error;
+
+	bool loadFrame(uint32_t idx);
+};
+
+#endif /* __COMPRESSED_FILE_H */
@@ -4,15 +4,20 @@
 static LoggerPtr logger(Logger::getLogger("SMS.DataSource"));
 
 #include <stdexcept>
+#include <new>
 #include <sstream>
+#include <algorithm>
 #include <string>
 
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/prctl.h>
 #include <stdint.h>
 #include <string.h>
 #include <netdb.h>
 #include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
 #include <time.h>
 
 #include <boost/make_shared.hpp>
@@ -26,10 +31,16 @@ static LoggerPtr logger(Logger::getLogger("SMS.DataSource"));
 #include "DataSource.h"
 #include "SMSControl.h"
 #include "SMSControlPV.h"
+#include "EventFd.h"
+#include "Metrics.h"
 #include "utils.h"
 
 RateLimitedLogging::History RLLHistory_DataSource;
 
+// Time to read and parse a chunk from a source, through handing the
+// packets off to SMSControl/StorageManager
+static Metrics::Id metricParse = Metrics::latency("DataSource:Parse");
+
 // Rate-Limited Logging IDs...
 #define RLL_DROPPED_PACKETS           0
 #define RLL_LOCAL_DUPLICATE_PULSE     1
@@ -57,6 +68,7 @@ RateLimitedLogging::History RLLHistory_DataSource;
 #define RLL_RTDL_PULSE_IN_FUTURE     23
 #define RLL_ANNOTATION               24
 #define RLL_HEARTBEAT                25
+#define RLL_RX_QUEUE_STALL           26
 
 // Pulse Time Sanity Check Constants
 #define FACILITY_START_TIME 512715600 // EPICS Sat Apr  1 00:00:00 EST 2006
@@ -839,7 +851,8 @@ DataSource::DataSource( const std::string &name,
 			bool check_source_sequence, bool check_pulse_sequence,
 			uint32_t max_pulse_seq_list,
 			unsigned int read_chunk,
-			uint32_t rtdlNoDataThresh, bool save_input_stream ) :
+			uint32_t rtdlNoDataThresh, bool save_input_stream,
+			bool rx_thread, unsigned int rx_queue_size ) :
 	m_name(uri), m_basename(name), m_uri(uri),
 	m_fdreg(NULL), m_timer(NULL), m_addrinfo(NULL),
 	m_state(DISABLED), m_smsSourceId(id), m_fd(-1),
@@ -854,7 +867,11 @@ DataSource::DataSource( const std::string &name,
 	m_check_pulse_sequence(check_pulse_sequence),
 	m_max_pulse_seq_list(max_pulse_seq_list),
 	m_max_read_chunk(read_chunk), m_rtdlNoDataThresh(rtdlNoDataThresh),
-	m_save_input_stream(save_input_stream)
+	m_save_input_stream(save_input_stream),
+	m_rxThreadMode(rx_thread), m_rxQueueSize(rx_queue_size),
+	m_rxMaxBlocks(0), m_rxFull(NULL), m_rxFree(NULL), m_rxEvent(NULL),
+	m_rxRunning(false), m_rxCurrent(NULL), m_rxOffset(0), m_rxStalls(0),
+	m_rxStallsLogged(0)
 {
 	// Snag an SMSControl Instance Handle _Exactly Once_...! ;-o
 	m_ctrl = SMSControl::getInstance();
@@ -1336,12 +1353,14 @@ DataSource::~DataSource()
 		delete m_fdreg;
 		m_fdreg = NULL;
 	}
+	stopRxThread();
 	if (m_fd >= 0) {
 		if ( m_ctrl->verbose() > 0 )
 			DEBUG("Close m_fd=" << m_fd);
 		close(m_fd);
 		m_fd = -1;
 	}
+	delete m_rxEvent;
 	m_connection.disconnect();
 }
 
@@ -1602,6 +1621,8 @@ void DataSource::connectionFailed(bool dumpStats, bool dumpDiscarded,
 		delete m_fdreg;
 		m_fdreg = NULL;
 	}
+	// Receive Thread Must Let Go of the Socket Before We Close It...
+	stopRxThread();
 	if (m_fd >= 0) {
 		if ( m_ctrl->verbose() > 0 )
 			DEBUG("Close m_fd=" << m_fd);
@@ -1875,10 +1896,14 @@ void DataSource::startConnect(void)
 		 * the first packet from the source unless we look for the
 		 * connection becoming writable.
 		 */
-		fdRegType type = (m_state == CONNECTING) ? fdrWrite : fdrRead;
-		m_fdreg = new ReadyAdapter(m_fd, type,
-				boost::bind(&DataSource::fdReady, this),
-				m_ctrl->verbose());
+		if ( m_state == ACTIVE && m_rxThreadMode ) {
+			startRxThread();
+		} else {
+			fdRegType type = (m_state == CONNECTING) ? fdrWrite : fdrRead;
+			m_fdreg = new ReadyAdapter(m_fd, type,
+					boost::bind(&DataSource::fdReady, this),
+					m_ctrl->verbose());
+		}
 	} catch (std::exception &e) {
 		ERROR( ( m_ctrl->getRecording() ? "[RECORDING] " : "" )
 			<< "Exception in startConnect()"
@@ -1941,9 +1966,13 @@ void DataSource::connectComplete(void)
 
 		// Catch Bad Alloc Exception...
 		try {
-			m_fdreg = new ReadyAdapter(m_fd, fdrRead,
-					boost::bind(&DataSource::fdReady, this),
-					m_ctrl->verbose());
+			if ( m_rxThreadMode ) {
+				startRxThread();
+			} else {
+				m_fdreg = new ReadyAdapter(m_fd, fdrRead,
+						boost::bind(&DataSource::fdReady, this),
+						m_ctrl->verbose());
+			}
 		} catch (std::exception &e) {
 			ERROR( ( m_ctrl->getRecording() ? "[RECORDING] " : "" )
 				<< "Exception in connectComplete()"
@@ -2104,7 +2133,12 @@ void DataSource::dataReady(void)
 
 	try {
 		// NOTE: This is POSIXParser::read()... ;-o
-		if (!read(m_fd, log_info, 4000, m_max_read_chunk)) {
+		// (or Packets Already Read by Our Receive Thread...)
+		Metrics::Timer timer(metricParse);
+		bool ok = m_rxThreadMode ? rxQueueParse(log_info)
+			: read(m_fd, log_info, 4000, m_max_read_chunk);
+		timer.stop();
+		if (!ok) {
 			INFO( ( m_ctrl->getRecording() ? "[RECORDING] " : "" )
 				<< "Connection closed with " << m_name
 				<< " log_info=(" << log_info << ")" );
@@ -2161,6 +2195,355 @@ void DataSource::dataReady(void)
 	}
 }
 
+/* Receive thread block sizing; blocks follow the max read chunk, but
+ * always hold at least a few typical packets, and grow to fit one large
+ * packet (up to the parser's own limit) when they have to.
+ */
+static const uint32_t RX_MIN_BLOCK_SIZE = 64 * 1024;
+static const uint64_t RX_MAX_PACKET_SIZE = 48 * 1024 * 1024;
+
+void DataSource::startRxThread(void)
+{
+	uint32_t block_size = m_max_read_chunk;
+	if ( block_size < RX_MIN_BLOCK_SIZE )
+		block_size = RX_MIN_BLOCK_SIZE;
+
+	m_rxMaxBlocks = m_rxQueueSize / block_size;
+	if ( m_rxMaxBlocks < 4 )
+		m_rxMaxBlocks = 4;
+
+	// Created Once, Outlives Any Connection (Stale Signals are Ignored)
+	if ( m_rxEvent == NULL ) {
+		m_rxEvent = new EventFd(
+			boost::bind(&DataSource::rxQueueReady, this, _1) );
+	}
+
+	m_rxFull = new SPSCQueue<RxBlock *>( m_rxMaxBlocks );
+	m_rxFree = new SPSCQueue<RxBlock *>( m_rxMaxBlocks );
+
+	m_rxCurrent = NULL;
+	m_rxOffset = 0;
+	m_rxStalls = 0;
+	m_rxStallsLogged = 0;
+
+	m_rxRunning = true;
+
+	boost::thread rx( boost::bind(&DataSource::rxThread, this,
+		m_fd, block_size) );
+	m_rxThread.swap(rx);
+
+	DEBUG("Started Receive Thread for " << m_name
+		<< " block_size=" << block_size
+		<< " max_blocks=" << m_rxMaxBlocks);
+}
+
+void DataSource::stopRxThread(void)
+{
+	m_rxRunning = false;
+
+	if ( m_rxThread.joinable() ) {
+		m_rxThread.join();
+		DEBUG("Stopped Receive Thread for " << m_name);
+	}
+
+	// Receive Thread is Gone, We Own All the Blocks Now...
+	std::vector<RxBlock *>::iterator it;
+	for ( it = m_rxBlocks.begin(); it != m_rxBlocks.end(); ++it ) {
+		delete [] (*it)->m_data;
+		delete *it;
+	}
+	m_rxBlocks.clear();
+
+	delete m_rxFull;
+	m_rxFull = NULL;
+	delete m_rxFree;
+	m_rxFree = NULL;
+
+	m_rxCurrent = NULL;
+	m_rxOffset = 0;
+}
+
+DataSource::RxBlock *DataSource::rxGetBlock(uint32_t block_size)
+{
+	RxBlock *blk;
+
+	if ( !m_rxFree->pop(blk) ) {
+		if ( m_rxBlocks.size() >= m_rxMaxBlocks )
+			return NULL;
+		blk = new RxBlock;
+		blk->m_data = new uint8_t[block_size];
+		blk->m_size = block_size;
+		m_rxBlocks.push_back(blk);
+	}
+
+	blk->m_len = 0;
+	blk->m_error = 0;
+
+	return blk;
+}
+
+static void rxReserve(uint8_t *&data, uint32_t &size, uint32_t len,
+		uint64_t need)
+{
+	if ( need <= size )
+		return;
+
+	uint8_t *bigger = new uint8_t[need];
+	memcpy(bigger, data, len);
+	delete [] data;
+	data = bigger;
+	size = (uint32_t) need;
+}
+
+bool DataSource::rxPushBlock(RxBlock *blk)
+{
+	bool stalled = false;
+
+	// Main Loop is Behind, Wait (Data Piles Up in the Socket Buffer)
+	while ( !m_rxFull->push(blk) ) {
+		if ( !m_rxRunning )
+			return false;
+		if ( !stalled ) {
+			m_rxStalls++;
+			stalled = true;
+		}
+		usleep(1000);
+	}
+
+	m_rxEvent->signal();
+
+	return true;
+}
+
+void DataSource::rxThread(int fd, uint32_t block_size)
+{
+	RxBlock *blk = NULL;
+	uint32_t framed = 0;
+	int error = 0;
+
+	struct pollfd pfd;
+	pfd.fd = fd;
+	pfd.events = POLLIN;
+
+	/* Thread names are limited to 15 characters */
+	std::string tname = "sms-rx-" + m_name;
+	tname.resize( std::min( tname.size(), (size_t) 15 ) );
+	prctl( PR_SET_NAME, tname.c_str(), 0, 0, 0 );
+
+	try {
+		while ( m_rxRunning && !error ) {
+
+			while ( blk == NULL ) {
+				if ( !m_rxRunning )
+					return;
+				if ( !(blk = rxGetBlock(block_size)) )
+					usleep(1000);
+			}
+
+			int rc = poll(&pfd, 1, 100);
+			if ( rc < 0 && errno != EINTR ) {
+				error = errno;
+				break;
+			}
+			if ( rc <= 0 )
+				continue;
+
+			// Drain Whatever the Socket Has, Up to the End of the Block
+			while ( blk->m_len < blk->m_size ) {
+				ssize_t n = ::read(fd, blk->m_data + blk->m_len,
+					blk->m_size - blk->m_len);
+				if ( n < 0 ) {
+					if ( errno == EINTR )
+						continue;
+					if ( errno != EAGAIN )
+						error = errno;
+					break;
+				}
+				if ( n == 0 ) {
+					error = -1;
+					break;
+				}
+				blk->m_len += n;
+			}
+
+			// Frame Whole Packets...
+			uint64_t need = 0;
+			while ( blk->m_len - framed >= sizeof(ADARA::Header) ) {
+				const ADARA::Header *hdr =
+					(const ADARA::Header *) (blk->m_data + framed);
+				uint64_t pkt_len = sizeof(ADARA::Header)
+					+ (uint64_t) hdr->payload_len;
+				if ( pkt_len > blk->m_len - framed ) {
+					need = pkt_len;
+					break;
+				}
+				framed += pkt_len;
+			}
+
+			if ( need > RX_MAX_PACKET_SIZE ) {
+				error = EMSGSIZE;
+				break;
+			}
+
+			if ( framed ) {
+				// Hand Off the Complete Packets,
+				// Carry the Partial Packet Over to a New Block
+				RxBlock *next = NULL;
+				while ( !(next = rxGetBlock(block_size)) ) {
+					if ( !m_rxRunning )
+						return;
+					usleep(1000);
+				}
+
+				uint32_t tail = blk->m_len - framed;
+				rxReserve(next->m_data, next->m_size, 0,
+					( need > tail ) ? need : tail);
+				memcpy(next->m_data, blk->m_data + framed, tail);
+				next->m_len = tail;
+
+				blk->m_len = framed;
+				if ( !rxPushBlock(blk) )
+					return;
+
+				blk = next;
+				framed = 0;
+			}
+			else {
+				// One Packet Bigger than the Block, Make Room
+				rxReserve(blk->m_data, blk->m_size, blk->m_len, need);
+			}
+		}
+	} catch (std::bad_alloc &) {
+		error = ENOMEM;
+	}
+
+	if ( !m_rxRunning )
+		return;
+
+	// Tell the Main Loop Why We Stopped (after any complete packets)
+	while ( blk == NULL ) {
+		if ( !m_rxRunning )
+			return;
+		if ( !(blk = rxGetBlock(block_size)) )
+			usleep(1000);
+	}
+	blk->m_len = framed;
+	blk->m_error = error;
+	rxPushBlock(blk);
+}
+
+void DataSource::rxQueueReady(fdRegType UNUSED(type))
+{
+	uint64_t val;
+	m_rxEvent->read(val);
+
+	// Leftover Signal from a Connection That's Already Gone...
+	if ( m_state != ACTIVE || m_rxFull == NULL )
+		return;
+
+	dataReady();
+}
+
+bool DataSource::rxQueueParse(std::string &log_info)
+{
+	unsigned long to_read = m_max_read_chunk ?: ~0UL;
+	unsigned long bytes = 0;
+	unsigned int pkts = 0;
+
+	log_info.clear();
+
+	// Let Someone Know if the Receive Thread Has Had to Wait for Us...
+	uint32_t stalls = m_rxStalls;
+	if ( stalls != m_rxStallsLogged ) {
+		std::string rll_log_info;
+		if ( RateLimitedLogging::checkLog( RLLHistory_DataSource,
+				RLL_RX_QUEUE_STALL, m_name, 60, 3, 10, rll_log_info ) ) {
+			ERROR(rll_log_info
+				<< ( m_ctrl->getRecording() ? "[RECORDING] " : "" )
+				<< "rxQueueParse(): Receive Queue Full for " << m_name
+				<< " (" << ( stalls - m_rxStallsLogged ) << " Stalls,"
+				<< " " << m_rxMaxBlocks << " Blocks)"
+				<< " - Main Loop Falling Behind");
+		}
+		m_rxStallsLogged = stalls;
+	}
+
+	last_last_total_bytes = last_total_bytes;
+	last_last_total_packets = last_total_packets;
+
+	while ( bytes < to_read ) {
+
+		if ( m_rxCurrent == NULL ) {
+			if ( !m_rxFull->pop(m_rxCurrent) )
+				break;
+			m_rxOffset = 0;
+		}
+
+		RxBlock *blk = m_rxCurrent;
+
+		while ( m_rxOffset < blk->m_len ) {
+			unsigned int len = bufferFillLength();
+			if ( len > blk->m_len - m_rxOffset )
+				len = blk->m_len - m_rxOffset;
+			if ( len ) {
+				memcpy(bufferFillAddress(), blk->m_data + m_rxOffset, len);
+				bufferBytesAppended(len);
+				m_rxOffset += len;
+				bytes += len;
+			}
+
+			int rc = bufferParse(log_info, 0);
+			if ( rc < 0 ) {
+				log_info.append("rxQueueParse() bufferParse() error exit; ");
+				return false;
+			}
+			if ( !len && !rc ) {
+				throw std::runtime_error(
+					"rxQueueParse(): Parser Buffer Full, No Progress");
+			}
+			pkts += rc;
+		}
+
+		int error = blk->m_error;
+
+		// Block Goes Back to the Receive Thread
+		// (Free Queue Holds Every Block, so Never Full)
+		m_rxCurrent = NULL;
+		m_rxFree->push(blk);
+
+		if ( error == -1 ) {
+			log_info.append("rxQueueParse() connection closed exit; ");
+			return false;
+		}
+		else if ( error ) {
+			switch ( error ) {
+				case EPIPE:
+				case ECONNRESET:
+				case ETIMEDOUT:
+				case EHOSTUNREACH:
+				case ENETUNREACH:
+					/* The host went away, but that shouldn't be fatal. */
+					log_info.append("rxQueueParse() host went away exit; ");
+					return false;
+			}
+			std::string msg("rxQueueParse(): Receive Thread: ");
+			msg += strerror(error);
+			throw std::runtime_error(msg);
+		}
+	}
+
+	last_total_bytes = bytes;
+	last_total_packets = pkts;
+
+	// Come Back for the Rest After Everyone Else Gets a Turn...
+	if ( m_rxCurrent != NULL || !m_rxFull->empty() )
+		m_rxEvent->signal();
+
+	log_info.append("rxQueueParse() true exit; ");
+
+	return true;
+}
+
 void DataSource::enabled(void)
 {
 	DEBUG("*** Data Source " << m_name << " Enabled!");
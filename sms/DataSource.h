@@ -3,6 +3,7 @@
 
 #include <boost/smart_ptr.hpp>
 #include <boost/signals2.hpp>
+#include <boost/thread.hpp>
 #include <stdint.h>
 #include <map>
 #include <bitset>
@@ -15,12 +16,14 @@
 #include "ReadyAdapter.h"
 #include "TimerAdapter.h"
 #include "Markers.h"
+#include "SPSCQueue.h"
 
 extern "C" {
 struct addrinfo;
 }
 
 class HWSource;
+class EventFd;
 class smsStringPV;
 class smsEnabledPV;
 class DataSourceRequiredPV;
@@ -42,7 +45,8 @@ public:
 		bool check_source_sequence, bool check_pulse_sequence,
 		uint32_t max_pulse_seq_list,
 		unsigned int read_chunk,
-		uint32_t rtdlNoDataThresh, bool save_input_stream);
+		uint32_t rtdlNoDataThresh, bool save_input_stream,
+		bool rx_thread, unsigned int rx_queue_size);
 	~DataSource();
 
 	SMSControl *m_ctrl;
@@ -112,6 +116,31 @@ private:
 	bool m_save_input_stream;
 	struct timespec m_maxTime; // Wallclock Time...!
 
+	/* Optional dedicated receive thread; reads and frames whole packets
+	 * into blocks handed to the main loop through an SPSC queue, so the
+	 * socket keeps draining while the main loop is busy elsewhere.
+	 */
+	struct RxBlock {
+		uint8_t *	m_data;
+		uint32_t	m_size;
+		uint32_t	m_len;
+		int		m_error;	// 0 data, -1 EOF, else errno
+	};
+
+	bool m_rxThreadMode;
+	unsigned int m_rxQueueSize;
+	uint32_t m_rxMaxBlocks;
+	SPSCQueue<RxBlock *> *m_rxFull;
+	SPSCQueue<RxBlock *> *m_rxFree;
+	std::vector<RxBlock *> m_rxBlocks;
+	EventFd *m_rxEvent;
+	boost::thread m_rxThread;
+	volatile bool m_rxRunning;
+	RxBlock *m_rxCurrent;
+	uint32_t m_rxOffset;
+	volatile uint32_t m_rxStalls;
+	uint32_t m_rxStallsLogged;
+
 	boost::shared_ptr<smsStringPV> m_pvName;
 	boost::shared_ptr<smsStringPV> m_pvBaseName;
 	boost::shared_ptr<smsStringPV> m_pvDataURI;
@@ -189,6 +218,14 @@ private:
 	void connectComplete(void);
 	void dataReady(void);
 
+	void startRxThread(void);
+	void stopRxThread(void);
+	void rxThread(int fd, uint32_t block_size);
+	RxBlock *rxGetBlock(uint32_t block_size);
+	bool rxPushBlock(RxBlock *blk);
+	void rxQueueReady(fdRegType type);
+	bool rxQueueParse(std::string &log_info);
+
 	void dumpLastReadStats(std::string who);
 
 	void unregisterHWSources(bool isSourceDown, bool stateChanged,
@@ -0,0 +1,62 @@
+#ifndef __EVENT_BANKS_H
+#define __EVENT_BANKS_H
+
+#include <vector>
+#include <stdint.h>
+
+#include "ADARA.h"
+
+/* One source's events for a pulse, with one vector per bank+state index,
+ * in arrival order; the banked event packets gather straight from them.
+ *
+ * The vectors keep their capacity once cleared, so rather than freeing
+ * them with the pulse, hand them on to the next pulse's sources with
+ * clear() and recycle(); in steady state a pulse then allocates nothing.
+ */
+class EventBanks {
+public:
+	typedef std::vector<ADARA::Event> EventVector;
+
+	EventBanks() : m_reserve(0) { }
+
+	/* Bank+state indices run from 0 to banks - 1; growing keeps the
+	 * events (and indices) of existing banks. Each bank makes room
+	 * for at least reserve events on its first event.
+	 */
+	void setBanks(uint32_t banks, uint32_t reserve) {
+		m_banks.resize(banks);
+		m_reserve = reserve;
+	}
+	uint32_t banks(void) const { return m_banks.size(); }
+
+	/* Returns true for the first event in its bank */
+	bool add(const ADARA::Event &ev, uint32_t index) {
+		EventVector &v = m_banks[index];
+		bool first = v.empty();
+		if (first && v.capacity() < m_reserve)
+			v.reserve(m_reserve);
+		v.push_back(ev);
+		return first;
+	}
+
+	EventVector &bank(uint32_t index) { return m_banks[index]; }
+
+	/* Empty every bank, keeping its storage */
+	void clear(void) {
+		for (uint32_t i = 0; i < m_banks.size(); i++)
+			m_banks[i].clear();
+	}
+
+	/* Trade banks with another source; both are expected to be
+	 * empty, i.e. cleared or new.
+	 */
+	void recycle(EventBanks &other) {
+		m_banks.swap(other.m_banks);
+	}
+
+private:
+	std::vector<EventVector> m_banks;
+	uint32_t m_reserve;
+};
+
+#endif /* __EVENT_BANKS_H */
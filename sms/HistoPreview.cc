@@ -0,0 +1,312 @@
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "ADARA.h"
+#include "ADARAPackets.h"
+#include "HistoPreview.h"
+
+uint64_t HistoPreview::m_interval_ns = 1000000000ULL;
+uint32_t HistoPreview::m_default_tof_max = 33333;
+uint32_t HistoPreview::m_default_tof_bin = 100;
+uint32_t HistoPreview::m_max_pixels = 4 * 1024 * 1024;
+
+/* Don't let a silly bin width make a client's histogram enormous */
+static const uint32_t MAX_TOF_BINS = 1024 * 1024;
+
+void HistoPreview::config(double interval, uint32_t tof_max,
+		uint32_t tof_bin, uint32_t max_pixels)
+{
+	if (interval < 0.01)
+		interval = 0.01;
+	m_interval_ns = (uint64_t) (interval * 1e9);
+
+	m_default_tof_max = tof_max ? tof_max : 1;
+	m_default_tof_bin = tof_bin ? tof_bin : 1;
+	m_max_pixels = max_pixels;
+}
+
+HistoPreview::BankHisto::BankHisto(const Binning &binning) :
+	m_binning(binning), m_touched(false)
+{
+	if (m_binning.m_bin < 1)
+		m_binning.m_bin = 1;
+	if (m_binning.m_max <= m_binning.m_offset)
+		m_binning.m_max = m_binning.m_offset + m_binning.m_bin;
+
+	uint32_t span = m_binning.m_max - m_binning.m_offset;
+	if (span / m_binning.m_bin >= MAX_TOF_BINS)
+		m_binning.m_bin = span / MAX_TOF_BINS + 1;
+
+	m_counts.resize((span + m_binning.m_bin - 1) / m_binning.m_bin);
+}
+
+HistoPreview::HistoPreview(uint32_t decimation) :
+	m_decimation(decimation ? decimation : 1), m_pixelHigh(0),
+	m_start(0), m_last(0), m_lastSec(0), m_lastNsec(0),
+	m_pulses(0), m_events(0)
+{
+}
+
+void HistoPreview::detectorBankSets(const uint8_t *pkt, uint32_t len)
+{
+	/* Per set: name, flags, bank count, banks, TOF offset/max/bin,
+	 * throttle (double) and suffix; see DetectorBankSetsPkt.
+	 */
+	const uint32_t name_words =
+		ADARA::DetectorBankSetsPkt::SET_NAME_SIZE / sizeof(uint32_t);
+	const uint32_t tail_words = 3 + 2
+		+ ADARA::DetectorBankSetsPkt::THROTTLE_SUFFIX_SIZE
+			/ sizeof(uint32_t);
+
+	const uint32_t *p = (const uint32_t *) pkt + 4;
+	const uint32_t *end = (const uint32_t *) pkt + len / sizeof(uint32_t);
+	std::map<uint32_t, Binning> binning;
+
+	if (p >= end)
+		return;
+
+	uint32_t sets = *p++;
+	while (sets--) {
+		if ((uint32_t) (end - p) < name_words + 2)
+			return;
+		p += name_words;
+		uint32_t flags = *p++;
+		uint32_t count = *p++;
+
+		if ((uint32_t) (end - p) < tail_words
+				|| (uint32_t) (end - p) - tail_words < count)
+			return;
+		const uint32_t *banks = p;
+		p += count;
+
+		Binning b(p[0], p[1], p[2]);
+		p += tail_words;
+
+		if (!(flags & ADARA::HISTO_FORMAT))
+			continue;
+
+		/* First set listing a bank wins, as in STC */
+		for (uint32_t i = 0; i < count; i++)
+			binning.insert(std::make_pair(banks[i], b));
+	}
+
+	m_setBinning.swap(binning);
+
+	/* Start over on any bank whose binning changed; the client
+	 * will see a section with the new parameters next time.
+	 */
+	BankMap::iterator it = m_histos.begin();
+	while (it != m_histos.end()) {
+		std::map<uint32_t, Binning>::iterator sb =
+			m_setBinning.find(it->first);
+		Binning want = ( sb != m_setBinning.end() ) ? sb->second
+			: Binning(0, m_default_tof_max, m_default_tof_bin);
+		BankHisto fresh(want);
+		const Binning &have = it->second.m_binning;
+
+		if (fresh.m_binning.m_offset != have.m_offset
+				|| fresh.m_binning.m_max != have.m_max
+				|| fresh.m_binning.m_bin != have.m_bin)
+			m_histos.erase(it++);
+		else
+			++it;
+	}
+}
+
+HistoPreview::BankHisto &HistoPreview::bankHisto(uint32_t bank)
+{
+	BankMap::iterator it = m_histos.find(bank);
+	if (it != m_histos.end())
+		return it->second;
+
+	std::map<uint32_t, Binning>::iterator sb = m_setBinning.find(bank);
+	Binning b = ( sb != m_setBinning.end() ) ? sb->second
+		: Binning(0, m_default_tof_max, m_default_tof_bin);
+
+	return m_histos.insert(
+		std::make_pair(bank, BankHisto(b))).first->second;
+}
+
+void HistoPreview::notePulse(const uint8_t *pkt)
+{
+	const uint32_t *hdr = (const uint32_t *) pkt;
+
+	m_lastSec = hdr[2];
+	m_lastNsec = hdr[3];
+	m_last = (uint64_t) m_lastSec * 1000000000ULL + m_lastNsec;
+	if (!m_pulses++)
+		m_start = m_last;
+}
+
+void HistoPreview::skipPulse(const uint8_t *pkt)
+{
+	notePulse(pkt);
+}
+
+void HistoPreview::addPulse(const uint8_t *pkt, uint32_t len, bool state,
+		const std::vector<uint32_t> *banks)
+{
+	const uint32_t *rpos = (const uint32_t *) pkt + 4 + 4;
+	const uint32_t *end = (const uint32_t *) pkt + len / sizeof(uint32_t);
+	uint32_t bank_hdr = state ? 3 : 2;
+
+	if (rpos > end)
+		return;
+
+	notePulse(pkt);
+
+	while (end - rpos >= 4) {
+		uint32_t bank_count = rpos[3];
+		rpos += 4;
+
+		while (bank_count--) {
+			if ((uint32_t) (end - rpos) < bank_hdr)
+				return;
+
+			uint32_t bank = rpos[0];
+			uint32_t events = rpos[bank_hdr - 1];
+			const uint32_t *ev = rpos + bank_hdr;
+
+			if ((uint32_t) (end - ev) / 2 < events)
+				return;
+			rpos = ev + 2 * events;
+
+			if (banks && !std::binary_search(banks->begin(),
+					banks->end(), bank))
+				continue;
+
+			BankHisto &h = bankHisto(bank);
+			const Binning &b = h.m_binning;
+			uint32_t *counts = &h.m_counts[0];
+			uint32_t nbins = h.m_counts.size();
+
+			/* The error and unmapped banks carry physical ids */
+			bool real = ( bank < 0xfffffffe );
+
+			h.m_touched = true;
+			m_events += events;
+
+			for (uint32_t e = 0; e < events; e++, ev += 2) {
+				/* TOF is in 100ns units, binning in us */
+				uint32_t tof = ev[0] / 10;
+				uint32_t pixel = ev[1];
+
+				if (tof >= b.m_offset) {
+					uint32_t bin = ( tof - b.m_offset ) / b.m_bin;
+					if (bin < nbins)
+						counts[bin]++;
+				}
+
+				if (real && pixel < m_max_pixels) {
+					if (pixel >= m_pixels.size()) {
+						size_t sz = m_pixels.size() * 2;
+						if (sz <= pixel)
+							sz = pixel + 1;
+						if (sz > m_max_pixels)
+							sz = m_max_pixels;
+						m_pixels.resize(sz);
+					}
+					m_pixels[pixel]++;
+					if (pixel >= m_pixelHigh)
+						m_pixelHigh = pixel + 1;
+				}
+			}
+		}
+	}
+}
+
+void HistoPreview::appendRuns(std::vector<uint32_t> &words,
+		std::vector<uint32_t> &counts, uint32_t bins)
+{
+	size_t run_count_pos = words.size() - 1;
+	uint32_t runs = 0;
+	uint32_t i = 0;
+
+	while (i < bins) {
+		while (i < bins && !counts[i])
+			i++;
+		if (i == bins)
+			break;
+
+		/* A run absorbs gaps of up to two empty bins, which
+		 * cost no more than starting a new run would.
+		 */
+		uint32_t start = i, last = i;
+		while (i < bins && i - last <= 2) {
+			if (counts[i])
+				last = i;
+			i++;
+		}
+		i = last + 1;
+
+		words.push_back(start);
+		words.push_back(i - start);
+		for (uint32_t j = start; j < i; j++) {
+			words.push_back(counts[j]);
+			counts[j] = 0;
+		}
+		runs++;
+	}
+
+	words[run_count_pos] = runs;
+}
+
+void HistoPreview::build(std::vector<uint8_t> &out)
+{
+	std::vector<uint32_t> words;
+	uint32_t sections = 0;
+
+	words.push_back(0);	// payload length
+	words.push_back(ADARA_PKT_TYPE(
+		ADARA::PacketType::HISTO_PREVIEW_TYPE,
+		ADARA::PacketType::HISTO_PREVIEW_VERSION));
+	words.push_back(m_lastSec);
+	words.push_back(m_lastNsec);
+
+	words.push_back(m_pulses);
+	words.push_back(m_events);
+	words.push_back(m_decimation);
+	words.push_back(0);	// section count
+
+	for (BankMap::iterator it = m_histos.begin();
+			it != m_histos.end(); ++it) {
+		BankHisto &h = it->second;
+		if (!h.m_touched)
+			continue;
+
+		words.push_back(it->first);
+		words.push_back(ADARA::HistoPreviewPkt::BANK_TOF);
+		words.push_back(h.m_binning.m_offset);
+		words.push_back(h.m_binning.m_bin);
+		words.push_back(h.m_counts.size());
+		words.push_back(0);
+		appendRuns(words, h.m_counts, h.m_counts.size());
+
+		h.m_touched = false;
+		sections++;
+	}
+
+	if (m_pixelHigh) {
+		words.push_back(0);
+		words.push_back(ADARA::HistoPreviewPkt::PIXEL_COUNTS);
+		words.push_back(0);
+		words.push_back(1);
+		words.push_back(m_pixelHigh);
+		words.push_back(0);
+		appendRuns(words, m_pixels, m_pixelHigh);
+
+		m_pixelHigh = 0;
+		sections++;
+	}
+
+	words[7] = sections;
+	words[0] = ( words.size() - 4 ) * sizeof(uint32_t);
+
+	const uint8_t *p = (const uint8_t *) &words[0];
+	out.insert(out.end(), p, p + words.size() * sizeof(uint32_t));
+
+	m_pulses = 0;
+	m_events = 0;
+}
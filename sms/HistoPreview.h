@@ -0,0 +1,97 @@
+#ifndef __HISTO_PREVIEW_H
+#define __HISTO_PREVIEW_H
+
+#include <boost/noncopyable.hpp>
+#include <map>
+#include <vector>
+
+#include <stdint.h>
+
+/* The HistoPreview accumulates the neutron events a live client would
+ * have been sent into per-bank TOF histograms and per-pixel counts, and
+ * periodically turns them into a HistoPreviewPkt so preview clients (live
+ * views, monitors) can skip receiving and re-histogramming every event.
+ *
+ * TOF binning for a bank comes from the first Detector Bank Set that
+ * lists it with HISTO_FORMAT, as seen in the stream, or the configured
+ * livestream preview defaults otherwise. Each packet only carries the
+ * counts since the previous one, as runs of non-zero bins.
+ */
+class HistoPreview : boost::noncopyable {
+public:
+	static void config(double interval, uint32_t tof_max, uint32_t tof_bin,
+			uint32_t max_pixels);
+
+	HistoPreview(uint32_t decimation);
+
+	/* Pick up the histogram parameters from a DetectorBankSetsPkt */
+	void detectorBankSets(const uint8_t *pkt, uint32_t len);
+
+	/* Accumulate a banked event (state) packet; banks, if given,
+	 * is the sorted list of banks to include.
+	 */
+	void addPulse(const uint8_t *pkt, uint32_t len, bool state,
+			const std::vector<uint32_t> *banks);
+
+	/* Count a pulse whose events were decimated away */
+	void skipPulse(const uint8_t *pkt);
+
+	bool pending(void) const { return m_pulses != 0; }
+	bool due(void) const {
+		return( m_pulses && m_last - m_start >= m_interval_ns );
+	}
+
+	/* Append a HistoPreviewPkt with everything accumulated so far
+	 * to out, and start a new interval.
+	 */
+	void build(std::vector<uint8_t> &out);
+
+private:
+	struct Binning {
+		uint32_t m_offset;	// microseconds
+		uint32_t m_max;
+		uint32_t m_bin;
+
+		Binning(uint32_t offset, uint32_t max, uint32_t bin) :
+			m_offset(offset), m_max(max), m_bin(bin) { }
+	};
+
+	struct BankHisto {
+		Binning m_binning;
+		std::vector<uint32_t> m_counts;
+		bool m_touched;
+
+		BankHisto(const Binning &binning);
+	};
+
+	typedef std::map<uint32_t, BankHisto> BankMap;
+
+	static uint64_t m_interval_ns;
+	static uint32_t m_default_tof_max;
+	static uint32_t m_default_tof_bin;
+	static uint32_t m_max_pixels;
+
+	uint32_t m_decimation;
+
+	std::map<uint32_t, Binning> m_setBinning;
+	BankMap m_histos;
+
+	std::vector<uint32_t> m_pixels;
+	uint32_t m_pixelHigh;		// highest pixel counted + 1
+
+	uint64_t m_start;
+	uint64_t m_last;
+	uint32_t m_lastSec;
+	uint32_t m_lastNsec;
+	uint32_t m_pulses;
+	uint32_t m_events;
+
+	void notePulse(const uint8_t *pkt);
+
+	BankHisto &bankHisto(uint32_t bank);
+
+	static void appendRuns(std::vector<uint32_t> &words,
+			std::vector<uint32_t> &counts, uint32_t bins);
+};
+
+#endif /* __HISTO_PREVIEW_H */
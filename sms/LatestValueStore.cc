@@ -0,0 +1,225 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include <stdint.h>
+#include <string.h>
+
+#include "LatestValueStore.h"
+
+const LatestValueStore::Handle LatestValueStore::NONE;
+
+LatestValueStore::LatestValueStore(uint32_t chunkSize) :
+	m_chunkSize(chunkSize), m_liveBytes(0), m_holeBytes(0),
+	m_pinned(NONE), m_inPlace(0), m_relocated(0), m_compactions(0)
+{
+}
+
+LatestValueStore::~LatestValueStore()
+{
+	std::vector<Chunk>::iterator it;
+
+	for (it = m_chunks.begin(); it != m_chunks.end(); ++it)
+		delete [] it->m_data;
+}
+
+void LatestValueStore::newChunk(uint32_t minSize)
+{
+	Chunk c;
+
+	/* Oversized packets (large array PVs) get a chunk of their own */
+	c.m_size = (minSize > m_chunkSize) ? minSize : m_chunkSize;
+	c.m_data = new uint8_t[c.m_size];
+	c.m_used = 0;
+
+	m_chunks.push_back(c);
+}
+
+void LatestValueStore::allocate(Slot &slot, uint32_t len)
+{
+	if (m_chunks.empty() || m_chunks.back().m_size
+					- m_chunks.back().m_used < len)
+		newChunk(len);
+
+	Chunk &c = m_chunks.back();
+
+	slot.m_chunk = m_chunks.size() - 1;
+	slot.m_offset = c.m_used;
+	slot.m_len = len;
+	slot.m_live = true;
+
+	c.m_used += len;
+}
+
+LatestValueStore::Handle LatestValueStore::store(Handle h,
+		const uint8_t *pkt, uint32_t len)
+{
+	if (h != NONE) {
+		Slot &s = m_slots[h];
+
+		if (s.m_len == len) {
+			/* Common case for scalar variables; same slot,
+			 * same place in the prologue.
+			 */
+			memcpy(m_chunks[s.m_chunk].m_data + s.m_offset, pkt, len);
+			m_inPlace++;
+			return h;
+		}
+
+		if (h == m_pinned)
+			throw std::logic_error("LatestValueStore: "
+						"resizing pinned packet");
+
+		/* Size changed; move to the end of the arena */
+		m_holeBytes += s.m_len;
+		m_liveBytes -= s.m_len;
+		m_relocated++;
+	} else if (!m_freeSlots.empty()) {
+		h = m_freeSlots.back();
+		m_freeSlots.pop_back();
+	} else {
+		h = m_slots.size();
+		m_slots.push_back(Slot());
+	}
+
+	Slot &s = m_slots[h];
+	allocate(s, len);
+	memcpy(m_chunks[s.m_chunk].m_data + s.m_offset, pkt, len);
+	m_liveBytes += len;
+
+	return h;
+}
+
+void LatestValueStore::release(Handle h)
+{
+	if (h == NONE)
+		return;
+
+	Slot &s = m_slots[h];
+
+	if (!s.m_live)
+		throw std::logic_error("LatestValueStore: double release");
+
+	if (h == m_pinned)
+		m_pinned = NONE;
+
+	s.m_live = false;
+	m_holeBytes += s.m_len;
+	m_liveBytes -= s.m_len;
+	m_freeSlots.push_back(h);
+}
+
+void LatestValueStore::sortedHandles(std::vector<Handle> &handles) const
+{
+	/* Sort live slots by arena address (chunk, offset) -- this is the
+	 * order they were stored in.
+	 */
+	std::vector<std::pair<uint64_t, Handle> > order;
+	order.reserve(m_slots.size());
+
+	for (Handle h = 0; h < m_slots.size(); h++) {
+		const Slot &s = m_slots[h];
+		if (s.m_live) {
+			order.push_back(std::make_pair(
+				((uint64_t) s.m_chunk << 32) | s.m_offset, h));
+		}
+	}
+
+	std::sort(order.begin(), order.end());
+
+	handles.clear();
+	handles.reserve(order.size());
+	for (uint32_t i = 0; i < order.size(); i++)
+		handles.push_back(order[i].second);
+}
+
+void LatestValueStore::compact(void)
+{
+	std::vector<Handle> handles;
+	sortedHandles(handles);
+
+	std::vector<Chunk> old;
+	old.swap(m_chunks);
+
+	/* One chunk for everything we have now plus some headroom, so the
+	 * common case afterwards is a single iovec again.
+	 */
+	uint64_t want = m_liveBytes + (m_liveBytes / 4);
+	if (want < m_chunkSize)
+		want = m_chunkSize;
+	if (want > 0xffffffffULL)
+		want = 0xffffffffULL;
+	newChunk((uint32_t) want);
+
+	for (uint32_t i = 0; i < handles.size(); i++) {
+		Slot &s = m_slots[handles[i]];
+		const uint8_t *src = old[s.m_chunk].m_data + s.m_offset;
+
+		allocate(s, s.m_len);
+		memcpy(m_chunks[s.m_chunk].m_data + s.m_offset, src, s.m_len);
+	}
+
+	std::vector<Chunk>::iterator it;
+	for (it = old.begin(); it != old.end(); ++it)
+		delete [] it->m_data;
+
+	m_holeBytes = 0;
+	m_compactions++;
+}
+
+void LatestValueStore::fillIoVector(IoVector &iovec)
+{
+	if (m_holeBytes && m_pinned == NONE)
+		compact();
+
+	struct iovec v;
+
+	if (!m_holeBytes && m_pinned == NONE) {
+		/* Fast path, the arena is the prologue */
+		std::vector<Chunk>::iterator it;
+		for (it = m_chunks.begin(); it != m_chunks.end(); ++it) {
+			if (!it->m_used)
+				continue;
+			v.iov_base = it->m_data;
+			v.iov_len = it->m_used;
+			iovec.push_back(v);
+		}
+		return;
+	}
+
+	/* Slow path while an update is in flight: walk the live slots,
+	 * merging runs that are adjacent in memory.
+	 */
+	std::vector<Handle> handles;
+	sortedHandles(handles);
+
+	uint8_t *run = NULL;
+	size_t runLen = 0;
+
+	for (uint32_t i = 0; i < handles.size(); i++) {
+		if (handles[i] == m_pinned)
+			continue;
+
+		uint8_t *p = data(handles[i]);
+		uint32_t len = m_slots[handles[i]].m_len;
+
+		if (run && run + runLen == p) {
+			runLen += len;
+			continue;
+		}
+
+		if (run) {
+			v.iov_base = run;
+			v.iov_len = runLen;
+			iovec.push_back(v);
+		}
+
+		run = p;
+		runLen = len;
+	}
+
+	if (run) {
+		v.iov_base = run;
+		v.iov_len = runLen;
+		iovec.push_back(v);
+	}
+}
@@ -0,0 +1,103 @@
+#ifndef __LATEST_VALUE_STORE_H
+#define __LATEST_VALUE_STORE_H
+
+#include <boost/noncopyable.hpp>
+#include <vector>
+
+#include <stdint.h>
+
+#include "Storage.h"
+
+/* The LatestValueStore holds the most recent copy of each slow-control
+ * packet (device descriptors and variable values) that must be replayed
+ * in a prologue whenever a new storage file is started.
+ *
+ * Packets are kept back-to-back in large arena chunks, so the store
+ * itself *is* the pre-built prologue: when nothing has moved, a whole
+ * chunk goes out as a single iovec entry. An update with the same length
+ * as the previous value (always the case for scalar variables) simply
+ * overwrites its slot in place with no allocation. A packet that changes
+ * size is appended to the end of the arena and leaves a hole behind;
+ * holes are squeezed out at the next prologue.
+ *
+ * Because relocated packets move to the end, packets are emitted in the
+ * order they were (last) relocated or first stored. Callers rely on this
+ * to keep each device descriptor ahead of its variable values.
+ *
+ * Chunks are never reallocated in place, so data() pointers stay valid
+ * until the handle is released or the arena is compacted. A handle may
+ * be "pinned" while its data is in use by a caller that can recurse
+ * into fillIoVector() (e.g. StorageManager::addPacket() starting a new
+ * file); the pinned packet is left out of the prologue and compaction
+ * is deferred until it is unpinned.
+ */
+class LatestValueStore : boost::noncopyable {
+public:
+	typedef uint32_t Handle;
+
+	static const Handle NONE = 0xffffffff;
+	static const uint32_t DEFAULT_CHUNK_SIZE = 1024 * 1024;
+
+	LatestValueStore(uint32_t chunkSize = DEFAULT_CHUNK_SIZE);
+	~LatestValueStore();
+
+	/* Store a copy of a packet, reusing the slot for handle h (if not
+	 * NONE) when the length is unchanged. Returns the (possibly new)
+	 * handle for the packet.
+	 */
+	Handle store(Handle h, const uint8_t *pkt, uint32_t len);
+
+	void release(Handle h);
+
+	uint8_t *data(Handle h) const {
+		const Slot &s = m_slots[h];
+		return m_chunks[s.m_chunk].m_data + s.m_offset;
+	}
+
+	uint32_t length(Handle h) const { return m_slots[h].m_len; }
+
+	void pin(Handle h) { m_pinned = h; }
+	void unpin(void) { m_pinned = NONE; }
+	Handle pinned(void) const { return m_pinned; }
+
+	/* Append iovec entries covering every live packet, in store order */
+	void fillIoVector(IoVector &iovec);
+
+	uint64_t inPlaceCount(void) const { return m_inPlace; }
+	uint64_t relocateCount(void) const { return m_relocated; }
+	uint64_t compactCount(void) const { return m_compactions; }
+	uint64_t liveBytes(void) const { return m_liveBytes; }
+
+private:
+	struct Chunk {
+		uint8_t *	m_data;
+		uint32_t	m_size;
+		uint32_t	m_used;
+	};
+
+	struct Slot {
+		uint32_t	m_chunk;
+		uint32_t	m_offset;
+		uint32_t	m_len;
+		bool		m_live;
+	};
+
+	std::vector<Chunk> m_chunks;
+	std::vector<Slot> m_slots;
+	std::vector<Handle> m_freeSlots;
+	uint32_t m_chunkSize;
+	uint64_t m_liveBytes;
+	uint64_t m_holeBytes;
+	Handle m_pinned;
+
+	uint64_t m_inPlace;
+	uint64_t m_relocated;
+	uint64_t m_compactions;
+
+	void allocate(Slot &slot, uint32_t len);
+	void newChunk(uint32_t minSize);
+	void sortedHandles(std::vector<Handle> &handles) const;
+	void compact(void);
+};
+
+#endif /* __LATEST_VALUE_STORE_H */
@@ -8,7 +8,6 @@ static LoggerPtr logger(Logger::getLogger("SMS.LiveClient"));
 
 #include <unistd.h>
 #include <errno.h>
-#include <sys/sendfile.h>
 #include <stdint.h>
 
 #include <boost/bind.hpp>
@@ -22,6 +21,7 @@ static LoggerPtr logger(Logger::getLogger("SMS.LiveClient"));
 #include "LiveClient.h"
 #include "StorageManager.h"
 #include "StorageFile.h"
+#include "Metrics.h"
 #include "utils.h"
 
 RateLimitedLogging::History RLLHistory_LiveClient;
@@ -29,10 +29,20 @@ RateLimitedLogging::History RLLHistory_LiveClient;
 // Rate-Limited Logging IDs...
 #define RLL_LIVE_CLIENT_READ_EXCEPTION   0
 
-/* We only need to receive the hello packet, which is very small, so don't
- * allocate huge buffers for us.
+/* We only need to receive the hello packet, which is small, so don't
+ * allocate huge buffers for us. (A Version 2 hello can carry a list of
+ * packet types and detector banks, so leave room for a few thousand.)
  */
-#define MAX_PKT_SIZE 1024
+#define MAX_PKT_SIZE 16384
+
+/* Largest stored packet a filtered client will wait for, same as the
+ * STC's parser limit; a header claiming more than this is corrupt.
+ */
+#define MAX_STORED_PKT_SIZE 0x3000000
+
+// Time in sendfile()/filtering per chunk, and what went out, all clients
+static Metrics::Id metricSend = Metrics::latency("Live:Send");
+static Metrics::Id metricBytes = Metrics::counter("Live:Bytes");
 
 unsigned int LiveClient::m_max_send_chunk = 2 * 1024 * 1024;
 double LiveClient::m_hello_timeout = 30.0;
@@ -56,7 +66,8 @@ LiveClient::LiveClient(LiveServer *server, int fd) :
 	ADARA::POSIXParser(MAX_PKT_SIZE, MAX_PKT_SIZE),
 	m_server(server), m_starting_new_file(true), m_bytes_written(0),
 	m_read(NULL), m_write(NULL), m_hello_received(false),
-	m_client_fd(fd), m_file_fd(-1), m_client_flags(0)
+	m_client_fd(fd), m_file_fd(-1), m_client_flags(0),
+	m_filter_out_pos(0)
 {
 	char hostname[1024], service[256];
 	struct sockaddr_in6 sa;
@@ -163,6 +174,12 @@ LiveClient::~LiveClient()
 
 	ERROR("client " << m_clientName << " disconnected");
 
+	if ( m_filter ) {
+		ERROR("client " << m_clientName << " filtered subscription"
+			<< " sent " << m_filter->bytesOut()
+			<< " of " << m_filter->bytesIn() << " bytes");
+	}
+
 	if ( m_clientId >= 0 ) {
 		m_pvStatus->disconnected();
 
@@ -394,7 +411,16 @@ void LiveClient::writable(void)
 			return;
 		}
 
-		rc = sendfile(m_client_fd, m_file_fd, &cur_offset, len);
+		// Filtered Clients Get Their Packets Picked Over First...
+		Metrics::Timer timer(metricSend);
+		if ( m_filter )
+		{
+			rc = sendFiltered( f, cur_offset,
+				f->size() - cur_offset, !f->active() );
+		}
+		else
+			rc = f->send(m_client_fd, &cur_offset, len);
+		timer.stop();
 		if ( rc < 0 )
 		{
 			if ( errno == EAGAIN || errno == EINTR )
@@ -426,8 +452,26 @@ void LiveClient::writable(void)
 		 * shrink on us, and we'll handle the client going
 		 * away on read or via an error return above. We'll just
 		 * pretend we got a non-zero rc.
+		 *
+		 * (For filtered clients, rc is what was consumed from the
+		 * file; flushFiltered() counts what was actually written.)
 		 */
-		m_bytes_written += rc;
+		if ( !m_filter )
+		{
+			m_bytes_written += rc;
+			Metrics::add(metricBytes, rc);
+		}
+
+		if ( m_filter )
+		{
+			/* Rewritten data still queued up for the socket? */
+			if ( m_filter_out_pos < m_filter_out.size() )
+				goto more;
+
+			/* No whole packet to work on yet, wait for more. */
+			if ( !rc && cur_offset != f->size() )
+				goto idle;
+		}
 
 		/* Did we catch up to the current EOF? */
 		if ( cur_offset != f->size() )
@@ -555,6 +599,96 @@ more:
 	// DEBUG("writable() more exit");
 }
 
+ssize_t LiveClient::sendFiltered( StorageFile::SharedPtr &f, off_t &offset,
+		off_t avail, bool at_end )
+{
+	// Push Out Anything Left Over from Last Time First...
+	if ( !flushFiltered() )
+		return -1;
+
+	if ( avail <= 0 )
+		return 0;
+
+	off_t len = avail;
+	if ( len > m_max_send_chunk )
+		len = m_max_send_chunk;
+
+	m_filter_in.resize( len );
+
+	ssize_t rc = f->read( &m_filter_in[0], len, offset );
+	if ( rc <= 0 )
+		return rc;
+
+	// Make Sure We Have At Least One Whole Packet to Work With...
+	uint32_t need = LiveFilter::packetLength( &m_filter_in[0], rc );
+
+	// A Corrupt Header Would Have Us Waiting Forever for the Rest...
+	if ( need > MAX_STORED_PKT_SIZE )
+	{
+		ERROR("sendFiltered(): Bogus Packet Length " << need
+			<< " at offset=" << offset << " in file=" << f->path()
+			<< " (max=" << MAX_STORED_PKT_SIZE << ")"
+			<< " for client " << m_clientName
+			<< " (m_client_fd=" << m_client_fd << ")");
+		errno = EMSGSIZE;
+		return -1;
+	}
+
+	// (A Finished File Ending Mid-Packet Just Gets the Rest of the File)
+	if ( need > (size_t) rc && ( need <= avail || at_end ) )
+	{
+		off_t want = ( need <= avail ) ? need : avail;
+		m_filter_in.resize( want );
+		ssize_t more = f->read( &m_filter_in[rc], want - rc,
+			offset + rc );
+		if ( more < 0 )
+			return more;
+		rc += more;
+	}
+
+	uint32_t used = m_filter->filter( &m_filter_in[0], rc, m_filter_out );
+
+	// A Finished File Ending in a Partial Packet...?! Pass It Along As-Is
+	// and Let the Client's Parser Sort It Out...
+	if ( !used && at_end && rc == avail )
+	{
+		m_filter_out.insert( m_filter_out.end(),
+			m_filter_in.begin(), m_filter_in.begin() + rc );
+		used = rc;
+	}
+
+	offset += used;
+
+	if ( !flushFiltered() && errno != EAGAIN )
+		return -1;
+
+	return used;
+}
+
+bool LiveClient::flushFiltered( void )
+{
+	while ( m_filter_out_pos < m_filter_out.size() )
+	{
+		ssize_t rc = ::write( m_client_fd,
+			&m_filter_out[ m_filter_out_pos ],
+			m_filter_out.size() - m_filter_out_pos );
+		if ( rc < 0 )
+		{
+			if ( errno == EINTR )
+				continue;
+			return false;
+		}
+		m_filter_out_pos += rc;
+		m_bytes_written += rc;
+		Metrics::add(metricBytes, rc);
+	}
+
+	m_filter_out.clear();
+	m_filter_out_pos = 0;
+
+	return true;
+}
+
 void LiveClient::containerChange( StorageContainer::SharedPtr &c,
 		bool starting )
 {
@@ -1102,6 +1236,13 @@ bool LiveClient::rxPacket( const ADARA::ClientHelloPkt &pkt )
 		ss << "PAUSE_AGNOSTIC";
 	ss << "]";
 
+	// Version 2 Subscription Filters...
+	if ( LiveFilter::wanted( pkt ) )
+	{
+		m_filter.reset( new LiveFilter( pkt ) );
+		ss << " [" << m_filter->describe() << "]";
+	}
+
 	ERROR("LiveClient Hello V" << pkt.version()
 		<< " Received from " << m_clientName
 		<< ", Requested Start Time = " << pkt.requestedStartTime()
@@ -5,11 +5,13 @@
 #include <boost/smart_ptr.hpp>
 #include <stdint.h>
 #include <string>
+#include <vector>
 #include <list>
 
 #include "ADARAPackets.h"
 #include "POSIXParser.h"
 #include "LiveServer.h"
+#include "LiveFilter.h"
 #include "StorageContainer.h"
 #include "StorageFile.h"
 #include "ReadyAdapter.h"
@@ -56,6 +58,15 @@ private:
 
 	uint32_t m_client_flags;
 
+	/* Only set for clients that asked for a filtered subscription;
+	 * everyone else gets the stored stream straight from sendfile()
+	 * (by way of StorageFile::send(), for compressed files).
+	 */
+	boost::scoped_ptr<LiveFilter> m_filter;
+	std::vector<uint8_t> m_filter_in;
+	std::vector<uint8_t> m_filter_out;
+	size_t m_filter_out_pos;
+
 	TimerAdapter<LiveClient> *m_timer;
 
 	connection m_mgrConnection;
@@ -80,6 +91,10 @@ private:
 	void writable(void);
 	void readable(void);
 
+	ssize_t sendFiltered(StorageFile::SharedPtr &f, off_t &offset,
+		off_t avail, bool at_end);
+	bool flushFiltered(void);
+
 	bool timerExpired(void);
 
 	bool rxPacket(const ADARA::Packet &pkt);
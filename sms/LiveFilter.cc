@@ -0,0 +1,236 @@
+#include <algorithm>
+#include <sstream>
+#include <string>
+
+#include <stdint.h>
+#include <string.h>
+
+#include "ADARA.h"
+#include "LiveFilter.h"
+
+LiveFilter::LiveFilter(const ADARA::ClientHelloPkt &hello) :
+	m_flags(hello.clientFlags()), m_decimation(hello.eventDecimation()),
+	m_types(hello.packetTypes()), m_banks(hello.detectorBanks()),
+	m_pulses(0), m_bytesIn(0), m_bytesOut(0)
+{
+	std::sort(m_types.begin(), m_types.end());
+	std::sort(m_banks.begin(), m_banks.end());
+
+	if (!(m_flags & ADARA::ClientHelloPkt::DECIMATE_EVENTS)
+			|| !m_decimation)
+		m_decimation = 1;
+
+	if (m_flags & ADARA::ClientHelloPkt::HISTO_PREVIEW)
+		m_preview.reset(new HistoPreview(m_decimation));
+}
+
+bool LiveFilter::typeWanted(uint32_t base_type) const
+{
+	if (m_flags & ADARA::ClientHelloPkt::METADATA_ONLY) {
+		switch (base_type) {
+			case ADARA::PacketType::RAW_EVENT_TYPE:
+			case ADARA::PacketType::MAPPED_EVENT_TYPE:
+			case ADARA::PacketType::BANKED_EVENT_TYPE:
+			case ADARA::PacketType::BANKED_EVENT_STATE_TYPE:
+			case ADARA::PacketType::BEAM_MONITOR_EVENT_TYPE:
+				return false;
+			default:
+				break;
+		}
+	}
+
+	if (m_flags & ADARA::ClientHelloPkt::FILTER_PKT_TYPES) {
+		return( std::binary_search(m_types.begin(), m_types.end(),
+			base_type) );
+	}
+
+	return true;
+}
+
+uint32_t LiveFilter::filter(const uint8_t *data, uint32_t len,
+		std::vector<uint8_t> &out)
+{
+	uint32_t pos = 0;
+	size_t out_start = out.size();
+
+	while (pos < len) {
+		uint32_t pkt_len = packetLength(data + pos, len - pos);
+		if (!pkt_len || pkt_len > len - pos)
+			break;
+
+		const uint8_t *pkt = data + pos;
+		uint32_t base_type =
+			ADARA_BASE_PKT_TYPE(((const uint32_t *) pkt)[1]);
+
+		pos += pkt_len;
+
+		bool banked = ( base_type == ADARA::PacketType::BANKED_EVENT_TYPE );
+		bool state =
+			( base_type == ADARA::PacketType::BANKED_EVENT_STATE_TYPE );
+
+		if (m_preview) {
+			preview(pkt, pkt_len, base_type, out);
+
+			/* Neutron events are swallowed by the preview */
+			if (banked || state)
+				continue;
+		}
+
+		if (!typeWanted(base_type))
+			continue;
+
+		if ((banked || state)
+				&& ((m_flags & ADARA::ClientHelloPkt::FILTER_BANKS)
+					|| m_decimation > 1)) {
+			bool keep_events = !( m_pulses++ % m_decimation );
+			filterBanked(pkt, pkt_len, state, keep_events, out);
+			continue;
+		}
+
+		out.insert(out.end(), pkt, pkt + pkt_len);
+	}
+
+	m_bytesIn += pos;
+	m_bytesOut += out.size() - out_start;
+
+	return pos;
+}
+
+void LiveFilter::preview(const uint8_t *pkt, uint32_t len,
+		uint32_t base_type, std::vector<uint8_t> &out)
+{
+	switch (base_type) {
+		case ADARA::PacketType::BANKED_EVENT_TYPE:
+		case ADARA::PacketType::BANKED_EVENT_STATE_TYPE:
+			if (!( m_pulses++ % m_decimation )) {
+				bool by_bank =
+					!!( m_flags & ADARA::ClientHelloPkt::FILTER_BANKS );
+				m_preview->addPulse(pkt, len,
+					base_type
+						== ADARA::PacketType::BANKED_EVENT_STATE_TYPE,
+					by_bank ? &m_banks : NULL);
+			}
+			else
+				m_preview->skipPulse(pkt);
+
+			if (m_preview->due())
+				m_preview->build(out);
+			break;
+
+		case ADARA::PacketType::DETECTOR_BANK_SETS_TYPE:
+			m_preview->detectorBankSets(pkt, len);
+			break;
+
+		case ADARA::PacketType::RUN_STATUS_TYPE:
+			/* Don't let a preview straddle a run boundary */
+			if (m_preview->pending())
+				m_preview->build(out);
+			break;
+
+		default:
+			break;
+	}
+}
+
+void LiveFilter::filterBanked(const uint8_t *pkt, uint32_t len, bool state,
+		bool keep_events, std::vector<uint8_t> &out)
+{
+	/* Layout after the header: 4 words of pulse information, then per
+	 * source (id, intra-pulse time, TOF field, bank count) followed by
+	 * per bank (id, [state,] event count, count * (tof, pixel)).
+	 */
+	const uint32_t *in = (const uint32_t *) pkt;
+	const uint32_t *end = in + len / sizeof(uint32_t);
+	const uint32_t *rpos = in + 4 + 4;
+	uint32_t bank_hdr = state ? 3 : 2;
+	bool by_bank = !!( m_flags & ADARA::ClientHelloPkt::FILTER_BANKS );
+
+	if (rpos > end) {
+		/* Too short to make sense of; let the client's parser
+		 * complain about it. */
+		out.insert(out.end(), pkt, pkt + len);
+		return;
+	}
+
+	size_t start = out.size();
+	out.insert(out.end(), pkt, (const uint8_t *) rpos);
+
+	while (rpos < end) {
+		if (end - rpos < 4)
+			goto malformed;
+
+		size_t src_hdr = out.size();
+		out.insert(out.end(), (const uint8_t *) rpos,
+			(const uint8_t *) (rpos + 4));
+		uint32_t bank_count = rpos[3];
+		uint32_t kept = 0;
+		rpos += 4;
+
+		while (bank_count--) {
+			if ((uint32_t) (end - rpos) < bank_hdr)
+				goto malformed;
+
+			uint32_t bank = rpos[0];
+			uint32_t events = rpos[bank_hdr - 1];
+			const uint32_t *next = rpos + bank_hdr;
+
+			if ((uint32_t) (end - next) / 2 < events)
+				goto malformed;
+			next += 2 * events;
+
+			if (keep_events && (!by_bank || std::binary_search(
+					m_banks.begin(), m_banks.end(), bank))) {
+				out.insert(out.end(), (const uint8_t *) rpos,
+					(const uint8_t *) next);
+				kept++;
+			}
+
+			rpos = next;
+		}
+
+		memcpy(&out[src_hdr + 3 * sizeof(uint32_t)], &kept,
+			sizeof(uint32_t));
+	}
+
+	{
+		uint32_t payload_len = out.size() - start - sizeof(ADARA::Header);
+		memcpy(&out[start], &payload_len, sizeof(uint32_t));
+	}
+	return;
+
+malformed:
+	out.resize(start);
+	out.insert(out.end(), pkt, pkt + len);
+}
+
+std::string LiveFilter::describe(void) const
+{
+	std::stringstream ss;
+	const char *sep = "";
+
+	if (m_flags & ADARA::ClientHelloPkt::METADATA_ONLY) {
+		ss << sep << "METADATA_ONLY";
+		sep = " ";
+	}
+	if (m_flags & ADARA::ClientHelloPkt::FILTER_PKT_TYPES) {
+		ss << sep << "PKT_TYPES=" << std::hex;
+		for (uint32_t i = 0; i < m_types.size(); i++)
+			ss << ( i ? "," : "" ) << "0x" << m_types[i];
+		ss << std::dec;
+		sep = " ";
+	}
+	if (m_flags & ADARA::ClientHelloPkt::FILTER_BANKS) {
+		ss << sep << "BANKS=";
+		for (uint32_t i = 0; i < m_banks.size(); i++)
+			ss << ( i ? "," : "" ) << (int32_t) m_banks[i];
+		sep = " ";
+	}
+	if (m_decimation > 1) {
+		ss << sep << "DECIMATE=1/" << m_decimation;
+		sep = " ";
+	}
+	if (m_preview)
+		ss << sep << "PREVIEW";
+
+	return ss.str();
+}
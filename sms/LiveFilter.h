@@ -0,0 +1,87 @@
+#ifndef __LIVE_FILTER_H
+#define __LIVE_FILTER_H
+
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <vector>
+
+#include <stdint.h>
+
+#include "ADARAPackets.h"
+#include "HistoPreview.h"
+
+/* The LiveFilter implements the subscription filters a live client may
+ * request in a Version 2 ClientHelloPkt. It works on the raw bytes of the
+ * stored stream, so LiveClient can run a chunk of a storage file through
+ * it and send the result instead of sendfile()'ing the whole thing:
+ *
+ *    METADATA_ONLY     - drop every neutron/monitor event packet
+ *    FILTER_PKT_TYPES  - only pass the listed (base) packet types
+ *    FILTER_BANKS      - strip banked event packets down to the
+ *                        listed detector banks
+ *    DECIMATE_EVENTS   - only keep the neutron events of 1-in-N pulses
+ *    HISTO_PREVIEW     - replace the neutron events with periodic
+ *                        HistoPreviewPkts (see HistoPreview)
+ *
+ * Banked event (state) packets are rewritten rather than dropped by the
+ * bank and decimation filters, so every pulse still arrives with its
+ * charge, cycle, flags and source headers; only the per-bank event
+ * sections are removed. Beam monitor packets are left alone by both.
+ */
+class LiveFilter : boost::noncopyable {
+public:
+	LiveFilter(const ADARA::ClientHelloPkt &hello);
+
+	static bool wanted(const ADARA::ClientHelloPkt &hello) {
+		return( !!( hello.clientFlags()
+			& ADARA::ClientHelloPkt::FILTER_MASK ) );
+	}
+
+	/* Total length of the packet starting at data, or 0 if we don't
+	 * have enough of it to tell. (A corrupt payload length comes back
+	 * as 0xffffffff rather than wrapping around to a short packet.)
+	 */
+	static uint32_t packetLength(const uint8_t *data, uint32_t len) {
+		if (len < sizeof(ADARA::Header))
+			return 0;
+		uint32_t payload_len = ((const uint32_t *) data)[0];
+		if (payload_len > 0xffffffff - sizeof(ADARA::Header))
+			return 0xffffffff;
+		return( payload_len + sizeof(ADARA::Header) );
+	}
+
+	/* Run the complete packets at the start of [data, data + len)
+	 * through the filter, appending what the client should see to out.
+	 * Returns the number of bytes consumed, which is always a whole
+	 * number of packets; any trailing partial packet is left alone.
+	 */
+	uint32_t filter(const uint8_t *data, uint32_t len,
+			std::vector<uint8_t> &out);
+
+	uint64_t bytesIn(void) const { return m_bytesIn; }
+	uint64_t bytesOut(void) const { return m_bytesOut; }
+
+	std::string describe(void) const;
+
+private:
+	uint32_t m_flags;
+	uint32_t m_decimation;
+	std::vector<uint32_t> m_types;	// sorted
+	std::vector<uint32_t> m_banks;	// sorted
+
+	uint64_t m_pulses;
+	uint64_t m_bytesIn;
+	uint64_t m_bytesOut;
+
+	boost::scoped_ptr<HistoPreview> m_preview;
+
+	void preview(const uint8_t *pkt, uint32_t len, uint32_t base_type,
+			std::vector<uint8_t> &out);
+
+	bool typeWanted(uint32_t base_type) const;
+
+	void filterBanked(const uint8_t *pkt, uint32_t len, bool state,
+			bool keep_events, std::vector<uint8_t> &out);
+};
+
+#endif /* __LIVE_FILTER_H */
@@ -18,6 +18,7 @@ static LoggerPtr logger(Logger::getLogger("SMS.LiveServer"));
 #include "SMSControlPV.h"
 #include "LiveServer.h"
 #include "LiveClient.h"
+#include "HistoPreview.h"
 
 class ListenStringPV : public smsStringPV {
 public:
@@ -77,6 +78,14 @@ void LiveServer::config(const boost::property_tree::ptree &conf)
 	m_send_paused_data =
 		conf.get<bool>("livestream.send_paused_data", false);
 
+	// Histogram Preview Defaults, for Clients that Ask for HISTO_PREVIEW
+	// (Detector Bank Sets with Histo Format override the TOF Binning)
+	HistoPreview::config(
+		conf.get<double>("livestream.preview_interval", 1.0),
+		conf.get<uint32_t>("livestream.preview_tof_max", 33333),
+		conf.get<uint32_t>("livestream.preview_tof_bin", 100),
+		conf.get<uint32_t>("livestream.preview_max_pixels", 4194304));
+
 	LiveClient::config(conf);
 }
 
@@ -35,6 +35,25 @@ RateLimitedLogging::History RLLHistory_MetaDataMgr;
 #define RLL_VAR_UPDATE_NO_DESC     9
 #define RLL_VAR_UPDATE_BAD_TAG    10
 
+/* Checked on every variable update, so registered once for handle-based
+ * checks; the device and source tag go in the message instead of the key.
+ */
+static RateLimitedLogging::Handle rllUnableRemapU32Var =
+	RateLimitedLogging::registerLog( RLLHistory_MetaDataMgr,
+		RLL_UNABLE_REMAP_U32_VAR, "", 60, 3, 10 );
+static RateLimitedLogging::Handle rllUnableRemapDblVar =
+	RateLimitedLogging::registerLog( RLLHistory_MetaDataMgr,
+		RLL_UNABLE_REMAP_DBL_VAR, "", 60, 3, 10 );
+static RateLimitedLogging::Handle rllUnableRemapStrVar =
+	RateLimitedLogging::registerLog( RLLHistory_MetaDataMgr,
+		RLL_UNABLE_REMAP_STR_VAR, "", 60, 3, 10 );
+static RateLimitedLogging::Handle rllVarUpdateNoDesc =
+	RateLimitedLogging::registerLog( RLLHistory_MetaDataMgr,
+		RLL_VAR_UPDATE_NO_DESC, "", 60, 3, 10 );
+static RateLimitedLogging::Handle rllVarUpdateBadTag =
+	RateLimitedLogging::registerLog( RLLHistory_MetaDataMgr,
+		RLL_VAR_UPDATE_BAD_TAG, "", 60, 3, 10 );
+
 MetaDataMgr::MetaDataMgr() : m_nextMappedDevId(1)
 {
 	m_connection = StorageManager::onPrologue(
@@ -47,23 +66,21 @@ MetaDataMgr::~MetaDataMgr()
 }
 
 void MetaDataMgr::upstreamDisconnected(
-		MetaDataMgr::VariablePktMap &varPkts )
+		MetaDataMgr::VariableSlotMap &varSlots )
 {
 	/* For each variable, modify the packet to indicate that we
 	 * lost the upstream connection and feed it into the stream.
 	 */
-	VariablePktMap::iterator vit, vend = varPkts.end();
+	VariableSlotMap::iterator vit, vend = varSlots.end();
 	uint32_t len, pktSize = 0;
 	uint32_t *fields = NULL;
 	uint8_t *pkt = NULL;
 
 	std::stringstream var_log_ss;
 
-	for ( vit = varPkts.begin(); vit != vend; vit++ ) {
-
-		ADARA::PacketSharedPtr orig = vit->second;
+	for ( vit = varSlots.begin(); vit != vend; vit++ ) {
 
-		len = orig->packet_length();
+		len = m_latest.length( vit->second );
 		if ( len > pktSize ) {
 			delete[] pkt;
 			pktSize = len;
@@ -72,7 +89,7 @@ void MetaDataMgr::upstreamDisconnected(
 					ADARA::PacketHeader::header_length() );
 		}
 
-		memcpy( pkt, orig->packet(), len );
+		memcpy( pkt, m_latest.data( vit->second ), len );
 		fields[2] = ADARA::VariableStatus::UPSTREAM_DISCONNECTED;
 		fields[2] <<= 16;
 		fields[2] |= ADARA::VariableSeverity::INVALID;
@@ -104,6 +121,21 @@ void MetaDataMgr::upstreamDisconnected(
 	delete[] pkt;
 }
 
+void MetaDataMgr::releaseDevice( MetaDataMgr::DeviceVariables &dev )
+{
+	/* Drop the device's descriptor and variable values from the
+	 * prologue store; the caller removes the device itself.
+	 */
+	VariableSlotMap::iterator vit, vend = dev.m_variableSlots.end();
+
+	for ( vit = dev.m_variableSlots.begin(); vit != vend; ++vit )
+		m_latest.release( vit->second );
+	dev.m_variableSlots.clear();
+
+	m_latest.release( dev.m_descriptorSlot );
+	dev.m_descriptorSlot = LatestValueStore::NONE;
+}
+
 void MetaDataMgr::dropSourceTag( uint32_t srcTag )
 {
 	/* Rate-limited log that we got disconnected from a DataSource (srcTag)
@@ -135,7 +167,7 @@ void MetaDataMgr::dropSourceTag( uint32_t srcTag )
 				<< " srcTag=" << dev.m_srcTag
 				<< " devId=" << dev.m_devId
 				<< " mapped_dev=" << dit->first);
-			upstreamDisconnected(dev.m_variablePkts);
+			upstreamDisconnected(dev.m_variableSlots);
 			// Move Device to "Old Devices" List for Possible Re-Connect...
 			uint64_t key = ((uint64_t) srcTag << 32) | dev.m_devId;
 			m_oldDevIdMap[key] = dit->first;
@@ -150,7 +182,8 @@ void MetaDataMgr::dropSourceTag( uint32_t srcTag )
 			// - Go Ahead and Clear Out Any Previous Values, We'll Get
 			// _New_ Values on a Re-Connect... ;-D
 			// (cleaner this way, plus doesn't break "continuous" tests!)
-			m_oldDevices[dit->first].m_variablePkts.clear();
+			m_oldDevices[dit->first].m_variableSlots.clear();
+			releaseDevice(dev);
 			m_devices.erase(dit++);
 			dropped = true;
 		} else {
@@ -236,8 +269,13 @@ uint32_t MetaDataMgr::lookupOldMappedDeviceId(
 			odit->second.m_srcTag;
 		m_devices[mapped_dev].m_descriptorPkt =
 			odit->second.m_descriptorPkt;
-		m_devices[mapped_dev].m_variablePkts =
-			odit->second.m_variablePkts;   // (cleared out on disconnect)
+		m_devices[mapped_dev].m_variableSlots.clear();
+			// (variable values cleared out on disconnect)
+
+		ADARA::Packet *desc = odit->second.m_descriptorPkt.get();
+		m_devices[mapped_dev].m_descriptorSlot = m_latest.store(
+			LatestValueStore::NONE, desc->packet(),
+			desc->packet_length() );
 
 		m_oldDevices.erase(odit);
 
@@ -395,6 +433,7 @@ void MetaDataMgr::updateDescriptor(
 		if ( do_log ) {
 			DEBUG("Updating Existing Descriptor");
 		}
+		releaseDevice(dev);
 		m_devices.erase(dit);
 
 		// Empty Descriptor XML, "Undefine" Device...!
@@ -422,6 +461,8 @@ void MetaDataMgr::updateDescriptor(
 		true /* ignore_pkt_timestamp */,
 		false /* check_old_containers */ );
 	m_devices[mapped_dev].m_descriptorPkt = pkt;
+	m_devices[mapped_dev].m_descriptorSlot = m_latest.store(
+		LatestValueStore::NONE, pkt->packet(), pkt->packet_length() );
 	m_devices[mapped_dev].m_devId = inPkt.devId();
 	m_devices[mapped_dev].m_srcTag = srcTag;
 }
@@ -504,6 +545,8 @@ void MetaDataMgr::addFastMetaDDP( const timespec &ts, uint32_t mapped_dev,
 	}
 	m_devices[mapped_dev].m_descriptorPkt =
 		boost::make_shared<ADARA::Packet>(wrapped);
+	m_devices[mapped_dev].m_descriptorSlot = m_latest.store(
+		LatestValueStore::NONE, (const uint8_t *) pkt, size );
 	m_devices[mapped_dev].m_devId = -1; // FastMetaDDP...!
 	m_devices[mapped_dev].m_srcTag = 0;
 }
@@ -516,11 +559,8 @@ void MetaDataMgr::updateValue( const ADARA::VariableU32Pkt &inPkt,
 	if ( !mapped_dev ) {
 		/* Rate-limited logging of Device/Source Tag Lookup failed...? */
 		std::string log_info;
-		std::stringstream ss;
-		ss << inPkt.devId() << "/" << srcTag;
 		if ( RateLimitedLogging::checkLog( RLLHistory_MetaDataMgr,
-				RLL_UNABLE_REMAP_U32_VAR, ss.str(),
-				60, 3, 10, log_info ) ) {
+				rllUnableRemapU32Var, log_info ) ) {
 			SMSControl *ctrl = SMSControl::getInstance();
 			ERROR( log_info
 				<< ( ctrl->getRecording() ? "[RECORDING] " : "" )
@@ -532,13 +572,8 @@ void MetaDataMgr::updateValue( const ADARA::VariableU32Pkt &inPkt,
 		return;
 	}
 
-	/* Fix the device id in the packet before further processing... */
-	boost::shared_ptr<ADARA::VariableU32Pkt> vup;
-	vup = boost::make_shared<ADARA::VariableU32Pkt>(inPkt);
-	vup->remapDeviceId(mapped_dev);
-	ADARA::PacketSharedPtr pkt(vup);
-
-	updateVariable( mapped_dev, inPkt.varId(), pkt, srcTag );
+	/* The device id is remapped as the value is stored... */
+	updateVariable( mapped_dev, inPkt.varId(), inPkt, srcTag, true );
 }
 
 void MetaDataMgr::updateValue( const ADARA::VariableDoublePkt &inPkt,
@@ -549,11 +584,8 @@ void MetaDataMgr::updateValue( const ADARA::VariableDoublePkt &inPkt,
 	if ( !mapped_dev ) {
 		/* Rate-limited logging of Device/Source Tag Lookup failed...? */
 		std::string log_info;
-		std::stringstream ss;
-		ss << inPkt.devId() << "/" << srcTag;
 		if ( RateLimitedLogging::checkLog( RLLHistory_MetaDataMgr,
-				RLL_UNABLE_REMAP_DBL_VAR, ss.str(),
-				60, 3, 10, log_info ) ) {
+				rllUnableRemapDblVar, log_info ) ) {
 			SMSControl *ctrl = SMSControl::getInstance();
 			ERROR( log_info
 				<< ( ctrl->getRecording() ? "[RECORDING] " : "" )
@@ -566,13 +598,8 @@ void MetaDataMgr::updateValue( const ADARA::VariableDoublePkt &inPkt,
 		return;
 	}
 
-	/* Fix the device id in the packet before further processing... */
-	boost::shared_ptr<ADARA::VariableDoublePkt> vup;
-	vup = boost::make_shared<ADARA::VariableDoublePkt>(inPkt);
-	vup->remapDeviceId(mapped_dev);
-	ADARA::PacketSharedPtr pkt(vup);
-
-	updateVariable( mapped_dev, inPkt.varId(), pkt, srcTag );
+	/* The device id is remapped as the value is stored... */
+	updateVariable( mapped_dev, inPkt.varId(), inPkt, srcTag, true );
 }
 
 void MetaDataMgr::updateValue( const ADARA::VariableStringPkt &inPkt,
@@ -583,11 +610,8 @@ void MetaDataMgr::updateValue( const ADARA::VariableStringPkt &inPkt,
 	if ( !mapped_dev ) {
 		/* Rate-limited logging of Device/Source Tag Lookup failed...? */
 		std::string log_info;
-		std::stringstream ss;
-		ss << inPkt.devId() << "/" << srcTag;
 		if ( RateLimitedLogging::checkLog( RLLHistory_MetaDataMgr,
-				RLL_UNABLE_REMAP_STR_VAR, ss.str(),
-				60, 3, 10, log_info ) ) {
+				rllUnableRemapStrVar, log_info ) ) {
 			SMSControl *ctrl = SMSControl::getInstance();
 			ERROR( log_info
 				<< ( ctrl->getRecording() ? "[RECORDING] " : "" )
@@ -600,13 +624,8 @@ void MetaDataMgr::updateValue( const ADARA::VariableStringPkt &inPkt,
 		return;
 	}
 
-	/* Fix the device id in the packet before further processing... */
-	boost::shared_ptr<ADARA::VariableStringPkt> vup;
-	vup = boost::make_shared<ADARA::VariableStringPkt>(inPkt);
-	vup->remapDeviceId(mapped_dev);
-	ADARA::PacketSharedPtr pkt(vup);
-
-	updateVariable( mapped_dev, inPkt.varId(), pkt, srcTag );
+	/* The device id is remapped as the value is stored... */
+	updateVariable( mapped_dev, inPkt.varId(), inPkt, srcTag, true );
 }
 
 void MetaDataMgr::updateValue( const ADARA::VariableU32ArrayPkt &inPkt,
@@ -617,11 +636,8 @@ void MetaDataMgr::updateValue( const ADARA::VariableU32ArrayPkt &inPkt,
 	if ( !mapped_dev ) {
 		/* Rate-limited logging of Device/Source Tag Lookup failed...? */
 		std::string log_info;
-		std::stringstream ss;
-		ss << inPkt.devId() << "/" << srcTag;
 		if ( RateLimitedLogging::checkLog( RLLHistory_MetaDataMgr,
-				RLL_UNABLE_REMAP_U32_VAR, ss.str(),
-				60, 3, 10, log_info ) ) {
+				rllUnableRemapU32Var, log_info ) ) {
 			SMSControl *ctrl = SMSControl::getInstance();
 			ERROR( log_info
 				<< ( ctrl->getRecording() ? "[RECORDING] " : "" )
@@ -634,13 +650,8 @@ void MetaDataMgr::updateValue( const ADARA::VariableU32ArrayPkt &inPkt,
 		return;
 	}
 
-	/* Fix the device id in the packet before further processing... */
-	boost::shared_ptr<ADARA::VariableU32ArrayPkt> vup;
-	vup = boost::make_shared<ADARA::VariableU32ArrayPkt>(inPkt);
-	vup->remapDeviceId(mapped_dev);
-	ADARA::PacketSharedPtr pkt(vup);
-
-	updateVariable( mapped_dev, inPkt.varId(), pkt, srcTag );
+	/* The device id is remapped as the value is stored... */
+	updateVariable( mapped_dev, inPkt.varId(), inPkt, srcTag, true );
 }
 
 void MetaDataMgr::updateValue( const ADARA::VariableDoubleArrayPkt &inPkt,
@@ -651,11 +662,8 @@ void MetaDataMgr::updateValue( const ADARA::VariableDoubleArrayPkt &inPkt,
 	if ( !mapped_dev ) {
 		/* Rate-limited logging of Device/Source Tag Lookup failed...? */
 		std::string log_info;
-		std::stringstream ss;
-		ss << inPkt.devId() << "/" << srcTag;
 		if ( RateLimitedLogging::checkLog( RLLHistory_MetaDataMgr,
-				RLL_UNABLE_REMAP_DBL_VAR, ss.str(),
-				60, 3, 10, log_info ) ) {
+				rllUnableRemapDblVar, log_info ) ) {
 			SMSControl *ctrl = SMSControl::getInstance();
 			ERROR( log_info
 				<< ( ctrl->getRecording() ? "[RECORDING] " : "" )
@@ -668,13 +676,8 @@ void MetaDataMgr::updateValue( const ADARA::VariableDoubleArrayPkt &inPkt,
 		return;
 	}
 
-	/* Fix the device id in the packet before further processing... */
-	boost::shared_ptr<ADARA::VariableDoubleArrayPkt> vup;
-	vup = boost::make_shared<ADARA::VariableDoubleArrayPkt>(inPkt);
-	vup->remapDeviceId(mapped_dev);
-	ADARA::PacketSharedPtr pkt(vup);
-
-	updateVariable( mapped_dev, inPkt.varId(), pkt, srcTag );
+	/* The device id is remapped as the value is stored... */
+	updateVariable( mapped_dev, inPkt.varId(), inPkt, srcTag, true );
 }
 
 void MetaDataMgr::updateValue( const ADARA::MultVariableU32Pkt &inPkt,
@@ -685,11 +688,8 @@ void MetaDataMgr::updateValue( const ADARA::MultVariableU32Pkt &inPkt,
 	if ( !mapped_dev ) {
 		/* Rate-limited logging of Device/Source Tag Lookup failed...? */
 		std::string log_info;
-		std::stringstream ss;
-		ss << inPkt.devId() << "/" << srcTag;
 		if ( RateLimitedLogging::checkLog( RLLHistory_MetaDataMgr,
-				RLL_UNABLE_REMAP_U32_VAR, ss.str(),
-				60, 3, 10, log_info ) ) {
+				rllUnableRemapU32Var, log_info ) ) {
 			SMSControl *ctrl = SMSControl::getInstance();
 			ERROR( log_info
 				<< ( ctrl->getRecording() ? "[RECORDING] " : "" )
@@ -702,13 +702,8 @@ void MetaDataMgr::updateValue( const ADARA::MultVariableU32Pkt &inPkt,
 		return;
 	}
 
-	/* Fix the device id in the packet before further processing... */
-	boost::shared_ptr<ADARA::MultVariableU32Pkt> vup;
-	vup = boost::make_shared<ADARA::MultVariableU32Pkt>(inPkt);
-	vup->remapDeviceId(mapped_dev);
-	ADARA::PacketSharedPtr pkt(vup);
-
-	updateVariable( mapped_dev, inPkt.varId(), pkt, srcTag );
+	/* The device id is remapped as the value is stored... */
+	updateVariable( mapped_dev, inPkt.varId(), inPkt, srcTag, true );
 }
 
 void MetaDataMgr::updateValue( const ADARA::MultVariableDoublePkt &inPkt,
@@ -719,11 +714,8 @@ void MetaDataMgr::updateValue( const ADARA::MultVariableDoublePkt &inPkt,
 	if ( !mapped_dev ) {
 		/* Rate-limited logging of Device/Source Tag Lookup failed...? */
 		std::string log_info;
-		std::stringstream ss;
-		ss << inPkt.devId() << "/" << srcTag;
 		if ( RateLimitedLogging::checkLog( RLLHistory_MetaDataMgr,
-				RLL_UNABLE_REMAP_DBL_VAR, ss.str(),
-				60, 3, 10, log_info ) ) {
+				rllUnableRemapDblVar, log_info ) ) {
 			SMSControl *ctrl = SMSControl::getInstance();
 			ERROR( log_info
 				<< ( ctrl->getRecording() ? "[RECORDING] " : "" )
@@ -736,13 +728,8 @@ void MetaDataMgr::updateValue( const ADARA::MultVariableDoublePkt &inPkt,
 		return;
 	}
 
-	/* Fix the device id in the packet before further processing... */
-	boost::shared_ptr<ADARA::MultVariableDoublePkt> vup;
-	vup = boost::make_shared<ADARA::MultVariableDoublePkt>(inPkt);
-	vup->remapDeviceId(mapped_dev);
-	ADARA::PacketSharedPtr pkt(vup);
-
-	updateVariable( mapped_dev, inPkt.varId(), pkt, srcTag );
+	/* The device id is remapped as the value is stored... */
+	updateVariable( mapped_dev, inPkt.varId(), inPkt, srcTag, true );
 }
 
 void MetaDataMgr::updateValue( const ADARA::MultVariableStringPkt &inPkt,
@@ -753,11 +740,8 @@ void MetaDataMgr::updateValue( const ADARA::MultVariableStringPkt &inPkt,
 	if ( !mapped_dev ) {
 		/* Rate-limited logging of Device/Source Tag Lookup failed...? */
 		std::string log_info;
-		std::stringstream ss;
-		ss << inPkt.devId() << "/" << srcTag;
 		if ( RateLimitedLogging::checkLog( RLLHistory_MetaDataMgr,
-				RLL_UNABLE_REMAP_STR_VAR, ss.str(),
-				60, 3, 10, log_info ) ) {
+				rllUnableRemapStrVar, log_info ) ) {
 			SMSControl *ctrl = SMSControl::getInstance();
 			ERROR( log_info
 				<< ( ctrl->getRecording() ? "[RECORDING] " : "" )
@@ -770,13 +754,8 @@ void MetaDataMgr::updateValue( const ADARA::MultVariableStringPkt &inPkt,
 		return;
 	}
 
-	/* Fix the device id in the packet before further processing... */
-	boost::shared_ptr<ADARA::MultVariableStringPkt> vup;
-	vup = boost::make_shared<ADARA::MultVariableStringPkt>(inPkt);
-	vup->remapDeviceId(mapped_dev);
-	ADARA::PacketSharedPtr pkt(vup);
-
-	updateVariable( mapped_dev, inPkt.varId(), pkt, srcTag );
+	/* The device id is remapped as the value is stored... */
+	updateVariable( mapped_dev, inPkt.varId(), inPkt, srcTag, true );
 }
 
 void MetaDataMgr::updateValue( const ADARA::MultVariableU32ArrayPkt &inPkt,
@@ -787,11 +766,8 @@ void MetaDataMgr::updateValue( const ADARA::MultVariableU32ArrayPkt &inPkt,
 	if ( !mapped_dev ) {
 		/* Rate-limited logging of Device/Source Tag Lookup failed...? */
 		std::string log_info;
-		std::stringstream ss;
-		ss << inPkt.devId() << "/" << srcTag;
 		if ( RateLimitedLogging::checkLog( RLLHistory_MetaDataMgr,
-				RLL_UNABLE_REMAP_U32_VAR, ss.str(),
-				60, 3, 10, log_info ) ) {
+				rllUnableRemapU32Var, log_info ) ) {
 			SMSControl *ctrl = SMSControl::getInstance();
 			ERROR( log_info
 				<< ( ctrl->getRecording() ? "[RECORDING] " : "" )
@@ -804,13 +780,8 @@ void MetaDataMgr::updateValue( const ADARA::MultVariableU32ArrayPkt &inPkt,
 		return;
 	}
 
-	/* Fix the device id in the packet before further processing... */
-	boost::shared_ptr<ADARA::MultVariableU32ArrayPkt> vup;
-	vup = boost::make_shared<ADARA::MultVariableU32ArrayPkt>(inPkt);
-	vup->remapDeviceId(mapped_dev);
-	ADARA::PacketSharedPtr pkt(vup);
-
-	updateVariable( mapped_dev, inPkt.varId(), pkt, srcTag );
+	/* The device id is remapped as the value is stored... */
+	updateVariable( mapped_dev, inPkt.varId(), inPkt, srcTag, true );
 }
 
 void MetaDataMgr::updateValue(
@@ -822,11 +793,8 @@ void MetaDataMgr::updateValue(
 	if ( !mapped_dev ) {
 		/* Rate-limited logging of Device/Source Tag Lookup failed...? */
 		std::string log_info;
-		std::stringstream ss;
-		ss << inPkt.devId() << "/" << srcTag;
 		if ( RateLimitedLogging::checkLog( RLLHistory_MetaDataMgr,
-				RLL_UNABLE_REMAP_DBL_VAR, ss.str(),
-				60, 3, 10, log_info ) ) {
+				rllUnableRemapDblVar, log_info ) ) {
 			SMSControl *ctrl = SMSControl::getInstance();
 			ERROR( log_info
 				<< ( ctrl->getRecording() ? "[RECORDING] " : "" )
@@ -839,13 +807,8 @@ void MetaDataMgr::updateValue(
 		return;
 	}
 
-	/* Fix the device id in the packet before further processing... */
-	boost::shared_ptr<ADARA::MultVariableDoubleArrayPkt> vup;
-	vup = boost::make_shared<ADARA::MultVariableDoubleArrayPkt>(inPkt);
-	vup->remapDeviceId(mapped_dev);
-	ADARA::PacketSharedPtr pkt(vup);
-
-	updateVariable( mapped_dev, inPkt.varId(), pkt, srcTag );
+	/* The device id is remapped as the value is stored... */
+	updateVariable( mapped_dev, inPkt.varId(), inPkt, srcTag, true );
 }
 
 void MetaDataMgr::extractLastValue( ADARA::MultVariableU32Pkt inPkt,
@@ -1191,16 +1154,15 @@ void MetaDataMgr::updateMappedVariable(
 		uint32_t mapped_dev, uint32_t varId,
 		const uint8_t *data, uint32_t size )
 {
-	/* We need to make a copy of the packet, but can only copy from
-	 * another Packet object, so create a wrapper object then copy it.
+	/* Wrap the caller's buffer; updateVariable() copies it into
+	 * the latest value store.
 	 */
-	ADARA::Packet pkt( data, sizeof(size) );
-	ADARA::PacketSharedPtr copy(new ADARA::Packet(pkt));
-	updateVariable( mapped_dev, varId, copy, 0 );
+	ADARA::Packet pkt( data, size );
+	updateVariable( mapped_dev, varId, pkt, 0, false );
 }
 
 void MetaDataMgr::updateVariable( uint32_t dev, uint32_t varId,
-		ADARA::PacketSharedPtr &inPkt, uint32_t srcTag )
+		const ADARA::Packet &inPkt, uint32_t srcTag, bool remap )
 {
 	DeviceMap::iterator dit = m_devices.find(dev);
 
@@ -1209,11 +1171,8 @@ void MetaDataMgr::updateVariable( uint32_t dev, uint32_t varId,
 		 * the corresponding device descriptor.
 		 */
 		std::string log_info;
-		std::stringstream ss;
-		ss << dev << "/" << srcTag;
 		if ( RateLimitedLogging::checkLog( RLLHistory_MetaDataMgr,
-				RLL_VAR_UPDATE_NO_DESC, ss.str(),
-				60, 3, 10, log_info ) ) {
+				rllVarUpdateNoDesc, log_info ) ) {
 			SMSControl *ctrl = SMSControl::getInstance();
 			ERROR( log_info
 				<< ( ctrl->getRecording() ? "[RECORDING] " : "" )
@@ -1230,11 +1189,8 @@ void MetaDataMgr::updateVariable( uint32_t dev, uint32_t varId,
 		 * an Incorrect srcTag (ie, Wrong Data Source)
 		 */
 		std::string log_info;
-		std::stringstream ss;
-		ss << dev << "/" << srcTag;
 		if ( RateLimitedLogging::checkLog( RLLHistory_MetaDataMgr,
-				RLL_VAR_UPDATE_BAD_TAG, ss.str(),
-				60, 3, 10, log_info ) ) {
+				rllVarUpdateBadTag, log_info ) ) {
 			SMSControl *ctrl = SMSControl::getInstance();
 			ERROR( log_info
 				<< ( ctrl->getRecording() ? "[RECORDING] " : "" )
@@ -1248,107 +1204,148 @@ void MetaDataMgr::updateVariable( uint32_t dev, uint32_t varId,
 		return;
 	}
 
-	/* Remove the old variable value from our map before we add the
-	 * update to the stream; this keeps us from writing out the old
-	 * value in a prologue if we start a new file on this update.
+	/* Overwrite the latest value for this variable in place (or take
+	 * a new slot if it changed size), fixing up the device id as we go.
 	 */
-	VariablePktMap &varPktMap = dit->second.m_variablePkts;
-	VariablePktMap::iterator vit = varPktMap.find(varId);
+	VariableSlotMap &varSlots = dit->second.m_variableSlots;
+	VariableSlotMap::iterator vit = varSlots.find(varId);
+	LatestValueStore::Handle slot = LatestValueStore::NONE;
 
-	if ( vit != varPktMap.end() )
-		varPktMap.erase(vit);
+	if ( vit != varSlots.end() )
+		slot = vit->second;
 
-	// Since PV Value Update TimeStamps can be "Old" Relative to
-	// the Current Run Time (because they haven't changed in a while),
-	// We Need to "Ignore the Packet TimeStamp" when Writing Them;
-	// They Need to Just Go into the "Current" Storage Container.
-	StorageManager::addPacket( inPkt->packet(), inPkt->packet_length(),
-		true /* ignore_pkt_timestamp */ );
+	slot = m_latest.store( slot, inPkt.packet(), inPkt.packet_length() );
+	varSlots[varId] = slot;
 
-	varPktMap[varId] = inPkt;
-}
+	uint8_t *pkt = m_latest.data( slot );
+	uint32_t len = m_latest.length( slot );
 
-void MetaDataMgr::onPrologue( bool UNUSED(capture_last) )
-{
-	DeviceMap::iterator dit, dend = m_devices.end();
-
-	for ( dit = m_devices.begin(); dit != dend; ++dit ) {
+	if ( remap ) {
+		uint32_t *fields = (uint32_t *)
+			( pkt + ADARA::PacketHeader::header_length() );
+		fields[0] = dev;
+	}
 
-		DeviceVariables &dev = dit->second;
-		ADARA::Packet *dev_pkt = dev.m_descriptorPkt.get();
+	switch ( inPkt.base_type() ) {
+		case ADARA::PacketType::MULT_VAR_VALUE_U32_TYPE:
+		case ADARA::PacketType::MULT_VAR_VALUE_DOUBLE_TYPE:
+		case ADARA::PacketType::MULT_VAR_VALUE_STRING_TYPE:
+		case ADARA::PacketType::MULT_VAR_VALUE_U32_ARRAY_TYPE:
+		case ADARA::PacketType::MULT_VAR_VALUE_DOUBLE_ARRAY_TYPE:
+			m_multVars.insert( std::make_pair( dev, varId ) );
+			break;
+		default:
+			break;
+	}
 
-		/* Push out the device descriptor before the variable values */
-		StorageManager::addPrologue( dev_pkt->packet(),
-			dev_pkt->packet_length() );
+	/* Keep the new value out of any prologue written while we add the
+	 * update to the stream; this keeps us from writing it twice in close
+	 * proximity if we start a new file on this update.
+	 *
+	 * Since PV Value Update TimeStamps can be "Old" Relative to
+	 * the Current Run Time (because they haven't changed in a while),
+	 * We Need to "Ignore the Packet TimeStamp" when Writing Them;
+	 * They Need to Just Go into the "Current" Storage Container.
+	 */
+	m_latest.pin( slot );
+	try {
+		StorageManager::addPacket( pkt, len,
+			true /* ignore_pkt_timestamp */ );
+	} catch ( ... ) {
+		m_latest.unpin();
+		throw;
+	}
+	m_latest.unpin();
+}
 
-		VariablePktMap &varPkts = dev.m_variablePkts;
-		VariablePktMap::iterator vit, vend = varPkts.end();
+void MetaDataMgr::reduceMultVariables( void )
+{
+	/* Handle Multiple Variable Value Packets!
+	 * (Extract "Last" Variable Value and Replace with a
+	 * New Single Variable Value Packet for the Prologue...)
+	 */
+	std::set<std::pair<uint32_t, uint32_t> >::iterator mit, mnext;
 
-		for ( vit = varPkts.begin(); vit != vend; ++vit ) {
+	for ( mit = m_multVars.begin(); mit != m_multVars.end(); mit = mnext ) {
 
-			ADARA::Packet *var_pkt = vit->second.get();
+		mnext = mit;
+		++mnext;
 
-			// Handle Multiple Variable Value Packets!
-			// (Extract "Last" Variable Value and Create
-			// New Single Variable Value Packet for Prologue...)
+		DeviceMap::iterator dit = m_devices.find( mit->first );
+		if ( dit == m_devices.end() ) {
+			m_multVars.erase( mit );
+			continue;
+		}
 
-			ADARA::PacketSharedPtr newPkt;
-			bool is_mult = false;
+		VariableSlotMap &varSlots = dit->second.m_variableSlots;
+		VariableSlotMap::iterator vit = varSlots.find( mit->second );
+		if ( vit == varSlots.end() ) {
+			m_multVars.erase( mit );
+			continue;
+		}
 
-			if ( var_pkt->base_type()
-					== ADARA::PacketType::MULT_VAR_VALUE_U32_TYPE )
-			{
-				ADARA::MultVariableU32Pkt mult_var_pkt(
-					var_pkt->packet(), var_pkt->packet_length() );
-				extractLastValue( mult_var_pkt, newPkt );
-				is_mult = true;
-			}
-			else if ( var_pkt->base_type()
-					== ADARA::PacketType::MULT_VAR_VALUE_DOUBLE_TYPE )
-			{
-				ADARA::MultVariableDoublePkt mult_var_pkt(
-					var_pkt->packet(), var_pkt->packet_length() );
-				extractLastValue( mult_var_pkt, newPkt );
-				is_mult = true;
-			}
-			else if ( var_pkt->base_type()
-					== ADARA::PacketType::MULT_VAR_VALUE_STRING_TYPE )
-			{
-				ADARA::MultVariableStringPkt mult_var_pkt(
-					var_pkt->packet(), var_pkt->packet_length() );
-				extractLastValue( mult_var_pkt, newPkt );
-				is_mult = true;
-			}
-			else if ( var_pkt->base_type()
-					== ADARA::PacketType::MULT_VAR_VALUE_U32_ARRAY_TYPE )
-			{
-				ADARA::MultVariableU32ArrayPkt mult_var_pkt(
-					var_pkt->packet(), var_pkt->packet_length() );
-				extractLastValue( mult_var_pkt, newPkt );
-				is_mult = true;
-			}
-			else if ( var_pkt->base_type()
-					== ADARA::PacketType::MULT_VAR_VALUE_DOUBLE_ARRAY_TYPE)
-			{
-				ADARA::MultVariableDoubleArrayPkt mult_var_pkt(
-					var_pkt->packet(), var_pkt->packet_length() );
-				extractLastValue( mult_var_pkt, newPkt );
-				is_mult = true;
-			}
+		/* In the middle of being written, leave it for next time */
+		if ( vit->second == m_latest.pinned() )
+			continue;
 
-			if ( is_mult )
-			{
-				// Replace Multiple Variable Value Packet for
-				// This Device PV with New Single Variable Value Packet
-				vit->second.swap( newPkt );
+		const uint8_t *data = m_latest.data( vit->second );
+		uint32_t len = m_latest.length( vit->second );
+		ADARA::PacketHeader hdr( data );
+		ADARA::PacketSharedPtr newPkt;
 
-				// Use New Packet in Prologue...
-				var_pkt = vit->second.get();
-			}
+		if ( hdr.base_type()
+				== ADARA::PacketType::MULT_VAR_VALUE_U32_TYPE )
+		{
+			ADARA::MultVariableU32Pkt mult_var_pkt( data, len );
+			extractLastValue( mult_var_pkt, newPkt );
+		}
+		else if ( hdr.base_type()
+				== ADARA::PacketType::MULT_VAR_VALUE_DOUBLE_TYPE )
+		{
+			ADARA::MultVariableDoublePkt mult_var_pkt( data, len );
+			extractLastValue( mult_var_pkt, newPkt );
+		}
+		else if ( hdr.base_type()
+				== ADARA::PacketType::MULT_VAR_VALUE_STRING_TYPE )
+		{
+			ADARA::MultVariableStringPkt mult_var_pkt( data, len );
+			extractLastValue( mult_var_pkt, newPkt );
+		}
+		else if ( hdr.base_type()
+				== ADARA::PacketType::MULT_VAR_VALUE_U32_ARRAY_TYPE )
+		{
+			ADARA::MultVariableU32ArrayPkt mult_var_pkt( data, len );
+			extractLastValue( mult_var_pkt, newPkt );
+		}
+		else if ( hdr.base_type()
+				== ADARA::PacketType::MULT_VAR_VALUE_DOUBLE_ARRAY_TYPE )
+		{
+			ADARA::MultVariableDoubleArrayPkt mult_var_pkt( data, len );
+			extractLastValue( mult_var_pkt, newPkt );
+		}
 
-			StorageManager::addPrologue( var_pkt->packet(),
-				var_pkt->packet_length() );
+		// Replace Multiple Variable Value Packet for
+		// This Device PV with New Single Variable Value Packet
+		if ( newPkt ) {
+			vit->second = m_latest.store( vit->second,
+				newPkt->packet(), newPkt->packet_length() );
 		}
+
+		m_multVars.erase( mit );
 	}
 }
 
+void MetaDataMgr::onPrologue( bool UNUSED(capture_last) )
+{
+	reduceMultVariables();
+
+	/* The latest value store is laid out as the prologue already
+	 * (each device descriptor ahead of its variable values), so
+	 * this is normally a single iovec.
+	 */
+	IoVector iovec;
+	m_latest.fillIoVector( iovec );
+
+	if ( !iovec.empty() )
+		StorageManager::addPrologue( iovec );
+}
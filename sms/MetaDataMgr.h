@@ -12,6 +12,7 @@
 
 #include "ADARA.h"
 #include "ADARAPackets.h"
+#include "LatestValueStore.h"
 
 struct timespec;
 
@@ -73,13 +74,18 @@ public:
 			bool do_log, bool &reconnected);
 
 private:
-	typedef std::map<uint32_t, ADARA::PacketSharedPtr> VariablePktMap;
+	/* Latest value of each variable, by variable id, held in m_latest */
+	typedef std::map<uint32_t, LatestValueStore::Handle> VariableSlotMap;
 
 	struct DeviceVariables {
+		DeviceVariables() : m_devId(0), m_srcTag(0),
+			m_descriptorSlot(LatestValueStore::NONE) {}
+
 		uint32_t	m_devId;
 		uint32_t	m_srcTag;
 		ADARA::PacketSharedPtr	m_descriptorPkt;
-		VariablePktMap	m_variablePkts;
+		LatestValueStore::Handle	m_descriptorSlot;
+		VariableSlotMap	m_variableSlots;
 	};
 
 	typedef std::map<uint32_t, DeviceVariables> DeviceMap;
@@ -92,14 +98,29 @@ private:
 	std::set<uint32_t> m_activeDevId;
 	uint32_t m_nextMappedDevId;
 
-	void upstreamDisconnected(VariablePktMap &varPkts);
+	/* Descriptors and latest variable values for active devices, laid
+	 * out as a ready-made prologue.
+	 */
+	LatestValueStore m_latest;
+
+	/* (mapped device, variable) pairs whose latest value is still a
+	 * Multiple Variable Value packet; these get reduced to a single
+	 * value packet at the next prologue.
+	 */
+	std::set<std::pair<uint32_t, uint32_t> > m_multVars;
+
+	void upstreamDisconnected(VariableSlotMap &varSlots);
+	void releaseDevice(DeviceVariables &dev);
 
 	uint32_t lookupMappedDeviceId(uint32_t dev, uint32_t srcTag);
 	uint32_t lookupOldMappedDeviceId(uint32_t dev, uint32_t srcTag,
 			bool &reconnected);
 
 	void updateVariable(uint32_t dev, uint32_t varId,
-			    ADARA::PacketSharedPtr &inPkt, uint32_t srcTag);
+			    const ADARA::Packet &inPkt, uint32_t srcTag,
+			    bool remap);
+
+	void reduceMultVariables(void);
 
 	void onPrologue( bool capture_last );
 };
@@ -0,0 +1,273 @@
+#include <sstream>
+#include <stdexcept>
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "Metrics.h"
+
+bool Metrics::m_enabled = false;
+__thread Metrics::Shard *Metrics::t_shard = NULL;
+
+static pthread_mutex_t metrics_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t metrics_key;
+static pthread_once_t metrics_key_once = PTHREAD_ONCE_INIT;
+
+/* Metrics are registered from static initializers all over smsd, so
+ * build these on first use rather than trusting initialization order.
+ */
+static std::vector<std::string> &counterNames(void)
+{
+	static std::vector<std::string> names;
+	return names;
+}
+
+static std::vector<std::string> &latencyNames(void)
+{
+	static std::vector<std::string> names;
+	return names;
+}
+
+/* Every shard ever handed out; never freed, so the exporter can walk
+ * this without caring which threads are still around.
+ */
+static std::vector<void *> &allShards(void)
+{
+	static std::vector<void *> shards;
+	return shards;
+}
+
+static Metrics::Id registerName(std::vector<std::string> &names,
+		const std::string &name, uint32_t max)
+{
+	pthread_mutex_lock(&metrics_lock);
+
+	Metrics::Id id;
+	for (id = 0; id < names.size(); id++) {
+		if (names[id] == name)
+			break;
+	}
+
+	if (id == names.size()) {
+		if (names.size() >= max) {
+			pthread_mutex_unlock(&metrics_lock);
+			throw std::logic_error("Too many metrics registered: " + name);
+		}
+		names.push_back(name);
+	}
+
+	pthread_mutex_unlock(&metrics_lock);
+
+	return id;
+}
+
+Metrics::Id Metrics::counter(const std::string &name)
+{
+	return registerName(counterNames(), name, MAX_COUNTERS);
+}
+
+Metrics::Id Metrics::latency(const std::string &name)
+{
+	return registerName(latencyNames(), name, MAX_LATENCIES);
+}
+
+void Metrics::makeKey(void)
+{
+	pthread_key_create(&metrics_key, &Metrics::releaseShard);
+}
+
+Metrics::Shard *Metrics::claimShard(void)
+{
+	pthread_once(&metrics_key_once, makeKey);
+
+	pthread_mutex_lock(&metrics_lock);
+
+	std::vector<void *> &shards = allShards();
+
+	/* Pick up where an exited thread left off, if we can */
+	Shard *s = NULL;
+	for (size_t i = 0; i < shards.size(); i++) {
+		Shard *old = (Shard *) shards[i];
+		if (!old->m_inUse) {
+			s = old;
+			break;
+		}
+	}
+
+	if (!s) {
+		s = (Shard *) calloc(1, sizeof(Shard));
+		if (!s) {
+			pthread_mutex_unlock(&metrics_lock);
+			throw std::bad_alloc();
+		}
+		for (uint32_t i = 0; i < MAX_LATENCIES; i++)
+			s->m_latencies[i].m_min = ~0ULL;
+		shards.push_back(s);
+	}
+
+	s->m_inUse = true;
+
+	pthread_mutex_unlock(&metrics_lock);
+
+	pthread_setspecific(metrics_key, s);
+
+	return s;
+}
+
+/* Thread exit */
+void Metrics::releaseShard(void *shard)
+{
+	pthread_mutex_lock(&metrics_lock);
+	((Shard *) shard)->m_inUse = false;
+	pthread_mutex_unlock(&metrics_lock);
+}
+
+uint64_t Metrics::bucketLow(uint32_t idx)
+{
+	if (idx < 2 * SUB_BUCKETS)
+		return idx;
+
+	uint32_t shift = idx / SUB_BUCKETS - 1;
+	return (uint64_t) (SUB_BUCKETS + idx % SUB_BUCKETS) << shift;
+}
+
+uint64_t Metrics::bucketHigh(uint32_t idx)
+{
+	if (idx < 2 * SUB_BUCKETS)
+		return idx;
+
+	uint32_t shift = idx / SUB_BUCKETS - 1;
+	return bucketLow(idx) + (1ULL << shift) - 1;
+}
+
+void Metrics::snapshot(Snapshot &snap)
+{
+	snap.when = now();
+
+	pthread_mutex_lock(&metrics_lock);
+
+	const std::vector<std::string> &counter_names = counterNames();
+	const std::vector<std::string> &latency_names = latencyNames();
+	const std::vector<void *> &shards = allShards();
+
+	snap.counters.clear();
+	for (uint32_t c = 0; c < counter_names.size(); c++) {
+		uint64_t total = 0;
+		for (size_t i = 0; i < shards.size(); i++)
+			total += ((Shard *) shards[i])->m_counters[c];
+		snap.counters.push_back(std::make_pair(counter_names[c], total));
+	}
+
+	snap.latencies.resize(latency_names.size());
+	for (uint32_t l = 0; l < latency_names.size(); l++) {
+		Totals &t = snap.latencies[l];
+		t.name = latency_names[l];
+		t.count = t.sum = t.max = 0;
+		t.min = ~0ULL;
+		t.buckets.assign(NUM_BUCKETS, 0);
+
+		for (size_t i = 0; i < shards.size(); i++) {
+			const Histogram &h = ((Shard *) shards[i])->m_latencies[l];
+			t.count += h.m_count;
+			t.sum += h.m_sum;
+			if (h.m_max > t.max)
+				t.max = h.m_max;
+			if (h.m_min < t.min)
+				t.min = h.m_min;
+			for (uint32_t b = 0; b < NUM_BUCKETS; b++)
+				t.buckets[b] += h.m_buckets[b];
+		}
+	}
+
+	pthread_mutex_unlock(&metrics_lock);
+}
+
+Metrics::LatencyStats Metrics::stats(const Totals &cur, const Totals *prev)
+{
+	LatencyStats st;
+	memset(&st, 0, sizeof(st));
+
+	std::vector<uint64_t> buckets(cur.buckets);
+	st.count = cur.count;
+	uint64_t sum = cur.sum;
+	if (prev && prev->buckets.size() == buckets.size()) {
+		for (uint32_t b = 0; b < buckets.size(); b++)
+			buckets[b] -= prev->buckets[b];
+		st.count -= prev->count;
+		sum -= prev->sum;
+	}
+
+	if (!st.count)
+		return st;
+
+	st.mean = sum / st.count;
+
+	/* Bucket bounds, tightened by the exact extremes where they apply */
+	uint32_t first = 0, last = buckets.size() - 1;
+	while (first < last && !buckets[first])
+		first++;
+	while (last > first && !buckets[last])
+		last--;
+	st.min = bucketLow(first);
+	if (cur.min > st.min && cur.min <= bucketHigh(first))
+		st.min = cur.min;
+	st.max = bucketHigh(last);
+	if (cur.max < st.max && cur.max >= bucketLow(last))
+		st.max = cur.max;
+
+	/* Percentiles are bucket upper bounds (HDR's "highest equivalent
+	 * value"), capped at the max
+	 */
+	uint64_t *pct[4] = { &st.p50, &st.p90, &st.p99, &st.p999 };
+	double frac[4] = { 0.50, 0.90, 0.99, 0.999 };
+	uint64_t seen = 0;
+	uint32_t b = 0;
+	for (uint32_t p = 0; p < 4; p++) {
+		uint64_t want = (uint64_t) (frac[p] * st.count + 0.5);
+		if (want < 1)
+			want = 1;
+		while (b < last && seen + buckets[b] < want)
+			seen += buckets[b++];
+		uint64_t v = bucketHigh(b);
+		*pct[p] = (v > st.max) ? st.max : v;
+	}
+
+	return st;
+}
+
+std::string Metrics::report(const Snapshot &cur, const Snapshot *prev)
+{
+	std::stringstream ss;
+
+	double secs = 0.0;
+	if (prev && cur.when > prev->when)
+		secs = (cur.when - prev->when) / 1e9;
+
+	for (size_t i = 0; i < cur.counters.size(); i++) {
+		ss << "counter " << cur.counters[i].first
+			<< " total=" << cur.counters[i].second;
+		if (secs > 0.0 && i < prev->counters.size()) {
+			ss << " rate=" << (uint64_t) ((cur.counters[i].second
+				- prev->counters[i].second) / secs);
+		}
+		ss << "\n";
+	}
+
+	for (size_t i = 0; i < cur.latencies.size(); i++) {
+		const Totals *p = ( prev && i < prev->latencies.size() )
+			? &prev->latencies[i] : NULL;
+		LatencyStats st = stats(cur.latencies[i], p);
+		ss << "latency_ns " << cur.latencies[i].name
+			<< " count=" << st.count
+			<< " mean=" << st.mean
+			<< " min=" << st.min
+			<< " p50=" << st.p50
+			<< " p90=" << st.p90
+			<< " p99=" << st.p99
+			<< " p999=" << st.p999
+			<< " max=" << st.max << "\n";
+	}
+
+	return ss.str();
+}
@@ -0,0 +1,177 @@
+#ifndef __METRICS_H
+#define __METRICS_H
+
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+#include <time.h>
+
+/* In-process smsd metrics: counters and latency histograms. Off unless
+ * the config turns them on; when off, a Timer or add() is one branch.
+ *
+ * Each thread that records anything gets its own shard of counters and
+ * histograms, so the hot path is a couple of plain adds on memory no
+ * other thread writes; no atomics, no locks. The exporter sums the
+ * shards when it takes a snapshot (reads of aligned 64-bit words, so a
+ * snapshot may be a hair behind, never torn). Shards of exited threads
+ * are kept (their counts still matter) and reused by new threads.
+ *
+ * Latencies go into HDR-style log-linear histograms: 16 linear
+ * sub-buckets per power of two, so any recorded value is reported to
+ * within 1/16 (~6%), from 1 ns up to ~18 minutes, in a fixed 4.7 KB.
+ *
+ * Metrics are registered by name once, up front, and used via the
+ * returned Id; names look like PV name pieces ("Storage:AddPacket"),
+ * as that's what they become when mirrored into PVs.
+ */
+
+class Metrics {
+public:
+	typedef uint32_t Id;
+
+	enum { MAX_COUNTERS = 32, MAX_LATENCIES = 16 };
+
+	enum { SUB_BITS = 4, SUB_BUCKETS = 1 << SUB_BITS,
+		MAX_BITS = 40,
+		NUM_BUCKETS = ( MAX_BITS - SUB_BITS + 1 ) * SUB_BUCKETS };
+
+	/* Register (or look up) a metric by name */
+	static Id counter(const std::string &name);
+	static Id latency(const std::string &name);
+
+	/* Disabled (the default): Timers don't read the clock, nothing
+	 * is recorded.
+	 */
+	static bool enabled(void) { return m_enabled; }
+	static void setEnabled(bool on) { m_enabled = on; }
+
+	/* Monotonic nanoseconds */
+	static inline uint64_t now(void) {
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+	}
+
+	static inline void add(Id id, uint64_t n = 1) {
+		if (m_enabled)
+			shard()->m_counters[id] += n;
+	}
+
+	static inline void record(Id id, uint64_t ns) {
+		if (m_enabled)
+			shard()->m_latencies[id].record(ns);
+	}
+
+	/* Times a scope into a latency histogram */
+	class Timer {
+	public:
+		explicit Timer(Id id) : m_id(id), m_start(m_enabled ? now() : 0) {}
+		~Timer() { stop(); }
+
+		void stop(void) {
+			if (m_start) {
+				record(m_id, now() - m_start);
+				m_start = 0;
+			}
+		}
+
+		/* Didn't happen after all; record nothing */
+		void cancel(void) { m_start = 0; }
+
+	private:
+		Id m_id;
+		uint64_t m_start;
+	};
+
+	static inline uint32_t bucketIndex(uint64_t v) {
+		if (v < 2 * SUB_BUCKETS)
+			return (uint32_t) v;
+		uint32_t msb = 63 - __builtin_clzll(v);
+		if (msb >= MAX_BITS)
+			return NUM_BUCKETS - 1;
+		uint32_t shift = msb - SUB_BITS;
+		return (shift + 1) * SUB_BUCKETS
+			+ (uint32_t) ((v >> shift) & (SUB_BUCKETS - 1));
+	}
+
+	/* Smallest/largest values that land in a bucket */
+	static uint64_t bucketLow(uint32_t idx);
+	static uint64_t bucketHigh(uint32_t idx);
+
+	/* A histogram summed over all threads */
+	struct Totals {
+		std::string name;
+		uint64_t count;
+		uint64_t sum;
+		uint64_t min;
+		uint64_t max;
+		std::vector<uint64_t> buckets;
+	};
+
+	struct Snapshot {
+		Snapshot() : when(0) { }
+
+		uint64_t when;
+		std::vector<std::pair<std::string, uint64_t> > counters;
+		std::vector<Totals> latencies;
+	};
+
+	struct LatencyStats {
+		uint64_t count;
+		uint64_t mean;
+		uint64_t min;
+		uint64_t max;
+		uint64_t p50, p90, p99, p999;
+	};
+
+	static void snapshot(Snapshot &snap);
+
+	/* Stats for what was recorded since prev (or ever, if NULL) */
+	static LatencyStats stats(const Totals &cur, const Totals *prev);
+
+	/* Plain text, one metric per line; counters as totals (plus rates,
+	 * given a previous snapshot), latencies since the previous one.
+	 */
+	static std::string report(const Snapshot &cur, const Snapshot *prev);
+
+private:
+	struct Histogram {
+		uint64_t m_count;
+		uint64_t m_sum;
+		uint64_t m_min;
+		uint64_t m_max;
+		uint64_t m_buckets[NUM_BUCKETS];
+
+		inline void record(uint64_t v) {
+			m_buckets[bucketIndex(v)]++;
+			m_count++;
+			m_sum += v;
+			if (v > m_max)
+				m_max = v;
+			if (v < m_min)
+				m_min = v;
+		}
+	};
+
+	struct Shard {
+		uint64_t m_counters[MAX_COUNTERS];
+		Histogram m_latencies[MAX_LATENCIES];
+		bool m_inUse;
+	};
+
+	static inline Shard *shard(void) {
+		if (__builtin_expect(t_shard == NULL, 0))
+			t_shard = claimShard();
+		return t_shard;
+	}
+
+	static Shard *claimShard(void);
+	static void releaseShard(void *shard);
+	static void makeKey(void);
+
+	static bool m_enabled;
+	static __thread Shard *t_shard;
+};
+
+#endif /* __METRICS_H */
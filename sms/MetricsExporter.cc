@@ -0,0 +1,294 @@
+
+#include "Logging.h"
+
+static LoggerPtr logger(Logger::getLogger("SMS.Metrics"));
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#include <boost/bind.hpp>
+
+#include "ADARAUtils.h"
+#include "EPICS.h"
+#include "SMSControl.h"
+#include "SMSControlPV.h"
+#include "MetricsExporter.h"
+
+RateLimitedLogging::History RLLHistory_MetricsExporter;
+
+// Rate-Limited Logging IDs...
+#define RLL_FILE_CREATE               0
+#define RLL_FILE_WRITE                1
+#define RLL_FILE_RENAME               2
+
+/* A metrics file that can't be written fails every export period, so
+ * after a few, only log every 100th (about every 15 minutes at the
+ * default period) until it clears up.
+ */
+static RateLimitedLogging::Handle rllFileCreate =
+	RateLimitedLogging::registerLog( RLLHistory_MetricsExporter,
+		RLL_FILE_CREATE, "", 600, 3, 100 );
+static RateLimitedLogging::Handle rllFileWrite =
+	RateLimitedLogging::registerLog( RLLHistory_MetricsExporter,
+		RLL_FILE_WRITE, "", 600, 3, 100 );
+static RateLimitedLogging::Handle rllFileRename =
+	RateLimitedLogging::registerLog( RLLHistory_MetricsExporter,
+		RLL_FILE_RENAME, "", 600, 3, 100 );
+
+MetricsExporter *MetricsExporter::m_singleton;
+
+double MetricsExporter::m_period;
+std::string MetricsExporter::m_file;
+std::string MetricsExporter::m_socket;
+bool MetricsExporter::m_pvs;
+
+void MetricsExporter::config(const boost::property_tree::ptree &conf)
+{
+	Metrics::setEnabled(conf.get<bool>("metrics.enabled", false));
+
+	m_period = conf.get<double>("metrics.period", 10.0);
+	if (m_period < 0.1)
+		m_period = 0.1;
+
+	m_file = conf.get<std::string>("metrics.file", "");
+	m_socket = conf.get<std::string>("metrics.socket", "");
+	m_pvs = conf.get<bool>("metrics.pvs", false);
+}
+
+void MetricsExporter::init(void)
+{
+	if (!Metrics::enabled())
+		return;
+
+	m_singleton = new MetricsExporter();
+}
+
+MetricsExporter::MetricsExporter() :
+		m_timer(new TimerAdapter<MetricsExporter>(this,
+			&MetricsExporter::exportMetrics)),
+		m_fdreg(NULL), m_fd(-1)
+{
+	/* Every metric is registered by a static initializer somewhere,
+	 * so by now this has all the names we'll ever see.
+	 */
+	Metrics::snapshot(m_last);
+
+	if (m_pvs) {
+		SMSControl *ctrl = SMSControl::getInstance();
+		if (!ctrl) {
+			throw std::logic_error(
+				"uninitialized SMSControl obj for MetricsExporter!");
+		}
+
+		std::string prefix(ctrl->getPVPrefix());
+		prefix += ":Metrics:";
+
+		for (uint32_t i = 0; i < m_last.latencies.size(); i++) {
+			std::string name(prefix + m_last.latencies[i].name);
+			const char *suffix[3] = { ":P50Us", ":P99Us", ":MaxUs" };
+			for (uint32_t s = 0; s < 3; s++) {
+				boost::shared_ptr<smsUint32PV> pv(
+					new smsUint32PV(name + suffix[s]));
+				m_pvLatencies.push_back(pv);
+				ctrl->addPV(pv);
+			}
+		}
+
+		for (uint32_t i = 0; i < m_last.counters.size(); i++) {
+			boost::shared_ptr<smsUint32PV> pv(new smsUint32PV(
+				prefix + m_last.counters[i].first + ":Rate"));
+			m_pvRates.push_back(pv);
+			ctrl->addPV(pv);
+		}
+	}
+
+	m_report = Metrics::report(m_last, NULL);
+
+	if (!m_socket.empty())
+		setupSocket();
+
+	INFO("Exporting metrics every " << m_period << " seconds"
+		<< (m_file.empty() ? "" : " to ") << m_file
+		<< (m_socket.empty() ? "" : " on socket ") << m_socket
+		<< (m_pvs ? " and in PVs" : ""));
+
+	m_timer->start(m_period);
+}
+
+MetricsExporter::~MetricsExporter()
+{
+	delete m_fdreg;
+
+	if (m_fd >= 0) {
+		close(m_fd);
+		unlink(m_socket.c_str());
+	}
+}
+
+bool MetricsExporter::exportMetrics(void)
+{
+	Metrics::Snapshot cur;
+	Metrics::snapshot(cur);
+
+	m_report = Metrics::report(cur, &m_last);
+
+	if (!m_file.empty())
+		writeFile();
+
+	if (m_pvs)
+		updatePVs(cur);
+
+	m_last.when = cur.when;
+	m_last.counters.swap(cur.counters);
+	m_last.latencies.swap(cur.latencies);
+
+	/* Restart */
+	return true;
+}
+
+void MetricsExporter::writeFile(void)
+{
+	/* Readers always see a whole report */
+	std::string tmp(m_file + ".tmp");
+
+	std::string log_info;
+
+	FILE *f = fopen(tmp.c_str(), "w");
+	if (!f) {
+		int err = errno;
+		if (RateLimitedLogging::checkLog(RLLHistory_MetricsExporter,
+				rllFileCreate, log_info)) {
+			ERROR(log_info << "Unable to create metrics file "
+				<< tmp << ": " << strerror(err));
+		}
+		return;
+	}
+
+	size_t len = fwrite(m_report.data(), 1, m_report.size(), f);
+	if (fclose(f) || len != m_report.size()) {
+		int err = errno;
+		if (RateLimitedLogging::checkLog(RLLHistory_MetricsExporter,
+				rllFileWrite, log_info)) {
+			ERROR(log_info << "Unable to write metrics file "
+				<< tmp << ": " << strerror(err));
+		}
+		unlink(tmp.c_str());
+		return;
+	}
+
+	if (rename(tmp.c_str(), m_file.c_str())) {
+		int err = errno;
+		if (RateLimitedLogging::checkLog(RLLHistory_MetricsExporter,
+				rllFileRename, log_info)) {
+			ERROR(log_info << "Unable to rename metrics file "
+				<< tmp << " to " << m_file << ": "
+				<< strerror(err));
+		}
+		unlink(tmp.c_str());
+	}
+}
+
+void MetricsExporter::updatePVs(const Metrics::Snapshot &cur)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_REALTIME, &now);
+
+	double secs = (cur.when - m_last.when) / 1e9;
+
+	for (uint32_t i = 0; i < cur.latencies.size()
+			&& 3 * i + 2 < m_pvLatencies.size(); i++) {
+		Metrics::LatencyStats st = Metrics::stats(cur.latencies[i],
+			i < m_last.latencies.size() ? &m_last.latencies[i] : NULL);
+		uint64_t us[3] = { st.p50 / 1000, st.p99 / 1000, st.max / 1000 };
+		for (uint32_t s = 0; s < 3; s++) {
+			if (us[s] > INT32_MAX)
+				us[s] = INT32_MAX;
+			m_pvLatencies[3 * i + s]->update(us[s], &now,
+				/* no_log */ true);
+		}
+	}
+
+	for (uint32_t i = 0; i < cur.counters.size()
+			&& i < m_pvRates.size(); i++) {
+		uint64_t rate = 0;
+		if (secs > 0.0 && i < m_last.counters.size()) {
+			rate = (uint64_t) ((cur.counters[i].second
+				- m_last.counters[i].second) / secs);
+		}
+		if (rate > INT32_MAX)
+			rate = INT32_MAX;
+		m_pvRates[i]->update(rate, &now, /* no_log */ true);
+	}
+}
+
+void MetricsExporter::setupSocket(void)
+{
+	SMSControl *ctrl = SMSControl::getInstance();
+
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+
+	if (m_socket.size() >= sizeof(addr.sun_path)) {
+		ERROR("Metrics socket path too long: " << m_socket);
+		return;
+	}
+	strcpy(addr.sun_path, m_socket.c_str());
+
+	m_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (m_fd < 0) {
+		ERROR("Unable to create metrics socket: " << strerror(errno));
+		return;
+	}
+
+	/* Left over from a previous smsd */
+	unlink(m_socket.c_str());
+
+	if (bind(m_fd, (struct sockaddr *) &addr, sizeof(addr))
+			|| listen(m_fd, 8)) {
+		ERROR("Unable to listen on metrics socket " << m_socket
+			<< ": " << strerror(errno));
+		close(m_fd);
+		m_fd = -1;
+		return;
+	}
+
+	try {
+		m_fdreg = new ReadyAdapter(m_fd, fdrRead,
+			boost::bind(&MetricsExporter::newConnection, this),
+			ctrl ? ctrl->verbose() : 0);
+	}
+	catch (std::exception &e) {
+		ERROR("setupSocket(): Exception in Ready Adapter - " << e.what());
+		m_fdreg = NULL;
+		close(m_fd);
+		m_fd = -1;
+	}
+}
+
+void MetricsExporter::newConnection(void)
+{
+	int fd = accept4(m_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+	if (fd < 0) {
+		if (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK) {
+			ERROR("Unable to accept metrics connection: "
+				<< strerror(errno));
+		}
+		return;
+	}
+
+	/* A report is a few KB, well inside an empty socket buffer, so
+	 * this never blocks the main loop; a short write is just dropped.
+	 */
+	ssize_t rc = write(fd, m_report.data(), m_report.size());
+	if (rc != (ssize_t) m_report.size()) {
+		DEBUG("Short write to metrics client: " << rc << " of "
+			<< m_report.size());
+	}
+
+	close(fd);
+}
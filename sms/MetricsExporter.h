@@ -0,0 +1,58 @@
+#ifndef __METRICS_EXPORTER_H
+#define __METRICS_EXPORTER_H
+
+#include <boost/property_tree/ptree.hpp>
+#include <boost/shared_ptr.hpp>
+#include <string>
+#include <vector>
+#include "ReadyAdapter.h"
+#include "TimerAdapter.h"
+#include "Metrics.h"
+
+class smsUint32PV;
+
+/* Periodically snapshots the Metrics registry and publishes it: as a
+ * text report rewritten in place on disk, to anyone connecting to a
+ * local Unix socket (one report per connection), and/or mirrored into
+ * PVs under <prefix>:Metrics.
+ */
+class MetricsExporter {
+public:
+	static void config(const boost::property_tree::ptree &conf);
+	static void init(void);
+
+	MetricsExporter();
+	~MetricsExporter();
+
+private:
+	static MetricsExporter *m_singleton;
+
+	static double m_period;
+	static std::string m_file;
+	static std::string m_socket;
+	static bool m_pvs;
+
+	std::auto_ptr<TimerAdapter<MetricsExporter> > m_timer;
+
+	ReadyAdapter *m_fdreg;
+	int m_fd;
+
+	Metrics::Snapshot m_last;
+	std::string m_report;
+
+	/* Per latency: P50Us, P99Us, MaxUs; per counter: Rate */
+	std::vector<boost::shared_ptr<smsUint32PV> > m_pvLatencies;
+	std::vector<boost::shared_ptr<smsUint32PV> > m_pvRates;
+
+	bool exportMetrics(void);
+
+	void writeFile(void);
+	void updatePVs(const Metrics::Snapshot &cur);
+
+	void setupSocket(void);
+	void newConnection(void);
+
+	friend class TimerAdapter<MetricsExporter>;
+};
+
+#endif /* __METRICS_EXPORTER_H */
@@ -0,0 +1,263 @@
+
+#include "Logging.h"
+
+static LoggerPtr logger(Logger::getLogger("SMS.PulseIndex"));
+
+#include <string>
+
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "PulseIndexWriter.h"
+
+static bool indexWrite(int fd, const void *buf, size_t len)
+{
+	const uint8_t *p = (const uint8_t *) buf;
+	ssize_t rc;
+
+	while (len) {
+		rc = ::write(fd, p, len);
+		if (rc <= 0) {
+			if (rc < 0 && (errno == EAGAIN || errno == EINTR))
+				continue;
+			return false;
+		}
+		p += rc;
+		len -= rc;
+	}
+
+	return true;
+}
+
+PulseIndexWriter::PulseIndexWriter() :
+	m_dirFd(-1), m_fd(-1), m_distance(0), m_entries(0), m_maxPulse(0),
+	m_lastOffset(-1), m_nextHeader(0), m_hdrHave(0)
+{
+}
+
+PulseIndexWriter::~PulseIndexWriter()
+{
+	if (m_fd >= 0)
+		::close(m_fd);
+}
+
+bool PulseIndexWriter::open(int dir_fd, const std::string &data_path,
+		off_t distance)
+{
+	m_dirFd = dir_fd;
+	m_distance = distance;
+	m_path = ADARA::PulseIndex::sidecarPath(data_path);
+
+	m_fd = openat(m_dirFd, m_path.c_str(), O_CREAT|O_TRUNC|O_WRONLY, 0660);
+	if (m_fd < 0) {
+		// *Don't* Throw Exception Here...!
+		// Readers Just Fall Back to Parsing the Data File.
+		int err = errno;
+		ERROR("open(): openat(" << m_path << ") error: "
+			<< strerror(err));
+		m_fd = -1;
+		m_path.clear();
+		return false;
+	}
+
+	ADARA::PulseIndexHeader hdr;
+	memcpy(hdr.magic, ADARA_PULSE_INDEX_MAGIC, sizeof(hdr.magic));
+	hdr.version = ADARA_PULSE_INDEX_VERSION;
+	hdr.entry_size = sizeof(ADARA::PulseIndexEntry);
+
+	if (!indexWrite(m_fd, &hdr, sizeof(hdr))) {
+		abandon("header write error");
+		return false;
+	}
+
+	return true;
+}
+
+/* Pick out the packet headers from len bytes about to be written to the
+ * data file at offset; headers can straddle iovecs (and writes).
+ */
+void PulseIndexWriter::data(off_t offset, const struct iovec *vec,
+		int nvecs, uint32_t len)
+{
+	uint8_t *hdr = (uint8_t *) &m_hdr;
+
+	for ( ; m_fd >= 0 && nvecs && len ; vec++, nvecs--) {
+		const uint8_t *p = (const uint8_t *) vec->iov_base;
+		uint32_t n = (vec->iov_len < len) ? vec->iov_len : len;
+		off_t end = offset + n;
+
+		while (m_fd >= 0) {
+			off_t at = m_nextHeader + m_hdrHave;
+			if (at >= end)
+				break;
+			if (at < offset) {
+				abandon("lost packet framing");
+				break;
+			}
+
+			uint32_t take = sizeof(m_hdr) - m_hdrHave;
+			if (take > end - at)
+				take = end - at;
+			memcpy(hdr + m_hdrHave, p + (at - offset), take);
+			m_hdrHave += take;
+
+			if (m_hdrHave == sizeof(m_hdr)) {
+				packet(m_hdr, m_nextHeader);
+				m_nextHeader += sizeof(m_hdr) + m_hdr.payload_len;
+				m_hdrHave = 0;
+			}
+		}
+
+		offset = end;
+		len -= n;
+	}
+}
+
+/* Walk the headers of len bytes copied into the data file at offset
+ * (by StorageFile::catFile()) straight out of the source file.
+ */
+void PulseIndexWriter::copied(int src_fd, off_t offset, off_t len)
+{
+	ADARA::Header hdr;
+	off_t off = 0;
+
+	if (m_fd < 0)
+		return;
+
+	if (m_nextHeader != offset || m_hdrHave) {
+		abandon("copy not on a packet boundary");
+		return;
+	}
+
+	while (off + (off_t) sizeof(hdr) <= len) {
+		if (pread(src_fd, &hdr, sizeof(hdr), off) != sizeof(hdr)) {
+			abandon("prologue read error");
+			return;
+		}
+		packet(hdr, offset + off);
+		off += sizeof(hdr) + hdr.payload_len;
+	}
+
+	if (off != len) {
+		abandon("partial packet in prologue");
+		return;
+	}
+
+	m_nextHeader = offset + len;
+}
+
+void PulseIndexWriter::packet(const ADARA::Header &hdr, off_t offset)
+{
+	uint32_t base_type = ADARA_BASE_PKT_TYPE(hdr.pkt_format);
+
+	m_typeCounts[base_type]++;
+
+	switch (base_type) {
+		case ADARA::PacketType::RTDL_TYPE:
+		case ADARA::PacketType::BANKED_EVENT_TYPE:
+		case ADARA::PacketType::BANKED_EVENT_STATE_TYPE:
+		case ADARA::PacketType::BEAM_MONITOR_EVENT_TYPE:
+			break;
+		default:
+			return;
+	}
+
+	/* Only a new high pulse id makes an entry, so readers starting
+	 * from an entry never miss a packet for that pulse or later ones.
+	 */
+	uint64_t pulse = ((uint64_t) hdr.ts_sec << 32) | hdr.ts_nsec;
+	if (pulse <= m_maxPulse)
+		return;
+	m_maxPulse = pulse;
+
+	if (m_lastOffset >= 0 && offset - m_lastOffset < m_distance)
+		return;
+
+	struct timespec now;
+	clock_gettime(CLOCK_REALTIME, &now);
+
+	ADARA::PulseIndexEntry e;
+	e.pulse_id = pulse;
+	e.offset = offset;
+	e.wall_sec = now.tv_sec - ADARA::EPICS_EPOCH_OFFSET;
+	e.wall_nsec = now.tv_nsec;
+	m_pending.push_back(e);
+
+	m_lastOffset = offset;
+}
+
+void PulseIndexWriter::flush(void)
+{
+	if (m_fd < 0 || m_pending.empty())
+		return;
+
+	if (!indexWrite(m_fd, &m_pending.front(),
+			m_pending.size() * sizeof(ADARA::PulseIndexEntry))) {
+		abandon("entry write error");
+		return;
+	}
+
+	m_entries += m_pending.size();
+	m_pending.clear();
+}
+
+void PulseIndexWriter::close(void)
+{
+	flush();
+
+	if (m_fd < 0)
+		return;
+
+	std::vector<ADARA::PulseIndexTypeCount> counts;
+	std::map<uint32_t, uint64_t>::iterator it;
+	for (it = m_typeCounts.begin(); it != m_typeCounts.end(); ++it) {
+		ADARA::PulseIndexTypeCount tc;
+		tc.pkt_type = it->first;
+		tc.reserved = 0;
+		tc.count = it->second;
+		counts.push_back(tc);
+	}
+
+	ADARA::PulseIndexFooter ftr;
+	ftr.num_entries = m_entries;
+	ftr.num_types = counts.size();
+	ftr.magic = ADARA_PULSE_INDEX_FOOTER_MAGIC;
+
+	if ((!counts.empty() && !indexWrite(m_fd, &counts.front(),
+				counts.size() * sizeof(ADARA::PulseIndexTypeCount)))
+			|| !indexWrite(m_fd, &ftr, sizeof(ftr))) {
+		abandon("footer write error");
+		return;
+	}
+
+	::close(m_fd);
+	m_fd = -1;
+}
+
+/* Something went wrong; a wrong index is worse than none, so drop it
+ * and leave readers to parse the data file the old way.
+ */
+void PulseIndexWriter::abandon(const std::string &why)
+{
+	ERROR("Dropping Pulse Index " << m_path << ": " << why);
+	remove();
+}
+
+void PulseIndexWriter::remove(void)
+{
+	if (m_fd >= 0) {
+		::close(m_fd);
+		m_fd = -1;
+	}
+
+	if (!m_path.empty()) {
+		unlinkat(m_dirFd, m_path.c_str(), 0);
+		m_path.clear();
+	}
+
+	m_pending.clear();
+}
@@ -0,0 +1,86 @@
+#ifndef __PULSE_INDEX_WRITER_H
+#define __PULSE_INDEX_WRITER_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include "ADARA.h"
+#include "ADARAPulseIndex.h"
+
+/* Writes the pulse index sidecar for one SMS data file (see
+ * ADARAPulseIndex.h for the format) as the data file is written.
+ *
+ * The owner hands over everything bound for the data file, at its file
+ * offset, before writing it: data() for what it writev()s, copied() for
+ * what the kernel copies in from another file. The packet headers are
+ * picked out of that as it goes by, wherever they fall across iovecs.
+ *
+ * Anything going wrong -- a write error on either file, data that isn't
+ * contiguous -- drops the sidecar (a wrong index is worse than none) and
+ * readers fall back to parsing the data file. Nothing here ever fails
+ * the data path.
+ */
+class PulseIndexWriter {
+public:
+	/* Entries are batched up to this many before being written */
+	enum { FLUSH_ENTRIES = 64 };
+
+	PulseIndexWriter();
+	~PulseIndexWriter();
+
+	/* Start the sidecar for data_path (relative to dir_fd), with
+	 * entries at least distance bytes apart; false if it couldn't be
+	 * created, in which case there's no index for this file.
+	 */
+	bool open(int dir_fd, const std::string &data_path, off_t distance);
+
+	/* Still writing an index */
+	bool active(void) const { return m_fd >= 0; }
+
+	/* The sidecar, if there is one (still set once closed out) */
+	const std::string &path(void) const { return m_path; }
+
+	void data(off_t offset, const struct iovec *vec, int nvecs,
+		uint32_t len);
+	void copied(int src_fd, off_t offset, off_t len);
+
+	/* Entries not yet written out */
+	size_t pending(void) const { return m_pending.size(); }
+	void flush(void);
+
+	/* Data file closed out; write the type counts and footer */
+	void close(void);
+
+	void abandon(const std::string &why);
+
+	/* The data file is going away, so the sidecar goes too */
+	void remove(void);
+
+private:
+	int m_dirFd;
+	int m_fd;
+	std::string m_path;
+	off_t m_distance;
+
+	std::vector<ADARA::PulseIndexEntry> m_pending;
+	std::map<uint32_t, uint64_t> m_typeCounts;
+	uint64_t m_entries;
+	uint64_t m_maxPulse;
+	off_t m_lastOffset;
+	off_t m_nextHeader;
+	uint32_t m_hdrHave;
+	ADARA::Header m_hdr;
+
+	void packet(const ADARA::Header &hdr, off_t offset);
+
+	/* Not copyable */
+	PulseIndexWriter(const PulseIndexWriter &);
+	PulseIndexWriter &operator=(const PulseIndexWriter &);
+};
+
+#endif /* __PULSE_INDEX_WRITER_H */
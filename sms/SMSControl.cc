@@ -56,6 +56,30 @@ RateLimitedLogging::History RLLHistory_SMSControl;
 #define RLL_BOGUS_PULSE_ENERGY_ZERO     13
 #define RLL_BOGUS_PULSE_ENERGY_BETA     14
 
+/* Checked per event (or per chopper event), so registered once for
+ * handle-based checks; the source/device/chopper goes in the message.
+ */
+static RateLimitedLogging::Handle rllMissingRtdlProtonCharge =
+	RateLimitedLogging::registerLog( RLLHistory_SMSControl,
+		RLL_MISSING_RTDL_PROTON_CHARGE, "", 2, 10, 100 );
+static RateLimitedLogging::Handle rllUnknownFastMetaPixelId =
+	RateLimitedLogging::registerLog( RLLHistory_SMSControl,
+		RLL_UNKNOWN_FAST_META_PIXEL_ID, "", 2, 10, 5000 );
+static RateLimitedLogging::Handle rllChopperSyncIssue =
+	RateLimitedLogging::registerLog( RLLHistory_SMSControl,
+		RLL_CHOPPER_SYNC_ISSUE, "", 60, 10, 100 );
+static RateLimitedLogging::Handle rllChopperGlitchIssue =
+	RateLimitedLogging::registerLog( RLLHistory_SMSControl,
+		RLL_CHOPPER_GLITCH_ISSUE, "", 60, 10, 100 );
+
+// Per-pulse stage timing; "Complete" is from the first packet seen for
+// a pulse until it's recorded
+static Metrics::Id metricEvents = Metrics::latency("Pulse:Events");
+static Metrics::Id metricRecord = Metrics::latency("Pulse:Record");
+static Metrics::Id metricComplete = Metrics::latency("Pulse:Complete");
+static Metrics::Id metricPulses = Metrics::counter("Pulse:Count");
+static Metrics::Id metricEventCount = Metrics::counter("Pulse:EventCount");
+
 ReadyAdapter *SMSControl::m_fdregChannelAccess = NULL;
 
 uint32_t SMSControl::m_targetStationNumber;
@@ -584,6 +608,8 @@ void SMSControl::addSource(const std::string &name,
 	uint32_t max_pulse_seq_list;
 	uint32_t rtdlNoDataThresh;
 	bool save_input_stream;
+	bool rx_thread;
+	unsigned int rx_queue_size;
 
 	uri = info.find("uri");
 	if (uri == info.not_found()) {
@@ -604,6 +630,19 @@ void SMSControl::addSource(const std::string &name,
 		throw std::runtime_error(msg);
 	}
 
+	rx_thread = info.get<bool>("rx_thread", false);
+
+	val = info.get<std::string>("rx_queue", "64M");
+	try {
+		rx_queue_size = parse_size(val);
+	} catch (std::runtime_error e) {
+		std::string msg("Unable to parse receive queue size for source '");
+		msg += name;
+		msg += "': ";
+		msg += e.what();
+		throw std::runtime_error(msg);
+	}
+
 	required = info.get<bool>("required", false);
 	connect_retry = info.get<double>("connect_retry", 15.0);
 	connect_timeout = info.get<double>("connect_timeout", 5.0);
@@ -697,6 +736,12 @@ void SMSControl::addSource(const std::string &name,
 			<< name << "!");
 	}
 
+	// Let Folks Know this Data Source Gets its Own Receive Thread...
+	if (rx_thread) {
+		DEBUG("Receive Thread Set to True for Data Source "
+			<< name << " (Receive Queue Size " << val << ")");
+	}
+
 	boost::shared_ptr<DataSource> src(new DataSource(name,
 							 enabled,
 							 required,
@@ -715,7 +760,9 @@ void SMSControl::addSource(const std::string &name,
 							 max_pulse_seq_list,
 							 chunk_size,
 							 rtdlNoDataThresh,
-							 save_input_stream));
+							 save_input_stream,
+							 rx_thread,
+							 rx_queue_size));
 	m_dataSources.push_back(src);
 
 	// Add Another DataSource Max Time Entry
@@ -4237,6 +4284,8 @@ void SMSControl::pulseEvents( const ADARA::RawDataPkt &pkt,
 {
 	static uint32_t cnt = 0;
 
+	Metrics::Timer timer(metricEvents);
+
 	PulsePtr &pulse = getPulse(pkt.pulseId(), dup)->second;
 
 	if (!pulse->m_rtdl) {
@@ -4261,13 +4310,21 @@ void SMSControl::pulseEvents( const ADARA::RawDataPkt &pkt,
 		EventSource new_src( pkt.intraPulseTime(), pkt.tofField() );
 		// Note: "Number" of States Includes State 0...
 		new_src.m_numStates = m_numStatesLast;
-		new_src.m_banks_arr_size =
-			new_src.m_numStates * ( m_maxBank + 1 );
-		new_src.m_banks_arr = new EventVector[ new_src.m_banks_arr_size ];
 		SourceMap::value_type val( hwId, new_src );
 		src = pulse->m_pulseSources.insert(val).first;
+		// (Size the Banks In Place, Rather Than Copying Them In...)
+		EventSource &es = src->second;
+		// Reuse Banks from a Previous Pulse If We Have Any...
+		if ( !m_banksPool.empty() ) {
+			es.m_banks.recycle( m_banksPool.back() );
+			m_banksPool.pop_back();
+		}
+		es.m_banks.setBanks( es.m_numStates * ( m_maxBank + 1 ),
+			m_bankReserve );
 	}
 
+	EventSource &es = src->second;
+
 	/* We'll say this time and time again, but we can't use the one
 	 * from the RTDL packet -- that was for the previous pulse.
 	 *
@@ -4292,21 +4349,18 @@ void SMSControl::pulseEvents( const ADARA::RawDataPkt &pkt,
 		// or If the Data Packet Pulse Charge "Changed" (yikes)... ;-D
 		if ( !m_noRTDLPulses && pulse->m_charge != pkt.pulseCharge() ) {
 			// Rate-Limited Log Missing RTDL for Setting Proton Charge...
-			std::stringstream ss;
-			// Just Use Hardware ID for RLL Key...
-			ss << hwId;
 			std::string log_info;
 			if ( RateLimitedLogging::checkLog(
 					RLLHistory_SMSControl,
-					RLL_MISSING_RTDL_PROTON_CHARGE, ss.str(),
-					2, 10, 100, log_info ) ) {
+					rllMissingRtdlProtonCharge, log_info ) ) {
 				ERROR(log_info
 					<< ( m_recording ? "[RECORDING] " : "" )
 					<< "pulseEvents():"
 					<< " Missing RTDL for Setting Proton Charge!"
 					<< " Use Data Packet Proton Charge, If Available..."
 					<< " Data=" << pkt.pulseCharge()
-					<< " id=0x" << std::hex << pulse->m_id.first
+					<< " hwId=0x" << std::hex << hwId
+					<< " id=0x" << pulse->m_id.first
 					<< " dup=0x" << pulse->m_id.second << std::dec);
 			}
 		}
@@ -4471,15 +4525,11 @@ void SMSControl::pulseEvents( const ADARA::RawDataPkt &pkt,
 				}
 				else {
 					// Rate-Limited Log Unknown Fast Meta-Data PixelId...
-					std::stringstream ss;
-					// Just Use Device ID for RLL Key...
 					uint32_t devId = phys >> 16;
-					ss << std::hex << "0x" << devId;
 					std::string log_info;
 					if ( RateLimitedLogging::checkLog(
 							RLLHistory_SMSControl,
-							RLL_UNKNOWN_FAST_META_PIXEL_ID, ss.str(),
-							2, 10, 5000, log_info ) ) {
+							rllUnknownFastMetaPixelId, log_info ) ) {
 						ERROR(log_info
 							<< ( m_recording ? "[RECORDING] " : "" )
 							<< "pulseEvents():"
@@ -4487,8 +4537,9 @@ void SMSControl::pulseEvents( const ADARA::RawDataPkt &pkt,
 							<< ( ( (phys >> 28) == 5 ) ?
 								" Trigger" : " Analog/ADC" )
 							<< " PixelId phys=0x"
-							<< std::hex << phys << std::dec
-							<< " (Device ID " << ss.str() << ")");
+							<< std::hex << phys
+							<< " (Device ID 0x" << devId << ")"
+							<< std::dec);
 					}
 					// Add Generic Fast Meta-Data Device for This PixelId
 					m_fastmeta->addGenericDevice(phys, key);
@@ -4534,27 +4585,21 @@ void SMSControl::pulseEvents( const ADARA::RawDataPkt &pkt,
 			state = 0;
 
 		// Check State Versus Source Max State,
-		// Re-Allocate Banks Array As Needed...
+		// Grow Banks As Needed...
+		// (Bank+State Indices for Existing States Don't Change...)
 		// Note: "Number" of States Includes State 0...
-		if ( state + 1 > src->second.m_numStates ) {
-			uint32_t new_banks_arr_size =
+		if ( state + 1 > es.m_numStates ) {
+			uint32_t new_banks_size =
 				( state + 1 ) * ( m_maxBank + 1 );
 			DEBUG("pulseEvents(): New State Out of Bounds:"
 				<< " state+1=" << ( state + 1 )
-				<< " > src->m_numStates=" << src->second.m_numStates
-				<< " - Re-Allocating Banks Array With"
-				<< " new_banks_arr_size=" << src->second.m_banks_arr_size
-				<< " -> " << new_banks_arr_size);
-			EventVector *new_banks_arr = new EventVector[
-				new_banks_arr_size ];
-			for ( uint32_t i=0 ; i < src->second.m_banks_arr_size ; i++ ) {
-				new_banks_arr[i].swap( src->second.m_banks_arr[i] );
-			}
-			delete[] src->second.m_banks_arr;
-			src->second.m_banks_arr = new_banks_arr;
-			src->second.m_banks_arr_size = new_banks_arr_size;
+				<< " > src->m_numStates=" << es.m_numStates
+				<< " - Growing Banks With"
+				<< " new_banks_size=" << es.m_banks.banks()
+				<< " -> " << new_banks_size);
+			es.m_banks.setBanks( new_banks_size, m_bankReserve );
 			// Note: "Number" of States Includes State 0...
-			src->second.m_numStates = state + 1;
+			es.m_numStates = state + 1;
 
 			// Also Check/Update Overall Last Max State for New Sources...
 			// Note: "Number" of States Includes State 0...
@@ -4573,20 +4618,15 @@ void SMSControl::pulseEvents( const ADARA::RawDataPkt &pkt,
 
 		uint32_t bsindex = bank + ( state * ( m_maxBank + 1 ) );
 
-		EventVector *ev = &(src->second.m_banks_arr[ bsindex ]);
+		translated.pixel = logical;
+		translated.tof = events[i].tof;
 
 		// Increment Bank Count on Each First Bank+State Event...
-		if ( ev->size() == 0 ) {
+		if ( es.m_banks.add( translated, bsindex ) ) {
 			pulse->m_numBanks++;
-			src->second.m_activeBanks++;
-			ev->reserve(m_bankReserve);
+			es.m_activeBanks++;
 		}
 
-		translated.pixel = logical;
-		translated.tof = events[i].tof;
-
-		ev->push_back(translated);
-
 		pulse->m_numEvents++;
 	}
 
@@ -5123,6 +5163,12 @@ void SMSControl::recordPulse(PulsePtr &pulse)
 {
 	static uint32_t cnt = 0;
 
+	Metrics::Timer timer(metricRecord);
+	Metrics::add(metricPulses);
+	Metrics::add(metricEventCount, pulse->m_numEvents);
+	if (pulse->m_created)
+		Metrics::record(metricComplete, Metrics::now() - pulse->m_created);
+
 	/* Send the RTDL packet, followed by the banked event packet */
 
 	// XXX avoid sending the RTDL for a pulse twice (if duplicated)
@@ -5300,6 +5346,20 @@ void SMSControl::buildMonitorPacket(PulsePtr &pulse)
 	StorageManager::addPacket(m_iovec);
 }
 
+void SMSControl::recycleBanks(PulsePtr &pulse)
+{
+	/* The banked event packet is out, so empty each source's banks
+	 * and keep them for the next pulse's sources.
+	 */
+	SourceMap::iterator sIt, sEnd = pulse->m_pulseSources.end();
+	for (sIt = pulse->m_pulseSources.begin(); sIt != sEnd; sIt++) {
+		EventSource &src = sIt->second;
+		src.m_banks.clear();
+		m_banksPool.push_back( EventBanks() );
+		m_banksPool.back().recycle( src.m_banks );
+	}
+}
+
 void SMSControl::buildBankedPacket(PulsePtr &pulse)
 {
 	m_iovec.clear();
@@ -5362,11 +5422,11 @@ void SMSControl::buildBankedPacket(PulsePtr &pulse)
 		m_hdrs.push_back(src.m_tofField);
 		m_hdrs.push_back(src.m_activeBanks);
 
-		for ( uint32_t bi=0 ; bi < src.m_banks_arr_size ; bi++ )
+		for ( uint32_t bi=0 ; bi < src.m_banks.banks() ; bi++ )
 		{
-			EventVector *ev = &(src.m_banks_arr[bi]);
+			EventVector &ev = src.m_banks.bank(bi);
 
-			if ( ev->size() == 0 )
+			if ( ev.size() == 0 )
 				continue;
 
 			iov.iov_base = &m_hdrs.front() + m_hdrs.size();
@@ -5382,10 +5442,10 @@ void SMSControl::buildBankedPacket(PulsePtr &pulse)
 			//       (PixelMap::UNMAPPED_BANK = 0xffff -> 0xffffffff)
 			// All other bank ids will get their real number.
 			m_hdrs.push_back( bank - PixelMap::REAL_BANK_OFFSET );
-			m_hdrs.push_back( ev->size() );
+			m_hdrs.push_back( ev.size() );
 
-			iov.iov_base = &(ev->front());
-			iov.iov_len = ev->size();
+			iov.iov_base = &ev.front();
+			iov.iov_len = ev.size();
 			iov.iov_len *= sizeof(ADARA::Event);
 			m_iovec.push_back(iov);
 		}
@@ -5406,11 +5466,7 @@ void SMSControl::buildBankedPacket(PulsePtr &pulse)
 		m_numStatesLast = 1;
 	}
 
-	// Free Up Allocated Banks Array Storage...
-	for (sIt = pulse->m_pulseSources.begin(); sIt != sEnd; sIt++) {
-		EventSource &src = sIt->second;
-		delete[] src.m_banks_arr;
-	}
+	recycleBanks(pulse);
 }
 
 void SMSControl::buildBankedStatePacket(PulsePtr &pulse)
@@ -5477,11 +5533,11 @@ void SMSControl::buildBankedStatePacket(PulsePtr &pulse)
 		m_hdrs.push_back(src.m_tofField);
 		m_hdrs.push_back(src.m_activeBanks);
 
-		for ( uint32_t bi=0 ; bi < src.m_banks_arr_size ; bi++ )
+		for ( uint32_t bi=0 ; bi < src.m_banks.banks() ; bi++ )
 		{
-			EventVector *ev = &(src.m_banks_arr[bi]);
+			EventVector &ev = src.m_banks.bank(bi);
 
-			if ( ev->size() == 0 )
+			if ( ev.size() == 0 )
 				continue;
 
 			iov.iov_base = &m_hdrs.front() + m_hdrs.size();
@@ -5503,10 +5559,10 @@ void SMSControl::buildBankedStatePacket(PulsePtr &pulse)
 			// All other bank ids will get their real number.
 			m_hdrs.push_back( bank - PixelMap::REAL_BANK_OFFSET );
 			m_hdrs.push_back( state );
-			m_hdrs.push_back( ev->size() );
+			m_hdrs.push_back( ev.size() );
 
-			iov.iov_base = &(ev->front());
-			iov.iov_len = ev->size();
+			iov.iov_base = &ev.front();
+			iov.iov_len = ev.size();
 			iov.iov_len *= sizeof(ADARA::Event);
 			m_iovec.push_back(iov);
 		}
@@ -5529,11 +5585,7 @@ void SMSControl::buildBankedStatePacket(PulsePtr &pulse)
 	else if ( m_numStatesLast == numStates )
 		m_numStatesResetCount = 10;
 
-	// Free Up Allocated Banks Array Storage...
-	for (sIt = pulse->m_pulseSources.begin(); sIt != sEnd; sIt++) {
-		EventSource &src = sIt->second;
-		delete[] src.m_banks_arr;
-	}
+	recycleBanks(pulse);
 }
 
 void SMSControl::buildChopperPackets(PulsePtr &pulse)
@@ -5595,13 +5647,10 @@ void SMSControl::buildChopperPackets(PulsePtr &pulse)
 								&& tof < m_interPulseTimeChopperMax )
 						{
 							/* Rate-limited logging of no RTDL for pulse */
-							std::stringstream ss;
-							ss << cit->first;
 							std::string log_info;
 							if ( RateLimitedLogging::checkLog(
 									RLLHistory_SMSControl,
-									RLL_CHOPPER_SYNC_ISSUE, ss.str(),
-									60, 10, 100, log_info ) ) {
+									rllChopperSyncIssue, log_info ) ) {
 								ERROR(log_info
 									<< ( m_recording
 										? "[RECORDING] " : "" )
@@ -5628,13 +5677,10 @@ void SMSControl::buildChopperPackets(PulsePtr &pulse)
 								&& tof < m_interPulseTimeChopGlitchMax )
 						{
 							/* Rate-limited logging of no RTDL for pulse */
-							std::stringstream ss;
-							ss << cit->first;
 							std::string log_info;
 							if ( RateLimitedLogging::checkLog(
 									RLLHistory_SMSControl,
-									RLL_CHOPPER_GLITCH_ISSUE, ss.str(),
-									60, 10, 100, log_info ) ) {
+									rllChopperGlitchIssue, log_info ) ) {
 								ERROR(log_info
 									<< ( m_recording
 										? "[RECORDING] " : "" )
@@ -21,7 +21,9 @@
 #include "ADARAPackets.h"
 #include "SMSControlPV.h"
 #include "ReadyAdapter.h"
+#include "EventBanks.h"
 #include "Storage.h"
+#include "Metrics.h"
 
 class smsStringPV;
 class smsRunNumberPV;
@@ -793,22 +795,25 @@ private:
 
 	typedef std::pair<uint64_t, uint32_t> PulseIdentifier;
 
+	/* Events are kept per source in one vector per bank+state index
+	 * (see EventBanks), which are recycled between pulses rather than
+	 * freed (see m_banksPool).
+	 */
 	struct EventSource {
 		EventSource( uint32_t intraPulse, uint32_t tofField ) :
 				m_intraPulseTime(intraPulse),
 				m_tofField(tofField),
-				m_activeBanks(0)
+				m_activeBanks(0), m_numStates(0)
 		{ }
 
 		uint32_t			m_intraPulseTime;
 		uint32_t			m_tofField;
 		uint32_t			m_activeBanks;
 
-		EventVector			*m_banks_arr;
+		EventBanks			m_banks;	// per bank+state
 
 		// Note: "Number" of States Includes State 0...
 		uint32_t			m_numStates;
-		uint32_t			m_banks_arr_size; // Will be needed for realloc
 	};
 
 	typedef std::map<uint32_t, EventSource> SourceMap;
@@ -836,7 +841,8 @@ private:
 				m_id(id), m_pending(srcs), m_numEventSources(srcs.count()),
 				m_numEvents(0), m_numBanks(0), m_numMonEvents(0),
 				m_charge(0), m_vetoFlags(0), m_cycle(0),
-				m_ringPeriod(0), m_flags(0)
+				m_ringPeriod(0), m_flags(0),
+				m_created(Metrics::enabled() ? Metrics::now() : 0)
 		{ }
 
 		PulseIdentifier			m_id;
@@ -855,6 +861,7 @@ private:
 		uint32_t				m_cycle;
 		uint32_t				m_ringPeriod;
 		uint32_t				m_flags;
+		uint64_t				m_created;	// Metrics::now()
 	};
 
 	MonitorMap				m_allMonitors;
@@ -945,6 +952,7 @@ private:
 
 	IoVector m_iovec;
 	std::vector<uint32_t> m_hdrs;
+	std::vector<EventBanks> m_banksPool;
 
 	static uint32_t m_targetStationNumber;
 
@@ -1054,6 +1062,7 @@ private:
 	void addChopperEvent(const ADARA::RawDataPkt &pkt, PulsePtr &pulse,
 				uint32_t id, uint32_t tof);
 
+	void recycleBanks(PulsePtr &pulse);
 	void buildBankedPacket(PulsePtr &pulse);
 	void buildBankedStatePacket(PulsePtr &pulse);
 	void buildMonitorPacket(PulsePtr &pulse);
@@ -0,0 +1,78 @@
+#ifndef __SPSC_QUEUE_H
+#define __SPSC_QUEUE_H
+
+#include <boost/noncopyable.hpp>
+#include <stdint.h>
+
+/* Bounded lock-free single-producer/single-consumer ring.
+ *
+ * Exactly one thread may call push() and exactly one (other) thread may
+ * call pop(); neither side ever blocks, they just report full/empty and
+ * leave it to the caller to decide whether to wait, drop or retry. The
+ * producer only writes m_tail and the consumer only writes m_head, so a
+ * full barrier between touching a slot and publishing the index is all
+ * the synchronization needed.
+ *
+ * The indices live on separate cache lines so the two threads don't
+ * bounce a line back and forth on every operation.
+ */
+template <typename T>
+class SPSCQueue : boost::noncopyable {
+public:
+	SPSCQueue(uint32_t capacity) :
+		m_size(capacity + 1), m_ring(new T[capacity + 1]),
+		m_head(0), m_tail(0)
+	{ }
+
+	~SPSCQueue() { delete [] m_ring; }
+
+	uint32_t capacity(void) const { return m_size - 1; }
+
+	/* Producer side; returns false if the queue is full */
+	bool push(const T &val) {
+		uint32_t tail = m_tail;
+		uint32_t next = (tail + 1 == m_size) ? 0 : tail + 1;
+
+		if (next == m_head)
+			return false;
+
+		m_ring[tail] = val;
+		__sync_synchronize();
+		m_tail = next;
+		return true;
+	}
+
+	/* Consumer side; returns false if the queue is empty */
+	bool pop(T &val) {
+		uint32_t head = m_head;
+
+		if (head == m_tail)
+			return false;
+
+		__sync_synchronize();
+		val = m_ring[head];
+		__sync_synchronize();
+		m_head = (head + 1 == m_size) ? 0 : head + 1;
+		return true;
+	}
+
+	/* Approximate when called from the producer side */
+	bool empty(void) const { return m_head == m_tail; }
+
+	uint32_t count(void) const {
+		uint32_t head = m_head, tail = m_tail;
+		return (tail >= head) ? tail - head : m_size - head + tail;
+	}
+
+private:
+	const uint32_t m_size;
+	T *m_ring;
+
+	char m_pad0[64];
+	volatile uint32_t m_head;
+	char m_pad1[64];
+	volatile uint32_t m_tail;
+	char m_pad2[64];
+};
+
+#endif /* __SPSC_QUEUE_H */
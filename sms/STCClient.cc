@@ -8,7 +8,6 @@ static LoggerPtr logger(Logger::getLogger("SMS.STCClient"));
 
 #include <unistd.h>
 #include <errno.h>
-#include <sys/sendfile.h>
 #include <sys/socket.h>
 #include <stdint.h>
 
@@ -372,7 +371,7 @@ void STCClient::writable(void)
 			return;
 		}
 
-		rc = sendfile( m_stc_fd, m_file_fd, &m_cur_offset, len );
+		rc = f->send( m_stc_fd, &m_cur_offset, len );
 		if ( rc < 0 )
 		{
 			if ( errno == EAGAIN || errno == EINTR )
@@ -136,7 +136,7 @@ void StorageContainer::terminateFile(
 		}
 
 		it->m_file->terminate( status );
-		StorageManager::addBaseStorage( it->m_file->size() );
+		StorageManager::addBaseStorage( it->m_file->diskSize() );
 		it->m_file.reset();
 	}
 
@@ -836,7 +836,7 @@ void StorageContainer::getPauseModeByTime(
 					}
 
 					it->m_file->terminate( status );
-					StorageManager::addBaseStorage( it->m_file->size() );
+					StorageManager::addBaseStorage( it->m_file->diskSize() );
 					it->m_file.reset();
 				}
 
@@ -1192,7 +1192,7 @@ void StorageContainer::terminate(void)
 			}
 
 			it->m_file->terminate( status );
-			StorageManager::addBaseStorage( it->m_file->size() );
+			StorageManager::addBaseStorage( it->m_file->diskSize() );
 			it->m_file.reset();
 		}
 
@@ -1285,7 +1285,7 @@ void StorageContainer::terminate(void)
 			}
 
 			it->m_file->terminate( status );
-			StorageManager::addBaseStorage( it->m_file->size() );
+			StorageManager::addBaseStorage( it->m_file->diskSize() );
 			it->m_file.reset();
 		}
 
@@ -1312,7 +1312,7 @@ void StorageContainer::terminate(void)
 				<< " for Data Source ID " << i);
 
 			m_ds_input_files[i]->terminateSave();
-			StorageManager::addBaseStorage( m_ds_input_files[i]->size() );
+			StorageManager::addBaseStorage( m_ds_input_files[i]->diskSize() );
 			m_ds_input_files[i].reset();
 		}
 	}
@@ -1360,7 +1360,7 @@ bool StorageContainer::save(IoVector &iovec, uint32_t len,
 		// for this Data Source...
 		m_ds_input_files[dataSourceId]->terminateSave();
 		StorageManager::addBaseStorage(
-			m_ds_input_files[dataSourceId]->size());
+			m_ds_input_files[dataSourceId]->diskSize());
 		m_ds_input_files[dataSourceId].reset();
 	}
 
@@ -1938,7 +1938,7 @@ uint64_t StorageContainer::blocks(void) const
 
 	end = m_files.end();
 	for (total = 0, it = m_files.begin(); it != end; ++it) {
-		blocks = (*it)->size() + StorageManager::m_block_size - 1;
+		blocks = (*it)->diskSize() + StorageManager::m_block_size - 1;
 		blocks /= StorageManager::m_block_size;
 		total += blocks;
 	}
@@ -2272,6 +2272,25 @@ StorageContainer::SharedPtr StorageContainer::scan(const std::string &path,
 			continue;
 		}
 
+		/* Pulse index sidecars go along with their data files */
+		if (file.extension() == ".pidx")
+			continue;
+
+		/* A compressed copy left half-written by a crash (see
+		 * StorageFile::compressFile()); the data file is still whole.
+		 * Anything newer is being written right now, so leave it be.
+		 */
+		if (file.extension() == ".ztmp") {
+			boost::system::error_code ec;
+			time_t mtime = fs::last_write_time(it->path(), ec);
+			if (!ec && mtime < start.tv_sec) {
+				WARN("scan(): Removing stale compressed copy '"
+					<< it->path() << "'");
+				remove(it->path(), ec);
+			}
+			continue;
+		}
+
 		if (file.extension() != ".adara") {
 			WARN("scan(): Ignoring non-ADARA file '" << it->path() << "'");
 			continue;
@@ -2410,6 +2429,10 @@ uint64_t StorageContainer::purge(const std::string &path, uint64_t goal,
 		try {
 			size = fs::file_size(*fit);
 			remove(*fit);
+			remove(fs::path(
+				ADARA::PulseIndex::sidecarPath(fit->string())));
+			// (And Any Compressed Copy Left Half-Written...)
+			remove(fs::path(fit->string() + ".ztmp"));
 
 			size += StorageManager::m_block_size - 1;
 			size /= StorageManager::m_block_size;
@@ -12,18 +12,30 @@ static LoggerPtr logger(Logger::getLogger("SMS.StorageFile"));
 #include <errno.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
+#include <sys/prctl.h>
+#include <linux/fs.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <limits.h>
 
 #include <boost/lexical_cast.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/bind.hpp>
 
 #include "ADARA.h"
 #include "StorageFile.h"
 #include "StorageContainer.h"
 #include "StorageManager.h"
 #include "SMSControl.h"
+#ifdef HAVE_LZ4
+#include "CompressedFile.h"
+#endif
+#include "PulseIndexWriter.h"
+#include "EventFd.h"
+#include "Metrics.h"
 #include "utils.h"
 
 namespace fs = boost::filesystem;
@@ -54,6 +66,35 @@ struct run_status_packet {
 
 off_t StorageFile::m_max_sync_distance = 16 * 1024 * 1024;
 off_t StorageFile::m_max_file_size = 200 * 1024 * 1024;
+off_t StorageFile::m_index_distance = 64 * 1024;
+bool StorageFile::m_index_enabled = true;
+bool StorageFile::m_compress = false;
+#ifdef HAVE_LZ4
+uint32_t StorageFile::m_compress_frame = CompressedFile::MAX_FRAME_SIZE;
+#else
+uint32_t StorageFile::m_compress_frame = 0;
+#endif
+
+/* A closed out data file waiting for the compressor thread; "cancelled"
+ * (under m_compressLock) once the file is deleted, so the compressed
+ * copy doesn't bring it back.
+ */
+struct StorageFile::CompressJob {
+	std::string path;
+	bool cancelled;
+};
+
+boost::thread StorageFile::m_compressThread;
+boost::mutex StorageFile::m_compressLock;
+boost::condition_variable StorageFile::m_compressCond;
+std::list<boost::shared_ptr<StorageFile::CompressJob> >
+	StorageFile::m_compressQueue;
+volatile bool StorageFile::m_compressStop;
+EventFd *StorageFile::m_compressDone;
+
+static Metrics::Id metricCompress = Metrics::latency("Storage:Compress");
+static Metrics::Id metricCompressSaved =
+	Metrics::counter("Storage:CompressSaved");
 
 void StorageFile::config(const boost::property_tree::ptree &conf)
 {
@@ -80,6 +121,55 @@ void StorageFile::config(const boost::property_tree::ptree &conf)
 			throw std::runtime_error("StorageFile::" + msg);
 		}
 	}
+
+	m_index_enabled = conf.get<bool>("storage.pulseindex", true);
+
+	val = conf.get<std::string>("storage.indexdist", "");
+	if (val.length()) {
+		try {
+			m_index_distance = parse_size(val);
+		} catch (std::runtime_error e) {
+			std::string msg(
+				"config(): Unable to parse pulse index distance: ");
+			msg += e.what();
+			ERROR(msg);
+			throw std::runtime_error("StorageFile::" + msg);
+		}
+	}
+
+	m_compress = conf.get<bool>("storage.compress", false);
+
+#ifndef HAVE_LZ4
+	if (m_compress) {
+		std::string msg("config(): Data file compression requested, ");
+		msg += "but this SMS was built without LZ4";
+		ERROR(msg);
+		throw std::runtime_error("StorageFile::" + msg);
+	}
+#else
+	val = conf.get<std::string>("storage.compressframe", "");
+	if (val.length()) {
+		uint64_t frame;
+		try {
+			frame = parse_size(val);
+		} catch (std::runtime_error e) {
+			std::string msg("config(): ");
+			msg += "Unable to parse compression frame size: ";
+			msg += e.what();
+			ERROR(msg);
+			throw std::runtime_error("StorageFile::" + msg);
+		}
+		if (frame < CompressedFile::MIN_FRAME_SIZE
+				|| frame > CompressedFile::MAX_FRAME_SIZE) {
+			std::string msg("config(): Compression frame size ");
+			msg += val;
+			msg += " out of range (1M-4M)";
+			ERROR(msg);
+			throw std::runtime_error("StorageFile::" + msg);
+		}
+		m_compress_frame = frame;
+	}
+#endif
 }
 
 StorageFile::~StorageFile()
@@ -87,8 +177,18 @@ StorageFile::~StorageFile()
 	//assert(!m_fd_refs);
 	//assert(m_fd == -1);
 
-	if (!m_persist)
+#ifdef HAVE_LZ4
+	delete m_reader;
+#endif
+
+	if (!m_persist) {
+		if (m_compressJob) {
+			boost::lock_guard<boost::mutex> lock(m_compressLock);
+			m_compressJob->cancelled = true;
+		}
 		unlink(m_path.c_str());
+		m_index.remove();
+	}
 }
 
 int StorageFile::get_fd(void)
@@ -118,6 +218,11 @@ void StorageFile::put_fd(void)
 			::close(m_fd);
 			m_fd = -1;
 		}
+#ifdef HAVE_LZ4
+		delete m_reader;
+		m_reader = NULL;
+#endif
+		std::vector<char>().swap(m_sendBuf);
 	}
 }
 
@@ -190,6 +295,26 @@ void StorageFile::open(int flags)
 		DEBUG("New File Descriptor m_fd=" << m_fd);
 	}
 
+#ifdef HAVE_LZ4
+	/* Closed out files may have been compressed since we last looked */
+	if ((flags & O_ACCMODE) == O_RDONLY && CompressedFile::detect(m_fd)) {
+		std::string err;
+		m_reader = new CompressedFile();
+		if (!m_reader->open(m_fd, err)) {
+			delete m_reader;
+			m_reader = NULL;
+			::close(m_fd);
+			m_fd = -1;
+			std::string msg("open(): ");
+			msg += m_path;
+			msg += " compressed file error: ";
+			msg += err;
+			ERROR(msg);
+			throw std::runtime_error("StorageFile::" + msg);
+		}
+	}
+#endif
+
 	m_fdRefs = 1;
 }
 
@@ -214,6 +339,11 @@ void StorageFile::addSync(void)
 	sync.hdr.ts_nsec = now.tv_nsec;
 	sync.offset = m_size;
 
+	if (m_index.active()) {
+		struct iovec vec = { &sync, sizeof(sync) };
+		m_index.data(m_size, &vec, 1, sizeof(sync));
+	}
+
 	for (len = sizeof(sync); len; len -= rc) {
 
 		// Check File Descriptor...
@@ -256,6 +386,9 @@ void StorageFile::addSync(void)
 		p += rc;
 	}
 
+	if (len && m_index.active())
+		m_index.abandon("sync packet write error");
+
 	/* We want to try to keep sync packets as close to a multiple of
 	 * the desired distance as possible.
 	 */
@@ -406,6 +539,11 @@ bool StorageFile::write(IoVector &iovec, uint32_t len, bool do_notify,
 	if ( written )
 		*written = 0;
 
+	// Note the Packet Headers for the Pulse Index Before writev()
+	// Walks the IoVector...
+	if ( m_index.active() && len )
+		m_index.data( m_size, &iovec.front(), iovec.size(), len );
+
 	// On Non-Partial Write Errors, We _Retry_ the Write Twice to Be Sure!
 	do
 	{
@@ -499,6 +637,10 @@ bool StorageFile::write(IoVector &iovec, uint32_t len, bool do_notify,
 	}
 	while ( ret == false && !partial && ++retry_count < 3 );
 
+	// The Index Already Counted This Data, So It's Out of Step Now...
+	if ( !ret && m_index.active() )
+		m_index.abandon("data file write error");
+
 	/* We want the final run status to be the last packet in the file,
 	 * so don't add a sync packet if we're no longer active.
 	 */
@@ -514,6 +656,9 @@ bool StorageFile::write(IoVector &iovec, uint32_t len, bool do_notify,
 	if ( do_notify )
 		notify();
 
+	if ( m_index.pending() >= PulseIndexWriter::FLUSH_ENTRIES )
+		m_index.flush();
+
 	// DEBUG("StorageFile::write() exit");
 
 	return( ret );
@@ -545,8 +690,13 @@ void StorageFile::terminate(ADARA::RunStatus::Enum status)
 	m_active = false;
 
 	addRunStatus(status);
+	m_index.close();
+	m_diskSize = m_size;
 	m_update(*this);
 	put_fd();
+
+	if (m_compressOnClose)
+		queueCompress();
 }
 
 bool StorageFile::save(IoVector &iovec, uint32_t len, uint32_t *written)
@@ -668,6 +818,7 @@ bool StorageFile::save(IoVector &iovec, uint32_t len, uint32_t *written)
 void StorageFile::terminateSave(void)
 {
 	m_active = false;
+	m_diskSize = m_size;
 
 	put_fd();
 }
@@ -682,8 +833,9 @@ StorageFile::StorageFile(OwnerPtr &owner, bool paused,
 	m_startTime(0), // Wallclock Time...!
 	m_persist(true), m_oversize(false),
 	m_active(false), m_paused(paused), m_addendum(false),
-	m_size(0), m_sizeLastUpdate(0), m_syncDistance(0),
-	m_fd(-1), m_fdRefs(0)
+	m_size(0), m_diskSize(0), m_sizeLastUpdate(0), m_syncDistance(0),
+	m_fd(-1), m_fdRefs(0),
+	m_compressOnClose(false), m_reader(NULL)
 {
 	StorageContainer::SharedPtr c = m_owner.lock();
 	if (c) {
@@ -707,6 +859,12 @@ StorageFile::SharedPtr StorageFile::newFile(OwnerPtr owner,
 	f->makePath( status == ADARA::RunStatus::PROLOGUE );
 	f->open(O_CREAT|O_EXCL|O_RDWR);
 	if ( status != ADARA::RunStatus::PROLOGUE ) {
+		// (Prologues get copied into each data file, so leave them be)
+		f->m_compressOnClose = m_compress;
+		if ( m_index_enabled ) {
+			f->m_index.open( StorageManager::base_fd(), f->m_path,
+				m_index_distance );
+		}
 		f->addSync();
 		f->addRunStatus(status);
 	}
@@ -994,6 +1152,14 @@ StorageFile::SharedPtr StorageFile::importFile(OwnerPtr owner,
 		ERROR(msg);
 	}
 
+	// A Compressed File's Size is that of the Original Stream...
+	// (But It's the Size on Disk that Counts Against Storage)
+	uint64_t size = statbuf.st_size;
+#ifdef HAVE_LZ4
+	if ( f->m_reader )
+		size = f->m_reader->size();
+#endif
+
 	f->put_fd();
 
 	// Don't Throw An Exception Just Trying to Stat Some Old Data File...!
@@ -1001,7 +1167,8 @@ StorageFile::SharedPtr StorageFile::importFile(OwnerPtr owner,
 		return StorageFile::SharedPtr();
 	}
 
-	f->m_size = statbuf.st_size;
+	f->m_size = size;
+	f->m_diskSize = statbuf.st_size;
 
 	return f;
 }
@@ -1031,6 +1198,73 @@ uint64_t StorageFile::fileSize(const std::string &path)
 	return( file_size );
 }
 
+/* Copy len bytes from the start of src_fd to the current offset of
+ * dst_fd without bringing the data through user space: share the
+ * extents outright (FICLONERANGE) when the filesystem can and the
+ * destination offset is block aligned, else copy_file_range(), else
+ * sendfile(). The destination offset is advanced by the amount copied
+ * and the source offset is left alone; whatever wasn't copied (all of
+ * it, on kernels/filesystems that support none of these) is left for
+ * the caller's read()/write() loop.
+ */
+static off_t kernelCopy(int src_fd, int dst_fd, off_t len,
+		const char *&method)
+{
+	off_t copied = 0;
+	ssize_t rc;
+
+	method = "read/write";
+
+	if (len <= 0)
+		return 0;
+
+#ifdef FICLONERANGE
+	struct stat st;
+	off_t dst_off = lseek(dst_fd, 0, SEEK_CUR);
+	if (dst_off >= 0 && !fstat(dst_fd, &st) && st.st_blksize
+			&& !(dst_off % st.st_blksize)) {
+		struct file_clone_range fcr;
+		fcr.src_fd = src_fd;
+		fcr.src_offset = 0;
+		fcr.src_length = len;
+		fcr.dest_offset = dst_off;
+		if (!ioctl(dst_fd, FICLONERANGE, &fcr)
+				&& lseek(dst_fd, dst_off + len, SEEK_SET) >= 0) {
+			method = "reflink";
+			return len;
+		}
+	}
+#endif
+
+#ifdef __NR_copy_file_range
+	loff_t src_off = 0;
+	while (copied < len) {
+		rc = syscall(__NR_copy_file_range, src_fd, &src_off,
+			dst_fd, NULL, (size_t) (len - copied), 0);
+		if (rc < 0 && (errno == EINTR || errno == EAGAIN))
+			continue;
+		if (rc <= 0)
+			break;
+		copied += rc;
+		method = "copy_file_range";
+	}
+#endif
+
+	off_t off = copied;
+	while (copied < len) {
+		rc = sendfile(dst_fd, src_fd, &off, (size_t) (len - copied));
+		if (rc < 0 && (errno == EINTR || errno == EAGAIN))
+			continue;
+		if (rc <= 0)
+			break;
+		copied += rc;
+		if (copied == rc)
+			method = "sendfile";
+	}
+
+	return copied;
+}
+
 bool StorageFile::catFile(StorageFile::SharedPtr src)
 {
 	SMSControl *ctrl = SMSControl::getInstance();
@@ -1038,11 +1272,14 @@ bool StorageFile::catFile(StorageFile::SharedPtr src)
 	char buf[1024];
 	uint8_t *p;
 
-	int total, nbytes, len, rc;
+	off_t total;
+	int nbytes, len, rc;
 	int src_fd;
 
 	bool ret = true;
 
+	off_t start = m_size;
+
 	// Make Sure We Got A Real Source File... ;-D
 	if ( !src ) {
 		ERROR("catFile():"
@@ -1062,10 +1299,38 @@ bool StorageFile::catFile(StorageFile::SharedPtr src)
 		return( false );
 	}
 
+	// Let the Kernel Do the Copy If It Can (Prologues Can Be Many MB,
+	// and This Runs on the Main Event Loop at Every Rollover)...
+
+	const char *method = "read/write";
+	off_t copied = 0;
+
+	struct stat src_stat;
+	if ( src_fd >= 0 && m_fd >= 0 && !fstat( src_fd, &src_stat ) ) {
+		copied = kernelCopy( src_fd, m_fd, src_stat.st_size, method );
+		m_syncDistance += copied;
+		m_size += copied;
+	}
+
 	// Repeatedly Read A Buffer from Source File
 	// And Concatenate the Buffer to This File...
+	// (Picking Up After Anything the Kernel Copied, Through to EOF)
 
-	total = 0;
+	if ( src_fd >= 0
+			&& ::lseek( src_fd, copied, SEEK_SET ) == (off_t) -1 ) {
+		int e = errno;
+		ERROR("catFile():"
+			<< " [" << m_path << "]"
+			<< " Unable to Seek Source File "
+			<< src->m_path << " src_fd=" << src_fd << " - "
+			<< strerror(e));
+		if ( m_index.active() )
+			m_index.abandon("prologue copy error");
+		src->put_fd();
+		return( false );
+	}
+
+	total = copied;
 
 	while ( ret == true ) {
 
@@ -1099,6 +1364,8 @@ bool StorageFile::catFile(StorageFile::SharedPtr src)
 					src->put_fd();
 					src_fd = -1;
 				}
+				if ( m_index.active() )
+					m_index.abandon("prologue copy error");
 				return( false );
 			}
 			nbytes = 0;
@@ -1182,7 +1449,16 @@ bool StorageFile::catFile(StorageFile::SharedPtr src)
 	DEBUG("catFile():"
 		<< " [" << m_path << "]"
 		<< " Copied " << total << " Bytes"
-		<< " from Source File " << src->m_path);
+		<< " from Source File " << src->m_path
+		<< " (" << copied << " via " << method << ")");
+
+	// Count the Copied Packets in the Pulse Index...
+	if ( m_index.active() ) {
+		if ( ret && src_fd >= 0 )
+			m_index.copied( src_fd, start, m_size - start );
+		else
+			m_index.abandon("prologue copy error");
+	}
 
 	// Close Source File...
 	if ( src_fd >= 0 ) {
@@ -1193,3 +1469,267 @@ bool StorageFile::catFile(StorageFile::SharedPtr src)
 	return( ret );
 }
 
+
+ssize_t StorageFile::read(void *buf, size_t len, off_t offset)
+{
+#ifndef HAVE_LZ4
+	return ::pread(m_fd, buf, len, offset);
+#else
+	if (!m_reader)
+		return ::pread(m_fd, buf, len, offset);
+
+	ssize_t rc = m_reader->pread(buf, len, offset);
+	if (rc < 0 && errno == EIO) {
+		ERROR("read(): " << m_path << " at offset " << offset
+			<< ": " << m_reader->error());
+		errno = EIO;
+	}
+
+	return rc;
+#endif
+}
+
+/* Straight from the page cache when we can. A compressed file has to
+ * come up through a buffer, but the reader keeps the last frame around,
+ * so short writes to a busy socket just mean another copy, not another
+ * decompression.
+ */
+ssize_t StorageFile::send(int out_fd, off_t *offset, size_t len)
+{
+	if (!m_reader)
+		return sendfile(out_fd, m_fd, offset, len);
+
+	if (!len)
+		return 0;
+
+	if (m_sendBuf.size() < len)
+		m_sendBuf.resize(len);
+
+	ssize_t rc = read(&m_sendBuf[0], len, *offset);
+	if (rc <= 0)
+		return rc;
+
+	rc = ::write(out_fd, &m_sendBuf[0], rc);
+	if (rc > 0)
+		*offset += rc;
+
+	return rc;
+}
+
+void StorageFile::startCompressor(void)
+{
+	if (!m_compress)
+		return;
+
+	/* Blocks saved by each compressed file come back through here,
+	 * to come off the storage pool's usage.
+	 */
+	m_compressDone = new EventFd(
+		boost::bind( &StorageFile::compressCompleted ) );
+
+	m_compressStop = false;
+
+	boost::thread t(compressor);
+	m_compressThread.swap(t);
+
+	INFO("Compressing closed data files in "
+		<< m_compress_frame << " byte frames");
+}
+
+void StorageFile::stopCompressor(void)
+{
+	if (!m_compressDone)
+		return;
+
+	size_t left;
+	{
+		boost::lock_guard<boost::mutex> lock(m_compressLock);
+		m_compressStop = true;
+		left = m_compressQueue.size();
+		m_compressQueue.clear();
+		m_compressCond.notify_all();
+	}
+
+	m_compressThread.join();
+
+	/* They're perfectly readable as they are */
+	if (left) {
+		INFO("Leaving " << left
+			<< " closed data files uncompressed at shutdown");
+	}
+
+	delete m_compressDone;
+	m_compressDone = NULL;
+}
+
+void StorageFile::queueCompress(void)
+{
+	/* Not running (yet, or any more), or already queued */
+	if (!m_compressDone || m_compressJob)
+		return;
+
+	m_compressJob.reset(new CompressJob);
+	m_compressJob->path = m_path;
+	m_compressJob->cancelled = false;
+
+	boost::lock_guard<boost::mutex> lock(m_compressLock);
+	m_compressQueue.push_back(m_compressJob);
+	m_compressCond.notify_one();
+}
+
+void StorageFile::compressor(void)
+{
+	prctl( PR_SET_NAME, "sms-compress", 0, 0, 0 );
+
+	for (;;) {
+		boost::shared_ptr<CompressJob> job;
+		{
+			boost::unique_lock<boost::mutex> lock(m_compressLock);
+			while (m_compressQueue.empty() && !m_compressStop)
+				m_compressCond.wait(lock);
+			if (m_compressStop)
+				return;
+			job = m_compressQueue.front();
+			m_compressQueue.pop_front();
+		}
+
+		uint64_t saved = compressFile(job);
+		if (saved && !m_compressDone->signal(saved)) {
+			ERROR("compressor(): Error Signaling Compression Done"
+				<< " with " << saved << " Blocks Saved");
+		}
+	}
+}
+
+#ifdef HAVE_LZ4
+/* Runs on the compressor thread: write the compressed copy alongside,
+ * then rename it over the original. Readers with the original open
+ * keep reading it; the next open() finds the compressed one. Returns
+ * the number of blocks freed up.
+ */
+uint64_t StorageFile::compressFile(boost::shared_ptr<CompressJob> job)
+{
+	int base_fd = StorageManager::base_fd();
+	std::string tmp(job->path + ".ztmp");
+
+	/* Only files actually compressed count towards the timings */
+	Metrics::Timer timer(metricCompress);
+
+	int in_fd = openat(base_fd, job->path.c_str(), O_RDONLY);
+	if (in_fd < 0) {
+		/* Purged already?! Nothing to do then... */
+		int e = errno;
+		if (e != ENOENT) {
+			ERROR("compressFile(): Unable to Open " << job->path
+				<< " - " << strerror(e));
+		}
+		timer.cancel();
+		return 0;
+	}
+
+	struct stat st;
+	if (fstat(in_fd, &st) || !st.st_size || CompressedFile::detect(in_fd)) {
+		::close(in_fd);
+		timer.cancel();
+		return 0;
+	}
+
+	int out_fd = openat(base_fd, tmp.c_str(),
+		O_CREAT|O_TRUNC|O_WRONLY, 0660);
+	if (out_fd < 0) {
+		int e = errno;
+		ERROR("compressFile(): Unable to Create " << tmp
+			<< " - " << strerror(e));
+		::close(in_fd);
+		timer.cancel();
+		return 0;
+	}
+
+	uint64_t packed = 0;
+	std::string err;
+	bool ok = CompressedFile::compress(in_fd, out_fd, m_compress_frame,
+		packed, err, &m_compressStop);
+
+	/* The rename must not land before the data does */
+	if (ok && fdatasync(out_fd)) {
+		err = "fdatasync(): ";
+		err += strerror(errno);
+		ok = false;
+	}
+	::close(out_fd);
+
+	bool replaced = false;
+
+	if (!ok) {
+		if (!m_compressStop) {
+			ERROR("compressFile(): Unable to Compress " << job->path
+				<< " - " << err);
+		}
+	}
+	else if (packed >= (uint64_t) st.st_size) {
+		DEBUG("compressFile(): Leaving " << job->path
+			<< " Uncompressed (" << packed << " >= "
+			<< st.st_size << " Bytes)");
+	}
+	else {
+		boost::lock_guard<boost::mutex> lock(m_compressLock);
+
+		/* Deleted or purged out from under us? */
+		struct stat now;
+		if (!job->cancelled && !fstat(in_fd, &now) && now.st_nlink) {
+			if (renameat(base_fd, tmp.c_str(),
+					base_fd, job->path.c_str())) {
+				int e = errno;
+				ERROR("compressFile(): Unable to Rename " << tmp
+					<< " to " << job->path
+					<< " - " << strerror(e));
+			}
+			else
+				replaced = true;
+		}
+	}
+
+	if (!replaced)
+		unlinkat(base_fd, tmp.c_str(), 0);
+
+	::close(in_fd);
+
+	if (!replaced) {
+		timer.cancel();
+		return 0;
+	}
+
+	timer.stop();
+
+	uint64_t bs = StorageManager::m_block_size;
+	uint64_t saved = (st.st_size + bs - 1) / bs - (packed + bs - 1) / bs;
+
+	Metrics::add(metricCompressSaved, st.st_size - packed);
+
+	DEBUG("compressFile(): Compressed " << job->path
+		<< " from " << st.st_size << " to " << packed << " Bytes ("
+		<< ( packed * 100 / st.st_size ) << "%), "
+		<< saved << " Blocks Saved");
+
+	return saved;
+}
+#else
+/* Never queued; config() won't turn compression on without LZ4 */
+uint64_t StorageFile::compressFile(boost::shared_ptr<CompressJob>)
+{
+	return 0;
+}
+#endif
+
+void StorageFile::compressCompleted(void)
+{
+	uint64_t saved = 0;
+
+	if (!m_compressDone->read(saved)) {
+		ERROR("compressCompleted():"
+			<< " Error Reading Compression Done Event!");
+		return;
+	}
+
+	StorageManager::releaseBaseStorage(saved);
+}
@@ -5,13 +5,21 @@
 #include <boost/noncopyable.hpp>
 #include <boost/signals2.hpp>
 #include <boost/property_tree/ptree.hpp>
+#include <boost/thread.hpp>
 
 #include <stdint.h>
 
+#include <list>
+#include <map>
+#include <vector>
+
 #include "ADARA.h"
+#include "PulseIndexWriter.h"
 #include "Storage.h"
 
 class StorageContainer;
+class CompressedFile;
+class EventFd;
 
 class StorageFile : boost::noncopyable {
 public:
@@ -36,6 +44,13 @@ public:
 	bool addendum(void) const { return m_addendum; }
 	bool oversize(void) const { return m_oversize; }
 	off_t size(void) const { return m_size; }
+
+	/* Bytes on disk, for storage pool accounting: less than size()
+	 * for a compressed file. Only known once the file is closed out
+	 * or imported; background compression after that is accounted
+	 * for separately (see StorageManager::releaseBaseStorage()).
+	 */
+	off_t diskSize(void) const { return m_diskSize; }
 	uint32_t modeNumber(void) const { return m_modeNumber; }
 	uint32_t fileNumber(void) const { return m_fileNumber; }
 	uint32_t pauseFileNumber(void) const { return m_pauseFileNumber; }
@@ -44,6 +59,12 @@ public:
 	void persist(bool p = true) { m_persist = p; }
 	OwnerPtr owner(void) const { return m_owner; }
 
+	/* Is the open file descriptor one of our compressed files?
+	 * (See CompressedFile.h) If so, it can't go straight to
+	 * sendfile(); use read()/send() instead, which work either way.
+	 */
+	bool compressed(void) const { return m_reader != NULL; }
+
 	boost::signals2::connection connect(const onUpdate::slot_type &slot) {
 		return m_update.connect(slot);
 	}
@@ -77,10 +98,20 @@ public:
 
 	bool catFile(SharedPtr src);
 
+	/* pread()/sendfile() on the stored stream, between get_fd() and
+	 * put_fd(), decompressing as needed; offsets are always into
+	 * the original, uncompressed stream.
+	 */
+	ssize_t read(void *buf, size_t len, off_t offset);
+	ssize_t send(int out_fd, off_t *offset, size_t len);
+
 	~StorageFile();
 
 	static void config(const boost::property_tree::ptree &conf);
 
+	static void startCompressor(void);
+	static void stopCompressor(void);
+
 private:
 	OwnerPtr m_owner;
 	std::string m_path;
@@ -96,20 +127,47 @@ private:
 	bool m_paused;
 	bool m_addendum;
 	off_t m_size;
+	off_t m_diskSize;
 	off_t m_sizeLastUpdate;
 	off_t m_syncDistance;
 	int m_fd;
 	unsigned int m_fdRefs;
 	onUpdate m_update;
 
+	/* Background Compression (See CompressedFile.h) */
+	struct CompressJob;
+	bool m_compressOnClose;
+	boost::shared_ptr<CompressJob> m_compressJob;
+	CompressedFile *m_reader;
+	std::vector<char> m_sendBuf;
+
+	/* Pulse Index Sidecar (See ADARAPulseIndex.h) */
+	PulseIndexWriter m_index;
+
 	static off_t m_max_file_size;
 	static off_t m_max_sync_distance;
+	static off_t m_index_distance;
+	static bool m_index_enabled;
+	static bool m_compress;
+	static uint32_t m_compress_frame;
+
+	static boost::thread m_compressThread;
+	static boost::mutex m_compressLock;
+	static boost::condition_variable m_compressCond;
+	static std::list<boost::shared_ptr<CompressJob> > m_compressQueue;
+	static volatile bool m_compressStop;
+	static EventFd *m_compressDone;
 
 	void makePath(bool is_prologue);
 	void open(int flags);
 	void addSync(void);
 	void addRunStatus(ADARA::RunStatus::Enum status);
 
+	void queueCompress(void);
+	static void compressor(void);
+	static uint64_t compressFile(boost::shared_ptr<CompressJob> job);
+	static void compressCompleted(void);
+
 	StorageFile(OwnerPtr &owner, bool paused,
 		uint32_t modeNumber, uint32_t fileNumber, uint32_t pauseFileNumber);
 };
@@ -15,6 +15,7 @@ static LoggerPtr logger(Logger::getLogger("SMS.StorageManager"));
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/vfs.h>
+#include <sys/prctl.h>
 #include <fcntl.h>
 #include <ctype.h>
 #include <stdint.h>
@@ -34,6 +35,7 @@ static LoggerPtr logger(Logger::getLogger("SMS.StorageManager"));
 #include "ADARAUtils.h"
 #include "STCClientMgr.h"
 #include "EventFd.h"
+#include "Metrics.h"
 #include "utils.h"
 
 namespace fs = boost::filesystem;
@@ -43,6 +45,11 @@ RateLimitedLogging::History RLLHistory_StorageManager;
 // Rate-Limited Logging IDs...
 #define RLL_CONTAINER_SAWTOOTH        0
 
+// Time to get a packet into the current data file, and what went in
+static Metrics::Id metricAddPacket = Metrics::latency("Storage:AddPacket");
+static Metrics::Id metricPackets = Metrics::counter("Storage:Packets");
+static Metrics::Id metricBytes = Metrics::counter("Storage:Bytes");
+
 class PoolsizePV : public smsStringPV {
 public:
 	PoolsizePV(const std::string &name, uint32_t block_size,
@@ -880,6 +887,9 @@ void StorageManager::lateInit(void)
 	boost::thread io(backgroundIo);
 	m_ioThread.swap(io);
 
+	/* Closed data files get compressed in the background, if enabled */
+	StorageFile::startCompressor();
+
 	/* The IO thread immediately begins a scan of the store, so consider
 	 * it active.
 	 */
@@ -916,6 +926,9 @@ void StorageManager::stop(
 		m_contChange( (*it), false );
 	}
 
+	/* Anything still queued stays uncompressed; needs m_base_fd */
+	StorageFile::stopCompressor();
+
 	close(m_base_fd);
 
 	uint64_t value = 0;
@@ -1143,6 +1156,16 @@ void StorageManager::addBaseStorage(uint64_t size)
 	m_blocks_used += blocks;
 }
 
+void StorageManager::releaseBaseStorage(uint64_t blocks)
+{
+	/* A closed file was compressed in the background (see StorageFile),
+	 * and takes up this many fewer blocks than we accounted for above.
+	 */
+	if (blocks > m_blocks_used)
+		blocks = m_blocks_used;
+	m_blocks_used -= blocks;
+}
+
 void StorageManager::startContainer(
 		std::list<StorageContainer::SharedPtr>::iterator &it,
 		const struct timespec &minTime, // EPICS Time...!
@@ -1584,8 +1607,13 @@ void StorageManager::addPacket( IoVector &iovec,
 {
 	// DEBUG("addPacket() entry");
 
+	Metrics::Timer timer(metricAddPacket);
+
 	uint32_t len = validatePacket( iovec );
 
+	Metrics::add(metricPackets);
+	Metrics::add(metricBytes, len);
+
 	ADARA::Header *hdr = (ADARA::Header *) iovec[0].iov_base;
 	struct timespec ts;
 	ts.tv_sec = hdr->ts_sec; // EPICS Time...!
@@ -3254,6 +3282,9 @@ void StorageManager::backgroundIo(void)
 	 * m_purgedBlocks	IO thread, indicate how many blocks were purged
 	 */
 
+	/* Named so per-thread CPU use can be told apart (e.g. sms-bench) */
+	prctl( PR_SET_NAME, "sms-storage", 0, 0, 0 );
+
 	SMSControl *ctrl = SMSControl::getInstance();
 
 	scanStorage();
@@ -306,6 +306,7 @@ private:
 				const std::string &dir, uint64_t &total_size);
 
 	static void addBaseStorage(uint64_t size);
+	static void releaseBaseStorage(uint64_t blocks);
 
 	static struct timespec m_default_time;
 
@@ -349,6 +350,7 @@ private:
 				bool capture_last = false);
 
 	friend class StorageContainer;
+	friend class StorageFile;
 };
 
 #endif /* __STORAGE_MANAGER_H */
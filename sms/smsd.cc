@@ -69,6 +69,7 @@ static LoggerPtr logger(Logger::getLogger("SMS"));
 #include "ComBusSMSMon.h"
 #include "LiveServer.h"
 #include "STCClientMgr.h"
+#include "MetricsExporter.h"
 
 #define CHILD_INIT_SUCCESS	1
 #define CHILD_INIT_FAILED	2
@@ -213,6 +214,7 @@ static void load_config(const char *pname, ptree::ptree &conf,
 	SMSControl::config(conf);
 	STCClientMgr::config(conf);
 	LiveServer::config(conf);
+	MetricsExporter::config(conf);
 }
 
 static void block_signals(void)
@@ -493,6 +495,7 @@ int main(int argc, char **argv)
 		SMSControl::init();
 		LiveServer::init();
 		STCClientMgr::init();
+		MetricsExporter::init();
 
 		SMSControl::late_config(conf);
 	} catch (std::runtime_error e) {
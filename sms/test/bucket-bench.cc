@@ -0,0 +1,256 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include <map>
+#include <vector>
+
+#include "ADARA.h"
+#include "EventBanks.h"
+
+/* Microbenchmark for the SMSControl per-pulse event bucketing.
+ *
+ * A synthetic pixel map (20k pixels spread over 100 banks) is used to
+ * map a pulse's worth of raw events arriving in packet-sized pieces
+ * from a few sources, then the banked event packet payload is gathered.
+ * Both variants keep one EventVector per bank+state per source: "fresh"
+ * is the previous scheme, which allocated the banks (and reserved each
+ * one on first use) every pulse; "recycled" drives the same EventBanks
+ * class SMSControl uses, which hands the emptied banks on to the next
+ * pulse. Both produce identical banked payloads, which is checked
+ * before timing anything.
+ *
+ * Only the bucketing is measured; the pixel mapping here is a plain
+ * table lookup, and there's no packet parsing, state lookup or I/O.
+ *
+ * Usage: bucket-bench [events/pulse [pulses]]
+ */
+
+/* Mirrors PixelMap */
+enum { UNMAPPED_BANK = 0xffff, ERROR_BANK = 0xfffe };
+enum { REAL_BANK_OFFSET = 2 };
+
+typedef std::vector<std::pair<uint32_t, uint16_t> > Table;
+typedef std::vector<ADARA::Event> EventVector;
+
+static const uint32_t NUM_PIXELS = 20000;
+static const uint32_t NUM_BANKS = 100;
+static const uint32_t PKT_EVENTS = 4096;
+static const uint32_t BANK_RESERVE = 4096;
+
+static uint32_t maxBank = NUM_BANKS + REAL_BANK_OFFSET;
+static uint32_t numSources = 4;
+static uint32_t numStates = 1;
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+	if (!(cond)) { \
+		fprintf(stderr, "%s:%d: check failed: %s\n", \
+			__FILE__, __LINE__, #cond); \
+		failures++; \
+	} \
+} while (0)
+
+static inline void mapEvent(const Table &table, uint32_t phys,
+		uint32_t &logical, uint32_t &bank)
+{
+	if (phys < table.size()) {
+		logical = table[phys].first;
+		bank = table[phys].second;
+	} else {
+		logical = phys | 0x80000000;
+		bank = UNMAPPED_BANK;
+	}
+
+	bank = (uint16_t) ( bank + REAL_BANK_OFFSET );
+}
+
+/* Events carry a state in the upper TOF bits when sorting by state */
+static inline uint32_t bankState(uint32_t bank, uint32_t tof)
+{
+	return( bank + ( ( tof >> 21 ) % numStates ) * ( maxBank + 1 ) );
+}
+
+/* Old scheme: a new vector per bank+state per source every pulse */
+struct VecSource {
+	std::vector<EventVector> m_banks;
+};
+
+static void freshPulse(const Table &table,
+		const std::vector<ADARA::Event> &raw, std::vector<uint8_t> &out)
+{
+	std::map<uint32_t, VecSource> sources;
+	uint32_t numEvents = 0;
+
+	for (uint32_t p = 0; p * PKT_EVENTS < raw.size(); p++) {
+		VecSource &src = sources[p % numSources];
+		if (src.m_banks.empty())
+			src.m_banks.resize(numStates * ( maxBank + 1 ));
+
+		uint32_t end = (p + 1) * PKT_EVENTS;
+		if (end > raw.size())
+			end = raw.size();
+
+		for (uint32_t i = p * PKT_EVENTS; i < end; i++) {
+			uint32_t logical, bank;
+			mapEvent(table, raw[i].pixel, logical, bank);
+			ADARA::Event ev;
+			ev.pixel = logical;
+			ev.tof = raw[i].tof;
+
+			EventVector &v = src.m_banks[bankState(bank, raw[i].tof)];
+			if (v.empty())
+				v.reserve(BANK_RESERVE);
+			v.push_back(ev);
+			numEvents++;
+		}
+	}
+
+	/* Gather, as writev() would */
+	out.resize(numEvents * sizeof(ADARA::Event));
+	uint8_t *dst = &out[0];
+	std::map<uint32_t, VecSource>::iterator it;
+	for (it = sources.begin(); it != sources.end(); ++it) {
+		for (uint32_t b = 0; b < it->second.m_banks.size(); b++) {
+			EventVector &v = it->second.m_banks[b];
+			if (v.empty())
+				continue;
+			memcpy(dst, &v[0], v.size() * sizeof(ADARA::Event));
+			dst += v.size() * sizeof(ADARA::Event);
+		}
+	}
+}
+
+/* Current scheme: EventBanks recycled between pulses, as used by
+ * SMSControl::pulseEvents() and SMSControl::recycleBanks()
+ */
+static std::vector<EventBanks> pool;
+
+static void recycledPulse(const Table &table,
+		const std::vector<ADARA::Event> &raw, std::vector<uint8_t> &out)
+{
+	std::map<uint32_t, EventBanks> sources;
+	uint32_t numEvents = 0;
+
+	for (uint32_t p = 0; p * PKT_EVENTS < raw.size(); p++) {
+		EventBanks &src = sources[p % numSources];
+		if (!src.banks()) {
+			if (!pool.empty()) {
+				src.recycle(pool.back());
+				pool.pop_back();
+			}
+			src.setBanks(numStates * ( maxBank + 1 ), BANK_RESERVE);
+		}
+
+		uint32_t end = (p + 1) * PKT_EVENTS;
+		if (end > raw.size())
+			end = raw.size();
+
+		for (uint32_t i = p * PKT_EVENTS; i < end; i++) {
+			uint32_t logical, bank;
+			mapEvent(table, raw[i].pixel, logical, bank);
+			ADARA::Event ev;
+			ev.pixel = logical;
+			ev.tof = raw[i].tof;
+
+			src.add(ev, bankState(bank, raw[i].tof));
+			numEvents++;
+		}
+	}
+
+	/* Gather, as writev() would */
+	out.resize(numEvents * sizeof(ADARA::Event));
+	uint8_t *dst = &out[0];
+	std::map<uint32_t, EventBanks>::iterator it;
+	for (it = sources.begin(); it != sources.end(); ++it) {
+		for (uint32_t b = 0; b < it->second.banks(); b++) {
+			EventVector &v = it->second.bank(b);
+			if (v.empty())
+				continue;
+			memcpy(dst, &v[0], v.size() * sizeof(ADARA::Event));
+			dst += v.size() * sizeof(ADARA::Event);
+		}
+
+		it->second.clear();
+		pool.push_back(EventBanks());
+		pool.back().recycle(it->second);
+	}
+}
+
+static double elapsed(const struct timespec &a, const struct timespec &b)
+{
+	return (b.tv_sec - a.tv_sec) + (b.tv_nsec - a.tv_nsec) / 1e9;
+}
+
+static void run(const Table &table, uint32_t events, uint32_t sources,
+		uint32_t states, uint32_t pulses)
+{
+	numSources = sources;
+	numStates = states;
+
+	std::vector<ADARA::Event> raw(events);
+	srand(42);
+	for (uint32_t i = 0; i < events; i++) {
+		raw[i].pixel = rand() % (NUM_PIXELS + NUM_PIXELS / 100);
+		raw[i].tof = ( rand() % 16666 ) | ( ( rand() % 8 ) << 21 );
+	}
+
+	std::vector<uint8_t> a, b;
+	freshPulse(table, raw, a);
+	recycledPulse(table, raw, b);
+	CHECK(a.size() == events * sizeof(ADARA::Event));
+	CHECK(a == b);
+
+	struct timespec t0, t1, t2;
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (uint32_t p = 0; p < pulses; p++)
+		freshPulse(table, raw, a);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	for (uint32_t p = 0; p < pulses; p++)
+		recycledPulse(table, raw, b);
+	clock_gettime(CLOCK_MONOTONIC, &t2);
+
+	double fresh_s = elapsed(t0, t1), recycled_s = elapsed(t1, t2);
+
+	printf("%u events/pulse, %u sources, %u state(s):\n",
+		events, sources, states);
+	printf("  fresh    %8.2f ms/pulse  %6.2f ns/event\n",
+		fresh_s * 1e3 / pulses, fresh_s * 1e9 / pulses / events);
+	printf("  recycled %8.2f ms/pulse  %6.2f ns/event  (%.2fx)\n",
+		recycled_s * 1e3 / pulses, recycled_s * 1e9 / pulses / events,
+		fresh_s / recycled_s);
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t events = argc > 1 ? strtoul(argv[1], NULL, 0) : 1000000;
+	uint32_t pulses = argc > 2 ? strtoul(argv[2], NULL, 0) : 100;
+
+	/* Banks are runs of 200 logical pixels, with the physical ids
+	 * scattered so neighbouring ids don't land in the same bank;
+	 * the random events below also include ~1% unmapped ids */
+	Table table(NUM_PIXELS);
+	for (uint32_t p = 0; p < NUM_PIXELS; p++) {
+		uint32_t logical = (p * 7919) % NUM_PIXELS;
+		table[p] = std::make_pair(logical,
+			(uint16_t) (logical / (NUM_PIXELS / NUM_BANKS)));
+	}
+
+	printf("%u pixels, %u banks\n", NUM_PIXELS, NUM_BANKS);
+
+	run(table, events, 4, 1, pulses);
+	run(table, events, 1, 1, pulses);
+	run(table, events, 4, 8, pulses);
+	run(table, events / 10, 4, 1, pulses * 10);
+
+	if (failures) {
+		fprintf(stderr, "%d check(s) failed\n", failures);
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,266 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <vector>
+
+#include "ADARA.h"
+#include "CompressedFile.h"
+
+/* Checks and benchmark for compressed SMS raw data files.
+ *
+ * Builds a stand-in raw data file (event packets of pixel id/TOF pairs,
+ * like a detector stream), compresses it, and checks reads of the
+ * compressed form against the original: the whole thing front to back,
+ * random seeks, reads straddling frames, and reads off the end. Then
+ * checks a damaged frame is reported rather than returned, and that an
+ * empty file survives the trip. Along the way, reports the compression
+ * ratio and how fast compression and (cold, per frame) decompression go;
+ * with random pixel ids and TOFs, the ratio here is close to worst case.
+ *
+ * Usage: compress-test [megabytes [frame_size]]
+ */
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+	if (!(cond)) { \
+		fprintf(stderr, "%s:%d: check failed: %s\n", \
+			__FILE__, __LINE__, #cond); \
+		failures++; \
+	} \
+} while (0)
+
+static double elapsed(const struct timespec &a, const struct timespec &b)
+{
+	return (b.tv_sec - a.tv_sec) + (b.tv_nsec - a.tv_nsec) / 1e9;
+}
+
+static int tempFile(void)
+{
+	char name[] = "/tmp/compress-test-XXXXXX";
+	int fd = mkstemp(name);
+	if (fd < 0) {
+		perror("mkstemp");
+		exit(1);
+	}
+	unlink(name);
+	return fd;
+}
+
+/* Event packets of a few KB each, with slowly rising TOFs and pixel
+ * ids from a small detector, much like what the SMS stores.
+ */
+static void makeData(std::vector<uint8_t> &data, size_t size)
+{
+	data.clear();
+	data.reserve(size + 65536);
+
+	uint32_t sec = 800000000, nsec = 0;
+	while (data.size() < size) {
+		uint32_t events = 256 + rand() % 512;
+		ADARA::Header hdr;
+		hdr.payload_len = 24 + events * 8;
+		hdr.pkt_format = ADARA_PKT_TYPE(
+			ADARA::PacketType::RAW_EVENT_TYPE, 0);
+		hdr.ts_sec = sec;
+		hdr.ts_nsec = nsec;
+
+		size_t at = data.size();
+		data.resize(at + sizeof(hdr) + hdr.payload_len);
+		memcpy(&data[at], &hdr, sizeof(hdr));
+
+		uint32_t *p = (uint32_t *) &data[at + sizeof(hdr)];
+		memset(p, 0, 24);
+		p[0] = 1;
+		p += 6;
+
+		uint32_t tof = 0;
+		for (uint32_t i = 0; i < events; i++) {
+			tof += rand() % 200;
+			*p++ = tof;
+			*p++ = rand() % 65536;
+		}
+
+		nsec += 16666666;
+		if (nsec >= 1000000000) {
+			nsec -= 1000000000;
+			sec++;
+		}
+	}
+}
+
+static void writeAll(int fd, const std::vector<uint8_t> &data)
+{
+	size_t done = 0;
+	while (done < data.size()) {
+		ssize_t rc = write(fd, &data[done], data.size() - done);
+		if (rc <= 0) {
+			perror("write");
+			exit(1);
+		}
+		done += rc;
+	}
+	lseek(fd, 0, SEEK_SET);
+}
+
+static void checkEmpty(void)
+{
+	int in = tempFile(), out = tempFile();
+	uint64_t packed;
+	std::string err;
+
+	CHECK(CompressedFile::compress(in, out, 0, packed, err));
+	CHECK(CompressedFile::detect(out) == false);
+
+	CompressedFile cf;
+	CHECK(cf.open(out, err));
+	CHECK(cf.size() == 0);
+	CHECK(cf.frames() == 0);
+
+	char buf[16];
+	CHECK(cf.pread(buf, sizeof(buf), 0) == 0);
+
+	close(in);
+	close(out);
+}
+
+static void checkReads(CompressedFile &cf, const std::vector<uint8_t> &data)
+{
+	std::vector<uint8_t> buf(1024 * 1024);
+
+	/* Front to back in odd sized pieces, as the live clients would */
+	size_t off = 0;
+	bool same = true;
+	while (off < data.size()) {
+		size_t len = 65536 + rand() % 300000;
+		ssize_t rc = cf.pread(&buf[0], len, off);
+		if (rc <= 0 || memcmp(&buf[0], &data[off], rc)) {
+			same = false;
+			break;
+		}
+		off += rc;
+	}
+	CHECK(same);
+	CHECK(off == data.size());
+
+	/* Random seeks, some straddling frame boundaries */
+	for (uint32_t i = 0; i < 200; i++) {
+		off_t at = rand() % data.size();
+		size_t len = rand() % buf.size();
+		size_t want = len;
+		if (at + want > data.size())
+			want = data.size() - at;
+		ssize_t rc = cf.pread(&buf[0], len, at);
+		CHECK(rc == (ssize_t) want);
+		CHECK(rc <= 0 || !memcmp(&buf[0], &data[at], rc));
+	}
+
+	/* At and past the end */
+	CHECK(cf.pread(&buf[0], 100, data.size()) == 0);
+	CHECK(cf.pread(&buf[0], 100, data.size() + 12345) == 0);
+	CHECK(cf.pread(&buf[0], 100, data.size() - 10) == 10);
+}
+
+static void checkCorrupt(int fd, CompressedFile &cf)
+{
+	std::string err;
+	struct stat st;
+	fstat(fd, &st);
+	std::vector<uint8_t> copy(st.st_size);
+	CHECK(pread(fd, &copy[0], copy.size(), 0) == (ssize_t) copy.size());
+
+	/* Scribble on the second frame */
+	CompressedFrameEntry first;
+	memcpy(&first, &copy[copy.size() - sizeof(CompressedFileFooter)
+		- cf.frames() * sizeof(CompressedFrameEntry)], sizeof(first));
+	copy[first.packed_size + 1000] ^= 0x55;
+
+	char buf[4096];
+	off_t frame1 = first.raw_size + 10;
+	CHECK(cf.pread(buf, sizeof(buf), frame1) == sizeof(buf));
+
+	int bad = tempFile();
+	CHECK(write(bad, &copy[0], copy.size()) == (ssize_t) copy.size());
+
+	CompressedFile damaged;
+	CHECK(damaged.open(bad, err));
+	CHECK(damaged.pread(buf, sizeof(buf), 0) == sizeof(buf));
+	CHECK(damaged.pread(buf, sizeof(buf), frame1) == -1);
+	CHECK(!damaged.error().empty());
+
+	/* A truncated file has no seek table at all */
+	CHECK(ftruncate(bad, copy.size() - 1) == 0);
+	CompressedFile truncated;
+	CHECK(!truncated.open(bad, err));
+
+	close(bad);
+}
+
+int main(int argc, char **argv)
+{
+	size_t mb = argc > 1 ? strtoul(argv[1], NULL, 0) : 64;
+	uint32_t frame_size = argc > 2 ? strtoul(argv[2], NULL, 0)
+		: (uint32_t) CompressedFile::MAX_FRAME_SIZE;
+
+	checkEmpty();
+
+	std::vector<uint8_t> data;
+	makeData(data, mb * 1024 * 1024);
+
+	int in = tempFile(), out = tempFile();
+	writeAll(in, data);
+
+	struct timespec t0, t1;
+	uint64_t packed;
+	std::string err;
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	bool ok = CompressedFile::compress(in, out, frame_size, packed, err);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	CHECK(ok);
+	if (!ok) {
+		fprintf(stderr, "compress: %s\n", err.c_str());
+		return 1;
+	}
+	double secs = elapsed(t0, t1);
+
+	CHECK(CompressedFile::detect(out));
+	CHECK(!CompressedFile::detect(in));
+
+	CompressedFile cf;
+	CHECK(cf.open(out, err));
+	CHECK(cf.size() == data.size());
+
+	printf("%zu bytes in %u frames -> %llu bytes (%.1f%%)\n",
+		data.size(), cf.frames(), (unsigned long long) packed,
+		packed * 100.0 / data.size());
+	printf("  compress    %8.1f MB/s\n", data.size() / secs / 1e6);
+
+	/* Cold, every frame decompressed once */
+	std::vector<uint8_t> buf(data.size());
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	ssize_t rc = cf.pread(&buf[0], buf.size(), 0);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	CHECK(rc == (ssize_t) data.size());
+	CHECK(buf == data);
+	printf("  decompress  %8.1f MB/s\n",
+		data.size() / elapsed(t0, t1) / 1e6);
+
+	checkReads(cf, data);
+	checkCorrupt(out, cf);
+
+	close(in);
+	close(out);
+
+	if (failures) {
+		fprintf(stderr, "%d check(s) failed\n", failures);
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,154 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include <stdexcept>
+#include <vector>
+
+#include "LatestValueStore.h"
+
+/* Consistency checks and a microbenchmark for the MetaDataMgr latest
+ * value store; the benchmark mimics a beamline with a few thousand
+ * scalar PVs updating and a prologue being gathered every so often.
+ */
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+	if (!(cond)) { \
+		fprintf(stderr, "%s:%d: check failed: %s\n", \
+			__FILE__, __LINE__, #cond); \
+		failures++; \
+	} \
+} while (0)
+
+static void fill(std::vector<uint8_t> &buf, uint32_t len, uint8_t val)
+{
+	buf.assign(len, val);
+}
+
+/* Flatten an iovec list so it can be compared with what we expect */
+static void gather(const IoVector &iovec, std::vector<uint8_t> &out)
+{
+	out.clear();
+	for (uint32_t i = 0; i < iovec.size(); i++) {
+		const uint8_t *p = (const uint8_t *) iovec[i].iov_base;
+		out.insert(out.end(), p, p + iovec[i].iov_len);
+	}
+}
+
+static void testStore(void)
+{
+	LatestValueStore store(64);
+	std::vector<uint8_t> pkt, out;
+	IoVector iovec;
+
+	fill(pkt, 16, 'a');
+	LatestValueStore::Handle a = store.store(LatestValueStore::NONE,
+						&pkt[0], pkt.size());
+	fill(pkt, 24, 'b');
+	LatestValueStore::Handle b = store.store(LatestValueStore::NONE,
+						&pkt[0], pkt.size());
+
+	/* Same size, same slot */
+	fill(pkt, 16, 'A');
+	CHECK(store.store(a, &pkt[0], pkt.size()) == a);
+	CHECK(store.inPlaceCount() == 1);
+
+	store.fillIoVector(iovec);
+	CHECK(iovec.size() == 1);
+	gather(iovec, out);
+	CHECK(out.size() == 40 && out[0] == 'A' && out[16] == 'b');
+
+	/* Resize moves 'a' behind 'b' */
+	fill(pkt, 32, 'C');
+	a = store.store(a, &pkt[0], pkt.size());
+	CHECK(store.relocateCount() == 1);
+
+	/* Pinned packets are left out and compaction waits */
+	store.pin(a);
+	iovec.clear();
+	store.fillIoVector(iovec);
+	gather(iovec, out);
+	CHECK(out.size() == 24 && out[0] == 'b');
+	CHECK(store.compactCount() == 0);
+	store.unpin();
+
+	iovec.clear();
+	store.fillIoVector(iovec);
+	CHECK(store.compactCount() == 1);
+	CHECK(iovec.size() == 1);
+	gather(iovec, out);
+	CHECK(out.size() == 56 && out[0] == 'b' && out[24] == 'C');
+
+	/* Oversized packets get their own chunk */
+	fill(pkt, 4096, 'D');
+	LatestValueStore::Handle d = store.store(LatestValueStore::NONE,
+						&pkt[0], pkt.size());
+	CHECK(store.length(d) == 4096 && store.data(d)[4095] == 'D');
+
+	store.release(b);
+	iovec.clear();
+	store.fillIoVector(iovec);
+	gather(iovec, out);
+	CHECK(out.size() == 32 + 4096 && out[0] == 'C' && out[32] == 'D');
+	CHECK(store.liveBytes() == 32 + 4096);
+
+	bool threw = false;
+	try {
+		store.release(b);
+	} catch (std::logic_error &) {
+		threw = true;
+	}
+	CHECK(threw);
+}
+
+static double elapsed(const struct timespec &a, const struct timespec &b)
+{
+	return (b.tv_sec - a.tv_sec) + (b.tv_nsec - a.tv_nsec) / 1e9;
+}
+
+static void benchmark(uint32_t pvs, uint32_t updates)
+{
+	LatestValueStore store;
+	std::vector<LatestValueStore::Handle> handles(pvs,
+						LatestValueStore::NONE);
+	std::vector<uint8_t> pkt(32, 0);
+	struct timespec t0, t1, t2;
+	IoVector iovec;
+	uint32_t i;
+
+	for (i = 0; i < pvs; i++)
+		handles[i] = store.store(handles[i], &pkt[0], pkt.size());
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < updates; i++) {
+		pkt[16] = i;
+		store.store(handles[i % pvs], &pkt[0], pkt.size());
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	for (i = 0; i < 1000; i++) {
+		iovec.clear();
+		store.fillIoVector(iovec);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t2);
+
+	printf("%u pvs: %.1f ns/update, %.2f us/prologue (%zu iovec)\n",
+		pvs, elapsed(t0, t1) * 1e9 / updates,
+		elapsed(t1, t2) * 1e6 / 1000, iovec.size());
+}
+
+int main(int argc, char **argv)
+{
+	testStore();
+
+	if (failures) {
+		fprintf(stderr, "%d check(s) failed\n", failures);
+		return 1;
+	}
+
+	benchmark(argc > 1 ? strtoul(argv[1], NULL, 0) : 5000, 10000000);
+	return 0;
+}
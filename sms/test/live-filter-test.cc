@@ -0,0 +1,436 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ADARA.h"
+#include "ADARAPackets.h"
+#include "ADARAParser.h"
+#include "HistoPreview.h"
+#include "LiveFilter.h"
+
+/* Checks for the live client subscription filters: a Version 2 client
+ * hello is parsed into a LiveFilter, a synthetic stream is run through
+ * it in awkward chunk sizes, and the output is parsed back to make sure
+ * it is a well-formed stream with the expected content.
+ */
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+	if (!(cond)) { \
+		fprintf(stderr, "%s:%d: check failed: %s\n", \
+			__FILE__, __LINE__, #cond); \
+		failures++; \
+	} \
+} while (0)
+
+typedef std::vector<uint32_t> Words;
+
+static void header(Words &w, uint32_t base_type, uint32_t version,
+		uint32_t pulse)
+{
+	w.push_back(0);
+	w.push_back(ADARA_PKT_TYPE(base_type, version));
+	w.push_back(1000000 + pulse);
+	w.push_back(pulse);
+}
+
+static void finish(Words &w, size_t start)
+{
+	w[start] = (w.size() - start - 4) * sizeof(uint32_t);
+}
+
+static void hello(Words &w, uint32_t flags, uint32_t decimation,
+		const Words &types, const Words &banks)
+{
+	size_t start = w.size();
+	header(w, ADARA::PacketType::CLIENT_HELLO_TYPE,
+		ADARA::PacketType::CLIENT_HELLO_VERSION, 0);
+	w.push_back(0);
+	w.push_back(flags);
+	w.push_back(decimation);
+	w.push_back(types.size());
+	w.insert(w.end(), types.begin(), types.end());
+	w.push_back(banks.size());
+	w.insert(w.end(), banks.begin(), banks.end());
+	finish(w, start);
+}
+
+/* Two sources, banks 1-3 plus the error bank, bank b gets b + 1 events */
+static void banked(Words &w, uint32_t pulse, bool state)
+{
+	size_t start = w.size();
+	header(w, state ? ADARA::PacketType::BANKED_EVENT_STATE_TYPE
+			: ADARA::PacketType::BANKED_EVENT_TYPE,
+		state ? ADARA::PacketType::BANKED_EVENT_STATE_VERSION
+			: ADARA::PacketType::BANKED_EVENT_VERSION, pulse);
+	w.push_back(12345);		// charge
+	w.push_back(1);			// energy
+	w.push_back(pulse % 600);	// cycle
+	w.push_back(0);			// flags
+
+	for (uint32_t src = 0; src < 2; src++) {
+		w.push_back(src);
+		w.push_back(0);
+		w.push_back(0x80000000);
+		w.push_back(4);
+
+		uint32_t banks[4] = { 0xfffffffe, 1, 2, 3 };
+		for (uint32_t b = 0; b < 4; b++) {
+			w.push_back(banks[b]);
+			if (state)
+				w.push_back(src);
+			uint32_t count = (banks[b] & 0xf) + 1;
+			w.push_back(count);
+			for (uint32_t e = 0; e < count; e++) {
+				w.push_back(e);
+				w.push_back(banks[b] * 1000 + e);
+			}
+		}
+	}
+
+	finish(w, start);
+}
+
+static void other(Words &w, uint32_t base_type, uint32_t version,
+		uint32_t words, uint32_t pulse)
+{
+	size_t start = w.size();
+	header(w, base_type, version, pulse);
+	for (uint32_t i = 0; i < words; i++)
+		w.push_back(i);
+	finish(w, start);
+}
+
+/* One histo-format set, bank 2 binned 0-10us in 1us bins */
+static void bankSets(Words &w)
+{
+	size_t start = w.size();
+	header(w, ADARA::PacketType::DETECTOR_BANK_SETS_TYPE,
+		ADARA::PacketType::DETECTOR_BANK_SETS_VERSION, 0);
+	w.push_back(1);
+	for (uint32_t i = 0; i < 4; i++)
+		w.push_back(0x41414141);	// name
+	w.push_back(ADARA::HISTO_FORMAT);
+	w.push_back(1);
+	w.push_back(2);
+	w.push_back(0);			// TOF offset
+	w.push_back(10);		// TOF max
+	w.push_back(1);			// TOF bin
+	w.push_back(0);			// throttle
+	w.push_back(0);
+	for (uint32_t i = 0; i < 4; i++)
+		w.push_back(0);		// suffix
+	finish(w, start);
+}
+
+static void stream(Words &w, uint32_t pulses)
+{
+	for (uint32_t p = 0; p < pulses; p++) {
+		other(w, ADARA::PacketType::VAR_VALUE_U32_TYPE,
+			ADARA::PacketType::VAR_VALUE_U32_VERSION, 4, p);
+		other(w, ADARA::PacketType::BEAM_MONITOR_EVENT_TYPE,
+			ADARA::PacketType::BEAM_MONITOR_EVENT_VERSION, 4, p);
+		banked(w, p, p & 1);
+	}
+}
+
+/* Parses the hello and the filtered output */
+class Checker : public ADARA::Parser {
+public:
+	Checker() : m_vars(0), m_monitors(0), m_pulses(0), m_events(0),
+		m_banks(0), m_invalid(0), m_previews(0), m_previewPulses(0),
+		m_previewEvents(0), m_tofCounts(0), m_pixelCounts(0),
+		m_bank2Bins(0) { }
+
+	std::auto_ptr<LiveFilter> m_filter;
+
+	uint32_t m_vars, m_monitors, m_pulses, m_events, m_banks, m_invalid;
+	Words m_bankIds;
+
+	uint32_t m_previews, m_previewPulses, m_previewEvents;
+	uint32_t m_tofCounts, m_pixelCounts, m_bank2Bins;
+
+	void parse(const uint8_t *data, size_t len) {
+		std::string log_info;
+		while (len) {
+			unsigned int n = bufferFillLength();
+			if (n > len)
+				n = len;
+			memcpy(bufferFillAddress(), data, n);
+			bufferBytesAppended(n);
+			try {
+				CHECK(bufferParse(log_info) >= 0);
+			} catch (ADARA::invalid_packet &) {
+				m_invalid++;
+				return;
+			}
+			data += n;
+			len -= n;
+		}
+	}
+
+	using ADARA::Parser::rxPacket;
+
+	bool rxPacket(const ADARA::ClientHelloPkt &pkt) {
+		m_filter.reset(new LiveFilter(pkt));
+		return false;
+	}
+
+	bool rxPacket(const ADARA::VariableU32Pkt &) {
+		m_vars++;
+		return false;
+	}
+
+	bool rxPacket(const ADARA::BeamMonitorPkt &) {
+		m_monitors++;
+		return false;
+	}
+
+	void banks(const ADARA::Packet &pkt, uint32_t bank_hdr) {
+		const uint32_t *p = (const uint32_t *) pkt.payload();
+		const uint32_t *end = p + pkt.payload_length() / 4;
+
+		m_pulses++;
+		p += 4;
+		while (p < end) {
+			uint32_t count = p[3];
+			p += 4;
+			while (count--) {
+				uint32_t events = p[bank_hdr - 1];
+				m_bankIds.push_back(p[0]);
+				m_banks++;
+				m_events += events;
+				p += bank_hdr + 2 * events;
+			}
+		}
+		CHECK(p == end);
+	}
+
+	bool rxPacket(const ADARA::BankedEventPkt &pkt) {
+		banks(pkt, 2);
+		return false;
+	}
+
+	bool rxPacket(const ADARA::BankedEventStatePkt &pkt) {
+		banks(pkt, 3);
+		return false;
+	}
+
+	bool rxPacket(const ADARA::HistoPreviewPkt &pkt) {
+		m_previews++;
+		m_previewPulses += pkt.pulseCount();
+		m_previewEvents += pkt.eventCount();
+
+		for (uint32_t i = 0; i < pkt.sectionCount(); i++) {
+			Words bins;
+			pkt.accumulate(i, bins);
+			CHECK(bins.size() == pkt.binCount(i));
+
+			uint32_t sum = 0;
+			for (uint32_t b = 0; b < bins.size(); b++)
+				sum += bins[b];
+
+			if (pkt.kind(i) == ADARA::HistoPreviewPkt::PIXEL_COUNTS) {
+				m_pixelCounts += sum;
+				continue;
+			}
+
+			m_tofCounts += sum;
+			if (pkt.bankId(i) == 2) {
+				CHECK(pkt.binWidth(i) == 1);
+				m_bank2Bins = pkt.binCount(i);
+			}
+		}
+		return false;
+	}
+};
+
+/* Filter the stream in chunks like LiveClient does, returns the output */
+static void run(LiveFilter &filter, const Words &in, uint32_t chunk,
+		std::vector<uint8_t> &out)
+{
+	const uint8_t *data = (const uint8_t *) &in[0];
+	uint32_t len = in.size() * sizeof(uint32_t), pos = 0;
+
+	out.clear();
+	while (pos < len) {
+		uint32_t n = len - pos < chunk ? len - pos : chunk;
+
+		/* Always hand over at least one whole packet */
+		uint32_t need = LiveFilter::packetLength(data + pos, len - pos);
+		if (need > n)
+			n = need;
+
+		uint32_t used = filter.filter(data + pos, n, out);
+		CHECK(used > 0);
+		pos += used;
+	}
+}
+
+static void check(uint32_t flags, uint32_t decimation, const Words &types,
+		const Words &banks, uint32_t exp_vars, uint32_t exp_mons,
+		uint32_t exp_pulses, uint32_t exp_banks, uint32_t exp_events)
+{
+	Words h, s;
+	Checker hc, oc;
+	std::vector<uint8_t> out;
+
+	hello(h, flags, decimation, types, banks);
+	hc.parse((const uint8_t *) &h[0], h.size() * sizeof(uint32_t));
+	CHECK(hc.m_filter.get() != NULL);
+	if (!hc.m_filter.get())
+		return;
+
+	stream(s, 10);
+	run(*hc.m_filter, s, 100, out);
+	oc.parse(&out[0], out.size());
+
+	CHECK(oc.m_vars == exp_vars);
+	CHECK(oc.m_monitors == exp_mons);
+	CHECK(oc.m_pulses == exp_pulses);
+	CHECK(oc.m_banks == exp_banks);
+	CHECK(oc.m_events == exp_events);
+	CHECK(hc.m_filter->bytesIn() == s.size() * sizeof(uint32_t));
+	CHECK(hc.m_filter->bytesOut() == out.size());
+
+	if (flags & ADARA::ClientHelloPkt::FILTER_BANKS) {
+		for (uint32_t i = 0; i < oc.m_bankIds.size(); i++) {
+			CHECK(std::find(banks.begin(), banks.end(),
+				oc.m_bankIds[i]) != banks.end());
+		}
+	}
+
+	printf("%-40s %6zu -> %6zu bytes\n", hc.m_filter->describe().c_str(),
+		s.size() * sizeof(uint32_t), out.size());
+}
+
+int main(void)
+{
+	Words none, types, banks;
+
+	/* Per pulse: 2 sources x 4 banks, with 2, 3 and 4 events in
+	 * banks 1-3 and (0xfffffffe & 0xf) + 1 = 15 in the error bank */
+	uint32_t per_pulse = 2 * (15 + 2 + 3 + 4);
+
+	check(0, 0, none, none, 10, 10, 10, 80, 10 * per_pulse);
+
+	check(ADARA::ClientHelloPkt::METADATA_ONLY, 0, none, none,
+		10, 0, 0, 0, 0);
+
+	types.push_back(ADARA::PacketType::BEAM_MONITOR_EVENT_TYPE);
+	check(ADARA::ClientHelloPkt::FILTER_PKT_TYPES, 0, types, none,
+		0, 10, 0, 0, 0);
+
+	banks.push_back(2);
+	banks.push_back(0xfffffffe);
+	check(ADARA::ClientHelloPkt::FILTER_BANKS, 0, none, banks,
+		10, 10, 10, 40, 10 * 2 * (15 + 3));
+
+	check(ADARA::ClientHelloPkt::DECIMATE_EVENTS, 4, none, none,
+		10, 10, 10, 3 * 8, 3 * per_pulse);
+
+	check(ADARA::ClientHelloPkt::DECIMATE_EVENTS
+			| ADARA::ClientHelloPkt::FILTER_BANKS, 5, none, banks,
+		10, 10, 10, 2 * 4, 2 * 2 * (15 + 3));
+
+	/* Histogram preview: pulses are a second apart, so with a one
+	 * second interval every other pulse closes a preview */
+	{
+		Words h, s;
+		Checker hc, oc;
+		std::vector<uint8_t> out;
+
+		HistoPreview::config(1.0, 33333, 100, 1 << 20);
+
+		hello(h, ADARA::ClientHelloPkt::HISTO_PREVIEW, 0, none, none);
+		hc.parse((const uint8_t *) &h[0], h.size() * sizeof(uint32_t));
+		CHECK(hc.m_filter.get() != NULL);
+
+		bankSets(s);
+		stream(s, 10);
+		run(*hc.m_filter, s, 100, out);
+		oc.parse(&out[0], out.size());
+
+		CHECK(oc.m_pulses == 0);
+		CHECK(oc.m_vars == 10);
+		CHECK(oc.m_monitors == 10);
+		CHECK(oc.m_previews == 5);
+		CHECK(oc.m_previewPulses == 10);
+		CHECK(oc.m_previewEvents == 10 * per_pulse);
+		CHECK(oc.m_tofCounts == 10 * per_pulse);
+		/* The error bank's events have no logical pixel */
+		CHECK(oc.m_pixelCounts == 10 * 2 * (2 + 3 + 4));
+		CHECK(oc.m_bank2Bins == 10);
+
+		printf("%-40s %6zu -> %6zu bytes\n",
+			hc.m_filter->describe().c_str(),
+			s.size() * sizeof(uint32_t), out.size());
+	}
+
+	/* Malformed extended hello */
+	{
+		Words h;
+		Checker hc;
+		hello(h, ADARA::ClientHelloPkt::FILTER_BANKS, 0, none, banks);
+		h[h.size() - 3] = 7; // bank count runs off the end
+		hc.parse((const uint8_t *) &h[0], h.size() * sizeof(uint32_t));
+		CHECK(hc.m_filter.get() == NULL);
+		CHECK(hc.m_invalid == 1);
+	}
+
+	/* V2 hellos too short for even the V1 fields */
+	for (uint32_t len = 0; len < 2 * sizeof(uint32_t);
+			len += sizeof(uint32_t)) {
+		Words h;
+		Checker hc;
+		size_t start = h.size();
+		header(h, ADARA::PacketType::CLIENT_HELLO_TYPE,
+			ADARA::PacketType::CLIENT_HELLO_VERSION, 0);
+		if (len)
+			h.push_back(0);
+		finish(h, start);
+		CHECK(h[start] == len);
+		hc.parse((const uint8_t *) &h[0], h.size() * sizeof(uint32_t));
+		CHECK(hc.m_filter.get() == NULL);
+		CHECK(hc.m_invalid == 1);
+	}
+
+	/* A corrupt payload length can't wrap around to a short packet,
+	 * and the filter won't take it (or anything after it) */
+	{
+		Words h, s;
+		Checker hc;
+		std::vector<uint8_t> out;
+
+		hello(h, 0, 0, none, none);
+		hc.parse((const uint8_t *) &h[0], h.size() * sizeof(uint32_t));
+		CHECK(hc.m_filter.get() != NULL);
+
+		stream(s, 1);
+		size_t start = s.size();
+		other(s, ADARA::PacketType::RUN_INFO_TYPE, 0, 4, 0);
+		s[start] = 0xfffffff8;
+
+		const uint8_t *data = (const uint8_t *) &s[start];
+		CHECK(LiveFilter::packetLength(data, 16) == 0xffffffff);
+		if (hc.m_filter.get()) {
+			uint32_t len = s.size() * sizeof(uint32_t);
+			CHECK(hc.m_filter->filter((const uint8_t *) &s[0], len,
+				out) == start * sizeof(uint32_t));
+		}
+	}
+
+	if (failures) {
+		fprintf(stderr, "%d check(s) failed\n", failures);
+		return 1;
+	}
+
+	return 0;
+}
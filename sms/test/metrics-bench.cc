@@ -0,0 +1,241 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include <vector>
+
+#include "Metrics.h"
+
+/* Checks and microbenchmark for the smsd metrics registry.
+ *
+ * First the histogram bucketing and percentile math are checked against
+ * known distributions, and per-thread counters against a multi-threaded
+ * total. Then a stand-in for a packet's worth of smsd work (a checksum
+ * over a packet-sized buffer) is timed bare, with a Timer and counter
+ * around it while metrics are disabled, and with them enabled; the
+ * difference is what instrumenting a stage boundary costs.
+ */
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+	if (!(cond)) { \
+		fprintf(stderr, "%s:%d: check failed: %s\n", \
+			__FILE__, __LINE__, #cond); \
+		failures++; \
+	} \
+} while (0)
+
+static const uint32_t NUM_THREADS = 4;
+static const uint32_t THREAD_ADDS = 1000000;
+
+static Metrics::Id benchWork = Metrics::latency("Bench:Work");
+static Metrics::Id benchPackets = Metrics::counter("Bench:Packets");
+static Metrics::Id benchBytes = Metrics::counter("Bench:Bytes");
+static Metrics::Id checkUniform = Metrics::latency("Check:Uniform");
+static Metrics::Id checkThreads = Metrics::counter("Check:Threads");
+
+static double elapsed(const struct timespec &a, const struct timespec &b)
+{
+	return (b.tv_sec - a.tv_sec) + (b.tv_nsec - a.tv_nsec) / 1e9;
+}
+
+static const Metrics::Totals *findLatency(const Metrics::Snapshot &snap,
+		const char *name)
+{
+	for (size_t i = 0; i < snap.latencies.size(); i++) {
+		if (snap.latencies[i].name == name)
+			return &snap.latencies[i];
+	}
+	return NULL;
+}
+
+static uint64_t findCounter(const Metrics::Snapshot &snap, const char *name)
+{
+	for (size_t i = 0; i < snap.counters.size(); i++) {
+		if (snap.counters[i].first == name)
+			return snap.counters[i].second;
+	}
+	return 0;
+}
+
+/* Within the 1/16 bucket resolution */
+static bool near(uint64_t got, uint64_t want)
+{
+	uint64_t slop = want / Metrics::SUB_BUCKETS + 1;
+	return got + slop >= want && got <= want + slop;
+}
+
+static void checkBuckets(void)
+{
+	/* Contiguous, ordered, and each value lands in its own bucket */
+	for (uint32_t i = 1; i < Metrics::NUM_BUCKETS; i++)
+		CHECK(Metrics::bucketLow(i) == Metrics::bucketHigh(i - 1) + 1);
+
+	uint64_t vals[] = { 0, 1, 31, 32, 33, 1000, 123456, 999999999ULL };
+	for (uint32_t i = 0; i < sizeof(vals) / sizeof(vals[0]); i++) {
+		uint32_t idx = Metrics::bucketIndex(vals[i]);
+		CHECK(Metrics::bucketLow(idx) <= vals[i]);
+		CHECK(Metrics::bucketHigh(idx) >= vals[i]);
+	}
+
+	/* Off the top all goes in the last bucket */
+	CHECK(Metrics::bucketIndex(~0ULL) == Metrics::NUM_BUCKETS - 1);
+}
+
+static void checkPercentiles(void)
+{
+	Metrics::Snapshot before, after;
+	Metrics::snapshot(before);
+
+	/* 1..100000 in a scrambled order */
+	for (uint64_t i = 0; i < 100000; i++)
+		Metrics::record(checkUniform, (i * 7919) % 100000 + 1);
+
+	Metrics::snapshot(after);
+
+	const Metrics::Totals *t = findLatency(after, "Check:Uniform");
+	CHECK(t != NULL);
+	if (!t)
+		return;
+
+	Metrics::LatencyStats st = Metrics::stats(*t,
+		findLatency(before, "Check:Uniform"));
+	CHECK(st.count == 100000);
+	CHECK(st.min == 1);
+	CHECK(st.max == 100000);
+	CHECK(near(st.mean, 50000));
+	CHECK(near(st.p50, 50000));
+	CHECK(near(st.p90, 90000));
+	CHECK(near(st.p99, 99000));
+	CHECK(near(st.p999, 99900));
+
+	/* Nothing new since the last snapshot, nothing to report */
+	st = Metrics::stats(*t, t);
+	CHECK(st.count == 0);
+	CHECK(st.p99 == 0);
+}
+
+static void *adder(void *arg)
+{
+	(void) arg;
+	for (uint32_t i = 0; i < THREAD_ADDS; i++)
+		Metrics::add(checkThreads);
+	return NULL;
+}
+
+static void checkThreadTotals(void)
+{
+	pthread_t threads[NUM_THREADS];
+
+	for (uint32_t i = 0; i < NUM_THREADS; i++)
+		pthread_create(&threads[i], NULL, adder, NULL);
+	for (uint32_t i = 0; i < NUM_THREADS; i++)
+		pthread_join(threads[i], NULL);
+
+	/* Exited threads' counts stay, and their shards get reused */
+	pthread_create(&threads[0], NULL, adder, NULL);
+	pthread_join(threads[0], NULL);
+
+	Metrics::Snapshot snap;
+	Metrics::snapshot(snap);
+	CHECK(findCounter(snap, "Check:Threads")
+		== (uint64_t) (NUM_THREADS + 1) * THREAD_ADDS);
+}
+
+/* Stand-in for a stage's per-packet work */
+static uint32_t work(const std::vector<uint32_t> &pkt)
+{
+	uint32_t sum = 0;
+	for (size_t i = 0; i < pkt.size(); i++)
+		sum = (sum << 1 | sum >> 31) ^ pkt[i];
+	return sum;
+}
+
+static double timeBare(const std::vector<uint32_t> &pkt, uint32_t iters,
+		uint32_t &sink)
+{
+	struct timespec t0, t1;
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (uint32_t i = 0; i < iters; i++)
+		sink += work(pkt);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+
+	return elapsed(t0, t1);
+}
+
+static double timeInstrumented(const std::vector<uint32_t> &pkt,
+		uint32_t iters, uint32_t &sink)
+{
+	struct timespec t0, t1;
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (uint32_t i = 0; i < iters; i++) {
+		Metrics::Timer timer(benchWork);
+		sink += work(pkt);
+		Metrics::add(benchPackets);
+		Metrics::add(benchBytes, pkt.size() * sizeof(uint32_t));
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+
+	return elapsed(t0, t1);
+}
+
+static void run(uint32_t pkt_bytes, uint32_t iters)
+{
+	std::vector<uint32_t> pkt(pkt_bytes / sizeof(uint32_t));
+	for (size_t i = 0; i < pkt.size(); i++)
+		pkt[i] = rand();
+
+	uint32_t sink = 0;
+
+	/* Warm up caches, and this thread's shard */
+	timeInstrumented(pkt, iters / 10, sink);
+
+	double bare = timeBare(pkt, iters, sink);
+
+	Metrics::setEnabled(false);
+	double off = timeInstrumented(pkt, iters, sink);
+	Metrics::setEnabled(true);
+	double on = timeInstrumented(pkt, iters, sink);
+
+	printf("%u byte packets (sink %08x):\n", pkt_bytes, sink);
+	printf("  bare      %8.1f ns/packet\n", bare * 1e9 / iters);
+	printf("  disabled  %8.1f ns/packet  %+6.1f ns  (%+.2f%%)\n",
+		off * 1e9 / iters, (off - bare) * 1e9 / iters,
+		(off - bare) * 100.0 / bare);
+	printf("  enabled   %8.1f ns/packet  %+6.1f ns  (%+.2f%%)\n",
+		on * 1e9 / iters, (on - bare) * 1e9 / iters,
+		(on - bare) * 100.0 / bare);
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t iters = argc > 1 ? strtoul(argv[1], NULL, 0) : 200000;
+
+	Metrics::setEnabled(true);
+
+	checkBuckets();
+	checkPercentiles();
+	checkThreadTotals();
+
+	/* A small meta-data packet, a typical event packet, a big one */
+	run(64, iters * 10);
+	run(4096, iters);
+	run(65536, iters / 10);
+
+	Metrics::Snapshot snap;
+	Metrics::snapshot(snap);
+	printf("\n%s", Metrics::report(snap, NULL).c_str());
+
+	if (failures) {
+		fprintf(stderr, "%d check(s) failed\n", failures);
+		return 1;
+	}
+
+	return 0;
+}
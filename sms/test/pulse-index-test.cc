@@ -0,0 +1,402 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "ADARA.h"
+#include "ADARAPulseIndex.h"
+#include "PulseIndexWriter.h"
+
+/* Checks the pulse index sidecar writer against the reader:
+ *
+ *   - a synthetic data file (a copied-in prologue, then pulses with
+ *     stragglers from earlier pulses mixed in) goes through the writer
+ *     in random iovec splits, so packet headers straddle iovecs,
+ *   - the sidecar's layout: header, entries, type counts and footer,
+ *     with every entry on the first packet of a new highest pulse id,
+ *     no closer than the index distance, and type counts to match,
+ *   - seekPulse() before, on, between and after the entries, and that
+ *     reading from where it says never misses a packet for the pulse,
+ *   - an index from a file still being written (no footer), cut off
+ *     mid-entry, or too short for a header,
+ *   - a gap in the data drops the sidecar altogether.
+ */
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+	if (!(cond)) { \
+		fprintf(stderr, "%s:%d: check failed: %s\n", \
+			__FILE__, __LINE__, #cond); \
+		failures++; \
+	} \
+} while (0)
+
+#define INDEX_DISTANCE	4096
+
+typedef std::vector<uint8_t> Bytes;
+
+struct Packet {
+	uint64_t offset;
+	uint32_t base_type;
+	uint64_t pulse;
+};
+
+static void addPacket(Bytes &out, uint32_t type, uint64_t pulse,
+		uint32_t payload_len)
+{
+	ADARA::Header hdr;
+	hdr.payload_len = payload_len;
+	hdr.pkt_format = ADARA_PKT_TYPE(type, 0);
+	hdr.ts_sec = pulse >> 32;
+	hdr.ts_nsec = pulse & 0xffffffff;
+
+	size_t at = out.size();
+	out.resize(at + sizeof(hdr) + payload_len, 0x5a);
+	memcpy(&out[at], &hdr, sizeof(hdr));
+}
+
+static std::vector<Packet> packets(const Bytes &data)
+{
+	std::vector<Packet> pkts;
+	uint64_t off = 0;
+
+	while (off + sizeof(ADARA::Header) <= data.size()) {
+		const ADARA::Header *hdr = (const ADARA::Header *) &data[off];
+		Packet p;
+		p.offset = off;
+		p.base_type = ADARA_BASE_PKT_TYPE(hdr->pkt_format);
+		p.pulse = ((uint64_t) hdr->ts_sec << 32) | hdr->ts_nsec;
+		pkts.push_back(p);
+		off += sizeof(*hdr) + hdr->payload_len;
+	}
+
+	return pkts;
+}
+
+static bool isPulse(uint32_t base_type)
+{
+	return base_type == ADARA::PacketType::RTDL_TYPE
+		|| base_type == ADARA::PacketType::BANKED_EVENT_TYPE
+		|| base_type == ADARA::PacketType::BEAM_MONITOR_EVENT_TYPE;
+}
+
+static uint64_t pulseId(uint32_t n)
+{
+	uint64_t ns = 900000000ULL * 1000000000ULL + n * 16666666ULL;
+	return ((ns / 1000000000ULL) << 32) | (ns % 1000000000ULL);
+}
+
+/* Run state, as StorageFile copies in from the prologue file */
+static void makePrologue(Bytes &out)
+{
+	addPacket(out, ADARA::PacketType::RUN_INFO_TYPE, pulseId(0), 400);
+	addPacket(out, ADARA::PacketType::GEOMETRY_TYPE, pulseId(0), 2000);
+	for (uint32_t d = 0; d < 5; d++)
+		addPacket(out, ADARA::PacketType::DEVICE_DESC_TYPE,
+			pulseId(0), 300);
+}
+
+/* Pulses, each of RTDL and banked events, with now and then a beam
+ * monitor packet from the pulse before, a PV update or a sync packet.
+ */
+static void makePulses(Bytes &out, uint32_t pulses)
+{
+	for (uint32_t n = 1; n <= pulses; n++) {
+		addPacket(out, ADARA::PacketType::RTDL_TYPE, pulseId(n), 120);
+		addPacket(out, ADARA::PacketType::BANKED_EVENT_TYPE,
+			pulseId(n), 16 + 8 * (rand() % 300));
+
+		if (n > 1 && rand() % 4 == 0)
+			addPacket(out, ADARA::PacketType::BEAM_MONITOR_EVENT_TYPE,
+				pulseId(n - 1), 16 + 8 * (rand() % 20));
+		if (rand() % 5 == 0)
+			addPacket(out, ADARA::PacketType::VAR_VALUE_DOUBLE_TYPE,
+				pulseId(n), 20);
+		if (rand() % 50 == 0)
+			addPacket(out, ADARA::PacketType::SYNC_TYPE, pulseId(n), 28);
+	}
+}
+
+/* Hand data to the writer as StorageFile would: len bytes at a time, cut
+ * into random iovecs.
+ */
+static void feed(PulseIndexWriter &w, const Bytes &data, uint64_t from,
+		uint64_t to)
+{
+	std::vector<struct iovec> vec;
+
+	while (from < to) {
+		uint32_t len = 1 + rand() % 20000;
+		if (from + len > to)
+			len = to - from;
+
+		vec.clear();
+		uint32_t done = 0;
+		while (done < len) {
+			uint32_t n = 1 + rand() % 40;
+			if (rand() % 3 == 0)
+				n = 1 + rand() % 8000;
+			if (done + n > len)
+				n = len - done;
+			struct iovec v = { (void *) &data[from + done], n };
+			vec.push_back(v);
+			done += n;
+		}
+
+		w.data(from, &vec.front(), vec.size(), len);
+		if (w.pending() >= PulseIndexWriter::FLUSH_ENTRIES)
+			w.flush();
+		from += len;
+	}
+}
+
+static bool writeFile(int dir_fd, const std::string &name, const Bytes &data)
+{
+	int fd = openat(dir_fd, name.c_str(), O_CREAT|O_TRUNC|O_RDWR, 0660);
+	if (fd < 0)
+		return false;
+	bool ok = write(fd, &data[0], data.size()) == (ssize_t) data.size();
+	return !close(fd) && ok;
+}
+
+static off_t fileSize(const std::string &path)
+{
+	struct stat st;
+	return stat(path.c_str(), &st) ? -1 : st.st_size;
+}
+
+static void checkEntries(const ADARA::PulseIndex &idx, const Bytes &data)
+{
+	std::vector<Packet> pkts = packets(data);
+	std::map<uint64_t, const Packet *> at;
+	for (uint32_t i = 0; i < pkts.size(); i++)
+		at[pkts[i].offset] = &pkts[i];
+
+	CHECK(idx.numEntries() > 10);
+
+	for (uint64_t e = 0; e < idx.numEntries(); e++) {
+		const ADARA::PulseIndexEntry &ent = idx.entry(e);
+
+		/* On a packet of the pulse named, the first of any pulse
+		 * that high
+		 */
+		CHECK(at.count(ent.offset) == 1);
+		if (!at.count(ent.offset))
+			continue;
+		const Packet *p = at[ent.offset];
+		CHECK(isPulse(p->base_type));
+		CHECK(p->pulse == ent.pulse_id);
+		for (uint32_t i = 0; i < pkts.size()
+				&& pkts[i].offset < ent.offset; i++)
+			CHECK(!isPulse(pkts[i].base_type)
+				|| pkts[i].pulse < ent.pulse_id);
+
+		if (e) {
+			const ADARA::PulseIndexEntry &prev = idx.entry(e - 1);
+			CHECK(ent.pulse_id > prev.pulse_id);
+			CHECK(ent.offset >= prev.offset + INDEX_DISTANCE);
+			CHECK(((uint64_t) ent.wall_sec << 32 | ent.wall_nsec)
+				>= ((uint64_t) prev.wall_sec << 32
+					| prev.wall_nsec));
+		}
+	}
+}
+
+static void checkSeek(const ADARA::PulseIndex &idx, const Bytes &data)
+{
+	uint64_t n = idx.numEntries();
+	if (!n)
+		return;
+
+	const ADARA::PulseIndexEntry &first = idx.entry(0);
+	const ADARA::PulseIndexEntry &last = idx.entry(n - 1);
+
+	CHECK(idx.seekPulse(0) == 0);
+	CHECK(idx.seekPulse(first.pulse_id - 1) == 0);
+	CHECK(idx.seekPulse(first.pulse_id) == first.offset);
+	CHECK(idx.seekPulse(last.pulse_id) == last.offset);
+	CHECK(idx.seekPulse(last.pulse_id + 1) == last.offset);
+	CHECK(idx.seekPulse(~0ULL) == last.offset);
+
+	for (uint64_t e = 1; e < n; e++) {
+		const ADARA::PulseIndexEntry &prev = idx.entry(e - 1);
+		const ADARA::PulseIndexEntry &ent = idx.entry(e);
+		CHECK(idx.seekPulse(ent.pulse_id) == ent.offset);
+		CHECK(idx.seekPulse(ent.pulse_id - 1) == prev.offset);
+	}
+
+	CHECK(idx.seekTime(0, 0) == 0);
+	CHECK(idx.seekTime(last.wall_sec, last.wall_nsec) == last.offset);
+
+	/* Starting where seekPulse() says, nothing for the pulse (or any
+	 * later one) is missed
+	 */
+	std::vector<Packet> pkts = packets(data);
+	for (uint32_t i = 0; i < pkts.size(); i++) {
+		if (!isPulse(pkts[i].base_type))
+			continue;
+		uint64_t from = idx.seekPulse(pkts[i].pulse);
+		CHECK(from <= pkts[i].offset);
+	}
+}
+
+static void checkTypes(const ADARA::PulseIndex &idx, const Bytes &data)
+{
+	std::map<uint32_t, uint64_t> want;
+	std::vector<Packet> pkts = packets(data);
+	for (uint32_t i = 0; i < pkts.size(); i++)
+		want[pkts[i].base_type]++;
+
+	std::map<uint32_t, uint64_t> got;
+	for (uint32_t t = 0; t < idx.numTypes(); t++) {
+		CHECK(!got.count(idx.typeCount(t).pkt_type));
+		got[idx.typeCount(t).pkt_type] = idx.typeCount(t).count;
+	}
+
+	CHECK(got == want);
+}
+
+static void checkTruncated(const std::string &path, uint64_t entries)
+{
+	ADARA::PulseIndex idx;
+	off_t entries_end = sizeof(ADARA::PulseIndexHeader)
+		+ entries * sizeof(ADARA::PulseIndexEntry);
+
+	/* Cut off half way through an entry */
+	off_t cut = entries_end - sizeof(ADARA::PulseIndexEntry) / 2;
+	CHECK(truncate(path.c_str(), cut) == 0);
+	CHECK(idx.open(path));
+	CHECK(!idx.complete());
+	CHECK(idx.numEntries() == entries - 1);
+	CHECK(idx.numTypes() == 0);
+	if (idx.numEntries()) {
+		const ADARA::PulseIndexEntry &last
+			= idx.entry(idx.numEntries() - 1);
+		CHECK(idx.seekPulse(~0ULL) == last.offset);
+	}
+
+	/* Just the header; nothing to seek by */
+	CHECK(truncate(path.c_str(), sizeof(ADARA::PulseIndexHeader)) == 0);
+	CHECK(idx.open(path));
+	CHECK(idx.numEntries() == 0);
+	CHECK(idx.seekPulse(~0ULL) == 0);
+
+	/* Not even that */
+	CHECK(truncate(path.c_str(), sizeof(ADARA::PulseIndexHeader) - 1)
+		== 0);
+	CHECK(!idx.open(path));
+	CHECK(idx.numEntries() == 0);
+}
+
+static void checkSidecarPath(void)
+{
+	CHECK(ADARA::PulseIndex::sidecarPath(
+			"m00000001-f00000002-run-1234.adara")
+		== "m00000001-f00000002-run-1234.pidx");
+	CHECK(ADARA::PulseIndex::sidecarPath("dir.adara/f00000001.adara")
+		== "dir.adara/f00000001.pidx");
+	CHECK(ADARA::PulseIndex::sidecarPath("f00000001.adara.ztmp")
+		== "f00000001.adara.ztmp.pidx");
+}
+
+int main(void)
+{
+	char dir[] = "/tmp/pulse-index-test-XXXXXX";
+	if (mkdtemp(dir) == NULL) {
+		perror("mkdtemp");
+		return 1;
+	}
+	int dir_fd = open(dir, O_RDONLY);
+	std::string idx_path = std::string(dir) + "/f00000001.pidx";
+
+	checkSidecarPath();
+
+	Bytes prologue, data;
+	makePrologue(prologue);
+	CHECK(writeFile(dir_fd, "prologue.adara", prologue));
+	data = prologue;
+	makePulses(data, 3000);
+
+	PulseIndexWriter w;
+	CHECK(w.open(dir_fd, "f00000001.adara", INDEX_DISTANCE));
+	CHECK(w.active());
+	CHECK(w.path() == "f00000001.pidx");
+
+	/* The prologue comes in by copy, like catFile() */
+	int src_fd = openat(dir_fd, "prologue.adara", O_RDONLY);
+	CHECK(src_fd >= 0);
+	w.copied(src_fd, 0, prologue.size());
+	close(src_fd);
+
+	/* Part way, an index with no footer is good for what's there */
+	feed(w, data, prologue.size(), data.size() / 2);
+	w.flush();
+	{
+		ADARA::PulseIndex idx;
+		CHECK(idx.open(idx_path));
+		CHECK(!idx.complete());
+		CHECK(idx.numEntries() > 0);
+		checkEntries(idx, data);
+	}
+
+	feed(w, data, data.size() / 2, data.size());
+	w.close();
+	CHECK(!w.active());
+	CHECK(w.path() == "f00000001.pidx");
+
+	ADARA::PulseIndex idx;
+	CHECK(idx.open(idx_path));
+	CHECK(idx.complete());
+	CHECK(fileSize(idx_path) == (off_t) (sizeof(ADARA::PulseIndexHeader)
+		+ idx.numEntries() * sizeof(ADARA::PulseIndexEntry)
+		+ idx.numTypes() * sizeof(ADARA::PulseIndexTypeCount)
+		+ sizeof(ADARA::PulseIndexFooter)));
+
+	checkEntries(idx, data);
+	checkSeek(idx, data);
+	checkTypes(idx, data);
+
+	uint64_t entries = idx.numEntries();
+	idx.close();
+	checkTruncated(idx_path, entries);
+
+	/* A gap in the data loses the framing; no index beats a wrong one */
+	PulseIndexWriter gap;
+	CHECK(gap.open(dir_fd, "f00000002.adara", INDEX_DISTANCE));
+	feed(gap, data, 0, 1000);
+	feed(gap, data, data.size() / 2, data.size());
+	CHECK(!gap.active());
+	CHECK(gap.path().empty());
+	CHECK(fileSize(std::string(dir) + "/f00000002.pidx") == -1);
+
+	/* Going with its data file */
+	PulseIndexWriter gone;
+	CHECK(gone.open(dir_fd, "f00000003.adara", INDEX_DISTANCE));
+	gone.close();
+	CHECK(fileSize(std::string(dir) + "/f00000003.pidx") > 0);
+	gone.remove();
+	CHECK(fileSize(std::string(dir) + "/f00000003.pidx") == -1);
+
+	unlinkat(dir_fd, "f00000001.pidx", 0);
+	unlinkat(dir_fd, "prologue.adara", 0);
+	close(dir_fd);
+	rmdir(dir);
+
+	if (failures) {
+		fprintf(stderr, "%d check(s) failed\n", failures);
+		return 1;
+	}
+
+	printf("Pulse index OK.\n");
+
+	return 0;
+}
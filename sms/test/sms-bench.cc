@@ -0,0 +1,1094 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <stdexcept>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <dirent.h>
+#include <time.h>
+
+#include <boost/program_options.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+
+#include "ADARA.h"
+#include "PulseGenerator.h"
+
+/* End-to-end smsd throughput and latency harness.
+ *
+ * The harness starts an smsd against a scratch directory, serving as
+ * its preprocessor data sources, its STC and (optionally) some live
+ * clients, all over loopback:
+ *
+ *   generators -> smsd (DataSource -> SMSControl -> StorageManager)
+ *       -> storage files, tailed by the harness
+ *       -> LiveClient connections
+ *       -> STC stand-in (when runs are started with --run-start-cmd)
+ *
+ * Every pulse is stamped with its slot on a fixed pulse clock, and the
+ * time the last source finished writing it is remembered. Each banked
+ * event and beam monitor packet that shows up in the storage files or
+ * on a live connection is matched back to its pulse, giving ingest to
+ * disk (page cache, really) and ingest to live client latencies.
+ * Storage files are polled every --poll-us, which bounds the disk
+ * latency resolution.
+ *
+ * After a warm-up period, the harness measures for --duration seconds
+ * and writes the results, including the CPU used by each smsd thread,
+ * as JSON.
+ */
+
+namespace po = boost::program_options;
+namespace fs = boost::filesystem;
+
+static std::string smsd_path = "sms/smsd";
+static std::string geometry_path = "sms/conf/geometry.xml";
+static std::string pixelmap_path = "sms/conf/pixelmap";
+static std::string workdir;
+static bool keep_workdir = false;
+static std::string output_path;
+static std::vector<std::string> extra_sources;
+static std::string run_start_cmd;
+static std::string run_stop_cmd;
+
+static uint16_t base_port = 32416;
+static uint16_t live_port = 32415;
+static uint16_t stc_port = 32417;
+static uint32_t num_sources = 1;
+static uint32_t live_clients = 1;
+static double pulse_hz = 60.0;
+static uint32_t events_per_pulse = 10000;
+static uint32_t max_packet = 32768;
+static uint32_t num_pixels = 1024;
+static std::string poolsize = "1G";
+static bool rx_thread = false;
+static double warmup = 5.0;
+static double duration = 30.0;
+static uint32_t poll_us = 1000;
+static double startup_timeout = 60.0;
+
+static uint64_t pulse_ns;
+static uint64_t start_mono_ns;
+static uint64_t start_real_ns;
+
+static volatile bool stopping = false;
+static volatile bool measuring = false;
+
+static uint64_t monoNow(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint64_t realNow(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static bool writeAll(int fd, const void *buf, size_t len)
+{
+	const uint8_t *p = (const uint8_t *) buf;
+	while (len) {
+		ssize_t rc = write(fd, p, len);
+		if (rc < 0) {
+			if (errno == EINTR)
+				continue;
+			return false;
+		}
+		p += rc;
+		len -= rc;
+	}
+	return true;
+}
+
+/* When each pulse was completely sent, by pulse number */
+class SentPulses {
+public:
+	SentPulses() {
+		for (uint32_t i = 0; i < RING; i++)
+			m_ring[i].m_pulse = ~0ULL;
+	}
+
+	void sent(uint64_t pulse, uint64_t mono_ns) {
+		boost::mutex::scoped_lock lock(m_mutex);
+		Slot &s = m_ring[pulse % RING];
+		if (s.m_pulse != pulse) {
+			s.m_pulse = pulse;
+			s.m_done = mono_ns;
+			s.m_sources = 1;
+		} else {
+			if (mono_ns > s.m_done)
+				s.m_done = mono_ns;
+			s.m_sources++;
+		}
+	}
+
+	/* Only pulses all sources have finished with count */
+	bool lookup(uint64_t pulse, uint64_t &mono_ns) {
+		boost::mutex::scoped_lock lock(m_mutex);
+		Slot &s = m_ring[pulse % RING];
+		if (s.m_pulse != pulse || s.m_sources < num_sources)
+			return false;
+		mono_ns = s.m_done;
+		return true;
+	}
+
+private:
+	enum { RING = 16384 };
+
+	struct Slot {
+		uint64_t	m_pulse;
+		uint64_t	m_done;
+		uint32_t	m_sources;
+	};
+
+	boost::mutex	m_mutex;
+	Slot		m_ring[RING];
+};
+
+static SentPulses sent_pulses;
+
+class Latency {
+public:
+	void add(uint64_t ns) { m_us.push_back((uint32_t) (ns / 1000)); }
+
+	void merge(const Latency &o) {
+		m_us.insert(m_us.end(), o.m_us.begin(), o.m_us.end());
+	}
+
+	void json(std::ostream &os) {
+		std::sort(m_us.begin(), m_us.end());
+
+		os << "{ \"count\": " << m_us.size();
+		if (!m_us.empty()) {
+			os << ", \"min\": " << m_us.front()
+				<< ", \"p50\": " << pct(0.5)
+				<< ", \"p90\": " << pct(0.9)
+				<< ", \"p99\": " << pct(0.99)
+				<< ", \"p999\": " << pct(0.999)
+				<< ", \"max\": " << m_us.back();
+		}
+
+		/* Power of two buckets, by upper bound */
+		os << ", \"histogram\": [";
+		uint32_t i = 0;
+		const char *sep = "";
+		for (uint64_t le = 1; i < m_us.size(); le <<= 1) {
+			uint32_t n = 0;
+			while (i < m_us.size() && m_us[i] <= le) {
+				n++;
+				i++;
+			}
+			if (n) {
+				os << sep << "[" << le << ", " << n << "]";
+				sep = ", ";
+			}
+		}
+		os << "] }";
+	}
+
+private:
+	std::vector<uint32_t> m_us;
+
+	uint32_t pct(double p) {
+		size_t i = (size_t) (p * (m_us.size() - 1) + 0.5);
+		return m_us[i];
+	}
+};
+
+/* Reassembles packets from a byte stream and collects the statistics
+ * for the pulses they belong to.
+ */
+class PacketSink {
+public:
+	PacketSink() : m_bytes(0), m_packets(0), m_events(0) { }
+
+	void feed(const uint8_t *data, size_t len) {
+		if (measuring)
+			m_bytes += len;
+
+		m_buf.insert(m_buf.end(), data, data + len);
+
+		size_t pos = 0;
+		while (m_buf.size() - pos >= sizeof(ADARA::Header)) {
+			const uint32_t *hdr = (const uint32_t *) &m_buf[pos];
+			size_t pkt_len = sizeof(ADARA::Header) + hdr[0];
+			if (m_buf.size() - pos < pkt_len)
+				break;
+			packet(hdr, pkt_len);
+			pos += pkt_len;
+		}
+		m_buf.erase(m_buf.begin(), m_buf.begin() + pos);
+	}
+
+	uint64_t	m_bytes;
+	uint64_t	m_packets;
+	uint64_t	m_events;
+	Latency		m_latency;
+
+private:
+	std::vector<uint8_t>	m_buf;
+
+	void packet(const uint32_t *hdr, size_t len) {
+		uint32_t base = ADARA_BASE_PKT_TYPE(hdr[1]);
+		bool state = false;
+
+		switch (base) {
+		case ADARA::PacketType::BANKED_EVENT_STATE_TYPE:
+			state = true;
+			/* fall through */
+		case ADARA::PacketType::BANKED_EVENT_TYPE:
+			if (measuring)
+				m_events += bankedEvents(hdr, len, state);
+			break;
+		case ADARA::PacketType::BEAM_MONITOR_EVENT_TYPE:
+			break;
+		default:
+			return;
+		}
+
+		/* Pulse ids are the generator's pulse clock slots */
+		uint64_t real = ( (uint64_t) hdr[2] + ADARA::EPICS_EPOCH_OFFSET )
+			* 1000000000ULL + hdr[3];
+		if (real < start_real_ns || ( real - start_real_ns ) % pulse_ns)
+			return;
+
+		uint64_t sent;
+		if (!sent_pulses.lookup(( real - start_real_ns ) / pulse_ns, sent))
+			return;
+
+		if (measuring) {
+			uint64_t now = monoNow();
+			m_latency.add(now > sent ? now - sent : 0);
+			m_packets++;
+		}
+	}
+
+	uint32_t bankedEvents(const uint32_t *hdr, size_t len, bool state) {
+		const uint32_t *rpos = hdr + 4 + 4;
+		const uint32_t *end = hdr + len / sizeof(uint32_t);
+		uint32_t bank_hdr = state ? 3 : 2;
+		uint32_t events = 0;
+
+		while (end - rpos >= 4) {
+			uint32_t banks = rpos[3];
+			rpos += 4;
+			while (banks--) {
+				if ((uint32_t) (end - rpos) < bank_hdr)
+					return events;
+				uint32_t n = rpos[bank_hdr - 1];
+				rpos += bank_hdr;
+				if ((uint32_t) (end - rpos) / 2 < n)
+					return events;
+				rpos += 2 * n;
+				events += n;
+			}
+		}
+		return events;
+	}
+};
+
+static int listenOn(uint16_t port)
+{
+	struct sockaddr_in addr;
+	int fd, val = 1;
+
+	fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (fd < 0)
+		throw std::runtime_error("Unable to create socket");
+
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &val, sizeof(val));
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = htons(port);
+
+	if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) || listen(fd, 4)) {
+		std::stringstream ss;
+		ss << "Unable to listen on port " << port << ": "
+			<< strerror(errno);
+		close(fd);
+		throw std::runtime_error(ss.str());
+	}
+
+	return fd;
+}
+
+/* Waits for a connection, giving up when the harness stops */
+static int acceptOne(int listen_fd)
+{
+	while (!stopping) {
+		struct timeval tv = { 0, 200000 };
+		fd_set fds;
+		FD_ZERO(&fds);
+		FD_SET(listen_fd, &fds);
+		if (select(listen_fd + 1, &fds, NULL, NULL, &tv) <= 0)
+			continue;
+
+		int fd = accept(listen_fd, NULL, NULL);
+		if (fd >= 0)
+			return fd;
+	}
+	return -1;
+}
+
+/* The generator settings shared by all sources: plain pixel ids
+ * 0..num_pixels-1, and a single beam monitor event per pulse, for
+ * monitor packet latency.
+ */
+static ADARA::PulseGenerator::Config genConfig(void)
+{
+	ADARA::PulseGenerator::Config cfg;
+
+	cfg.m_sources = num_sources;
+	cfg.m_eventsPerPulse = events_per_pulse;
+	cfg.m_maxPacket = max_packet;
+	cfg.m_pulseNs = pulse_ns;
+	cfg.m_monitorEvents = 1;
+	cfg.m_choppers = 0;
+	for (uint32_t i = 0; i < num_pixels; i++)
+		cfg.m_pixels.push_back(i);
+
+	return cfg;
+}
+
+/* A preprocessor stand-in; pulses are pre-built by the PulseGenerator
+ * (as for adara-loadgen), so sending costs no more than the writes.
+ */
+class Generator {
+public:
+	Generator(uint32_t index) :
+		m_connected(false), m_events(0), m_pulses(0), m_late(0),
+		m_gen(genConfig(), index)
+	{
+		m_listen = listenOn(base_port + index);
+	}
+
+	void start(void) {
+		m_thread = boost::thread(boost::bind(&Generator::run, this));
+	}
+
+	void join(void) { m_thread.join(); }
+
+	volatile bool		m_connected;
+	volatile uint64_t	m_events;
+	volatile uint64_t	m_pulses;
+	volatile uint64_t	m_late;
+
+private:
+	ADARA::PulseGenerator	m_gen;
+	int			m_listen;
+	boost::thread		m_thread;
+
+	void stream(int fd) {
+		uint64_t pulse = ( monoNow() - start_mono_ns ) / pulse_ns + 1;
+
+		while (!stopping) {
+			uint64_t deadline = start_mono_ns + pulse * pulse_ns;
+			struct timespec dl;
+			dl.tv_sec = deadline / 1000000000ULL;
+			dl.tv_nsec = deadline % 1000000000ULL;
+
+			if (monoNow() > deadline + pulse_ns) {
+				if (measuring)
+					m_late++;
+			} else
+				clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME,
+					&dl, NULL);
+
+			const std::vector<uint32_t> &words = m_gen.pulse(pulse,
+				start_real_ns + pulse * pulse_ns);
+			if (!writeAll(fd, &words[0],
+					words.size() * sizeof(uint32_t)))
+				return;
+			sent_pulses.sent(pulse, monoNow());
+
+			if (measuring) {
+				m_events += m_gen.events();
+				m_pulses++;
+			}
+			pulse++;
+		}
+	}
+
+	void run(void) {
+		while (!stopping) {
+			int fd = acceptOne(m_listen);
+			if (fd < 0)
+				break;
+			int val = 1;
+			setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &val, sizeof(val));
+			m_connected = true;
+			stream(fd);
+			m_connected = false;
+			close(fd);
+		}
+	}
+};
+
+/* Stands in for the STC: swallow the run, then report success */
+class STCStandIn {
+public:
+	STCStandIn() : m_runs(0), m_bytes(0) {
+		m_listen = listenOn(stc_port);
+	}
+
+	void start(void) {
+		m_thread = boost::thread(boost::bind(&STCStandIn::run, this));
+	}
+
+	void join(void) { m_thread.join(); }
+
+	volatile uint64_t	m_runs;
+	volatile uint64_t	m_bytes;
+
+private:
+	int		m_listen;
+	boost::thread	m_thread;
+
+	void run(void) {
+		std::vector<uint8_t> buf(1024 * 1024);
+
+		while (!stopping) {
+			int fd = acceptOne(m_listen);
+			if (fd < 0)
+				break;
+
+			/* SMS half-closes the connection after the run */
+			ssize_t rc;
+			while ((rc = read(fd, &buf[0], buf.size())) > 0)
+				m_bytes += rc;
+
+			static const char reason[] = "sms-bench";
+			uint32_t pkt[4 + 1 + 3];
+			memset(pkt, 0, sizeof(pkt));
+			pkt[0] = sizeof(uint32_t) + sizeof(reason) - 1;
+			pkt[1] = ADARA_PKT_TYPE(
+				ADARA::PacketType::TRANS_COMPLETE_TYPE,
+				ADARA::PacketType::TRANS_COMPLETE_VERSION);
+			pkt[4] = sizeof(reason) - 1;
+			memcpy(&pkt[5], reason, sizeof(reason) - 1);
+			writeAll(fd, pkt, sizeof(ADARA::Header) + pkt[0]);
+
+			close(fd);
+			m_runs++;
+		}
+	}
+};
+
+/* A live client asking for everything from now on */
+class LiveReader {
+public:
+	LiveReader() : m_connected(false) { }
+
+	void start(void) {
+		m_thread = boost::thread(boost::bind(&LiveReader::run, this));
+	}
+
+	void join(void) { m_thread.join(); }
+
+	volatile bool	m_connected;
+	PacketSink	m_sink;
+
+private:
+	boost::thread	m_thread;
+
+	int connect(void) {
+		struct sockaddr_in addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		addr.sin_port = htons(live_port);
+
+		while (!stopping) {
+			int fd = socket(AF_INET, SOCK_STREAM, 0);
+			if (fd < 0)
+				return -1;
+			if (!::connect(fd, (struct sockaddr *) &addr, sizeof(addr)))
+				return fd;
+			close(fd);
+			usleep(200000);
+		}
+		return -1;
+	}
+
+	void run(void) {
+		int fd = connect();
+		if (fd < 0)
+			return;
+
+		uint32_t hello[4 + 2];
+		memset(hello, 0, sizeof(hello));
+		hello[0] = 2 * sizeof(uint32_t);
+		hello[1] = ADARA_PKT_TYPE(ADARA::PacketType::CLIENT_HELLO_TYPE,
+			ADARA::PacketType::CLIENT_HELLO_VERSION);
+		hello[2] = realNow() / 1000000000ULL - ADARA::EPICS_EPOCH_OFFSET;
+		if (!writeAll(fd, hello, sizeof(hello))) {
+			close(fd);
+			return;
+		}
+
+		m_connected = true;
+
+		std::vector<uint8_t> buf(1024 * 1024);
+		while (!stopping) {
+			struct timeval tv = { 0, 200000 };
+			fd_set fds;
+			FD_ZERO(&fds);
+			FD_SET(fd, &fds);
+			if (select(fd + 1, &fds, NULL, NULL, &tv) <= 0)
+				continue;
+
+			ssize_t rc = read(fd, &buf[0], buf.size());
+			if (rc <= 0)
+				break;
+			m_sink.feed(&buf[0], rc);
+		}
+
+		m_connected = false;
+		close(fd);
+	}
+};
+
+/* Follows every storage file smsd writes */
+class StorageTail {
+public:
+	StorageTail(const std::string &dir) : m_files(0), m_dir(dir) { }
+
+	void start(void) {
+		m_thread = boost::thread(boost::bind(&StorageTail::run, this));
+	}
+
+	void join(void) { m_thread.join(); }
+
+	PacketSink	m_sink;
+	volatile uint64_t	m_files;
+
+private:
+	struct File {
+		int		m_fd;
+		PacketSink	*m_sink;
+	};
+
+	std::string		m_dir;
+	std::map<std::string, File>	m_open;
+	boost::thread		m_thread;
+
+	void scan(void) {
+		boost::system::error_code ec;
+		fs::recursive_directory_iterator it(m_dir, ec), end;
+
+		for (; !ec && it != end; it.increment(ec)) {
+			if (it->path().extension() != ".adara")
+				continue;
+
+			std::string path = it->path().string();
+			if (m_open.count(path))
+				continue;
+
+			int fd = open(path.c_str(), O_RDONLY);
+			if (fd < 0)
+				continue;
+
+			/* Each file is a packet stream of its own */
+			File f;
+			f.m_fd = fd;
+			f.m_sink = new PacketSink;
+			m_open[path] = f;
+			m_files++;
+		}
+	}
+
+	void run(void) {
+		std::vector<uint8_t> buf(4 * 1024 * 1024);
+		uint64_t last_scan = 0;
+
+		while (!stopping) {
+			uint64_t now = monoNow();
+			if (now - last_scan > 100000000ULL) {
+				scan();
+				last_scan = now;
+			}
+
+			std::map<std::string, File>::iterator it;
+			for (it = m_open.begin(); it != m_open.end(); ++it) {
+				ssize_t rc;
+				while ((rc = read(it->second.m_fd, &buf[0],
+						buf.size())) > 0) {
+					it->second.m_sink->feed(&buf[0], rc);
+				}
+			}
+
+			usleep(poll_us);
+		}
+
+		std::map<std::string, File>::iterator it;
+		for (it = m_open.begin(); it != m_open.end(); ++it) {
+			PacketSink *s = it->second.m_sink;
+			m_sink.m_bytes += s->m_bytes;
+			m_sink.m_packets += s->m_packets;
+			m_sink.m_events += s->m_events;
+			m_sink.m_latency.merge(s->m_latency);
+			close(it->second.m_fd);
+			delete s;
+		}
+	}
+};
+
+struct ThreadCPU {
+	std::string	m_name;
+	uint64_t	m_ticks;
+};
+
+typedef std::map<int, ThreadCPU> ThreadMap;
+
+static void sampleThreads(pid_t pid, ThreadMap &threads)
+{
+	std::stringstream dir;
+	dir << "/proc/" << pid << "/task";
+
+	DIR *d = opendir(dir.str().c_str());
+	if (!d)
+		return;
+
+	struct dirent *ent;
+	while ((ent = readdir(d)) != NULL) {
+		if (ent->d_name[0] == '.')
+			continue;
+
+		std::ifstream f((dir.str() + "/" + ent->d_name + "/stat").c_str());
+		std::string stat;
+		if (!getline(f, stat))
+			continue;
+
+		/* The name may contain spaces, so find its closing paren */
+		size_t open = stat.find('('), close = stat.rfind(')');
+		if (open == std::string::npos || close == std::string::npos)
+			continue;
+
+		std::istringstream rest(stat.substr(close + 2));
+		std::string field;
+		uint64_t utime = 0, stime = 0;
+		/* utime and stime are fields 14 and 15; rest starts at 3 */
+		for (int i = 3; i <= 15 && rest >> field; i++) {
+			if (i == 14)
+				utime = strtoull(field.c_str(), NULL, 10);
+			else if (i == 15)
+				stime = strtoull(field.c_str(), NULL, 10);
+		}
+
+		ThreadCPU &t = threads[atoi(ent->d_name)];
+		t.m_name = stat.substr(open + 1, close - open - 1);
+		t.m_ticks = utime + stime;
+	}
+	closedir(d);
+}
+
+static std::string jsonString(const std::string &s)
+{
+	std::string out = "\"";
+	for (size_t i = 0; i < s.size(); i++) {
+		char c = s[i];
+		if (c == '"' || c == '\\')
+			out += '\\';
+		if ((unsigned char) c < 0x20)
+			continue;
+		out += c;
+	}
+	return out + "\"";
+}
+
+static void writeConfig(void)
+{
+	fs::create_directories(workdir + "/data");
+
+	std::ofstream log((workdir + "/logging.conf").c_str());
+	log << "log4j.appender.console=org.apache.log4j.ConsoleAppender\n"
+		<< "log4j.appender.console.layout=org.apache.log4j.PatternLayout\n"
+		<< "log4j.appender.console.layout.ConversionPattern="
+			"%d %p %c - %m%n\n"
+		<< "log4j.rootLogger=INFO, console\n";
+
+	std::ofstream conf((workdir + "/smsd.conf").c_str());
+	conf << "[sms]\n"
+		<< "\tbasedir = " << workdir << "\n"
+		<< "\tgeometry_file = " << fs::absolute(geometry_path).string()
+			<< "\n"
+		<< "\tpixelmap_file = " << fs::absolute(pixelmap_path).string()
+			<< "\n"
+		<< "\tfacility = SNS\n"
+		<< "\tbeamline_id = BL99Z\n"
+		<< "\tbeamline_longname = SMSBENCH\n"
+		<< "\tbeamline_shortname = BENCH\n"
+		<< "\n";
+
+	for (uint32_t i = 0; i < num_sources; i++) {
+		conf << "[source \"bench" << i << "\"]\n"
+			<< "\turi = 127.0.0.1:" << ( base_port + i ) << "\n"
+			<< "\trequired = true\n"
+			<< "\tconnect_retry = 1.0\n"
+			<< "\trx_thread = " << ( rx_thread ? "true" : "false" )
+				<< "\n\n";
+	}
+	for (uint32_t i = 0; i < extra_sources.size(); i++) {
+		conf << "[source \"extra" << i << "\"]\n"
+			<< "\turi = " << extra_sources[i] << "\n"
+			<< "\tconnect_retry = 1.0\n\n";
+	}
+
+	conf << "[storage]\n"
+		<< "\tpoolsize = " << poolsize << "\n\n"
+		<< "[combus]\n"
+		<< "\tdomain = SNS.BENCH\n"
+		<< "\tbroker_uri = tcp://127.0.0.1:1\n\n"
+		<< "[livestream]\n"
+		<< "\tservice = " << live_port << "\n"
+		<< "\turi = 127.0.0.1\n\n"
+		<< "[stcclient]\n"
+		<< "\turi = 127.0.0.1:" << stc_port << "\n"
+		<< "\tconnect_retry = 1.0\n";
+}
+
+static pid_t startSMSD(void)
+{
+	std::string log = workdir + "/smsd.log";
+	std::string conf = workdir + "/smsd.conf";
+	std::string logconf = workdir + "/logging.conf";
+
+	pid_t pid = fork();
+	if (pid < 0)
+		throw std::runtime_error("Unable to fork smsd");
+
+	if (!pid) {
+		int fd = open(log.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (fd >= 0) {
+			dup2(fd, 1);
+			dup2(fd, 2);
+			close(fd);
+		}
+		execl(smsd_path.c_str(), "smsd", "-f", "-c", conf.c_str(),
+			"-l", logconf.c_str(), (char *) NULL);
+		perror("exec smsd");
+		_exit(127);
+	}
+
+	return pid;
+}
+
+static void stopSMSD(pid_t pid)
+{
+	kill(pid, SIGTERM);
+	for (int i = 0; i < 100; i++) {
+		if (waitpid(pid, NULL, WNOHANG) == pid)
+			return;
+		usleep(100000);
+	}
+	kill(pid, SIGKILL);
+	waitpid(pid, NULL, 0);
+}
+
+static void parse_options(int argc, char **argv)
+{
+	po::options_description desc("Allowed options");
+	desc.add_options()
+		("help,h", "Show usage information")
+		("smsd", po::value<std::string>(&smsd_path),
+				"Path to the smsd binary")
+		("geometry", po::value<std::string>(&geometry_path),
+				"Geometry file for smsd")
+		("pixelmap", po::value<std::string>(&pixelmap_path),
+				"Pixel map file for smsd")
+		("workdir", po::value<std::string>(&workdir),
+				"smsd base directory (default: a new temporary one)")
+		("keep", po::bool_switch(&keep_workdir),
+				"Keep the work directory afterwards")
+		("output,o", po::value<std::string>(&output_path),
+				"Write the JSON results here (default: stdout)")
+		("port", po::value<uint16_t>(&base_port),
+				"First generator port; source N uses port + N")
+		("live-port", po::value<uint16_t>(&live_port),
+				"smsd live client port")
+		("stc-port", po::value<uint16_t>(&stc_port),
+				"STC stand-in port")
+		("sources,s", po::value<uint32_t>(&num_sources),
+				"Number of generator data sources")
+		("extra-source", po::value<std::vector<std::string> >(
+					&extra_sources),
+				"Also connect smsd to this host:port"
+				" (e.g. adara-loadgen --pv-port)")
+		("rx-thread", po::bool_switch(&rx_thread),
+				"Use dedicated receive threads for the sources")
+		("live-clients,l", po::value<uint32_t>(&live_clients),
+				"Number of live clients")
+		("hz,r", po::value<double>(&pulse_hz), "Pulse rate")
+		("events,e", po::value<uint32_t>(&events_per_pulse),
+				"Neutron events per pulse over all sources")
+		("max-packet", po::value<uint32_t>(&max_packet),
+				"Maximum raw event packet size in bytes")
+		("pixels,P", po::value<uint32_t>(&num_pixels),
+				"Events use pixel ids 0..N-1")
+		("poolsize", po::value<std::string>(&poolsize),
+				"smsd storage pool size")
+		("warmup,w", po::value<double>(&warmup),
+				"Seconds to run before measuring")
+		("duration,d", po::value<double>(&duration),
+				"Seconds to measure for")
+		("poll-us", po::value<uint32_t>(&poll_us),
+				"Storage file polling interval (us)")
+		("startup-timeout", po::value<double>(&startup_timeout),
+				"Seconds to wait for smsd to connect everything")
+		("run-start-cmd", po::value<std::string>(&run_start_cmd),
+				"Shell command to start a run after the warm-up")
+		("run-stop-cmd", po::value<std::string>(&run_stop_cmd),
+				"Shell command to stop the run after measuring");
+
+	po::variables_map vm;
+	try {
+		po::store(po::parse_command_line(argc, argv, desc), vm);
+		po::notify(vm);
+	} catch (po::error &e) {
+		std::cerr << argv[0] << ": " << e.what() << std::endl
+			<< std::endl << desc << std::endl;
+		exit(2);
+	}
+
+	if (vm.count("help")) {
+		std::cerr << desc << std::endl;
+		exit(2);
+	}
+
+	if (pulse_hz <= 0 || !num_sources || !num_pixels || duration <= 0) {
+		std::cerr << argv[0] << ": hz, sources, pixels and duration"
+			" must be non-zero" << std::endl;
+		exit(2);
+	}
+
+	if (max_packet < 256)
+		max_packet = 256;
+
+	pulse_ns = (uint64_t) ( 1e9 / pulse_hz );
+}
+
+static void sleepFor(double secs)
+{
+	uint64_t until = monoNow() + (uint64_t) ( secs * 1e9 );
+	while (monoNow() < until)
+		usleep(10000);
+}
+
+int main(int argc, char **argv)
+{
+	parse_options(argc, argv);
+
+	signal(SIGPIPE, SIG_IGN);
+
+	bool temp_workdir = workdir.empty();
+	if (temp_workdir) {
+		char tmpl[] = "/tmp/sms-bench.XXXXXX";
+		if (!mkdtemp(tmpl)) {
+			perror("mkdtemp");
+			return 1;
+		}
+		workdir = tmpl;
+	}
+
+	/* Pulse ids are aligned to whole pulses since the epoch */
+	start_real_ns = realNow();
+	start_real_ns -= start_real_ns % pulse_ns;
+	start_mono_ns = monoNow();
+
+	std::vector<Generator *> gens;
+	std::vector<LiveReader *> readers;
+	STCStandIn *stc;
+	StorageTail *tail;
+	pid_t pid;
+
+	try {
+		writeConfig();
+
+		for (uint32_t i = 0; i < num_sources; i++)
+			gens.push_back(new Generator(i));
+		stc = new STCStandIn;
+		tail = new StorageTail(workdir + "/data");
+
+		pid = startSMSD();
+	} catch (std::exception &e) {
+		std::cerr << argv[0] << ": " << e.what() << std::endl;
+		return 1;
+	}
+
+	for (uint32_t i = 0; i < gens.size(); i++)
+		gens[i]->start();
+	stc->start();
+	tail->start();
+	for (uint32_t i = 0; i < live_clients; i++) {
+		readers.push_back(new LiveReader);
+		readers.back()->start();
+	}
+
+	std::string error;
+	uint64_t deadline = monoNow() + (uint64_t) ( startup_timeout * 1e9 );
+	for (;;) {
+		bool ready = true;
+		for (uint32_t i = 0; i < gens.size(); i++)
+			ready = ready && gens[i]->m_connected;
+		for (uint32_t i = 0; i < readers.size(); i++)
+			ready = ready && readers[i]->m_connected;
+		if (ready)
+			break;
+
+		if (waitpid(pid, NULL, WNOHANG) == pid) {
+			error = "smsd exited during startup";
+			pid = 0;
+			break;
+		}
+		if (monoNow() > deadline) {
+			error = "timed out waiting for smsd connections";
+			break;
+		}
+		usleep(100000);
+	}
+
+	ThreadMap before, after;
+	double elapsed = 0;
+
+	if (error.empty()) {
+		std::cerr << "smsd connected, warming up for " << warmup
+			<< "s" << std::endl;
+		sleepFor(warmup);
+
+		if (!run_start_cmd.empty() && system(run_start_cmd.c_str()))
+			std::cerr << "Run start command failed" << std::endl;
+
+		sampleThreads(pid, before);
+		uint64_t t0 = monoNow();
+		measuring = true;
+
+		std::cerr << "Measuring for " << duration << "s" << std::endl;
+		sleepFor(duration);
+
+		measuring = false;
+		elapsed = ( monoNow() - t0 ) / 1e9;
+		sampleThreads(pid, after);
+
+		if (!run_stop_cmd.empty()) {
+			if (system(run_stop_cmd.c_str()))
+				std::cerr << "Run stop command failed" << std::endl;
+			/* Give the STC stand-in a chance to see the run */
+			sleepFor(2.0);
+		}
+	}
+
+	if (pid)
+		stopSMSD(pid);
+
+	stopping = true;
+	for (uint32_t i = 0; i < gens.size(); i++)
+		gens[i]->join();
+	for (uint32_t i = 0; i < readers.size(); i++)
+		readers[i]->join();
+	stc->join();
+	tail->join();
+
+	/* Gather it all up */
+	uint64_t gen_events = 0, gen_pulses = 0, late = 0;
+	for (uint32_t i = 0; i < gens.size(); i++) {
+		gen_events += gens[i]->m_events;
+		gen_pulses += gens[i]->m_pulses;
+		late += gens[i]->m_late;
+	}
+
+	Latency live_latency;
+	uint64_t live_bytes = 0;
+	for (uint32_t i = 0; i < readers.size(); i++) {
+		live_latency.merge(readers[i]->m_sink.m_latency);
+		live_bytes += readers[i]->m_sink.m_bytes;
+	}
+
+	double secs = elapsed > 0 ? elapsed : 1.0;
+	double hz = sysconf(_SC_CLK_TCK);
+
+	std::ofstream file;
+	if (!output_path.empty())
+		file.open(output_path.c_str());
+	std::ostream &os = output_path.empty() ? std::cout : file;
+
+	os << "{\n";
+	if (!error.empty())
+		os << "  \"error\": " << jsonString(error) << ",\n";
+	os << "  \"config\": { \"sources\": " << num_sources
+		<< ", \"live_clients\": " << live_clients
+		<< ", \"hz\": " << pulse_hz
+		<< ", \"events_per_pulse\": " << events_per_pulse
+		<< ", \"max_packet\": " << max_packet
+		<< ", \"rx_thread\": " << ( rx_thread ? "true" : "false" )
+		<< ", \"poll_us\": " << poll_us << " },\n";
+	os << "  \"duration_s\": " << elapsed << ",\n";
+	os << "  \"generated\": { \"events_per_s\": " << gen_events / secs
+		<< ", \"source_pulses\": " << gen_pulses
+		<< ", \"late_pulses\": " << late << " },\n";
+	os << "  \"storage\": { \"events_per_s\": "
+		<< tail->m_sink.m_events / secs
+		<< ", \"mb_per_s\": " << tail->m_sink.m_bytes / secs / 1e6
+		<< ", \"files\": " << tail->m_files << " },\n";
+	os << "  \"live\": { \"mb_per_s\": " << live_bytes / secs / 1e6
+		<< " },\n";
+	os << "  \"stc\": { \"runs\": " << stc->m_runs
+		<< ", \"bytes\": " << stc->m_bytes << " },\n";
+
+	os << "  \"latency_us\": {\n    \"ingest_to_disk\": ";
+	tail->m_sink.m_latency.json(os);
+	os << ",\n    \"ingest_to_live\": ";
+	live_latency.json(os);
+	os << "\n  },\n";
+
+	double total = 0;
+	os << "  \"threads\": [";
+	const char *sep = "\n";
+	for (ThreadMap::iterator it = after.begin(); it != after.end(); ++it) {
+		uint64_t ticks = it->second.m_ticks;
+		ThreadMap::iterator b = before.find(it->first);
+		if (b != before.end())
+			ticks -= b->second.m_ticks;
+		double pct = 100.0 * ticks / hz / secs;
+		total += pct;
+		os << sep << "    { \"tid\": " << it->first
+			<< ", \"name\": " << jsonString(it->second.m_name)
+			<< ", \"cpu_pct\": " << pct << " }";
+		sep = ",\n";
+	}
+	os << "\n  ],\n";
+	os << "  \"smsd_cpu_pct\": " << total << "\n";
+	os << "}\n";
+
+	if (temp_workdir && !keep_workdir) {
+		boost::system::error_code ec;
+		fs::remove_all(workdir, ec);
+	} else
+		std::cerr << "smsd files are in " << workdir << std::endl;
+
+	return error.empty() ? 0 : 1;
+}
@@ -11,6 +11,11 @@
 
 using namespace std;
 
+bool ComBusTransMon::s_persistent = false;
+ADARA::ComBus::Connection *ComBusTransMon::s_combus = 0;
+string ComBusTransMon::s_combus_domain;
+string ComBusTransMon::s_combus_uri;
+
 
 /** \brief ComBusMon constructor
   *
@@ -49,10 +54,19 @@ ComBusTransMon::~ComBusTransMon()
         delete m_comm_thread;
     }
 
-    syslog( LOG_INFO, "[%i] Disconnecting ComBus...", g_pid );
+    if ( m_combus && s_persistent )
+    {
+        // Keep the connection for the next run in this process
+        s_combus = m_combus;
+        s_combus_domain = m_domain;
+        s_combus_uri = m_broker_uri;
+    }
+    else if ( m_combus )
+    {
+        syslog( LOG_INFO, "[%i] Disconnecting ComBus...", g_pid );
 
-    if ( m_combus )
         delete m_combus;
+    }
 
     if ( m_terminal_msg )
         delete m_terminal_msg;
@@ -61,6 +75,18 @@ ComBusTransMon::~ComBusTransMon()
 }
 
 
+/** \brief Keep the ComBus connection between runs
+  *
+  * For the persistent STC daemon; instead of disconnecting, the destructor
+  * hands the connection on to the next ComBusTransMon in this process.
+  */
+void
+ComBusTransMon::setPersistent( bool a_persistent )
+{
+    s_persistent = a_persistent;
+}
+
+
 /** \brief Starts the background ComBus comm thread
   *
   * This method starts the background communication thread which will begin
@@ -327,10 +353,33 @@ ComBusTransMon::commThread()
                 stringstream ss_err;
                 ss_err << "[" << g_pid << "] STC Error ComBus";
 
+                // Reuse Persistent STC ComBus Connection...
+                if ( s_combus )
+                {
+                    m_combus = s_combus;
+                    s_combus = 0;
+
+                    if ( m_domain != s_combus_domain
+                            || m_broker_uri != s_combus_uri )
+                    {
+                        m_combus->setConnection( m_domain, m_broker_uri,
+                            m_broker_user, m_broker_pass );
+                    }
+
+                    // Start over from the default reconnect interval
+                    m_combus->setReconnRetry( 2 );
+
+                    syslog( LOG_INFO, "[%i] STC Reusing ComBus Connection",
+                        g_pid );
+                }
+
                 // Make STC ComBus Connection...
-                m_combus = new ADARA::ComBus::Connection( m_domain, "STC",
-                    getpid(), m_broker_uri, m_broker_user, m_broker_pass,
-                    ss_info.str(), ss_err.str() );
+                else
+                {
+                    m_combus = new ADARA::ComBus::Connection( m_domain,
+                        "STC", getpid(), m_broker_uri, m_broker_user,
+                        m_broker_pass, ss_info.str(), ss_err.str() );
+                }
 
                 if ( !m_combus->waitForConnect( 5 ) ) { 
                     syslog( LOG_ERR,
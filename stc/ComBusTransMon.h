@@ -29,6 +29,8 @@ public:
     void failure( STC::TranslationStatusCode a_code,
         const std::string a_reason );
 
+    static void setPersistent( bool a_persistent );
+
 private:
     void commThread();
 
@@ -44,6 +46,11 @@ private:
     ADARA::ComBus::MessageBase *m_terminal_msg;
     boost::mutex                m_api_mutex;
     std::string                 m_host;
+
+    static bool                         s_persistent;
+    static ADARA::ComBus::Connection   *s_combus;      ///< Kept between runs
+    static std::string                  s_combus_domain;
+    static std::string                  s_combus_uri;
 };
 
 #endif // COMBUSTRANSMON_H
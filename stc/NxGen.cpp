@@ -5,6 +5,7 @@
 #include <time.h>
 #include <unistd.h>
 #include <stdlib.h>
+#include <sys/stat.h>
 #include <libxml/tree.h>
 #include "NxGen.h"
 #include "TraceException.h"
@@ -16,6 +17,12 @@
 // Do Stu's Dummy PixelId-Filled Histogram Test...
 // #define HISTO_TEST
 
+// Histogram Cells per Slab Written Out from the Sparse Histogram (16 MB)
+#define HISTO_SLAB_CELLS    ( 4 * 1024 * 1024 )
+
+// Elements per Slab Read In from a Partial Translation When Stitching
+#define STITCH_SLAB_ELEMENTS    ( 1024 * 1024 )
+
 using namespace std;
 
 std::string NxGen::GroupNameIndex = "[XXX_INDEX_XXX]";
@@ -89,7 +96,7 @@ NxGen::NxGen
 
     // Parse STC Config File
     if ( !m_config_file.empty() )
-        parseSTCConfigFile( m_config_file );
+        loadSTCConfigFile( m_config_file );
 
     // Reserve internal buffer for veto pulse times (in Dataset Elements!)
     m_pulse_vetoes.reserve( a_chunk_size );
@@ -907,6 +914,15 @@ NxGen::finalize
 
         writeScalar( m_entry_path, "total_other_counts",
             a_run_metrics.non_events_counted, "" );
+
+        // One Segment of a Split Run, Keep Its Pulse Count for Stitching
+        // (Not "total_pulses", That's Only the Pulses with Charge...)
+        if ( isSegment() )
+        {
+            writeScalar( m_entry_path, "segment_pulses",
+                getPulseCount(), "" );
+        }
+
         writeScalar( m_entry_path, "proton_charge",
             a_run_metrics.total_charge, CHARGE_UNITS );
 
@@ -1560,7 +1576,27 @@ NxGen::processRunInfo
                 a_run_info.sample_volume_cubic_units );
         }
 
-        bool ldap_lookup = false;
+        // If User Name _Not_ Specified, and User ID _Is_ Present,
+        // Then Resolve User Name Via LDAP Lookup...! ;-D
+        // (All At Once, Cached Names First, Then One Batched LDAP Search)
+        vector<string> unnamed_uids;
+        for ( vector<STC::UserInfo>::const_iterator u =
+                a_run_info.users.begin();
+                u != a_run_info.users.end(); ++u )
+        {
+            if ( ( !u->name.compare( "XXX_UNRESOLVED_NAME_XXX" )
+                        || u->name.empty() )
+                    && !u->id.empty()
+                    && u->id.compare( "XXX_UNRESOLVED_UID_XXX" ) )
+            {
+                unnamed_uids.push_back( u->id );
+            }
+        }
+
+        map<string, string> ldap_names;
+        if ( !unnamed_uids.empty() )
+            stcLdapLookupUserNames( unnamed_uids, ldap_names );
+
         size_t user_count = 0;
         string path;
         for ( vector<STC::UserInfo>::const_iterator u =
@@ -1573,26 +1609,11 @@ NxGen::processRunInfo
 
             writeString( path, "facility_user_id", u->id );
 
-            // If User Name _Not_ Specified, and User ID _Is_ Present,
-            // Then Resolve User Name Via LDAP Lookup...! ;-D
-
             std::string user_name = u->name;
 
-            if ( ( !u->name.compare( "XXX_UNRESOLVED_NAME_XXX" )
-                        || u->name.empty() )
-                    && !u->id.empty()
-                    && u->id.compare( "XXX_UNRESOLVED_UID_XXX" ) )
-            {
-                // Create LDAP Connection Only as Needed...
-                if ( !ldap_lookup )
-                {
-                    if ( stcLdapConnect() == 0 )
-                        ldap_lookup = true;
-                }
-
-                if ( ldap_lookup )
-                    stcLdapLookupUserName( u->id, user_name );
-            }
+            map<string, string>::iterator ln = ldap_names.find( u->id );
+            if ( ln != ldap_names.end() )
+                user_name = ln->second;
 
             writeString( path, "name", user_name );
 
@@ -1603,10 +1624,6 @@ NxGen::processRunInfo
                 writeString( path, "role", u->role );
             }
         }
-
-        // Close Any Open LDAP Connections...
-        if ( ldap_lookup )
-            stcLdapDisconnect();
     }
     catch( TraceException &e )
     {
@@ -2196,8 +2213,8 @@ NxGen::bankFinalize
             writeMultidimDataset( bi->m_instr_path, m_data_name,
                 dummy_histo, dims );
 #else
-            writeMultidimDataset( bi->m_instr_path, m_data_name,
-                bi->m_data_buffer, dims );
+            writeHistogramDataset( bi->m_instr_path, m_data_name,
+                bi->m_histo_data, dims );
 #endif
 
             // Add "Axes" Attribute for NeXus NXdata Standards Compat
@@ -2637,6 +2654,405 @@ NxGen::monitorFinalize
 }
 
 
+/*! \brief Stitches one partial (segment) translation into this one
+ *  \return The number of run pulses held by the partial translation
+ *
+ * This method reads the event data of a partial NeXus file, written by
+ * STC for one segment of a split run, and hands it to the stream parser
+ * to append to each event-based bank and monitor, with the event index
+ * offset by the events (and pulses) of the partials before it. Histogram
+ * banks and monitors add up the partial's histogram and counts. A bank
+ * or monitor missing from the partial (e.g. a state it never saw) had no
+ * events there, and its index just gets filled over its pulses later.
+ */
+uint64_t
+NxGen::stitchPartial
+(
+    const std::string  &a_path,         ///< [in] Path of partial NeXus file
+    uint64_t            a_pulse_offset  ///< [in] Run pulses before the partial
+)
+{
+    H5nx partial;
+
+    if ( partial.H5NXopen_file( a_path ) != SUCCEED )
+    {
+        THROW_TRACE( STC::ERR_UNEXPECTED_INPUT,
+            "Unable to open partial translation: " << a_path )
+    }
+
+    uint64_t pulses = 0;
+
+    try
+    {
+        // Only a Segment Translation Says How Many Pulses It Holds...
+        readPartialScalar( partial, m_entry_path + "/segment_pulses",
+            pulses );
+
+        STC::RunMetrics metrics;
+        readPartialScalar( partial, m_entry_path + "/total_counts",
+            metrics.events_counted );
+        readPartialScalar( partial, m_entry_path + "/total_uncounted_counts",
+            metrics.events_uncounted );
+        readPartialScalar( partial, m_entry_path + "/total_uncounted_counts",
+            metrics.events_error, "ERROR_bit_or_unknown_other" );
+        readPartialScalar( partial, m_entry_path + "/total_uncounted_counts",
+            metrics.events_unmapped, "events_have_no_bank" );
+        readPartialScalar( partial, m_entry_path + "/total_other_counts",
+            metrics.non_events_counted );
+        stitchRunMetrics( metrics );
+
+        syslog( LOG_INFO, "[%i] %s: %s %s, %lu %s, %lu %s",
+            g_pid, "NxGen::stitchPartial()", "Stitching", a_path.c_str(),
+            pulses, "Pulses", metrics.events_counted, "Events Counted" );
+        give_syslog_a_chance;
+
+        std::vector<uint64_t> index;
+        std::vector<float> tof;
+        std::vector<uint32_t> pid;
+        std::vector<uint32_t> histo;
+        std::vector<hsize_t> dims;
+
+        // Detector Banks...
+
+        for ( uint32_t b=0 ; b < getBanksArraySize() ; b++ )
+        {
+            // Banks that Never Had Any Data Just Get Finalized Empty...
+            STC::BankInfo *bank = getBankByIndex( b );
+            if ( bank == NULL || !(bank->m_initialized) )
+                continue;
+
+            NxBankInfo *bi = dynamic_cast<NxBankInfo*>( bank );
+            if ( !bi )
+            {
+                THROW_TRACE( STC::ERR_CAST_FAILED,
+                    "Invalid bank object in stitchPartial()" )
+            }
+
+            // Event-based Data...
+            if ( bi->m_has_event
+                    && partialHasPath( partial, bi->m_index_path ) )
+            {
+                readPartialDims( partial, bi->m_index_path, dims );
+                if ( dims.size() != 1 || dims[0] != pulses )
+                {
+                    THROW_TRACE( STC::ERR_UNEXPECTED_INPUT,
+                        "Partial event index " << bi->m_index_path
+                            << " doesn't match its " << pulses
+                            << " pulses" )
+                }
+
+                uint64_t base = bi->m_event_count;
+
+                for ( uint64_t off=0 ; off < pulses ;
+                        off += STITCH_SLAB_ELEMENTS )
+                {
+                    uint64_t n = pulses - off;
+                    if ( n > STITCH_SLAB_ELEMENTS )
+                        n = STITCH_SLAB_ELEMENTS;
+
+                    index.assign( n, 0 );
+                    readPartialSlab( partial, bi->m_index_path,
+                        index, n, off );
+
+                    stitchBankIndex( *bi, a_pulse_offset + off,
+                        index, n, base );
+                }
+
+                readPartialDims( partial, bi->m_tof_path, dims );
+                uint64_t events = dims.empty() ? 0 : dims[0];
+                readPartialDims( partial, bi->m_pid_path, dims );
+                if ( dims.size() != 1 || dims[0] != events )
+                {
+                    THROW_TRACE( STC::ERR_UNEXPECTED_INPUT,
+                        "Partial event datasets " << bi->m_tof_path
+                            << " and " << bi->m_pid_path
+                            << " differ in length" )
+                }
+
+                for ( uint64_t off=0 ; off < events ;
+                        off += STITCH_SLAB_ELEMENTS )
+                {
+                    uint64_t n = events - off;
+                    if ( n > STITCH_SLAB_ELEMENTS )
+                        n = STITCH_SLAB_ELEMENTS;
+
+                    tof.assign( n, 0 );
+                    readPartialSlab( partial, bi->m_tof_path, tof, n, off );
+                    pid.assign( n, 0 );
+                    readPartialSlab( partial, bi->m_pid_path, pid, n, off );
+
+                    stitchBankEvents( *bi, tof, pid, n );
+                }
+            }
+
+            // Histogram-based Data...
+            if ( bi->m_has_histo && partialHasPath( partial,
+                    bi->m_histo_path + "/total_counts" ) )
+            {
+                uint64_t counted, uncounted;
+                readPartialScalar( partial, bi->m_histo_path + "/total_counts",
+                    counted );
+                readPartialScalar( partial,
+                    bi->m_histo_path + "/total_uncounted_counts",
+                    uncounted );
+
+                // Nothing Counted, Nothing in the Histogram...
+                uint64_t num_rows = bi->m_logical_pixelids.size();
+                uint64_t row_size = bi->m_num_tof_bins - 1;
+                if ( counted && num_rows && row_size )
+                {
+                    readPartialDims( partial, bi->m_data_path, dims );
+                    if ( dims.size() != 2 || dims[0] != num_rows
+                            || dims[1] != row_size )
+                    {
+                        THROW_TRACE( STC::ERR_UNEXPECTED_INPUT,
+                            "Partial histogram " << bi->m_data_path
+                                << " doesn't match its bank" )
+                    }
+
+                    uint64_t slab_rows = HISTO_SLAB_CELLS / row_size;
+                    if ( slab_rows < 1 )
+                        slab_rows = 1;
+
+                    for ( uint64_t row = 0 ; row < num_rows ;
+                            row += slab_rows )
+                    {
+                        uint64_t rows = num_rows - row;
+                        if ( rows > slab_rows )
+                            rows = slab_rows;
+
+                        histo.assign( rows * row_size, 0 );
+                        if ( partial.H5NXread_rows( bi->m_data_path, histo,
+                                rows, row ) != SUCCEED )
+                        {
+                            THROW_TRACE( STC::ERR_UNEXPECTED_INPUT,
+                                "H5NXread_rows() failed for path: "
+                                    << bi->m_data_path << ", row: " << row )
+                        }
+
+                        // Only Touch the Cells that Got Counts...
+                        for ( uint64_t i=0 ; i < rows * row_size ; i++ )
+                        {
+                            if ( histo[i] )
+                            {
+                                bi->m_histo_data.add(
+                                    row * row_size + i, histo[i] );
+                            }
+                        }
+                    }
+                }
+
+                bi->m_histo_event_count += counted;
+                bi->m_histo_event_uncounted += uncounted;
+            }
+        }
+
+        // Beam Monitors...
+
+        for ( std::map<STC::Identifier, STC::MonitorInfo*>::iterator imi =
+                    getMonitors().begin();
+                imi != getMonitors().end(); ++imi )
+        {
+            NxMonitorInfo *mi = dynamic_cast<NxMonitorInfo*>( imi->second );
+            if ( !mi )
+            {
+                THROW_TRACE( STC::ERR_CAST_FAILED,
+                    "Invalid monitor object in stitchPartial()" )
+            }
+
+            // Histo-based Monitor
+            if ( mi->m_config.format == ADARA::HISTO_FORMAT )
+            {
+                if ( !partialHasPath( partial, mi->m_path + "/total_counts" ) )
+                    continue;
+
+                uint64_t counted, uncounted;
+                readPartialScalar( partial, mi->m_path + "/total_counts",
+                    counted );
+                readPartialScalar( partial,
+                    mi->m_path + "/total_uncounted_counts", uncounted );
+
+                uint64_t bins = mi->m_data_buffer.size();
+                if ( counted && bins )
+                {
+                    readPartialDims( partial, mi->m_data_path, dims );
+                    if ( dims.size() != 1 || dims[0] != bins )
+                    {
+                        THROW_TRACE( STC::ERR_UNEXPECTED_INPUT,
+                            "Partial histogram " << mi->m_data_path
+                                << " doesn't match its monitor" )
+                    }
+
+                    histo.assign( bins, 0 );
+                    readPartialSlab( partial, mi->m_data_path,
+                        histo, bins, 0 );
+
+                    for ( uint64_t i=0 ; i < bins ; i++ )
+                        mi->m_data_buffer[i] += histo[i];
+                }
+
+                mi->m_event_count += counted;
+                mi->m_event_uncounted += uncounted;
+            }
+
+            // Event-based Monitor
+            else
+            {
+                if ( !partialHasPath( partial, mi->m_index_path ) )
+                    continue;
+
+                readPartialDims( partial, mi->m_index_path, dims );
+                if ( dims.size() != 1 || dims[0] != pulses )
+                {
+                    THROW_TRACE( STC::ERR_UNEXPECTED_INPUT,
+                        "Partial event index " << mi->m_index_path
+                            << " doesn't match its " << pulses
+                            << " pulses" )
+                }
+
+                uint64_t base = mi->m_event_count;
+
+                for ( uint64_t off=0 ; off < pulses ;
+                        off += STITCH_SLAB_ELEMENTS )
+                {
+                    uint64_t n = pulses - off;
+                    if ( n > STITCH_SLAB_ELEMENTS )
+                        n = STITCH_SLAB_ELEMENTS;
+
+                    index.assign( n, 0 );
+                    readPartialSlab( partial, mi->m_index_path,
+                        index, n, off );
+
+                    stitchMonitorIndex( *mi, a_pulse_offset + off,
+                        index, n, base );
+                }
+
+                readPartialDims( partial, mi->m_tof_path, dims );
+                uint64_t events = dims.empty() ? 0 : dims[0];
+
+                for ( uint64_t off=0 ; off < events ;
+                        off += STITCH_SLAB_ELEMENTS )
+                {
+                    uint64_t n = events - off;
+                    if ( n > STITCH_SLAB_ELEMENTS )
+                        n = STITCH_SLAB_ELEMENTS;
+
+                    tof.assign( n, 0 );
+                    readPartialSlab( partial, mi->m_tof_path, tof, n, off );
+
+                    stitchMonitorEvents( *mi, tof, n );
+                }
+            }
+        }
+    }
+    catch( TraceException &e )
+    {
+        partial.H5NXclose_file();
+        RETHROW_TRACE( e, "stitchPartial() failed for partial translation: "
+            << a_path )
+    }
+
+    partial.H5NXclose_file();
+
+    return( pulses );
+}
+
+
+/*! \brief Checks for a group or dataset in a partial translation
+ *  \return True if the path exists in the partial NeXus file
+ */
+bool
+NxGen::partialHasPath
+(
+    H5nx               &a_partial,  ///< [in] Open partial NeXus file
+    const std::string  &a_path      ///< [in] Nexus path to check
+)
+{
+    bool exists;
+
+    if ( a_partial.H5NXcheck_link_path( a_path, exists ) != SUCCEED )
+    {
+        THROW_TRACE( STC::ERR_UNEXPECTED_INPUT,
+            "H5NXcheck_link_path() failed for path: " << a_path )
+    }
+
+    return( exists );
+}
+
+
+/*! \brief Reads a count (dataset or attribute) from a partial translation
+ */
+void
+NxGen::readPartialScalar
+(
+    H5nx               &a_partial,  ///< [in] Open partial NeXus file
+    const std::string  &a_path,     ///< [in] Nexus path of dataset
+    uint64_t           &a_value,    ///< [out] Value read
+    const std::string  &a_attr      ///< [in] Attribute name (if any)
+)
+{
+    int cc = a_attr.empty()
+        ? a_partial.H5NXread_dataset_scalar( a_path, a_value )
+        : a_partial.H5NXread_attribute_scalar( a_path, a_attr, a_value );
+
+    if ( cc != SUCCEED )
+    {
+        THROW_TRACE( STC::ERR_UNEXPECTED_INPUT,
+            "Unable to read partial translation " << a_path
+                << ( a_attr.empty() ? "" : " attribute " ) << a_attr
+                << " - not an STC segment translation?" )
+    }
+}
+
+
+/*! \brief Gets the dimensions of a dataset in a partial translation
+ */
+void
+NxGen::readPartialDims
+(
+    H5nx                   &a_partial,  ///< [in] Open partial NeXus file
+    const std::string      &a_path,     ///< [in] Nexus path of dataset
+    std::vector<hsize_t>   &a_dims      ///< [out] Dataset dimensions
+)
+{
+    int rank;
+
+    a_dims.assign( H5S_MAX_RANK, 0 );
+
+    if ( a_partial.H5NXget_dataset_dims( a_path, rank, a_dims )
+            != SUCCEED )
+    {
+        THROW_TRACE( STC::ERR_UNEXPECTED_INPUT,
+            "H5NXget_dataset_dims() failed for path: " << a_path )
+    }
+
+    a_dims.resize( rank );
+}
+
+
+/*! \brief Reads a 1D slab of a dataset in a partial translation
+ */
+template <typename TypeT>
+void
+NxGen::readPartialSlab
+(
+    H5nx                   &a_partial,  ///< [in] Open partial NeXus file
+    const std::string      &a_path,     ///< [in] Nexus path of dataset
+    std::vector<TypeT>     &a_slab,     ///< [out] Slab buffer (pre-sized)
+    uint64_t                a_size,     ///< [in] Number of elements
+    uint64_t                a_offset    ///< [in] Offset of first element
+)
+{
+    if ( a_partial.H5NXread_slab( a_path, a_slab, a_size, a_offset )
+            != SUCCEED )
+    {
+        THROW_TRACE( STC::ERR_UNEXPECTED_INPUT,
+            "H5NXread_slab() failed for path: " << a_path
+                << ", offset: " << a_offset )
+    }
+}
+
+
 /*! \brief Sets the overall run comments in Nexus file
  *
  * This method writes the overall run comments to the Nexus file.
@@ -3493,6 +3909,121 @@ NxGen::writeMultidimDataset
 }
 
 
+/*! \brief Creates and Writes a Nexus 2D Histogram Dataset
+ *
+ * This method Creates a [pixel x TOF bin] Nexus Dataset and fills it
+ * from the given Sparse Histogram a slab of whole rows at a time, so the
+ * full dense histogram never has to be held in memory.
+ */
+void
+NxGen::writeHistogramDataset
+(
+    const std::string           &a_path,    ///< [in] Nexus path of new dataset
+    const std::string           &a_name,    ///< [in] Name of new dataset
+    const STC::SparseHistogram  &a_histo,   ///< [in] Histogram Counts
+    std::vector<hsize_t>        &a_dims     ///< [in] Dimensions of Data
+)
+{
+    // Create the Dataset, Without Any Data Yet...
+    std::vector<uint32_t> slab;
+    writeMultidimDataset( a_path, a_name, slab, a_dims );
+
+    uint64_t num_rows = a_dims[0];
+    uint64_t row_size = a_dims[1];
+
+    if ( !num_rows || !row_size )
+        return;
+
+    uint64_t slab_rows = HISTO_SLAB_CELLS / row_size;
+    if ( slab_rows < 1 )
+        slab_rows = 1;
+    else if ( slab_rows > num_rows )
+        slab_rows = num_rows;
+
+    syslog( LOG_INFO,
+        "[%i] %s: %s %s/%s [%lu x %lu], %lu of %lu Blocks Dense, %lu %s",
+        g_pid, "NxGen::writeHistogramDataset()", "Writing Histogram",
+        a_path.c_str(), a_name.c_str(),
+        (unsigned long) num_rows, (unsigned long) row_size,
+        (unsigned long) a_histo.denseBlocks(),
+        (unsigned long) ( ( a_histo.size()
+            + STC::SparseHistogram::BLOCK_MASK )
+                >> STC::SparseHistogram::BLOCK_SHIFT ),
+        (unsigned long) a_histo.memoryUsed(), "Bytes Used" );
+    give_syslog_a_chance;
+
+    slab.resize( slab_rows * row_size );
+
+    for ( uint64_t row = 0 ; row < num_rows ; row += slab_rows )
+    {
+        uint64_t rows = num_rows - row;
+        if ( rows > slab_rows )
+            rows = slab_rows;
+
+        a_histo.copyOut( row * row_size, rows * row_size, &(slab[0]) );
+
+        if ( m_h5nx.H5NXwrite_rows( a_path + "/" + a_name, slab,
+                rows, row ) != SUCCEED )
+        {
+            THROW_TRACE( STC::ERR_OUTPUT_FAILURE,
+                "H5NXwrite_rows() failed for path: " << a_path
+                    << ", name: " << a_name << ", row: " << row )
+        }
+    }
+}
+
+
+/// Parsed STC Config File, kept for later runs in the same process
+NxGen::STCConfigCache NxGen::s_config_cache;
+
+
+/*! \brief Loads External STC Config File
+ *
+ * This method re-uses the groups and commands from the last parse of
+ * the same STC Config File in this process, unless the file has been
+ * modified since then, in which case it is parsed again.
+ */
+void
+NxGen::loadSTCConfigFile
+(
+    const string &a_config_file     ///< [in] STC Config File Path
+)
+{
+    STCConfigCache &cache = s_config_cache;
+    struct stat st;
+
+    if ( stat( a_config_file.c_str(), &st ) != 0 )
+    {
+        // Let the Parser Report the Problem...
+        parseSTCConfigFile( a_config_file );
+        return;
+    }
+
+    if ( cache.path == a_config_file
+            && cache.mtime == st.st_mtime && cache.size == st.st_size )
+    {
+        syslog( LOG_INFO, "[%i] %s %s (%lu Groups, %lu Commands)",
+            g_pid, "Using Cached STC Config File", a_config_file.c_str(),
+            (unsigned long) cache.groups.size(),
+            (unsigned long) cache.commands.size() );
+        give_syslog_a_chance;
+
+        m_config_groups = cache.groups;
+        m_config_commands = cache.commands;
+        return;
+    }
+
+    parseSTCConfigFile( a_config_file );
+
+    // Save a Copy Before This Run Touches It...
+    cache.path = a_config_file;
+    cache.mtime = st.st_mtime;
+    cache.size = st.st_size;
+    cache.groups = m_config_groups;
+    cache.commands = m_config_commands;
+}
+
+
 /*! \brief Parses External STC Config File
  *
  * This method parses an External STC Config File
@@ -300,7 +300,9 @@ private:
             m_full_buffer_count(0),
             m_value_enum_strings_max_len(-1),
             m_value_enum_strings_not_found(0),
-            m_finalized(false)
+            m_finalized(false),
+            m_values_prepared(false),
+            m_packed_max_len(1)
         {
             // If the PV Name and Connection String are the Same,
             // then there's No Alias, and No Need for a Distinct Link.
@@ -388,17 +390,13 @@ private:
                 this->m_stats.push(a_values[i]);
         }
 
-        /// Writes Buffered Uint32 PV Values to Nexus File 
-        void flushValueBuffers
+        /// Scans Buffered Uint32 PV Values Before Writing
+        /// (Value Changes, Last Value & Enumerated Type Value Strings)
+        void prepareValueBuffers
         (
-            std::vector<uint32_t> &value_buffer ///< Uint32 Buffer to Write
+            std::vector<uint32_t> &value_buffer ///< Uint32 Buffer to Scan
         )
         {
-            // TODO - This code may need to be optimized
-            // when fast metadata is supported
-            m_nxgen.writeSlab( m_log_path + "/value",
-                value_buffer, m_cur_size );
-
             // Did this PV's Value *Change* for the First Time here...?
             if ( !(this->m_value_changed) )
             {
@@ -495,19 +493,34 @@ private:
                     this->m_last_enum_string = m_value_enum_strings.back();
                 }
             }
+
+            m_values_prepared = true;
         }
 
-        /// Writes Buffered Double PV Values to Nexus File 
+        /// Writes Buffered Uint32 PV Values to Nexus File
         void flushValueBuffers
         (
-            std::vector<double> &value_buffer ///< Double Buffer to Write
+            std::vector<uint32_t> &value_buffer ///< Uint32 Buffer to Write
         )
         {
+            // Already Scanned by prepareFinalFlush()...?
+            if ( !m_values_prepared )
+                prepareValueBuffers( value_buffer );
+            m_values_prepared = false;
+
             // TODO - This code may need to be optimized
             // when fast metadata is supported
             m_nxgen.writeSlab( m_log_path + "/value",
                 value_buffer, m_cur_size );
+        }
 
+        /// Scans Buffered Double PV Values Before Writing
+        /// (Value Changes & Last Value)
+        void prepareValueBuffers
+        (
+            std::vector<double> &value_buffer ///< Double Buffer to Scan
+        )
+        {
             // Did this PV's Value *Change* for the First Time here...?
             if ( !(this->m_value_changed) )
             {
@@ -531,12 +544,32 @@ private:
             // Are There More Than One Value to This PV Time-Series?
             if ( m_cur_size || value_buffer.size() > 1 )
                 this->m_last_value_more = true;
+
+            m_values_prepared = true;
         }
 
-        /// Writes Buffered String PV Values to Nexus File 
+        /// Writes Buffered Double PV Values to Nexus File
         void flushValueBuffers
         (
-            std::vector<std::string> &value_buffer ///< String Buffer to Write
+            std::vector<double> &value_buffer ///< Double Buffer to Write
+        )
+        {
+            // Already Scanned by prepareFinalFlush()...?
+            if ( !m_values_prepared )
+                prepareValueBuffers( value_buffer );
+            m_values_prepared = false;
+
+            // TODO - This code may need to be optimized
+            // when fast metadata is supported
+            m_nxgen.writeSlab( m_log_path + "/value",
+                value_buffer, m_cur_size );
+        }
+
+        /// Packs Buffered String PV Values into a Padded 2D Array
+        /// (Plus Value Changes & Last Value)
+        void prepareValueBuffers
+        (
+            std::vector<std::string> &value_buffer ///< String Buffer to Pack
         )
         {
             // Determine Max String Length...
@@ -562,15 +595,13 @@ private:
                 give_syslog_a_chance;
             }
 
-            // Write 2D String Array to NeXus File...
+            m_packed_max_len = max_len;
+            m_packed_strings.clear();
+
             if ( value_buffer.size() )
             {
-                std::vector<hsize_t> dims;
-                dims.push_back( value_buffer.size() );
-                dims.push_back( max_len );
-
                 // Pad the Strings with Spaces to Be of Uniform Length...
-                std::vector<std::string> value_vec;
+                m_packed_strings.reserve( value_buffer.size() );
                 // (And See if PV's Value *Changed* for First Time here...)
                 std::string value = ( this->m_last_value_set )
                     ? ( this->m_last_value ) : ( value_buffer.front() );
@@ -585,10 +616,8 @@ private:
                     }
                     if ( str.size() < max_len )
                         str.insert( str.end(), max_len - str.size(), ' ' );
-                    value_vec.push_back( str );
+                    m_packed_strings.push_back( str );
                 }
-                m_nxgen.writeMultidimDataset( m_log_path,
-                    "value", value_vec, dims, this->m_units );
 
                 // Save Last Value for Conditional STC Config Groups
                 this->m_last_value = value_buffer.back();
@@ -598,6 +627,33 @@ private:
                 if ( value_buffer.size() > 1 )
                     this->m_last_value_more = true;
             }
+
+            m_values_prepared = true;
+        }
+
+        /// Writes Buffered String PV Values to Nexus File
+        void flushValueBuffers
+        (
+            std::vector<std::string> &value_buffer ///< String Buffer to Write
+        )
+        {
+            // Already Packed by prepareFinalFlush()...?
+            if ( !m_values_prepared )
+                prepareValueBuffers( value_buffer );
+            m_values_prepared = false;
+
+            // Write 2D String Array to NeXus File...
+            if ( value_buffer.size() )
+            {
+                std::vector<hsize_t> dims;
+                dims.push_back( value_buffer.size() );
+                dims.push_back( m_packed_max_len );
+
+                m_nxgen.writeMultidimDataset( m_log_path,
+                    "value", m_packed_strings, dims, this->m_units );
+
+                std::vector<std::string>().swap( m_packed_strings );
+            }
             else
             {
                 syslog( LOG_INFO, "[%i] %s %s, %s", g_pid,
@@ -610,10 +666,11 @@ private:
             }
         }
 
-        /// Writes Buffered Uint32 Array PV Values to Nexus File 
-        void flushValueBuffers
+        /// Packs Buffered Uint32 Array PV Values into a Padded 2D Array
+        /// (Plus Value Changes & Last Value)
+        void prepareValueBuffers
         (
-            std::vector< std::vector<uint32_t> > &value_buffer ///< Uint32 Array Buffer to Write
+            std::vector< std::vector<uint32_t> > &value_buffer ///< Uint32 Array Buffer to Pack
         )
         {
             // Determine Max Array Length...
@@ -636,15 +693,13 @@ private:
                 value_buffer.size(), max_len );
             give_syslog_a_chance;
 
-            // Write 2D Uint32 Array to NeXus File...
+            m_packed_max_len = max_len;
+            m_packed_uints.clear();
+
             if ( value_buffer.size() )
             {
-                std::vector<hsize_t> dims;
-                dims.push_back( value_buffer.size() );
-                dims.push_back( max_len );
-
                 // Pad the Arrays with Zeros to Be of Uniform Length...
-                std::vector<uint32_t> value_vec;
+                m_packed_uints.reserve( value_buffer.size() * max_len );
                 // (And See if PV's Value *Changed* for First Time here...)
                 std::vector<uint32_t> &value = ( this->m_last_value_set )
                     ? ( this->m_last_value ) : ( value_buffer.front() );
@@ -667,17 +722,14 @@ private:
                             }
                         }
                     }
-                    value_vec.reserve( value_vec.size() + max_len );
-                    value_vec.insert( value_vec.end(),
+                    m_packed_uints.insert( m_packed_uints.end(),
                         value_buffer[i].begin(), value_buffer[i].end() );
                     if ( value_buffer[i].size() < max_len )
                     {
-                        value_vec.insert( value_vec.end(),
+                        m_packed_uints.insert( m_packed_uints.end(),
                             max_len - value_buffer[i].size(), 0 );
                     }
                 }
-                m_nxgen.writeMultidimDataset( m_log_path,
-                    "value", value_vec, dims, this->m_units );
 
                 // Save Last Value for Conditional STC Config Groups
                 this->m_last_value = value_buffer.back();
@@ -687,6 +739,33 @@ private:
                 if ( value_buffer.size() > 1 )
                     this->m_last_value_more = true;
             }
+
+            m_values_prepared = true;
+        }
+
+        /// Writes Buffered Uint32 Array PV Values to Nexus File
+        void flushValueBuffers
+        (
+            std::vector< std::vector<uint32_t> > &value_buffer ///< Uint32 Array Buffer to Write
+        )
+        {
+            // Already Packed by prepareFinalFlush()...?
+            if ( !m_values_prepared )
+                prepareValueBuffers( value_buffer );
+            m_values_prepared = false;
+
+            // Write 2D Uint32 Array to NeXus File...
+            if ( value_buffer.size() )
+            {
+                std::vector<hsize_t> dims;
+                dims.push_back( value_buffer.size() );
+                dims.push_back( m_packed_max_len );
+
+                m_nxgen.writeMultidimDataset( m_log_path,
+                    "value", m_packed_uints, dims, this->m_units );
+
+                std::vector<uint32_t>().swap( m_packed_uints );
+            }
             else
             {
                 syslog( LOG_INFO, "[%i] %s %s, %s", g_pid,
@@ -699,10 +778,11 @@ private:
             }
         }
 
-        /// Writes Buffered Double Array PV Values to Nexus File 
-        void flushValueBuffers
+        /// Packs Buffered Double Array PV Values into a Padded 2D Array
+        /// (Plus Value Changes & Last Value)
+        void prepareValueBuffers
         (
-            std::vector< std::vector<double> > &value_buffer ///< Double Array Buffer to Write
+            std::vector< std::vector<double> > &value_buffer ///< Double Array Buffer to Pack
         )
         {
             // Determine Max Array Length...
@@ -725,15 +805,13 @@ private:
                 value_buffer.size(), max_len );
             give_syslog_a_chance;
 
-            // Write 2D Double Array to NeXus File...
+            m_packed_max_len = max_len;
+            m_packed_doubles.clear();
+
             if ( value_buffer.size() )
             {
-                std::vector<hsize_t> dims;
-                dims.push_back( value_buffer.size() );
-                dims.push_back( max_len );
-
                 // Pad the Arrays with Zeros to Be of Uniform Length...
-                std::vector<double> value_vec;
+                m_packed_doubles.reserve( value_buffer.size() * max_len );
                 // (And See if PV's Value *Changed* for First Time here...)
                 std::vector<double> &value = ( this->m_last_value_set )
                     ? ( this->m_last_value ) : ( value_buffer.front() );
@@ -758,17 +836,14 @@ private:
                             }
                         }
                     }
-                    value_vec.reserve( value_vec.size() + max_len );
-                    value_vec.insert( value_vec.end(),
+                    m_packed_doubles.insert( m_packed_doubles.end(),
                         value_buffer[i].begin(), value_buffer[i].end() );
                     if ( value_buffer[i].size() < max_len )
                     {
-                        value_vec.insert( value_vec.end(),
+                        m_packed_doubles.insert( m_packed_doubles.end(),
                             max_len - value_buffer[i].size(), 0.0 );
                     }
                 }
-                m_nxgen.writeMultidimDataset( m_log_path,
-                    "value", value_vec, dims, this->m_units );
 
                 // Save Last Value for Conditional STC Config Groups
                 this->m_last_value = value_buffer.back();
@@ -778,6 +853,33 @@ private:
                 if ( value_buffer.size() > 1 )
                     this->m_last_value_more = true;
             }
+
+            m_values_prepared = true;
+        }
+
+        /// Writes Buffered Double Array PV Values to Nexus File
+        void flushValueBuffers
+        (
+            std::vector< std::vector<double> > &value_buffer ///< Double Array Buffer to Write
+        )
+        {
+            // Already Packed by prepareFinalFlush()...?
+            if ( !m_values_prepared )
+                prepareValueBuffers( value_buffer );
+            m_values_prepared = false;
+
+            // Write 2D Double Array to NeXus File...
+            if ( value_buffer.size() )
+            {
+                std::vector<hsize_t> dims;
+                dims.push_back( value_buffer.size() );
+                dims.push_back( m_packed_max_len );
+
+                m_nxgen.writeMultidimDataset( m_log_path,
+                    "value", m_packed_doubles, dims, this->m_units );
+
+                std::vector<double>().swap( m_packed_doubles );
+            }
             else
             {
                 syslog( LOG_INFO, "[%i] %s %s, %s", g_pid,
@@ -790,6 +892,48 @@ private:
             }
         }
 
+        /// CPU-Side Preparation of the Final PV Buffer Flush
+        ///
+        /// Normalizes any pre-first-pulse value times (adding them to the
+        /// statistics) and scans/packs the buffered values for writing,
+        /// ahead of the final flushBuffers() call. Only touches this PV,
+        /// never the NeXus file, so StreamParser runs it for many PVs at
+        /// once on worker threads; flushBuffers() then just writes.
+        void prepareFinalFlush
+        (
+            uint64_t start_time     ///< 1st Pulse Time (nanosecs), if set
+        )
+        {
+            if ( this->m_has_non_normalized && start_time )
+            {
+                if ( m_nxgen.verbose() > 1 ) {
+                    syslog( LOG_INFO,
+                        "[%i] %s %s %s %s, %s: %s",
+                        g_pid, "NxPVInfo::prepareFinalFlush()",
+                        this->m_device_str.c_str(),
+                        "Normalizing PV Value Times",
+                        "with First Pulse Time",
+                        "Now Available",
+                        this->m_pv_str.c_str() );
+                    give_syslog_a_chance;
+                }
+
+                this->normalizeTimestamps( start_time,
+                    m_nxgen.verbose() );
+            }
+
+            // Only PVs flushBuffers() Will Actually Write...
+            if ( !m_nxgen.m_gen_nexus || this->m_ignore
+                    || this->m_duplicate
+                    || this->m_has_non_normalized
+                    || !(this->m_value_buffer.size()) )
+            {
+                return;
+            }
+
+            prepareValueBuffers( this->m_value_buffer );
+        }
+
         /// Writes buffered PV values and time axis to Nexus file and performs finalization
         int32_t flushBuffers
         (
@@ -2907,6 +3051,14 @@ private:
         uint32_t        m_value_enum_strings_max_len;   ///< Max Length of Enumerated Type Value Strings
         uint32_t        m_value_enum_strings_not_found;   ///< Number of Enumerated Type Value Strings Not Found
         bool            m_finalized;    ///< Flag to Indicate PV Log has been Finalized
+        bool            m_values_prepared;  ///< Value Buffer Already Scanned/Packed by prepareValueBuffers()
+        uint32_t        m_packed_max_len;   ///< Row Length of Packed String/Array Values
+        std::vector<std::string>
+                        m_packed_strings;   ///< Packed (Padded) String Values
+        std::vector<uint32_t>
+                        m_packed_uints;     ///< Packed (Zero-Padded) Uint32 Array Values
+        std::vector<double>
+                        m_packed_doubles;   ///< Packed (Zero-Padded) Double Array Values
     };
 
 public:
@@ -2983,6 +3135,8 @@ protected:
     void                monitorPulseGap( STC::MonitorInfo &a_monitor,
                             uint64_t a_count );
     void                monitorFinalize( STC::MonitorInfo &a_monitor );
+    uint64_t            stitchPartial( const std::string &a_path,
+                            uint64_t a_pulse_offset );
     void                runComment( double a_time, uint64_t a_ts_nano,
                             const std::string &a_comment,
                             bool a_force_init = false );
@@ -3027,7 +3181,28 @@ private:
                             std::vector<TypeT> &a_data,
                             std::vector<hsize_t> &a_dims,
                             const std::string a_units = "" );
+    void                writeHistogramDataset(
+                            const std::string &a_path,
+                            const std::string &a_name,
+                            const STC::SparseHistogram &a_histo,
+                            std::vector<hsize_t> &a_dims );
+
+    bool                partialHasPath( H5nx &a_partial,
+                            const std::string &a_path );
+    void                readPartialScalar( H5nx &a_partial,
+                            const std::string &a_path, uint64_t &a_value,
+                            const std::string &a_attr = "" );
+    void                readPartialDims( H5nx &a_partial,
+                            const std::string &a_path,
+                            std::vector<hsize_t> &a_dims );
+    template <typename TypeT>
+    void                readPartialSlab( H5nx &a_partial,
+                            const std::string &a_path,
+                            std::vector<TypeT> &a_slab,
+                            uint64_t a_size, uint64_t a_offset );
 
+    void                loadSTCConfigFile(
+                            const std::string &a_config_file );
     void                parseSTCConfigFile(
                             const std::string &a_config_file );
 
@@ -3146,6 +3321,21 @@ private:
     std::vector<struct CommandInfo>
                         m_config_commands;      ///< Vector of STC Config Pre-Post-Autoreduction Commands
 
+    /// Last STC Config File parsed in this process (i.e. by a persistent
+    /// STC daemon worker), re-used until the file changes
+    struct STCConfigCache
+    {
+        STCConfigCache() : mtime(0), size(0) {}
+
+        std::string                         path;
+        time_t                              mtime;
+        off_t                               size;
+        std::vector<struct GroupInfo>       groups;
+        std::vector<struct CommandInfo>     commands;
+    };
+
+    static STCConfigCache s_config_cache;
+
 
     std::string         m_entry_path;           ///< Path to Nexus NXentry
     std::string         m_instrument_path;      ///< Path to Nexus NXinstrument
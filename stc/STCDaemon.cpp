@@ -0,0 +1,436 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include "STCDaemon.h"
+
+using namespace std;
+
+
+volatile sig_atomic_t STCDaemon::s_stop = 0;
+volatile sig_atomic_t STCDaemon::s_report = 0;
+
+
+/** \brief STCDaemon constructor
+  * \param a_port - TCP port to accept SMS connections on
+  * \param a_workers - Number of worker processes
+  * \param a_max_runs - Translations before a worker retires (0 = never)
+  * \param a_report_period - Seconds between throughput logs (0 = off)
+  */
+STCDaemon::STCDaemon( unsigned short a_port, uint32_t a_workers,
+        uint32_t a_max_runs, uint32_t a_report_period ) :
+    m_port(a_port), m_workers(a_workers ? a_workers : 1),
+    m_max_runs(a_max_runs), m_report_period(a_report_period),
+    m_listen_fd(-1), m_respawn_after(0)
+{
+    m_report_pipe[0] = m_report_pipe[1] = -1;
+}
+
+
+/** \brief STCDaemon destructor
+  */
+STCDaemon::~STCDaemon()
+{
+    if ( m_listen_fd >= 0 )
+        close( m_listen_fd );
+    if ( m_report_pipe[0] >= 0 )
+        close( m_report_pipe[0] );
+    if ( m_report_pipe[1] >= 0 )
+        close( m_report_pipe[1] );
+}
+
+
+/** \brief Runs the daemon until SIGTERM/SIGINT
+  * \param a_handler - Translation handler for each SMS connection
+  * \return Process exit status (0 on clean shutdown)
+  *
+  * Only returns in the parent; workers exit from workerLoop().
+  */
+int
+STCDaemon::run( Handler a_handler )
+{
+    struct sigaction sa;
+    memset( &sa, 0, sizeof(sa) );
+    sa.sa_handler = signalHandler;
+    sigemptyset( &sa.sa_mask );
+    // No SA_RESTART, so poll() below wakes up on signals
+    sigaction( SIGTERM, &sa, 0 );
+    sigaction( SIGINT, &sa, 0 );
+    sigaction( SIGUSR1, &sa, 0 );
+    signal( SIGPIPE, SIG_IGN );
+
+    if ( !startListening() )
+        return 1;
+
+    if ( pipe( m_report_pipe ) < 0 )
+    {
+        syslog( LOG_ERR, "[%i] STC Error: stcd Report Pipe Failed - %s",
+            g_pid, strerror( errno ) );
+        give_syslog_a_chance;
+        return 1;
+    }
+    fcntl( m_report_pipe[0], F_SETFL, O_NONBLOCK );
+    fcntl( m_report_pipe[0], F_SETFD, FD_CLOEXEC );
+    fcntl( m_report_pipe[1], F_SETFD, FD_CLOEXEC );
+
+    syslog( LOG_INFO,
+        "[%i] stcd Listening on Port %u with %u Workers (%s=%u, %s=%u)",
+        g_pid, m_port, m_workers, "max_runs", m_max_runs,
+        "report_period", m_report_period );
+    give_syslog_a_chance;
+
+    time_t last_report = time(0);
+
+    while ( !s_stop )
+    {
+        while ( m_stats.size() < m_workers && time(0) >= m_respawn_after )
+        {
+            if ( !spawnWorker( a_handler ) )
+                break;
+        }
+
+        struct pollfd pfd = { m_report_pipe[0], POLLIN, 0 };
+        poll( &pfd, 1, 1000 );
+
+        readReports();
+        reapWorkers( false );
+
+        if ( s_report || ( m_report_period
+                && time(0) - last_report >= (time_t) m_report_period ) )
+        {
+            s_report = 0;
+            report();
+            last_report = time(0);
+        }
+    }
+
+    syslog( LOG_INFO, "[%i] stcd Shutting Down, Waiting for %lu Workers",
+        g_pid, (unsigned long) m_stats.size() );
+    give_syslog_a_chance;
+
+    // New connections can wait for (or go to) the next stcd
+    close( m_listen_fd );
+    m_listen_fd = -1;
+
+    for ( map<pid_t,WorkerStats>::iterator w = m_stats.begin();
+            w != m_stats.end(); ++w )
+    {
+        kill( w->first, SIGTERM );
+    }
+
+    reapWorkers( true );
+    readReports();
+    report();
+
+    syslog( LOG_INFO, "[%i] stcd Exiting", g_pid );
+    give_syslog_a_chance;
+
+    return 0;
+}
+
+
+/** \brief Creates the listening socket shared by all workers
+  * \return True on success
+  */
+bool
+STCDaemon::startListening()
+{
+    m_listen_fd = socket( AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0 );
+    if ( m_listen_fd < 0 )
+    {
+        syslog( LOG_ERR, "[%i] STC Error: stcd Socket Failed - %s",
+            g_pid, strerror( errno ) );
+        give_syslog_a_chance;
+        return false;
+    }
+
+    int one = 1;
+    setsockopt( m_listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one) );
+
+    struct sockaddr_in addr;
+    memset( &addr, 0, sizeof(addr) );
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl( INADDR_ANY );
+    addr.sin_port = htons( m_port );
+
+    if ( bind( m_listen_fd, (struct sockaddr *) &addr, sizeof(addr) ) < 0
+            || listen( m_listen_fd, 64 ) < 0 )
+    {
+        syslog( LOG_ERR, "[%i] STC Error: stcd Can't Listen on Port %u - %s",
+            g_pid, m_port, strerror( errno ) );
+        give_syslog_a_chance;
+        return false;
+    }
+
+    // Workers all wait on the same socket; losers of the race for a
+    // new connection must not block in accept()
+    fcntl( m_listen_fd, F_SETFL, O_NONBLOCK );
+
+    return true;
+}
+
+
+/** \brief Forks a new worker process
+  * \param a_handler - Translation handler for the worker
+  * \return True if the worker was started
+  */
+bool
+STCDaemon::spawnWorker( Handler &a_handler )
+{
+    pid_t pid = fork();
+
+    if ( pid < 0 )
+    {
+        syslog( LOG_ERR, "[%i] STC Error: stcd Fork Failed - %s",
+            g_pid, strerror( errno ) );
+        give_syslog_a_chance;
+        m_respawn_after = time(0) + 5;
+        return false;
+    }
+
+    if ( pid == 0 )
+    {
+        workerLoop( a_handler );
+        exit( 0 );
+    }
+
+    m_stats[pid].started = time(0);
+
+    syslog( LOG_INFO, "[%i] stcd Started Worker %d (%lu of %u)",
+        g_pid, pid, (unsigned long) m_stats.size(), m_workers );
+    give_syslog_a_chance;
+
+    return true;
+}
+
+
+/** \brief Worker process main loop
+  * \param a_handler - Translation handler for each connection
+  *
+  * Accepts and translates SMS connections one at a time until told to
+  * stop, the parent goes away, or m_max_runs translations are done.
+  */
+void
+STCDaemon::workerLoop( Handler &a_handler )
+{
+    g_pid = getpid();
+
+    close( m_report_pipe[0] );
+    m_report_pipe[0] = -1;
+
+    // Let a busy worker finish its run on SIGTERM, don't interrupt it
+    struct sigaction sa;
+    memset( &sa, 0, sizeof(sa) );
+    sa.sa_handler = signalHandler;
+    sa.sa_flags = SA_RESTART;
+    sigemptyset( &sa.sa_mask );
+    sigaction( SIGTERM, &sa, 0 );
+    sigaction( SIGINT, &sa, 0 );
+    signal( SIGUSR1, SIG_IGN );
+
+    prctl( PR_SET_PDEATHSIG, SIGTERM );
+    if ( getppid() == 1 )
+        exit( 0 );
+
+    syslog( LOG_INFO, "[%i] stcd Worker Ready", g_pid );
+    give_syslog_a_chance;
+
+    uint32_t runs = 0;
+
+    while ( !s_stop && ( !m_max_runs || runs < m_max_runs ) )
+    {
+        struct pollfd pfd = { m_listen_fd, POLLIN, 0 };
+        if ( poll( &pfd, 1, 1000 ) <= 0 )
+            continue;
+
+        struct sockaddr_in peer;
+        socklen_t peer_len = sizeof(peer);
+        int fd = accept( m_listen_fd, (struct sockaddr *) &peer, &peer_len );
+        if ( fd < 0 )
+        {
+            // Another worker got it
+            if ( errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR
+                    || errno == ECONNABORTED )
+            {
+                continue;
+            }
+
+            syslog( LOG_ERR, "[%i] STC Error: stcd Accept Failed - %s",
+                g_pid, strerror( errno ) );
+            give_syslog_a_chance;
+            sleep( 1 );
+            continue;
+        }
+
+        // Translation reads block (the listening socket doesn't)
+        fcntl( fd, F_SETFL, fcntl( fd, F_GETFL ) & ~O_NONBLOCK );
+
+        char addr[INET_ADDRSTRLEN] = "unknown";
+        inet_ntop( AF_INET, &peer.sin_addr, addr, sizeof(addr) );
+
+        syslog( LOG_INFO, "[%i] stcd Worker Accepted SMS Connection from %s:%u",
+            g_pid, addr, ntohs( peer.sin_port ) );
+        give_syslog_a_chance;
+
+        struct timespec start, end;
+        clock_gettime( CLOCK_MONOTONIC, &start );
+
+        RunReport rpt;
+        memset( &rpt, 0, sizeof(rpt) );
+        rpt.pid = g_pid;
+        rpt.bytes = 0;
+        rpt.code = a_handler( fd, rpt.bytes );
+
+        close( fd );
+
+        clock_gettime( CLOCK_MONOTONIC, &end );
+        rpt.secs = ( end.tv_sec - start.tv_sec )
+            + ( end.tv_nsec - start.tv_nsec ) * 1e-9;
+
+        // Nothing useful to do if the parent's gone
+        if ( write( m_report_pipe[1], &rpt, sizeof(rpt) ) < 0 ) { }
+
+        ++runs;
+    }
+
+    syslog( LOG_INFO, "[%i] stcd Worker Exiting After %u Runs%s",
+        g_pid, runs, ( s_stop ? "" : " (Retiring)" ) );
+    give_syslog_a_chance;
+}
+
+
+/** \brief Collects translation reports from workers
+  */
+void
+STCDaemon::readReports()
+{
+    RunReport rpt;
+
+    // Reports are written whole, so they're read whole too
+    while ( read( m_report_pipe[0], &rpt, sizeof(rpt) )
+            == (ssize_t) sizeof(rpt) )
+    {
+        WorkerStats &w = m_stats[rpt.pid];
+
+        w.runs++;
+        if ( rpt.code != STC::TS_SUCCESS )
+            w.failures++;
+        w.bytes += rpt.bytes;
+        w.busy += rpt.secs;
+
+        syslog( LOG_INFO,
+            "[%i] stcd Worker %d Run Done: %s=%u, %.1f MB in %.1f s (%.1f MB/s)",
+            g_pid, rpt.pid, "code", rpt.code, rpt.bytes / 1e6, rpt.secs,
+            ( rpt.secs > 0.0 ) ? rpt.bytes / 1e6 / rpt.secs : 0.0 );
+        give_syslog_a_chance;
+    }
+}
+
+
+/** \brief Reaps exited workers, folding their stats into the totals
+  * \param a_wait - Block until all workers have exited
+  */
+void
+STCDaemon::reapWorkers( bool a_wait )
+{
+    int status;
+    pid_t pid;
+
+    while ( !m_stats.empty()
+            && ( pid = waitpid( -1, &status, a_wait ? 0 : WNOHANG ) ) != 0 )
+    {
+        if ( pid < 0 )
+        {
+            if ( errno == EINTR )
+                continue;
+            break;
+        }
+
+        // Its last report may still be in the pipe
+        readReports();
+
+        map<pid_t,WorkerStats>::iterator w = m_stats.find( pid );
+        if ( w == m_stats.end() )
+            continue;
+
+        bool failed = !WIFEXITED( status ) || WEXITSTATUS( status ) != 0;
+
+        syslog( failed ? LOG_ERR : LOG_INFO,
+            "[%i] %sstcd Worker %d Exited (%s %d) After %lu Runs",
+            g_pid, ( failed ? "STC Error: " : "" ), pid,
+            ( WIFSIGNALED( status ) ? "signal" : "status" ),
+            ( WIFSIGNALED( status ) ? WTERMSIG( status )
+                : WEXITSTATUS( status ) ),
+            (unsigned long) w->second.runs );
+        give_syslog_a_chance;
+
+        // Don't spin forking workers that die straight away
+        if ( failed && !s_stop && time(0) - w->second.started < 5 )
+            m_respawn_after = time(0) + 5;
+
+        m_retired.runs += w->second.runs;
+        m_retired.failures += w->second.failures;
+        m_retired.bytes += w->second.bytes;
+        m_retired.busy += w->second.busy;
+
+        m_stats.erase( w );
+    }
+}
+
+
+/** \brief Logs per-worker and total translation throughput
+  */
+void
+STCDaemon::report()
+{
+    WorkerStats total = m_retired;
+    time_t now = time(0);
+
+    for ( map<pid_t,WorkerStats>::iterator w = m_stats.begin();
+            w != m_stats.end(); ++w )
+    {
+        syslog( LOG_INFO,
+            "[%i] stcd Worker %d: %lu Runs (%lu Failed), %.1f MB in %.1f s Busy (%.1f MB/s), Up %ld s",
+            g_pid, w->first, (unsigned long) w->second.runs,
+            (unsigned long) w->second.failures, w->second.bytes / 1e6,
+            w->second.busy, ( w->second.busy > 0.0 )
+                ? w->second.bytes / 1e6 / w->second.busy : 0.0,
+            (long) ( now - w->second.started ) );
+        give_syslog_a_chance;
+
+        total.runs += w->second.runs;
+        total.failures += w->second.failures;
+        total.bytes += w->second.bytes;
+        total.busy += w->second.busy;
+    }
+
+    syslog( LOG_INFO,
+        "[%i] stcd Total: %lu Runs (%lu Failed), %.1f MB in %.1f s Busy (%.1f MB/s)",
+        g_pid, (unsigned long) total.runs, (unsigned long) total.failures,
+        total.bytes / 1e6, total.busy,
+        ( total.busy > 0.0 ) ? total.bytes / 1e6 / total.busy : 0.0 );
+    give_syslog_a_chance;
+}
+
+
+/** \brief Signal handler for parent and workers
+  * \param a_sig - Signal number
+  */
+void
+STCDaemon::signalHandler( int a_sig )
+{
+    if ( a_sig == SIGUSR1 )
+        s_report = 1;
+    else
+        s_stop = 1;
+}
+
+// vim: expandtab
@@ -0,0 +1,92 @@
+#ifndef STCDAEMON_H
+#define STCDAEMON_H
+
+#include <signal.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/types.h>
+#include <map>
+#include <boost/function.hpp>
+#include "stcdefs.h"
+
+
+/** \brief Persistent STC server ("stcd" mode) with pre-forked workers
+  *
+  * Instead of xinetd launching a new STC for every run, the STCDaemon
+  * listens on the STC port itself and keeps a pool of forked worker
+  * processes. Each worker accepts one SMS connection at a time and
+  * translates it with the supplied handler, then goes back for the next.
+  * Workers outlive individual runs, so the parsed STC Config File (only
+  * re-parsed when it changes), the LDAP connection and the ComBus
+  * connection stay warm across runs.
+  *
+  * Workers are replaced when they exit, and retire themselves after a
+  * set number of translations to bound any per-run leaks. After every
+  * translation a worker reports to the parent, which logs per-worker
+  * and total throughput periodically (and on SIGUSR1). On SIGTERM,
+  * idle workers exit right away and busy ones finish their run first.
+  */
+class STCDaemon
+{
+public:
+    /// Translates one SMS connection (socket fd), returning the status
+    /// code and the number of stream bytes processed
+    typedef boost::function<STC::TranslationStatusCode ( int, uint64_t & )>
+        Handler;
+
+    STCDaemon( unsigned short a_port, uint32_t a_workers,
+        uint32_t a_max_runs, uint32_t a_report_period );
+    ~STCDaemon();
+
+    int     run( Handler a_handler );
+
+private:
+    /// Sent from a worker to the parent after each translation
+    /// (small enough for an atomic pipe write)
+    struct RunReport
+    {
+        pid_t       pid;
+        uint32_t    code;
+        uint64_t    bytes;
+        double      secs;
+    };
+
+    /// Parent's running totals for a worker
+    struct WorkerStats
+    {
+        WorkerStats() : started(0), runs(0), failures(0), bytes(0),
+            busy(0.0) {}
+
+        time_t      started;
+        uint64_t    runs;
+        uint64_t    failures;
+        uint64_t    bytes;
+        double      busy;       ///< Seconds spent translating
+    };
+
+    bool    startListening();
+    bool    spawnWorker( Handler &a_handler );
+    void    workerLoop( Handler &a_handler );
+    void    readReports();
+    void    reapWorkers( bool a_wait );
+    void    report();
+
+    static void signalHandler( int a_sig );
+
+    unsigned short                  m_port;
+    uint32_t                        m_workers;          ///< Pool size
+    uint32_t                        m_max_runs;         ///< Runs before a worker retires (0 = never)
+    uint32_t                        m_report_period;    ///< Seconds between throughput logs (0 = off)
+    int                             m_listen_fd;
+    int                             m_report_pipe[2];   ///< Workers to parent
+    std::map<pid_t,WorkerStats>     m_stats;            ///< Current workers
+    WorkerStats                     m_retired;          ///< Totals for workers since exited
+    time_t                          m_respawn_after;    ///< Back off after workers fail at startup
+
+    static volatile sig_atomic_t    s_stop;
+    static volatile sig_atomic_t    s_report;
+};
+
+#endif // STCDAEMON_H
+
+// vim: expandtab
@@ -0,0 +1,288 @@
+#ifndef SPARSEHISTOGRAM_H
+#define SPARSEHISTOGRAM_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include <vector>
+
+namespace STC {
+
+
+/// Adaptive (Sparse Until Busy) Histogram Counts
+///
+/// Holds a flat array of uint32_t counts (a detector bank's pixel x TOF
+/// bin histogram) without allocating it all up front. The cells are
+/// split into fixed blocks; each block starts out as a small hash of
+/// just the cells that have been counted, and is converted to a plain
+/// dense array once enough of its cells are in use that the hash would
+/// be no smaller. Blocks nobody counts into cost nothing beyond their
+/// (small) descriptor, so wide banks with fine TOF binning only pay for
+/// the parts of the histogram that actually see neutrons.
+///
+/// copyOut() materializes any range of cells (zeros included), so the
+/// histogram can be written out a slab at a time.
+class SparseHistogram
+{
+public:
+    /// 16K Cells (64 KB Dense) per Block
+    enum { BLOCK_SHIFT = 14, BLOCK_CELLS = 1 << BLOCK_SHIFT,
+        BLOCK_MASK = BLOCK_CELLS - 1 };
+
+    /// Blocks Go Dense Once 1/8 of Their Cells Have Counts
+    enum { DENSE_THRESHOLD = BLOCK_CELLS / 8 };
+
+    SparseHistogram() : m_size(0) {}
+
+    ~SparseHistogram()
+    {
+        clear();
+    }
+
+    /// (Re)initialize to a_size cells, all zero
+    void init( uint64_t a_size )
+    {
+        clear();
+        m_size = a_size;
+        m_blocks.resize( ( a_size + BLOCK_MASK ) >> BLOCK_SHIFT );
+    }
+
+    uint64_t size() const { return m_size; }
+
+    /// Count one event in a cell (a_index < size(), caller checks)
+    inline void increment( uint64_t a_index )
+    {
+        Block &b = m_blocks[ a_index >> BLOCK_SHIFT ];
+        uint32_t off = (uint32_t) ( a_index & BLOCK_MASK );
+
+        if ( b.dense )
+            b.dense[ off ]++;
+        else
+            sparseIncrement( b, off, 1 );
+    }
+
+    /// Count a_count events in a cell at once (a_index < size())
+    void add( uint64_t a_index, uint32_t a_count )
+    {
+        Block &b = m_blocks[ a_index >> BLOCK_SHIFT ];
+        uint32_t off = (uint32_t) ( a_index & BLOCK_MASK );
+
+        if ( b.dense )
+            b.dense[ off ] += a_count;
+        else
+            sparseIncrement( b, off, a_count );
+    }
+
+    /// Current count for a cell
+    uint32_t get( uint64_t a_index ) const
+    {
+        const Block &b = m_blocks[ a_index >> BLOCK_SHIFT ];
+        uint32_t off = (uint32_t) ( a_index & BLOCK_MASK );
+
+        if ( b.dense )
+            return b.dense[ off ];
+
+        if ( !b.cap )
+            return 0;
+
+        for ( uint32_t i = hash( off, b.bits ) ; ;
+                i = ( i + 1 ) & ( b.cap - 1 ) )
+        {
+            if ( b.keys[i] == off + 1 )
+                return b.counts[i];
+            if ( !b.keys[i] )
+                return 0;
+        }
+    }
+
+    /// Fill a_out with the counts for cells [a_begin, a_begin + a_count)
+    void copyOut( uint64_t a_begin, uint64_t a_count, uint32_t *a_out ) const
+    {
+        uint64_t end = a_begin + a_count;
+
+        memset( a_out, 0, a_count * sizeof(uint32_t) );
+
+        for ( uint64_t blk = a_begin >> BLOCK_SHIFT ;
+                blk < m_blocks.size()
+                    && ( blk << BLOCK_SHIFT ) < end ; blk++ )
+        {
+            const Block &b = m_blocks[ blk ];
+            uint64_t base = blk << BLOCK_SHIFT;
+
+            if ( b.dense )
+            {
+                uint64_t from = ( base > a_begin ) ? base : a_begin;
+                uint64_t to = ( base + BLOCK_CELLS < end )
+                    ? base + BLOCK_CELLS : end;
+                if ( to > m_size )
+                    to = m_size;
+                if ( from < to )
+                {
+                    memcpy( a_out + ( from - a_begin ),
+                        b.dense + ( from - base ),
+                        ( to - from ) * sizeof(uint32_t) );
+                }
+            }
+            else
+            {
+                for ( uint32_t i = 0 ; i < b.cap ; i++ )
+                {
+                    if ( !b.keys[i] )
+                        continue;
+                    uint64_t cell = base + b.keys[i] - 1;
+                    if ( cell >= a_begin && cell < end )
+                        a_out[ cell - a_begin ] = b.counts[i];
+                }
+            }
+        }
+    }
+
+    /// Blocks Converted to Dense Arrays So Far
+    uint64_t denseBlocks() const
+    {
+        uint64_t n = 0;
+        for ( size_t blk = 0 ; blk < m_blocks.size() ; blk++ )
+            n += ( m_blocks[blk].dense != 0 );
+        return n;
+    }
+
+    /// Bytes Used for Counts (vs. size() * 4 for a Dense Array)
+    uint64_t memoryUsed() const
+    {
+        uint64_t bytes = m_blocks.size() * sizeof(Block);
+        for ( size_t blk = 0 ; blk < m_blocks.size() ; blk++ )
+        {
+            if ( m_blocks[blk].dense )
+                bytes += BLOCK_CELLS * sizeof(uint32_t);
+            else
+                bytes += m_blocks[blk].cap * 2 * sizeof(uint32_t);
+        }
+        return bytes;
+    }
+
+private:
+    struct Block
+    {
+        Block() : dense(0), keys(0), counts(0), cap(0), used(0), bits(0) {}
+
+        uint32_t   *dense;      ///< All Cells, Once Busy Enough
+        uint32_t   *keys;       ///< Hash: Cell Offset + 1 (0 = Empty)
+        uint32_t   *counts;     ///< Hash: Count per Key
+        uint32_t    cap;        ///< Hash Slots (Power of Two)
+        uint32_t    used;       ///< Hash Slots in Use
+        uint32_t    bits;       ///< log2( cap )
+    };
+
+    static inline uint32_t hash( uint32_t a_off, uint32_t a_bits )
+    {
+        return ( a_off * 0x9E3779B1U ) >> ( 32 - a_bits );
+    }
+
+    void sparseIncrement( Block &b, uint32_t a_off, uint32_t a_count )
+    {
+        if ( !b.cap )
+            rehash( b, 4 );
+
+        uint32_t i = hash( a_off, b.bits );
+        while ( b.keys[i] )
+        {
+            if ( b.keys[i] == a_off + 1 )
+            {
+                b.counts[i] += a_count;
+                return;
+            }
+            i = ( i + 1 ) & ( b.cap - 1 );
+        }
+
+        // New Cell...
+        if ( b.used + 1 > DENSE_THRESHOLD )
+        {
+            densify( b );
+            b.dense[ a_off ] += a_count;
+            return;
+        }
+
+        b.keys[i] = a_off + 1;
+        b.counts[i] = a_count;
+
+        // Keep the Hash At Most Half Full
+        if ( ++b.used * 2 > b.cap )
+            rehash( b, b.bits + 1 );
+    }
+
+    void rehash( Block &b, uint32_t a_bits )
+    {
+        uint32_t cap = 1U << a_bits;
+        uint32_t *keys = allocate( cap );
+        uint32_t *counts = allocate( cap );
+
+        for ( uint32_t j = 0 ; j < b.cap ; j++ )
+        {
+            if ( !b.keys[j] )
+                continue;
+            uint32_t i = hash( b.keys[j] - 1, a_bits );
+            while ( keys[i] )
+                i = ( i + 1 ) & ( cap - 1 );
+            keys[i] = b.keys[j];
+            counts[i] = b.counts[j];
+        }
+
+        free( b.keys );
+        free( b.counts );
+        b.keys = keys;
+        b.counts = counts;
+        b.cap = cap;
+        b.bits = a_bits;
+    }
+
+    void densify( Block &b )
+    {
+        b.dense = allocate( BLOCK_CELLS );
+
+        for ( uint32_t j = 0 ; j < b.cap ; j++ )
+        {
+            if ( b.keys[j] )
+                b.dense[ b.keys[j] - 1 ] = b.counts[j];
+        }
+
+        free( b.keys );
+        free( b.counts );
+        b.keys = b.counts = 0;
+        b.cap = b.used = b.bits = 0;
+    }
+
+    static uint32_t *allocate( uint32_t a_cells )
+    {
+        uint32_t *p = (uint32_t *) calloc( a_cells, sizeof(uint32_t) );
+        if ( !p )
+            throw std::bad_alloc();
+        return p;
+    }
+
+    void clear()
+    {
+        for ( size_t blk = 0 ; blk < m_blocks.size() ; blk++ )
+        {
+            free( m_blocks[blk].dense );
+            free( m_blocks[blk].keys );
+            free( m_blocks[blk].counts );
+        }
+        m_blocks.clear();
+        m_size = 0;
+    }
+
+    // Not copyable
+    SparseHistogram( const SparseHistogram & );
+    SparseHistogram & operator=( const SparseHistogram & );
+
+    uint64_t                m_size;         ///< Total Cells
+    std::vector<Block>      m_blocks;       ///< Per-Block Storage
+};
+
+
+} // End STC Namespace
+
+#endif // SPARSEHISTOGRAM_H
+
+// vim: expandtab
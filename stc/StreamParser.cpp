@@ -1,10 +1,13 @@
 #include "StreamParser.h"
 #include "TransCompletePkt.h"
+#include <algorithm>
 #include <iomanip>
 #include <sstream>
 #include <string>
 #include <string.h>
 #include <boost/algorithm/string.hpp>
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
 #include <unistd.h>
 #include <syslog.h>
 #include <time.h>
@@ -31,6 +34,13 @@ RateLimitedLogging::History RLLHistory_StreamParserH;
 /// This sets the size of the ADARA parser stream buffer in bytes
 #define ADARA_IN_BUF_SIZE   0x3000000  // For Old "Direct" PixelMap Pkt!
 
+/// Max worker threads preparing PV logs for the final flush
+/// (Several STC instances may share a host, don't take it all...)
+#define PV_FINALIZE_THREADS_MAX     4
+
+/// Min PVs per worker thread, not worth the threads below this
+#define PV_FINALIZE_PVS_PER_THREAD  32
+
 
 //---------------------------------------------------------------------------------------------------------------------
 // Public StreamParser methods
@@ -83,6 +93,7 @@ StreamParser::StreamParser
     m_skipped_pkt_count(0),
     m_pulse_flag(0),
     m_verbose_level(a_verbose_level),
+    m_segment(false),
     m_pause_has_non_normalized(false),
     m_scan_has_non_normalized(false),
     m_comment_has_non_normalized(false)
@@ -335,6 +346,23 @@ StreamParser::processStream()
             // NOTE: This is POSIXParser::read()... ;-o
             if ( !read( m_fd, log_info ) )
             {
+                // A Segment of a Split Run Has No End-of-Run,
+                // It Just Stops After Its Last Pulse; Finalize It Here
+                // Just as an End-of-Run Would...
+                if ( m_segment && m_processing_state == PROCESSING_EVENTS )
+                {
+                    syslog( LOG_INFO,
+                        "[%i] %s: End of Run Segment After %lu Pulses.",
+                        g_pid, "processStream()", m_pulse_count );
+                    give_syslog_a_chance;
+
+                    m_run_metrics.run_end_time = nsec_to_timespec(
+                        m_pulse_info.start_time + m_pulse_info.max_time );
+
+                    finalizeStreamProcessing();
+                    m_processing_state = DONE_PROCESSING;
+                }
+
                 if ( m_processing_state != DONE_PROCESSING )
                 {
                     stringstream ss;
@@ -580,6 +608,7 @@ StreamParser::rxPacket
         case ADARA::PacketType::CLIENT_HELLO_TYPE:
         case ADARA::PacketType::SYNC_TYPE:
         case ADARA::PacketType::HEARTBEAT_TYPE:
+        case ADARA::PacketType::HISTO_PREVIEW_TYPE:
             if ( m_gather_stats )
                 ++m_skipped_pkt_count;
     }
@@ -2013,6 +2042,16 @@ StreamParser::processBankEvents
         }
     }
 
+    // Stitching Partial Translations, Banks are Created and Initialized
+    // Here Just as in a Serial Run, But All of Their Events (and Event
+    // Counts) Come from the Partials... (see stitchPartials())
+    if ( isStitching() )
+    {
+        if ( bi != NULL && !(bi->m_initialized) )
+            bi->initializeBank( false, m_verbose_level );
+        return;
+    }
+
     // Valid Detector Bank ID...
     if ( bi != NULL )
     {
@@ -2181,21 +2220,28 @@ StreamParser::processBankEvents
                                     pid - bi->m_base_pid ] >= 0 )
                         {
                             // Calculate index into Histogram based on TOF
-                            tofbin = ( tof - (*dbs)->tofOffset )
-                                / bi->m_tof_bin_size;
+                            // (Precomputed Divide by bi->m_tof_bin_size)
+                            tofbin = bi->m_tof_bin_div.divide(
+                                tof - (*dbs)->tofOffset );
 
                             // TOF Sanity Test, Just to Be Sure... ;-b
                             // (This should never happen,
                             //    but the logic is confusing.)
+                            // (A Zero TOF Bin Size Was Already Logged,
+                            //    Its Events All Land Here Quietly...)
                             if ( tofbin >= bi->m_num_tof_bins - 1 )
                             {
-                                syslog( LOG_ERR,
+                                if ( bi->m_tof_bin_size )
+                                {
+                                    syslog( LOG_ERR,
                                 "[%i] %s %s %u %s tof=%u tofbin=%u >= %u",
-                                    g_pid, "STC Error:",
-                                    "Detector Bank", bi->m_id,
-                                    "Histogram Error",
-                                    tof, tofbin, bi->m_num_tof_bins - 1 );
-                                give_syslog_a_chance;
+                                        g_pid, "STC Error:",
+                                        "Detector Bank", bi->m_id,
+                                        "Histogram Error",
+                                        tof, tofbin,
+                                        bi->m_num_tof_bins - 1 );
+                                    give_syslog_a_chance;
+                                }
                                 // Count Uncounted Detector Histo Events...
                                 (bi->m_histo_event_uncounted)++;
                                 continue;
@@ -2227,7 +2273,7 @@ StreamParser::processBankEvents
                             }
 
                             // Increment Histogram Time Slot...
-                            (bi->m_data_buffer[ index ])++;
+                            bi->m_histo_data.increment( index );
 
                             // Count Detector Events for Histogram Mode Too
                             (bi->m_histo_event_count)++;
@@ -2440,7 +2486,9 @@ StreamParser::rxPacket
         rpos += event_count;
 
         // Monitor events are counted as non-events
-        m_run_metrics.non_events_counted += event_count;
+        // (Unless Stitching, the Partials Count Them...)
+        if ( !isStitching() )
+            m_run_metrics.non_events_counted += event_count;
     }
 
     return false;
@@ -2494,6 +2542,10 @@ StreamParser::processMonitorEvents
             pair<Identifier, MonitorInfo*>( a_monitor_id, mi ) );
     }
 
+    // Stitching Partial Translations, Events Come from the Partials...
+    if ( isStitching() )
+        return;
+
     const uint32_t *epos = a_rpos + a_event_count;
 
     // Histo-based Monitors...
@@ -2518,19 +2570,25 @@ StreamParser::processMonitorEvents
                     && tof < imi->second->m_config.tofMax )
             {
                 // Calculate index into Histogram based on TOF...
-                tofbin = ( tof - imi->second->m_config.tofOffset )
-                    / imi->second->m_config.tofBin;
+                // (Precomputed Divide by m_config.tofBin)
+                tofbin = imi->second->m_tof_bin_div.divide(
+                    tof - imi->second->m_config.tofOffset );
 
                 // Sanity Test, Just to Be Sure... ;-b
                 // (This should never happen, but the logic is confusing.)
+                // (A Zero TOF Bin Size Was Already Logged,
+                //    Its Events All Land Here Quietly...)
                 if ( tofbin >= imi->second->m_num_tof_bins - 1 )
                 {
-                    syslog( LOG_ERR,
+                    if ( imi->second->m_config.tofBin )
+                    {
+                        syslog( LOG_ERR,
                     "[%i] %s %s %u Histogram Error tof=%u index=%u >= %u",
-                        g_pid, "STC Error:", "Beam Monitor",
-                        imi->second->m_id, tof, tofbin,
-                        imi->second->m_num_tof_bins - 1 );
-                    give_syslog_a_chance;
+                            g_pid, "STC Error:", "Beam Monitor",
+                            imi->second->m_id, tof, tofbin,
+                            imi->second->m_num_tof_bins - 1 );
+                        give_syslog_a_chance;
+                    }
                     // Count Uncounted Beam Monitor Events...
                     (imi->second->m_event_uncounted)++;
                     continue;
@@ -7332,6 +7390,11 @@ StreamParser::finalizeStreamProcessing()
 
     pulseBuffersReady( m_pulse_info );
 
+    // Merge In the Events of Any Partial Translations, Now That All of
+    // the Run's Banks and Monitors Exist, But Before They're Finalized...
+    if ( isStitching() )
+        stitchPartials();
+
     // Write any remaining data in bank buffers
 
     for ( uint32_t i=0 ; i < m_banks_arr_size ; i++ )
@@ -7440,7 +7503,11 @@ StreamParser::finalizeStreamProcessing()
         writeDeviceEnums( ienum->first, ienum->second );
     }
 
+    // Normalize/Scan/Pack Remaining PV Buffers in Parallel...
+    prepareFinalPVFlush( timespec_to_nsec( m_run_metrics.run_start_time ) );
+
     // Write Any Remaining Data in PV Buffers
+    // (One PV at a Time, the NeXus Writes are Serialized Here)
 
     for ( vector<PVInfoBase*>::iterator ipv = m_pvs_list.begin();
             ipv != m_pvs_list.end(); ++ipv )
@@ -7472,6 +7539,301 @@ StreamParser::finalizeStreamProcessing()
 }
 
 
+/*! \brief This method stitches the partial (segment) translations of a split run.
+ *
+ * This method merges the event data of each partial NeXus file, in pulse
+ * order, into the banks and monitors of this translation (of the run's
+ * event-free "skeleton" stream), via the stitchPartial() virtual method.
+ * Everything else (pulse times and charge, PV logs, markers, run times)
+ * comes from the skeleton stream itself, exactly as for a serial
+ * translation. The partials must account for every one of the run's
+ * pulses, else the stitched event indices would be wrong.
+ */
+void
+StreamParser::stitchPartials()
+{
+    uint64_t pulse_offset = 0;
+
+    for ( vector<string>::iterator f = m_stitch_files.begin();
+            f != m_stitch_files.end(); ++f )
+    {
+        syslog( LOG_INFO,
+            "[%i] %s: Stitching Partial Translation %s at Pulse %lu",
+            g_pid, "StreamParser::stitchPartials()",
+            f->c_str(), pulse_offset );
+        give_syslog_a_chance;
+
+        pulse_offset += stitchPartial( *f, pulse_offset );
+
+        if ( pulse_offset > m_pulse_count )
+            break;
+    }
+
+    if ( pulse_offset != m_pulse_count )
+    {
+        THROW_TRACE( ERR_UNEXPECTED_INPUT,
+            "Partial translations hold " << pulse_offset
+                << " pulses, but the run has " << m_pulse_count
+                << " - not the segments of this run?" )
+    }
+}
+
+
+/*! \brief This method appends a partial translation's event index to a detector bank.
+ *
+ * The partial's event index (a_count pulses, starting after a_pulse_offset
+ * pulses of the run) counts from its own first event, so a_base (the
+ * bank's event count before the partial's events) is added to each entry.
+ * Any pulses since the bank last had data are filled first, as for a
+ * pulse gap in the stream.
+ */
+void
+StreamParser::stitchBankIndex
+(
+    BankInfo                    &a_bi,              ///< [in] Detector bank to stitch into
+    uint64_t                    a_pulse_offset,     ///< [in] Run pulses before this index chunk
+    const vector<uint64_t>      &a_index,           ///< [in] Partial event index chunk
+    uint64_t                    a_count,            ///< [in] Number of pulses in index chunk
+    uint64_t                    a_base              ///< [in] Bank event count before the partial
+)
+{
+    if ( a_bi.m_last_pulse_with_data < a_pulse_offset )
+    {
+        handleBankPulseGap( a_bi,
+            a_pulse_offset - a_bi.m_last_pulse_with_data );
+    }
+
+    for ( uint64_t i=0 ; i < a_count ; i++ )
+        a_bi.m_index_buffer.push_back( a_base + a_index[i] );
+
+    a_bi.m_last_pulse_with_data = a_pulse_offset + a_count;
+
+    if ( a_bi.m_index_buffer.size() >= m_anc_buf_write_thresh )
+    {
+        bankIndexBuffersReady( a_bi, false );
+
+        a_bi.m_index_buffer.clear();
+    }
+}
+
+
+/*! \brief This method appends a partial translation's events to a detector bank.
+ */
+void
+StreamParser::stitchBankEvents
+(
+    BankInfo                    &a_bi,      ///< [in] Detector bank to stitch into
+    const vector<float>         &a_tof,     ///< [in] Partial event time of flight chunk
+    const vector<uint32_t>      &a_pid,     ///< [in] Partial event pixel id chunk
+    uint64_t                    a_count     ///< [in] Number of events in chunk
+)
+{
+    size_t sz = a_bi.m_tof_buffer_size;
+
+    if ( sz + a_count > a_bi.m_tof_buffer.size() )
+    {
+        a_bi.m_tof_buffer.resize( sz + a_count, (float) -1.0 );
+        a_bi.m_pid_buffer.resize( sz + a_count, (uint32_t) -1 );
+    }
+
+    std::copy( a_tof.begin(), a_tof.begin() + a_count,
+        a_bi.m_tof_buffer.begin() + sz );
+    std::copy( a_pid.begin(), a_pid.begin() + a_count,
+        a_bi.m_pid_buffer.begin() + sz );
+
+    a_bi.m_tof_buffer_size += a_count;
+    a_bi.m_event_count += a_count;
+
+    if ( a_bi.m_tof_buffer_size >= m_event_buf_write_thresh )
+    {
+        bankPidTOFBuffersReady( a_bi );
+
+        a_bi.m_tof_buffer_size = 0;
+    }
+}
+
+
+/*! \brief This method appends a partial translation's event index to a monitor.
+ *
+ * As for stitchBankIndex(), but for an event-based beam monitor.
+ */
+void
+StreamParser::stitchMonitorIndex
+(
+    MonitorInfo                 &a_mi,              ///< [in] Monitor to stitch into
+    uint64_t                    a_pulse_offset,     ///< [in] Run pulses before this index chunk
+    const vector<uint64_t>      &a_index,           ///< [in] Partial event index chunk
+    uint64_t                    a_count,            ///< [in] Number of pulses in index chunk
+    uint64_t                    a_base              ///< [in] Monitor event count before the partial
+)
+{
+    if ( a_mi.m_last_pulse_with_data < a_pulse_offset )
+    {
+        handleMonitorPulseGap( a_mi,
+            a_pulse_offset - a_mi.m_last_pulse_with_data );
+    }
+
+    for ( uint64_t i=0 ; i < a_count ; i++ )
+        a_mi.m_index_buffer.push_back( a_base + a_index[i] );
+
+    a_mi.m_last_pulse_with_data = a_pulse_offset + a_count;
+
+    if ( a_mi.m_index_buffer.size() >= m_anc_buf_write_thresh )
+    {
+        monitorIndexBuffersReady( a_mi, false );
+
+        a_mi.m_index_buffer.clear();
+    }
+}
+
+
+/*! \brief This method appends a partial translation's events to a monitor.
+ */
+void
+StreamParser::stitchMonitorEvents
+(
+    MonitorInfo                 &a_mi,      ///< [in] Monitor to stitch into
+    const vector<float>         &a_tof,     ///< [in] Partial event time of flight chunk
+    uint64_t                    a_count     ///< [in] Number of events in chunk
+)
+{
+    size_t sz = a_mi.m_tof_buffer_size;
+
+    if ( sz + a_count > a_mi.m_tof_buffer.size() )
+        a_mi.m_tof_buffer.resize( sz + a_count, (float) -1.0 );
+
+    std::copy( a_tof.begin(), a_tof.begin() + a_count,
+        a_mi.m_tof_buffer.begin() + sz );
+
+    a_mi.m_tof_buffer_size += a_count;
+    a_mi.m_event_count += a_count;
+
+    if ( a_mi.m_tof_buffer_size >= m_event_buf_write_thresh )
+    {
+        monitorTOFBuffersReady( a_mi );
+
+        a_mi.m_tof_buffer_size = 0;
+    }
+}
+
+
+/*! \brief This method adds a partial translation's event counts to the run metrics.
+ */
+void
+StreamParser::stitchRunMetrics
+(
+    const RunMetrics &a_metrics     ///< [in] Partial translation event counts
+)
+{
+    m_run_metrics.events_counted += a_metrics.events_counted;
+    m_run_metrics.events_uncounted += a_metrics.events_uncounted;
+    m_run_metrics.events_unmapped += a_metrics.events_unmapped;
+    m_run_metrics.events_error += a_metrics.events_error;
+    m_run_metrics.non_events_counted += a_metrics.non_events_counted;
+}
+
+
+/*! \brief This method prepares all PV Logs for their final flush.
+ *
+ * This method does the CPU-side part of the final PV buffer flush
+ * (timestamp normalization & statistics, value change scans, enumerated
+ * type value strings, and padding of string/array values into 2D
+ * arrays) for all the PVs, spread across a small pool of worker threads.
+ * Each PV is only ever touched by one worker, and nothing here touches
+ * the NeXus file; the actual writes still happen one PV at a time in
+ * the flushBuffers() pass that follows.
+ */
+void
+StreamParser::prepareFinalPVFlush
+(
+    uint64_t a_start_time   ///< [in] 1st Pulse Time (nanosecs)
+)
+{
+    uint32_t num_threads = boost::thread::hardware_concurrency();
+
+    if ( num_threads > PV_FINALIZE_THREADS_MAX )
+        num_threads = PV_FINALIZE_THREADS_MAX;
+
+    if ( num_threads > m_pvs_list.size() / PV_FINALIZE_PVS_PER_THREAD )
+        num_threads = m_pvs_list.size() / PV_FINALIZE_PVS_PER_THREAD;
+
+    volatile size_t next = 0;
+
+    // Not Enough PVs to Bother, Just Do It Here...
+    if ( num_threads <= 1 )
+    {
+        prepareFinalPVFlushWorker( a_start_time, &next );
+        return;
+    }
+
+    struct timespec ts_start, ts_end;
+    clock_gettime( CLOCK_REALTIME, &ts_start );
+
+    // This Thread Works Too...
+    boost::thread_group workers;
+    for ( uint32_t i=1 ; i < num_threads ; i++ )
+    {
+        workers.create_thread( boost::bind(
+            &StreamParser::prepareFinalPVFlushWorker, this,
+            a_start_time, &next ) );
+    }
+
+    prepareFinalPVFlushWorker( a_start_time, &next );
+
+    workers.join_all();
+
+    clock_gettime( CLOCK_REALTIME, &ts_end );
+
+    syslog( LOG_INFO, "[%i] %s: Prepared %lu PV Logs, %u Threads, %lf sec",
+        g_pid, "StreamParser::prepareFinalPVFlush()",
+        (unsigned long) m_pvs_list.size(), num_threads,
+        calcDiffSeconds( ts_end, ts_start ) );
+    give_syslog_a_chance;
+}
+
+
+/*! \brief Worker for prepareFinalPVFlush(), takes PVs until none are left.
+ *
+ * Any failure just leaves that PV unprepared, and its flushBuffers()
+ * call will then do the whole job itself (and report the error).
+ */
+void
+StreamParser::prepareFinalPVFlushWorker
+(
+    uint64_t a_start_time,      ///< [in] 1st Pulse Time (nanosecs)
+    volatile size_t *a_next     ///< [in,out] Next PV List Index to Take
+)
+{
+    size_t i;
+
+    while ( ( i = __sync_fetch_and_add( a_next, 1 ) ) < m_pvs_list.size() )
+    {
+        try
+        {
+            m_pvs_list[i]->prepareFinalFlush( a_start_time );
+        }
+        catch ( std::exception &e )
+        {
+            syslog( LOG_ERR, "[%i] %s %s: %s %s - %s",
+                g_pid, "STC Error:",
+                "StreamParser::prepareFinalPVFlushWorker()",
+                "Failed to Prepare PV Log",
+                m_pvs_list[i]->m_device_pv_str.c_str(), e.what() );
+            give_syslog_a_chance;
+        }
+        catch ( ... )
+        {
+            syslog( LOG_ERR, "[%i] %s %s: %s %s",
+                g_pid, "STC Error:",
+                "StreamParser::prepareFinalPVFlushWorker()",
+                "Failed to Prepare PV Log",
+                m_pvs_list[i]->m_device_pv_str.c_str() );
+            give_syslog_a_chance;
+        }
+    }
+}
+
+
 /*! \brief This method tries to Merge/Collapse Duplicate PV Logs...!
  *
  * This method is called just prior to actually writing out all the
@@ -7958,6 +8320,8 @@ StreamParser::getPktName(
             ss << "Beam Monitor Config"; break;
         case ADARA::PacketType::DETECTOR_BANK_SETS_TYPE:
             ss << "Detector Bank Sets"; break;
+        case ADARA::PacketType::HISTO_PREVIEW_TYPE:
+            ss << "Histo Preview"; break;
         case ADARA::PacketType::DATA_DONE_TYPE:
             ss << "Data Done"; break;
         case ADARA::PacketType::DEVICE_DESC_TYPE:
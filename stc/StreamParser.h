@@ -102,6 +102,19 @@ public:
 
     uint32_t verbose(void) { return m_verbose_level; }
 
+    // Parallel Translation of a Split Run (see tools/adara-split):
+    // - a Segment Ends Without an End-of-Run, Finalize It at End of Stream
+    // - Stitching Translates the Event-Free Skeleton of the Whole Run,
+    //    Merging In the Events of Each Segment's Partial NeXus File
+    void setSegment( bool a_segment ) { m_segment = a_segment; }
+    bool isSegment(void) const { return m_segment; }
+
+    void setStitchFiles( const std::vector<std::string> &a_files )
+        { m_stitch_files = a_files; }
+    bool isStitching(void) const { return !m_stitch_files.empty(); }
+
+    uint64_t getPulseCount(void) const { return m_pulse_count; }
+
     uint64_t m_total_bytes_count;   ///< Total Input Stream Byte Count of ADARA packets
 
 private:
@@ -220,7 +233,11 @@ private:
     //void        processPulseID( uint64_t a_pulse_id );
     void        receivedInfo( InfoBit a_bit );
     void        finalizeStreamProcessing();
+    void        stitchPartials();
     void        collapseDuplicatePVs();
+    void        prepareFinalPVFlush( uint64_t a_start_time );
+    void        prepareFinalPVFlushWorker( uint64_t a_start_time,
+                    volatile size_t *a_next );
     PVType      toPVType( const char *a_source ) const;
     inline void gatherStats( const ADARA::Packet &a_pkt ) const;
     const char* getPktName( uint32_t a_pkt_type ) const;
@@ -274,7 +291,31 @@ private:
 
     uint32_t                                m_verbose_level;            ///< STC Verbosity Level
 
+    bool                                    m_segment;                  ///< Translating One Segment of a Split Run
+    std::vector<std::string>                m_stitch_files;             ///< Partial (Segment) NeXus Files to Stitch, In Pulse Order
+
 protected:
+    // Stitching Access for the Stream Adapter's stitchPartial()
+    uint32_t    getBanksArraySize(void) const { return m_banks_arr_size; }
+    BankInfo   *getBankByIndex( uint32_t a_index ) const
+                    { return m_banks_arr[ a_index ]; }
+    std::map<Identifier,MonitorInfo*> &getMonitors(void)
+                    { return m_monitors; }
+
+    void        stitchBankIndex( BankInfo &a_bi, uint64_t a_pulse_offset,
+                    const std::vector<uint64_t> &a_index, uint64_t a_count,
+                    uint64_t a_base );
+    void        stitchBankEvents( BankInfo &a_bi,
+                    const std::vector<float> &a_tof,
+                    const std::vector<uint32_t> &a_pid, uint64_t a_count );
+    void        stitchMonitorIndex( MonitorInfo &a_mi,
+                    uint64_t a_pulse_offset,
+                    const std::vector<uint64_t> &a_index, uint64_t a_count,
+                    uint64_t a_base );
+    void        stitchMonitorEvents( MonitorInfo &a_mi,
+                    const std::vector<float> &a_tof, uint64_t a_count );
+    void        stitchRunMetrics( const RunMetrics &a_metrics );
+
     std::multimap<uint64_t, std::pair<double, uint16_t> >
                                             m_pause_multimap;           /// Pause/Resume annotation nsec-to-timestamp/state (on/off) map
     std::multimap<uint64_t, std::pair<double, uint16_t> >::iterator
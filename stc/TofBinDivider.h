@@ -0,0 +1,133 @@
+#ifndef TOFBINDIVIDER_H
+#define TOFBINDIVIDER_H
+
+#include <stdint.h>
+#include <vector>
+
+namespace STC {
+
+
+/// Histogram TOF Binning Without a Per-Event Integer Divide
+///
+/// Computes tof / bin_size exactly as the integer division does (for
+/// every uint32_t), using a precomputed "magic" multiply and shift
+/// (after libdivide's unsigned 32-bit algorithm), or just a shift when
+/// the bin size is a power of two. For small TOF ranges, a lookup table
+/// of bin numbers can be built instead, so each event is a single load.
+///
+/// A zero bin size (which would divide by zero) bins everything to
+/// 0xFFFFFFFF, beyond any real histogram, so events are just uncounted.
+class TofBinDivider
+{
+public:
+    /// Largest TOF range (in TOF units) given a lookup table;
+    /// 8 KB of uint16_t, small enough to stay in L1 cache
+    enum { MAX_TABLE_RANGE = 4096 };
+
+    TofBinDivider()
+    {
+        init( 1 );
+    }
+
+    /// Set up to divide by a_divisor, with a lookup table covering
+    /// numerators below a_table_range if that's small enough (0 = none)
+    void init( uint32_t a_divisor, uint32_t a_table_range = 0 )
+    {
+        m_divisor = a_divisor;
+        m_magic = 0;
+        m_shift = 0;
+        m_add = false;
+
+        m_table.clear();
+        m_table_size = 0;
+
+        if ( a_divisor == 0 )
+            return;
+
+        uint32_t floor_log_2_d = 31 - __builtin_clz( a_divisor );
+
+        // Power of Two (Including 1), Just Shift...
+        if ( ( a_divisor & ( a_divisor - 1 ) ) == 0 )
+        {
+            m_shift = floor_log_2_d;
+        }
+
+        else
+        {
+            // proposed_m = floor( 2^(32 + floor_log_2_d) / d )
+            uint64_t numer = (uint64_t) 1 << ( 32 + floor_log_2_d );
+            uint32_t proposed_m = (uint32_t) ( numer / a_divisor );
+            uint32_t rem = (uint32_t) ( numer % a_divisor );
+
+            uint32_t e = a_divisor - rem;
+
+            // This Power Works: magic fits in 32 bits...
+            if ( e < ( (uint32_t) 1 << floor_log_2_d ) )
+            {
+                m_shift = floor_log_2_d;
+            }
+
+            // Otherwise Need 33 Bits, Use the "Add" Variant...
+            else
+            {
+                proposed_m += proposed_m;
+                uint32_t twice_rem = rem + rem;
+                if ( twice_rem >= a_divisor || twice_rem < rem )
+                    proposed_m += 1;
+                m_shift = floor_log_2_d;
+                m_add = true;
+            }
+
+            m_magic = 1 + proposed_m;
+        }
+
+        if ( a_table_range > 0 && a_table_range <= MAX_TABLE_RANGE )
+        {
+            m_table.resize( a_table_range );
+            for ( uint32_t n = 0 ; n < a_table_range ; n++ )
+                m_table[n] = (uint16_t) ( n / a_divisor );
+            m_table_size = a_table_range;
+        }
+    }
+
+    /// Same result as a_numer / divisor()
+    inline uint32_t divide( uint32_t a_numer ) const
+    {
+        if ( a_numer < m_table_size )
+            return m_table[ a_numer ];
+
+        if ( !m_magic )
+        {
+            if ( !m_divisor )
+                return 0xFFFFFFFF;
+            return a_numer >> m_shift;
+        }
+
+        uint32_t q = (uint32_t)
+            ( ( (uint64_t) m_magic * a_numer ) >> 32 );
+
+        if ( m_add )
+            return ( ( ( a_numer - q ) >> 1 ) + q ) >> m_shift;
+
+        return q >> m_shift;
+    }
+
+    uint32_t divisor() const { return m_divisor; }
+
+    bool hasTable() const { return m_table_size != 0; }
+
+private:
+    uint32_t                m_divisor;      ///< Bin size being divided by
+    uint32_t                m_magic;        ///< Multiplier (0 for shift only)
+    uint32_t                m_shift;        ///< Final right shift
+    bool                    m_add;          ///< 33-bit magic ("add" variant)
+    std::vector<uint16_t>   m_table;        ///< Bin per TOF, small ranges
+    uint32_t                m_table_size;   ///< Numerators covered by m_table
+};
+
+
+} // End STC Namespace
+
+#endif // TOFBINDIVIDER_H
+
+// vim: expandtab
@@ -4,15 +4,71 @@
 
 #include <string>
 #include <sstream>
+#include <map>
+#include <algorithm>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <fcntl.h>
 #include <sys/time.h>
+#include <sys/file.h>
+#include <sys/stat.h>
 #include <errno.h>
 #include <syslog.h>
 #include <ldap.h>
 
 #include "stcdefs.h"
+#include "UserIdLdap.h"
 
 LDAP *stcLdapConn = NULL;
 
+// LDAP Server URI (Empty for the ldap.conf/LDAPURI Default) and Search Base
+std::string stcLdapUri;
+std::string stcLdapBase = "ou=Users,dc=sns,dc=ornl,dc=gov";
+
+void stcLdapSetServer( std::string uri, std::string base )
+{
+	stcLdapUri = uri;
+	if ( !base.empty() )
+		stcLdapBase = base;
+}
+
+// User Name Cache File Shared by All STCs (Empty Path Disables),
+// and How Long (Seconds) a Cached Name is Used Without Asking LDAP...
+std::string stcLdapCachePath;
+uint32_t stcLdapCacheTTL = 86400;
+
+void stcLdapSetCache( std::string path, uint32_t ttl )
+{
+	stcLdapCachePath = path;
+	stcLdapCacheTTL = ttl;
+}
+
+// Max User IDs OR'ed Together in One LDAP Search Filter
+#define STC_LDAP_BATCH 100
+
+// Persistent Connections are Kept (and Reused) by stcLdapDisconnect()...
+bool stcLdapPersistent = false;
+
+void stcLdapSetPersistent( bool persistent )
+{
+	stcLdapPersistent = persistent;
+}
+
+// Drop a Broken (or Half-Initialized) Connection, So the Next
+// stcLdapConnect() Starts Over...
+static void stcLdapReset(void)
+{
+	if ( stcLdapConn != NULL )
+	{
+		ldap_unbind_ext_s(stcLdapConn, NULL, NULL);
+		stcLdapConn = NULL;
+	}
+}
+
 int stcLdapConnect()
 {
 	struct timeval network_timeout = { 3, 0 };
@@ -22,8 +78,14 @@ int stcLdapConnect()
 
 	int cc;
 
+	// Reuse Any Persistent Connection...
+	if ( stcLdapConn != NULL )
+		return( 0 );
+
 	// Connect to the LDAP Server
-	if ( (cc = ldap_initialize( &stcLdapConn, NULL )) != LDAP_SUCCESS )
+	if ( (cc = ldap_initialize( &stcLdapConn,
+			stcLdapUri.empty() ? NULL : stcLdapUri.c_str() ))
+				!= LDAP_SUCCESS )
 	{
 		syslog( LOG_ERR,
 			"[%i] %s %s: LDAP Initialize Failed - %s",
@@ -40,7 +102,8 @@ int stcLdapConnect()
 		syslog( LOG_ERR,
 			"[%i] %s %s: LDAP Set Network Timeout Option Failed - %s",
 			g_pid, "STC Error:", "stcLdapConnect()", ldap_err2string(cc) );
-	    return( -2 );
+		stcLdapReset();
+		return( -2 );
 	}
 	syslog( LOG_INFO, "[%i] Set LDAP Network Timeout to %ld.%ld Seconds.",
 		g_pid, network_timeout.tv_sec, network_timeout.tv_usec );
@@ -53,7 +116,8 @@ int stcLdapConnect()
 		syslog( LOG_ERR,
 			"[%i] %s %s: LDAP Set Search Time Limit Option Failed - %s",
 			g_pid, "STC Error:", "stcLdapConnect()", ldap_err2string(cc) );
-	    return( -3 );
+		stcLdapReset();
+		return( -3 );
 	}
 	syslog( LOG_INFO, "[%i] Set LDAP Search Time Limit to %d Seconds.",
 		g_pid, search_timelimit );
@@ -66,7 +130,8 @@ int stcLdapConnect()
 		syslog( LOG_ERR,
 			"[%i] %s %s: LDAP Set Synchronous Timeout Option Failed - %s",
 			g_pid, "STC Error:", "stcLdapConnect()", ldap_err2string(cc) );
-	    return( -4 );
+		stcLdapReset();
+		return( -4 );
 	}
 	syslog( LOG_INFO,
 		"[%i] Set LDAP Synchronous Timeout to %ld.%ld Seconds.",
@@ -75,20 +140,80 @@ int stcLdapConnect()
 	return( 0 );
 }
 
-int stcLdapLookupUserName( std::string uid, std::string &user_name )
+// Escape a Value for Use in an LDAP Search Filter (RFC 4515)...
+static std::string stcLdapEscape( const std::string &value )
 {
-	LDAPMessage *msg;
+	std::string escaped;
+	char hex[4];
 
-	std::string base = "ou=Users,dc=sns,dc=ornl,dc=gov";
-
-	std::string filter;
+	for ( size_t i = 0 ; i < value.size() ; i++ )
+	{
+		unsigned char c = value[i];
+		if ( c == '*' || c == '(' || c == ')' || c == '\\' || c == '\0' )
+		{
+			snprintf( hex, sizeof(hex), "\\%02x", c );
+			escaped += hex;
+		}
+		else
+			escaped += c;
+	}
 
-	const char *attrs[2];
+	return( escaped );
+}
 
+// Search the LDAP Server, Reconnecting Once if a Persistent
+// Connection Has Gone Stale Between Runs...
+static int stcLdapSearch( std::string filter, const char **attrs,
+		LDAPMessage **msg, const char *caller )
+{
 	struct timeval search_timeout = { 3, 0 };
 
 	int cc;
 
+	cc = ldap_search_ext_s(stcLdapConn,
+		stcLdapBase.c_str(), LDAP_SCOPE_SUBTREE,
+		filter.c_str(), (char **)attrs, 0, NULL, NULL,
+		&search_timeout, LDAP_NO_LIMIT, msg);
+
+	if ( stcLdapPersistent && ( cc == LDAP_SERVER_DOWN
+			|| cc == LDAP_CONNECT_ERROR || cc == LDAP_TIMEOUT ) )
+	{
+		syslog( LOG_INFO, "[%i] %s: Reconnecting to LDAP Server - %s",
+			g_pid, caller, ldap_err2string(cc) );
+		stcLdapReset();
+		if ( stcLdapConnect() == 0 )
+		{
+			cc = ldap_search_ext_s(stcLdapConn,
+				stcLdapBase.c_str(), LDAP_SCOPE_SUBTREE,
+				filter.c_str(), (char **)attrs, 0, NULL, NULL,
+				&search_timeout, LDAP_NO_LIMIT, msg);
+		}
+	}
+
+	if ( cc != LDAP_SUCCESS )
+	{
+		syslog( LOG_ERR, "[%i] %s %s: LDAP Search Failed - %s",
+			g_pid, "STC Error:", caller, ldap_err2string(cc) );
+		// The Result is Allocated Even on Failure...
+		if ( *msg != NULL )
+		{
+			ldap_msgfree(*msg);
+			*msg = NULL;
+		}
+		return( -1 );
+	}
+
+	return( 0 );
+}
+
+int stcLdapLookupUserName( std::string uid, std::string &user_name )
+{
+	LDAPMessage *msg = NULL;
+
+	std::string filter;
+
+	const char *attrs[2];
+
 	// Verify Valid UID String...
 	if ( uid.empty() )
 	{
@@ -98,22 +223,15 @@ int stcLdapLookupUserName( std::string uid, std::string &user_name )
 	}
 
 	// Set Up LDAP Search Filters...
-	filter = "uid=" + uid;
+	filter = "uid=" + stcLdapEscape( uid );
 
 	// Choose Desired Attribute(s)...
 	attrs[0] = "cn";
 	attrs[1] = NULL;
 
 	// Search LDAP Server for User ID
-	if ( (cc = ldap_search_ext_s(stcLdapConn,
-			base.c_str(), LDAP_SCOPE_SUBTREE,
-			filter.c_str(), (char **)attrs, 0, NULL, NULL,
-			&search_timeout, LDAP_NO_LIMIT, &msg)) != LDAP_SUCCESS )
-	{
-		syslog( LOG_ERR, "[%i] %s %s: LDAP Search Failed - %s",
-			g_pid, "STC Error:", "stcLdapConnect()", ldap_err2string(cc) );
+	if ( stcLdapSearch( filter, attrs, &msg, "stcLdapLookupUserName()" ) )
 		return( -2 );
-	}
 
 	// Display LDAP Search Results
 	int num_entries_returned = ldap_count_entries(stcLdapConn, msg);
@@ -164,12 +282,365 @@ int stcLdapLookupUserName( std::string uid, std::string &user_name )
 	return( -3 );
 }
 
+//
+// Shared User Name Cache File...
+//
+// One "<uid>\t<time resolved>\t<name>" Line per User. Readers Just Read;
+// Writers Take an Exclusive flock() on "<path>.lock", Merge Their New
+// Names into the Current File, and rename() a Fresh Copy into Place,
+// So Concurrent STCs Never See a Partial File or Lose Each Other's Names.
+//
+
+struct stcLdapCacheEntry
+{
+	std::string name;
+	time_t resolved;
+};
+
+typedef std::map<std::string, stcLdapCacheEntry> stcLdapCacheMap;
+
+// The Cache is Only an Optimization, So Just Warn (Once per Process)
+// If It Can't be Used, e.g. Its Directory Doesn't Exist...
+static void stcLdapCacheWarn( const char *func, const char *what,
+		const std::string &path )
+{
+	static bool warned = false;
+
+	if ( warned )
+		return;
+	warned = true;
+
+	syslog( LOG_WARNING, "[%i] %s %s: Can't %s %s - %s %s",
+		g_pid, "STC Warning:", func, what, path.c_str(), strerror(errno),
+		"(User Name Cache Disabled Until Restart)" );
+}
+
+static void stcLdapCacheRead( stcLdapCacheMap &cache )
+{
+	FILE *fp;
+
+	if ( (fp = fopen( stcLdapCachePath.c_str(), "r" )) == NULL )
+	{
+		if ( errno != ENOENT )
+		{
+			stcLdapCacheWarn( "stcLdapCacheRead()", "Read",
+				stcLdapCachePath );
+		}
+		return;
+	}
+
+	char *line = NULL;
+	size_t len = 0;
+
+	while ( getline( &line, &len, fp ) > 0 )
+	{
+		char *uid = line;
+		char *stamp = strchr( uid, '\t' );
+		if ( stamp == NULL )
+			continue;
+		*stamp++ = '\0';
+		char *name = strchr( stamp, '\t' );
+		if ( name == NULL )
+			continue;
+		*name++ = '\0';
+		name[ strcspn( name, "\n" ) ] = '\0';
+
+		stcLdapCacheEntry &entry = cache[ uid ];
+		entry.name = name;
+		entry.resolved = (time_t) strtoll( stamp, NULL, 10 );
+	}
+
+	free( line );
+	fclose( fp );
+}
+
+// Tabs/Newlines (in uids or Names) Would Break the Cache File Format...
+static std::string stcLdapCacheClean( const std::string &str )
+{
+	std::string clean = str;
+	for ( size_t i = 0 ; i < clean.size() ; i++ )
+	{
+		if ( clean[i] == '\t' || clean[i] == '\n' || clean[i] == '\r' )
+			clean[i] = ' ';
+	}
+	return( clean );
+}
+
+static void stcLdapCacheWrite( const stcLdapCacheMap &updates )
+{
+	std::string lock_path = stcLdapCachePath + ".lock";
+	std::stringstream tmp_ss;
+	tmp_ss << stcLdapCachePath << ".tmp." << g_pid;
+	std::string tmp_path = tmp_ss.str();
+
+	int lock_fd = open( lock_path.c_str(), O_RDWR | O_CREAT, 0664 );
+	if ( lock_fd < 0 || flock( lock_fd, LOCK_EX ) )
+	{
+		stcLdapCacheWarn( "stcLdapCacheWrite()", "Lock", lock_path );
+		if ( lock_fd >= 0 )
+			close( lock_fd );
+		return;
+	}
+
+	// Merge Into Whatever Other STCs Have Written Meanwhile...
+	stcLdapCacheMap cache;
+	stcLdapCacheRead( cache );
+
+	for ( stcLdapCacheMap::const_iterator u = updates.begin() ;
+			u != updates.end() ; ++u )
+	{
+		stcLdapCacheMap::iterator c = cache.find( u->first );
+		if ( c == cache.end() || c->second.resolved < u->second.resolved )
+			cache[ u->first ] = u->second;
+	}
+
+	FILE *fp = fopen( tmp_path.c_str(), "w" );
+	bool ok = ( fp != NULL );
+
+	for ( stcLdapCacheMap::const_iterator c = cache.begin() ;
+			ok && c != cache.end() ; ++c )
+	{
+		ok = ( fprintf( fp, "%s\t%lld\t%s\n", c->first.c_str(),
+			(long long) c->second.resolved, c->second.name.c_str() ) > 0 );
+	}
+
+	if ( fp != NULL && fclose( fp ) )
+		ok = false;
+
+	if ( !ok || rename( tmp_path.c_str(), stcLdapCachePath.c_str() ) )
+	{
+		stcLdapCacheWarn( "stcLdapCacheWrite()", "Update",
+			stcLdapCachePath );
+		unlink( tmp_path.c_str() );
+	}
+	else
+	{
+		syslog( LOG_INFO, "[%i] %s: Cached %lu New User Name(s) in %s",
+			g_pid, "stcLdapCacheWrite()", (unsigned long) updates.size(),
+			stcLdapCachePath.c_str() );
+	}
+
+	flock( lock_fd, LOCK_UN );
+	close( lock_fd );
+}
+
+void stcLdapCacheStore( const std::map<std::string, std::string> &user_names )
+{
+	if ( stcLdapCachePath.empty() || user_names.empty() )
+		return;
+
+	stcLdapCacheMap updates;
+	time_t now = time(NULL);
+
+	for ( std::map<std::string, std::string>::const_iterator u =
+			user_names.begin() ; u != user_names.end() ; ++u )
+	{
+		stcLdapCacheEntry &entry = updates[ stcLdapCacheClean( u->first ) ];
+		entry.name = stcLdapCacheClean( u->second );
+		entry.resolved = now;
+	}
+
+	stcLdapCacheWrite( updates );
+}
+
+static std::string stcLdapLower( const std::string &str )
+{
+	std::string lower = str;
+	for ( size_t i = 0 ; i < lower.size() ; i++ )
+		lower[i] = tolower( (unsigned char) lower[i] );
+	return( lower );
+}
+
+int stcLdapLookupUserNames( const std::vector<std::string> &uids,
+		std::map<std::string, std::string> &user_names )
+{
+	bool use_cache = !stcLdapCachePath.empty();
+	stcLdapCacheMap cache;
+	std::map<std::string, std::string> updates;
+	time_t now = time(NULL);
+
+	// Requested (Not Freshly Cached) User IDs, by Lower Case uid
+	// (LDAP Matches uid Case-Insensitively), to Every Spelling Asked For...
+	typedef std::map<std::string, std::vector<std::string> > stcLdapLookupMap;
+	stcLdapLookupMap lookup;
+
+	if ( use_cache )
+		stcLdapCacheRead( cache );
+
+	size_t from_cache = 0;
+
+	for ( size_t i = 0 ; i < uids.size() ; i++ )
+	{
+		if ( uids[i].empty() || user_names.count( uids[i] ) )
+			continue;
+
+		stcLdapCacheMap::iterator c =
+			cache.find( stcLdapCacheClean( uids[i] ) );
+		if ( c != cache.end()
+				&& now - c->second.resolved < (time_t) stcLdapCacheTTL )
+		{
+			user_names[ uids[i] ] = c->second.name;
+			from_cache++;
+		}
+		else
+		{
+			std::vector<std::string> &spellings =
+				lookup[ stcLdapLower( uids[i] ) ];
+			if ( std::find( spellings.begin(), spellings.end(), uids[i] )
+					== spellings.end() )
+			{
+				spellings.push_back( uids[i] );
+			}
+		}
+	}
+
+	syslog( LOG_INFO, "[%i] %s: %lu User Name(s) from Cache, %lu to Look Up",
+		g_pid, "stcLdapLookupUserNames()",
+		(unsigned long) from_cache, (unsigned long) lookup.size() );
+
+	if ( lookup.empty() )
+		return( 0 );
+
+	// One Search per Batch of User IDs: (|(uid=a)(uid=b)...)
+	if ( stcLdapConnect() == 0 )
+	{
+		const char *attrs[3] = { "uid", "cn", NULL };
+
+		stcLdapLookupMap::iterator b = lookup.begin();
+
+		while ( b != lookup.end() )
+		{
+			std::string filter = "(|";
+			for ( uint32_t n = 0 ;
+					n < STC_LDAP_BATCH && b != lookup.end() ; n++, ++b )
+			{
+				filter += "(uid=" + stcLdapEscape( b->second[0] ) + ")";
+			}
+			filter += ")";
+
+			LDAPMessage *msg = NULL;
+
+			// Give Up on LDAP for This Run, Fall Back to the Cache...
+			if ( stcLdapSearch( filter, attrs, &msg,
+					"stcLdapLookupUserNames()" ) )
+			{
+				break;
+			}
+
+			syslog( LOG_INFO, "[%i] %s: Batch Search Got %d Entries from LDAP.",
+				g_pid, "stcLdapLookupUserNames()",
+				ldap_count_entries(stcLdapConn, msg) );
+
+			for ( LDAPMessage *entry = ldap_first_entry(stcLdapConn, msg);
+					entry != NULL;
+					entry = ldap_next_entry(stcLdapConn, entry) )
+			{
+				struct berval **uid_vals =
+					ldap_get_values_len(stcLdapConn, entry, attrs[0]);
+				struct berval **cn_vals =
+					ldap_get_values_len(stcLdapConn, entry, attrs[1]);
+
+				if ( uid_vals != NULL && cn_vals != NULL
+						&& cn_vals[0] != NULL )
+				{
+					std::string name( cn_vals[0]->bv_val,
+						cn_vals[0]->bv_len );
+
+					// Match Any of the Entry's uid Values We Asked For
+					for ( int v = 0 ; uid_vals[v] != NULL ; v++ )
+					{
+						stcLdapLookupMap::iterator l =
+							lookup.find( stcLdapLower( std::string(
+								uid_vals[v]->bv_val,
+								uid_vals[v]->bv_len ) ) );
+						if ( l == lookup.end() )
+							continue;
+
+						for ( size_t u = 0 ; u < l->second.size() ; u++ )
+						{
+							const std::string &uid = l->second[u];
+
+							if ( user_names.count( uid ) )
+								continue;
+
+							user_names[ uid ] = name;
+
+							updates[ uid ] = name;
+
+							syslog( LOG_INFO,
+								"[%i] %s: Found LDAP User Name [%s] for uid=[%s]",
+								g_pid, "stcLdapLookupUserNames()",
+								name.c_str(), uid.c_str() );
+						}
+					}
+				}
+
+				if ( uid_vals != NULL )
+					ldap_value_free_len(uid_vals);
+				if ( cn_vals != NULL )
+					ldap_value_free_len(cn_vals);
+			}
+
+			ldap_msgfree(msg);
+		}
+
+		stcLdapDisconnect();
+	}
+
+	// Anything LDAP Didn't Resolve (Server Down or Slow, or Not Found)
+	// Falls Back to an Expired Cache Entry, If Any...
+	int unresolved = 0;
+
+	for ( stcLdapLookupMap::iterator l = lookup.begin() ;
+			l != lookup.end() ; ++l )
+	{
+		for ( size_t u = 0 ; u < l->second.size() ; u++ )
+		{
+			const std::string &uid = l->second[u];
+
+			if ( user_names.count( uid ) )
+				continue;
+
+			stcLdapCacheMap::iterator c =
+				cache.find( stcLdapCacheClean( uid ) );
+			if ( c != cache.end() )
+			{
+				user_names[ uid ] = c->second.name;
+				syslog( LOG_ERR,
+					"[%i] %s %s: Using Cached User Name [%s] for uid=[%s] %s",
+					g_pid, "STC Error:", "stcLdapLookupUserNames()",
+					c->second.name.c_str(), uid.c_str(),
+					"(Not Resolved by LDAP)" );
+			}
+			else
+			{
+				syslog( LOG_ERR,
+					"[%i] %s %s: LDAP User Name Not Found for uid=[%s]!",
+					g_pid, "STC Error:", "stcLdapLookupUserNames()",
+					uid.c_str() );
+				unresolved++;
+			}
+		}
+	}
+
+	if ( use_cache )
+		stcLdapCacheStore( updates );
+
+	return( unresolved ? -1 : 0 );
+}
+
 int stcLdapDisconnect(void)
 {
 	int cc;
 
+	// Keep Persistent Connections for the Next Run...
+	if ( stcLdapPersistent )
+		return( 0 );
+
 	// End Session with LDAP Server
-	if ( (cc = ldap_unbind_ext_s(stcLdapConn, NULL, NULL)) != 0 )
+	cc = ldap_unbind_ext_s(stcLdapConn, NULL, NULL);
+	stcLdapConn = NULL;
+	if ( cc != 0 )
 	{
 		syslog( LOG_ERR, "[%i] %s %s: ldap_unbind_s: %s",
 			g_pid, "STC Error:", "stcLdapDisconnect()",
@@ -3,11 +3,31 @@
 //
 
 #include <string>
+#include <vector>
+#include <map>
 #include <stdint.h>
 
 int stcLdapConnect();
 
+// Keep the LDAP Connection Open Across Runs (for stcd Workers)...
+void stcLdapSetPersistent( bool persistent );
+
+// LDAP Server URI (Empty for ldap.conf Default) and User Search Base...
+void stcLdapSetServer( std::string uri, std::string base );
+
+// Shared On-Disk User Name Cache (Empty Path Disables), Entry TTL Seconds
+void stcLdapSetCache( std::string path, uint32_t ttl );
+
+// Merge uid -> Name Pairs (Resolved Now) into the Shared Cache File...
+void stcLdapCacheStore( const std::map<std::string, std::string> &user_names );
+
 int stcLdapLookupUserName( std::string uid, std::string &user_name );
 
+// Resolve Many User IDs at Once: Fresh Cache Entries, Then One Batched
+// LDAP Search for the Rest, Then Expired Cache Entries as a Fallback.
+// Connects (and Disconnects) as Needed; Returns 0 if All Were Resolved.
+int stcLdapLookupUserNames( const std::vector<std::string> &uids,
+	std::map<std::string, std::string> &user_names );
+
 int stcLdapDisconnect(void);
 
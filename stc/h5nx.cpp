@@ -1100,6 +1100,44 @@ int H5nx::H5NXcheck_dataset_path( const std::string &group_path,
     return SUCCEED;
 }
 
+///////////////////////////////////////////////////////////////////
+// H5NXcheck_link_path
+// quietly check for a group or dataset, and every group above it
+////////////////////////////////////////////////////////////////////
+int H5nx::H5NXcheck_link_path( const std::string &path, bool &exists )
+{
+    exists = false;
+
+    // H5Lexists() Only Looks at the Last Link, So Walk Down the Path...
+    size_t pos = 0;
+    while ( pos != std::string::npos )
+    {
+        pos = path.find( '/', pos + 1 );
+
+        std::string link = path.substr( 0, pos );
+
+        htri_t ret = H5Lexists( this->m_fid, link.c_str(), H5P_DEFAULT );
+        if ( ret < 0 )
+        {
+            syslog( LOG_ERR, "[%i] %s in %s(): Error in %s() %s=%s",
+                g_pid, "STC Error", "H5nx::H5NXcheck_link_path",
+                "H5Lexists", "link", link.c_str() );
+            give_syslog_a_chance;
+            H5NXdumperr( "H5nx::H5NXcheck_link_path(): H5Lexists() "
+                + link );
+            return FAIL;
+        }
+
+        // Don't Log Here, a Missing Link is an Expected Outcome... ;-D
+        if ( !ret )
+            return SUCCEED;
+    }
+
+    exists = true;
+
+    return SUCCEED;
+}
+
 ///////////////////////////////////////////////////////////////////
 // to_nx_type
 ////////////////////////////////////////////////////////////////////
@@ -2468,6 +2506,361 @@ int H5nx::H5NXwrite_slab( const std::string &dataset_path,
     return SUCCEED;
 }
 
+///////////////////////////////////////////////////////////////////
+// H5NXwrite_rows
+////////////////////////////////////////////////////////////////////
+
+// NOTE: Supplied Vector Buffer Must Hold "num_rows" Full Rows...!
+
+template
+int H5nx::H5NXwrite_rows( const std::string &dataset_path,
+        const std::vector<uint32_t> &slab, uint64_t num_rows,
+        uint64_t row_offset );
+
+template <typename NumT>
+int H5nx::H5NXwrite_rows( const std::string &dataset_path,
+        const std::vector<NumT> &vec, uint64_t num_rows,
+        uint64_t row_offset )
+{
+    hid_t   did;
+    hid_t   tid;
+    hid_t   sid;
+    hid_t   msid;
+    hsize_t dims[H5S_MAX_RANK];
+    hsize_t count[H5S_MAX_RANK];
+    hsize_t start[H5S_MAX_RANK];
+
+    ///////////////////////////////////////////////////////////////////
+    // FOR 2D DATASET
+    ////////////////////////////////////////////////////////////////////
+
+    //open dataset
+    if ( (did = H5Dopen2( this->m_fid, dataset_path.c_str(),
+            H5P_DEFAULT )) < 0 )
+    {
+        syslog( LOG_ERR, "[%i] %s in %s(): Error in %s() %s=%s %s",
+            g_pid, "STC Error", "H5nx::H5NXwrite_rows", "H5Dopen2",
+            "dataset_path", dataset_path.c_str(), "Open Dataset" );
+        give_syslog_a_chance;
+        H5NXdumperr("H5nx::H5NXwrite_rows(): H5Dopen2() Open Dataset "
+            + dataset_path);
+        return FAIL;
+    }
+
+    //get type
+    if ( (tid = H5Dget_type( did )) < 0 )
+    {
+        syslog( LOG_ERR, "[%i] %s in %s(): Error in %s() %s",
+            g_pid, "STC Error", "H5nx::H5NXwrite_rows", "H5Dget_type",
+            "Get Type" );
+        give_syslog_a_chance;
+        H5NXdumperr("H5nx::H5NXwrite_rows(): H5Dget_type() Get Type");
+        return FAIL;
+    }
+
+    //get the file space, for the row length
+    if ( (sid = H5Dget_space( did )) < 0 )
+    {
+        syslog( LOG_ERR, "[%i] %s in %s(): Error in %s() %s",
+            g_pid, "STC Error", "H5nx::H5NXwrite_rows", "H5Dget_space",
+            "Get Dataspace" );
+        give_syslog_a_chance;
+        H5NXdumperr(
+            "H5nx::H5NXwrite_rows(): H5Dget_space() Get Dataspace");
+        return FAIL;
+    }
+
+    if ( H5Sget_simple_extent_ndims( sid ) != 2
+            || H5Sget_simple_extent_dims( sid, dims, NULL ) < 0
+            || row_offset + num_rows > dims[0]
+            || vec.size() < num_rows * dims[1] )
+    {
+        syslog( LOG_ERR,
+            "[%i] %s in %s(): Error in %s() %s=%lu %s=%lu %s=%lu %s",
+            g_pid, "STC Error", "H5nx::H5NXwrite_rows",
+            "H5Sget_simple_extent_dims",
+            "row_offset", (unsigned long) row_offset,
+            "num_rows", (unsigned long) num_rows,
+            "vec.size()", (unsigned long) vec.size(),
+            "Rows Don't Fit 2D Dataset" );
+        give_syslog_a_chance;
+        H5NXdumperr("H5nx::H5NXwrite_rows(): H5Sget_simple_extent_dims()"
+            + std::string(" Rows Don't Fit 2D Dataset"));
+        return FAIL;
+    }
+
+    count[0] = num_rows;
+    count[1] = dims[1];
+    start[0] = row_offset;
+    start[1] = 0;
+
+    //select space on file
+    if ( H5Sselect_hyperslab( sid, H5S_SELECT_SET,
+            start, NULL, count, NULL ) < 0 )
+    {
+        syslog( LOG_ERR,
+            "[%i] %s in %s(): Error in %s() %s=%lu %s=%lu %s",
+            g_pid, "STC Error", "H5nx::H5NXwrite_rows",
+            "H5Sselect_hyperslab",
+            "start[0]", (unsigned long) start[0],
+            "count[0]", (unsigned long) count[0],
+            "Select Hyperslab File Space" );
+        give_syslog_a_chance;
+        H5NXdumperr("H5nx::H5NXwrite_rows(): H5Sselect_hyperslab()"
+            + std::string("Select Hyperslab File Space"));
+        return FAIL;
+    }
+
+    //memory space
+    if ( (msid = H5Screate_simple( 2, count, count )) < 0 )
+    {
+        syslog( LOG_ERR, "[%i] %s in %s(): Error in %s() %s=%lu %s",
+            g_pid, "STC Error", "H5nx::H5NXwrite_rows", "H5Screate_simple",
+            "count[0]", (unsigned long) count[0],
+            "Create Memory Dataspace" );
+        give_syslog_a_chance;
+        H5NXdumperr("H5nx::H5NXwrite_rows(): H5Screate_simple()"
+            + std::string(" Create Memory Dataspace"));
+        return FAIL;
+    }
+
+    //write
+    if ( H5Dwrite( did, tid, msid, sid, H5P_DEFAULT, &(vec[0]) ) < 0 )
+    {
+        syslog( LOG_ERR, "[%i] %s in %s(): Error in %s() %s (Disk Space?)",
+            g_pid, "STC Error", "H5nx::H5NXwrite_rows", "H5Dwrite",
+            "Write Data" );
+        give_syslog_a_chance;
+        H5NXdumperr("H5nx::H5NXwrite_rows(): H5Dwrite() Write Data");
+        return FAIL;
+    }
+
+    //close memory space
+    if ( H5Sclose( msid ) < 0 )
+    {
+        syslog( LOG_ERR, "[%i] %s in %s(): Error in %s() %s",
+            g_pid, "STC Error", "H5nx::H5NXwrite_rows", "H5Sclose",
+            "Close Memory Dataspace" );
+        give_syslog_a_chance;
+        H5NXdumperr(
+            "H5nx::H5NXwrite_rows(): H5Sclose() Close Memory Dataspace");
+        return FAIL;
+    }
+
+    //close file space
+    if ( H5Sclose( sid ) < 0 )
+    {
+        syslog( LOG_ERR, "[%i] %s in %s(): Error in %s() %s",
+            g_pid, "STC Error", "H5nx::H5NXwrite_rows", "H5Sclose",
+            "Close File Space" );
+        give_syslog_a_chance;
+        H5NXdumperr("H5nx::H5NXwrite_rows(): H5Sclose() Close File Space");
+        return FAIL;
+    }
+
+    //close type
+    if ( H5Tclose( tid ) < 0 )
+    {
+        syslog( LOG_ERR, "[%i] %s in %s(): Error in %s() %s",
+            g_pid, "STC Error", "H5nx::H5NXwrite_rows", "H5Tclose",
+            "Close Type" );
+        give_syslog_a_chance;
+        H5NXdumperr("H5nx::H5NXwrite_rows(): H5Tclose() Close Type");
+        return FAIL;
+    }
+
+    //close dataset
+    if ( H5Dclose( did ) < 0 )
+    {
+        syslog( LOG_ERR, "[%i] %s in %s(): Error in %s() %s",
+            g_pid, "STC Error", "H5nx::H5NXwrite_rows", "H5Dclose",
+            "Close Dataset" );
+        give_syslog_a_chance;
+        H5NXdumperr("H5nx::H5NXwrite_rows(): H5Dclose() Close Dataset");
+        return FAIL;
+    }
+
+    return SUCCEED;
+}
+
+///////////////////////////////////////////////////////////////////
+// H5NXread_rows
+////////////////////////////////////////////////////////////////////
+
+// NOTE: Supplied Vector Buffer Must Be Pre-Allocated to Hold
+// "num_rows" Full Rows...! (Use "assign()", Not "reserve()"!)
+
+template
+int H5nx::H5NXread_rows( const std::string &dataset_path,
+        std::vector<uint32_t> &slab, uint64_t num_rows,
+        uint64_t row_offset );
+
+template <typename NumT>
+int H5nx::H5NXread_rows( const std::string &dataset_path,
+        std::vector<NumT> &vec, uint64_t num_rows,
+        uint64_t row_offset )
+{
+    hid_t   did;
+    hid_t   tid;
+    hid_t   sid;
+    hid_t   msid;
+    hsize_t dims[H5S_MAX_RANK];
+    hsize_t count[H5S_MAX_RANK];
+    hsize_t start[H5S_MAX_RANK];
+
+    ///////////////////////////////////////////////////////////////////
+    // FOR 2D DATASET
+    ////////////////////////////////////////////////////////////////////
+
+    //open dataset
+    if ( (did = H5Dopen2( this->m_fid, dataset_path.c_str(),
+            H5P_DEFAULT )) < 0 )
+    {
+        syslog( LOG_ERR, "[%i] %s in %s(): Error in %s() %s=%s %s",
+            g_pid, "STC Error", "H5nx::H5NXread_rows", "H5Dopen2",
+            "dataset_path", dataset_path.c_str(), "Open Dataset" );
+        give_syslog_a_chance;
+        H5NXdumperr("H5nx::H5NXread_rows(): H5Dopen2() Open Dataset "
+            + dataset_path);
+        return FAIL;
+    }
+
+    //get type
+    if ( (tid = H5Dget_type( did )) < 0 )
+    {
+        syslog( LOG_ERR, "[%i] %s in %s(): Error in %s() %s",
+            g_pid, "STC Error", "H5nx::H5NXread_rows", "H5Dget_type",
+            "Get Type" );
+        give_syslog_a_chance;
+        H5NXdumperr("H5nx::H5NXread_rows(): H5Dget_type() Get Type");
+        return FAIL;
+    }
+
+    //get the file space, for the row length
+    if ( (sid = H5Dget_space( did )) < 0 )
+    {
+        syslog( LOG_ERR, "[%i] %s in %s(): Error in %s() %s",
+            g_pid, "STC Error", "H5nx::H5NXread_rows", "H5Dget_space",
+            "Get Dataspace" );
+        give_syslog_a_chance;
+        H5NXdumperr(
+            "H5nx::H5NXread_rows(): H5Dget_space() Get Dataspace");
+        return FAIL;
+    }
+
+    if ( H5Sget_simple_extent_ndims( sid ) != 2
+            || H5Sget_simple_extent_dims( sid, dims, NULL ) < 0
+            || row_offset + num_rows > dims[0]
+            || vec.size() < num_rows * dims[1] )
+    {
+        syslog( LOG_ERR,
+            "[%i] %s in %s(): Error in %s() %s=%lu %s=%lu %s=%lu %s",
+            g_pid, "STC Error", "H5nx::H5NXread_rows",
+            "H5Sget_simple_extent_dims",
+            "row_offset", (unsigned long) row_offset,
+            "num_rows", (unsigned long) num_rows,
+            "vec.size()", (unsigned long) vec.size(),
+            "Rows Don't Fit 2D Dataset" );
+        give_syslog_a_chance;
+        H5NXdumperr("H5nx::H5NXread_rows(): H5Sget_simple_extent_dims()"
+            + std::string(" Rows Don't Fit 2D Dataset"));
+        return FAIL;
+    }
+
+    count[0] = num_rows;
+    count[1] = dims[1];
+    start[0] = row_offset;
+    start[1] = 0;
+
+    //select space on file
+    if ( H5Sselect_hyperslab( sid, H5S_SELECT_SET,
+            start, NULL, count, NULL ) < 0 )
+    {
+        syslog( LOG_ERR,
+            "[%i] %s in %s(): Error in %s() %s=%lu %s=%lu %s",
+            g_pid, "STC Error", "H5nx::H5NXread_rows",
+            "H5Sselect_hyperslab",
+            "start[0]", (unsigned long) start[0],
+            "count[0]", (unsigned long) count[0],
+            "Select Hyperslab File Space" );
+        give_syslog_a_chance;
+        H5NXdumperr("H5nx::H5NXread_rows(): H5Sselect_hyperslab()"
+            + std::string("Select Hyperslab File Space"));
+        return FAIL;
+    }
+
+    //memory space
+    if ( (msid = H5Screate_simple( 2, count, count )) < 0 )
+    {
+        syslog( LOG_ERR, "[%i] %s in %s(): Error in %s() %s=%lu %s",
+            g_pid, "STC Error", "H5nx::H5NXread_rows", "H5Screate_simple",
+            "count[0]", (unsigned long) count[0],
+            "Create Memory Dataspace" );
+        give_syslog_a_chance;
+        H5NXdumperr("H5nx::H5NXread_rows(): H5Screate_simple()"
+            + std::string(" Create Memory Dataspace"));
+        return FAIL;
+    }
+
+    //read
+    if ( H5Dread( did, tid, msid, sid, H5P_DEFAULT, &(vec[0]) ) < 0 )
+    {
+        syslog( LOG_ERR, "[%i] %s in %s(): Error in %s() %s",
+            g_pid, "STC Error", "H5nx::H5NXread_rows", "H5Dread",
+            "Read Data" );
+        give_syslog_a_chance;
+        H5NXdumperr("H5nx::H5NXread_rows(): H5Dread() Read Data");
+        return FAIL;
+    }
+
+    //close memory space
+    if ( H5Sclose( msid ) < 0 )
+    {
+        syslog( LOG_ERR, "[%i] %s in %s(): Error in %s() %s",
+            g_pid, "STC Error", "H5nx::H5NXread_rows", "H5Sclose",
+            "Close Memory Dataspace" );
+        give_syslog_a_chance;
+        H5NXdumperr(
+            "H5nx::H5NXread_rows(): H5Sclose() Close Memory Dataspace");
+        return FAIL;
+    }
+
+    //close file space
+    if ( H5Sclose( sid ) < 0 )
+    {
+        syslog( LOG_ERR, "[%i] %s in %s(): Error in %s() %s",
+            g_pid, "STC Error", "H5nx::H5NXread_rows", "H5Sclose",
+            "Close File Space" );
+        give_syslog_a_chance;
+        H5NXdumperr("H5nx::H5NXread_rows(): H5Sclose() Close File Space");
+        return FAIL;
+    }
+
+    //close type
+    if ( H5Tclose( tid ) < 0 )
+    {
+        syslog( LOG_ERR, "[%i] %s in %s(): Error in %s() %s",
+            g_pid, "STC Error", "H5nx::H5NXread_rows", "H5Tclose",
+            "Close Type" );
+        give_syslog_a_chance;
+        H5NXdumperr("H5nx::H5NXread_rows(): H5Tclose() Close Type");
+        return FAIL;
+    }
+
+    //close dataset
+    if ( H5Dclose( did ) < 0 )
+    {
+        syslog( LOG_ERR, "[%i] %s in %s(): Error in %s() %s",
+            g_pid, "STC Error", "H5nx::H5NXread_rows", "H5Dclose",
+            "Close Dataset" );
+        give_syslog_a_chance;
+        H5NXdumperr("H5nx::H5NXread_rows(): H5Dclose() Close Dataset");
+        return FAIL;
+    }
+
+    return SUCCEED;
+}
+
 ///////////////////////////////////////////////////////////////////
 // H5NXread_slab
 ////////////////////////////////////////////////////////////////////
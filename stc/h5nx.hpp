@@ -77,6 +77,9 @@ public:
     int H5NXcheck_dataset_path( const std::string &group_path,
         const std::string &dataset_name, bool &exists );
 
+    //check for existence of a group or dataset (absolute path)
+    int H5NXcheck_link_path( const std::string &path, bool &exists );
+
     //create/write a SCALAR NUMERICAL attribute
     template <typename NumT>
     int H5NXmake_attribute_scalar( const std::string &dataset_path,
@@ -142,6 +145,20 @@ public:
         std::vector<NumT> &slab, uint64_t slab_size,
         uint64_t slab_offset );
 
+    /////////////////////////////////////////////
+    // WARNING
+    // THIS IS FOR A 2D, FIXED SIZE CASE
+    // writes/reads whole rows [row_offset, row_offset + num_rows)
+    ////////////////////////////////////////////
+    template <typename NumT>
+    int H5NXwrite_rows( const std::string &dataset_path,
+        const std::vector<NumT> &slab, uint64_t num_rows,
+        uint64_t row_offset );
+    template <typename NumT>
+    int H5NXread_rows( const std::string &dataset_path,
+        std::vector<NumT> &slab, uint64_t num_rows,
+        uint64_t row_offset );
+
     ////////////////////////////////////////////
     int H5NXmake_link( const std::string &current_name,
         const std::string &destination_name );
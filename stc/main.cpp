@@ -54,6 +54,10 @@
  * the STC defaults to stream-mode and reads the ADARA stream from stdin. (When
  * configured as an internet service, xinetd maps the socket connection to stdin
  * when launching a new STC instance.)
+ * A long run's file can also be translated in parallel (see
+ * tools/adara-translate-parallel): each segment from adara-split is translated
+ * with --segment, then --stitch merges the segments' events, in order, into a
+ * translation of the run's event-free "skeleton" stream.
  * \subsection Design
  * The STC program is a (mostly) single-threaded process that uses the NxGen class
  * to perform stream translation. The 'NxGen' class is a Nexus-adapter class derived
@@ -81,12 +85,17 @@
 #include <boost/lexical_cast.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/program_options.hpp>
+#include <boost/bind.hpp>
+#include <boost/ref.hpp>
+#include <boost/algorithm/string.hpp>
 #include "ADARA.h"
 #include "ADARAUtils.h"
 #include "TransCompletePkt.h"
 #include "TraceException.h"
 #include "NxGen.h"
 #include "ComBusTransMon.h"
+#include "STCDaemon.h"
+#include "UserIdLdap.h"
 
 using namespace std;
 
@@ -211,202 +220,201 @@ long_syslog( const string &a_label, const string &a_msg )
 }
 
 /**
- * @brief main - Entry point of STC process
- * @param argc - Number of CLI arguments
- * @param argv - Array of CLI command/parameter strings
- * @return 0 on success, 1 on error
+ * @brief sendStatus - Reports the translation status to the SMS
+ * @param a_interact - Interactive mode (status goes to the terminal)
+ * @param a_infd - Stream from the SMS
+ * @param a_outfd - Stream to the SMS
+ * @param a_code - Translation status code
+ * @param a_reason - Failure reason
  */
-int main( int argc, char** argv )
+void
+sendStatus( bool a_interact, int a_infd, int a_outfd,
+        STC::TranslationStatusCode a_code, const string &a_reason )
 {
-    int                         infd = 0;
-    int                         outfd = 1;
-    STC::TranslationStatusCode  sms_code = STC::TS_SUCCESS;
-    string                      sms_reason;
-    bool                        interact;
-    string                      work_root;
-    string                      work_base;
-    string                      work_dir;
-    string                      work_path; // Obsolete... (work_root/base)
-    string                      base_path;
-    string                      config_file;
-    unsigned long               chunk_size; // in Dataset Elements! :-O
-    unsigned short              evt_buf_size;
-    unsigned short              anc_buf_size;
-    unsigned long               cache_size;
-    unsigned short              compression_level;
-    NxGen                      *nxgen = 0;
-    ComBusTransMon             *monitor = 0;
-    string                      nexus_outfile;
-    string                      adara_outfile;
-    bool                        keep_temp = false;
+    bool                        interact = a_interact;
+    int                         infd = a_infd;
+    int                         outfd = a_outfd;
+    STC::TranslationStatusCode  sms_code = a_code;
+    const string               &sms_reason = a_reason;
 
-    // Setup global syslog info
-    g_pid = getpid();
+    if ( !interact )
+    {
+        STC::TransCompletePkt ack_pkt( sms_code, sms_reason );
+        uint32_t heartbeat_pkt[4] = {0,0x00400900,0,0};
 
-    openlog( "stc", 0, LOG_DAEMON );
-    setlogmask( LOG_UPTO( LOG_DEBUG ) );
-    syslog( LOG_INFO,
-        "[%i] %s. %s Version %s, %s Version %s, %s Version %s, Tag %s",
-        g_pid, "Started", "STC", STC_VERSION,
-        "ADARA Common", ADARA::VERSION.c_str(),
-        "ComBus", ADARA::ComBus::VERSION.c_str(),
-        ADARA::TAG_NAME.c_str() );
-    give_syslog_a_chance;
+        // Send ACK/NACK packet to SMS - go to extra effort to ensure the message is sent and
+        // any errors are detected. The second write of 1 byte after the message is sent is
+        // required due to limitations of tcp in detecting dropped connections. If the connection
+        // has been lost, the first write may or may not detect an error, but the second write
+        // (of the heartbeat packet) will fail.
+        // Also, the connection must be shutdown properly with shutdown(), and we must wait for
+        // the SMS to drop the connection when read() returns 0. This prevents the connection from
+        // being reset before the data is actually sent.
 
-    try
-    {
-        bool strict;
-        bool move;
-        bool doRename;
-        uint32_t verbose_level;
-        bool verbose;
-        bool gather_stats;
-        bool suppress_adara;
-        bool suppress_nexus;
-        string broker_uri;
-        string broker_user;
-        string broker_pass;
-        string domain;
+        // Ignore SIGPIPE signals so we can get error codes from write()
+        signal( SIGPIPE, SIG_IGN );
 
-        namespace po = boost::program_options;
-        po::options_description options( "stc program options" );
-        options.add_options()
-                ("help,h", "show help")
-                ("version", "show version number")
-                ("interactive,i", po::bool_switch( &interact )->default_value( false ), "interactive mode")
-                ("verbose_level", po::value<uint32_t>( &verbose_level )->default_value( 0 ), "verbose output logging level (uint32)")
-                ("verbose,v", po::bool_switch( &verbose )->default_value( false ), "verbose output mode (deprecated)")
-                ("strict,s", po::bool_switch( &strict )->default_value( false ), "enable strict protocol parsing")
-                ("move,m", po::bool_switch( &move )->default_value( false ), "move output nexus file to cataloging location (forces strict parsing)")
-                ("report,r", po::bool_switch( &gather_stats )->default_value( false ), "report stream statistics")
-                ("no-nexus,n", po::bool_switch( &suppress_nexus )->default_value( false ), "suppress nexus output file generation")
-                ("no-adara,a", po::bool_switch( &suppress_adara )->default_value( false ), "suppress adara output stream generation")
-                ("keep-temp,k", po::bool_switch( &keep_temp )->default_value( false ), "do not delete temporary output files on translation or move failure")
-                ("file,f",po::value<string>(),"read input from file instead of stdin")
-                ("work-root",po::value<string>( &work_root ),"set root path to construct working directory")
-                ("work-base",po::value<string>( &work_base ),"set base path to construct working directory")
-                ("work-path,w",po::value<string>( &work_path ),"set path to working directory")
-                ("base-path,b",po::value<string>( &base_path ),"set base cataloging path (none by defualt)")
-                ("config,C",po::value<string>( &config_file ),"set STC Config File path (none by defualt)")
-                ("compression-level,c", po::value<unsigned short>( &compression_level )->default_value( 0 ), "set nexus compression level (0=off,9=max)")
-                ("chunk-size", po::value<unsigned long>( &chunk_size )->default_value( 49152 ),"set hdf5 chunk size (in Dataset Elements!)")
-                ("cache-size", po::value<unsigned long>( &cache_size )->default_value( 1024 ),"set hdf5 cache size (in KB)")
-                ("event-buf-size", po::value<unsigned short>( &evt_buf_size )->default_value( 200 ),"set event buffers to (in chunks)")
-                ("anc-buf-size", po::value<unsigned short>( &anc_buf_size )->default_value( 20 ),"set ancillary buffers (in chunks)")
-                ("broker_uri", po::value<string>( &broker_uri )->default_value( "" ), "set AMQP broker URI/IP address")
-                ("broker_user", po::value<string>( &broker_user )->default_value( "" ), "set AMQP broker user name")
-                ("broker_pass", po::value<string>( &broker_pass )->default_value( "" ), "set AMQP broker password")
-                ("domain", po::value<string>( &domain )->default_value( "" ), "Override ComBus domain prefix (TEST ONLY)")
-                ;
+        bool send_status = false;
 
+        std::string log_info;
 
-        po::variables_map opt_map;
-        po::store( po::parse_command_line(argc,argv,options), opt_map );
-        po::notify( opt_map );
+        send_status |= Utils::sendBytes( outfd,
+            ack_pkt.getMessageBuffer(), ack_pkt.getMessageLength(),
+            log_info );
 
-        if ( opt_map.count( "help" ))
-        {
-            cout << options << endl;
-            return STC::TS_TRANSIENT_ERROR;
-        }
-        else if ( opt_map.count( "version" ))
+        if ( !send_status )
         {
-            cout << STC_VERSION
-                 << " (ADARA Common " << ADARA::VERSION
-                 << ", ComBus Version " << ADARA::ComBus::VERSION
-                 << ", Tag " << ADARA::TAG_NAME << ")" << endl;
-            return STC::TS_TRANSIENT_ERROR;
+            syslog( LOG_INFO,
+                "[%i] STC failed: Translation Complete Message: %s",
+                g_pid, log_info.c_str() );
+            give_syslog_a_chance;
         }
 
-        // Apply "Verbose" Boolean Option (Now Deprecated)
-        // to Set New Verbose Logging Level... ;-D
-        if ( verbose_level == 0 && verbose )
-        {
-            // Formerly "--verbose" Triggered "Level 2" Verbosity...
-            // ("Effectively", Before there was a "Level 1"... ;-D)
-            verbose_level = 2;
+        send_status |= Utils::sendBytes( outfd,
+            (char*)heartbeat_pkt, sizeof(heartbeat_pkt), log_info );
 
-            syslog( LOG_INFO, "[%i] %s %s %u.",
-                g_pid, "Applying (Deprecated) \"Verbose\" Option",
-                "to Set Verbose Logging Level to", verbose_level );
+        if ( send_status )
+        {
+            syslog( LOG_INFO,
+                "[%i] Notified SMS of translation status", g_pid );
             give_syslog_a_chance;
         }
         else
         {
-            syslog( LOG_INFO, "[%i] %s %u.",
-                g_pid, "STC Verbose Logging Level Set to", verbose_level );
+            syslog( LOG_INFO,
+                "[%i] STC failed: Translation Complete/Heartbeat Msg: %s",
+                g_pid, log_info.c_str() );
             give_syslog_a_chance;
         }
 
-        // Log Chunk/Buffer Sizes...
-        syslog( LOG_INFO,
-            "[%i] %s %s=%lu %s=%u (%lu/0x%lx) %s=%u (%lu/0x%lx).",
-            g_pid, "STC Data Buffering",
-            "chunk_size", chunk_size,
-            "evt_buf_size", evt_buf_size,
-            chunk_size * evt_buf_size, chunk_size * evt_buf_size,
-            "anc_buf_size", anc_buf_size,
-            chunk_size * anc_buf_size, chunk_size * anc_buf_size );
-        give_syslog_a_chance;
-
-        // If user has requested cataloging, force sane options
-        if ( move )
-        {
-            strict = true;
-            // Don't Force ADARA Stream Generation...
-            // - Raw Data Files Now Cached at SMS/DAQ1 Machines for Replay
-            // suppress_adara = false;
-            suppress_nexus = false;
-        }
-
-        // Can't support statistics display when _Not_ in interactive mode
-        // (Normally, _Only_ response to SMS is written to stdout...!)
-        if ( gather_stats && !interact )
-            gather_stats = false;
-
-        //
-        // *** New STC Work Directory Specification:
-        //    ${WORK_ROOT}/${FACILITY}/${BEAMLINE}/${WORK_BASE}
-        // - if either "work_root" and/or "work_base" are specified,
-        // these values _Subsume_ any "work_path" value and activate the
-        // new "delayed gratification" mode... ;-D
-        //    -> where we _Wait_ until we know the FACILITY and BEAMLINE
-        //    to actually construct the full Working Directory path.
-        //
+        // Request shutdown of write socket - should initiate buffer flush
+        shutdown( outfd, SHUT_WR );
 
-        if ( work_root.size() || work_base.size() )
+        // Read-spin on infd until connection is closed by SMS
+        char buf[1];
+        ssize_t ec;
+        long cnt = 0;
+        while ( 1 )
         {
-            // Clear Out (Now Obsolete) "Work Path",
-            // Favor New "Delayed Gratification: Mode. ;-D
-            work_path.clear();
-
-            // Make Sure Work Root Ends in "/"...
-            // (It might be _Just_ "/"...! ;-D)
-            if ( work_root.size() == 0
-                    || work_root[ work_root.size() - 1 ] != '/' )
+            // NOTE: This is Standard C Library read()... ;-o
+            ec = ::read( infd, buf, 1 );
+            if ( ec > 0 )
             {
-                work_root += "/";
+                cnt += ec;
+                continue;
+            }
+            else if ( ec == 0 )
+                break;
+            else
+            {
+                switch ( ec )
+                {
+                    case EINTR:
+                    case EAGAIN:
+                        continue;
+                    default:
+                        break;
+                }
             }
-
-            syslog( LOG_INFO, "[%i] Working Directory Root set to: [%s]",
-                g_pid, work_root.c_str() );
-            give_syslog_a_chance;
-
-            syslog( LOG_INFO, "[%i] Working Directory Base set to: [%s]",
-                g_pid, work_base.c_str() );
-            give_syslog_a_chance;
         }
 
-        if ( work_path.size() )
+        // Log any extra data read from socket (probably DataDonePkt... :)
+        if ( cnt > 0 )
         {
-            // Make Sure Work Path Ends in "/"...
-            if ( work_path[ work_path.size() - 1 ] != '/' )
-                work_path += "/";
-
-            syslog( LOG_INFO, "[%i] Working Directory Path set to: [%s]",
-                g_pid, work_path.c_str() );
+            syslog( LOG_INFO,
+                "[%i] Warning: Extra Data Read from SMS socket cnt=%ld",
+                g_pid, cnt );
             give_syslog_a_chance;
         }
+    }
+    else if ( sms_code != STC::TS_SUCCESS )
+    {
+        cout << sms_reason << endl;
+    }
+}
+
+/// STC settings from the command line, the same for every translation
+struct STCOptions
+{
+    bool                        interact;
+    bool                        strict;
+    bool                        move;
+    bool                        gather_stats;
+    bool                        suppress_adara;
+    bool                        suppress_nexus;
+    bool                        keep_temp;
+    bool                        segment;
+    vector<string>              stitch_files;
+    uint32_t                    verbose_level;
+    string                      work_root;
+    string                      work_base;
+    string                      work_path;
+    string                      base_path;
+    string                      config_file;
+    unsigned long               chunk_size;
+    unsigned short              evt_buf_size;
+    unsigned short              anc_buf_size;
+    unsigned long               cache_size;
+    unsigned short              compression_level;
+    string                      broker_uri;
+    string                      broker_user;
+    string                      broker_pass;
+    string                      domain;
+};
+
+/**
+ * @brief translate - Translates one ADARA stream and notifies the SMS
+ * @param a_opts - Settings from the command line
+ * @param a_infd - Input stream (negative if the input file didn't open)
+ * @param a_outfd - Stream to send the translation status to
+ * @param a_bytes - Returns the number of stream bytes processed
+ * @return Translation status code (as sent to the SMS)
+ *
+ * Called once for a stdin (inetd) or file translation, or once per SMS
+ * connection by each stcd worker (see STCDaemon).
+ */
+STC::TranslationStatusCode
+translate( const STCOptions &a_opts, int a_infd, int a_outfd,
+        uint64_t &a_bytes )
+{
+    int                         infd = a_infd;
+    int                         outfd = a_outfd;
+    STC::TranslationStatusCode  sms_code = STC::TS_SUCCESS;
+    string                      sms_reason;
+    bool                        interact = a_opts.interact;
+    string                      work_root = a_opts.work_root;
+    string                      work_base = a_opts.work_base;
+    string                      work_dir;
+    string                      work_path = a_opts.work_path;
+    string                      base_path = a_opts.base_path;
+    string                      config_file = a_opts.config_file;
+    unsigned long               chunk_size = a_opts.chunk_size;
+    unsigned short              evt_buf_size = a_opts.evt_buf_size;
+    unsigned short              anc_buf_size = a_opts.anc_buf_size;
+    unsigned long               cache_size = a_opts.cache_size;
+    unsigned short              compression_level =
+                                    a_opts.compression_level;
+    NxGen                      *nxgen = 0;
+    ComBusTransMon             *monitor = 0;
+    string                      nexus_outfile;
+    string                      adara_outfile;
+    bool                        keep_temp = a_opts.keep_temp;
+
+    a_bytes = 0;
+
+    try
+    {
+        bool strict = a_opts.strict;
+        bool move = a_opts.move;
+        bool doRename;
+        uint32_t verbose_level = a_opts.verbose_level;
+        bool gather_stats = a_opts.gather_stats;
+        bool suppress_adara = a_opts.suppress_adara;
+        bool suppress_nexus = a_opts.suppress_nexus;
+        string broker_uri = a_opts.broker_uri;
+        string broker_user = a_opts.broker_user;
+        string broker_pass = a_opts.broker_pass;
+        string domain = a_opts.domain;
 
         string tempName = genTempName();
 
@@ -418,38 +426,6 @@ int main( int argc, char** argv )
             nexus_outfile = work_path + tempName + ".nxs";
                 // "work_path" could be empty...
 
-        if ( config_file.size() )
-        {
-            struct stat statbuf;
-            int err = stat(config_file.c_str(), &statbuf);
-            if ( err )
-            {
-                syslog( LOG_ERR,
-                    "[%i] Stat Error on Config File: %s, %s - Ignoring...",
-                    g_pid, config_file.c_str(), strerror(errno) );
-                give_syslog_a_chance;
-                config_file.clear();
-            }
-            else if ( statbuf.st_size == 0 )
-            {
-                syslog( LOG_ERR,
-                    "[%i] Empty Config File: %s - Ignoring...",
-                    g_pid, config_file.c_str() );
-                give_syslog_a_chance;
-                config_file.clear();
-            }
-            else
-            {
-                syslog( LOG_INFO, "[%i] STC Config File Specified: %s",
-                    g_pid, config_file.c_str() );
-                give_syslog_a_chance;
-            }
-        }
-        else {
-            syslog( LOG_ERR, "[%i] No STC Config File Specified", g_pid );
-            give_syslog_a_chance;
-        }
-
         // Only Dump Verbose STC Settings in Interactive Mode...!
         // (else screws up the STC-to-SMS return status...! ;-D)
         if ( interact && verbose_level > 0 )
@@ -497,31 +473,21 @@ int main( int argc, char** argv )
                  << ( gather_stats ? "yes" : "no" ) << endl;
         }
 
-        if ( opt_map.count( "file" ))
-        {
-            infd = open( opt_map["file"].as<string>().c_str(), O_RDONLY );
-            if ( infd < 0 )
-                throw std::runtime_error("Failed to open input file");
-        }
+        if ( infd < 0 )
+            throw std::runtime_error("Failed to open input file");
 
         if ( infd >= 0 )
         {
-            if ( !interact )
-            {
-                // In non-interactive mode, must hack around chatty
-                // HDF5 library: remap stdout and stderr to /dev/null
-                outfd = dup( 1 );
-                int nullfd = open( "/dev/null", O_RDWR );
-                dup2( nullfd, 1 );
-                dup2( nullfd, 2 );
-            }
-
             nxgen = new NxGen( infd,
                 work_root, work_base, adara_outfile, nexus_outfile,
                 config_file, strict, gather_stats, chunk_size,
                 evt_buf_size, anc_buf_size, cache_size, compression_level,
                 verbose_level );
 
+            // Parallel Translation of a Split Run...
+            nxgen->setSegment( a_opts.segment );
+            nxgen->setStitchFiles( a_opts.stitch_files );
+
             // Start ComBus monitor thread (even in interactive mode!)
             monitor = new ComBusTransMon();
             monitor->start( *nxgen,
@@ -706,180 +672,446 @@ int main( int argc, char** argv )
 
         if ( nxgen != 0 )
         {
-            sms_reason = nxgen->getFacilityName()
-                + " " + nxgen->getBeamLongName()
-                + " (" + nxgen->getBeamShortName() + ")"
-                + " Run "
-                    + boost::lexical_cast<string>(nxgen->getRunNumber())
-                + " " + nxgen->getProposalID() + " - ";
+            sms_reason = nxgen->getFacilityName()
+                + " " + nxgen->getBeamLongName()
+                + " (" + nxgen->getBeamShortName() + ")"
+                + " Run "
+                    + boost::lexical_cast<string>(nxgen->getRunNumber())
+                + " " + nxgen->getProposalID() + " - ";
+        }
+
+        sms_reason += "Unhandled exception";
+
+        syslog( LOG_INFO, "[%i] STC failed: Unknown exception.", g_pid );
+    }
+
+    string run_desc = "";
+    if ( nxgen != 0 )
+    {
+        run_desc = " of " + nxgen->getFacilityName() + " "
+            + nxgen->getBeamShortName() + "_"
+            + boost::lexical_cast<string>(nxgen->getRunNumber())
+            + " (" + nxgen->getProposalID() + ")";
+    }
+
+    if ( sms_code != STC::TS_SUCCESS )
+    {
+        syslog( LOG_INFO, "[%i] STC failed: Translation%s failed. code: %u",
+            g_pid, run_desc.c_str(), (unsigned int)sms_code );
+        give_syslog_a_chance;
+
+        // Notify ComBus Monitor of Failure...
+        if ( monitor )
+            monitor->failure( sms_code, sms_reason );
+    }
+    else
+    {
+        syslog( LOG_INFO, "[%i] Translation%s succeeded",
+            g_pid, run_desc.c_str() );
+        give_syslog_a_chance;
+    }
+
+
+    sendStatus( interact, infd, outfd, sms_code, sms_reason );
+
+
+    // Clean Up, We're Done...! :-D
+
+    syslog( LOG_INFO, "[%i] Cleaning up", g_pid );
+    give_syslog_a_chance;
+
+    if ( monitor )
+        delete monitor;
+
+    if ( nxgen )
+    {
+        a_bytes = nxgen->m_total_bytes_count;
+        delete nxgen;
+    }
+
+    // Clean-up temp output files if translation or rename failed
+    if ( !keep_temp && !nexus_outfile.empty() )
+    {
+        try {
+            boost::filesystem::remove(
+                boost::filesystem::path( work_dir + "/" + nexus_outfile ) );
+        }
+        catch( ... )
+        {
+            syslog( LOG_INFO,
+                "[%i] Error Cleaning Up NeXus File at %s/%s.",
+                g_pid, work_dir.c_str(), nexus_outfile.c_str() );
+            give_syslog_a_chance;
+        }
+    }
+
+    if ( !keep_temp && !adara_outfile.empty() )
+    {
+        try {
+            boost::filesystem::remove(
+                boost::filesystem::path( work_dir + "/" + adara_outfile ) );
+        }
+        catch( ... )
+        {
+            syslog( LOG_INFO,
+                "[%i] Error Cleaning Up ADARA File at %s/%s.",
+                g_pid, work_dir.c_str(), adara_outfile.c_str() );
+            give_syslog_a_chance;
+        }
+    }
+
+    return sms_code;
+}
+
+/**
+ * @brief main - Entry point of STC process
+ * @param argc - Number of CLI arguments
+ * @param argv - Array of CLI command/parameter strings
+ * @return 0 on success, 1 on error
+ */
+int main( int argc, char** argv )
+{
+    int                         infd = 0;
+    int                         outfd = 1;
+    STC::TranslationStatusCode  sms_code = STC::TS_SUCCESS;
+    string                      sms_reason;
+    bool                        interact = false;
+    string                      work_root;
+    string                      work_base;
+    string                      work_path; // Obsolete... (work_root/base)
+    string                      base_path;
+    string                      config_file;
+    unsigned long               chunk_size; // in Dataset Elements! :-O
+    unsigned short              evt_buf_size;
+    unsigned short              anc_buf_size;
+    unsigned long               cache_size;
+    unsigned short              compression_level;
+    bool                        keep_temp = false;
+    bool                        daemon = false;
+    unsigned short              port;
+    uint32_t                    workers;
+    uint32_t                    max_runs;
+    uint32_t                    report_period;
+    uint64_t                    bytes;
+
+    // Setup global syslog info
+    g_pid = getpid();
+
+    openlog( "stc", 0, LOG_DAEMON );
+    setlogmask( LOG_UPTO( LOG_DEBUG ) );
+    syslog( LOG_INFO,
+        "[%i] %s. %s Version %s, %s Version %s, %s Version %s, Tag %s",
+        g_pid, "Started", "STC", STC_VERSION,
+        "ADARA Common", ADARA::VERSION.c_str(),
+        "ComBus", ADARA::ComBus::VERSION.c_str(),
+        ADARA::TAG_NAME.c_str() );
+    give_syslog_a_chance;
+
+    try
+    {
+        bool strict;
+        bool move;
+        uint32_t verbose_level;
+        bool verbose;
+        bool gather_stats;
+        bool suppress_adara;
+        bool suppress_nexus;
+        bool segment;
+        string stitch;
+        string broker_uri;
+        string broker_user;
+        string broker_pass;
+        string domain;
+        string ldap_uri;
+        string ldap_base;
+        string ldap_cache;
+        uint32_t ldap_cache_ttl;
+
+        namespace po = boost::program_options;
+        po::options_description options( "stc program options" );
+        options.add_options()
+                ("help,h", "show help")
+                ("version", "show version number")
+                ("interactive,i", po::bool_switch( &interact )->default_value( false ), "interactive mode")
+                ("verbose_level", po::value<uint32_t>( &verbose_level )->default_value( 0 ), "verbose output logging level (uint32)")
+                ("verbose,v", po::bool_switch( &verbose )->default_value( false ), "verbose output mode (deprecated)")
+                ("strict,s", po::bool_switch( &strict )->default_value( false ), "enable strict protocol parsing")
+                ("move,m", po::bool_switch( &move )->default_value( false ), "move output nexus file to cataloging location (forces strict parsing)")
+                ("report,r", po::bool_switch( &gather_stats )->default_value( false ), "report stream statistics")
+                ("no-nexus,n", po::bool_switch( &suppress_nexus )->default_value( false ), "suppress nexus output file generation")
+                ("no-adara,a", po::bool_switch( &suppress_adara )->default_value( false ), "suppress adara output stream generation")
+                ("keep-temp,k", po::bool_switch( &keep_temp )->default_value( false ), "do not delete temporary output files on translation or move failure")
+                ("file,f",po::value<string>(),"read input from file instead of stdin")
+                ("segment", po::bool_switch( &segment )->default_value( false ), "translate one segment of a split run (see adara-split), to be stitched")
+                ("stitch", po::value<string>( &stitch ), "stitch these comma-separated segment translations, in order, over the run's skeleton stream")
+                ("work-root",po::value<string>( &work_root ),"set root path to construct working directory")
+                ("work-base",po::value<string>( &work_base ),"set base path to construct working directory")
+                ("work-path,w",po::value<string>( &work_path ),"set path to working directory")
+                ("base-path,b",po::value<string>( &base_path ),"set base cataloging path (none by defualt)")
+                ("config,C",po::value<string>( &config_file ),"set STC Config File path (none by defualt)")
+                ("compression-level,c", po::value<unsigned short>( &compression_level )->default_value( 0 ), "set nexus compression level (0=off,9=max)")
+                ("chunk-size", po::value<unsigned long>( &chunk_size )->default_value( 49152 ),"set hdf5 chunk size (in Dataset Elements!)")
+                ("cache-size", po::value<unsigned long>( &cache_size )->default_value( 1024 ),"set hdf5 cache size (in KB)")
+                ("event-buf-size", po::value<unsigned short>( &evt_buf_size )->default_value( 200 ),"set event buffers to (in chunks)")
+                ("anc-buf-size", po::value<unsigned short>( &anc_buf_size )->default_value( 20 ),"set ancillary buffers (in chunks)")
+                ("broker_uri", po::value<string>( &broker_uri )->default_value( "" ), "set AMQP broker URI/IP address")
+                ("broker_user", po::value<string>( &broker_user )->default_value( "" ), "set AMQP broker user name")
+                ("broker_pass", po::value<string>( &broker_pass )->default_value( "" ), "set AMQP broker password")
+                ("domain", po::value<string>( &domain )->default_value( "" ), "Override ComBus domain prefix (TEST ONLY)")
+                ("ldap-uri", po::value<string>( &ldap_uri )->default_value( "" ), "set LDAP server URI for user name lookups (default from ldap.conf)")
+                ("ldap-base", po::value<string>( &ldap_base )->default_value( "ou=Users,dc=sns,dc=ornl,dc=gov" ), "set LDAP search base for user name lookups")
+                ("ldap-cache", po::value<string>( &ldap_cache )->default_value( "" ), "set user name cache file shared by all STCs, e.g. /var/cache/stc/ldap_users (default off)")
+                ("ldap-cache-ttl", po::value<uint32_t>( &ldap_cache_ttl )->default_value( 86400 ), "seconds a cached user name is used before asking LDAP again")
+                ("daemon,D", po::bool_switch( &daemon )->default_value( false ), "run as persistent stcd server with a pool of worker processes")
+                ("port", po::value<unsigned short>( &port )->default_value( 31417 ), "stcd port for SMS connections")
+                ("workers", po::value<uint32_t>( &workers )->default_value( 4 ), "stcd worker processes (concurrent translations)")
+                ("max-runs", po::value<uint32_t>( &max_runs )->default_value( 100 ), "stcd translations per worker before it is replaced (0=never)")
+                ("report-period", po::value<uint32_t>( &report_period )->default_value( 300 ), "stcd seconds between worker throughput logs (0=off)")
+                ;
+
+
+        po::variables_map opt_map;
+        po::store( po::parse_command_line(argc,argv,options), opt_map );
+        po::notify( opt_map );
+
+        if ( opt_map.count( "help" ))
+        {
+            cout << options << endl;
+            return STC::TS_TRANSIENT_ERROR;
+        }
+        else if ( opt_map.count( "version" ))
+        {
+            cout << STC_VERSION
+                 << " (ADARA Common " << ADARA::VERSION
+                 << ", ComBus Version " << ADARA::ComBus::VERSION
+                 << ", Tag " << ADARA::TAG_NAME << ")" << endl;
+            return STC::TS_TRANSIENT_ERROR;
         }
 
-        sms_reason += "Unhandled exception";
-
-        syslog( LOG_INFO, "[%i] STC failed: Unknown exception.", g_pid );
-    }
-
-    string run_desc = "";
-    if ( nxgen != 0 )
-    {
-        run_desc = " of " + nxgen->getFacilityName() + " "
-            + nxgen->getBeamShortName() + "_"
-            + boost::lexical_cast<string>(nxgen->getRunNumber())
-            + " (" + nxgen->getProposalID() + ")";
-    }
+        // Apply "Verbose" Boolean Option (Now Deprecated)
+        // to Set New Verbose Logging Level... ;-D
+        if ( verbose_level == 0 && verbose )
+        {
+            // Formerly "--verbose" Triggered "Level 2" Verbosity...
+            // ("Effectively", Before there was a "Level 1"... ;-D)
+            verbose_level = 2;
 
-    if ( sms_code != STC::TS_SUCCESS )
-    {
-        syslog( LOG_INFO, "[%i] STC failed: Translation%s failed. code: %u",
-            g_pid, run_desc.c_str(), (unsigned int)sms_code );
-        give_syslog_a_chance;
+            syslog( LOG_INFO, "[%i] %s %s %u.",
+                g_pid, "Applying (Deprecated) \"Verbose\" Option",
+                "to Set Verbose Logging Level to", verbose_level );
+            give_syslog_a_chance;
+        }
+        else
+        {
+            syslog( LOG_INFO, "[%i] %s %u.",
+                g_pid, "STC Verbose Logging Level Set to", verbose_level );
+            give_syslog_a_chance;
+        }
 
-        // Notify ComBus Monitor of Failure...
-        if ( monitor )
-            monitor->failure( sms_code, sms_reason );
-    }
-    else
-    {
-        syslog( LOG_INFO, "[%i] Translation%s succeeded",
-            g_pid, run_desc.c_str() );
+        // Log Chunk/Buffer Sizes...
+        syslog( LOG_INFO,
+            "[%i] %s %s=%lu %s=%u (%lu/0x%lx) %s=%u (%lu/0x%lx).",
+            g_pid, "STC Data Buffering",
+            "chunk_size", chunk_size,
+            "evt_buf_size", evt_buf_size,
+            chunk_size * evt_buf_size, chunk_size * evt_buf_size,
+            "anc_buf_size", anc_buf_size,
+            chunk_size * anc_buf_size, chunk_size * anc_buf_size );
         give_syslog_a_chance;
-    }
-
-    if ( !interact )
-    {
-        STC::TransCompletePkt ack_pkt( sms_code, sms_reason );
-        uint32_t heartbeat_pkt[4] = {0,0x00400900,0,0};
 
-        // Send ACK/NACK packet to SMS - go to extra effort to ensure the message is sent and
-        // any errors are detected. The second write of 1 byte after the message is sent is
-        // required due to limitations of tcp in detecting dropped connections. If the connection
-        // has been lost, the first write may or may not detect an error, but the second write
-        // (of the heartbeat packet) will fail.
-        // Also, the connection must be shutdown properly with shutdown(), and we must wait for
-        // the SMS to drop the connection when read() returns 0. This prevents the connection from
-        // being reset before the data is actually sent.
+        // If user has requested cataloging, force sane options
+        if ( move )
+        {
+            strict = true;
+            // Don't Force ADARA Stream Generation...
+            // - Raw Data Files Now Cached at SMS/DAQ1 Machines for Replay
+            // suppress_adara = false;
+            suppress_nexus = false;
+        }
 
-        // Ignore SIGPIPE signals so we can get error codes from write()
-        signal( SIGPIPE, SIG_IGN );
+        // Can't support statistics display when _Not_ in interactive mode
+        // (Normally, _Only_ response to SMS is written to stdout...!)
+        if ( gather_stats && !interact )
+            gather_stats = false;
 
-        bool send_status = false;
+        //
+        // *** New STC Work Directory Specification:
+        //    ${WORK_ROOT}/${FACILITY}/${BEAMLINE}/${WORK_BASE}
+        // - if either "work_root" and/or "work_base" are specified,
+        // these values _Subsume_ any "work_path" value and activate the
+        // new "delayed gratification" mode... ;-D
+        //    -> where we _Wait_ until we know the FACILITY and BEAMLINE
+        //    to actually construct the full Working Directory path.
+        //
 
-        std::string log_info;
+        if ( work_root.size() || work_base.size() )
+        {
+            // Clear Out (Now Obsolete) "Work Path",
+            // Favor New "Delayed Gratification: Mode. ;-D
+            work_path.clear();
 
-        send_status |= Utils::sendBytes( outfd,
-            ack_pkt.getMessageBuffer(), ack_pkt.getMessageLength(),
-            log_info );
+            // Make Sure Work Root Ends in "/"...
+            // (It might be _Just_ "/"...! ;-D)
+            if ( work_root.size() == 0
+                    || work_root[ work_root.size() - 1 ] != '/' )
+            {
+                work_root += "/";
+            }
 
-        if ( !send_status )
-        {
-            syslog( LOG_INFO,
-                "[%i] STC failed: Translation Complete Message: %s",
-                g_pid, log_info.c_str() );
+            syslog( LOG_INFO, "[%i] Working Directory Root set to: [%s]",
+                g_pid, work_root.c_str() );
             give_syslog_a_chance;
-        }
-
-        send_status |= Utils::sendBytes( outfd,
-            (char*)heartbeat_pkt, sizeof(heartbeat_pkt), log_info );
 
-        if ( send_status )
-        {
-            syslog( LOG_INFO,
-                "[%i] Notified SMS of translation status", g_pid );
+            syslog( LOG_INFO, "[%i] Working Directory Base set to: [%s]",
+                g_pid, work_base.c_str() );
             give_syslog_a_chance;
         }
-        else
+
+        if ( work_path.size() )
         {
-            syslog( LOG_INFO,
-                "[%i] STC failed: Translation Complete/Heartbeat Msg: %s",
-                g_pid, log_info.c_str() );
+            // Make Sure Work Path Ends in "/"...
+            if ( work_path[ work_path.size() - 1 ] != '/' )
+                work_path += "/";
+
+            syslog( LOG_INFO, "[%i] Working Directory Path set to: [%s]",
+                g_pid, work_path.c_str() );
             give_syslog_a_chance;
         }
 
-        // Request shutdown of write socket - should initiate buffer flush
-        shutdown( outfd, SHUT_WR );
 
-        // Read-spin on infd until connection is closed by SMS
-        char buf[1];
-        ssize_t ec;
-        long cnt = 0;
-        while ( 1 )
+        if ( config_file.size() )
         {
-            // NOTE: This is Standard C Library read()... ;-o
-            ec = ::read( infd, buf, 1 );
-            if ( ec > 0 )
+            struct stat statbuf;
+            int err = stat(config_file.c_str(), &statbuf);
+            if ( err )
             {
-                cnt += ec;
-                continue;
+                syslog( LOG_ERR,
+                    "[%i] Stat Error on Config File: %s, %s - Ignoring...",
+                    g_pid, config_file.c_str(), strerror(errno) );
+                give_syslog_a_chance;
+                config_file.clear();
+            }
+            else if ( statbuf.st_size == 0 )
+            {
+                syslog( LOG_ERR,
+                    "[%i] Empty Config File: %s - Ignoring...",
+                    g_pid, config_file.c_str() );
+                give_syslog_a_chance;
+                config_file.clear();
             }
-            else if ( ec == 0 )
-                break;
             else
             {
-                switch ( ec )
-                {
-                    case EINTR:
-                    case EAGAIN:
-                        continue;
-                    default:
-                        break;
-                }
+                syslog( LOG_INFO, "[%i] STC Config File Specified: %s",
+                    g_pid, config_file.c_str() );
+                give_syslog_a_chance;
             }
         }
+        else {
+            syslog( LOG_ERR, "[%i] No STC Config File Specified", g_pid );
+            give_syslog_a_chance;
+        }
 
-        // Log any extra data read from socket (probably DataDonePkt... :)
-        if ( cnt > 0 )
+        // A Segment Translation Can't Also Stitch Segments...
+        if ( segment && opt_map.count( "stitch" ) )
         {
-            syslog( LOG_INFO,
-                "[%i] Warning: Extra Data Read from SMS socket cnt=%ld",
-                g_pid, cnt );
-            give_syslog_a_chance;
+            throw std::runtime_error(
+                "--segment can't be used with --stitch" );
         }
-    }
-    else if ( sms_code != STC::TS_SUCCESS )
-    {
-        cout << sms_reason << endl;
-    }
 
-    // Clean Up, We're Done...! :-D
+        STCOptions opts;
+        opts.interact = interact;
+        opts.strict = strict;
+        opts.move = move;
+        opts.gather_stats = gather_stats;
+        opts.suppress_adara = suppress_adara;
+        opts.suppress_nexus = suppress_nexus;
+        opts.keep_temp = keep_temp;
+        opts.segment = segment;
+        if ( stitch.size() )
+        {
+            boost::split( opts.stitch_files, stitch,
+                boost::is_any_of( "," ) );
+        }
+        opts.verbose_level = verbose_level;
+        opts.work_root = work_root;
+        opts.work_base = work_base;
+        opts.work_path = work_path;
+        opts.base_path = base_path;
+        opts.config_file = config_file;
+        opts.chunk_size = chunk_size;
+        opts.evt_buf_size = evt_buf_size;
+        opts.anc_buf_size = anc_buf_size;
+        opts.cache_size = cache_size;
+        opts.compression_level = compression_level;
+        opts.broker_uri = broker_uri;
+        opts.broker_user = broker_user;
+        opts.broker_pass = broker_pass;
+        opts.domain = domain;
+
+        // Batched User Name Lookups, Through the Shared Name Cache...
+        stcLdapSetServer( ldap_uri, ldap_base );
+        stcLdapSetCache( ldap_cache, ldap_cache_ttl );
+
+        // Persistent "stcd" Server, Instead of One STC per Run
+        // from xinetd - Workers Keep Config/LDAP/ComBus Warm...
+        if ( daemon )
+        {
+            if ( interact || opt_map.count( "file" )
+                    || segment || opt_map.count( "stitch" ) )
+            {
+                throw std::runtime_error( "Daemon mode can't be used with"
+                    " --interactive, --file, --segment or --stitch" );
+            }
 
-    syslog( LOG_INFO, "[%i] Cleaning up", g_pid );
-    give_syslog_a_chance;
+            // Workers are never interactive, so hush the chatty
+            // HDF5 library once here, rather than for every run
+            int nullfd = open( "/dev/null", O_RDWR );
+            dup2( nullfd, 0 );
+            dup2( nullfd, 1 );
+            dup2( nullfd, 2 );
+            if ( nullfd > 2 )
+                close( nullfd );
 
-    if ( monitor )
-        delete monitor;
+            stcLdapSetPersistent( true );
+            ComBusTransMon::setPersistent( true );
 
-    if ( nxgen )
-        delete nxgen;
+            STCDaemon stcd( port, workers, max_runs, report_period );
 
-    // Clean-up temp output files if translation or rename failed
-    if ( !keep_temp && !nexus_outfile.empty() )
-    {
-        try {
-            boost::filesystem::remove(
-                boost::filesystem::path( work_dir + "/" + nexus_outfile ) );
+            int status = stcd.run( boost::bind( &translate,
+                boost::cref( opts ), _1, _1, _2 ) );
+
+            closelog();
+
+            return status;
         }
-        catch( ... )
+
+        if ( opt_map.count( "file" ))
         {
-            syslog( LOG_INFO,
-                "[%i] Error Cleaning Up NeXus File at %s/%s.",
-                g_pid, work_dir.c_str(), nexus_outfile.c_str() );
-            give_syslog_a_chance;
+            // translate() Reports Any Failure to Open...
+            infd = open( opt_map["file"].as<string>().c_str(), O_RDONLY );
         }
-    }
 
-    if ( !keep_temp && !adara_outfile.empty() )
-    {
-        try {
-            boost::filesystem::remove(
-                boost::filesystem::path( work_dir + "/" + adara_outfile ) );
-        }
-        catch( ... )
+        if ( infd >= 0 && !interact )
         {
-            syslog( LOG_INFO,
-                "[%i] Error Cleaning Up ADARA File at %s/%s.",
-                g_pid, work_dir.c_str(), adara_outfile.c_str() );
-            give_syslog_a_chance;
+            // In non-interactive mode, must hack around chatty
+            // HDF5 library: remap stdout and stderr to /dev/null
+            outfd = dup( 1 );
+            int nullfd = open( "/dev/null", O_RDWR );
+            dup2( nullfd, 1 );
+            dup2( nullfd, 2 );
         }
+
+        sms_code = translate( opts, infd, outfd, bytes );
+    }
+    catch( exception &e )
+    {
+        // Bad Command Line (translate() Handles Its Own Exceptions)
+        sms_code = STC::TS_PERM_ERROR;
+        sms_reason = e.what();
+
+        long_syslog( "STC failed: Exception:", sms_reason );
+
+        sendStatus( interact, infd, outfd, sms_code, sms_reason );
     }
 
     syslog( LOG_INFO, "[%i] Process exiting", g_pid );
@@ -891,4 +1123,3 @@ int main( int argc, char** argv )
 }
 
 // vim: expandtab
-
@@ -9,6 +9,8 @@
 #include <syslog.h>
 #include "ADARAUtils.h"
 #include "ADARAPackets.h"
+#include "TofBinDivider.h"
+#include "SparseHistogram.h"
 
 // Global syslog info
 #define STC_VERSION "1.13.3"
@@ -173,6 +175,25 @@ public:
                         give_syslog_a_chance;
                     }
 
+                    // Zero TOF Bin Size, Can't Divide the TOF Range...
+                    // (Empty Histogram, Events Go Uncounted, As for the
+                    //    TofBinDivider)
+                    else if ( (*dbs)->tofBin == 0 )
+                    {
+                        syslog( LOG_ERR,
+                            "[%i] %s %s %u %s %u %s: %s %s (%u to %u by %u)",
+                            g_pid, "STC Error:", "Detector Bank", m_id,
+                            "State", m_state,
+                            "Histogram Error", "Zero TOF Bin Size",
+                            "Empty Histogram",
+                            (*dbs)->tofOffset, (*dbs)->tofMax,
+                            (*dbs)->tofBin );
+                        give_syslog_a_chance;
+
+                        m_num_tof_bins = 2;
+                        m_tof_bin_size = 0;
+                    }
+
                     else
                     {
                         // Number of Time Bin Values Needed...
@@ -206,6 +227,10 @@ public:
                         m_tof_bin_size = (*dbs)->tofBin;
                     }
 
+                    // Precompute the Per-Event TOF Bin Division...
+                    m_tof_bin_div.init( m_tof_bin_size,
+                        (*dbs)->tofMax - (*dbs)->tofOffset );
+
                     // Calculate Per-PixelId Offset Index
                     //    into Histogram Data Buffer...
                     // (saves time, and we sorta _Have_ to do this
@@ -243,7 +268,8 @@ public:
                     give_syslog_a_chance;
 
                     // Actual Histogram Storage, Non-Inclusive Max TOF Bin
-                    m_data_buffer.reserve( num_pids
+                    // (Sparse, Only Allocated As Bins Get Counts...)
+                    m_histo_data.init( (uint64_t) num_pids
                         * ( m_num_tof_bins - 1 ) );
 
                     // TOF Bin Values...
@@ -252,10 +278,6 @@ public:
                     uint32_t tofbin = (*dbs)->tofOffset;
                     for (uint32_t i=0 ; i < m_num_tof_bins - 1 ; i++)
                     {
-                        // Inverted Indexing, but it's the right count...!
-                        for (uint32_t p=0 ; p < num_pids ; p++)
-                            m_data_buffer.push_back(0);
-
                         m_tofbin_buffer.push_back((float)tofbin);
                         tofbin += m_tof_bin_size;
                     }
@@ -264,15 +286,15 @@ public:
                     m_tofbin_buffer.push_back((float)((*dbs)->tofMax));
 
                     // Verify Histogram Data Size
-                    if ( m_data_buffer.size() !=
-                            num_pids * ( m_num_tof_bins - 1 ) )
+                    if ( m_histo_data.size() != (uint64_t) num_pids
+                            * ( m_num_tof_bins - 1 ) )
                     {
                         syslog( LOG_ERR,
                       "[%i] %s %s %u %s %u %s: %s %s.size()=%lu vs. %s %u",
                             g_pid, "STC Error:", "Detector Bank", m_id,
                             "State", m_state,
                             "Histogram", "Verifying",
-                            "m_data_buffer", m_data_buffer.size(),
+                            "m_histo_data", m_histo_data.size(),
                             "expected",
                             num_pids * ( m_num_tof_bins - 1 ) );
                         give_syslog_a_chance;
@@ -390,9 +412,10 @@ public:
     bool                    m_has_histo;            ///< Has a Histogram output already been defined?
     uint32_t                m_num_tof_bins;         ///< Histo Number of TOF Bins
     uint32_t                m_tof_bin_size;         ///< Histo Actual TOF Bin Size (differs for "empty")
+    TofBinDivider           m_tof_bin_div;          ///< Histo Fast Divide by m_tof_bin_size
     uint32_t                m_base_pid;             ///< Base PixelId Offset into Histo Offset Index
     std::vector<int32_t>    m_histo_pid_offset;     ///< Histo PixelId Offsets into data buffer
-    std::vector<uint32_t>   m_data_buffer;          ///< Histo data buffer
+    SparseHistogram         m_histo_data;           ///< Histo data (pixel x TOF bin)
     std::vector<float>      m_tofbin_buffer;        ///< Histo TOF Bin buffer
 
     std::vector<DetectorBankSet *>  m_bank_sets;    ///< Any Detector Bank Set info for this detector bank
@@ -434,16 +457,34 @@ public:
         // Histo-based Monitor
         if ( m_config.format == ADARA::HISTO_FORMAT )
         {
-            // Number of Time Bin Values Needed...
-            m_num_tof_bins = ( ( m_config.tofMax - m_config.tofOffset )
-                / m_config.tofBin ) + 1;
-
-            // If Max TOF doesn't divide evenly into TOF Bin size,
-            // then need "One Extra" Bin Value...
-            if ( ( m_config.tofMax - m_config.tofOffset )
-                    % m_config.tofBin )
+            // Zero TOF Bin Size, Can't Divide the TOF Range...
+            // (Empty Histogram, Events Go Uncounted, As for the
+            //    TofBinDivider)
+            if ( m_config.tofBin == 0 )
             {
-                m_num_tof_bins++;
+                syslog( LOG_ERR,
+                    "[%i] %s %s %u Histogram Error: %s, %s (%u to %u by %u)",
+                    g_pid, "STC Error:", "Beam Monitor", m_id,
+                    "Zero TOF Bin Size", "Empty Histogram",
+                    m_config.tofOffset, m_config.tofMax, m_config.tofBin );
+                give_syslog_a_chance;
+
+                m_num_tof_bins = 2;
+            }
+
+            else
+            {
+                // Number of Time Bin Values Needed...
+                m_num_tof_bins = ( ( m_config.tofMax - m_config.tofOffset )
+                    / m_config.tofBin ) + 1;
+
+                // If Max TOF doesn't divide evenly into TOF Bin size,
+                // then need "One Extra" Bin Value...
+                if ( ( m_config.tofMax - m_config.tofOffset )
+                        % m_config.tofBin )
+                {
+                    m_num_tof_bins++;
+                }
             }
 
             // Fail Safe: Make Sure We Get At Least One Actual TOF Bin!
@@ -457,6 +498,10 @@ public:
                 m_num_tof_bins = 2;
             }
 
+            // Precompute the Per-Event TOF Bin Division...
+            m_tof_bin_div.init( m_config.tofBin,
+                m_config.tofMax - m_config.tofOffset );
+
             // Actual Histogram Storage, Non-Inclusive Max TOF Bin...
             m_data_buffer.reserve(m_num_tof_bins - 1);
 
@@ -503,6 +548,7 @@ public:
     uint64_t                m_tof_buffer_size;      ///< "In Use" Size of Time of flight buffer
 
     uint32_t                m_num_tof_bins;         ///< Histo Number of TOF Bins
+    TofBinDivider           m_tof_bin_div;          ///< Histo Fast Divide by m_config.tofBin
     std::vector<uint32_t>   m_data_buffer;          ///< Histo data buffer
     std::vector<float>      m_tofbin_buffer;        ///< Histo TOF Bin buffer
 
@@ -830,6 +876,10 @@ public:
     virtual int32_t flushBuffers( uint64_t start_time,
         struct RunMetrics *a_run_metrics = 0 ) = 0;
 
+    /// Virtual method to allow subclasses to do the CPU-side work of the
+    /// final flushBuffers() ahead of time (may run on a worker thread)
+    virtual void prepareFinalFlush( uint64_t start_time ) = 0;
+
     virtual void createSTCConfigConditionalGroups(void) = 0;
 
     std::string         m_device_name;  ///< Name of device that owns the PV
@@ -1397,6 +1447,8 @@ public:
                                 uint64_t a_count ) = 0;
     virtual void            monitorFinalize(
                                 STC::MonitorInfo &a_monitor ) = 0;
+    virtual uint64_t        stitchPartial( const std::string &a_path,
+                                uint64_t a_pulse_offset ) = 0;
     virtual void            runComment( double a_time, uint64_t a_ts_nano,
                                 const std::string &a_comment,
                                 bool a_force_init = false ) = 0;
@@ -0,0 +1,196 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "UserIdLdap.h"
+
+/* Checks the STC shared LDAP user name cache, without an LDAP server:
+ *
+ *   - stcLdapCacheStore() writes one "uid<TAB>time<TAB>name" line per
+ *     user, with tabs/newlines in uids and names blanked out, and
+ *     merges into (rather than replaces) what's already there,
+ *   - stcLdapLookupUserNames() takes fresh names from the cache, and
+ *     with LDAP unreachable falls back to expired ones, reporting
+ *     only the uids it can't find at all, and names every spelling
+ *     of uids that differ only in case,
+ *   - a cache path in a missing directory is harmless.
+ *
+ * LDAP is pointed at a closed port on localhost, so every search fails.
+ */
+
+pid_t g_pid;
+
+static uint32_t failures = 0;
+
+#define CHECK( _cond ) \
+    do { \
+        if ( !( _cond ) ) \
+        { \
+            fprintf( stderr, "%s:%d: check failed: %s\n", \
+                __FILE__, __LINE__, #_cond ); \
+            failures++; \
+        } \
+    } while ( 0 )
+
+static std::vector<std::string> readLines( const std::string &path )
+{
+    std::vector<std::string> lines;
+    std::ifstream f( path.c_str() );
+    std::string line;
+    while ( getline( f, line ) )
+        lines.push_back( line );
+    return lines;
+}
+
+static void checkFormat( const std::string &path )
+{
+    std::map<std::string, std::string> names;
+    names[ "alice" ] = "Alice Aardvark";
+    names[ "bob\tsmith\n" ] = "Bob\tSmith\r\nJr";
+
+    time_t before = time(NULL);
+    stcLdapCacheStore( names );
+
+    std::vector<std::string> lines = readLines( path );
+    CHECK( lines.size() == 2 );
+
+    for ( size_t i = 0 ; i < lines.size() ; i++ )
+    {
+        const std::string &l = lines[i];
+        size_t t1 = l.find( '\t' );
+        size_t t2 = ( t1 == std::string::npos ) ? t1 : l.find( '\t', t1 + 1 );
+        CHECK( t2 != std::string::npos );
+        CHECK( l.find( '\t', t2 + 1 ) == std::string::npos );
+        CHECK( l.find( '\r' ) == std::string::npos );
+        if ( t2 == std::string::npos )
+            continue;
+
+        time_t stamp = strtoll( l.substr( t1 + 1, t2 - t1 - 1 ).c_str(),
+            NULL, 10 );
+        CHECK( stamp >= before && stamp <= time(NULL) );
+    }
+
+    if ( lines.size() == 2 )
+    {
+        CHECK( lines[0].substr( 0, 6 ) == "alice\t" );
+        CHECK( lines[0].substr( lines[0].rfind( '\t' ) + 1 )
+            == "Alice Aardvark" );
+        CHECK( lines[1].substr( 0, 11 ) == "bob smith \t" );
+        CHECK( lines[1].substr( lines[1].rfind( '\t' ) + 1 )
+            == "Bob Smith  Jr" );
+    }
+
+    // Merged Into What's There...
+    std::map<std::string, std::string> more;
+    more[ "carol" ] = "Carol Caracal";
+    stcLdapCacheStore( more );
+
+    lines = readLines( path );
+    CHECK( lines.size() == 3 );
+    if ( lines.size() == 3 )
+        CHECK( lines[2].substr( 0, 6 ) == "carol\t" );
+}
+
+static void checkFallback( const std::string &path, uint32_t ttl )
+{
+    time_t now = time(NULL);
+
+    FILE *fp = fopen( path.c_str(), "w" );
+    CHECK( fp != NULL );
+    if ( fp == NULL )
+        return;
+    fprintf( fp, "fresh\t%lld\tFresh Name\n", (long long) now );
+    fprintf( fp, "stale\t%lld\tStale Name\n", (long long) ( now - 2 * ttl ) );
+    fprintf( fp, "STALE\t%lld\tShouty Name\n", (long long) ( now - 2 * ttl ) );
+    fprintf( fp, "garbage line without tabs\n" );
+    fclose( fp );
+
+    std::vector<std::string> uids;
+    std::map<std::string, std::string> names;
+
+    // Only Fresh Names, LDAP is Never Asked...
+    uids.push_back( "fresh" );
+    CHECK( stcLdapLookupUserNames( uids, names ) == 0 );
+    CHECK( names[ "fresh" ] == "Fresh Name" );
+
+    // LDAP Down: Expired Names Still Used, Unknown uids Reported...
+    uids.push_back( "stale" );
+    uids.push_back( "nobody" );
+    names.clear();
+    CHECK( stcLdapLookupUserNames( uids, names ) == -1 );
+    CHECK( names.size() == 2 );
+    CHECK( names[ "fresh" ] == "Fresh Name" );
+    CHECK( names[ "stale" ] == "Stale Name" );
+    CHECK( names.count( "nobody" ) == 0 );
+
+    // uids Differing Only in Case Share an LDAP Search, but Each
+    // Spelling Still Gets a Name...
+    uids.push_back( "STALE" );
+    names.clear();
+    CHECK( stcLdapLookupUserNames( uids, names ) == -1 );
+    CHECK( names.size() == 3 );
+    CHECK( names[ "stale" ] == "Stale Name" );
+    CHECK( names[ "STALE" ] == "Shouty Name" );
+
+    // ...and Nothing New was Written Back
+    CHECK( readLines( path ).size() == 4 );
+}
+
+static void checkMissingDir( void )
+{
+    stcLdapSetCache( "/nonexistent/stc-ldap-cache-test/ldap_users", 3600 );
+
+    std::map<std::string, std::string> names;
+    names[ "alice" ] = "Alice Aardvark";
+    stcLdapCacheStore( names );
+
+    std::vector<std::string> uids( 1, "alice" );
+    names.clear();
+    CHECK( stcLdapLookupUserNames( uids, names ) == -1 );
+    CHECK( names.empty() );
+}
+
+int main( void )
+{
+    g_pid = getpid();
+
+    char dir[] = "/tmp/ldap-cache-test-XXXXXX";
+    if ( mkdtemp( dir ) == NULL )
+    {
+        perror( "mkdtemp" );
+        return 1;
+    }
+    std::string path = std::string( dir ) + "/ldap_users";
+
+    uint32_t ttl = 3600;
+
+    stcLdapSetServer( "ldap://127.0.0.1:1", "" );
+    stcLdapSetCache( path, ttl );
+
+    checkFormat( path );
+    checkFallback( path, ttl );
+    checkMissingDir();
+
+    unlink( path.c_str() );
+    unlink( ( path + ".lock" ).c_str() );
+    rmdir( dir );
+
+    if ( failures )
+    {
+        printf( "%u check(s) failed\n", failures );
+        return 1;
+    }
+
+    printf( "LDAP user name cache OK.\n" );
+
+    return 0;
+}
+
+// vim: expandtab
@@ -0,0 +1,164 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "SparseHistogram.h"
+
+/* Checks that STC::SparseHistogram counts exactly like the dense
+ * std::vector<uint32_t> histogram it replaces, for a bank with:
+ *
+ *   - a few scattered hits (blocks stay sparse),
+ *   - a hot spot (blocks go dense part way through counting),
+ *   - a size that isn't a whole number of blocks,
+ *   - whole counts added at once (as when stitching partial runs),
+ *
+ * comparing every cell via get(), and via copyOut() over whole rows (as
+ * NxGen writes it) and over ranges straddling block boundaries.
+ */
+
+using STC::SparseHistogram;
+
+static uint64_t failures = 0;
+
+static void fail( const char *what, uint64_t cell, uint32_t got,
+        uint32_t want )
+{
+    if ( failures++ < 20 )
+    {
+        fprintf( stderr, "FAIL: %s: cell %llu = %u, got %u\n",
+            what, (unsigned long long) cell, want, got );
+    }
+}
+
+static void check( const SparseHistogram &histo,
+        const std::vector<uint32_t> &dense, uint64_t row_size )
+{
+    uint64_t size = dense.size();
+
+    for ( uint64_t c = 0 ; c < size ; c++ )
+    {
+        if ( histo.get( c ) != dense[c] )
+            fail( "get", c, histo.get( c ), dense[c] );
+    }
+
+    // Whole Rows, A Few at a Time...
+    std::vector<uint32_t> slab;
+    uint64_t slab_rows = 7;
+    for ( uint64_t c = 0 ; c < size ; c += slab_rows * row_size )
+    {
+        uint64_t n = slab_rows * row_size;
+        if ( n > size - c )
+            n = size - c;
+        slab.assign( n, 0xDEADBEEF );
+        histo.copyOut( c, n, &(slab[0]) );
+        for ( uint64_t i = 0 ; i < n ; i++ )
+        {
+            if ( slab[i] != dense[c + i] )
+                fail( "copyOut rows", c + i, slab[i], dense[c + i] );
+        }
+    }
+
+    // Around Block Boundaries...
+    for ( uint64_t b = SparseHistogram::BLOCK_CELLS ; b < size ;
+            b += SparseHistogram::BLOCK_CELLS )
+    {
+        uint64_t c = b - 3;
+        uint64_t n = ( size - c < 7 ) ? size - c : 7;
+        slab.assign( n, 0xDEADBEEF );
+        histo.copyOut( c, n, &(slab[0]) );
+        for ( uint64_t i = 0 ; i < n ; i++ )
+        {
+            if ( slab[i] != dense[c + i] )
+                fail( "copyOut edges", c + i, slab[i], dense[c + i] );
+        }
+    }
+}
+
+int main( int argc, char **argv )
+{
+    // 1000 pixels x 1999 TOF bins, not a whole number of blocks
+    uint64_t num_pids = ( argc > 1 ) ? strtoull( argv[1], NULL, 0 ) : 1000;
+    uint64_t row_size = ( argc > 2 ) ? strtoull( argv[2], NULL, 0 ) : 1999;
+    uint64_t size = num_pids * row_size;
+
+    SparseHistogram histo;
+    histo.init( size );
+    std::vector<uint32_t> dense( size, 0 );
+
+    srand( 42 );
+
+    // Scattered Hits...
+    for ( uint32_t i = 0 ; i < 20000 ; i++ )
+    {
+        uint64_t c = ( ( (uint64_t) rand() << 31 ) | rand() ) % size;
+        histo.increment( c );
+        dense[c]++;
+    }
+
+    printf( "Scattered: %llu of %llu blocks dense, %llu bytes"
+        " (vs. %llu dense)\n",
+        (unsigned long long) histo.denseBlocks(),
+        (unsigned long long) ( ( size + SparseHistogram::BLOCK_MASK )
+            >> SparseHistogram::BLOCK_SHIFT ),
+        (unsigned long long) histo.memoryUsed(),
+        (unsigned long long) ( size * sizeof(uint32_t) ) );
+
+    check( histo, dense, row_size );
+
+    // Hot Spot: a Tenth of the Pixels, Near the Peak TOF...
+    for ( uint32_t i = 0 ; i < 2000000 ; i++ )
+    {
+        uint64_t pid = num_pids / 3 + rand() % ( num_pids / 10 + 1 );
+        uint64_t bin = row_size / 2 + rand() % ( row_size / 4 + 1 )
+            - row_size / 8;
+        uint64_t c = pid * row_size + bin;
+        if ( c >= size )
+            continue;
+        histo.increment( c );
+        dense[c]++;
+    }
+
+    printf( "Hot spot:  %llu of %llu blocks dense, %llu bytes"
+        " (vs. %llu dense)\n",
+        (unsigned long long) histo.denseBlocks(),
+        (unsigned long long) ( ( size + SparseHistogram::BLOCK_MASK )
+            >> SparseHistogram::BLOCK_SHIFT ),
+        (unsigned long long) histo.memoryUsed(),
+        (unsigned long long) ( size * sizeof(uint32_t) ) );
+
+    check( histo, dense, row_size );
+
+    // Whole Counts at Once, As Stitched from Partial Translations...
+    for ( uint32_t i = 0 ; i < 50000 ; i++ )
+    {
+        uint64_t c = ( ( (uint64_t) rand() << 31 ) | rand() ) % size;
+        uint32_t n = 1 + rand() % 1000;
+        histo.add( c, n );
+        dense[c] += n;
+    }
+
+    check( histo, dense, row_size );
+
+    // Last Cell, Re-Init Clears...
+    histo.increment( size - 1 );
+    dense[ size - 1 ]++;
+    check( histo, dense, row_size );
+
+    histo.init( size );
+    if ( histo.denseBlocks() || histo.get( size - 1 ) )
+        fail( "init", size - 1, histo.get( size - 1 ), 0 );
+
+    if ( failures )
+    {
+        printf( "%llu failures\n", (unsigned long long) failures );
+        return 1;
+    }
+
+    printf( "All histogram counts identical to a dense array.\n" );
+
+    return 0;
+}
+
+// vim: expandtab
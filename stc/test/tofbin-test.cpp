@@ -0,0 +1,179 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "TofBinDivider.h"
+
+/* Checks that STC::TofBinDivider bins exactly like the integer divide
+ * it replaces in StreamParser (tofbin = ( tof - tofOffset ) / binSize):
+ *
+ *   - every uint32_t numerator, for a set of bin sizes covering the
+ *     shift, 32-bit magic and 33-bit ("add") magic cases, plus typical
+ *     histogram bin sizes (or just the bin sizes given as arguments);
+ *   - numerators around every multiple and the top of the range, for
+ *     every bin size below 2^16 and a spread of larger ones;
+ *   - every lookup table entry, for every table range and bin size.
+ *
+ * The reference quotient for the exhaustive sweeps is kept by counting,
+ * rather than dividing, so a full 2^32 sweep takes seconds.
+ */
+
+using STC::TofBinDivider;
+
+static uint64_t failures = 0;
+
+static void fail( uint32_t d, uint32_t n, uint32_t got, uint32_t want,
+        const char *what )
+{
+    if ( failures++ < 20 )
+    {
+        fprintf( stderr, "FAIL: %s: %u / %u = %u, got %u\n",
+            what, n, d, want, got );
+    }
+}
+
+/// Every uint32_t numerator against a counted quotient
+static void exhaustive( uint32_t d )
+{
+    TofBinDivider div;
+    div.init( d );
+
+    uint32_t q = 0, r = 0;
+    uint32_t n = 0;
+
+    do
+    {
+        uint32_t got = div.divide( n );
+        if ( got != q )
+            fail( d, n, got, q, "exhaustive" );
+
+        if ( ++r == d )
+        {
+            r = 0;
+            q++;
+        }
+    }
+    while ( ++n != 0 );
+
+    printf( "  bin size %10u: all 2^32 TOFs match\n", d );
+}
+
+/// Numerators around the multiples of d (and the top of the range)
+static void edges( uint32_t d, uint32_t max_multiples )
+{
+    TofBinDivider div;
+    div.init( d );
+
+    uint64_t step = d;
+    if ( ( 0x100000000ULL / d ) > max_multiples )
+        step = ( 0x100000000ULL / max_multiples / d ) * d;
+
+    for ( uint64_t m = 0 ; m <= 0xFFFFFFFFULL ; m += step )
+    {
+        for ( int k = -1 ; k <= 1 ; k++ )
+        {
+            int64_t n = (int64_t) m + k;
+            if ( n < 0 || n > 0xFFFFFFFFLL )
+                continue;
+            uint32_t got = div.divide( (uint32_t) n );
+            if ( got != (uint32_t) n / d )
+                fail( d, (uint32_t) n, got, (uint32_t) n / d, "edges" );
+        }
+    }
+
+    for ( uint32_t k = 0 ; k < 4 ; k++ )
+    {
+        uint32_t n = 0xFFFFFFFF - k;
+        uint32_t got = div.divide( n );
+        if ( got != n / d )
+            fail( d, n, got, n / d, "top" );
+    }
+}
+
+int main( int argc, char **argv )
+{
+    // Shift (1, powers of two), 32-bit magic (3, 5, 10, ...), 33-bit
+    // "add" magic (7, 641, ...), common histogram bin sizes, and
+    // extremes...
+    static const uint32_t default_divs[] = {
+        1, 2, 3, 7, 10, 16, 100, 641, 1000, 16666,
+        0x7FFFFFFF, 0x80000001, 0xFFFFFFFF
+    };
+
+    printf( "Exhaustive 2^32 TOF sweep:\n" );
+
+    if ( argc > 1 )
+    {
+        for ( int i = 1 ; i < argc ; i++ )
+        {
+            uint32_t d = strtoul( argv[i], NULL, 0 );
+            if ( d )
+                exhaustive( d );
+        }
+    }
+    else
+    {
+        for ( size_t i = 0 ;
+                i < sizeof(default_divs) / sizeof(default_divs[0]) ; i++ )
+        {
+            exhaustive( default_divs[i] );
+        }
+    }
+
+    printf( "Multiple edges, all bin sizes < 2^16 and a spread above:\n" );
+
+    for ( uint32_t d = 1 ; d < 0x10000 ; d++ )
+        edges( d, 4096 );
+
+    for ( uint64_t d = 0x10000 ; d <= 0xFFFFFFFFULL ; d = d * 17 / 16 + 1 )
+        edges( (uint32_t) d, 4096 );
+
+    printf( "Lookup tables, all ranges and bin sizes up to %u:\n",
+        (uint32_t) TofBinDivider::MAX_TABLE_RANGE );
+
+    static const uint32_t ranges[] = { 1, 2, 100, 1000, 4095,
+        TofBinDivider::MAX_TABLE_RANGE };
+
+    for ( size_t r = 0 ; r < sizeof(ranges) / sizeof(ranges[0]) ; r++ )
+    {
+        for ( uint32_t d = 1 ; d <= TofBinDivider::MAX_TABLE_RANGE ; d++ )
+        {
+            TofBinDivider div;
+            div.init( d, ranges[r] );
+            if ( !div.hasTable() )
+                fail( d, ranges[r], 0, 1, "table missing" );
+
+            // Past the end of the table falls back to the multiply
+            for ( uint32_t n = 0 ; n < ranges[r] + 2 * d ; n++ )
+            {
+                uint32_t got = div.divide( n );
+                if ( got != n / d )
+                    fail( d, n, got, n / d, "table" );
+            }
+        }
+    }
+
+    // Too Big for a Table...
+    TofBinDivider big;
+    big.init( 10, TofBinDivider::MAX_TABLE_RANGE + 1 );
+    if ( big.hasTable() )
+        fail( 10, TofBinDivider::MAX_TABLE_RANGE + 1, 1, 0, "table too big" );
+
+    // Zero Bin Size Bins Everything Out of Range (Instead of SIGFPE)
+    TofBinDivider zero;
+    zero.init( 0, 100 );
+    if ( zero.divide( 0 ) != 0xFFFFFFFF || zero.divide( 12345 ) != 0xFFFFFFFF )
+        fail( 0, 12345, zero.divide( 12345 ), 0xFFFFFFFF, "zero bin size" );
+
+    if ( failures )
+    {
+        printf( "%llu failures\n", (unsigned long long) failures );
+        return 1;
+    }
+
+    printf( "All bin assignments identical to integer division.\n" );
+
+    return 0;
+}
+
+// vim: expandtab
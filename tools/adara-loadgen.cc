@@ -0,0 +1,577 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <math.h>
+
+#include <boost/program_options.hpp>
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+
+#include "ADARA.h"
+#include "PulseGenerator.h"
+
+/* adara-loadgen is a high-rate stand-in for the detector preprocessors
+ * (and optionally pvsd) for SMS load and integration testing.
+ *
+ * Unlike adara-gen, nothing is generated on the send path: each source
+ * builds a pool of complete pulses (RTDL plus raw event packets) up
+ * front, and its sender thread only patches the timestamps, cycle and
+ * sequence numbers into the next pooled pulse before writing it out.
+ * Pulses are paced against absolute deadlines on CLOCK_MONOTONIC, so
+ * the requested rate holds without drift; a source that can't keep up
+ * sends back-to-back and reports the pulses it was late on.
+ *
+ * Each source listens on its own port (base port + index), just like a
+ * preprocessor; point the SMS data sources at them. Every source uses
+ * the same pulse clock so the SMS sees matching pulse ids. An optional
+ * PV source sends a pvsd-style device descriptor and a stream of
+ * variable updates, with periodic update storms.
+ */
+
+namespace po = boost::program_options;
+
+static uint16_t base_port = 31416;
+static double pulse_hz = 60.0;
+static double event_rate = 0;
+static uint32_t num_pixels = 4096;
+static std::string pixelmap_path;
+static ADARA::PulseGenerator::Config gen;
+static uint16_t pv_port = 0;
+static uint32_t num_pvs = 100;
+static double pv_rate = 1.0;
+static double storm_interval = 0;
+static uint32_t storm_updates = 10000;
+static double duration = 0;
+static bool stats = false;
+static bool verbose = false;
+
+static uint64_t pulse_ns;
+static struct timespec start_mono;
+static struct timespec start_real;
+
+static volatile bool stopping = false;
+
+static uint64_t ts_ns(const struct timespec &ts)
+{
+	return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static struct timespec ns_ts(uint64_t ns)
+{
+	struct timespec ts;
+	ts.tv_sec = ns / 1000000000ULL;
+	ts.tv_nsec = ns % 1000000000ULL;
+	return ts;
+}
+
+/* The Source class owns one preprocessor stand-in: its listening
+ * socket, its pool of pre-built pulses and its sender thread.
+ */
+class Source {
+public:
+	Source(uint32_t index) :
+		m_port(base_port + index), m_events(0), m_pulses(0),
+		m_bytes(0), m_late(0), m_gen(gen, index), m_listen(-1)
+	{ }
+
+	/* Bind before any thread starts, so failures reach main() */
+	void listen(void);
+
+	void start(void) {
+		m_thread = boost::thread(boost::bind(&Source::run, this));
+	}
+
+	void join(void) { m_thread.join(); }
+
+	uint16_t	m_port;
+
+	/* Updated by the sender thread, read by the stats thread */
+	volatile uint64_t	m_events;
+	volatile uint64_t	m_pulses;
+	volatile uint64_t	m_bytes;
+	volatile uint64_t	m_late;
+
+private:
+	ADARA::PulseGenerator	m_gen;
+	int		m_listen;
+	boost::thread	m_thread;
+
+	bool writeAll(int fd, const void *buf, size_t len) {
+		const uint8_t *p = (const uint8_t *) buf;
+		while (len) {
+			ssize_t rc = write(fd, p, len);
+			if (rc < 0) {
+				if (errno == EINTR)
+					continue;
+				return false;
+			}
+			p += rc;
+			len -= rc;
+		}
+		return true;
+	}
+
+	void stream(int fd) {
+		struct timespec now;
+
+		/* Join the shared pulse clock at the next pulse */
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		uint64_t pulse = ( ts_ns(now) - ts_ns(start_mono) ) / pulse_ns + 1;
+
+		while (!stopping) {
+			uint64_t deadline = ts_ns(start_mono) + pulse * pulse_ns;
+			struct timespec dl = ns_ts(deadline);
+
+			clock_gettime(CLOCK_MONOTONIC, &now);
+			if (ts_ns(now) > deadline + pulse_ns)
+				m_late++;
+			else
+				clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME,
+					&dl, NULL);
+
+			const std::vector<uint32_t> &words = m_gen.pulse(pulse,
+				ts_ns(start_real) + pulse * pulse_ns);
+
+			size_t len = words.size() * sizeof(uint32_t);
+			if (!writeAll(fd, &words[0], len))
+				return;
+
+			m_events += m_gen.events();
+			m_bytes += len;
+			m_pulses++;
+			pulse++;
+		}
+	}
+
+	void run(void);
+};
+
+static int listenOn(uint16_t port)
+{
+	struct sockaddr_in addr;
+	int fd, val = 1;
+
+	fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (fd < 0)
+		throw std::runtime_error("Unable to create socket");
+
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &val, sizeof(val));
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	addr.sin_port = htons(port);
+
+	if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) || listen(fd, 4)) {
+		std::stringstream ss;
+		ss << "Unable to listen on port " << port << ": "
+			<< strerror(errno);
+		close(fd);
+		throw std::runtime_error(ss.str());
+	}
+
+	return fd;
+}
+
+static int acceptOne(int listen_fd, uint16_t port)
+{
+	int fd = accept(listen_fd, NULL, NULL);
+	if (fd < 0)
+		return -1;
+
+	int val = 1;
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &val, sizeof(val));
+
+	if (verbose)
+		std::cerr << "Port " << port << " connected" << std::endl;
+	return fd;
+}
+
+void Source::listen(void)
+{
+	m_listen = listenOn(m_port);
+}
+
+void Source::run(void)
+{
+	while (!stopping) {
+		int fd = acceptOne(m_listen, m_port);
+		if (fd < 0)
+			continue;
+
+		stream(fd);
+		close(fd);
+
+		if (verbose)
+			std::cerr << "Port " << m_port << " disconnected"
+				<< std::endl;
+	}
+}
+
+/* The PVSource stands in for pvsd: one device with num_pvs double PVs,
+ * each updated pv_rate times a second, plus a storm of storm_updates
+ * back-to-back updates every storm_interval seconds.
+ */
+class PVSource {
+public:
+	PVSource() : m_updates(0), m_storms(0), m_listen(-1) { }
+
+	void listen(void) { m_listen = listenOn(pv_port); }
+
+	void start(void) {
+		m_thread = boost::thread(boost::bind(&PVSource::run, this));
+	}
+
+	volatile uint64_t	m_updates;
+	volatile uint64_t	m_storms;
+
+private:
+	int		m_listen;
+	boost::thread	m_thread;
+
+	enum { DEV_ID = 1 };
+
+	void descriptor(std::vector<uint32_t> &out) {
+		std::stringstream ddp;
+
+		ddp << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+		ddp << "<device"
+			<< " xmlns=\"http://public.sns.gov/schema/device.xsd\""
+			<< " xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\""
+			<< " xsi:schemaLocation=\"http://public.sns.gov/schema/device.xsd"
+			<< " http://public.sns.gov/schema/device.xsd\">\n";
+		ddp << "<device_name>LoadGen</device_name>\n";
+		ddp << "<process_variables>\n";
+		for (uint32_t i = 1; i <= num_pvs; i++) {
+			ddp << "    <process_variable>\n";
+			ddp << "        <pv_name>LoadGen:PV" << i << "</pv_name>\n";
+			ddp << "        <pv_id>" << i << "</pv_id>\n";
+			ddp << "        <pv_type>double</pv_type>\n";
+			ddp << "    </process_variable>\n";
+		}
+		ddp << "</process_variables>\n";
+		ddp << "</device>\n";
+
+		std::string xml = ddp.str();
+		uint32_t words = ( xml.size() + 3 ) / 4;
+		struct timespec now;
+		clock_gettime(CLOCK_REALTIME, &now);
+
+		out.push_back(8 + words * 4);
+		out.push_back(ADARA_PKT_TYPE(
+			ADARA::PacketType::DEVICE_DESC_TYPE,
+			ADARA::PacketType::DEVICE_DESC_VERSION));
+		out.push_back(now.tv_sec - ADARA::EPICS_EPOCH_OFFSET);
+		out.push_back(now.tv_nsec);
+		out.push_back(DEV_ID);
+		out.push_back(xml.size());
+
+		size_t at = out.size();
+		out.resize(at + words, 0);
+		memcpy(&out[at], xml.data(), xml.size());
+	}
+
+	void update(std::vector<uint32_t> &out, uint32_t pv, double value,
+			const struct timespec &now) {
+		out.push_back(20);
+		out.push_back(ADARA_PKT_TYPE(
+			ADARA::PacketType::VAR_VALUE_DOUBLE_TYPE,
+			ADARA::PacketType::VAR_VALUE_DOUBLE_VERSION));
+		out.push_back(now.tv_sec - ADARA::EPICS_EPOCH_OFFSET);
+		out.push_back(now.tv_nsec);
+		out.push_back(DEV_ID);
+		out.push_back(pv);
+		out.push_back(0);	// status/severity
+
+		size_t at = out.size();
+		out.resize(at + 2);
+		memcpy(&out[at], &value, sizeof(double));
+	}
+
+	bool send(int fd, std::vector<uint32_t> &buf) {
+		const uint8_t *p = (const uint8_t *) &buf[0];
+		size_t len = buf.size() * sizeof(uint32_t);
+		buf.clear();
+		while (len) {
+			ssize_t rc = write(fd, p, len);
+			if (rc < 0) {
+				if (errno == EINTR)
+					continue;
+				return false;
+			}
+			p += rc;
+			len -= rc;
+		}
+		return true;
+	}
+
+	void stream(int fd) {
+		/* Updates are spread over 100 ticks a second */
+		const uint64_t tick_ns = 10000000ULL;
+		double per_tick = num_pvs * pv_rate / 100.0, owed = 0;
+		uint32_t next_pv = 0;
+		uint64_t tick = 0, storm_ticks = 0;
+		std::vector<uint32_t> buf;
+		struct timespec base, now;
+		ADARA::XorShift rng(0x9f5eedULL);
+
+		if (storm_interval > 0)
+			storm_ticks = (uint64_t) ( storm_interval * 100 );
+
+		descriptor(buf);
+		if (!send(fd, buf))
+			return;
+
+		clock_gettime(CLOCK_MONOTONIC, &base);
+
+		while (!stopping) {
+			struct timespec dl = ns_ts(ts_ns(base) + ++tick * tick_ns);
+			clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &dl, NULL);
+			clock_gettime(CLOCK_REALTIME, &now);
+
+			uint32_t n = 0;
+			for (owed += per_tick; owed >= 1.0; owed -= 1.0, n++)
+				;
+			if (storm_ticks && !( tick % storm_ticks )) {
+				n += storm_updates;
+				m_storms++;
+			}
+
+			while (n--) {
+				update(buf, next_pv + 1, rng.uniform() * 100.0, now);
+				next_pv = ( next_pv + 1 ) % num_pvs;
+				m_updates++;
+			}
+
+			if (!buf.empty() && !send(fd, buf))
+				return;
+		}
+	}
+
+	void run(void) {
+		while (!stopping) {
+			int fd = acceptOne(m_listen, pv_port);
+			if (fd < 0)
+				continue;
+
+			stream(fd);
+			close(fd);
+		}
+	}
+};
+
+static void parse_options(int argc, char **argv)
+{
+	po::options_description desc("Allowed options");
+	desc.add_options()
+		("help,h", "Show usage information")
+		("port,p", po::value<uint16_t>(&base_port),
+				"First listening port; source N uses port + N")
+		("sources,s", po::value<uint32_t>(&gen.m_sources),
+				"Number of preprocessor sources")
+		("hz,r", po::value<double>(&pulse_hz), "Pulse rate")
+		("rate,R", po::value<double>(&event_rate),
+				"Target neutron events/s over all sources"
+				" (overrides --events)")
+		("events,e", po::value<uint32_t>(&gen.m_eventsPerPulse),
+				"Neutron events per pulse over all sources")
+		("max-packet", po::value<uint32_t>(&gen.m_maxPacket),
+				"Maximum raw event packet size in bytes")
+		("pool", po::value<uint32_t>(&gen.m_poolPulses),
+				"Pre-built pulses per source")
+		("pixelmap", po::value<std::string>(&pixelmap_path),
+				"Draw physical pixel ids from this SMS pixel map")
+		("pixels,P", po::value<uint32_t>(&num_pixels),
+				"Pixel ids 0..N-1 (without --pixelmap)")
+		("unmapped", po::value<double>(&gen.m_unmappedFraction),
+				"Fraction of events with ids outside the map")
+		("tof-dist", po::value<std::string>(&gen.m_tofDist),
+				"TOF distribution: moderator or uniform")
+		("mintof,t", po::value<double>(&gen.m_minTOF),
+				"Minimum time-of-flight (s)")
+		("maxtof,T", po::value<double>(&gen.m_maxTOF),
+				"Maximum time-of-flight (s)")
+		("monitors,m", po::value<uint32_t>(&gen.m_monitors),
+				"Number of beam monitors")
+		("mevents,M", po::value<uint32_t>(&gen.m_monitorEvents),
+				"Events per beam monitor per pulse")
+		("choppers,c", po::value<uint32_t>(&gen.m_choppers),
+				"Number of choppers")
+		("cevents,C", po::value<uint32_t>(&gen.m_chopperEvents),
+				"Events per chopper per pulse")
+		("fastmeta", po::value<uint32_t>(&gen.m_fastMetaDevices),
+				"Number of fast metadata devices")
+		("fevents", po::value<uint32_t>(&gen.m_fastMetaEvents),
+				"Events per fast metadata device per pulse")
+		("pv-port", po::value<uint16_t>(&pv_port),
+				"Also serve a pvsd stand-in on this port")
+		("pvs", po::value<uint32_t>(&num_pvs), "Number of PVs")
+		("pv-rate", po::value<double>(&pv_rate),
+				"Updates per second per PV")
+		("storm-interval", po::value<double>(&storm_interval),
+				"Seconds between PV update storms (0 = none)")
+		("storm-updates", po::value<uint32_t>(&storm_updates),
+				"Updates per PV storm")
+		("duration,d", po::value<double>(&duration),
+				"Exit after this many seconds (0 = run forever)")
+		("stats", po::bool_switch(&stats),
+				"Print rates every second")
+		("verbose,v", po::bool_switch(&verbose),
+				"Add verbose output");
+
+	po::variables_map vm;
+	try {
+		po::store(po::parse_command_line(argc, argv, desc), vm);
+		po::notify(vm);
+	} catch (po::error &e) {
+		std::cerr << argv[0] << ": " << e.what() << std::endl
+			<< std::endl << desc << std::endl;
+		exit(2);
+	}
+
+	if (vm.count("help")) {
+		std::cerr << desc << std::endl;
+		exit(2);
+	}
+
+	if (pulse_hz <= 0 || !gen.m_sources || !gen.m_poolPulses) {
+		std::cerr << argv[0] << ": hz, sources and pool must be non-zero"
+			<< std::endl;
+		exit(2);
+	}
+
+	if (gen.m_minTOF >= gen.m_maxTOF) {
+		std::cerr << argv[0] << ": mintof must be less than maxtof"
+			<< std::endl;
+		exit(2);
+	}
+
+	if (gen.m_maxPacket < 256)
+		gen.m_maxPacket = 256;
+
+	if (event_rate > 0) {
+		gen.m_eventsPerPulse =
+			(uint32_t) ( event_rate / pulse_hz + 0.5 );
+	}
+
+	pulse_ns = (uint64_t) ( 1e9 / pulse_hz );
+	gen.m_pulseNs = pulse_ns;
+
+	if (!pixelmap_path.empty()) {
+		try {
+			ADARA::PulseGenerator::loadPixelMap(pixelmap_path,
+				gen.m_pixels);
+		} catch (std::exception &e) {
+			std::cerr << argv[0] << ": " << e.what() << std::endl;
+			exit(2);
+		}
+	}
+	else {
+		for (uint32_t i = 0; i < num_pixels; i++)
+			gen.m_pixels.push_back(i);
+	}
+	if (gen.m_pixels.empty()) {
+		std::cerr << argv[0] << ": need at least one pixel" << std::endl;
+		exit(2);
+	}
+}
+
+static void block_signals(void)
+{
+	sigset_t sigset;
+
+	sigemptyset(&sigset);
+	sigaddset(&sigset, SIGPIPE);
+	pthread_sigmask(SIG_BLOCK, &sigset, NULL);
+}
+
+int main(int argc, char **argv)
+{
+	parse_options(argc, argv);
+
+	block_signals();
+
+	clock_gettime(CLOCK_MONOTONIC, &start_mono);
+	clock_gettime(CLOCK_REALTIME, &start_real);
+
+	std::vector<Source *> sources;
+	PVSource *pv = NULL;
+	try {
+		for (uint32_t i = 0; i < gen.m_sources; i++) {
+			sources.push_back(new Source(i));
+			sources.back()->listen();
+		}
+		if (pv_port) {
+			pv = new PVSource;
+			pv->listen();
+		}
+	} catch (std::exception &e) {
+		std::cerr << argv[0] << ": " << e.what() << std::endl;
+		return 1;
+	}
+
+	std::cerr << "Serving " << gen.m_sources << " source(s) on ports "
+		<< base_port << "-" << ( base_port + gen.m_sources - 1 )
+		<< ", " << gen.m_eventsPerPulse << " events/pulse at "
+		<< pulse_hz << " Hz (" << gen.m_eventsPerPulse * pulse_hz
+		<< " events/s)"
+		<< std::endl;
+
+	for (uint32_t i = 0; i < sources.size(); i++)
+		sources[i]->start();
+
+	if (pv) {
+		pv->start();
+		std::cerr << "Serving " << num_pvs << " PVs on port " << pv_port
+			<< std::endl;
+	}
+
+	uint64_t last_events = 0, last_bytes = 0, last_updates = 0;
+	double elapsed = 0;
+
+	while (!duration || elapsed < duration) {
+		sleep(1);
+		elapsed += 1.0;
+
+		if (!stats)
+			continue;
+
+		uint64_t events = 0, bytes = 0, late = 0;
+		for (uint32_t i = 0; i < sources.size(); i++) {
+			events += sources[i]->m_events;
+			bytes += sources[i]->m_bytes;
+			late += sources[i]->m_late;
+		}
+		uint64_t updates = pv ? pv->m_updates : 0;
+
+		fprintf(stderr, "%.0fs: %.3f Mevents/s %.1f MB/s late %lu"
+			" pv %lu/s\n", elapsed,
+			( events - last_events ) / 1e6,
+			( bytes - last_bytes ) / 1e6, late,
+			updates - last_updates);
+
+		last_events = events;
+		last_bytes = bytes;
+		last_updates = updates;
+	}
+
+	/* The sender threads are blocked in accept()/write(), just go */
+	stopping = true;
+	return 0;
+}
@@ -4,19 +4,34 @@
 #include <errno.h>
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <vector>
+#include <deque>
+#include <map>
 
 #include "ADARA.h"
 #include "ADARAPackets.h"
 #include "POSIXParser.h"
 #include "ADARAUtils.h"
+#include "ADARAPulseIndex.h"
 
 /// This sets the size of the ADARA parser stream buffer in bytes
 #define ADARA_IN_BUF_SIZE   0x3000000  // For Old "Direct" PixelMap Pkt!
 
 #define MAX_DEVICE_ID   100
 
+/// Default size of the packet-aligned blocks handed to pipeline workers
+#define MUNGE_BLOCK_SIZE   ( 4 * 1024 * 1024 )
+
+/// SMS data files compressed in the background start with an LZ4 frame
+/// (see sms/CompressedFile.h); no ADARA packet header ever looks like it
+#define MUNGE_LZ4_MAGIC   0x184D2204
+
 #include <boost/program_options.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
 
 namespace po = boost::program_options;
 
@@ -140,8 +155,9 @@ static const char *dataFlags(uint32_t flags)
 
 class MungeParser : public ADARA::POSIXParser {
 public:
-	MungeParser() :
-		ADARA::POSIXParser(ADARA_IN_BUF_SIZE, ADARA_IN_BUF_SIZE),
+	explicit MungeParser( std::ostream &out = std::cout,
+			unsigned int buf_size = ADARA_IN_BUF_SIZE ) :
+		ADARA::POSIXParser(buf_size, ADARA_IN_BUF_SIZE),
 		m_run_start_epoch(0),
 		m_addendum_file_number(0), m_addendum(false),
 		m_pause_file_number(0), m_paused(false),
@@ -158,7 +174,9 @@ public:
 		m_clearemptydata(false),
 		m_posixRead(false), m_showDDP(false), m_lowRate(false),
 		m_terse(false), m_catch(false),
-		m_out(std::cout),
+		m_seekPulse(0),
+		m_threads(1), m_blockSize(MUNGE_BLOCK_SIZE), m_worker(false),
+		m_out(out),
 		m_save_count(0),
 		m_skip_count(0)
 	{
@@ -183,6 +201,12 @@ public:
 
 	void read_file(int fd);
 
+	// Pipelined Munging, for Transforms that Need No Sequential Context
+	const char *pipelineBlocker(void) const;
+	void pipeline_file(FILE *);
+	void copyConfig(const MungeParser &cfg);
+	uint32_t mungeBlock(const uint8_t *data, size_t len);
+
 	bool rxPacket(const ADARA::Packet &pkt);
 
 	bool rxUnknownPkt(const ADARA::Packet &pkt);
@@ -266,6 +290,12 @@ private:
 	bool m_terse;
 	bool m_catch;
 
+	uint64_t m_seekPulse;
+
+	uint32_t m_threads;
+	uint32_t m_blockSize;
+	bool m_worker;
+
 	std::ostream &m_out;
 
 	std::string m_save_file;
@@ -326,10 +356,13 @@ bool MungeParser::rxPacket(const ADARA::Packet &pkt)
 	{
 		if ( pkt.type() == m_skip_pkts[i] )
 		{
-			std::cerr << "[Skipping Packet Type " << pkt.type()
-				<< " (0x" << std::hex << pkt.type()
-					<< std::dec << ")"
-				<< "]" << std::endl;
+			// (Pipeline Workers Just Count Them, Lines Would Interleave)
+			if ( !m_worker ) {
+				std::cerr << "[Skipping Packet Type " << pkt.type()
+					<< " (0x" << std::hex << pkt.type()
+						<< std::dec << ")"
+					<< "]" << std::endl;
+			}
 			m_skip_pkt = true;
 		}
 	}
@@ -543,16 +576,25 @@ bool MungeParser::handleDataPkt(const ADARA::RawDataPkt *pkt,
 	if ( m_clearemptydata
 			&& pkt->num_events() == 0 && pkt->version() == 0 )
 	{
-		fprintf( stderr,
-			"*** ClearEmptyData pkt->num_events()=%d pkt->version()=%d\n",
-			pkt->num_events(), pkt->version() );
-
 		ADARA::RawDataPkt *PKT =
 			const_cast<ADARA::RawDataPkt*>(pkt);
-		fprintf( stderr, "Before PKT->version()=%d\n", PKT->version() );
-		PKT->remapVersion( (ADARA::PacketType::Version) 0x1 );
-		fprintf( stderr, "After PKT->version()=%d (pkt->version()=%d)\n",
-			PKT->version(), pkt->version() );
+
+		if ( m_worker ) {
+			PKT->remapVersion( (ADARA::PacketType::Version) 0x1 );
+		}
+		else {
+			fprintf( stderr,
+				"*** ClearEmptyData pkt->num_events()=%d"
+				" pkt->version()=%d\n",
+				pkt->num_events(), pkt->version() );
+
+			fprintf( stderr, "Before PKT->version()=%d\n",
+				PKT->version() );
+			PKT->remapVersion( (ADARA::PacketType::Version) 0x1 );
+			fprintf( stderr,
+				"After PKT->version()=%d (pkt->version()=%d)\n",
+				PKT->version(), pkt->version() );
+		}
 	}
 
 	// Save Last Packet Time as Potential "End of Run" Timestamp...
@@ -1942,10 +1984,51 @@ void MungeParser::parse_file(const std::string &name)
 		throw msg;
 	}
 
+	// We Don't Decompress, and Index Offsets are into the Original Stream
+	uint32_t magic;
+	if ( pread( fileno(f), &magic, sizeof(magic), 0 ) == sizeof(magic)
+			&& magic == MUNGE_LZ4_MAGIC ) {
+		fclose(f);
+		std::string msg("compressed SMS data file: ");
+		msg += name;
+		msg += " (decompress with \"lz4 -dc\" first";
+		if ( m_seekPulse )
+			msg += ", --seekpulse can't seek into it";
+		msg += ")";
+		throw msg;
+	}
+
+	// Skip Straight to the Requested Pulse, If the SMS Indexed This File
+	if ( m_seekPulse ) {
+		ADARA::PulseIndex index;
+		if ( index.open( ADARA::PulseIndex::sidecarPath( name ) ) ) {
+			uint64_t offset = index.seekPulse( m_seekPulse );
+			std::cerr << name << ": Seeking to Offset " << offset
+				<< " (" << index.numEntries() << " Index Entries)"
+				<< std::endl;
+			if ( fseeko( f, offset, SEEK_SET ) ) {
+				int e = errno;
+				fclose(f);
+				std::string msg("unable to seek: ");
+				msg += name;
+				msg += ": ";
+				msg += strerror(e);
+				throw msg;
+			}
+		}
+		else {
+			std::cerr << name << ": No Pulse Index, Reading Whole File"
+				<< std::endl;
+		}
+	}
+
 	try {
 		if ( m_posixRead ) {
 			read_file( fileno( stdin ) );
 		}
+		else if ( m_threads > 1 ) {
+			pipeline_file(f);
+		}
 		else {
 			parse_file(f);
 		}
@@ -1971,9 +2054,303 @@ void MungeParser::read_file(int fd)
 	while ( (len = read( fd, log_info )) );
 }
 
+//
+// Pipelined Munging (--threads N)
+//
+// A reader thread cuts the input stream into blocks of whole packets,
+// N worker threads each run the packet transforms over whole blocks
+// with their own MungeParser, and the calling thread writes the munged
+// blocks back out in input order. Only the per-packet transforms can
+// run this way; anything that needs to see the stream in order (run
+// status tracking, generated packets, device descriptor counting,
+// the per-packet dump...) makes us munge serially instead.
+//
+
+const char *MungeParser::pipelineBlocker(void) const
+{
+	if ( !m_terse )
+		return "Per-Packet Dump Needs Terse Mode (--terse)";
+	if ( m_showDDP )
+		return "Device Descriptor Dump (--showddp)";
+	if ( m_posixRead || m_lowRate )
+		return "POSIX read() Parsing (--posixread)";
+	if ( m_addRunEnd || m_genStart || m_genStop )
+		return "Run Status Tracking (--addrunend/--genstart/--genstop)";
+	if ( m_save_out.is_open() )
+		return "Saved Packets File (--savefile/--savepkts)";
+	if ( m_hysterical )
+		return "Hysterical Run Times (--hysterical)";
+	if ( m_case == 1 )
+		return "Munge Case 1 Counts Device Descriptors";
+
+	return NULL;
+}
+
+// Pipeline Workers Only Need the Per-Packet Transform Settings
+void MungeParser::copyConfig(const MungeParser &cfg)
+{
+	m_case = cfg.m_case;
+	m_skip_pkts = cfg.m_skip_pkts;
+	m_skipStart = cfg.m_skipStart;
+	m_skipStop = cfg.m_skipStop;
+	m_filterafter = cfg.m_filterafter;
+	m_filterbefore = cfg.m_filterbefore;
+	m_threshtime = cfg.m_threshtime;
+	m_clearemptydata = cfg.m_clearemptydata;
+	m_terse = cfg.m_terse;
+	m_catch = cfg.m_catch;
+	m_worker = true;
+
+	for ( uint32_t i=0 ;
+			i < ( sizeof(m_descriptor_count) / sizeof(uint32_t) ) ; i++ ) {
+		m_descriptor_count[i] = 0;
+	}
+}
+
+// Munge a Block of Whole Packets, Returns the Number Skipped
+uint32_t MungeParser::mungeBlock(const uint8_t *data, size_t len)
+{
+	uint32_t skipped = m_skip_count;
+
+	while ( len ) {
+		size_t chunk = bufferFillLength();
+		if ( chunk > len )
+			chunk = len;
+
+		memcpy( bufferFillAddress(), data, chunk );
+		bufferBytesAppended( (unsigned int) chunk );
+		data += chunk;
+		len -= chunk;
+
+		std::string log_info;
+		if ( bufferParse(log_info, 0) < 0 ) {
+			log_info.append("parse error");
+			throw log_info;
+		}
+	}
+
+	return( m_skip_count - skipped );
+}
+
+struct MungeBlock {
+	uint64_t seq;
+	std::vector<uint8_t> data;
+	std::string out;
+	uint32_t skipped;
+};
+
+typedef boost::shared_ptr<MungeBlock> MungeBlockPtr;
+
+class MungePipeline {
+public:
+	MungePipeline(const MungeParser &cfg, uint32_t threads,
+			uint32_t block_size) :
+		m_cfg(cfg), m_threads(threads), m_blockSize(block_size),
+		m_maxBlocks(2 * threads + 2), m_numBlocks(0), m_queued(0),
+		m_readDone(false)
+	{ }
+
+	void run(FILE *f, std::ostream &out, uint32_t &skipped);
+
+private:
+	const MungeParser &m_cfg;
+	uint32_t m_threads;
+	uint32_t m_blockSize;
+	uint32_t m_maxBlocks;
+
+	boost::mutex m_mutex;
+	boost::condition_variable m_workCond;	// m_work, m_readDone
+	boost::condition_variable m_doneCond;	// m_done, m_readDone
+	boost::condition_variable m_spaceCond;	// m_queued
+
+	std::deque<MungeBlockPtr> m_work;
+	std::map<uint64_t, MungeBlockPtr> m_done;
+	uint64_t m_numBlocks;
+	uint32_t m_queued;	// read, but not yet written out
+	bool m_readDone;
+	std::string m_error;
+
+	void reader(FILE *f);
+	void worker(void);
+	void fail(const std::string &msg);
+};
+
+void MungePipeline::fail(const std::string &msg)
+{
+	boost::unique_lock<boost::mutex> lock(m_mutex);
+	if ( m_error.empty() )
+		m_error = msg;
+	m_workCond.notify_all();
+	m_doneCond.notify_all();
+	m_spaceCond.notify_all();
+}
+
+// Length of the leading whole packets in buf, plus the length of the
+// first packet that isn't whole (or 0 if even its header isn't there)
+static size_t wholePackets(const std::vector<uint8_t> &buf, size_t &need)
+{
+	size_t off = 0;
+
+	need = 0;
+	while ( off + sizeof(ADARA::Header) <= buf.size() ) {
+		const ADARA::Header *hdr = (const ADARA::Header *) &buf[off];
+		size_t pkt_len = sizeof(ADARA::Header) + hdr->payload_len;
+		if ( off + pkt_len > buf.size() ) {
+			need = pkt_len;
+			break;
+		}
+		off += pkt_len;
+	}
+
+	return off;
+}
+
+void MungePipeline::reader(FILE *f)
+{
+	std::vector<uint8_t> carry;
+	bool eof = false;
+
+	try {
+		while ( !eof ) {
+			MungeBlockPtr b(new MungeBlock);
+			b->data.swap(carry);
+
+			size_t want = m_blockSize;
+			size_t end, need;
+			for (;;) {
+				size_t have = b->data.size();
+				b->data.resize(have + want);
+				size_t len = fread(&b->data[have], 1, want, f);
+				b->data.resize(have + len);
+				if ( len < want ) {
+					if ( ferror(f) )
+						throw std::string("read error");
+					eof = true;
+				}
+
+				end = wholePackets(b->data, need);
+				if ( end || eof )
+					break;
+
+				// One Packet Bigger Than a Block, Read the Rest of It...
+				if ( need > ADARA_IN_BUF_SIZE ) {
+					throw std::string("oversize packet,"
+						" try again without --threads");
+				}
+				want = need - b->data.size();
+			}
+
+			// Leave Any Partial Packet for the Next Block
+			// (At EOF it goes in the last block, same as parse_file())
+			if ( !eof ) {
+				carry.assign(b->data.begin() + end, b->data.end());
+				b->data.resize(end);
+			}
+
+			if ( b->data.empty() )
+				break;
+
+			boost::unique_lock<boost::mutex> lock(m_mutex);
+			while ( m_queued >= m_maxBlocks && m_error.empty() )
+				m_spaceCond.wait(lock);
+			if ( !m_error.empty() )
+				return;
+
+			b->seq = m_numBlocks++;
+			m_queued++;
+			m_work.push_back(b);
+			m_workCond.notify_one();
+		}
+	} catch ( std::string m ) {
+		fail(m);
+		return;
+	}
+
+	boost::unique_lock<boost::mutex> lock(m_mutex);
+	m_readDone = true;
+	m_workCond.notify_all();
+	m_doneCond.notify_all();
+}
+
+void MungePipeline::worker(void)
+{
+	std::ostringstream out;
+	MungeParser parser(out, m_blockSize + 65536);
+	parser.copyConfig(m_cfg);
+
+	for (;;) {
+		MungeBlockPtr b;
+		{
+			boost::unique_lock<boost::mutex> lock(m_mutex);
+			while ( m_work.empty() && !m_readDone && m_error.empty() )
+				m_workCond.wait(lock);
+			if ( m_work.empty() || !m_error.empty() )
+				return;
+			b = m_work.front();
+			m_work.pop_front();
+		}
+
+		try {
+			b->skipped = parser.mungeBlock(&b->data[0], b->data.size());
+		} catch ( std::string m ) {
+			fail(m);
+			return;
+		}
+
+		b->out = out.str();
+		out.str("");
+		std::vector<uint8_t>().swap(b->data);
+
+		boost::unique_lock<boost::mutex> lock(m_mutex);
+		m_done[b->seq] = b;
+		m_doneCond.notify_all();
+	}
+}
+
+void MungePipeline::run(FILE *f, std::ostream &out, uint32_t &skipped)
+{
+	boost::thread_group threads;
+
+	threads.create_thread(boost::bind(&MungePipeline::reader, this, f));
+	for ( uint32_t i=0 ; i < m_threads ; i++ )
+		threads.create_thread(boost::bind(&MungePipeline::worker, this));
+
+	// Ordered Writer...
+	for ( uint64_t next=0 ; ; next++ ) {
+		MungeBlockPtr b;
+		{
+			boost::unique_lock<boost::mutex> lock(m_mutex);
+			while ( !m_done.count(next) && m_error.empty()
+					&& !( m_readDone && next == m_numBlocks ) )
+				m_doneCond.wait(lock);
+			if ( !m_error.empty() || !m_done.count(next) )
+				break;
+			b = m_done[next];
+			m_done.erase(next);
+			m_queued--;
+			m_spaceCond.notify_one();
+		}
+
+		out.write( b->out.data(), b->out.size() );
+		skipped += b->skipped;
+	}
+
+	threads.join_all();
+
+	if ( !m_error.empty() )
+		throw m_error;
+}
+
+void MungeParser::pipeline_file(FILE *f)
+{
+	MungePipeline pipeline(*this, m_threads, m_blockSize);
+	pipeline.run(f, m_out, m_skip_count);
+}
+
 void MungeParser::parse(int argc, char **argv)
 {
 	std::string m_threshtime_str;
+	std::string m_seekpulse_str;
 	std::string m_starttime_str;
 	std::string m_runstart_str;
 	std::string m_runstop_str;
@@ -2014,8 +2391,14 @@ void MungeParser::parse(int argc, char **argv)
 		("filterbefore,B", "Filter Data Stream to Before Threshold Time")
 		("threshtime", po::value<std::string>(&m_threshtime_str),
 			"Filter Threshold Time for Data Stream")
+		("seekpulse", po::value<std::string>(&m_seekpulse_str),
+			"Start Each File at This Pulse (sec.nsec), via .pidx Index")
 		("clearemptydata",
 			"Clear Empty Data Packets to Zero Proton Charge")
+		("threads,j", po::value<uint32_t>(&m_threads),
+			"Munge with N Worker Threads (Per-Packet Transforms Only)")
+		("blocksize", po::value<uint32_t>(&m_blockSize),
+			"Bytes of Packets per Worker Thread Block")
 		("case", po::value<uint32_t>(&m_case),
 			"Which Munge Case We Are Executing... (1,2,3...)");
 
@@ -2174,6 +2557,19 @@ void MungeParser::parse(int argc, char **argv)
 		}
 	}
 
+	if ( m_seekpulse_str.size() ) {
+		size_t dot = m_seekpulse_str.find(".");
+		uint64_t sec = boost::lexical_cast<uint32_t>(
+			m_seekpulse_str.substr(0, dot) );
+		uint64_t nsec = ( dot != std::string::npos )
+			? boost::lexical_cast<uint32_t>(
+				m_seekpulse_str.substr(dot + 1) ) : 0;
+		m_seekPulse = ( sec << 32 ) | nsec;
+		std::cerr << "Seek to Pulse Requested as: "
+			<< m_seekpulse_str << " -> pulse=0x"
+			<< std::hex << m_seekPulse << std::dec << std::endl;
+	}
+
 	m_clearemptydata = vm.count("clearemptydata");
 
 	m_posixRead = vm.count("posixread");
@@ -2188,11 +2584,30 @@ void MungeParser::parse(int argc, char **argv)
 		m_descriptor_count[i] = 0;
 	}
 
+	// Pipelined Munging Requested? Only If Nothing Needs Serial Context...
+	if ( m_threads > 1 ) {
+		const char *blocker = pipelineBlocker();
+		if ( blocker ) {
+			std::cerr << "Munging Serially, Not with " << m_threads
+				<< " Threads: " << blocker << std::endl;
+			m_threads = 1;
+		}
+		else {
+			if ( m_blockSize < 65536 )
+				m_blockSize = 65536;
+			std::cerr << "Munging with " << m_threads << " Threads, "
+				<< m_blockSize << " Byte Blocks." << std::endl;
+		}
+	}
+
 	if (!vm.count("file")) {
 		try {
 			if ( m_posixRead ) {
 				read_file( fileno( stdin ) );
 			}
+			else if ( m_threads > 1 ) {
+				pipeline_file(stdin);
+			}
 			else {
 				parse_file(stdin);
 			}
@@ -203,6 +203,7 @@ public:
 	bool rxPacket(const ADARA::BeamlineInfoPkt &pkt);
 	bool rxPacket(const ADARA::BeamMonitorConfigPkt &pkt);
 	bool rxPacket(const ADARA::DetectorBankSetsPkt &pkt);
+	bool rxPacket(const ADARA::HistoPreviewPkt &pkt);
 	bool rxPacket(const ADARA::DataDonePkt &pkt);
 	bool rxPacket(const ADARA::DeviceDescriptorPkt &pkt);
 	bool rxPacket(const ADARA::VariableU32Pkt &pkt);
@@ -893,7 +894,34 @@ bool Parser::rxPacket(const ADARA::ClientHelloPkt &pkt)
 			printf("NO_PAUSE_DATA");
 		else
 			printf("PAUSE_AGNOSTIC");
+		if ( clientFlags & ADARA::ClientHelloPkt::METADATA_ONLY )
+			printf(" METADATA_ONLY");
+		if ( clientFlags & ADARA::ClientHelloPkt::FILTER_PKT_TYPES )
+			printf(" FILTER_PKT_TYPES");
+		if ( clientFlags & ADARA::ClientHelloPkt::FILTER_BANKS )
+			printf(" FILTER_BANKS");
+		if ( clientFlags & ADARA::ClientHelloPkt::DECIMATE_EVENTS )
+			printf(" DECIMATE_EVENTS");
+		if ( clientFlags & ADARA::ClientHelloPkt::HISTO_PREVIEW )
+			printf(" HISTO_PREVIEW");
 		printf("]\n");
+		if ( clientFlags & ADARA::ClientHelloPkt::DECIMATE_EVENTS )
+			printf("    Events from 1-in-%u pulses\n",
+				pkt.eventDecimation());
+		const std::vector<uint32_t> &types = pkt.packetTypes();
+		if ( types.size() ) {
+			printf("    Packet Types:");
+			for (uint32_t i = 0; i < types.size(); i++)
+				printf(" 0x%x", types[i]);
+			printf("\n");
+		}
+		const std::vector<uint32_t> &banks = pkt.detectorBanks();
+		if ( banks.size() ) {
+			printf("    Detector Banks:");
+			for (uint32_t i = 0; i < banks.size(); i++)
+				printf(" %d", (int32_t) banks[i]);
+			printf("\n");
+		}
 	}
 
 	return false;
@@ -1027,6 +1055,34 @@ bool Parser::rxPacket(const ADARA::DetectorBankSetsPkt &pkt)
 	return false;
 }
 
+bool Parser::rxPacket(const ADARA::HistoPreviewPkt &pkt)
+{
+	if ( !m_terse ) {
+		printf("%u.%09u HISTO PREVIEW (0x%x,v%u) [%u bytes]\n"
+			"    %u pulses, %u events (1-in-%u), %u sections\n",
+			(uint32_t) (pkt.pulseId() >> 32), (uint32_t) pkt.pulseId(),
+			pkt.base_type(), pkt.version(), pkt.packet_length(),
+			pkt.pulseCount(), pkt.eventCount(), pkt.eventDecimation(),
+			pkt.sectionCount());
+		for (uint32_t i = 0; i < pkt.sectionCount(); i++) {
+			std::vector<uint32_t> bins;
+			uint64_t total = 0;
+			pkt.accumulate(i, bins);
+			for (uint32_t b = 0; b < bins.size(); b++)
+				total += bins[b];
+			if ( pkt.kind(i) == ADARA::HistoPreviewPkt::PIXEL_COUNTS )
+				printf("    Pixels %u-%u: %lu counts\n", pkt.base(i),
+					pkt.base(i) + pkt.binCount(i) - 1, total);
+			else
+				printf("    Bank %d TOF %u+%u x %u us: %lu counts\n",
+					(int32_t) pkt.bankId(i), pkt.base(i),
+					pkt.binWidth(i), pkt.binCount(i), total);
+		}
+	}
+
+	return false;
+}
+
 bool Parser::rxPacket(const ADARA::DataDonePkt &pkt)
 {
 	if ( !m_terse ) {
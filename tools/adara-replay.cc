@@ -1,246 +1,503 @@
-// A simple program to read an ADARA stream file and replay it at a
-// user-defined speed (which is assumed to be something less than
-// "as fast as the hard disk will go".
+// Replays a recorded ADARA stream (SMS data files, in order, or stdin)
+// to stdout (or a file/FIFO), paced by the packet timestamps, so it can
+// be piped into 'nc' or similar to load-test SMS and STC with recorded
+// production data.
 //
-// Default is to read from stdin and write to stdout
-// (We're assuming the data will be piped to 'nc' or something similar
-// so that other ADARA live clients can connect to it.)
+// Each packet is due at (its timestamp - the anchor packet's timestamp)
+// / speed after the replay starts, on CLOCK_MONOTONIC. Packets "from
+// the past" (the SMS replays cached device descriptors and variable
+// values at the start of each file, stamped with their original times)
+// are due along with the packet before them, and forward jumps of more
+// than --maxgap in the timestamps (idle time between runs) are cut down
+// to --maxgap. The anchor is the first packet, unless the stream opens
+// with such stale packets: then it's the first packet more than
+// --maxgap past them, so the replay doesn't idle on the way in.
 //
-// Works by parsing the ADARA stream just enough to pull the timestamps
-// from the packet headers and then comparing them to the computer's
-// actual time.
-
+// Packets due within --window of each other go out together in one
+// writev(), and we clock_nanosleep() to an absolute deadline for the
+// next batch, so pacing doesn't drift however long the replay runs.
+//
+// Stats report the achieved rate against the rate the timestamps ask
+// for, and how late batches went out compared to their deadline.
 
-#include "ADARAParser.h"
-#include "ADARAUtil.h"
+#include <iostream>
+#include <string>
+#include <vector>
 
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
 #include <time.h>
+#include <math.h>
 
-#include <iostream>
-#include <fstream>
+#include <boost/program_options.hpp>
+
+#include "ADARA.h"
+#include "ADARAUtils.h"
+
+namespace po = boost::program_options;
+
+static double speed = 1.0;
+static bool max_rate = false;
+static uint32_t loops = 1;
+static uint32_t window_us = 100;
+static double max_gap = 5.0;
+static double stats_interval = 5.0;
+static std::string output;
+static std::vector<std::string> inputs;
+
+/* Largest payload we'll believe; anything bigger is a corrupt stream */
+#define REPLAY_MAX_PAYLOAD	(64 * 1024 * 1024)
+
+/* Read this much at a time, and flush a batch at this many bytes */
+#define REPLAY_READ_SIZE	(16 * 1024 * 1024)
+#define REPLAY_BATCH_BYTES	(4 * 1024 * 1024)
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
 
-class SimpleParser : public ADARA::Parser
+static inline uint64_t monoNow(void)
 {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * NANO_PER_SECOND_LL + ts.tv_nsec;
+}
+
+static inline void sleepUntil(uint64_t deadline)
+{
+	struct timespec ts;
+	ts.tv_sec = deadline / NANO_PER_SECOND_LL;
+	ts.tv_nsec = deadline % NANO_PER_SECOND_LL;
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL)
+			== EINTR)
+		;
+}
+
+class Replay {
 public:
-    SimpleParser( std::ostream &outstream = std::cout, float tf = 1.0);
-
-    // Override some protected base class functions with 
-    // public versions
-    uint8_t *bufferFillAddress(void) const {
-        return ADARA::Parser::bufferFillAddress();
-    }
-
-    unsigned int bufferFillLength(void) const {
-        return ADARA::Parser::bufferFillLength();
-    }
-
-    void bufferBytesAppended(unsigned int count) {
-        return ADARA::Parser::bufferBytesAppended( count);
-    }
-    
-    int bufferParse(std::string & log_info, unsigned int max_packets = 0) {
-        return ADARA::Parser::bufferParse( log_info, max_packets );
-    }
-
-protected:
-    
-    using ADARA::Parser::rxPacket;
-    virtual bool rxPacket( const ADARA::Packet &pkt);
-    
+	Replay(int out_fd) : m_out(out_fd), m_haveFirst(false),
+		m_paced(false), m_firstPkt(0), m_lastPkt(0), m_base(0),
+		m_firstBase(0),
+		m_lastDue(0), m_start(0), m_lastStats(0),
+		m_batchBytes(0), m_batchDue(0), m_packets(0), m_bytes(0),
+		m_statsPackets(0), m_statsBytes(0), m_batches(0),
+		m_lateSum(0), m_lateSumSq(0), m_lateMax(0),
+		m_statsBatches(0), m_statsLateSum(0), m_statsLateMax(0)
+	{ }
+
+	void start(void) { m_start = m_lastStats = monoNow(); }
+
+	/* Replay the whole of an input; false on a bad or short stream */
+	bool replayFd(int fd, const std::string &name);
+
+	/* Run the next loop right where this one left off */
+	void rebase(void) { m_haveFirst = false; }
+
+	void finish(void);
+
 private:
-    std::ostream &m_out;
-    
-    // This requires some explanation:  We want to control how fast the
-    // packets are replayed.  Each packet has a timestamp, so we know how
-    // fast they were originally generated.  We need to subtract the first
-    // packet's timestamp from the current packet's timestamp to get a
-    // delta.  We then subtract the time the first packet was output from the
-    // current time and get an 'output delta'.  We then multiply the 'output
-    // delta' by the time factor.  When this modified output delta is greater
-    // than the timestamp delta, it's time to write out the packet.
-    //
-    // Multiplying the original output delta by the time factor allows us to
-    // adjust the rate the packets are written. Thus, if the factor is 2, we
-    // will wind up with packets being output at twice the speed they were
-    // originally generated.  A factor of 3, and the packets come out 3 times
-    // faster.  A factor of 0.5, and the packets come out at *half* their
-    // original speed.
-    float m_timeFactor;
-    struct timespec m_firstPktTime;
-    struct timespec m_firstOutTime;
-    
-    // Starts false, set to true after we process the first packet
-    // (Used so we know we have to initialize m_first*Time)
-    bool m_firstPktReceived;  
-
-    time_t m_last_stats;  // the last time the stats were printed
-#define STATS_INTERVAL 5 // in seconds
-    unsigned int m_packets_processed;
-    unsigned long m_total_packets_processed;
-    unsigned long m_total_bytes_processed;
-  
-    // returns elapsed time in nanoseconds!
-    inline int64_t fastElapsed( const timespec &start) const
-    {
-        struct timespec now;
-        clock_gettime(CLOCK_REALTIME, &now);
-        return fastElapsed( start, now);
-    }
-        
-    inline int64_t fastElapsed( const timespec &start, const timespec &end) const
-    {
-        int64_t rv;
-        if (end.tv_sec == start.tv_sec)
-        {
-            rv = end.tv_nsec - start.tv_nsec;
-        }
-        else
-        {
-            rv = ( ( end.tv_sec - start.tv_sec ) * NANO_PER_SECOND_LL ) +
-                  ( end.tv_nsec - start.tv_nsec );
-        }
-        return rv;
-    }
-    
-    // returns true if it's time to output the next packet
-    bool timesUp( const struct timespec &pktTime);
-    
-    // prints (to stderr) some basic stats about the packet processing...
-    void printStats( );
-    
-    // No copy constructor or assignment operator
-    SimpleParser( const SimpleParser &p);
-    SimpleParser & operator= (const SimpleParser &p);
-    
+	int m_out;
+
+	bool m_haveFirst;
+	bool m_paced;		// anything due after m_base this loop
+	uint64_t m_firstPkt;	// stream ns of this loop's anchor packet
+	uint64_t m_lastPkt;	// latest stream ns seen this loop
+	uint64_t m_base;	// monotonic ns it was due at
+	uint64_t m_firstBase;	// same, for the first loop
+	uint64_t m_lastDue;
+	uint64_t m_start;
+	uint64_t m_lastStats;
+
+	std::vector<uint8_t> m_buf;
+
+	std::vector<struct iovec> m_batch;
+	uint64_t m_batchBytes;
+	uint64_t m_batchDue;	// deadline of the batch's first packet
+
+	uint64_t m_packets;
+	uint64_t m_bytes;
+
+	uint64_t m_statsPackets;
+	uint64_t m_statsBytes;
+
+	/* Lateness of each batch vs. its deadline, ns */
+	uint64_t m_batches;
+	double m_lateSum;
+	double m_lateSumSq;
+	uint64_t m_lateMax;
+	uint64_t m_statsBatches;
+	double m_statsLateSum;
+	uint64_t m_statsLateMax;
+
+	void packet(const uint8_t *pkt, uint32_t len, uint64_t ts);
+	void flush(void);
+	void writeBatch(void);
+	void stats(bool final);
 };
 
+bool Replay::replayFd(int fd, const std::string &name)
+{
+	size_t have = 0;
+	bool eof = false;
+
+	if (m_buf.size() < REPLAY_READ_SIZE)
+		m_buf.resize(REPLAY_READ_SIZE);
+
+	while (!eof || have) {
+		/* Top up the buffer */
+		while (!eof && have < m_buf.size()) {
+			ssize_t rc = read(fd, &m_buf[have], m_buf.size() - have);
+			if (rc < 0) {
+				if (errno == EINTR)
+					continue;
+				std::cerr << name << ": read error: "
+					<< strerror(errno) << std::endl;
+				return false;
+			}
+			if (!rc)
+				eof = true;
+			have += rc;
+		}
+
+		/* Queue up every whole packet in it */
+		size_t off = 0;
+		while (off + sizeof(ADARA::Header) <= have) {
+			const ADARA::Header *hdr =
+				(const ADARA::Header *) &m_buf[off];
+			if (hdr->payload_len > REPLAY_MAX_PAYLOAD) {
+				std::cerr << name << ": bad payload length "
+					<< hdr->payload_len << std::endl;
+				flush();
+				return false;
+			}
+
+			uint32_t len = sizeof(ADARA::Header) + hdr->payload_len;
+			if (off + len > have)
+				break;
+
+			uint64_t ts = (uint64_t) hdr->ts_sec * NANO_PER_SECOND_LL
+				+ hdr->ts_nsec;
+			packet(&m_buf[off], len, ts);
+			off += len;
+		}
+
+		/* The batch points into the buffer we're about to reuse */
+		flush();
+
+		if (eof && off < have) {
+			std::cerr << name << ": " << have - off
+				<< " trailing bytes ignored" << std::endl;
+			return false;
+		}
+
+		/* Move the partial packet down, growing for a big one */
+		memmove(&m_buf[0], &m_buf[off], have - off);
+		have -= off;
+		if (have >= sizeof(ADARA::Header)) {
+			const ADARA::Header *hdr = (const ADARA::Header *) &m_buf[0];
+			size_t need = sizeof(ADARA::Header) + hdr->payload_len;
+			if (need > m_buf.size())
+				m_buf.resize(need);
+		}
+	}
+
+	return true;
+}
 
-SimpleParser::SimpleParser( std::ostream &outstream, float tf)
-    : m_out( outstream),
-      m_timeFactor( tf),
-      m_firstPktReceived( false),
-      m_last_stats( time(NULL)),
-      m_packets_processed( 0),
-      m_total_packets_processed( 0),
-      m_total_bytes_processed( 0)
+void Replay::packet(const uint8_t *pkt, uint32_t len, uint64_t ts)
 {
+	uint64_t due;
+
+	if (max_rate)
+		due = 0;
+	else {
+		if (!m_haveFirst) {
+			/* Start each loop where the last one left off */
+			m_firstPkt = m_lastPkt = ts;
+			if (!m_firstBase)
+				m_firstBase = monoNow();
+			m_base = m_lastDue ? m_lastDue : m_firstBase;
+			m_haveFirst = true;
+			m_paced = false;
+		}
+
+		/* Skip over long gaps, as if they'd been max_gap long; one
+		 * before anything's been paced is just the end of stale
+		 * packets, so start the clock over from here instead.
+		 */
+		if (ts > m_lastPkt) {
+			uint64_t gap = ts - m_lastPkt;
+			uint64_t max = (uint64_t) (max_gap * NANO_PER_SECOND_LL);
+			if (max_gap > 0.0 && gap > max)
+				m_firstPkt = m_paced ? m_firstPkt + gap - max : ts;
+			m_lastPkt = ts;
+		}
+
+		if (ts <= m_firstPkt)
+			due = m_base;
+		else {
+			uint64_t delta = ts - m_firstPkt;
+			due = m_base + (uint64_t) (delta / speed);
+			m_paced = true;
+		}
+
+		/* Deadlines never go backwards, so packets from the past go
+		 * out with whatever came before them, not "late"
+		 */
+		if (due < m_lastDue)
+			due = m_lastDue;
+		m_lastDue = due;
+
+		/* Due after this batch's window? Send the batch, then wait */
+		if (!m_batch.empty()
+				&& due > m_batchDue + window_us * 1000ULL)
+			flush();
+	}
+
+	if (m_batch.size() >= IOV_MAX || m_batchBytes >= REPLAY_BATCH_BYTES)
+		flush();
+
+	if (m_batch.empty())
+		m_batchDue = due;
+
+	struct iovec iov;
+	iov.iov_base = (void *) pkt;
+	iov.iov_len = len;
+	m_batch.push_back(iov);
+	m_batchBytes += len;
+
+	m_packets++;
+	m_bytes += len;
+	m_statsPackets++;
+	m_statsBytes += len;
 }
 
-bool SimpleParser::rxPacket( const ADARA::Packet &pkt)
+void Replay::flush(void)
 {
-    if (m_firstPktReceived == false)
-    {
-       // This is the first packet - need to init the m_first*Time variables
-       m_firstPktTime = pkt.timestamp();
-       clock_gettime( CLOCK_REALTIME, &m_firstOutTime);
-       m_firstPktReceived = true;
-    }
-    
-    // Wait until it's time to output this packet   
-    while (! timesUp( pkt.timestamp()))
-    {
-        usleep( 100); // TODO: do a better job of figuring out how long to sleep
-    }
-    
-    // Output the packet data
-    m_out.write( (const char *)pkt.packet(), pkt.packet_length());
-    
-    // Keep track of some packet statistics
-    m_packets_processed++;
-    m_total_packets_processed++;
-    m_total_bytes_processed += pkt.packet_length();
-    
-    if (time( NULL) > (m_last_stats + STATS_INTERVAL))
-    {
-        printStats();
-        m_packets_processed = 0;
-        m_last_stats = time(NULL);
-    }
-     
-    return false;  // false indicates no error
+	if (m_batch.empty())
+		return;
+
+	if (!max_rate) {
+		uint64_t now = monoNow();
+		if (m_batchDue > now) {
+			sleepUntil(m_batchDue);
+			now = monoNow();
+		}
+
+		uint64_t late = now - m_batchDue;
+		m_batches++;
+		m_lateSum += late;
+		m_lateSumSq += (double) late * late;
+		if (late > m_lateMax)
+			m_lateMax = late;
+		m_statsBatches++;
+		m_statsLateSum += late;
+		if (late > m_statsLateMax)
+			m_statsLateMax = late;
+	}
+
+	writeBatch();
+
+	if (stats_interval > 0.0 && monoNow() - m_lastStats
+			>= stats_interval * NANO_PER_SECOND_LL)
+		stats(false);
 }
 
+void Replay::writeBatch(void)
+{
+	struct iovec *iov = &m_batch[0];
+	int cnt = m_batch.size();
+
+	while (cnt) {
+		ssize_t rc = writev(m_out, iov, cnt);
+		if (rc < 0) {
+			if (errno == EINTR)
+				continue;
+			std::cerr << "write error: " << strerror(errno)
+				<< std::endl;
+			exit(1);
+		}
 
-#if 1
+		/* Short write; skip what went out */
+		while (cnt && (size_t) rc >= iov->iov_len) {
+			rc -= iov->iov_len;
+			iov++;
+			cnt--;
+		}
+		if (cnt) {
+			iov->iov_base = (uint8_t *) iov->iov_base + rc;
+			iov->iov_len -= rc;
+		}
+	}
 
-bool SimpleParser::timesUp( const struct timespec &pktTime)
+	m_batch.clear();
+	m_batchBytes = 0;
+}
+
+void Replay::stats(bool final)
 {
-    bool rv = false;
-    int64_t pktDelta = fastElapsed( m_firstPktTime, pktTime);
-    int64_t outputDelta = fastElapsed( m_firstOutTime);  
-    
-    outputDelta *= m_timeFactor;
-    
-    // The packet strem will occasionally have packets 'from the past'
-    // (ie: times prior to m_firstPktTime).  This happens at run start when 
-    // SMS dumps out all the device descriptor and variable value packets
-    // (which it has cached).  There's other places where this can
-    // happen, too.  Regardless, if the pktDelta is < 0, then we will
-    // output the packet without waiting.
-    
-    if ( (pktDelta < 0) || (outputDelta > pktDelta))
-    {
-        rv = true;
-    }
-    
-    return rv;
+	uint64_t now = monoNow();
+
+	double secs = (now - (final ? m_start : m_lastStats)) / 1e9;
+	uint64_t bytes = final ? m_bytes : m_statsBytes;
+	uint64_t packets = final ? m_packets : m_statsPackets;
+
+	if (secs <= 0.0)
+		secs = 1e-9;
+
+	fprintf(stderr, "%s%lu packets, %.1f MB in %.2f s:"
+		" %.0f packets/s, %.2f MB/s",
+		final ? "Total: " : "", packets, bytes / 1e6, secs,
+		packets / secs, bytes / 1e6 / secs);
+
+	if (!max_rate) {
+		/* What the timestamps asked for, overall */
+		if (final && m_lastDue > m_firstBase) {
+			fprintf(stderr, " (requested %.2f MB/s at %gx)",
+				m_bytes / ((m_lastDue - m_firstBase) / 1e9) / 1e6,
+				speed);
+		}
+
+		uint64_t batches = final ? m_batches : m_statsBatches;
+		double sum = final ? m_lateSum : m_statsLateSum;
+		uint64_t max = final ? m_lateMax : m_statsLateMax;
+		if (batches) {
+			fprintf(stderr, "; late by %.1f us mean, %.1f us max",
+				sum / batches / 1e3, max / 1e3);
+			if (final) {
+				double mean = m_lateSum / m_batches;
+				double var = m_lateSumSq / m_batches - mean * mean;
+				fprintf(stderr, ", %.1f us stddev, %lu batches",
+					(var > 0.0 ? sqrt(var) : 0.0) / 1e3, m_batches);
+			}
+		}
+	}
+
+	fprintf(stderr, "\n");
+
+	m_lastStats = now;
+	m_statsPackets = m_statsBytes = 0;
+	m_statsBatches = 0;
+	m_statsLateSum = 0;
+	m_statsLateMax = 0;
 }
-#else
-// this will cause us to output packets as fast as possible (for debugging)
-bool SimpleParser::timesUp( const timespec &outTime)
+
+void Replay::finish(void)
 {
-    return true;
+	flush();
+	stats(true);
 }
-#endif
 
-// prints (to stderr) some basic stats about the packet processing...
-void SimpleParser::printStats()
+static void parse_options(int argc, char **argv)
 {
-    unsigned packetsPerSec = m_packets_processed / (time(NULL) - m_last_stats);
-    std::cerr << "Packets per second: " << packetsPerSec
-              << " / Total packets: " << m_total_packets_processed
-              << " / Total MB: " << m_total_bytes_processed / (float)(1024*1024)
-              << std::endl;
+	po::options_description desc("Allowed options");
+	desc.add_options()
+		("help,h", "Show usage information")
+		("speed,s", po::value<double>(&speed),
+				"Replay at this multiple of the recorded rate")
+		("max,m", po::bool_switch(&max_rate),
+				"Replay as fast as the output will take it")
+		("loop,l", po::value<uint32_t>(&loops),
+				"Replay the input this many times (0 = forever)")
+		("window,w", po::value<uint32_t>(&window_us),
+				"Send packets due within this many usec together")
+		("maxgap,g", po::value<double>(&max_gap),
+				"Cut timestamp gaps longer than this many seconds"
+				" (0 = keep them)")
+		("stats", po::value<double>(&stats_interval),
+				"Seconds between rate reports (0 = only at end)")
+		("output,o", po::value<std::string>(&output),
+				"Write here instead of stdout")
+		("input", po::value<std::vector<std::string> >(&inputs),
+				"Stream files, in order (default stdin)");
+
+	po::positional_options_description pos;
+	pos.add("input", -1);
+
+	po::variables_map vm;
+	try {
+		po::store(po::command_line_parser(argc, argv).options(desc)
+				.positional(pos).run(), vm);
+		po::notify(vm);
+	} catch (po::error &e) {
+		std::cerr << argv[0] << ": " << e.what() << std::endl
+			<< std::endl << desc << std::endl;
+		exit(2);
+	}
+
+	if (vm.count("help")) {
+		std::cerr << "usage: " << argv[0]
+			<< " [options] [stream files...]" << std::endl
+			<< std::endl << desc << std::endl;
+		exit(2);
+	}
+
+	if (!(speed > 0.0)) {
+		std::cerr << argv[0] << ": speed must be positive" << std::endl;
+		exit(2);
+	}
+
+	if (inputs.empty() && loops != 1) {
+		std::cerr << argv[0] << ": can't loop over stdin" << std::endl;
+		exit(2);
+	}
 }
 
-// TODO: Need to add code to handle a command line option for the time factor
 int main(int argc, char **argv)
 {
-    SimpleParser p;
-    
-    uint8_t * parseBuf;
-    unsigned int bufLen;
-    
-    if (argc > 1)
-    {
-        std::cerr << "Usage:" << std::endl
-                  << "  " << argv[0] << " takes no parameters.  It reads from"
-                  << " stdin and writes to stdout." << std::endl;
-        return 1;
-    }
-   
-    while (std::cin.good())
-    {
-        parseBuf = p.bufferFillAddress();
-        bufLen = p.bufferFillLength();
-        
-        std::cin.read( (char *)parseBuf, bufLen);
-        
-        // Some basic error checking code that will probably never get called
-        if (std::cin.gcount() == 0)
-        {
-            std::cerr << "Read 0 bytes from standard input.  Position: "
-                      << std::cin.tellg() << std::endl;
-            usleep(100 * 1000);  // sleep for a bit and hope the whatever
-                                 // caused the problem sorts itself out...
-        }
-        
-        p.bufferBytesAppended(std::cin.gcount());
-
-		std::string log_info;
-        p.bufferParse(log_info);
-		std::cerr << "Buffer Parse returned: " << log_info << std::endl;
-    }
-    
-    return 0;
+	parse_options(argc, argv);
+
+	int out_fd = STDOUT_FILENO;
+	if (!output.empty()) {
+		out_fd = open(output.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (out_fd < 0) {
+			std::cerr << "Unable to open " << output << ": "
+				<< strerror(errno) << std::endl;
+			return 1;
+		}
+	}
+
+	Replay replay(out_fd);
+	replay.start();
+
+	bool ok = true;
+	for (uint32_t loop = 0; ok && (!loops || loop < loops); loop++) {
+		if (inputs.empty()) {
+			ok = replay.replayFd(STDIN_FILENO, "stdin");
+			break;
+		}
+
+		for (uint32_t i = 0; ok && i < inputs.size(); i++) {
+			int fd = open(inputs[i].c_str(), O_RDONLY);
+			if (fd < 0) {
+				std::cerr << "Unable to open " << inputs[i] << ": "
+					<< strerror(errno) << std::endl;
+				return 1;
+			}
+			posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+			ok = replay.replayFd(fd, inputs[i]);
+			close(fd);
+		}
+
+		replay.rebase();
+	}
+
+	replay.finish();
+
+	if (out_fd != STDOUT_FILENO && close(out_fd)) {
+		std::cerr << "Error closing " << output << ": "
+			<< strerror(errno) << std::endl;
+		return 1;
+	}
+
+	return ok ? 0 : 1;
 }
@@ -0,0 +1,475 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include <boost/program_options.hpp>
+
+#include "ADARA.h"
+
+/* adara-split cuts a run's raw .adara stream (the SMS data files, in
+ * order) into N segments of roughly equal size, on pulse boundaries.
+ *
+ * Cuts only ever fall on pulse boundaries, just before the first pulse
+ * packet (RTDL, banked events or beam monitor events) of a new pulse, so
+ * no pulse is ever split across two segments. Each segment after the
+ * first starts with a "prologue": a snapshot of the run state in effect
+ * at the cut, i.e. the run's first Run Status packet, the latest Run
+ * Info, Beamline Info, Geometry, Pixel Mapping, Beam Monitor Config and
+ * Detector Bank Sets packets, every Device Descriptor and the latest
+ * value of every process variable. That's the same state the SMS replays
+ * at the front of each of its own data files, so every segment parses
+ * (adara-parser, adara-dump) with the run's configuration in hand.
+ *
+ * A segment alone doesn't make a run's NeXus file: STC normalizes times
+ * to the run's first pulse, trims PV logs and totals pulses and charge
+ * over the whole run, none of which a segment can know. So with
+ * --skeleton, the whole run is also written out once more with its
+ * events stripped (every pulse, source, bank and monitor header kept,
+ * with no events), which STC translates in a fraction of the time.
+ * Each segment is translated side by side with "stc --segment", then
+ * "stc --stitch" translates the skeleton, taking everything but the
+ * events from it, just as for the whole run, and the events (with their
+ * event indices offset) from the segments' partial NeXus files, in
+ * order. tools/adara-translate-parallel does all of that.
+ *
+ * Dropping the prologue from each segment (its byte count is printed in
+ * the manifest) and concatenating the segments reproduces the input
+ * stream byte for byte; tools/test/split-test checks that.
+ */
+
+namespace po = boost::program_options;
+
+static uint32_t num_segments = 4;
+static std::string out_dir = ".";
+static std::string prefix = "segment";
+static bool verbose = false;
+static bool skeleton = false;
+static std::vector<std::string> inputs;
+
+/* Largest payload we'll believe; anything bigger is a corrupt stream */
+#define SPLIT_MAX_PAYLOAD	(64 * 1024 * 1024)
+
+/* Order of the singleton state packets in a prologue */
+static const uint32_t prologue_order[] = {
+	ADARA::PacketType::RUN_STATUS_TYPE,
+	ADARA::PacketType::RUN_INFO_TYPE,
+	ADARA::PacketType::BEAMLINE_INFO_TYPE,
+	ADARA::PacketType::GEOMETRY_TYPE,
+	ADARA::PacketType::PIXEL_MAPPING_TYPE,
+	ADARA::PacketType::PIXEL_MAPPING_ALT_TYPE,
+	ADARA::PacketType::BEAM_MONITOR_CONFIG_TYPE,
+	ADARA::PacketType::DETECTOR_BANK_SETS_TYPE,
+};
+
+#define PROLOGUE_SINGLETONS \
+	(sizeof(prologue_order) / sizeof(prologue_order[0]))
+
+/* Device Descriptors, then Variable Values, after the singletons */
+#define PROLOGUE_RANK_DDP	(PROLOGUE_SINGLETONS)
+#define PROLOGUE_RANK_VAR	(PROLOGUE_SINGLETONS + 1)
+
+struct StateKey {
+	uint32_t rank;
+	uint32_t dev;
+	uint32_t var;
+
+	StateKey(uint32_t r, uint32_t d, uint32_t v) :
+		rank(r), dev(d), var(v) {}
+
+	bool operator<(const StateKey &o) const {
+		if (rank != o.rank)
+			return rank < o.rank;
+		if (dev != o.dev)
+			return dev < o.dev;
+		return var < o.var;
+	}
+};
+
+typedef std::map<StateKey, std::string> StateMap;
+
+struct Segment {
+	Segment() : file(NULL), prologue_bytes(0), bytes(0),
+		first_pulse(0), pulses(0) {}
+
+	std::string path;
+	FILE *file;
+	uint64_t prologue_bytes;
+	uint64_t bytes;
+	uint64_t first_pulse;
+	uint64_t pulses;
+};
+
+static bool isPulsePacket(uint32_t base_type)
+{
+	switch (base_type) {
+	case ADARA::PacketType::RTDL_TYPE:
+	case ADARA::PacketType::BANKED_EVENT_TYPE:
+	case ADARA::PacketType::BANKED_EVENT_STATE_TYPE:
+	case ADARA::PacketType::BEAM_MONITOR_EVENT_TYPE:
+		return true;
+	}
+
+	return false;
+}
+
+/* Returns false if the packet isn't run state */
+static bool stateKey(uint32_t base_type, const uint32_t *payload,
+			uint32_t payload_len, StateKey &key)
+{
+	for (uint32_t i = 0; i < PROLOGUE_SINGLETONS; i++) {
+		if (base_type == prologue_order[i]) {
+			key = StateKey(i, 0, 0);
+			return true;
+		}
+	}
+
+	switch (base_type) {
+	case ADARA::PacketType::DEVICE_DESC_TYPE:
+		if (payload_len < sizeof(uint32_t))
+			return false;
+		key = StateKey(PROLOGUE_RANK_DDP, payload[0], 0);
+		return true;
+
+	case ADARA::PacketType::VAR_VALUE_U32_TYPE:
+	case ADARA::PacketType::VAR_VALUE_DOUBLE_TYPE:
+	case ADARA::PacketType::VAR_VALUE_STRING_TYPE:
+	case ADARA::PacketType::VAR_VALUE_U32_ARRAY_TYPE:
+	case ADARA::PacketType::VAR_VALUE_DOUBLE_ARRAY_TYPE:
+	case ADARA::PacketType::MULT_VAR_VALUE_U32_TYPE:
+	case ADARA::PacketType::MULT_VAR_VALUE_DOUBLE_TYPE:
+	case ADARA::PacketType::MULT_VAR_VALUE_STRING_TYPE:
+	case ADARA::PacketType::MULT_VAR_VALUE_U32_ARRAY_TYPE:
+	case ADARA::PacketType::MULT_VAR_VALUE_DOUBLE_ARRAY_TYPE:
+		if (payload_len < 2 * sizeof(uint32_t))
+			return false;
+		key = StateKey(PROLOGUE_RANK_VAR, payload[0], payload[1]);
+		return true;
+	}
+
+	return false;
+}
+
+/* Copies an event packet's payload without its events, keeping the
+ * pulse info and every source, bank and monitor header (with a zero
+ * event count), so STC still meets each bank and monitor on the same
+ * pulse as in the whole run. Returns false for other packets, or any
+ * event packet that doesn't add up, which are best copied as they are.
+ */
+static bool stripEvents(uint32_t base_type, const uint32_t *payload,
+			uint32_t payload_len, std::vector<uint32_t> &out)
+{
+	uint32_t words = payload_len / sizeof(uint32_t);
+	uint32_t bank_hdr;
+	uint32_t r, i;
+
+	if (payload_len % sizeof(uint32_t) || words < 4)
+		return false;
+
+	switch (base_type) {
+	case ADARA::PacketType::BANKED_EVENT_TYPE:
+		bank_hdr = 2;	/* bank id, event count */
+		break;
+	case ADARA::PacketType::BANKED_EVENT_STATE_TYPE:
+		bank_hdr = 3;	/* bank id, state, event count */
+		break;
+	case ADARA::PacketType::BEAM_MONITOR_EVENT_TYPE:
+		bank_hdr = 0;
+		break;
+	default:
+		return false;
+	}
+
+	/* Pulse info */
+	out.assign(payload, payload + 4);
+
+	for (r = 4; r < words; ) {
+		if (base_type == ADARA::PacketType::BEAM_MONITOR_EVENT_TYPE) {
+			/* Monitor id and event count, then source info */
+			if (words - r < 3)
+				return false;
+			uint32_t count = payload[r] & 0x003FFFFF;
+			out.push_back(payload[r] & ~0x003FFFFF);
+			out.push_back(payload[r + 1]);
+			out.push_back(payload[r + 2]);
+			r += 3;
+			if (count > words - r)
+				return false;
+			r += count;
+			continue;
+		}
+
+		/* Source id, source pulse info and bank count */
+		if (words - r < 4)
+			return false;
+		for (i = 0; i < 4; i++)
+			out.push_back(payload[r++]);
+
+		for (uint32_t banks = out.back(); banks; banks--) {
+			if (words - r < bank_hdr)
+				return false;
+			for (i = 0; i < bank_hdr - 1; i++)
+				out.push_back(payload[r++]);
+			uint32_t count = payload[r++];
+			out.push_back(0);
+			if (count > (words - r) / 2)
+				return false;
+			r += 2 * count;
+		}
+	}
+
+	return true;
+}
+
+static void writeOut(Segment &seg, const void *data, size_t len)
+{
+	if (fwrite(data, 1, len, seg.file) != len) {
+		std::cerr << "Error writing " << seg.path << ": "
+			<< strerror(errno) << std::endl;
+		exit(1);
+	}
+	seg.bytes += len;
+}
+
+static void openSegment(std::vector<Segment> &segs, const StateMap &state)
+{
+	Segment seg;
+	char name[32];
+
+	snprintf(name, sizeof(name), "-%03u.adara", (unsigned) segs.size());
+	seg.path = out_dir + "/" + prefix + name;
+
+	seg.file = fopen(seg.path.c_str(), "w");
+	if (!seg.file) {
+		std::cerr << "Unable to create " << seg.path << ": "
+			<< strerror(errno) << std::endl;
+		exit(1);
+	}
+
+	/* The first segment carries the run's own beginning */
+	if (!segs.empty()) {
+		StateMap::const_iterator it;
+		for (it = state.begin(); it != state.end(); ++it)
+			writeOut(seg, it->second.data(), it->second.size());
+		seg.prologue_bytes = seg.bytes;
+	}
+
+	if (!segs.empty() && fclose(segs.back().file)) {
+		std::cerr << "Error closing " << segs.back().path << ": "
+			<< strerror(errno) << std::endl;
+		exit(1);
+	}
+
+	segs.push_back(seg);
+}
+
+static void parse_options(int argc, char **argv)
+{
+	po::options_description desc("Allowed options");
+	desc.add_options()
+		("help,h", "Show usage information")
+		("segments,n", po::value<uint32_t>(&num_segments),
+				"Number of segments to split the run into")
+		("outdir,o", po::value<std::string>(&out_dir),
+				"Directory for the segment files")
+		("prefix,p", po::value<std::string>(&prefix),
+				"Segment file name prefix (<prefix>-NNN.adara)")
+		("verbose,v", po::bool_switch(&verbose),
+				"Report each cut as it's made")
+		("skeleton,s", po::bool_switch(&skeleton),
+				"Also write the run without its events "
+				"(<prefix>-skeleton.adara), for stc --stitch")
+		("input", po::value<std::vector<std::string> >(&inputs),
+				"Run data files, in order");
+
+	po::positional_options_description pos;
+	pos.add("input", -1);
+
+	po::variables_map vm;
+	try {
+		po::store(po::command_line_parser(argc, argv).options(desc)
+				.positional(pos).run(), vm);
+		po::notify(vm);
+	} catch (po::error &e) {
+		std::cerr << argv[0] << ": " << e.what() << std::endl
+			<< std::endl << desc << std::endl;
+		exit(2);
+	}
+
+	if (vm.count("help") || inputs.empty()) {
+		std::cerr << "usage: " << argv[0]
+			<< " [options] <run data files...>" << std::endl
+			<< std::endl << desc << std::endl;
+		exit(2);
+	}
+
+	if (!num_segments) {
+		std::cerr << argv[0] << ": segments must be non-zero"
+			<< std::endl;
+		exit(2);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	parse_options(argc, argv);
+
+	/* Cut targets are by bytes, so we need the whole run's size */
+	uint64_t total = 0;
+	for (uint32_t i = 0; i < inputs.size(); i++) {
+		struct stat st;
+		if (stat(inputs[i].c_str(), &st)) {
+			std::cerr << "Unable to stat " << inputs[i] << ": "
+				<< strerror(errno) << std::endl;
+			return 1;
+		}
+		total += st.st_size;
+	}
+
+	StateMap state;
+	std::vector<Segment> segs;
+	std::vector<uint32_t> payload(SPLIT_MAX_PAYLOAD / sizeof(uint32_t));
+	std::vector<uint32_t> stripped;
+	Segment skel;
+	uint64_t consumed = 0;
+	uint64_t cur_pulse = 0;
+	bool have_pulse = false;
+
+	openSegment(segs, state);
+
+	if (skeleton) {
+		skel.path = out_dir + "/" + prefix + "-skeleton.adara";
+		skel.file = fopen(skel.path.c_str(), "w");
+		if (!skel.file) {
+			std::cerr << "Unable to create " << skel.path << ": "
+				<< strerror(errno) << std::endl;
+			return 1;
+		}
+	}
+
+	for (uint32_t i = 0; i < inputs.size(); i++) {
+		FILE *in = fopen(inputs[i].c_str(), "r");
+		if (!in) {
+			std::cerr << "Unable to open " << inputs[i] << ": "
+				<< strerror(errno) << std::endl;
+			return 1;
+		}
+
+		uint32_t hdr[4];
+		size_t got;
+		while ((got = fread(hdr, 1, sizeof(hdr), in)) == sizeof(hdr)) {
+			uint32_t len = hdr[0];
+			uint32_t base_type = ADARA_BASE_PKT_TYPE(hdr[1]);
+			uint64_t pulse = ((uint64_t) hdr[2] << 32) | hdr[3];
+
+			if (len > SPLIT_MAX_PAYLOAD) {
+				std::cerr << inputs[i] << ": bad payload length "
+					<< len << " at offset "
+					<< ftell(in) - sizeof(hdr) << std::endl;
+				return 1;
+			}
+
+			if (len && fread(&payload[0], 1, len, in) != len) {
+				std::cerr << inputs[i] << ": truncated packet"
+					<< std::endl;
+				return 1;
+			}
+
+			if (isPulsePacket(base_type)
+					&& (!have_pulse || pulse != cur_pulse)) {
+				/* Start of a new pulse, the only place we cut */
+				uint64_t target = total * segs.size()
+					/ num_segments;
+				if (have_pulse && segs.size() < num_segments
+						&& consumed >= target) {
+					openSegment(segs, state);
+					if (verbose) {
+						std::cerr << "Cut at pulse 0x" << std::hex
+							<< pulse << std::dec << " after "
+							<< consumed << " bytes" << std::endl;
+					}
+				}
+
+				Segment &seg = segs.back();
+				if (!seg.pulses)
+					seg.first_pulse = pulse;
+				seg.pulses++;
+
+				cur_pulse = pulse;
+				have_pulse = true;
+			}
+
+			Segment &seg = segs.back();
+			writeOut(seg, hdr, sizeof(hdr));
+			if (len)
+				writeOut(seg, &payload[0], len);
+			consumed += sizeof(hdr) + len;
+
+			if (skeleton) {
+				if (stripEvents(base_type, &payload[0], len,
+						stripped)) {
+					uint32_t shdr[4] = { (uint32_t) (stripped.size()
+						* sizeof(uint32_t)), hdr[1], hdr[2], hdr[3] };
+					writeOut(skel, shdr, sizeof(shdr));
+					writeOut(skel, &stripped[0], shdr[0]);
+				} else {
+					writeOut(skel, hdr, sizeof(hdr));
+					if (len)
+						writeOut(skel, &payload[0], len);
+				}
+			}
+
+			/* Keep the run's opening Run Status, not later ones */
+			StateKey key(0, 0, 0);
+			if (stateKey(base_type, &payload[0], len, key)
+					&& (base_type != ADARA::PacketType::RUN_STATUS_TYPE
+					|| !state.count(key))) {
+				std::string &pkt = state[key];
+				pkt.assign((const char *) hdr, sizeof(hdr));
+				pkt.append((const char *) &payload[0], len);
+			}
+		}
+
+		if (got) {
+			std::cerr << inputs[i] << ": " << got
+				<< " trailing bytes ignored" << std::endl;
+		}
+
+		fclose(in);
+	}
+
+	if (fclose(segs.back().file)) {
+		std::cerr << "Error closing " << segs.back().path << ": "
+			<< strerror(errno) << std::endl;
+		return 1;
+	}
+
+	if (skeleton && fclose(skel.file)) {
+		std::cerr << "Error closing " << skel.path << ": "
+			<< strerror(errno) << std::endl;
+		return 1;
+	}
+
+	/* Manifest: file, prologue bytes, first pulse, pulses, total bytes */
+	for (uint32_t s = 0; s < segs.size(); s++) {
+		printf("%s %lu 0x%016lx %lu %lu\n", segs[s].path.c_str(),
+			segs[s].prologue_bytes, segs[s].first_pulse,
+			segs[s].pulses, segs[s].bytes);
+	}
+
+	if (segs.size() < num_segments) {
+		std::cerr << "Only " << segs.size() << " of " << num_segments
+			<< " segments; not enough pulses to go around"
+			<< std::endl;
+	}
+
+	return 0;
+}
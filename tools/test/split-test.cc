@@ -0,0 +1,429 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ADARA.h"
+
+/* Checks adara-split against a synthetic run spread over two data files:
+ *
+ *   - it makes as many segments as asked for, and the manifest agrees
+ *     with what's in them,
+ *   - dropping each segment's prologue and concatenating the segments
+ *     gives back the input byte for byte,
+ *   - every cut is on a pulse boundary,
+ *   - each prologue holds only run state: the run's first Run Status,
+ *     and the latest Run Info, Device Descriptors and variable values
+ *     as of the cut,
+ *   - the skeleton is the whole input, packet for packet, but with every
+ *     event packet's events dropped and its headers kept.
+ *
+ * Run from the top of the build tree, or name the adara-split to test.
+ *
+ * Usage: split-test [adara-split]
+ */
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+	if (!(cond)) { \
+		fprintf(stderr, "%s:%d: check failed: %s\n", \
+			__FILE__, __LINE__, #cond); \
+		failures++; \
+	} \
+} while (0)
+
+typedef std::vector<uint8_t> Bytes;
+
+struct Packet {
+	size_t offset;
+	uint32_t len;
+	uint32_t base_type;
+	uint64_t pulse;
+};
+
+static void addPacket(Bytes &out, uint32_t type, uint32_t sec, uint32_t nsec,
+		const std::vector<uint32_t> &payload)
+{
+	uint32_t hdr[4];
+	hdr[0] = payload.size() * sizeof(uint32_t);
+	hdr[1] = ADARA_PKT_TYPE(type, 0);
+	hdr[2] = sec;
+	hdr[3] = nsec;
+
+	size_t at = out.size();
+	out.resize(at + sizeof(hdr) + hdr[0]);
+	memcpy(&out[at], hdr, sizeof(hdr));
+	if (hdr[0])
+		memcpy(&out[at + sizeof(hdr)], &payload[0], hdr[0]);
+}
+
+static std::vector<Packet> packets(const Bytes &data)
+{
+	std::vector<Packet> pkts;
+	size_t off = 0;
+
+	while (off + 16 <= data.size()) {
+		const uint32_t *hdr = (const uint32_t *) &data[off];
+		Packet p;
+		p.offset = off;
+		p.len = hdr[0];
+		p.base_type = ADARA_BASE_PKT_TYPE(hdr[1]);
+		p.pulse = ((uint64_t) hdr[2] << 32) | hdr[3];
+		pkts.push_back(p);
+		off += 16 + p.len;
+	}
+	CHECK(off == data.size());
+
+	return pkts;
+}
+
+static bool isPulse(uint32_t base_type)
+{
+	return base_type == ADARA::PacketType::RTDL_TYPE
+		|| base_type == ADARA::PacketType::BANKED_EVENT_TYPE
+		|| base_type == ADARA::PacketType::BEAM_MONITOR_EVENT_TYPE;
+}
+
+/* Run state as of each packet: what a prologue cut there should hold */
+typedef std::map<std::pair<uint32_t, uint64_t>, std::string> State;
+
+static void track(State &state, const Bytes &data, const Packet &p)
+{
+	const uint32_t *payload = (const uint32_t *) &data[p.offset + 16];
+	std::string pkt((const char *) &data[p.offset], 16 + p.len);
+	uint64_t id = 0;
+
+	switch (p.base_type) {
+	case ADARA::PacketType::RUN_STATUS_TYPE:
+		if (state.count(std::make_pair(p.base_type, id)))
+			return;
+		break;
+	case ADARA::PacketType::RUN_INFO_TYPE:
+		break;
+	case ADARA::PacketType::DEVICE_DESC_TYPE:
+		id = payload[0];
+		break;
+	case ADARA::PacketType::VAR_VALUE_DOUBLE_TYPE:
+		id = ((uint64_t) payload[0] << 32) | payload[1];
+		break;
+	default:
+		return;
+	}
+
+	state[std::make_pair(p.base_type, id)] = pkt;
+}
+
+/* A run as the SMS would store it: pulses of RTDL, banked and monitor
+ * events, with PV updates in between, over two files each opening with
+ * the state replayed from before.
+ */
+static void makeRun(Bytes &file0, Bytes &file1, uint32_t pulses)
+{
+	std::vector<uint32_t> w;
+	uint32_t sec = 900000000, nsec = 0;
+	State state;
+
+	Bytes *out = &file0;
+
+	w.assign(3, 0);
+	w[0] = 1234;
+	addPacket(*out, ADARA::PacketType::RUN_STATUS_TYPE, sec, nsec, w);
+	w.assign(16, 0x6e75723c);
+	addPacket(*out, ADARA::PacketType::RUN_INFO_TYPE, sec, nsec, w);
+	for (uint32_t d = 1; d <= 3; d++) {
+		w.assign(8 + d, 0x3c3f786d);
+		w[0] = d;
+		addPacket(*out, ADARA::PacketType::DEVICE_DESC_TYPE, sec, nsec, w);
+	}
+
+	for (uint32_t n = 0; n < pulses; n++) {
+		nsec += 16666666;
+		if (nsec >= 1000000000) {
+			nsec -= 1000000000;
+			sec++;
+		}
+
+		if (n == pulses / 2) {
+			/* Next file, led by the state so far */
+			std::vector<Packet> pkts = packets(file0);
+			for (uint32_t i = 0; i < pkts.size(); i++)
+				track(state, file0, pkts[i]);
+			out = &file1;
+
+			/* Same run, but the second file */
+			w.assign(3, 0);
+			w[0] = 1234;
+			w[2] = 1;
+			addPacket(*out, ADARA::PacketType::RUN_STATUS_TYPE,
+				sec, nsec, w);
+
+			State::iterator it;
+			for (it = state.begin(); it != state.end(); ++it) {
+				if (it->first.first
+					== ADARA::PacketType::RUN_STATUS_TYPE)
+					continue;
+				out->insert(out->end(), it->second.begin(),
+					it->second.end());
+			}
+		}
+
+		w.assign(30, n);
+		addPacket(*out, ADARA::PacketType::RTDL_TYPE, sec, nsec, w);
+
+		/* Pulse info, then one source with one bank of events */
+		uint32_t events = rand() % 200;
+		w.assign(10 + 2 * events, n);
+		w[4] = 1;
+		w[7] = 1;
+		w[8] = n % 4;
+		w[9] = events;
+		addPacket(*out, ADARA::PacketType::BANKED_EVENT_TYPE, sec, nsec, w);
+
+		if (n % 3 == 0) {
+			/* Pulse info, then one monitor's events */
+			events = rand() % 20;
+			w.assign(7 + events, n);
+			w[4] = (1 << 22) | events;
+			addPacket(*out, ADARA::PacketType::BEAM_MONITOR_EVENT_TYPE,
+				sec, nsec, w);
+		}
+
+		if (n % 7 == 0) {
+			w.assign(5, 0);
+			w[0] = 1 + rand() % 3;
+			w[1] = 1 + rand() % 4;
+			w[3] = n;
+			addPacket(*out, ADARA::PacketType::VAR_VALUE_DOUBLE_TYPE,
+				sec, nsec, w);
+		}
+
+		if (n == pulses / 3) {
+			w.assign(20, 0x6f666e69);
+			addPacket(*out, ADARA::PacketType::RUN_INFO_TYPE,
+				sec, nsec, w);
+			w.assign(12, 0x3c3f786d);
+			w[0] = 2;
+			addPacket(*out, ADARA::PacketType::DEVICE_DESC_TYPE,
+				sec, nsec, w);
+		}
+	}
+}
+
+static bool writeFile(const std::string &path, const Bytes &data)
+{
+	FILE *f = fopen(path.c_str(), "w");
+	if (!f)
+		return false;
+	bool ok = fwrite(&data[0], 1, data.size(), f) == data.size();
+	return !fclose(f) && ok;
+}
+
+static bool readFile(const std::string &path, Bytes &data)
+{
+	FILE *f = fopen(path.c_str(), "r");
+	if (!f)
+		return false;
+
+	uint8_t buf[65536];
+	size_t got;
+	data.clear();
+	while ((got = fread(buf, 1, sizeof(buf), f)) > 0)
+		data.insert(data.end(), buf, buf + got);
+	fclose(f);
+	return true;
+}
+
+struct Entry {
+	std::string path;
+	unsigned long prologue;
+	unsigned long first_pulse;
+	unsigned long pulses;
+	unsigned long bytes;
+};
+
+static void checkSplit(const std::string &split, const std::string &dir,
+		const Bytes &input, uint32_t total_pulses, uint32_t n)
+{
+	char segs[16];
+	snprintf(segs, sizeof(segs), "%u", n);
+	std::string cmd = split + " -n " + segs + " -o " + dir + " -p seg "
+		+ dir + "/run-0.adara " + dir + "/run-1.adara";
+
+	FILE *p = popen(cmd.c_str(), "r");
+	CHECK(p != NULL);
+	if (!p)
+		return;
+
+	std::vector<Entry> manifest;
+	char path[4096];
+	Entry e;
+	while (fscanf(p, "%4095s %lu %lx %lu %lu", path, &e.prologue,
+			&e.first_pulse, &e.pulses, &e.bytes) == 5) {
+		e.path = path;
+		manifest.push_back(e);
+	}
+	CHECK(pclose(p) == 0);
+	CHECK(manifest.size() == n);
+
+	std::vector<Packet> in_pkts = packets(input);
+	Bytes joined;
+	unsigned long pulses = 0;
+	uint64_t last_pulse = 0;
+
+	for (uint32_t s = 0; s < manifest.size(); s++) {
+		const Entry &m = manifest[s];
+		Bytes seg;
+		CHECK(readFile(m.path, seg));
+		CHECK(seg.size() == m.bytes);
+		CHECK(m.prologue <= seg.size());
+		CHECK(s || !m.prologue);
+		if (m.prologue > seg.size())
+			continue;
+
+		/* The rest of the segment picks up where the last left off */
+		size_t cut = joined.size();
+		joined.insert(joined.end(), seg.begin() + m.prologue, seg.end());
+		pulses += m.pulses;
+
+		std::vector<Packet> pkts = packets(seg);
+		size_t body = 0;
+		while (body < pkts.size() && pkts[body].offset < m.prologue)
+			body++;
+		CHECK(body == pkts.size() || pkts[body].offset == m.prologue);
+
+		if (s) {
+			CHECK(body < pkts.size());
+			if (body == pkts.size())
+				continue;
+			CHECK(isPulse(pkts[body].base_type));
+			CHECK(pkts[body].pulse == m.first_pulse);
+			CHECK(pkts[body].pulse != last_pulse);
+		}
+
+		/* Prologue is the state as of the cut, and nothing else */
+		State want;
+		for (uint32_t i = 0; i < in_pkts.size()
+				&& in_pkts[i].offset < cut; i++)
+			track(want, input, in_pkts[i]);
+
+		State got;
+		for (uint32_t i = 0; i < body; i++) {
+			CHECK(!isPulse(pkts[i].base_type));
+			track(got, seg, pkts[i]);
+		}
+		CHECK(got.size() == body);
+		if (s)
+			CHECK(got == want);
+
+		for (uint32_t i = body; i < pkts.size(); i++) {
+			if (isPulse(pkts[i].base_type))
+				last_pulse = pkts[i].pulse;
+		}
+
+		unlink(m.path.c_str());
+	}
+
+	CHECK(joined == input);
+	CHECK(pulses == total_pulses);
+}
+
+static void checkSkeleton(const std::string &split, const std::string &dir,
+		const Bytes &input)
+{
+	std::string cmd = split + " -s -n 2 -o " + dir + " -p seg "
+		+ dir + "/run-0.adara " + dir + "/run-1.adara > /dev/null";
+	CHECK(system(cmd.c_str()) == 0);
+
+	Bytes skel;
+	CHECK(readFile(dir + "/seg-skeleton.adara", skel));
+
+	std::vector<Packet> in_pkts = packets(input);
+	std::vector<Packet> pkts = packets(skel);
+	CHECK(pkts.size() == in_pkts.size());
+
+	for (uint32_t i = 0; i < pkts.size() && i < in_pkts.size(); i++) {
+		const Packet &a = in_pkts[i];
+		const Packet &b = pkts[i];
+		const uint32_t *in = (const uint32_t *) &input[a.offset + 16];
+		const uint32_t *w = (const uint32_t *) &skel[b.offset + 16];
+
+		CHECK(b.base_type == a.base_type);
+		CHECK(b.pulse == a.pulse);
+
+		switch (a.base_type) {
+		case ADARA::PacketType::BANKED_EVENT_TYPE:
+			/* Up to the bank's event count, which is now zero */
+			CHECK(b.len == 10 * sizeof(uint32_t));
+			if (b.len != 10 * sizeof(uint32_t))
+				break;
+			CHECK(!memcmp(w, in, 9 * sizeof(uint32_t)));
+			CHECK(w[9] == 0);
+			break;
+		case ADARA::PacketType::BEAM_MONITOR_EVENT_TYPE:
+			CHECK(b.len == 7 * sizeof(uint32_t));
+			if (b.len != 7 * sizeof(uint32_t))
+				break;
+			CHECK(!memcmp(w, in, 4 * sizeof(uint32_t)));
+			CHECK(w[4] == (in[4] & ~0x003FFFFF));
+			CHECK(w[5] == in[5] && w[6] == in[6]);
+			break;
+		default:
+			CHECK(b.len == a.len);
+			CHECK(b.len != a.len || !memcmp(&skel[b.offset],
+				&input[a.offset], 16 + a.len));
+		}
+	}
+
+	unlink((dir + "/seg-000.adara").c_str());
+	unlink((dir + "/seg-001.adara").c_str());
+	unlink((dir + "/seg-skeleton.adara").c_str());
+}
+
+int main(int argc, char **argv)
+{
+	std::string split = argc > 1 ? argv[1] : "tools/adara-split";
+
+	char dir[] = "/tmp/split-test-XXXXXX";
+	if (mkdtemp(dir) == NULL) {
+		perror("mkdtemp");
+		return 1;
+	}
+
+	uint32_t pulses = 600;
+	Bytes file0, file1;
+	makeRun(file0, file1, pulses);
+
+	if (!writeFile(std::string(dir) + "/run-0.adara", file0)
+			|| !writeFile(std::string(dir) + "/run-1.adara", file1)) {
+		perror("write");
+		return 1;
+	}
+
+	Bytes input(file0);
+	input.insert(input.end(), file1.begin(), file1.end());
+
+	checkSplit(split, dir, input, pulses, 1);
+	checkSplit(split, dir, input, pulses, 2);
+	checkSplit(split, dir, input, pulses, 7);
+	checkSkeleton(split, dir, input);
+
+	unlink((std::string(dir) + "/run-0.adara").c_str());
+	unlink((std::string(dir) + "/run-1.adara").c_str());
+	rmdir(dir);
+
+	if (failures) {
+		fprintf(stderr, "%d check(s) failed\n", failures);
+		return 1;
+	}
+
+	printf("adara-split OK.\n");
+
+	return 0;
+}